@@ -134,6 +134,24 @@ OSMesaCreateContextExt( GLenum format, GLint depthBits, GLint stencilBits,
                         GLint accumBits, OSMesaContext sharelist);
 
 
+
+/*
+ * Like OSMesaCreateContextExt, but with a multisample (GL_ARB_multisample)
+ * framebuffer of the given number of samples per pixel, which is rounded
+ * up to 2, 4 or 8.  Zero or one sample gives an ordinary context.  Enable
+ * GL_MULTISAMPLE_ARB to draw antialiased polygons.
+ * The samples are kept in internal buffers and averaged into the image
+ * buffer by glFinish, glFlush and OSMesaGetColorBuffer.
+ * Returns NULL for more than 8 samples, or samples in color index mode.
+ *
+ * New in Mesa 6.5.
+ */
+GLAPI OSMesaContext GLAPIENTRY
+OSMesaCreateContextMultisample( GLenum format, GLint depthBits,
+                                GLint stencilBits, GLint accumBits,
+                                GLint samples, OSMesaContext sharelist );
+
+
 /*
  * Destroy an Off-Screen Mesa rendering context.
  *
@@ -252,6 +270,32 @@ OSMesaGetColorBuffer( OSMesaContext c, GLint *width, GLint *height,
 
 
 
+/*
+ * Read a rectangle of the current read buffer (see glReadBuffer) of the
+ * current context straight into the caller's memory.  The glPixelStore
+ * and pixel transfer state is ignored.  Faster than glReadPixels for
+ * grabbing frames.
+ * Input:  c - the OSMesa context, must be current
+ *         x, y, width, height - the rectangle, clipped to the buffer
+ *         format - GL_RGBA, GL_BGRA or GL_RGB
+ *         type - GL_UNSIGNED_BYTE or (not with GL_RGB)
+ *                GL_UNSIGNED_INT_8_8_8_8_REV
+ *         stride - bytes from the start of one row to the next; buffer
+ *                  is where the bottom row goes, so a negative stride
+ *                  stores the rows top-down
+ *         buffer - where to store the pixels
+ * Return:  GL_TRUE or GL_FALSE to indicate success or failure.  Fails if
+ *          the format and type aren't supported by the read buffer.
+ *
+ * New in Mesa 6.5.
+ */
+GLAPI GLboolean GLAPIENTRY
+OSMesaReadPixels( OSMesaContext c, GLint x, GLint y,
+                  GLsizei width, GLsizei height, GLenum format, GLenum type,
+                  GLint stride, void *buffer );
+
+
+
 /**
  * This typedef is new in Mesa 6.3.
  */
@@ -0,0 +1,164 @@
+/*
+ * Accumulation buffer benchmark for off-screen Mesa rendering.
+ *
+ * Times the glAccum operations used for motion blur and supersampling:
+ * GL_LOAD/GL_ACCUM with 1/n weights followed by GL_RETURN, and a decaying
+ * blur with GL_MULT which keeps the accumulation buffer in scaled mode.
+ * Reports the number of accumulation buffer pixels processed per second.
+ *
+ * Usage: osaccum [size]
+ *
+ * Setting MESA_SWRAST_THREADS splits the work between threads, and
+ * setting MESA_NO_ASM disables the SSE2 code, for comparison.  At the
+ * end a frame is accumulated with and without the SSE2 code and the
+ * results are compared.
+ *
+ * This program is in the public domain.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include "GL/osmesa.h"
+#include "oscheck.h"
+
+
+static GLint Size;
+
+
+/**
+ * Wall clock time in seconds; clock() would count the CPU time of all
+ * threads.
+ */
+static double
+now(void)
+{
+   struct timeval tv;
+   gettimeofday(&tv, NULL);
+   return tv.tv_sec + tv.tv_usec * 1.0e-6;
+}
+
+
+/**
+ * Do passes accumulation operations per frame for about one second.
+ * Return megapixels per second.
+ */
+static double
+run_test(GLint passes, GLboolean decay)
+{
+   double start, end;
+   int ops = 0;
+
+   glClear(GL_ACCUM_BUFFER_BIT);
+   start = now();
+   do {
+      GLint i;
+      for (i = 0; i < passes; i++) {
+         if (decay) {
+            glAccum(GL_MULT, 0.9F);
+            glAccum(GL_ACCUM, 0.1F);
+            ops += 2;
+         }
+         else {
+            glAccum(i ? GL_ACCUM : GL_LOAD, 1.0F / passes);
+            ops++;
+         }
+      }
+      glAccum(GL_RETURN, 1.0F);
+      ops++;
+      glFinish();
+      end = now();
+   } while (end - start < 1.0);
+
+   return (double) ops * Size * Size * 1.0e-6 / (end - start);
+}
+
+
+/**
+ * Accumulate a smooth shaded frame with each operation, returning values
+ * out of range.
+ */
+static void
+draw_check(void)
+{
+   glClear(GL_COLOR_BUFFER_BIT | GL_ACCUM_BUFFER_BIT);
+   glBegin(GL_QUADS);
+   glColor4f(1.0F, 0.0F, 0.0F, 1.0F);
+   glVertex2f(-1.0F, -1.0F);
+   glColor4f(0.0F, 1.0F, 0.0F, 0.5F);
+   glVertex2f(1.0F, -1.0F);
+   glColor4f(0.0F, 0.0F, 1.0F, 0.0F);
+   glVertex2f(1.0F, 1.0F);
+   glColor4f(1.0F, 1.0F, 1.0F, 0.25F);
+   glVertex2f(-1.0F, 1.0F);
+   glEnd();
+   glAccum(GL_LOAD, 0.25F);
+   glAccum(GL_ACCUM, 0.5F);
+   glAccum(GL_MULT, 0.9F);
+   glAccum(GL_ADD, 0.1F);
+   glAccum(GL_RETURN, 1.5F);
+}
+
+
+static OSMesaContext
+make_context(void *buffer)
+{
+   OSMesaContext ctx = OSMesaCreateContextExt(OSMESA_RGBA, 0, 0, 16, NULL);
+   if (!ctx || !OSMesaMakeCurrent(ctx, buffer, GL_UNSIGNED_BYTE, Size, Size)) {
+      printf("Creating the OSMesa context failed!\n");
+      exit(1);
+   }
+
+   glClearColor(0.2F, 0.4F, 0.6F, 0.8F);
+   glClear(GL_COLOR_BUFFER_BIT);
+   return ctx;
+}
+
+
+int
+main(int argc, char *argv[])
+{
+   OSMesaContext ctx;
+   void *buffer;
+   GLubyte *image, *ref;
+   int result;
+
+   Size = (argc > 1) ? atoi(argv[1]) : 1024;
+
+   buffer = malloc(Size * Size * 4 * sizeof(GLubyte));
+   if (!buffer) {
+      printf("Alloc image buffer failed!\n");
+      return 1;
+   }
+
+   ctx = make_context(buffer);
+
+   printf("%d x %d accumulation buffer\n", Size, Size);
+   printf("16 passes, GL_LOAD/GL_ACCUM 1/16  %8.1f Mpixels/s\n",
+          run_test(16, GL_FALSE));
+   printf("64 passes, GL_LOAD/GL_ACCUM 1/64  %8.1f Mpixels/s\n",
+          run_test(64, GL_FALSE));
+   printf("16 passes, GL_MULT + GL_ACCUM     %8.1f Mpixels/s\n",
+          run_test(16, GL_TRUE));
+
+   draw_check();
+   image = CheckColorBuffer();
+   OSMesaDestroyContext(ctx);
+
+   /* the same frame with the C code */
+   putenv("MESA_NO_ASM=1");
+   ctx = make_context(buffer);
+   draw_check();
+   ref = CheckColorBuffer();
+   OSMesaDestroyContext(ctx);
+
+   result = CheckImages("GL_ACCUM/GL_MULT/GL_RETURN", image, ref,
+                        Size, Size, 4, 0);
+
+   free(image);
+   free(ref);
+   free(buffer);
+
+   return result;
+}
@@ -0,0 +1,193 @@
+/*
+ * Blending benchmark for off-screen Mesa rendering.
+ *
+ * Draws window-sized, smooth shaded quads with each of the common
+ * blending modes and reports the blending rate, with and without every
+ * other pixel masked by polygon stippling.  At the end every mode is
+ * drawn with and without the SSE2 code and the results are compared.
+ *
+ * Usage: osblend
+ *
+ * This program is in the public domain.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "GL/osmesa.h"
+#include "oscheck.h"
+
+
+#define WIDTH 512
+#define HEIGHT 512
+#define LAYERS 16
+
+
+static const struct {
+   const char *name;
+   GLenum equation, src, dst;
+} Modes[] = {
+   { "GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA",
+     GL_FUNC_ADD, GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA },
+   { "GL_ONE, GL_ONE_MINUS_SRC_ALPHA",
+     GL_FUNC_ADD, GL_ONE, GL_ONE_MINUS_SRC_ALPHA },
+   { "GL_ONE, GL_ONE", GL_FUNC_ADD, GL_ONE, GL_ONE },
+   { "GL_DST_COLOR, GL_ZERO", GL_FUNC_ADD, GL_DST_COLOR, GL_ZERO },
+   { "GL_MIN", GL_MIN, GL_ONE, GL_ONE },
+   { "GL_MAX", GL_MAX, GL_ONE, GL_ONE },
+   { "GL_CONSTANT_COLOR, GL_ONE_MINUS_CONSTANT_COLOR",
+     GL_FUNC_ADD, GL_CONSTANT_COLOR, GL_ONE_MINUS_CONSTANT_COLOR },
+   { "GL_SRC_ALPHA_SATURATE, GL_ONE",
+     GL_FUNC_ADD, GL_SRC_ALPHA_SATURATE, GL_ONE }
+};
+
+
+static void
+draw_layers(void)
+{
+   int i;
+
+   glBegin(GL_QUADS);
+   for (i = 0; i < LAYERS; i++) {
+      GLfloat a = (GLfloat) i / LAYERS;
+      glColor4f(1.0F, a, 0.0F, 0.25F);
+      glVertex2f(-1.0F, -1.0F);
+      glColor4f(0.0F, 1.0F, a, 0.5F);
+      glVertex2f( 1.0F, -1.0F);
+      glColor4f(a, 0.0F, 1.0F, 1.0F);
+      glVertex2f( 1.0F,  1.0F);
+      glColor4f(0.5F, 0.5F, 0.5F, 0.0F);
+      glVertex2f(-1.0F,  1.0F);
+   }
+   glEnd();
+}
+
+
+static double
+run_test(GLboolean stipple)
+{
+   clock_t start, end;
+   int frames = 0;
+
+   if (stipple)
+      glEnable(GL_POLYGON_STIPPLE);
+   else
+      glDisable(GL_POLYGON_STIPPLE);
+
+   start = clock();
+   do {
+      draw_layers();
+      glFinish();
+      frames++;
+      end = clock();
+   } while (end - start < CLOCKS_PER_SEC);
+
+   /* Mpixels per second */
+   return (double) frames * LAYERS * WIDTH * HEIGHT
+      / ((double) (end - start) / CLOCKS_PER_SEC) / 1.0e6;
+}
+
+
+/**
+ * Draw the layers with each mode in a band of the window, unstippled on
+ * the left and stippled on the right.
+ */
+static void
+draw_check(void)
+{
+   const GLint n = sizeof(Modes) / sizeof(Modes[0]);
+   GLint i;
+
+   glClearColor(0.25F, 0.5F, 0.75F, 0.5F);
+   glClear(GL_COLOR_BUFFER_BIT);
+   glEnable(GL_SCISSOR_TEST);
+   for (i = 0; i < n; i++) {
+      glBlendEquation(Modes[i].equation);
+      glBlendFunc(Modes[i].src, Modes[i].dst);
+      glScissor(0, i * HEIGHT / n, WIDTH / 2, HEIGHT / n);
+      glDisable(GL_POLYGON_STIPPLE);
+      draw_layers();
+      glScissor(WIDTH / 2, i * HEIGHT / n, WIDTH / 2, HEIGHT / n);
+      glEnable(GL_POLYGON_STIPPLE);
+      draw_layers();
+   }
+   glDisable(GL_SCISSOR_TEST);
+}
+
+
+static OSMesaContext
+make_context(void *buffer)
+{
+   OSMesaContext ctx = OSMesaCreateContextExt(OSMESA_RGBA, 0, 0, 0, NULL);
+   GLubyte stipple[128];
+   int i;
+
+   if (!ctx || !OSMesaMakeCurrent(ctx, buffer, GL_UNSIGNED_BYTE,
+                                  WIDTH, HEIGHT)) {
+      printf("Creating the OSMesa context failed!\n");
+      exit(1);
+   }
+
+   /* checkerboard */
+   for (i = 0; i < 128; i++)
+      stipple[i] = (i / 4) & 1 ? 0xaa : 0x55;
+   glPolygonStipple(stipple);
+
+   glShadeModel(GL_SMOOTH);
+   glBlendColor(0.25F, 0.5F, 0.75F, 0.5F);
+   glEnable(GL_BLEND);
+   return ctx;
+}
+
+
+int
+main(int argc, char *argv[])
+{
+   OSMesaContext ctx;
+   void *buffer;
+   GLubyte *image, *ref;
+   unsigned int i;
+   int result;
+
+   buffer = malloc(WIDTH * HEIGHT * 4 * sizeof(GLubyte));
+   if (!buffer) {
+      printf("Alloc image buffer failed!\n");
+      return 1;
+   }
+
+   ctx = make_context(buffer);
+
+   printf("%d x %d, %d layers             Mpixels/s   stippled\n",
+          WIDTH, HEIGHT, LAYERS);
+
+   for (i = 0; i < sizeof(Modes) / sizeof(Modes[0]); i++) {
+      double rate, stippledRate;
+      glBlendEquation(Modes[i].equation);
+      glBlendFunc(Modes[i].src, Modes[i].dst);
+      rate = run_test(GL_FALSE);
+      stippledRate = run_test(GL_TRUE);
+      printf("%-46s %8.1f %8.1f\n", Modes[i].name, rate, stippledRate);
+   }
+
+   draw_check();
+   image = CheckColorBuffer();
+   OSMesaDestroyContext(ctx);
+
+   /* the same frame with the C code */
+   putenv("MESA_NO_ASM=1");
+   ctx = make_context(buffer);
+   draw_check();
+   ref = CheckColorBuffer();
+   OSMesaDestroyContext(ctx);
+
+   result = CheckImages("all modes", image, ref, WIDTH, HEIGHT, 4, 0);
+
+   free(image);
+   free(ref);
+   free(buffer);
+
+   (void) argc;
+   (void) argv;
+   return result;
+}
@@ -0,0 +1,113 @@
+/* oscheck.c */
+
+
+/*
+ * Output checks for the off-screen Mesa benchmarks.
+ *
+ * A benchmark renders a frame with the code it times, grabs the color or
+ * depth buffer, then renders the same frame again with that code turned
+ * off (usually by setting MESA_NO_ASM or a similar environment variable
+ * before creating a second context) and compares the two images.
+ *
+ * This program is in the public domain.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "oscheck.h"
+
+
+static void *
+copy_buffer(const void *buffer, size_t size)
+{
+   void *copy = malloc(size);
+   if (!copy) {
+      printf("Alloc check image failed!\n");
+      exit(1);
+   }
+   memcpy(copy, buffer, size);
+   return copy;
+}
+
+
+/*
+ * Return a copy of the current context's GL_RGBA, GL_UNSIGNED_BYTE color
+ * buffer, after glFinish() so that multisample buffers are resolved.
+ * Free it with free().
+ */
+GLubyte *
+CheckColorBuffer( void )
+{
+   GLint width, height, format;
+   void *buffer;
+
+   glFinish();
+   if (!OSMesaGetColorBuffer(OSMesaGetCurrentContext(),
+                             &width, &height, &format, &buffer)) {
+      printf("OSMesaGetColorBuffer failed!\n");
+      exit(1);
+   }
+   return (GLubyte *) copy_buffer(buffer, width * height * 4);
+}
+
+
+/*
+ * Return a copy of the current context's depth buffer and its bytes per
+ * value.  Free it with free().
+ */
+GLubyte *
+CheckDepthBuffer( GLint *bytesPerValue )
+{
+   GLint width, height;
+   void *buffer;
+
+   glFinish();
+   if (!OSMesaGetDepthBuffer(OSMesaGetCurrentContext(),
+                             &width, &height, bytesPerValue, &buffer)) {
+      printf("OSMesaGetDepthBuffer failed!\n");
+      exit(1);
+   }
+   return (GLubyte *) copy_buffer(buffer, width * height * *bytesPerValue);
+}
+
+
+/*
+ * Compare an image with a reference image, byte by byte, allowing
+ * differences up to tolerance.  Print a line with the image's hash or the
+ * first differing pixel.  Return 0 if they match, 1 if not.
+ */
+int
+CheckImages( const char *what, const GLubyte *image, const GLubyte *ref,
+             GLint width, GLint height, GLint bytesPerPixel,
+             GLint tolerance )
+{
+   const GLint n = width * height * bytesPerPixel;
+   GLuint hash = 2166136261u;
+   GLint i, first = -1, bad = 0;
+
+   for (i = 0; i < n; i++) {
+      if (abs(image[i] - ref[i]) > tolerance) {
+         if (first < 0)
+            first = i;
+         bad++;
+      }
+      hash = (hash ^ image[i]) * 16777619u;  /* FNV-1a */
+   }
+
+   if (first < 0) {
+      printf("check %-32s ok, hash %08x\n", what, hash);
+      return 0;
+   }
+   else {
+      const GLint pixel = first / bytesPerPixel;
+      printf("check %-32s FAILED: %d bytes differ, first at (%d, %d):",
+             what, bad, pixel % width, pixel / width);
+      for (i = 0; i < bytesPerPixel; i++)
+         printf(" %d/%d", image[pixel * bytesPerPixel + i],
+                ref[pixel * bytesPerPixel + i]);
+      printf("\n");
+      return 1;
+   }
+}
@@ -0,0 +1,21 @@
+/* oscheck.h */
+
+#ifndef OSCHECK_H
+#define OSCHECK_H
+
+
+#include "GL/osmesa.h"
+
+
+extern GLubyte *
+CheckColorBuffer( void );
+
+extern GLubyte *
+CheckDepthBuffer( GLint *bytesPerValue );
+
+extern int
+CheckImages( const char *what, const GLubyte *image, const GLubyte *ref,
+             GLint width, GLint height, GLint bytesPerPixel,
+             GLint tolerance );
+
+#endif
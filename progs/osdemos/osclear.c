@@ -0,0 +1,197 @@
+/*
+ * Clear benchmark for off-screen Mesa rendering.
+ *
+ * Mimics headless rendering of many small frames into a large buffer:
+ * each frame clears the depth and stencil buffers (and optionally the
+ * color buffer), draws a small quad and reads back the pixels it
+ * covered.  Reports frames per second.
+ *
+ * Usage: osclear [size [depthBits]]
+ *
+ * Setting the MESA_NO_LAZY_CLEAR environment variable makes the depth
+ * and stencil buffers be cleared eagerly, for comparison.  At the end
+ * a frame with scissored clears is drawn both ways and the color and
+ * depth buffers are compared.
+ *
+ * This program is in the public domain.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "GL/osmesa.h"
+#include "oscheck.h"
+
+
+#define QUAD_SIZE 64
+
+
+/**
+ * Draw a QUAD_SIZE x QUAD_SIZE quad in the lower left corner and read
+ * it back.
+ */
+static void
+draw_quad(GLint size, GLubyte *pixels)
+{
+   const GLfloat w = 2.0F * QUAD_SIZE / size;
+
+   glBegin(GL_QUADS);
+   glVertex3f(-1.0F, -1.0F, 0.0F);
+   glVertex3f(-1.0F + w, -1.0F, 0.0F);
+   glVertex3f(-1.0F + w, -1.0F + w, 0.0F);
+   glVertex3f(-1.0F, -1.0F + w, 0.0F);
+   glEnd();
+
+   glReadPixels(0, 0, QUAD_SIZE, QUAD_SIZE, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+}
+
+
+static double
+run_test(GLint size, GLbitfield clearMask, GLboolean draw)
+{
+   static GLubyte pixels[QUAD_SIZE * QUAD_SIZE * 4];
+   clock_t start, end;
+   int frames = 0;
+
+   start = clock();
+   do {
+      glClear(clearMask);
+      if (draw)
+         draw_quad(size, pixels);
+      glFinish();
+      frames++;
+      end = clock();
+   } while (end - start < CLOCKS_PER_SEC);
+
+   /* frames per second */
+   return (double) frames / ((double) (end - start) / CLOCKS_PER_SEC);
+}
+
+
+/**
+ * Clear everything, clear depth and stencil again in a scissor box which
+ * isn't aligned to anything, draw a sloped quad which increments the
+ * stencil buffer and show the stencil values with two more quads.
+ */
+static void
+draw_check(GLint size)
+{
+   glClearDepth(0.75);
+   glClearStencil(0x10);
+   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+
+   glEnable(GL_SCISSOR_TEST);
+   glScissor(size / 5 + 3, size / 7 + 1, size / 2 + 5, size / 3 + 7);
+   glClearDepth(0.25);
+   glClearStencil(0x3);
+   glClear(GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+   glDisable(GL_SCISSOR_TEST);
+   glClearDepth(1.0);
+   glClearStencil(0);
+
+   glStencilFunc(GL_ALWAYS, 0, ~0);
+   glStencilOp(GL_KEEP, GL_KEEP, GL_INCR);
+   glBegin(GL_QUADS);
+   glColor3f(1.0F, 0.0F, 0.0F);
+   glVertex3f(-1.0F, -1.0F, -1.0F);
+   glColor3f(0.0F, 1.0F, 0.0F);
+   glVertex3f(1.0F, -1.0F, 1.0F);
+   glColor3f(0.0F, 0.0F, 1.0F);
+   glVertex3f(1.0F, 1.0F, 1.0F);
+   glColor3f(1.0F, 1.0F, 1.0F);
+   glVertex3f(-1.0F, 1.0F, -1.0F);
+   glEnd();
+
+   glDisable(GL_DEPTH_TEST);
+   glEnable(GL_BLEND);
+   glBlendFunc(GL_ONE, GL_ONE);
+   glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+   glStencilFunc(GL_EQUAL, 0x11, 0xff);
+   glColor3f(0.0F, 0.0F, 0.5F);
+   glRectf(-1.0F, -1.0F, 1.0F, 1.0F);
+   glStencilFunc(GL_EQUAL, 0x4, 0xff);
+   glColor3f(0.5F, 0.0F, 0.0F);
+   glRectf(-1.0F, -1.0F, 1.0F, 1.0F);
+   glDisable(GL_BLEND);
+   glEnable(GL_DEPTH_TEST);
+}
+
+
+static OSMesaContext
+make_context(void *buffer, GLint size, GLint depthBits)
+{
+   OSMesaContext ctx = OSMesaCreateContextExt(OSMESA_RGBA, depthBits, 8,
+                                              0, NULL);
+   if (!ctx || !OSMesaMakeCurrent(ctx, buffer, GL_UNSIGNED_BYTE, size, size)) {
+      printf("Creating the OSMesa context failed!\n");
+      exit(1);
+   }
+
+   glEnable(GL_DEPTH_TEST);
+   glEnable(GL_STENCIL_TEST);
+   glStencilFunc(GL_ALWAYS, 1, ~0);
+   glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
+   return ctx;
+}
+
+
+int
+main(int argc, char *argv[])
+{
+   GLint size = (argc > 1) ? atoi(argv[1]) : 2048;
+   GLint depthBits = (argc > 2) ? atoi(argv[2]) : 24;
+   GLint stencilBits, bytesPerValue;
+   OSMesaContext ctx;
+   void *buffer;
+   GLubyte *image, *ref, *depth, *refDepth;
+   int result;
+
+   buffer = malloc(size * size * 4 * sizeof(GLubyte));
+   if (!buffer) {
+      printf("Alloc image buffer failed!\n");
+      return 1;
+   }
+
+   ctx = make_context(buffer, size, depthBits);
+
+   glGetIntegerv(GL_DEPTH_BITS, &depthBits);
+   glGetIntegerv(GL_STENCIL_BITS, &stencilBits);
+   printf("%d x %d, %d-bit depth, %d-bit stencil buffer\n",
+          size, size, depthBits, stencilBits);
+
+   printf("clear depth+stencil             %8.1f frames/s\n",
+          run_test(size, GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT,
+                   GL_FALSE));
+   printf("clear depth+stencil, draw, read %8.1f frames/s\n",
+          run_test(size, GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT,
+                   GL_TRUE));
+   printf("clear all, draw, read           %8.1f frames/s\n",
+          run_test(size, GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT |
+                   GL_STENCIL_BUFFER_BIT, GL_TRUE));
+
+   draw_check(size);
+   image = CheckColorBuffer();
+   depth = CheckDepthBuffer(&bytesPerValue);
+   OSMesaDestroyContext(ctx);
+
+   /* the same frame with eager clears */
+   putenv("MESA_NO_LAZY_CLEAR=1");
+   ctx = make_context(buffer, size, depthBits);
+   draw_check(size);
+   ref = CheckColorBuffer();
+   refDepth = CheckDepthBuffer(&bytesPerValue);
+   OSMesaDestroyContext(ctx);
+
+   result = CheckImages("color buffer", image, ref, size, size, 4, 0);
+   result |= CheckImages("depth buffer", depth, refDepth, size, size,
+                         bytesPerValue, 0);
+
+   free(image);
+   free(ref);
+   free(depth);
+   free(refDepth);
+   free(buffer);
+
+   return result;
+}
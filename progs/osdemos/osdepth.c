@@ -0,0 +1,195 @@
+/*
+ * Depth test benchmark for off-screen Mesa rendering.
+ *
+ * Draws a stack of large quads with each depth function, with and
+ * without depth writes, and reports the fill rate.  Color writes are
+ * disabled so the depth test dominates the cost of each span.  At the
+ * end every function is tested with and without the SSE2 code and the
+ * color and depth buffers are compared.
+ *
+ * Usage: osdepth [depthBits]
+ *
+ * This program is in the public domain.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "GL/osmesa.h"
+#include "oscheck.h"
+
+
+#define WIDTH 512
+#define HEIGHT 512
+#define LAYERS 64
+
+
+static const struct {
+   GLenum func;
+   const char *name;
+} Funcs[] = {
+   { GL_NEVER, "GL_NEVER" },
+   { GL_LESS, "GL_LESS" },
+   { GL_EQUAL, "GL_EQUAL" },
+   { GL_LEQUAL, "GL_LEQUAL" },
+   { GL_GREATER, "GL_GREATER" },
+   { GL_NOTEQUAL, "GL_NOTEQUAL" },
+   { GL_GEQUAL, "GL_GEQUAL" },
+   { GL_ALWAYS, "GL_ALWAYS" }
+};
+
+
+static void
+draw_layers(void)
+{
+   int i;
+
+   glBegin(GL_QUADS);
+   for (i = 0; i < LAYERS; i++) {
+      /* alternate between near-to-far and far-to-near so that roughly
+       * half the layers pass for the ordered compare funcs
+       */
+      GLfloat z = (GLfloat) (i & 1 ? i : LAYERS - i) / LAYERS * 1.8F - 0.9F;
+      glVertex3f(-1.0F, -1.0F, z);
+      glVertex3f( 1.0F, -1.0F, z);
+      glVertex3f( 1.0F,  1.0F, z);
+      glVertex3f(-1.0F,  1.0F, z);
+   }
+   glEnd();
+}
+
+
+static double
+run_test(GLenum func, GLboolean write)
+{
+   clock_t start, end;
+   int frames = 0;
+
+   glDepthFunc(func);
+   glDepthMask(write);
+
+   start = clock();
+   do {
+      glClear(GL_DEPTH_BUFFER_BIT);
+      draw_layers();
+      glFinish();
+      frames++;
+      end = clock();
+   } while (end - start < CLOCKS_PER_SEC);
+
+   /* Mpixels per second */
+   return (double) frames * LAYERS * WIDTH * HEIGHT
+      / ((double) (end - start) / CLOCKS_PER_SEC) / 1.0e6;
+}
+
+
+/**
+ * Draw a sloped, smooth shaded quad, then the white layers with each
+ * function in a band of the window.
+ */
+static void
+draw_check(void)
+{
+   const GLint n = sizeof(Funcs) / sizeof(Funcs[0]);
+   GLint i;
+
+   glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+   glDepthMask(GL_TRUE);
+   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+   glDepthFunc(GL_ALWAYS);
+   glBegin(GL_QUADS);
+   glColor3f(1.0F, 0.0F, 0.0F);
+   glVertex3f(-1.0F, -1.0F, -1.0F);
+   glColor3f(0.0F, 1.0F, 0.0F);
+   glVertex3f(1.0F, -1.0F, 1.0F);
+   glColor3f(0.0F, 0.0F, 1.0F);
+   glVertex3f(1.0F, 1.0F, 0.5F);
+   glColor3f(1.0F, 1.0F, 0.0F);
+   glVertex3f(-1.0F, 1.0F, -0.5F);
+   glEnd();
+
+   glColor3f(1.0F, 1.0F, 1.0F);
+   glEnable(GL_SCISSOR_TEST);
+   for (i = 0; i < n; i++) {
+      glScissor(0, i * HEIGHT / n, WIDTH, HEIGHT / n);
+      glDepthFunc(Funcs[i].func);
+      draw_layers();
+   }
+   glDisable(GL_SCISSOR_TEST);
+   glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+}
+
+
+static OSMesaContext
+make_context(void *buffer, GLint depthBits)
+{
+   OSMesaContext ctx = OSMesaCreateContextExt(OSMESA_RGBA, depthBits, 0,
+                                              0, NULL);
+   if (!ctx || !OSMesaMakeCurrent(ctx, buffer, GL_UNSIGNED_BYTE,
+                                  WIDTH, HEIGHT)) {
+      printf("Creating the OSMesa context failed!\n");
+      exit(1);
+   }
+
+   glEnable(GL_DEPTH_TEST);
+   glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+   return ctx;
+}
+
+
+int
+main(int argc, char *argv[])
+{
+   GLint depthBits = (argc > 1) ? atoi(argv[1]) : 16;
+   GLint bytesPerValue;
+   OSMesaContext ctx;
+   void *buffer;
+   GLubyte *image, *ref, *depth, *refDepth;
+   unsigned int i;
+   int result;
+
+   buffer = malloc(WIDTH * HEIGHT * 4 * sizeof(GLubyte));
+   if (!buffer) {
+      printf("Alloc image buffer failed!\n");
+      return 1;
+   }
+
+   ctx = make_context(buffer, depthBits);
+
+   glGetIntegerv(GL_DEPTH_BITS, &depthBits);
+   printf("%d x %d, %d-bit depth buffer, %d layers\n",
+          WIDTH, HEIGHT, depthBits, LAYERS);
+
+   for (i = 0; i < sizeof(Funcs) / sizeof(Funcs[0]); i++) {
+      printf("%-12s  write: %8.1f Mpix/s   no write: %8.1f Mpix/s\n",
+             Funcs[i].name,
+             run_test(Funcs[i].func, GL_TRUE),
+             run_test(Funcs[i].func, GL_FALSE));
+   }
+
+   draw_check();
+   image = CheckColorBuffer();
+   depth = CheckDepthBuffer(&bytesPerValue);
+   OSMesaDestroyContext(ctx);
+
+   /* the same frame with the C code */
+   putenv("MESA_NO_ASM=1");
+   ctx = make_context(buffer, depthBits);
+   draw_check();
+   ref = CheckColorBuffer();
+   refDepth = CheckDepthBuffer(&bytesPerValue);
+   OSMesaDestroyContext(ctx);
+
+   result = CheckImages("color buffer", image, ref, WIDTH, HEIGHT, 4, 0);
+   result |= CheckImages("depth buffer", depth, refDepth, WIDTH, HEIGHT,
+                         bytesPerValue, 0);
+
+   free(image);
+   free(ref);
+   free(depth);
+   free(refDepth);
+   free(buffer);
+
+   return result;
+}
@@ -0,0 +1,186 @@
+/*
+ * glDrawPixels/glCopyPixels benchmark for off-screen Mesa rendering.
+ *
+ * Draws an image the way a 2D overlay compositor would: with and without
+ * pixel zoom, with a pixel transfer scale/bias and in BGRA order, then
+ * scrolls the color buffer with overlapping glCopyPixels.  Reports the
+ * number of pixels written per second.  At the end a frame using all of
+ * these is drawn again with a no-op alpha test enabled, which disables
+ * the fast paths, and the results are compared.
+ *
+ * Usage: osdrawpix [size]
+ *
+ * This program is in the public domain.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "GL/osmesa.h"
+#include "oscheck.h"
+
+
+#ifndef GL_BGRA
+#define GL_BGRA 0x80E1
+#endif
+
+
+static GLint Size;
+static GLubyte *Image;
+
+
+/**
+ * Draw the image (or copy pixels if format is 0) for about one second.
+ * Return megapixels written per second.
+ */
+static double
+run_test(GLenum format, GLfloat zoom)
+{
+   const GLint imgSize = (GLint) (Size / zoom);
+   clock_t start, end;
+   int frames = 0;
+
+   glPixelZoom(zoom, zoom);
+   start = clock();
+   do {
+      if (format) {
+         glRasterPos2i(0, 0);
+         glDrawPixels(imgSize, imgSize, format, GL_UNSIGNED_BYTE, Image);
+      }
+      else {
+         /* scroll up by 16 rows */
+         glRasterPos2i(0, 16);
+         glCopyPixels(0, 0, imgSize, imgSize - (GLint) (16 / zoom), GL_COLOR);
+      }
+      frames++;
+      end = clock();
+   } while (end - start < CLOCKS_PER_SEC);
+   glPixelZoom(1.0F, 1.0F);
+
+   return (double) frames * Size * Size * 1.0e-6
+      / ((double) (end - start) / CLOCKS_PER_SEC);
+}
+
+
+/**
+ * Draw the image into each quarter of the window in a different way, then
+ * copy overlapping areas around.
+ */
+static void
+draw_check(void)
+{
+   const GLint half = Size / 2;
+
+   glClear(GL_COLOR_BUFFER_BIT);
+   glRasterPos2i(0, 0);
+   glDrawPixels(half, half, GL_RGBA, GL_UNSIGNED_BYTE, Image);
+   glRasterPos2i(0, half);
+   glDrawPixels(half, half, GL_BGRA, GL_UNSIGNED_BYTE, Image);
+   glPixelZoom(2.0F, 2.0F);
+   glRasterPos2i(half, 0);
+   glDrawPixels(half / 2, half / 2, GL_RGB, GL_UNSIGNED_BYTE, Image);
+
+   glPixelTransferf(GL_RED_SCALE, 0.5F);
+   glPixelTransferf(GL_ALPHA_BIAS, 0.25F);
+   glPixelZoom(3.0F, 3.0F);
+   glRasterPos2i(half, half);
+   glDrawPixels(half / 3, half / 3, GL_RGBA, GL_UNSIGNED_BYTE, Image);
+   glPixelZoom(1.0F, 1.0F);
+   glRasterPos2i(half / 2, half / 2 + 5);
+   glCopyPixels(0, 0, half, half, GL_COLOR);
+   glPixelTransferf(GL_RED_SCALE, 1.0F);
+   glPixelTransferf(GL_ALPHA_BIAS, 0.0F);
+
+   glRasterPos2i(3, 16);
+   glCopyPixels(0, 0, Size - 3, Size - 16, GL_COLOR);
+   glPixelZoom(2.0F, 2.0F);
+   glRasterPos2i(0, 0);
+   glCopyPixels(half, half, half / 2, half / 2, GL_COLOR);
+   glPixelZoom(1.0F, 1.0F);
+}
+
+
+int
+main(int argc, char *argv[])
+{
+   OSMesaContext ctx;
+   void *buffer;
+   GLubyte *image, *ref;
+   GLint i;
+   int result;
+
+   Size = (argc > 1) ? atoi(argv[1]) : 1024;
+
+   ctx = OSMesaCreateContextExt(OSMESA_RGBA, 0, 0, 0, NULL);
+   if (!ctx) {
+      printf("OSMesaCreateContext failed!\n");
+      return 1;
+   }
+
+   buffer = malloc(Size * Size * 4 * sizeof(GLubyte));
+   Image = (GLubyte *) malloc(Size * Size * 4 * sizeof(GLubyte));
+   if (!buffer || !Image) {
+      printf("Alloc image buffer failed!\n");
+      return 1;
+   }
+   for (i = 0; i < Size * Size * 4; i++)
+      Image[i] = (GLubyte) (i * 7 + (i >> 10));
+
+   if (!OSMesaMakeCurrent(ctx, buffer, GL_UNSIGNED_BYTE, Size, Size)) {
+      printf("OSMesaMakeCurrent failed!\n");
+      return 1;
+   }
+
+   glMatrixMode(GL_PROJECTION);
+   glLoadIdentity();
+   glOrtho(0, Size, 0, Size, -1, 1);
+   glMatrixMode(GL_MODELVIEW);
+   glLoadIdentity();
+
+   printf("%d x %d color buffer\n", Size, Size);
+   printf("GL_RGBA                     %8.1f Mpixels/s\n",
+          run_test(GL_RGBA, 1.0F));
+   printf("GL_RGBA, zoom 2             %8.1f Mpixels/s\n",
+          run_test(GL_RGBA, 2.0F));
+   printf("GL_RGB, zoom 4              %8.1f Mpixels/s\n",
+          run_test(GL_RGB, 4.0F));
+   printf("GL_BGRA                     %8.1f Mpixels/s\n",
+          run_test(GL_BGRA, 1.0F));
+
+   glPixelTransferf(GL_RED_SCALE, 0.5F);
+   glPixelTransferf(GL_ALPHA_BIAS, 0.25F);
+   printf("GL_RGBA, scale/bias         %8.1f Mpixels/s\n",
+          run_test(GL_RGBA, 1.0F));
+   printf("GL_RGBA, scale/bias, zoom 2 %8.1f Mpixels/s\n",
+          run_test(GL_RGBA, 2.0F));
+   printf("glCopyPixels, scale/bias    %8.1f Mpixels/s\n",
+          run_test(0, 1.0F));
+   glPixelTransferf(GL_RED_SCALE, 1.0F);
+   glPixelTransferf(GL_ALPHA_BIAS, 0.0F);
+
+   printf("glCopyPixels                %8.1f Mpixels/s\n",
+          run_test(0, 1.0F));
+   printf("glCopyPixels, zoom 2        %8.1f Mpixels/s\n",
+          run_test(0, 2.0F));
+
+   draw_check();
+   image = CheckColorBuffer();
+
+   /* the same frame through the general span code */
+   glEnable(GL_ALPHA_TEST);
+   glAlphaFunc(GL_ALWAYS, 0.0F);
+   draw_check();
+   ref = CheckColorBuffer();
+
+   result = CheckImages("draw, zoom, scale/bias, copy", image, ref,
+                        Size, Size, 4, 0);
+
+   free(image);
+   free(ref);
+   free(Image);
+   free(buffer);
+   OSMesaDestroyContext(ctx);
+
+   return result;
+}
@@ -0,0 +1,295 @@
+/*
+ * Fixed-function lighting benchmark for off-screen Mesa rendering.
+ *
+ * Draws a large array of triangles with both faces culled, so every
+ * vertex is transformed and lit but nothing is rasterized.
+ * Tests infinite and positional lights, one- and two-sided, with and
+ * without GL_COLOR_MATERIAL, for 1 to 8 lights.  Reports millions of
+ * vertices per second.  At the end the lit colors of some of the
+ * vertices are read back in feedback mode, with and without the SSE2
+ * code, and compared.
+ *
+ * Usage: oslight
+ *
+ * This program is in the public domain.
+ */
+
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include "GL/osmesa.h"
+#include "oscheck.h"
+
+
+#define NUM_VERTS (3 * 64 * 1024)
+#define CHECK_VERTS (3 * 1024)
+
+static GLfloat Verts[NUM_VERTS][3];
+static GLfloat Normals[NUM_VERTS][3];
+static GLubyte Colors[NUM_VERTS][4];
+
+
+static double
+now(void)
+{
+   struct timeval tv;
+   gettimeofday(&tv, NULL);
+   return tv.tv_sec + tv.tv_usec * 1.0e-6;
+}
+
+
+/**
+ * Points on a sphere in front of the viewer, with their normals.
+ */
+static void
+make_points(void)
+{
+   int i;
+
+   for (i = 0; i < NUM_VERTS; i++) {
+      const double a = i * 0.01;
+      const double b = i * 0.0137;
+      const float x = (float) (cos(a) * sin(b));
+      const float y = (float) (sin(a) * sin(b));
+      const float z = (float) cos(b);
+      Verts[i][0] = x;
+      Verts[i][1] = y;
+      Verts[i][2] = z - 5.0F;
+      Normals[i][0] = x;
+      Normals[i][1] = y;
+      Normals[i][2] = z;
+      Colors[i][0] = (GLubyte) (128 + 127 * x);
+      Colors[i][1] = (GLubyte) (128 + 127 * y);
+      Colors[i][2] = (GLubyte) (128 + 127 * z);
+      Colors[i][3] = 255;
+   }
+
+   glEnableClientState(GL_VERTEX_ARRAY);
+   glVertexPointer(3, GL_FLOAT, 0, Verts);
+   glEnableClientState(GL_NORMAL_ARRAY);
+   glNormalPointer(GL_FLOAT, 0, Normals);
+   glColorPointer(4, GL_UNSIGNED_BYTE, 0, Colors);
+}
+
+
+/**
+ * Enable the first n lights, positional or infinite.
+ */
+static void
+setup_lights(int n, GLboolean positional)
+{
+   int i;
+
+   for (i = 0; i < 8; i++) {
+      const GLenum light = GL_LIGHT0 + i;
+      if (i < n) {
+         GLfloat pos[4], col[4];
+         pos[0] = (float) cos(i * 0.8) * 3.0F;
+         pos[1] = (float) sin(i * 0.8) * 3.0F;
+         pos[2] = 2.0F;
+         pos[3] = positional ? 1.0F : 0.0F;
+         col[0] = 0.1F + 0.1F * (i & 1);
+         col[1] = 0.1F + 0.05F * (i & 2);
+         col[2] = 0.1F + 0.025F * (i & 4);
+         col[3] = 1.0F;
+         glEnable(light);
+         glLightfv(light, GL_POSITION, pos);
+         glLightfv(light, GL_DIFFUSE, col);
+         glLightfv(light, GL_SPECULAR, col);
+         glLightf(light, GL_LINEAR_ATTENUATION, positional ? 0.2F : 0.0F);
+      }
+      else {
+         glDisable(light);
+      }
+   }
+}
+
+
+/**
+ * Draw the vertices for about one second, return millions of vertices per
+ * second.
+ */
+static double
+run_test(void)
+{
+   double start, end;
+   double verts = 0.0;
+
+   start = now();
+   do {
+      glDrawArrays(GL_TRIANGLES, 0, NUM_VERTS);
+      glFinish();
+      verts += NUM_VERTS;
+      end = now();
+   } while (end - start < 1.0);
+
+   return verts * 1.0e-6 / (end - start);
+}
+
+
+/**
+ * Light the first CHECK_VERTS vertices with 8 lights in each of the
+ * configurations and return their colors from feedback mode, 8 *
+ * CHECK_VERTS RGBA values.
+ */
+static GLubyte *
+light_check(void)
+{
+   static const GLfloat amb[4] = { 0.2F, 0.2F, 0.2F, 1.0F };
+   static const GLfloat diff[4] = { 0.8F, 0.8F, 0.8F, 1.0F };
+   const GLint size = CHECK_VERTS / 3 * 23;  /* token, count, 3 vertices */
+   GLfloat *feedback = (GLfloat *) malloc(size * sizeof(GLfloat));
+   GLubyte *colors = (GLubyte *) calloc(8 * CHECK_VERTS, 4);
+   GLubyte *c = colors;
+   int config, i, j, n;
+
+   if (!feedback || !colors) {
+      printf("Alloc feedback buffer failed!\n");
+      exit(1);
+   }
+
+   glDisable(GL_CULL_FACE);
+   glFeedbackBuffer(size, GL_3D_COLOR, feedback);
+   for (config = 0; config < 8; config++) {
+      glLightModeli(GL_LIGHT_MODEL_TWO_SIDE, config & 1);
+      if (config & 2) {
+         glEnable(GL_COLOR_MATERIAL);
+         glEnableClientState(GL_COLOR_ARRAY);
+      }
+      else {
+         /* undo the material changes of GL_COLOR_MATERIAL */
+         glDisable(GL_COLOR_MATERIAL);
+         glDisableClientState(GL_COLOR_ARRAY);
+         glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT, amb);
+         glMaterialfv(GL_FRONT_AND_BACK, GL_DIFFUSE, diff);
+      }
+      setup_lights(8, (GLboolean) (config >> 2));
+
+      glRenderMode(GL_FEEDBACK);
+      glDrawArrays(GL_TRIANGLES, 0, CHECK_VERTS);
+      n = glRenderMode(GL_RENDER);
+
+      /* GL_POLYGON_TOKEN, count, count times x, y, z, r, g, b, a */
+      for (i = 0; i + 1 < n; i += 2 + 7 * (int) feedback[i + 1]) {
+         for (j = 0; j < (int) feedback[i + 1]; j++) {
+            const GLfloat *rgba = feedback + i + 2 + 7 * j + 3;
+            if (c < colors + 4 * 8 * CHECK_VERTS) {
+               c[0] = (GLubyte) (rgba[0] * 255.0F + 0.5F);
+               c[1] = (GLubyte) (rgba[1] * 255.0F + 0.5F);
+               c[2] = (GLubyte) (rgba[2] * 255.0F + 0.5F);
+               c[3] = (GLubyte) (rgba[3] * 255.0F + 0.5F);
+               c += 4;
+            }
+         }
+      }
+   }
+   glEnable(GL_CULL_FACE);
+
+   free(feedback);
+   return colors;
+}
+
+
+static OSMesaContext
+make_context(void *buffer)
+{
+   static const GLfloat spec[4] = { 0.8F, 0.8F, 1.0F, 1.0F };
+   OSMesaContext ctx = OSMesaCreateContextExt(OSMESA_RGBA, 16, 0, 0, NULL);
+
+   if (!ctx || !OSMesaMakeCurrent(ctx, buffer, GL_UNSIGNED_BYTE, 64, 64)) {
+      printf("Creating the OSMesa context failed!\n");
+      exit(1);
+   }
+
+   make_points();
+
+   glMatrixMode(GL_PROJECTION);
+   glFrustum(-1.0, 1.0, -1.0, 1.0, 2.0, 10.0);
+   glMatrixMode(GL_MODELVIEW);
+   glEnable(GL_CULL_FACE);
+   glCullFace(GL_FRONT_AND_BACK);
+
+   glEnable(GL_LIGHTING);
+   glMaterialfv(GL_FRONT_AND_BACK, GL_SPECULAR, spec);
+   glMaterialf(GL_FRONT_AND_BACK, GL_SHININESS, 30.0F);
+   return ctx;
+}
+
+
+int
+main(int argc, char *argv[])
+{
+   static const int lights[] = { 1, 2, 4, 8 };
+   OSMesaContext ctx;
+   void *buffer;
+   GLubyte *colors, *ref;
+   int positional, twoside, material, i, result;
+
+   (void) argc;
+   (void) argv;
+
+   buffer = malloc(64 * 64 * 4 * sizeof(GLubyte));
+   if (!buffer) {
+      printf("Alloc image buffer failed!\n");
+      return 1;
+   }
+
+   ctx = make_context(buffer);
+
+   printf("%d vertices\n", NUM_VERTS);
+   printf("%-34s", "lights:");
+   for (i = 0; i < 4; i++)
+      printf(" %8d", lights[i]);
+   printf("\n");
+
+   for (positional = 0; positional < 2; positional++) {
+      for (twoside = 0; twoside < 2; twoside++) {
+         for (material = 0; material < 2; material++) {
+            char name[64];
+
+            sprintf(name, "%s, %s%s",
+                    positional ? "positional" : "infinite",
+                    twoside ? "two-sided" : "one-sided",
+                    material ? ", color material" : "");
+            printf("%-34s", name);
+
+            glLightModeli(GL_LIGHT_MODEL_TWO_SIDE, twoside);
+            if (material) {
+               glEnable(GL_COLOR_MATERIAL);
+               glEnableClientState(GL_COLOR_ARRAY);
+            }
+            else {
+               glDisable(GL_COLOR_MATERIAL);
+               glDisableClientState(GL_COLOR_ARRAY);
+            }
+
+            for (i = 0; i < 4; i++) {
+               setup_lights(lights[i], (GLboolean) positional);
+               printf(" %8.2f", run_test());
+               fflush(stdout);
+            }
+            printf("\n");
+         }
+      }
+   }
+   printf("(Mverts/s)\n");
+
+   colors = light_check();
+   OSMesaDestroyContext(ctx);
+
+   /* the same vertices with the C code */
+   putenv("MESA_NO_ASM=1");
+   ctx = make_context(buffer);
+   ref = light_check();
+   OSMesaDestroyContext(ctx);
+
+   result = CheckImages("lit colors", colors, ref, 8 * CHECK_VERTS, 1, 4, 1);
+
+   free(colors);
+   free(ref);
+   free(buffer);
+
+   return result;
+}
@@ -0,0 +1,264 @@
+/*
+ * Line rendering benchmark for off-screen Mesa rendering.
+ *
+ * Draws the wireframe of a large triangle mesh, as a CAD program would,
+ * with glDrawElements(GL_LINES) and as GL_LINE_STRIPs.  Tests flat and
+ * smooth shading, depth testing, wide lines and stippled lines, zoomed
+ * out (sub-pixel edges) and zoomed in.  Reports millions of lines per
+ * second.  At the end each test is drawn again with a no-op alpha test
+ * enabled, which disables the batched line functions, and the results
+ * are compared.
+ *
+ * Usage: oslines [size]
+ *
+ * This program is in the public domain.
+ */
+
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include "GL/osmesa.h"
+#include "oscheck.h"
+
+
+/* Mesh vertices per side; about one million edges */
+#define GRID 578
+#define NUM_VERTS (GRID * GRID)
+#define NUM_EDGES (3 * (GRID - 1) * (GRID - 1) + 2 * (GRID - 1))
+
+static GLint Size;
+static GLfloat Verts[NUM_VERTS][3];
+static GLubyte Colors[NUM_VERTS][4];
+static GLuint Edges[NUM_EDGES][2];
+static GLuint Strips[GRID][GRID];
+
+
+static double
+now(void)
+{
+   struct timeval tv;
+   gettimeofday(&tv, NULL);
+   return tv.tv_sec + tv.tv_usec * 1.0e-6;
+}
+
+
+/**
+ * A bumpy height field and its horizontal, vertical and diagonal edges.
+ */
+static void
+make_mesh(void)
+{
+   int i, j, n = 0;
+
+   for (i = 0; i < GRID; i++) {
+      for (j = 0; j < GRID; j++) {
+         const float x = (float) j / (GRID - 1) * 2.0F - 1.0F;
+         const float y = (float) i / (GRID - 1) * 2.0F - 1.0F;
+         const int v = i * GRID + j;
+         Verts[v][0] = x;
+         Verts[v][1] = y;
+         Verts[v][2] = 0.2F * (float) (sin(x * 7.0) * cos(y * 5.0));
+         Colors[v][0] = (GLubyte) (128 + 127 * x);
+         Colors[v][1] = (GLubyte) (128 + 127 * y);
+         Colors[v][2] = 200;
+         Colors[v][3] = 255;
+         Strips[i][j] = v;
+         if (j + 1 < GRID) {
+            Edges[n][0] = v;
+            Edges[n][1] = v + 1;
+            n++;
+         }
+         if (i + 1 < GRID) {
+            Edges[n][0] = v;
+            Edges[n][1] = v + GRID;
+            n++;
+         }
+         if (i + 1 < GRID && j + 1 < GRID) {
+            Edges[n][0] = v;
+            Edges[n][1] = v + GRID + 1;
+            n++;
+         }
+      }
+   }
+
+   glEnableClientState(GL_VERTEX_ARRAY);
+   glVertexPointer(3, GL_FLOAT, 0, Verts);
+   glEnableClientState(GL_COLOR_ARRAY);
+   glColorPointer(4, GL_UNSIGNED_BYTE, 0, Colors);
+}
+
+
+static int
+draw_edges(void)
+{
+   glDrawElements(GL_LINES, 2 * NUM_EDGES, GL_UNSIGNED_INT, Edges);
+   return NUM_EDGES;
+}
+
+
+static int
+draw_strips(void)
+{
+   int i;
+   for (i = 0; i < GRID; i++)
+      glDrawElements(GL_LINE_STRIP, GRID, GL_UNSIGNED_INT, Strips[i]);
+   return GRID * (GRID - 1);
+}
+
+
+static const struct {
+   const char *name;
+   int (*draw)(void);
+   GLenum shadeModel;
+   GLfloat width;
+   GLboolean stipple, zoom;
+} Tests[] = {
+   { "lines, flat, depth tested",
+     draw_edges, GL_FLAT, 1.0F, GL_FALSE, GL_FALSE },
+   { "lines, smooth, depth tested",
+     draw_edges, GL_SMOOTH, 1.0F, GL_FALSE, GL_FALSE },
+   { "strips, smooth, depth tested",
+     draw_strips, GL_SMOOTH, 1.0F, GL_FALSE, GL_FALSE },
+   { "lines, width 2",
+     draw_edges, GL_SMOOTH, 2.0F, GL_FALSE, GL_FALSE },
+   { "strips, stippled",
+     draw_strips, GL_SMOOTH, 1.0F, GL_TRUE, GL_FALSE },
+   { "lines, smooth, zoomed in",
+     draw_edges, GL_SMOOTH, 1.0F, GL_FALSE, GL_TRUE }
+};
+
+#define NUM_TESTS (sizeof(Tests) / sizeof(Tests[0]))
+
+
+static void
+set_state(int i)
+{
+   glShadeModel(Tests[i].shadeModel);
+   glLineWidth(Tests[i].width);
+   if (Tests[i].stipple)
+      glEnable(GL_LINE_STIPPLE);
+   else
+      glDisable(GL_LINE_STIPPLE);
+
+   glLoadIdentity();
+   glRotatef(-50.0F, 1.0F, 0.0F, 0.0F);
+   glRotatef(20.0F, 0.0F, 0.0F, 1.0F);
+   if (Tests[i].zoom)
+      glScalef(8.0F, 8.0F, 1.0F);
+}
+
+
+/**
+ * Draw frames for about one second, return millions of lines per second.
+ */
+static double
+run_test(int (*draw)(void))
+{
+   double start, end;
+   double lines = 0.0;
+
+   start = now();
+   do {
+      glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+      lines += draw();
+      glFinish();
+      end = now();
+   } while (end - start < 1.0);
+
+   return lines * 1.0e-6 / (end - start);
+}
+
+
+/**
+ * Draw the frame of each test with the batched line functions and with
+ * the per-line functions, which a no-op alpha test selects, and compare.
+ */
+static int
+check_tests(void)
+{
+   unsigned int i;
+   int result = 0;
+
+   for (i = 0; i < NUM_TESTS; i++) {
+      GLubyte *image, *ref;
+
+      set_state(i);
+      if (Tests[i].shadeModel == GL_FLAT) {
+         /* OSMesa's own flat shaded line functions move endpoints on
+          * the right or top window edge inside it, keep clear of them.
+          */
+         glScalef(0.7F, 0.7F, 1.0F);
+      }
+      glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+      Tests[i].draw();
+      image = CheckColorBuffer();
+
+      glEnable(GL_ALPHA_TEST);
+      glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+      Tests[i].draw();
+      ref = CheckColorBuffer();
+      glDisable(GL_ALPHA_TEST);
+
+      result |= CheckImages(Tests[i].name, image, ref, Size, Size, 4, 0);
+      free(image);
+      free(ref);
+   }
+
+   return result;
+}
+
+
+int
+main(int argc, char *argv[])
+{
+   OSMesaContext ctx;
+   void *buffer;
+   unsigned int i;
+   int result;
+
+   Size = (argc > 1) ? atoi(argv[1]) : 512;
+
+   ctx = OSMesaCreateContextExt(OSMESA_RGBA, 16, 0, 0, NULL);
+   if (!ctx) {
+      printf("OSMesaCreateContext failed!\n");
+      return 1;
+   }
+
+   buffer = malloc(Size * Size * 4 * sizeof(GLubyte));
+   if (!buffer) {
+      printf("Alloc image buffer failed!\n");
+      return 1;
+   }
+
+   if (!OSMesaMakeCurrent(ctx, buffer, GL_UNSIGNED_BYTE, Size, Size)) {
+      printf("OSMesaMakeCurrent failed!\n");
+      return 1;
+   }
+
+   make_mesh();
+
+   printf("%d x %d, %d vertex mesh, %d edges\n", Size, Size,
+          NUM_VERTS, NUM_EDGES);
+
+   glMatrixMode(GL_PROJECTION);
+   glOrtho(-1.0, 1.0, -1.0, 1.0, -2.0, 2.0);
+   glMatrixMode(GL_MODELVIEW);
+   glEnable(GL_DEPTH_TEST);
+   glLineStipple(1, 0x0f0f);
+   glAlphaFunc(GL_ALWAYS, 0.0F);
+
+   for (i = 0; i < NUM_TESTS; i++) {
+      set_state(i);
+      printf("%-32s %8.2f Mlines/s\n", Tests[i].name,
+             run_test(Tests[i].draw));
+   }
+
+   result = check_tests();
+
+   free(buffer);
+   OSMesaDestroyContext(ctx);
+
+   return result;
+}
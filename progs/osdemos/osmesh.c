@@ -0,0 +1,300 @@
+/*
+ * Vertex pipeline benchmark for off-screen Mesa rendering.
+ *
+ * Draws a large lit triangle mesh with glDrawElements, as GL_TRIANGLES
+ * and as GL_TRIANGLE_STRIPs.  The mesh is drawn small so that vertex
+ * transformation, lighting and clipping dominate the frame time.  Tests
+ * unlit, one light and three lights with two-sided lighting.  Reports
+ * millions of triangles and vertices per second.  At the end each test
+ * is drawn once more, and again with glBegin/glArrayElement/glEnd and
+ * without the SSE code, and the images are compared.
+ *
+ * Usage: osmesh [size]
+ *
+ * This program is in the public domain.
+ */
+
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include "GL/osmesa.h"
+#include "oscheck.h"
+
+
+/* Mesh vertices per side; about one million vertices */
+#define GRID 1024
+#define NUM_VERTS (GRID * GRID)
+#define NUM_TRIS (2 * (GRID - 1) * (GRID - 1))
+
+static GLint Size;
+static GLfloat Verts[NUM_VERTS][3];
+static GLfloat Normals[NUM_VERTS][3];
+static GLubyte Colors[NUM_VERTS][4];
+static GLuint Tris[NUM_TRIS][3];
+static GLuint Strips[GRID - 1][2 * GRID];
+
+
+static double
+now(void)
+{
+   struct timeval tv;
+   gettimeofday(&tv, NULL);
+   return tv.tv_sec + tv.tv_usec * 1.0e-6;
+}
+
+
+/**
+ * A bumpy height field, as triangles and as one strip per row.
+ */
+static void
+make_mesh(void)
+{
+   int i, j, n = 0;
+
+   for (i = 0; i < GRID; i++) {
+      for (j = 0; j < GRID; j++) {
+         const float x = (float) j / (GRID - 1) * 2.0F - 1.0F;
+         const float y = (float) i / (GRID - 1) * 2.0F - 1.0F;
+         const float dx = (float) (0.2 * 7.0 * cos(x * 7.0) * cos(y * 5.0));
+         const float dy = (float) (-0.2 * 5.0 * sin(x * 7.0) * sin(y * 5.0));
+         const int v = i * GRID + j;
+         Verts[v][0] = x;
+         Verts[v][1] = y;
+         Verts[v][2] = 0.2F * (float) (sin(x * 7.0) * cos(y * 5.0));
+         Normals[v][0] = -dx;
+         Normals[v][1] = -dy;
+         Normals[v][2] = 1.0F;
+         Colors[v][0] = (GLubyte) (128 + 127 * x);
+         Colors[v][1] = (GLubyte) (128 + 127 * y);
+         Colors[v][2] = 200;
+         Colors[v][3] = 255;
+         if (i + 1 < GRID) {
+            Strips[i][2 * j] = v + GRID;
+            Strips[i][2 * j + 1] = v;
+         }
+         if (i + 1 < GRID && j + 1 < GRID) {
+            Tris[n][0] = v;
+            Tris[n][1] = v + 1;
+            Tris[n][2] = v + GRID;
+            n++;
+            Tris[n][0] = v + 1;
+            Tris[n][1] = v + GRID + 1;
+            Tris[n][2] = v + GRID;
+            n++;
+         }
+      }
+   }
+}
+
+
+static int
+draw_tris(void)
+{
+   glDrawElements(GL_TRIANGLES, 3 * NUM_TRIS, GL_UNSIGNED_INT, Tris);
+   return NUM_TRIS;
+}
+
+
+static int
+draw_strips(void)
+{
+   int i;
+   for (i = 0; i < GRID - 1; i++)
+      glDrawElements(GL_TRIANGLE_STRIP, 2 * GRID, GL_UNSIGNED_INT, Strips[i]);
+   return NUM_TRIS;
+}
+
+
+/**
+ * Draw frames for about one second, return millions of triangles per
+ * second.
+ */
+static double
+run_test(int (*draw)(void))
+{
+   double start, end;
+   double tris = 0.0;
+
+   start = now();
+   do {
+      glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+      tris += draw();
+      glFinish();
+      end = now();
+   } while (end - start < 1.0);
+
+   return tris * 1.0e-6 / (end - start);
+}
+
+
+/* The glArrayElement versions, for checking */
+static int
+draw_tris_immediate(void)
+{
+   int i;
+   glBegin(GL_TRIANGLES);
+   for (i = 0; i < NUM_TRIS; i++) {
+      glArrayElement(Tris[i][0]);
+      glArrayElement(Tris[i][1]);
+      glArrayElement(Tris[i][2]);
+   }
+   glEnd();
+   return NUM_TRIS;
+}
+
+
+static int
+draw_strips_immediate(void)
+{
+   int i, j;
+   for (i = 0; i < GRID - 1; i++) {
+      glBegin(GL_TRIANGLE_STRIP);
+      for (j = 0; j < 2 * GRID; j++)
+         glArrayElement(Strips[i][j]);
+      glEnd();
+   }
+   return NUM_TRIS;
+}
+
+
+static const struct {
+   const char *name;
+   int (*draw)(void);
+   int (*drawImmediate)(void);
+   int lights;
+} Tests[] = {
+   { "triangles, unlit", draw_tris, draw_tris_immediate, 0 },
+   { "strips, unlit", draw_strips, draw_strips_immediate, 0 },
+   { "triangles, 1 light", draw_tris, draw_tris_immediate, 1 },
+   { "strips, 1 light", draw_strips, draw_strips_immediate, 1 },
+   { "triangles, 3 lights, two-sided", draw_tris, draw_tris_immediate, 3 }
+};
+
+#define NUM_TESTS (sizeof(Tests) / sizeof(Tests[0]))
+
+
+static void
+set_lights(int lights)
+{
+   if (lights > 0) {
+      glEnable(GL_LIGHTING);
+      glEnable(GL_COLOR_MATERIAL);
+   }
+   else {
+      glDisable(GL_LIGHTING);
+      glDisable(GL_COLOR_MATERIAL);
+   }
+   if (lights > 1) {
+      glEnable(GL_LIGHT1);
+      glEnable(GL_LIGHT2);
+   }
+   else {
+      glDisable(GL_LIGHT1);
+      glDisable(GL_LIGHT2);
+   }
+   glLightModeli(GL_LIGHT_MODEL_TWO_SIDE, lights > 1);
+}
+
+
+static OSMesaContext
+make_context(void *buffer)
+{
+   static const GLfloat pos0[4] = { 0.3F, 0.5F, 1.0F, 0.0F };
+   static const GLfloat pos1[4] = { -0.5F, 0.2F, 0.8F, 1.0F };
+   static const GLfloat pos2[4] = { 0.5F, -0.5F, 0.5F, 1.0F };
+   static const GLfloat spec[4] = { 0.8F, 0.8F, 1.0F, 1.0F };
+   OSMesaContext ctx = OSMesaCreateContextExt(OSMESA_RGBA, 16, 0, 0, NULL);
+
+   if (!ctx || !OSMesaMakeCurrent(ctx, buffer, GL_UNSIGNED_BYTE, Size, Size)) {
+      printf("Creating the OSMesa context failed!\n");
+      exit(1);
+   }
+
+   glEnableClientState(GL_VERTEX_ARRAY);
+   glVertexPointer(3, GL_FLOAT, 0, Verts);
+   glEnableClientState(GL_NORMAL_ARRAY);
+   glNormalPointer(GL_FLOAT, 0, Normals);
+   glEnableClientState(GL_COLOR_ARRAY);
+   glColorPointer(4, GL_UNSIGNED_BYTE, 0, Colors);
+
+   glMatrixMode(GL_PROJECTION);
+   glFrustum(-1.0, 1.0, -1.0, 1.0, 2.0, 10.0);
+   glMatrixMode(GL_MODELVIEW);
+   glTranslatef(0.0F, 0.0F, -4.0F);
+   glRotatef(-50.0F, 1.0F, 0.0F, 0.0F);
+   glRotatef(20.0F, 0.0F, 0.0F, 1.0F);
+   glEnable(GL_DEPTH_TEST);
+
+   glEnable(GL_NORMALIZE);
+   glEnable(GL_LIGHT0);
+   glLightfv(GL_LIGHT0, GL_POSITION, pos0);
+   glLightfv(GL_LIGHT1, GL_POSITION, pos1);
+   glLightf(GL_LIGHT1, GL_LINEAR_ATTENUATION, 0.5F);
+   glLightfv(GL_LIGHT2, GL_POSITION, pos2);
+   glLightfv(GL_LIGHT2, GL_SPECULAR, spec);
+   glMaterialfv(GL_FRONT_AND_BACK, GL_SPECULAR, spec);
+   glMaterialf(GL_FRONT_AND_BACK, GL_SHININESS, 30.0F);
+   return ctx;
+}
+
+
+int
+main(int argc, char *argv[])
+{
+   OSMesaContext ctx;
+   void *buffer;
+   GLubyte *images[NUM_TESTS];
+   unsigned int i;
+   int result = 0;
+
+   Size = (argc > 1) ? atoi(argv[1]) : 256;
+
+   buffer = malloc(Size * Size * 4 * sizeof(GLubyte));
+   if (!buffer) {
+      printf("Alloc image buffer failed!\n");
+      return 1;
+   }
+
+   make_mesh();
+   ctx = make_context(buffer);
+
+   printf("%d x %d, %d vertex mesh, %d triangles\n", Size, Size,
+          NUM_VERTS, NUM_TRIS);
+
+   for (i = 0; i < NUM_TESTS; i++) {
+      double mtris;
+      set_lights(Tests[i].lights);
+      mtris = run_test(Tests[i].draw);
+      printf("%-32s %8.2f Mtris/s %8.2f Mverts/s\n", Tests[i].name, mtris,
+             mtris * NUM_VERTS / NUM_TRIS);
+   }
+
+   for (i = 0; i < NUM_TESTS; i++) {
+      set_lights(Tests[i].lights);
+      glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+      Tests[i].draw();
+      images[i] = CheckColorBuffer();
+   }
+   OSMesaDestroyContext(ctx);
+
+   /* the same frames in immediate mode with the C code */
+   putenv("MESA_NO_ASM=1");
+   ctx = make_context(buffer);
+   for (i = 0; i < NUM_TESTS; i++) {
+      GLubyte *ref;
+      set_lights(Tests[i].lights);
+      glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+      Tests[i].drawImmediate();
+      ref = CheckColorBuffer();
+      result |= CheckImages(Tests[i].name, images[i], ref, Size, Size, 4, 1);
+      free(images[i]);
+      free(ref);
+   }
+   OSMesaDestroyContext(ctx);
+
+   free(buffer);
+
+   return result;
+}
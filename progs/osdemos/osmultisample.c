@@ -0,0 +1,262 @@
+/*
+ * Multisample antialiasing benchmark for off-screen Mesa rendering.
+ *
+ * Draws the same scene of depth tested triangles antialiased two ways:
+ * with a 4x or 8x multisample context (OSMesaCreateContextMultisample),
+ * and by accumulating 4 or 8 jittered passes in the accumulation buffer.
+ * Reports frames per second of each, with and without trilinear
+ * texturing.  The multisample contexts texture each fragment once, the
+ * accumulation buffer method once per pass.  At the end one frame of
+ * each test is drawn again without the SSE code and the images are
+ * compared.
+ *
+ * Usage: osmultisample [size]
+ *
+ * This program is in the public domain.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <sys/time.h>
+#include "GL/osmesa.h"
+#include "GL/glext.h"
+#include "oscheck.h"
+
+
+static GLint Size;
+
+
+/* The 4x and 8x jitter patterns, in pixels from the pixel center */
+static const GLfloat Jitter4[4][2] = {
+   { -0.125F, -0.375F }, { 0.375F, -0.125F },
+   { -0.375F, 0.125F }, { 0.125F, 0.375F }
+};
+static const GLfloat Jitter8[8][2] = {
+   { 0.0625F, -0.1875F }, { -0.0625F, 0.1875F },
+   { 0.3125F, 0.0625F }, { -0.1875F, -0.3125F },
+   { -0.3125F, 0.3125F }, { -0.4375F, -0.0625F },
+   { 0.1875F, 0.4375F }, { 0.4375F, -0.4375F }
+};
+
+
+static double
+now(void)
+{
+   struct timeval tv;
+   gettimeofday(&tv, NULL);
+   return tv.tv_sec + tv.tv_usec * 1.0e-6;
+}
+
+
+/**
+ * A few hundred overlapping smooth shaded triangles, moved by
+ * (dx, dy) pixels.
+ */
+static void
+draw_scene(GLfloat dx, GLfloat dy)
+{
+   int i;
+
+   glMatrixMode(GL_PROJECTION);
+   glLoadIdentity();
+   glTranslatef(dx * 2.0F / Size, dy * 2.0F / Size, 0.0F);
+   glMatrixMode(GL_MODELVIEW);
+
+   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+   glBegin(GL_TRIANGLES);
+   for (i = 0; i < 300; i++) {
+      const double a = i * 0.37, r = 0.2 + 0.7 * (i % 17) / 17.0;
+      const GLfloat x = (GLfloat) (r * cos(a)), y = (GLfloat) (r * sin(a));
+      const GLfloat z = (GLfloat) ((i % 23) / 23.0 - 0.5);
+      glColor3f(0.5F + 0.5F * (GLfloat) cos(a), 0.5F, 0.5F + 0.5F * (GLfloat) sin(a));
+      glTexCoord2f(0.0F, 0.0F);
+      glVertex3f(x, y, z);
+      glColor3f(1.0F, 1.0F, 1.0F);
+      glTexCoord2f(4.0F, 0.0F);
+      glVertex3f(x + 0.3F * (GLfloat) cos(a + 1.0), y + 0.25F * (GLfloat) sin(a + 1.0), -z);
+      glColor3f(0.2F, 0.2F, 0.8F);
+      glTexCoord2f(0.0F, 4.0F);
+      glVertex3f(x + 0.2F * (GLfloat) cos(a + 2.5), y + 0.3F * (GLfloat) sin(a + 2.5), z);
+   }
+   glEnd();
+}
+
+
+/**
+ * Draw one frame.  passes > 0 antialiases with the accumulation buffer.
+ */
+static void
+draw_frame(int passes)
+{
+   if (passes > 0) {
+      const GLfloat (*jitter)[2] = (passes == 8) ? Jitter8 : Jitter4;
+      int p;
+      for (p = 0; p < passes; p++) {
+         draw_scene(jitter[p][0], jitter[p][1]);
+         glAccum(p ? GL_ACCUM : GL_LOAD, 1.0F / passes);
+      }
+      glAccum(GL_RETURN, 1.0F);
+   }
+   else {
+      draw_scene(0.0F, 0.0F);
+   }
+}
+
+
+/**
+ * Draw frames for about one second, return frames per second.
+ */
+static double
+run_test(int passes)
+{
+   double start, end;
+   int frames = 0;
+
+   start = now();
+   do {
+      draw_frame(passes);
+      glFinish();
+      frames++;
+      end = now();
+   } while (end - start < 1.0);
+
+   return frames / (end - start);
+}
+
+
+/**
+ * Make a mipmapped 64x64 checkerboard texture.
+ */
+static void
+make_texture(void)
+{
+   static GLubyte image[64 * 64 * 4];
+   GLint size, level, i, j;
+
+   for (level = 0, size = 64; size > 0; level++, size /= 2) {
+      for (i = 0; i < size; i++) {
+         for (j = 0; j < size; j++) {
+            const GLubyte c = (((i * 8 / size) ^ (j * 8 / size)) & 1) ? 255 : 96;
+            GLubyte *p = image + (i * size + j) * 4;
+            p[0] = c;
+            p[1] = c;
+            p[2] = 255 - c / 2;
+            p[3] = 255;
+         }
+      }
+      glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA, size, size, 0,
+                   GL_RGBA, GL_UNSIGNED_BYTE, image);
+   }
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                   GL_LINEAR_MIPMAP_LINEAR);
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+   glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+}
+
+
+static OSMesaContext
+make_context(GLint samples, GLint accumBits, void *buffer)
+{
+   OSMesaContext ctx = OSMesaCreateContextMultisample(OSMESA_RGBA, 24, 0,
+                                                      accumBits, samples,
+                                                      NULL);
+   if (!ctx || !OSMesaMakeCurrent(ctx, buffer, GL_UNSIGNED_BYTE, Size, Size)) {
+      printf("Creating the OSMesa context failed!\n");
+      exit(1);
+   }
+   glEnable(GL_DEPTH_TEST);
+   glClearColor(0.0F, 0.0F, 0.0F, 0.0F);
+   make_texture();
+   return ctx;
+}
+
+
+static const struct {
+   const char *name;
+   GLint samples, accumBits, passes;
+} Tests[] = {
+   { "aliased", 0, 16, 0 },
+   { "4 pass accum jitter", 0, 16, 4 },
+   { "8 pass accum jitter", 0, 16, 8 },
+   { "4x multisample", 4, 0, 0 },
+   { "8x multisample", 8, 0, 0 }
+};
+
+#define NUM_TESTS (sizeof(Tests) / sizeof(Tests[0]))
+
+
+static void
+set_texture(int tex)
+{
+   if (tex)
+      glEnable(GL_TEXTURE_2D);
+   else
+      glDisable(GL_TEXTURE_2D);
+}
+
+
+int
+main(int argc, char *argv[])
+{
+   OSMesaContext ctx;
+   void *buffer;
+   GLubyte *images[NUM_TESTS][2];
+   unsigned int i;
+   int tex, result = 0;
+
+   Size = (argc > 1) ? atoi(argv[1]) : 512;
+
+   buffer = malloc(Size * Size * 4 * sizeof(GLubyte));
+   if (!buffer) {
+      printf("Alloc image buffer failed!\n");
+      return 1;
+   }
+
+   printf("%d x %d, 300 triangles, frames/s   untextured    textured\n",
+          Size, Size);
+
+   for (i = 0; i < NUM_TESTS; i++) {
+      double rate[2];
+      ctx = make_context(Tests[i].samples, Tests[i].accumBits, buffer);
+      if (Tests[i].samples)
+         glEnable(GL_MULTISAMPLE_ARB);
+      for (tex = 0; tex < 2; tex++) {
+         set_texture(tex);
+         rate[tex] = run_test(Tests[i].passes);
+      }
+      printf("%-30s %12.1f %11.1f\n", Tests[i].name, rate[0], rate[1]);
+
+      for (tex = 0; tex < 2; tex++) {
+         set_texture(tex);
+         draw_frame(Tests[i].passes);
+         images[i][tex] = CheckColorBuffer();
+      }
+      OSMesaDestroyContext(ctx);
+   }
+
+   /* the same frames with the C code */
+   putenv("MESA_NO_ASM=1");
+   for (i = 0; i < NUM_TESTS; i++) {
+      ctx = make_context(Tests[i].samples, Tests[i].accumBits, buffer);
+      if (Tests[i].samples)
+         glEnable(GL_MULTISAMPLE_ARB);
+      for (tex = 0; tex < 2; tex++) {
+         char name[100];
+         GLubyte *ref;
+         set_texture(tex);
+         draw_frame(Tests[i].passes);
+         ref = CheckColorBuffer();
+         sprintf(name, "%s%s", Tests[i].name, tex ? ", textured" : "");
+         result |= CheckImages(name, images[i][tex], ref, Size, Size, 4, 0);
+         free(images[i][tex]);
+         free(ref);
+      }
+      OSMesaDestroyContext(ctx);
+   }
+
+   free(buffer);
+
+   return result;
+}
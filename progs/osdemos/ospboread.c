@@ -0,0 +1,249 @@
+/*
+ * Pixel buffer object readback benchmark for off-screen Mesa rendering.
+ *
+ * Mimics capturing rendered frames for video encoding: each frame is
+ * rendered, read back with glReadPixels into one of two pixel buffer
+ * objects, and the previous frame's buffer object is mapped and
+ * inspected.  With asynchronous readback the pixels of frame N are
+ * packed while frame N+1 is being rendered.  Reports frames per second
+ * for reading into client memory and into the buffer objects.  At the
+ * end a frame is read into a buffer object while the next one renders,
+ * and compared with the same frame read synchronously into client
+ * memory without the SSE code.
+ *
+ * Usage: ospboread [size [triangles]]
+ *
+ * Setting the MESA_NO_ASYNC_READPIXELS environment variable makes
+ * reads into buffer objects synchronous, for comparison.
+ *
+ * This program is in the public domain.
+ */
+
+
+#define GL_GLEXT_PROTOTYPES
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include "GL/osmesa.h"
+#include "GL/glext.h"
+#include "oscheck.h"
+
+
+static GLuint checksum;
+
+
+/**
+ * Wall clock time in seconds; clock() would count the CPU time of the
+ * packing thread too.
+ */
+static double
+now(void)
+{
+   struct timeval tv;
+   gettimeofday(&tv, NULL);
+   return tv.tv_sec + tv.tv_usec * 1.0e-6;
+}
+
+
+/**
+ * Draw a bunch of smooth-shaded, depth-tested triangles.
+ */
+static void
+render_frame(GLint frame, GLint triangles)
+{
+   GLint i;
+
+   srand(frame);
+   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+   glBegin(GL_TRIANGLES);
+   for (i = 0; i < 3 * triangles; i++) {
+      glColor3ub(rand() & 255, rand() & 255, rand() & 255);
+      glVertex3f((rand() % 2001 - 1000) * 0.001F,
+                 (rand() % 2001 - 1000) * 0.001F,
+                 (rand() % 2001 - 1000) * 0.001F);
+   }
+   glEnd();
+}
+
+
+/**
+ * Look at the pixels like an encoder would, a little.
+ */
+static void
+consume_pixels(const GLubyte *pixels, GLint size, GLenum format)
+{
+   const GLint bpp = (format == GL_RGB) ? 3 : 4;
+   GLint i;
+
+   for (i = 0; i < size * size * bpp; i += 4093)
+      checksum += pixels[i];
+}
+
+
+static double
+run_test(GLint size, GLint triangles, GLenum format, GLboolean usePBO)
+{
+   const GLint bpp = (format == GL_RGB) ? 3 : 4;
+   GLubyte *pixels = NULL;
+   GLuint pbo[2];
+   double start, end;
+   int frames = 0;
+
+   if (usePBO) {
+      glGenBuffersARB(2, pbo);
+      glBindBufferARB(GL_PIXEL_PACK_BUFFER_EXT, pbo[0]);
+      glBufferDataARB(GL_PIXEL_PACK_BUFFER_EXT, size * size * bpp, NULL,
+                      GL_STREAM_READ_ARB);
+      glBindBufferARB(GL_PIXEL_PACK_BUFFER_EXT, pbo[1]);
+      glBufferDataARB(GL_PIXEL_PACK_BUFFER_EXT, size * size * bpp, NULL,
+                      GL_STREAM_READ_ARB);
+   }
+   else {
+      pixels = (GLubyte *) malloc(size * size * bpp);
+   }
+
+   start = now();
+   do {
+      render_frame(frames, triangles);
+      if (usePBO) {
+         /* start reading this frame, then look at the previous one */
+         glBindBufferARB(GL_PIXEL_PACK_BUFFER_EXT, pbo[frames & 1]);
+         glReadPixels(0, 0, size, size, format, GL_UNSIGNED_BYTE, NULL);
+         if (frames > 0) {
+            const GLubyte *p;
+            glBindBufferARB(GL_PIXEL_PACK_BUFFER_EXT, pbo[(frames - 1) & 1]);
+            p = (const GLubyte *) glMapBufferARB(GL_PIXEL_PACK_BUFFER_EXT,
+                                                 GL_READ_ONLY_ARB);
+            consume_pixels(p, size, format);
+            glUnmapBufferARB(GL_PIXEL_PACK_BUFFER_EXT);
+         }
+      }
+      else {
+         glReadPixels(0, 0, size, size, format, GL_UNSIGNED_BYTE, pixels);
+         consume_pixels(pixels, size, format);
+      }
+      frames++;
+      end = now();
+   } while (end - start < 2.0);
+
+   if (usePBO) {
+      glBindBufferARB(GL_PIXEL_PACK_BUFFER_EXT, 0);
+      glDeleteBuffersARB(2, pbo);
+   }
+   else {
+      free(pixels);
+   }
+
+   /* frames per second */
+   return frames / (end - start);
+}
+
+
+/**
+ * Read frame 0 into a buffer object and render frame 1 before mapping
+ * it, or read frame 0 into client memory.  Return a copy of the pixels.
+ */
+static GLubyte *
+read_check(GLint size, GLint triangles, GLenum format, GLboolean usePBO)
+{
+   const GLint bpp = (format == GL_RGB) ? 3 : 4;
+   GLubyte *pixels = (GLubyte *) malloc(size * size * bpp);
+   GLuint pbo;
+
+   if (!pixels) {
+      printf("Alloc check image failed!\n");
+      exit(1);
+   }
+
+   render_frame(0, triangles);
+   if (usePBO) {
+      const GLubyte *p;
+      glGenBuffersARB(1, &pbo);
+      glBindBufferARB(GL_PIXEL_PACK_BUFFER_EXT, pbo);
+      glBufferDataARB(GL_PIXEL_PACK_BUFFER_EXT, size * size * bpp, NULL,
+                      GL_STREAM_READ_ARB);
+      glReadPixels(0, 0, size, size, format, GL_UNSIGNED_BYTE, NULL);
+      render_frame(1, triangles);
+      p = (const GLubyte *) glMapBufferARB(GL_PIXEL_PACK_BUFFER_EXT,
+                                           GL_READ_ONLY_ARB);
+      memcpy(pixels, p, size * size * bpp);
+      glUnmapBufferARB(GL_PIXEL_PACK_BUFFER_EXT);
+      glBindBufferARB(GL_PIXEL_PACK_BUFFER_EXT, 0);
+      glDeleteBuffersARB(1, &pbo);
+   }
+   else {
+      glReadPixels(0, 0, size, size, format, GL_UNSIGNED_BYTE, pixels);
+   }
+   return pixels;
+}
+
+
+static OSMesaContext
+make_context(void *buffer, GLint size)
+{
+   OSMesaContext ctx = OSMesaCreateContextExt(OSMESA_RGBA, 16, 0, 0, NULL);
+
+   if (!ctx || !OSMesaMakeCurrent(ctx, buffer, GL_UNSIGNED_BYTE, size, size)) {
+      printf("Creating the OSMesa context failed!\n");
+      exit(1);
+   }
+
+   glEnable(GL_DEPTH_TEST);
+   glShadeModel(GL_SMOOTH);
+   glPixelStorei(GL_PACK_ALIGNMENT, 1);
+   return ctx;
+}
+
+
+int
+main(int argc, char *argv[])
+{
+   GLint size = (argc > 1) ? atoi(argv[1]) : 1024;
+   GLint triangles = (argc > 2) ? atoi(argv[2]) : 20;
+   OSMesaContext ctx;
+   void *buffer;
+   GLubyte *bgra, *rgb, *ref;
+   int result;
+
+   buffer = malloc(size * size * 4 * sizeof(GLubyte));
+   if (!buffer) {
+      printf("Alloc image buffer failed!\n");
+      return 1;
+   }
+
+   ctx = make_context(buffer, size);
+
+   printf("%d x %d, %d triangles per frame\n", size, size, triangles);
+   printf("GL_BGRA into client memory   %8.1f frames/s\n",
+          run_test(size, triangles, GL_BGRA, GL_FALSE));
+   printf("GL_BGRA into buffer objects  %8.1f frames/s\n",
+          run_test(size, triangles, GL_BGRA, GL_TRUE));
+   printf("GL_RGB into client memory    %8.1f frames/s\n",
+          run_test(size, triangles, GL_RGB, GL_FALSE));
+   printf("GL_RGB into buffer objects   %8.1f frames/s\n",
+          run_test(size, triangles, GL_RGB, GL_TRUE));
+   printf("(checksum %u)\n", checksum);
+
+   bgra = read_check(size, triangles, GL_BGRA, GL_TRUE);
+   rgb = read_check(size, triangles, GL_RGB, GL_TRUE);
+   OSMesaDestroyContext(ctx);
+
+   /* the same frame read synchronously with the C code */
+   putenv("MESA_NO_ASYNC_READPIXELS=1");
+   putenv("MESA_NO_ASM=1");
+   ctx = make_context(buffer, size);
+   ref = read_check(size, triangles, GL_BGRA, GL_FALSE);
+   result = CheckImages("GL_BGRA buffer object", bgra, ref, size, size, 4, 0);
+   free(ref);
+   ref = read_check(size, triangles, GL_RGB, GL_FALSE);
+   result |= CheckImages("GL_RGB buffer object", rgb, ref, size, size, 3, 0);
+   free(ref);
+   OSMesaDestroyContext(ctx);
+
+   free(bgra);
+   free(rgb);
+   free(buffer);
+
+   return result;
+}
@@ -0,0 +1,233 @@
+/*
+ * Point rendering benchmark for off-screen Mesa rendering.
+ *
+ * Draws a particle system of random points from a vertex array with
+ * glDrawArrays, as single pixels, wide points, additively blended
+ * points, textured point sprites and distance attenuated points.
+ * Reports millions of points per second.  At the end the first points
+ * of each test are drawn again with one glDrawArrays call per point and
+ * the results are compared.
+ *
+ * Usage: ospoints [size]
+ *
+ * This program is in the public domain.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#define GL_GLEXT_PROTOTYPES
+#include "GL/osmesa.h"
+#include "GL/glext.h"
+#include "oscheck.h"
+
+
+#define NUM_POINTS 100000
+#define CHECK_POINTS 10000
+
+static GLint Size;
+static GLfloat Verts[NUM_POINTS][3];
+static GLubyte Colors[NUM_POINTS][4];
+
+
+static double
+now(void)
+{
+   struct timeval tv;
+   gettimeofday(&tv, NULL);
+   return tv.tv_sec + tv.tv_usec * 1.0e-6;
+}
+
+
+static void
+make_particles(void)
+{
+   int i;
+
+   for (i = 0; i < NUM_POINTS; i++) {
+      Verts[i][0] = (GLfloat) (rand() % 20000) / 10000.0F - 1.0F;
+      Verts[i][1] = (GLfloat) (rand() % 20000) / 10000.0F - 1.0F;
+      Verts[i][2] = (GLfloat) (rand() % 20000) / 10000.0F - 1.0F;
+      Colors[i][0] = 64 + rand() % 192;
+      Colors[i][1] = 64 + rand() % 192;
+      Colors[i][2] = 64 + rand() % 192;
+      Colors[i][3] = 255;
+   }
+
+   glEnableClientState(GL_VERTEX_ARRAY);
+   glVertexPointer(3, GL_FLOAT, 0, Verts);
+   glEnableClientState(GL_COLOR_ARRAY);
+   glColorPointer(4, GL_UNSIGNED_BYTE, 0, Colors);
+}
+
+
+/**
+ * A small round sprite texture, bright in the middle.
+ */
+static void
+make_texture(void)
+{
+   static GLubyte image[16][16][4];
+   int i, j;
+
+   for (i = 0; i < 16; i++) {
+      for (j = 0; j < 16; j++) {
+         const int dx = 2 * j - 15, dy = 2 * i - 15;
+         const int d2 = dx * dx + dy * dy;
+         const GLubyte c = (d2 < 225) ? 255 - d2 : 0;
+         image[i][j][0] = image[i][j][1] = image[i][j][2] = c;
+         image[i][j][3] = 255;
+      }
+   }
+   glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 16, 16, 0,
+                GL_RGBA, GL_UNSIGNED_BYTE, image);
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+   glTexEnvi(GL_POINT_SPRITE_ARB, GL_COORD_REPLACE_ARB, GL_TRUE);
+}
+
+
+/**
+ * Draw frames for about one second, return millions of points per second.
+ */
+static double
+run_test(void)
+{
+   double start, end;
+   int frames = 0;
+
+   start = now();
+   do {
+      glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+      glDrawArrays(GL_POINTS, 0, NUM_POINTS);
+      glFinish();
+      frames++;
+      end = now();
+   } while (end - start < 1.0);
+
+   return (double) frames * NUM_POINTS * 1.0e-6 / (end - start);
+}
+
+
+static const struct {
+   const char *name;
+   GLfloat size;
+   GLboolean blend, sprite, attenuate;
+} Tests[] = {
+   { "size 1, depth tested", 1.0F, GL_FALSE, GL_FALSE, GL_FALSE },
+   { "size 4, depth tested", 4.0F, GL_FALSE, GL_FALSE, GL_FALSE },
+   { "size 1, additive blend", 1.0F, GL_TRUE, GL_FALSE, GL_FALSE },
+   { "size 4, additive blend", 4.0F, GL_TRUE, GL_FALSE, GL_FALSE },
+   { "size 8 sprites, additive blend", 8.0F, GL_TRUE, GL_TRUE, GL_FALSE },
+   { "attenuated sprites", 8.0F, GL_TRUE, GL_TRUE, GL_TRUE }
+};
+
+#define NUM_TESTS (sizeof(Tests) / sizeof(Tests[0]))
+
+
+static void
+set_state(int i)
+{
+   static const GLfloat atten[3] = { 1.0F, 0.0F, 1.0F };
+   static const GLfloat noAtten[3] = { 1.0F, 0.0F, 0.0F };
+
+   glPointSize(Tests[i].size);
+   if (Tests[i].blend) {
+      glDisable(GL_DEPTH_TEST);
+      glEnable(GL_BLEND);
+   }
+   else {
+      glEnable(GL_DEPTH_TEST);
+      glDisable(GL_BLEND);
+   }
+   if (Tests[i].sprite) {
+      glEnable(GL_TEXTURE_2D);
+      glEnable(GL_POINT_SPRITE_ARB);
+   }
+   else {
+      glDisable(GL_TEXTURE_2D);
+      glDisable(GL_POINT_SPRITE_ARB);
+   }
+   glPointParameterfvEXT(GL_DISTANCE_ATTENUATION_EXT,
+                         Tests[i].attenuate ? atten : noAtten);
+}
+
+
+/**
+ * Draw the first CHECK_POINTS points of each test with one glDrawArrays
+ * call, and with one call per point, and compare.
+ */
+static int
+check_tests(void)
+{
+   unsigned int i;
+   int j, result = 0;
+
+   for (i = 0; i < NUM_TESTS; i++) {
+      GLubyte *image, *ref;
+
+      set_state(i);
+      glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+      glDrawArrays(GL_POINTS, 0, CHECK_POINTS);
+      image = CheckColorBuffer();
+
+      glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+      for (j = 0; j < CHECK_POINTS; j++)
+         glDrawArrays(GL_POINTS, j, 1);
+      ref = CheckColorBuffer();
+
+      result |= CheckImages(Tests[i].name, image, ref, Size, Size, 4, 0);
+      free(image);
+      free(ref);
+   }
+
+   return result;
+}
+
+
+int
+main(int argc, char *argv[])
+{
+   OSMesaContext ctx;
+   void *buffer;
+   unsigned int i;
+   int result;
+
+   Size = (argc > 1) ? atoi(argv[1]) : 512;
+
+   ctx = OSMesaCreateContextExt(OSMESA_RGBA, 16, 0, 0, NULL);
+   if (!ctx) {
+      printf("OSMesaCreateContext failed!\n");
+      return 1;
+   }
+
+   buffer = malloc(Size * Size * 4 * sizeof(GLubyte));
+   if (!buffer) {
+      printf("Alloc image buffer failed!\n");
+      return 1;
+   }
+
+   if (!OSMesaMakeCurrent(ctx, buffer, GL_UNSIGNED_BYTE, Size, Size)) {
+      printf("OSMesaMakeCurrent failed!\n");
+      return 1;
+   }
+
+   make_particles();
+   make_texture();
+   glBlendFunc(GL_ONE, GL_ONE);
+
+   printf("%d x %d, %d points per frame\n", Size, Size, NUM_POINTS);
+
+   for (i = 0; i < NUM_TESTS; i++) {
+      set_state(i);
+      printf("%-30s %8.2f Mpoints/s\n", Tests[i].name, run_test());
+   }
+
+   result = check_tests();
+
+   free(buffer);
+   OSMesaDestroyContext(ctx);
+
+   return result;
+}
@@ -0,0 +1,169 @@
+/*
+ * Antialiased polygon benchmark for off-screen Mesa rendering.
+ *
+ * Draws fans of smooth shaded triangles of several sizes with and without
+ * GL_POLYGON_SMOOTH, using the usual GL_SRC_ALPHA_SATURATE blending, and
+ * reports the number of triangles per second.  At the end the smooth
+ * fans are drawn again without the SSE code and the images are compared.
+ *
+ * Usage: ospolysmooth
+ *
+ * This program is in the public domain.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include "GL/osmesa.h"
+#include "oscheck.h"
+
+
+#define WIDTH 512
+#define HEIGHT 512
+
+
+/**
+ * Draw a fan of n triangles around the center of the window, radius in
+ * pixels.
+ */
+static void
+draw_fan(int n, GLfloat radius)
+{
+   const GLfloat rx = radius * 2.0F / WIDTH, ry = radius * 2.0F / HEIGHT;
+   int i;
+
+   glBegin(GL_TRIANGLE_FAN);
+   glColor4f(1.0F, 1.0F, 1.0F, 1.0F);
+   glVertex2f(0.0F, 0.0F);
+   for (i = 0; i <= n; i++) {
+      const double a = 2.0 * 3.14159265358979 * i / n;
+      glColor4f(0.5F + 0.5F * (GLfloat) cos(a), 0.5F + 0.5F * (GLfloat) sin(a),
+                0.5F, 1.0F);
+      glVertex2f(rx * (GLfloat) cos(a), ry * (GLfloat) sin(a));
+   }
+   glEnd();
+}
+
+
+static void
+set_smooth(GLboolean smooth)
+{
+   if (smooth) {
+      glEnable(GL_POLYGON_SMOOTH);
+      glEnable(GL_BLEND);
+   }
+   else {
+      glDisable(GL_POLYGON_SMOOTH);
+      glDisable(GL_BLEND);
+   }
+}
+
+
+static double
+run_test(GLboolean smooth, int n, GLfloat radius)
+{
+   clock_t start, end;
+   int frames = 0;
+
+   set_smooth(smooth);
+
+   start = clock();
+   do {
+      glClear(GL_COLOR_BUFFER_BIT);
+      draw_fan(n, radius);
+      glFinish();
+      frames++;
+      end = clock();
+   } while (end - start < CLOCKS_PER_SEC);
+
+   /* Ktriangles per second */
+   return (double) frames * n
+      / ((double) (end - start) / CLOCKS_PER_SEC) / 1.0e3;
+}
+
+
+static const struct {
+   int n;
+   GLfloat radius;
+} Tests[] = {
+   { 4000, 25.0F },
+   { 1000, 100.0F },
+   { 100, 250.0F }
+};
+
+#define NUM_TESTS (sizeof(Tests) / sizeof(Tests[0]))
+
+
+static OSMesaContext
+make_context(void *buffer)
+{
+   OSMesaContext ctx = OSMesaCreateContextExt(OSMESA_RGBA, 0, 0, 0, NULL);
+
+   if (!ctx || !OSMesaMakeCurrent(ctx, buffer, GL_UNSIGNED_BYTE,
+                                  WIDTH, HEIGHT)) {
+      printf("Creating the OSMesa context failed!\n");
+      exit(1);
+   }
+
+   glClearColor(0.0F, 0.0F, 0.0F, 0.0F);
+   glBlendFunc(GL_SRC_ALPHA_SATURATE, GL_ONE);
+   set_smooth(GL_TRUE);
+   return ctx;
+}
+
+
+int
+main(int argc, char *argv[])
+{
+   OSMesaContext ctx;
+   void *buffer;
+   GLubyte *images[NUM_TESTS];
+   unsigned int i;
+   int result = 0;
+
+   buffer = malloc(WIDTH * HEIGHT * 4 * sizeof(GLubyte));
+   if (!buffer) {
+      printf("Alloc image buffer failed!\n");
+      return 1;
+   }
+
+   ctx = make_context(buffer);
+
+   printf("%d x %d\n", WIDTH, HEIGHT);
+   for (i = 0; i < NUM_TESTS; i++) {
+      printf("%5d triangles, radius %3.0f  aliased: %8.1f Ktri/s   "
+             "smooth: %8.1f Ktri/s\n", Tests[i].n, Tests[i].radius,
+             run_test(GL_FALSE, Tests[i].n, Tests[i].radius),
+             run_test(GL_TRUE, Tests[i].n, Tests[i].radius));
+   }
+
+   set_smooth(GL_TRUE);
+   for (i = 0; i < NUM_TESTS; i++) {
+      glClear(GL_COLOR_BUFFER_BIT);
+      draw_fan(Tests[i].n, Tests[i].radius);
+      images[i] = CheckColorBuffer();
+   }
+   OSMesaDestroyContext(ctx);
+
+   /* the same fans with the C code */
+   putenv("MESA_NO_ASM=1");
+   ctx = make_context(buffer);
+   for (i = 0; i < NUM_TESTS; i++) {
+      char name[100];
+      GLubyte *ref;
+      glClear(GL_COLOR_BUFFER_BIT);
+      draw_fan(Tests[i].n, Tests[i].radius);
+      ref = CheckColorBuffer();
+      sprintf(name, "%d triangles, radius %.0f", Tests[i].n, Tests[i].radius);
+      result |= CheckImages(name, images[i], ref, WIDTH, HEIGHT, 4, 0);
+      free(images[i]);
+      free(ref);
+   }
+   OSMesaDestroyContext(ctx);
+
+   free(buffer);
+
+   return result;
+}
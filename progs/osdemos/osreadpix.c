@@ -0,0 +1,194 @@
+/*
+ * glReadPixels benchmark for off-screen Mesa rendering.
+ *
+ * Reads back the whole color buffer in a number of common formats and
+ * reports the throughput in megapixels per second.  The last test reads
+ * the buffer with OSMesaReadPixels() instead of glReadPixels().  At the
+ * end each read is repeated without the SSE2 code and the results are
+ * compared.
+ *
+ * Usage: osreadpix [size]
+ *
+ * Setting the MESA_NO_ASM environment variable disables the SSE2
+ * swizzling code, for comparison.
+ *
+ * This program is in the public domain.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "GL/osmesa.h"
+#include "oscheck.h"
+
+
+#ifndef GL_BGRA
+#define GL_BGRA 0x80E1
+#endif
+#ifndef GL_UNSIGNED_INT_8_8_8_8_REV
+#define GL_UNSIGNED_INT_8_8_8_8_REV 0x8367
+#endif
+
+
+/**
+ * Read the size x size color buffer in the given format and type for
+ * about one second.  Return megapixels per second.
+ */
+static void
+read_pixels(GLint size, GLenum format, GLenum type, GLboolean osmesa,
+            GLubyte *pixels)
+{
+   const GLint bpp = (format == GL_RGB) ? 3 : 4;
+
+   if (osmesa)
+      OSMesaReadPixels(OSMesaGetCurrentContext(), 0, 0, size, size,
+                       format, type, size * bpp, pixels);
+   else
+      glReadPixels(0, 0, size, size, format, type, pixels);
+}
+
+
+static double
+run_test(GLint size, GLenum format, GLenum type, GLboolean osmesa,
+         GLubyte *pixels)
+{
+   clock_t start, end;
+   int frames = 0;
+
+   start = clock();
+   do {
+      read_pixels(size, format, type, osmesa, pixels);
+      frames++;
+      end = clock();
+   } while (end - start < CLOCKS_PER_SEC);
+
+   return (double) frames * size * size * 1.0e-6
+      / ((double) (end - start) / CLOCKS_PER_SEC);
+}
+
+
+static const struct {
+   const char *name;
+   GLenum format, type;
+   GLint alignment;
+   GLboolean osmesa;
+} Tests[] = {
+   { "GL_RGBA, GL_UNSIGNED_BYTE", GL_RGBA, GL_UNSIGNED_BYTE, 1, GL_FALSE },
+   { "GL_BGRA, GL_UNSIGNED_BYTE", GL_BGRA, GL_UNSIGNED_BYTE, 1, GL_FALSE },
+   { "GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV",
+     GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, 1, GL_FALSE },
+   { "GL_RGB, GL_UNSIGNED_BYTE", GL_RGB, GL_UNSIGNED_BYTE, 1, GL_FALSE },
+   { "GL_RGB, GL_UNSIGNED_BYTE, alignment 4",
+     GL_RGB, GL_UNSIGNED_BYTE, 4, GL_FALSE },
+   { "OSMesaReadPixels GL_BGRA", GL_BGRA, GL_UNSIGNED_BYTE, 1, GL_TRUE }
+};
+
+#define NUM_TESTS (sizeof(Tests) / sizeof(Tests[0]))
+
+
+/**
+ * Make a context and fill its color buffer with a smooth shaded quad, so
+ * that the channels of neighbouring pixels differ.
+ */
+static OSMesaContext
+make_context(void *buffer, GLint size)
+{
+   OSMesaContext ctx = OSMesaCreateContextExt(OSMESA_RGBA, 0, 0, 0, NULL);
+
+   if (!ctx || !OSMesaMakeCurrent(ctx, buffer, GL_UNSIGNED_BYTE, size, size)) {
+      printf("Creating the OSMesa context failed!\n");
+      exit(1);
+   }
+
+   glClearColor(0.2F, 0.4F, 0.6F, 0.8F);
+   glClear(GL_COLOR_BUFFER_BIT);
+   glBegin(GL_QUADS);
+   glColor4f(0.0F, 0.2F, 1.0F, 0.6F);
+   glVertex2f(-1.0F, -1.0F);
+   glColor4f(1.0F, 0.0F, 0.4F, 1.0F);
+   glVertex2f(1.0F, -1.0F);
+   glColor4f(0.2F, 1.0F, 0.0F, 0.2F);
+   glVertex2f(1.0F, 1.0F);
+   glColor4f(0.8F, 0.4F, 0.6F, 0.0F);
+   glVertex2f(-1.0F, 1.0F);
+   glEnd();
+   glFinish();
+   return ctx;
+}
+
+
+/**
+ * Read the buffer as in test i into zeroed memory, padding included.
+ * Return it and the number of bytes per row.
+ */
+static GLubyte *
+read_check(GLint size, unsigned int i, GLint *rowBytes)
+{
+   const GLint bpp = (Tests[i].format == GL_RGB) ? 3 : 4;
+   const GLint a = Tests[i].alignment;
+   GLubyte *pixels;
+
+   *rowBytes = (size * bpp + a - 1) / a * a;
+   pixels = (GLubyte *) calloc(*rowBytes * size, 1);
+   if (!pixels) {
+      printf("Alloc check image failed!\n");
+      exit(1);
+   }
+   glPixelStorei(GL_PACK_ALIGNMENT, a);
+   read_pixels(size, Tests[i].format, Tests[i].type, Tests[i].osmesa, pixels);
+   return pixels;
+}
+
+
+int
+main(int argc, char *argv[])
+{
+   GLint size = (argc > 1) ? atoi(argv[1]) : 1024;
+   OSMesaContext ctx;
+   void *buffer;
+   GLubyte *pixels, *images[NUM_TESTS];
+   GLint rowBytes;
+   unsigned int i;
+   int result = 0;
+
+   buffer = malloc(size * size * 4 * sizeof(GLubyte));
+   pixels = (GLubyte *) malloc(size * size * 4 * sizeof(GLubyte));
+   if (!buffer || !pixels) {
+      printf("Alloc image buffer failed!\n");
+      return 1;
+   }
+
+   ctx = make_context(buffer, size);
+
+   printf("%d x %d color buffer\n", size, size);
+   for (i = 0; i < NUM_TESTS; i++) {
+      glPixelStorei(GL_PACK_ALIGNMENT, Tests[i].alignment);
+      printf("%-39s %8.1f Mpixels/s\n", Tests[i].name,
+             run_test(size, Tests[i].format, Tests[i].type, Tests[i].osmesa,
+                      pixels));
+   }
+
+   for (i = 0; i < NUM_TESTS; i++)
+      images[i] = read_check(size, i, &rowBytes);
+   OSMesaDestroyContext(ctx);
+
+   /* the same reads with the C code, compared byte by byte */
+   putenv("MESA_NO_ASM=1");
+   memset(buffer, 0, size * size * 4);
+   ctx = make_context(buffer, size);
+   for (i = 0; i < NUM_TESTS; i++) {
+      GLubyte *ref = read_check(size, i, &rowBytes);
+      result |= CheckImages(Tests[i].name, images[i], ref,
+                            rowBytes, size, 1, 0);
+      free(images[i]);
+      free(ref);
+   }
+   OSMesaDestroyContext(ctx);
+
+   free(pixels);
+   free(buffer);
+
+   return result;
+}
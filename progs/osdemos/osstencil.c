@@ -0,0 +1,284 @@
+/*
+ * Stencil test benchmark for off-screen Mesa rendering.
+ *
+ * Mimics the stencil passes of shadow volume rendering: after a depth
+ * only pass, large quads standing in for the volume faces are drawn
+ * with depth writes and color writes disabled, incrementing and
+ * decrementing the stencil buffer on depth fail or depth pass.  Then a
+ * quad is drawn where the stencil value is zero.  Reports the fill rate
+ * of each pass.  At the end a frame using all the stencil ops and a
+ * few stencil funcs is drawn with and without the SSE2 code, and the
+ * color, depth and stencil values are compared.
+ *
+ * Usage: osstencil [depthBits]
+ *
+ * With 24 depth bits (the default) depth and stencil values share one
+ * packed buffer.
+ *
+ * This program is in the public domain.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "GL/osmesa.h"
+#include "oscheck.h"
+
+
+#define WIDTH 512
+#define HEIGHT 512
+#define LAYERS 32
+
+
+static void
+draw_layers(GLint count, GLfloat zNear, GLfloat zFar)
+{
+   int i;
+
+   glBegin(GL_QUADS);
+   for (i = 0; i < count; i++) {
+      GLfloat z = zNear + (zFar - zNear) * i / count;
+      glVertex3f(-1.0F, -1.0F, z);
+      glVertex3f( 1.0F, -1.0F, z);
+      glVertex3f( 1.0F,  1.0F, z);
+      glVertex3f(-1.0F,  1.0F, z);
+   }
+   glEnd();
+}
+
+
+/**
+ * Draw the volume faces with the given stencil ops.  The depth
+ * buffer holds 0.5 so half the layers pass the depth test.
+ */
+static double
+run_volume_test(GLenum zfail, GLenum zpass)
+{
+   clock_t start, end;
+   int frames = 0;
+
+   glEnable(GL_STENCIL_TEST);
+   glStencilFunc(GL_ALWAYS, 0, ~0);
+   glStencilOp(GL_KEEP, zfail, zpass);
+   glDepthFunc(GL_LESS);
+   glDepthMask(GL_FALSE);
+   glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+
+   start = clock();
+   do {
+      draw_layers(LAYERS, -0.9F, 0.9F);
+      glFinish();
+      frames++;
+      end = clock();
+   } while (end - start < CLOCKS_PER_SEC);
+
+   /* Mpixels per second */
+   return (double) frames * LAYERS * WIDTH * HEIGHT
+      / ((double) (end - start) / CLOCKS_PER_SEC) / 1.0e6;
+}
+
+
+/**
+ * Clear, lay down the scene's depth, then draw a lit pass where the
+ * stencil value is zero, like one frame without the volumes.
+ */
+static double
+run_frame_test(void)
+{
+   clock_t start, end;
+   int frames = 0;
+
+   start = clock();
+   do {
+      glClear(GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+
+      glDisable(GL_STENCIL_TEST);
+      glDepthFunc(GL_LESS);
+      glDepthMask(GL_TRUE);
+      glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+      draw_layers(1, 0.0F, 0.0F);
+
+      glEnable(GL_STENCIL_TEST);
+      glStencilFunc(GL_EQUAL, 0, ~0);
+      glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+      glDepthFunc(GL_EQUAL);
+      glDepthMask(GL_FALSE);
+      glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+      draw_layers(1, 0.0F, 0.0F);
+
+      glFinish();
+      frames++;
+      end = clock();
+   } while (end - start < CLOCKS_PER_SEC);
+
+   /* frames per second */
+   return (double) frames / ((double) (end - start) / CLOCKS_PER_SEC);
+}
+
+
+/**
+ * Draw count layers from zNear to zFar with the given stencil ops, in a
+ * scissor box.
+ */
+static void
+draw_check_layers(GLenum zfail, GLenum zpass, GLint count,
+                  GLfloat zNear, GLfloat zFar,
+                  GLint x, GLint y, GLint w, GLint h)
+{
+   glScissor(x, y, w, h);
+   glStencilOp(GL_KEEP, zfail, zpass);
+   draw_layers(count, zNear, zFar);
+}
+
+
+static void
+draw_check(void)
+{
+   int i;
+
+   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+
+   /* sloped depth */
+   glDisable(GL_STENCIL_TEST);
+   glDepthFunc(GL_ALWAYS);
+   glDepthMask(GL_TRUE);
+   glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+   glBegin(GL_QUADS);
+   glVertex3f(-1.0F, -1.0F, -0.8F);
+   glVertex3f( 1.0F, -1.0F, 0.8F);
+   glVertex3f( 1.0F,  1.0F, 0.8F);
+   glVertex3f(-1.0F,  1.0F, -0.8F);
+   glEnd();
+
+   /* the volumes, overlapping, and clamping at 0 and 255 */
+   glEnable(GL_STENCIL_TEST);
+   glEnable(GL_SCISSOR_TEST);
+   glStencilFunc(GL_ALWAYS, 0, ~0);
+   glDepthFunc(GL_LESS);
+   glDepthMask(GL_FALSE);
+   draw_check_layers(GL_INCR_WRAP_EXT, GL_KEEP, LAYERS, -0.9F, 0.9F,
+                     0, 0, WIDTH, HEIGHT);
+   draw_check_layers(GL_DECR_WRAP_EXT, GL_KEEP, 2 * LAYERS, -0.5F, 0.9F,
+                     0, 0, WIDTH / 2, HEIGHT);
+   draw_check_layers(GL_KEEP, GL_INCR, LAYERS, -0.9F, 0.9F,
+                     0, HEIGHT / 2, WIDTH, HEIGHT / 2);
+   draw_check_layers(GL_KEEP, GL_DECR, 300, -0.9F, 0.9F,
+                     WIDTH / 4, 0, WIDTH / 4, HEIGHT);
+   draw_check_layers(GL_INCR, GL_INCR, 300, -0.9F, 0.9F,
+                     3 * WIDTH / 4, 0, WIDTH / 4, HEIGHT / 2);
+   glDisable(GL_SCISSOR_TEST);
+
+   /* color by stencil value */
+   glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+   glDepthFunc(GL_ALWAYS);
+   glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+   for (i = 0; i < 64; i++) {
+      glStencilFunc(GL_EQUAL, 4 * i, 0xfc);
+      glColor3ub(4 * i, 255 - 4 * i, (i & 1) ? 255 : 0);
+      draw_layers(1, 0.0F, 0.0F);
+   }
+}
+
+
+/**
+ * Return the stencil buffer, one byte per value.
+ */
+static GLubyte *
+read_stencil(void)
+{
+   GLubyte *stencil = (GLubyte *) malloc(WIDTH * HEIGHT);
+
+   if (!stencil) {
+      printf("Alloc check image failed!\n");
+      exit(1);
+   }
+   glPixelStorei(GL_PACK_ALIGNMENT, 1);
+   glReadPixels(0, 0, WIDTH, HEIGHT, GL_STENCIL_INDEX, GL_UNSIGNED_BYTE,
+                stencil);
+   return stencil;
+}
+
+
+static OSMesaContext
+make_context(GLint depthBits, void *buffer)
+{
+   OSMesaContext ctx = OSMesaCreateContextExt(OSMESA_RGBA, depthBits, 8, 0,
+                                              NULL);
+
+   if (!ctx || !OSMesaMakeCurrent(ctx, buffer, GL_UNSIGNED_BYTE,
+                                  WIDTH, HEIGHT)) {
+      printf("Creating the OSMesa context failed!\n");
+      exit(1);
+   }
+
+   glEnable(GL_DEPTH_TEST);
+   glClearDepth(0.5);
+   glClearStencil(0);
+   glClear(GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+   return ctx;
+}
+
+
+int
+main(int argc, char *argv[])
+{
+   GLint depthBits = (argc > 1) ? atoi(argv[1]) : 24;
+   GLint stencilBits, bpv;
+   OSMesaContext ctx;
+   void *buffer;
+   GLubyte *color, *depth, *stencil, *ref;
+   int result;
+
+   buffer = malloc(WIDTH * HEIGHT * 4 * sizeof(GLubyte));
+   if (!buffer) {
+      printf("Alloc image buffer failed!\n");
+      return 1;
+   }
+
+   ctx = make_context(depthBits, buffer);
+
+   glGetIntegerv(GL_DEPTH_BITS, &depthBits);
+   glGetIntegerv(GL_STENCIL_BITS, &stencilBits);
+   printf("%d x %d, %d-bit depth, %d-bit stencil buffer, %d layers\n",
+          WIDTH, HEIGHT, depthBits, stencilBits, LAYERS);
+
+   printf("z-fail volumes (GL_INCR_WRAP)   %8.1f Mpix/s\n",
+          run_volume_test(GL_INCR_WRAP_EXT, GL_KEEP));
+   printf("z-fail volumes (GL_DECR_WRAP)   %8.1f Mpix/s\n",
+          run_volume_test(GL_DECR_WRAP_EXT, GL_KEEP));
+   printf("z-pass volumes (GL_INCR)        %8.1f Mpix/s\n",
+          run_volume_test(GL_KEEP, GL_INCR));
+   printf("z-pass volumes (GL_DECR)        %8.1f Mpix/s\n",
+          run_volume_test(GL_KEEP, GL_DECR));
+   printf("clear, depth and lit passes     %8.1f frames/s\n",
+          run_frame_test());
+
+   draw_check();
+   color = CheckColorBuffer();
+   depth = CheckDepthBuffer(&bpv);
+   stencil = read_stencil();
+   OSMesaDestroyContext(ctx);
+
+   /* the same frame with the C code */
+   putenv("MESA_NO_ASM=1");
+   ctx = make_context(depthBits, buffer);
+   draw_check();
+   ref = CheckColorBuffer();
+   result = CheckImages("color", color, ref, WIDTH, HEIGHT, 4, 0);
+   free(ref);
+   ref = CheckDepthBuffer(&bpv);
+   result |= CheckImages("depth", depth, ref, WIDTH, HEIGHT, bpv, 0);
+   free(ref);
+   ref = read_stencil();
+   result |= CheckImages("stencil", stencil, ref, WIDTH, HEIGHT, 1, 0);
+   free(ref);
+   OSMesaDestroyContext(ctx);
+
+   free(color);
+   free(depth);
+   free(stencil);
+   free(buffer);
+
+   return result;
+}
@@ -0,0 +1,239 @@
+/*
+ * Texture filtering benchmark for off-screen Mesa rendering.
+ *
+ * Draws window-sized quads textured with a 1024x1024 mipmapped texture
+ * using each minification filter and reports the texturing rate.  The
+ * texture coordinates are scaled so that the texture is minified by a
+ * non-integer amount, so the mipmap-linear filters really blend two
+ * levels.  The texture environment is GL_REPLACE so that sampling
+ * dominates the cost of each span.  At the end a frame is drawn with
+ * each filter with and without the SSE2 code and the images are
+ * compared.
+ *
+ * Usage: ostexfilter [rgba8 | rgb5 | l8]
+ *
+ * This program is in the public domain.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "GL/osmesa.h"
+#include "oscheck.h"
+
+
+#define WIDTH 512
+#define HEIGHT 512
+#define TEX_SIZE 1024
+#define LAYERS 16
+
+/* texture coordinate range across the window: 819 texels on 512 pixels */
+#define TEXCOORD_RANGE 0.8F
+
+
+static const struct {
+   GLenum filter;
+   const char *name;
+} Filters[] = {
+   { GL_NEAREST, "GL_NEAREST" },
+   { GL_LINEAR, "GL_LINEAR" },
+   { GL_NEAREST_MIPMAP_NEAREST, "GL_NEAREST_MIPMAP_NEAREST" },
+   { GL_LINEAR_MIPMAP_NEAREST, "GL_LINEAR_MIPMAP_NEAREST" },
+   { GL_NEAREST_MIPMAP_LINEAR, "GL_NEAREST_MIPMAP_LINEAR" },
+   { GL_LINEAR_MIPMAP_LINEAR, "GL_LINEAR_MIPMAP_LINEAR" }
+};
+
+static const struct {
+   const char *name;
+   GLenum internalFormat;
+} Formats[] = {
+   { "rgba8", GL_RGBA8 },
+   { "rgb5", GL_RGB5 },
+   { "l8", GL_LUMINANCE8 }
+};
+
+
+/**
+ * Load a checkerboard with some noise in it, and box filtered mipmaps.
+ */
+static void
+make_texture(GLenum internalFormat)
+{
+   GLubyte *image = (GLubyte *) malloc(TEX_SIZE * TEX_SIZE * 4);
+   GLint size, level, i, j;
+
+   srand(1);
+   for (i = 0; i < TEX_SIZE; i++) {
+      for (j = 0; j < TEX_SIZE; j++) {
+         GLubyte *texel = image + (i * TEX_SIZE + j) * 4;
+         GLubyte c = (((i >> 4) ^ (j >> 4)) & 1) ? 224 : 32;
+         texel[0] = c + (rand() & 31);
+         texel[1] = c;
+         texel[2] = 255 - c - (rand() & 31);
+         texel[3] = 255;
+      }
+   }
+
+   size = TEX_SIZE;
+   level = 0;
+   while (1) {
+      glTexImage2D(GL_TEXTURE_2D, level, internalFormat, size, size, 0,
+                   GL_RGBA, GL_UNSIGNED_BYTE, image);
+      if (size == 1)
+         break;
+
+      /* box filter the image in place to the next level */
+      for (i = 0; i < size / 2; i++) {
+         for (j = 0; j < size / 2; j++) {
+            const GLubyte *src = image + (i * 2 * size + j * 2) * 4;
+            GLubyte *dst = image + (i * (size / 2) + j) * 4;
+            GLint c;
+            for (c = 0; c < 4; c++) {
+               dst[c] = (src[c] + src[4 + c] + src[size * 4 + c]
+                         + src[size * 4 + 4 + c] + 2) / 4;
+            }
+         }
+      }
+      size /= 2;
+      level++;
+   }
+
+   free(image);
+}
+
+
+static void
+draw_layers(void)
+{
+   int i;
+
+   glBegin(GL_QUADS);
+   for (i = 0; i < LAYERS; i++) {
+      /* shift the texture a bit for each layer */
+      GLfloat s = i * 0.01F, t = i * 0.02F;
+      glTexCoord2f(s, t);
+      glVertex2f(-1.0F, -1.0F);
+      glTexCoord2f(s + TEXCOORD_RANGE, t);
+      glVertex2f( 1.0F, -1.0F);
+      glTexCoord2f(s + TEXCOORD_RANGE, t + TEXCOORD_RANGE);
+      glVertex2f( 1.0F,  1.0F);
+      glTexCoord2f(s, t + TEXCOORD_RANGE);
+      glVertex2f(-1.0F,  1.0F);
+   }
+   glEnd();
+}
+
+
+static double
+run_test(GLenum filter)
+{
+   clock_t start, end;
+   int frames = 0;
+
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+
+   start = clock();
+   do {
+      draw_layers();
+      glFinish();
+      frames++;
+      end = clock();
+   } while (end - start < CLOCKS_PER_SEC);
+
+   /* Mtexels per second */
+   return (double) frames * LAYERS * WIDTH * HEIGHT
+      / ((double) (end - start) / CLOCKS_PER_SEC) / 1.0e6;
+}
+
+
+#define NUM_FILTERS (sizeof(Filters) / sizeof(Filters[0]))
+
+
+static OSMesaContext
+make_context(GLenum internalFormat, void *buffer)
+{
+   OSMesaContext ctx = OSMesaCreateContextExt(OSMESA_RGBA, 0, 0, 0, NULL);
+
+   if (!ctx || !OSMesaMakeCurrent(ctx, buffer, GL_UNSIGNED_BYTE,
+                                  WIDTH, HEIGHT)) {
+      printf("Creating the OSMesa context failed!\n");
+      exit(1);
+   }
+
+   make_texture(internalFormat);
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+   glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
+   glEnable(GL_TEXTURE_2D);
+   return ctx;
+}
+
+
+int
+main(int argc, char *argv[])
+{
+   OSMesaContext ctx;
+   void *buffer;
+   GLubyte *images[NUM_FILTERS];
+   unsigned int i, format = 0;
+   int result = 0;
+
+   if (argc > 1) {
+      for (format = 0; format < sizeof(Formats) / sizeof(Formats[0]);
+           format++) {
+         if (strcmp(argv[1], Formats[format].name) == 0)
+            break;
+      }
+      if (format == sizeof(Formats) / sizeof(Formats[0])) {
+         printf("Usage: ostexfilter [rgba8 | rgb5 | l8]\n");
+         return 1;
+      }
+   }
+
+   buffer = malloc(WIDTH * HEIGHT * 4 * sizeof(GLubyte));
+   if (!buffer) {
+      printf("Alloc image buffer failed!\n");
+      return 1;
+   }
+
+   ctx = make_context(Formats[format].internalFormat, buffer);
+
+   printf("%d x %d, %dx%d %s texture, %d layers\n",
+          WIDTH, HEIGHT, TEX_SIZE, TEX_SIZE, Formats[format].name, LAYERS);
+
+   for (i = 0; i < NUM_FILTERS; i++) {
+      printf("%-26s %8.1f Mtexels/s\n",
+             Filters[i].name, run_test(Filters[i].filter));
+   }
+
+   for (i = 0; i < NUM_FILTERS; i++) {
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                      Filters[i].filter);
+      draw_layers();
+      images[i] = CheckColorBuffer();
+   }
+   OSMesaDestroyContext(ctx);
+
+   /* the same frames with the C code */
+   putenv("MESA_NO_ASM=1");
+   ctx = make_context(Formats[format].internalFormat, buffer);
+   for (i = 0; i < NUM_FILTERS; i++) {
+      GLubyte *ref;
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                      Filters[i].filter);
+      draw_layers();
+      ref = CheckColorBuffer();
+      result |= CheckImages(Filters[i].name, images[i], ref,
+                            WIDTH, HEIGHT, 4, 0);
+      free(images[i]);
+      free(ref);
+   }
+   OSMesaDestroyContext(ctx);
+
+   free(buffer);
+
+   return result;
+}
@@ -360,6 +360,31 @@ void _ac_DestroyContext( GLcontext *ctx )
 	 FREE( (void *) ac->Cache.Attrib[i].Ptr );
    }
 
+   if (ac->Gather.Vertex.Ptr)
+      FREE( (void *) ac->Gather.Vertex.Ptr );
+   if (ac->Gather.Normal.Ptr)
+      FREE( (void *) ac->Gather.Normal.Ptr );
+   if (ac->Gather.Color.Ptr)
+      FREE( (void *) ac->Gather.Color.Ptr );
+   if (ac->Gather.SecondaryColor.Ptr)
+      FREE( (void *) ac->Gather.SecondaryColor.Ptr );
+   if (ac->Gather.EdgeFlag.Ptr)
+      FREE( (void *) ac->Gather.EdgeFlag.Ptr );
+   if (ac->Gather.Index.Ptr)
+      FREE( (void *) ac->Gather.Index.Ptr );
+   if (ac->Gather.FogCoord.Ptr)
+      FREE( (void *) ac->Gather.FogCoord.Ptr );
+
+   for (i = 0; i < MAX_TEXTURE_COORD_UNITS; i++) {
+      if (ac->Gather.TexCoord[i].Ptr)
+	 FREE( (void *) ac->Gather.TexCoord[i].Ptr );
+   }
+
+   for (i = 0; i < VERT_ATTRIB_MAX; i++) {
+      if (ac->Gather.Attrib[i].Ptr)
+	 FREE( (void *) ac->Gather.Attrib[i].Ptr );
+   }
+
    if (ac->Elts)
       FREE( ac->Elts );
 
@@ -87,6 +87,12 @@ typedef struct {
    GLuint start;
    GLuint count;
 
+   /* Facility for gathering scattered array elements, see
+    * _ac_import_gather():
+    */
+   struct ac_arrays Gather;
+   const GLuint *GatherElts;
+
    /* Facility for importing element lists:
     */
    GLuint *Elts;
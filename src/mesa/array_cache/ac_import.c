@@ -26,6 +26,7 @@
  */
 
 #include "glheader.h"
+#include "image.h"
 #include "macros.h"
 #include "imports.h"
 #include "mtypes.h"
@@ -42,6 +43,62 @@ do {									\
 } while (0)
 
 
+/* Make sure there's a buffer to gather elements of an array into:
+ */
+static GLboolean
+alloc_gather_array( GLcontext *ctx, struct gl_client_array *gather )
+{
+   if (!gather->Ptr) {
+      GLuint max = ctx->Const.MaxArrayLockSize + MAX_CLIPPED_VERTICES;
+      gather->Ptr = (GLubyte *) MALLOC( max * 4 * sizeof(GLdouble) );
+   }
+   return gather->Ptr != NULL;
+}
+
+
+/* Copy the elements listed in ac->GatherElts out of the client array
+ * into a contiguous buffer, and point the array at the copy.  The
+ * buffer was allocated by _ac_import_gather().
+ */
+static void
+gather_array( GLcontext *ctx, struct gl_client_array *array,
+	      struct gl_client_array *gather )
+{
+   ACcontext *ac = AC_CONTEXT(ctx);
+   const GLuint *elts = ac->GatherElts;
+   const GLuint n = ac->count - ac->start;
+   const GLuint stride = array->StrideB;
+   const GLuint size = array->Size * (array->Type == GL_DOUBLE ?
+				      sizeof(GLdouble) :
+				      _mesa_sizeof_type(array->Type));
+   const GLubyte *src = (const GLubyte *) array->Ptr;
+   GLubyte *dst;
+   GLuint i;
+
+   ASSERT(gather->Ptr);
+   dst = (GLubyte *) gather->Ptr;
+
+   if (((size | stride | (unsigned long) src) & 3) == 0) {
+      const GLuint words = size / 4;
+      GLuint *out = (GLuint *) dst;
+      for (i = 0 ; i < n ; i++) {
+	 const GLuint *in = (const GLuint *) (src + elts[i] * stride);
+	 GLuint j;
+	 for (j = 0 ; j < words ; j++)
+	    out[j] = in[j];
+	 out += words;
+      }
+   }
+   else {
+      for (i = 0 ; i < n ; i++)
+	 MEMCPY( dst + i * size, src + elts[i] * stride, size );
+   }
+
+   array->Ptr = dst;
+   array->StrideB = size;
+}
+
+
 /* Set the array pointer back to its source when the cached data is
  * invalidated:
  */
@@ -53,6 +110,9 @@ reset_texcoord( GLcontext *ctx, GLuint unit )
    if (ctx->Array.TexCoord[unit].Enabled) {
       ac->Raw.TexCoord[unit] = ctx->Array.TexCoord[unit];
       STRIDE_ARRAY(ac->Raw.TexCoord[unit], ac->start);
+      if (ac->GatherElts)
+         gather_array(ctx, &ac->Raw.TexCoord[unit],
+                      &ac->Gather.TexCoord[unit]);
    }
    else {
       ac->Raw.TexCoord[unit] = ac->Fallback.TexCoord[unit];
@@ -77,6 +137,8 @@ reset_vertex( GLcontext *ctx )
           || (ctx->VertexProgram._Enabled && ctx->Array.VertexAttrib[0].Enabled));
    ac->Raw.Vertex = ctx->Array.Vertex;
    STRIDE_ARRAY(ac->Raw.Vertex, ac->start);
+   if (ac->GatherElts && ctx->Array.Vertex.Enabled)
+      gather_array(ctx, &ac->Raw.Vertex, &ac->Gather.Vertex);
    ac->IsCached.Vertex = GL_FALSE;
    ac->NewArrayState &= ~_NEW_ARRAY_VERTEX;
 }
@@ -90,6 +152,8 @@ reset_normal( GLcontext *ctx )
    if (ctx->Array.Normal.Enabled) {
       ac->Raw.Normal = ctx->Array.Normal;
       STRIDE_ARRAY(ac->Raw.Normal, ac->start);
+      if (ac->GatherElts)
+         gather_array(ctx, &ac->Raw.Normal, &ac->Gather.Normal);
    }
    else {
       ac->Raw.Normal = ac->Fallback.Normal;
@@ -108,6 +172,8 @@ reset_color( GLcontext *ctx )
    if (ctx->Array.Color.Enabled) {
       ac->Raw.Color = ctx->Array.Color;
       STRIDE_ARRAY(ac->Raw.Color, ac->start);
+      if (ac->GatherElts)
+         gather_array(ctx, &ac->Raw.Color, &ac->Gather.Color);
    }
    else
       ac->Raw.Color = ac->Fallback.Color;
@@ -125,6 +191,9 @@ reset_secondarycolor( GLcontext *ctx )
    if (ctx->Array.SecondaryColor.Enabled) {
       ac->Raw.SecondaryColor = ctx->Array.SecondaryColor;
       STRIDE_ARRAY(ac->Raw.SecondaryColor, ac->start);
+      if (ac->GatherElts)
+         gather_array(ctx, &ac->Raw.SecondaryColor,
+                      &ac->Gather.SecondaryColor);
    }
    else
       ac->Raw.SecondaryColor = ac->Fallback.SecondaryColor;
@@ -142,6 +211,8 @@ reset_index( GLcontext *ctx )
    if (ctx->Array.Index.Enabled) {
       ac->Raw.Index = ctx->Array.Index;
       STRIDE_ARRAY(ac->Raw.Index, ac->start);
+      if (ac->GatherElts)
+         gather_array(ctx, &ac->Raw.Index, &ac->Gather.Index);
    }
    else
       ac->Raw.Index = ac->Fallback.Index;
@@ -159,6 +230,8 @@ reset_fogcoord( GLcontext *ctx )
    if (ctx->Array.FogCoord.Enabled) {
       ac->Raw.FogCoord = ctx->Array.FogCoord;
       STRIDE_ARRAY(ac->Raw.FogCoord, ac->start);
+      if (ac->GatherElts)
+         gather_array(ctx, &ac->Raw.FogCoord, &ac->Gather.FogCoord);
    }
    else
       ac->Raw.FogCoord = ac->Fallback.FogCoord;
@@ -176,6 +249,8 @@ reset_edgeflag( GLcontext *ctx )
    if (ctx->Array.EdgeFlag.Enabled) {
       ac->Raw.EdgeFlag = ctx->Array.EdgeFlag;
       STRIDE_ARRAY(ac->Raw.EdgeFlag, ac->start);
+      if (ac->GatherElts)
+         gather_array(ctx, &ac->Raw.EdgeFlag, &ac->Gather.EdgeFlag);
    }
    else
       ac->Raw.EdgeFlag = ac->Fallback.EdgeFlag;
@@ -193,6 +268,9 @@ reset_attrib( GLcontext *ctx, GLuint index )
    if (ctx->Array.VertexAttrib[index].Enabled) {
       ac->Raw.Attrib[index] = ctx->Array.VertexAttrib[index];
       STRIDE_ARRAY(ac->Raw.Attrib[index], ac->start);
+      if (ac->GatherElts)
+         gather_array(ctx, &ac->Raw.Attrib[index],
+                      &ac->Gather.Attrib[index]);
    }
    else
       ac->Raw.Attrib[index] = ac->Fallback.Attrib[index];
@@ -818,6 +896,13 @@ _ac_import_range( GLcontext *ctx, GLuint start, GLuint count )
 {
    ACcontext *ac = AC_CONTEXT(ctx);
 
+   if (ac->GatherElts) {
+      /* The raw and cached arrays hold gathered elements, start over.
+       */
+      ac->GatherElts = NULL;
+      ac->NewArrayState = _NEW_ARRAY_ALL;
+   }
+
    if (!ctx->Array.LockCount) {
       /* Not locked, discard cached data.  Changes to lock
        * status are caught via. _ac_invalidate_state().
@@ -841,6 +926,63 @@ _ac_import_range( GLcontext *ctx, GLuint start, GLuint count )
 
 
 
+/* Like _ac_import_range(), but the arrays to be imported are made up
+ * of the 'count' array elements listed in 'elts', in that order.  The
+ * elements are gathered into contiguous arrays, so the imported data
+ * only covers the vertices which are actually referenced.  The lock
+ * state of the arrays is ignored.
+ *
+ * Returns GL_FALSE, with GL_OUT_OF_MEMORY recorded, if there's no
+ * memory to gather the enabled arrays into.  The caller must then
+ * use _ac_import_range() instead.
+ */
+GLboolean
+_ac_import_gather( GLcontext *ctx, const GLuint *elts, GLuint count )
+{
+   ACcontext *ac = AC_CONTEXT(ctx);
+   struct gl_array_attrib *arrays = &ctx->Array;
+   GLboolean ok = GL_TRUE;
+   GLuint i;
+
+   ASSERT(count < ctx->Const.MaxArrayLockSize);
+
+   if (arrays->Vertex.Enabled)
+      ok &= alloc_gather_array(ctx, &ac->Gather.Vertex);
+   if (arrays->Normal.Enabled)
+      ok &= alloc_gather_array(ctx, &ac->Gather.Normal);
+   if (arrays->Color.Enabled)
+      ok &= alloc_gather_array(ctx, &ac->Gather.Color);
+   if (arrays->SecondaryColor.Enabled)
+      ok &= alloc_gather_array(ctx, &ac->Gather.SecondaryColor);
+   if (arrays->Index.Enabled)
+      ok &= alloc_gather_array(ctx, &ac->Gather.Index);
+   if (arrays->FogCoord.Enabled)
+      ok &= alloc_gather_array(ctx, &ac->Gather.FogCoord);
+   if (arrays->EdgeFlag.Enabled)
+      ok &= alloc_gather_array(ctx, &ac->Gather.EdgeFlag);
+   for (i = 0; i < ctx->Const.MaxTextureCoordUnits; i++) {
+      if (arrays->TexCoord[i].Enabled)
+         ok &= alloc_gather_array(ctx, &ac->Gather.TexCoord[i]);
+   }
+   for (i = 0; i < VERT_ATTRIB_MAX; i++) {
+      if (arrays->VertexAttrib[i].Enabled)
+         ok &= alloc_gather_array(ctx, &ac->Gather.Attrib[i]);
+   }
+
+   if (!ok) {
+      _mesa_error(ctx, GL_OUT_OF_MEMORY, "glDrawElements");
+      return GL_FALSE;
+   }
+
+   ac->NewArrayState = _NEW_ARRAY_ALL;
+   ac->GatherElts = elts;
+   ac->start = 0;
+   ac->count = count;
+   return GL_TRUE;
+}
+
+
+
 /* Additional convienence function for importing the element list
  * for glDrawElements() and glDrawRangeElements().
  */
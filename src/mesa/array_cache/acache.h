@@ -119,6 +119,13 @@ extern void
 _ac_import_range( GLcontext *ctx, GLuint start, GLuint count );
 
 
+/* Alternatively, set bounds to a list of array elements to be gathered.
+ * Returns GL_FALSE if out of memory:
+ */
+extern GLboolean
+_ac_import_gather( GLcontext *ctx, const GLuint *elts, GLuint count );
+
+
 /* Additional convenience function:
  */
 extern CONST void *
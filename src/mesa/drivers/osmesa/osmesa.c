@@ -42,11 +42,13 @@
 #include "imports.h"
 #include "mtypes.h"
 #include "renderbuffer.h"
+#include "state.h"
 #include "array_cache/acache.h"
 #include "swrast/swrast.h"
 #include "swrast_setup/swrast_setup.h"
 #include "swrast/s_context.h"
 #include "swrast/s_depth.h"
+#include "swrast/s_lazyclear.h"
 #include "swrast/s_lines.h"
 #include "swrast/s_triangle.h"
 #include "tnl/tnl.h"
@@ -431,6 +433,8 @@ osmesa_choose_line_function( GLcontext *ctx )
 
    if (CHAN_BITS != 8)                    return NULL;
    if (ctx->RenderMode != GL_RENDER)      return NULL;
+   if (ctx->DrawBuffer->Name != 0)        return NULL; /* user FBO */
+   if (ctx->DrawBuffer->Visual.samples > 1) return NULL;
    if (ctx->Line.SmoothFlag)              return NULL;
    if (ctx->Texture._EnabledUnits)        return NULL;
    if (ctx->Light.ShadeModel != GL_FLAT)  return NULL;
@@ -538,6 +542,9 @@ osmesa_choose_triangle_function( GLcontext *ctx )
 
    if (CHAN_BITS != 8)                  return (swrast_tri_func) NULL;
    if (ctx->RenderMode != GL_RENDER)    return (swrast_tri_func) NULL;
+   if (ctx->DrawBuffer->Name != 0)      return (swrast_tri_func) NULL; /* user FBO */
+   if (ctx->DrawBuffer->Visual.samples > 1)
+                                        return (swrast_tri_func) NULL;
    if (ctx->Polygon.SmoothFlag)         return (swrast_tri_func) NULL;
    if (ctx->Polygon.StippleFlag)        return (swrast_tri_func) NULL;
    if (ctx->Texture._EnabledUnits)      return (swrast_tri_func) NULL;
@@ -564,6 +571,21 @@ osmesa_choose_triangle_function( GLcontext *ctx )
 
 
 
+/*
+ * Average the samples of a multisample context into the image buffer.
+ * Called by glFinish and glFlush.
+ */
+static void
+osmesa_resolve( GLcontext *ctx )
+{
+   const OSMesaContext osmesa = OSMESA_CONTEXT(ctx);
+
+   if (osmesa->gl_visual->samples > 1 && osmesa->buffer)
+      _mesa_resolve_multisample_renderbuffers(ctx, osmesa->gl_buffer);
+}
+
+
+
 /* Override for the swrast triangle-selection function.  Try to use one
  * of our internal triangle functions, otherwise fall back to the
  * standard swrast functions.
@@ -614,6 +636,20 @@ osmesa_delete_renderbuffer(struct gl_renderbuffer *rb)
 }
 
 
+/**
+ * Return a pointer to pixel (x,y) so that swrast can access the user's
+ * buffer directly.  Only used for OSMESA_RGBA since that's the only
+ * format which is laid out like swrast's GLchan[4] arrays.
+ */
+static void *
+get_pointer_RGBA(GLcontext *ctx, struct gl_renderbuffer *rb, GLint x, GLint y)
+{
+   const OSMesaContext osmesa = OSMESA_CONTEXT(ctx);
+   (void) rb;
+   return PIXELADDR4(x, y);
+}
+
+
 /**
  * Allocate renderbuffer storage.  We don't actually allocate any storage
  * since we're using a user-provided buffer.
@@ -626,6 +662,7 @@ osmesa_renderbuffer_storage(GLcontext *ctx, struct gl_renderbuffer *rb,
    const OSMesaContext osmesa = OSMESA_CONTEXT(ctx);
 
    if (osmesa->format == OSMESA_RGBA) {
+      rb->GetPointer = get_pointer_RGBA;
       rb->GetRow = get_row_RGBA;
       rb->GetValues = get_values_RGBA;
       rb->PutRow = put_row_RGBA;
@@ -759,6 +796,22 @@ OSMesaCreateContext( GLenum format, OSMesaContext sharelist )
 GLAPI OSMesaContext GLAPIENTRY
 OSMesaCreateContextExt( GLenum format, GLint depthBits, GLint stencilBits,
                         GLint accumBits, OSMesaContext sharelist )
+{
+   return OSMesaCreateContextMultisample(format, depthBits, stencilBits,
+                                         accumBits, 0, sharelist);
+}
+
+
+
+/*
+ * New in Mesa 6.5
+ *
+ * Create context with a multisample framebuffer.  See osmesa.h.
+ */
+GLAPI OSMesaContext GLAPIENTRY
+OSMesaCreateContextMultisample( GLenum format, GLint depthBits,
+                                GLint stencilBits, GLint accumBits,
+                                GLint samples, OSMesaContext sharelist )
 {
    OSMesaContext osmesa;
    struct dd_function_table functions;
@@ -899,6 +952,16 @@ OSMesaCreateContextExt( GLenum format, GLint depthBits, GLint stencilBits,
       return NULL;
    }
 
+   /* the sample buffers are averaged into the image buffer */
+   if (samples <= 1)
+      samples = 0;
+   else if (samples > MAX_SAMPLES || !rgbmode || CHAN_TYPE == GL_FLOAT)
+      return NULL;
+   else if (samples > 4)
+      samples = 8;
+   else if (samples > 2)
+      samples = 4;
+
    osmesa = (OSMesaContext) CALLOC_STRUCT(osmesa_context);
    if (osmesa) {
       osmesa->gl_visual = _mesa_create_visual( rgbmode,
@@ -915,7 +978,7 @@ OSMesaCreateContextExt( GLenum format, GLint depthBits, GLint stencilBits,
                                                accumBits,
                                                accumBits,
                                                alphaBits ? accumBits : 0,
-                                               1            /* num samples */
+                                               samples
                                                );
       if (!osmesa->gl_visual) {
          FREE(osmesa);
@@ -928,6 +991,15 @@ OSMesaCreateContextExt( GLenum format, GLint depthBits, GLint stencilBits,
       functions.GetString = get_string;
       functions.UpdateState = osmesa_update_state;
       functions.GetBufferSize = get_buffer_size;
+      functions.Finish = osmesa_resolve;
+      functions.Flush = osmesa_resolve;
+      /* wait for asynchronous glReadPixels into buffer objects */
+      functions.BindBuffer = _swrast_BindBuffer;
+      functions.DeleteBuffer = _swrast_DeleteBuffer;
+      functions.BufferData = _swrast_BufferData;
+      functions.BufferSubData = _swrast_BufferSubData;
+      functions.GetBufferSubData = _swrast_GetBufferSubData;
+      functions.MapBuffer = _swrast_MapBuffer;
 
       if (!_mesa_initialize_context(&osmesa->mesa,
                                     osmesa->gl_visual,
@@ -962,6 +1034,14 @@ OSMesaCreateContextExt( GLenum format, GLint depthBits, GLint stencilBits,
                                    osmesa->gl_visual->haveAccumBuffer,
                                    GL_FALSE, /* alpha */
                                    GL_FALSE /* aux */ );
+      if (samples > 1 &&
+          !_mesa_add_multisample_renderbuffers(&osmesa->mesa,
+                                               osmesa->gl_buffer, samples)) {
+         _mesa_destroy_visual( osmesa->gl_visual );
+         _mesa_free_context_data( &osmesa->mesa );
+         FREE(osmesa);
+         return NULL;
+      }
 
       osmesa->format = format;
       osmesa->buffer = NULL;
@@ -1013,6 +1093,21 @@ OSMesaCreateContextExt( GLenum format, GLint depthBits, GLint stencilBits,
          swrast->choose_triangle = osmesa_choose_triangle;
          swrast->invalidate_line |= OSMESA_NEW_LINE;
          swrast->invalidate_triangle |= OSMESA_NEW_TRIANGLE;
+
+         /* Our renderbuffers are plain memory, so triangles may be
+          * rasterized by several threads (see MESA_SWRAST_THREADS).
+          */
+         _swrast_allow_binning( ctx, GL_TRUE );
+
+         /* The application only sees the depth buffer through
+          * OSMesaGetDepthBuffer(), so it may be cleared lazily.
+          */
+         _swrast_allow_lazy_clears( ctx, GL_TRUE );
+
+         /* Buffer objects are only accessed through the functions above,
+          * so glReadPixels into them may complete in the background.
+          */
+         _swrast_allow_async_readpixels( ctx, GL_TRUE );
       }
    }
    return osmesa;
@@ -1248,8 +1343,28 @@ OSMesaGetDepthBuffer( OSMesaContext c, GLint *width, GLint *height,
 {
    struct gl_renderbuffer *rb = NULL;
 
-   if (c->gl_buffer)
-      rb = c->gl_buffer->Attachment[BUFFER_DEPTH].Renderbuffer;
+   if (c->gl_buffer && c->gl_buffer->Attachment[BUFFER_DEPTH].Renderbuffer) {
+      struct gl_renderbuffer *depth
+         = c->gl_buffer->Attachment[BUFFER_DEPTH].Renderbuffer;
+
+      /* fill in any tiles whose clearing was deferred */
+      _swrast_resolve_lazy_clear(&c->mesa, depth, 0, 0,
+                                 depth->Width, depth->Height);
+
+      /* the depth values of the first sample */
+      rb = depth->NumSamples ? depth->Samples[0] : depth;
+
+      if (rb->Wrapped != rb) {
+         /* The depth values are interleaved with the stencil values.
+          * Keep them in a buffer of their own from now on.
+          */
+         if (_mesa_unpack_depth_stencil_renderbuffers(&c->mesa,
+                                                      c->gl_buffer))
+            c->mesa.NewState |= _NEW_BUFFERS;
+         depth = c->gl_buffer->Attachment[BUFFER_DEPTH].Renderbuffer;
+         rb = depth->NumSamples ? depth->Samples[0] : depth;
+      }
+   }
 
    if (!rb || !rb->Data) {
       /*if ((!c->gl_buffer) || (!c->gl_buffer->DepthBuffer)) {*/
@@ -1295,10 +1410,35 @@ OSMesaGetColorBuffer( OSMesaContext c, GLint *width,
       *height = c->height;
       *format = c->format;
       *buffer = c->buffer;
+      osmesa_resolve(&c->mesa);
       return GL_TRUE;
    }
 }
 
+/*
+ * Read a rectangle of the read buffer straight into the caller's memory.
+ * See osmesa.h.
+ */
+GLAPI GLboolean GLAPIENTRY
+OSMesaReadPixels( OSMesaContext c, GLint x, GLint y,
+                  GLsizei width, GLsizei height, GLenum format, GLenum type,
+                  GLint stride, void *buffer )
+{
+   GET_CURRENT_CONTEXT(ctx);
+
+   if (!c || ctx != &c->mesa)
+      return GL_FALSE;
+
+   ASSERT_OUTSIDE_BEGIN_END_AND_FLUSH_WITH_RETVAL(ctx, GL_FALSE);
+
+   if (ctx->NewState)
+      _mesa_update_state(ctx);
+
+   return _swrast_read_rgba_pixels(ctx, x, y, width, height, format, type,
+                                   stride, buffer);
+}
+
+
 
 struct name_function
 {
@@ -1309,6 +1449,7 @@ struct name_function
 static struct name_function functions[] = {
    { "OSMesaCreateContext", (OSMESAproc) OSMesaCreateContext },
    { "OSMesaCreateContextExt", (OSMESAproc) OSMesaCreateContextExt },
+   { "OSMesaCreateContextMultisample", (OSMESAproc) OSMesaCreateContextMultisample },
    { "OSMesaDestroyContext", (OSMESAproc) OSMesaDestroyContext },
    { "OSMesaMakeCurrent", (OSMESAproc) OSMesaMakeCurrent },
    { "OSMesaGetCurrentContext", (OSMESAproc) OSMesaGetCurrentContext },
@@ -1316,6 +1457,7 @@ static struct name_function functions[] = {
    { "OSMesaGetIntegerv", (OSMESAproc) OSMesaGetIntegerv },
    { "OSMesaGetDepthBuffer", (OSMESAproc) OSMesaGetDepthBuffer },
    { "OSMesaGetColorBuffer", (OSMESAproc) OSMesaGetColorBuffer },
+   { "OSMesaReadPixels", (OSMESAproc) OSMesaReadPixels },
    { "OSMesaGetProcAddress", (OSMESAproc) OSMesaGetProcAddress },
    { NULL, NULL }
 };
@@ -222,6 +222,12 @@
 /*@}*/
 
 
+/** For GL_ARB_multisample: maximum samples per pixel of software buffers */
+/*@{*/
+#define MAX_SAMPLES 8
+/*@}*/
+
+
 
 /**
  * \name Mesa-specific parameters
@@ -187,14 +187,23 @@ _mesa_add_soft_renderbuffers(struct gl_framebuffer *fb,
       }
    }
 
-   if (depth) {
-      assert(fb->Visual.depthBits > 0);
-      _mesa_add_depth_renderbuffer(NULL, fb, fb->Visual.depthBits);
+   if (depth && stencil &&
+       fb->Visual.depthBits > 16 && fb->Visual.depthBits <= 24 &&
+       fb->Visual.stencilBits <= 8) {
+      /* interleave depth and stencil values in one buffer */
+      _mesa_add_depth_stencil_renderbuffer(NULL, fb, fb->Visual.depthBits,
+                                           fb->Visual.stencilBits);
    }
+   else {
+      if (depth) {
+         assert(fb->Visual.depthBits > 0);
+         _mesa_add_depth_renderbuffer(NULL, fb, fb->Visual.depthBits);
+      }
 
-   if (stencil) {
-      assert(fb->Visual.stencilBits > 0);
-      _mesa_add_stencil_renderbuffer(NULL, fb, fb->Visual.stencilBits);
+      if (stencil) {
+         assert(fb->Visual.stencilBits > 0);
+         _mesa_add_stencil_renderbuffer(NULL, fb, fb->Visual.stencilBits);
+      }
    }
 
    if (accum) {
@@ -226,11 +235,10 @@ _mesa_add_soft_renderbuffers(struct gl_framebuffer *fb,
    }
 #endif
 
-#if 0
-   if (multisample) {
-      /* maybe someday */
+   if (color && fb->Visual.samples > 1) {
+      /* drivers with their own color buffers call this themselves */
+      _mesa_add_multisample_renderbuffers(NULL, fb, fb->Visual.samples);
    }
-#endif
 }
 
 
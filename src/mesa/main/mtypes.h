@@ -2059,6 +2059,17 @@ struct gl_renderbuffer
    /* Used to wrap one renderbuffer around another: */
    struct gl_renderbuffer *Wrapped;
 
+   /* Tiles with a deferred clear, private to swrast (see s_lazyclear.c) */
+   GLvoid *LazyClear;
+
+   /* Multisample buffers keep one renderbuffer per sample, and color
+    * buffers average them into Resolve (see renderbuffer.c).
+    * NumSamples is 0 for ordinary buffers.
+    */
+   GLuint NumSamples;
+   struct gl_renderbuffer *Samples[MAX_SAMPLES];
+   struct gl_renderbuffer *Resolve;
+
    /* Delete this renderbuffer */
    void (*Delete)(struct gl_renderbuffer *rb);
 
@@ -33,6 +33,9 @@
  * renderbuffer with the alpha renderbuffer.  We can do this because of the
  * OO-nature of renderbuffers.
  *
+ * Similarly, the depth and stencil attachments of a window-system
+ * framebuffer may both wrap one packed 24/8 depth/stencil renderbuffer.
+ *
  * Down the road we'll use this for run-time support of 8, 16 and 32-bit
  * color channels.  For example, Mesa may use 32-bit/float color channels
  * internally (swrast) and use wrapper renderbuffers to convert 32-bit
@@ -43,6 +46,7 @@
 #include "glheader.h"
 #include "imports.h"
 #include "context.h"
+#include "macros.h"
 #include "mtypes.h"
 #include "fbobject.h"
 #include "renderbuffer.h"
@@ -307,7 +311,7 @@ put_mono_values_ushort(GLcontext *ctx, struct gl_renderbuffer *rb,
 
 /**********************************************************************
  * Functions for buffers of 1 X GLuint values.
- * Typically depth/Z or color index.
+ * Typically depth/Z, packed depth/stencil or color index.
  */
 
 static void *
@@ -316,7 +320,8 @@ get_pointer_uint(GLcontext *ctx, struct gl_renderbuffer *rb,
 {
    if (!rb->Data)
       return NULL;
-   ASSERT(rb->DataType == GL_UNSIGNED_INT);
+   ASSERT(rb->DataType == GL_UNSIGNED_INT ||
+          rb->DataType == GL_UNSIGNED_INT_24_8_MESA);
    return (GLuint *) rb->Data + y * rb->Width + x;
 }
 
@@ -326,7 +331,8 @@ get_row_uint(GLcontext *ctx, struct gl_renderbuffer *rb, GLuint count,
              GLint x, GLint y, void *values)
 {
    const void *src = rb->GetPointer(ctx, rb, x, y);
-   ASSERT(rb->DataType == GL_UNSIGNED_INT);
+   ASSERT(rb->DataType == GL_UNSIGNED_INT ||
+          rb->DataType == GL_UNSIGNED_INT_24_8_MESA);
    _mesa_memcpy(values, src, count * sizeof(GLuint));
 }
 
@@ -337,7 +343,8 @@ get_values_uint(GLcontext *ctx, struct gl_renderbuffer *rb, GLuint count,
 {
    GLuint *dst = (GLuint *) values;
    GLuint i;
-   ASSERT(rb->DataType == GL_UNSIGNED_INT);
+   ASSERT(rb->DataType == GL_UNSIGNED_INT ||
+          rb->DataType == GL_UNSIGNED_INT_24_8_MESA);
    for (i = 0; i < count; i++) {
       const GLuint *src = (GLuint *) rb->Data + y[i] * rb->Width + x[i];
       dst[i] = *src;
@@ -351,7 +358,8 @@ put_row_uint(GLcontext *ctx, struct gl_renderbuffer *rb, GLuint count,
 {
    const GLuint *src = (const GLuint *) values;
    GLuint *dst = (GLuint *) rb->Data + y * rb->Width + x;
-   ASSERT(rb->DataType == GL_UNSIGNED_INT);
+   ASSERT(rb->DataType == GL_UNSIGNED_INT ||
+          rb->DataType == GL_UNSIGNED_INT_24_8_MESA);
    if (mask) {
       GLuint i;
       for (i = 0; i < count; i++) {
@@ -373,7 +381,8 @@ put_mono_row_uint(GLcontext *ctx, struct gl_renderbuffer *rb, GLuint count,
    const GLuint val = *((const GLuint *) value);
    GLuint *dst = (GLuint *) rb->Data + y * rb->Width + x;
    GLuint i;
-   ASSERT(rb->DataType == GL_UNSIGNED_INT);
+   ASSERT(rb->DataType == GL_UNSIGNED_INT ||
+          rb->DataType == GL_UNSIGNED_INT_24_8_MESA);
    for (i = 0; i < count; i++) {
       if (!mask || mask[i]) {
          dst[i] = val;
@@ -389,7 +398,8 @@ put_values_uint(GLcontext *ctx, struct gl_renderbuffer *rb, GLuint count,
 {
    const GLuint *src = (const GLuint *) values;
    GLuint i;
-   ASSERT(rb->DataType == GL_UNSIGNED_INT);
+   ASSERT(rb->DataType == GL_UNSIGNED_INT ||
+          rb->DataType == GL_UNSIGNED_INT_24_8_MESA);
    for (i = 0; i < count; i++) {
       if (!mask || mask[i]) {
          GLuint *dst = (GLuint *) rb->Data + y[i] * rb->Width + x[i];
@@ -406,7 +416,8 @@ put_mono_values_uint(GLcontext *ctx, struct gl_renderbuffer *rb, GLuint count,
 {
    const GLuint val = *((const GLuint *) value);
    GLuint i;
-   ASSERT(rb->DataType == GL_UNSIGNED_INT);
+   ASSERT(rb->DataType == GL_UNSIGNED_INT ||
+          rb->DataType == GL_UNSIGNED_INT_24_8_MESA);
    for (i = 0; i < count; i++) {
       if (!mask || mask[i]) {
          GLuint *dst = (GLuint *) rb->Data + y[i] * rb->Width + x[i];
@@ -1054,6 +1065,25 @@ soft_renderbuffer_storage(GLcontext *ctx, struct gl_renderbuffer *rb,
       rb->ComponentSizes[0] = 8 * sizeof(GLuint);
       pixelSize = sizeof(GLuint);
       break;
+   case GL_DEPTH_STENCIL_MESA:
+      /* 24 bits of depth in the high bits, 8 bits of stencil in the low
+       * bits.  Only accessed through the wrappers set up by
+       * _mesa_add_depth_stencil_renderbuffer(), or directly by swrast.
+       */
+      rb->_BaseFormat = GL_DEPTH_STENCIL_MESA;
+      rb->DataType = GL_UNSIGNED_INT_24_8_MESA;
+      rb->GetPointer = get_pointer_uint;
+      rb->GetRow = get_row_uint;
+      rb->GetValues = get_values_uint;
+      rb->PutRow = put_row_uint;
+      rb->PutRowRGB = NULL;
+      rb->PutMonoRow = put_mono_row_uint;
+      rb->PutValues = put_values_uint;
+      rb->PutMonoValues = put_mono_values_uint;
+      rb->ComponentSizes[0] = 24;
+      rb->ComponentSizes[1] = 8;
+      pixelSize = sizeof(GLuint);
+      break;
    case GL_COLOR_INDEX8_EXT:
       rb->_BaseFormat = GL_COLOR_INDEX;
       rb->DataType = GL_UNSIGNED_BYTE;
@@ -1349,6 +1379,562 @@ put_mono_values_alpha8(GLcontext *ctx, struct gl_renderbuffer *arb,
 }
 
 
+/**********************************************************************/
+/**********************************************************************/
+/**********************************************************************/
+
+
+/**
+ * Packed depth/stencil buffers.  The GL_DEPTH_STENCIL_MESA renderbuffer
+ * holds one GLuint per pixel with a 24-bit depth value in the high bits
+ * and an 8-bit stencil value in the low bits.  It's not attached to the
+ * framebuffer itself.  Instead, the depth and stencil attachments are
+ * wrappers which look like ordinary GL_UNSIGNED_INT depth and
+ * GL_UNSIGNED_BYTE stencil buffers, and which only touch their own part
+ * of the packed words.  Both wrappers hold a reference to the packed
+ * buffer.
+ *
+ * Since the wrappers don't allow direct access, swrast checks for
+ * wrapped GL_DEPTH_STENCIL_MESA buffers and accesses the packed words
+ * directly in its depth and stencil testing code.
+ */
+
+#define Z24_ADDRESS(RB, X, Y) \
+   ((GLuint *) (RB)->Wrapped->Data + (Y) * (RB)->Wrapped->Width + (X))
+
+
+static GLboolean
+alloc_storage_depth_stencil(GLcontext *ctx, struct gl_renderbuffer *rb,
+                            GLenum internalFormat, GLuint width, GLuint height)
+{
+   struct gl_renderbuffer *dsrb = rb->Wrapped;
+
+   ASSERT(rb != dsrb);
+
+   /* the depth and stencil wrappers are resized one after the other,
+    * only reallocate the packed buffer the first time.
+    */
+   if (dsrb->Width != width || dsrb->Height != height || !dsrb->Data) {
+      if (!dsrb->AllocStorage(ctx, dsrb, GL_DEPTH_STENCIL_MESA,
+                              width, height)) {
+         rb->Width = 0;
+         rb->Height = 0;
+         return GL_FALSE;
+      }
+   }
+
+   rb->Width = width;
+   rb->Height = height;
+   rb->InternalFormat = internalFormat;
+
+   return GL_TRUE;
+}
+
+
+/**
+ * Delete a depth or stencil wrapper, and the packed buffer if this was
+ * the last wrapper referencing it.
+ */
+static void
+delete_renderbuffer_depth_stencil(struct gl_renderbuffer *rb)
+{
+   struct gl_renderbuffer *dsrb = rb->Wrapped;
+
+   ASSERT(rb != dsrb);
+   dsrb->RefCount--;
+   if (dsrb->RefCount <= 0) {
+      dsrb->Delete(dsrb);
+   }
+   rb->Wrapped = NULL;
+   _mesa_free(rb);
+}
+
+
+static void *
+get_pointer_depth_stencil(GLcontext *ctx, struct gl_renderbuffer *rb,
+                          GLint x, GLint y)
+{
+   return NULL;   /* don't allow direct access! */
+}
+
+
+/*
+ * Depth wrapper functions.  Values are GLuints.
+ */
+
+static void
+get_row_z24(GLcontext *ctx, struct gl_renderbuffer *rb, GLuint count,
+            GLint x, GLint y, void *values)
+{
+   const GLuint *src = Z24_ADDRESS(rb, x, y);
+   GLuint *dst = (GLuint *) values;
+   GLuint i;
+   for (i = 0; i < count; i++) {
+      dst[i] = src[i] >> 8;
+   }
+}
+
+
+static void
+get_values_z24(GLcontext *ctx, struct gl_renderbuffer *rb, GLuint count,
+               const GLint x[], const GLint y[], void *values)
+{
+   GLuint *dst = (GLuint *) values;
+   GLuint i;
+   for (i = 0; i < count; i++) {
+      dst[i] = *Z24_ADDRESS(rb, x[i], y[i]) >> 8;
+   }
+}
+
+
+static void
+put_row_z24(GLcontext *ctx, struct gl_renderbuffer *rb, GLuint count,
+            GLint x, GLint y, const void *values, const GLubyte *mask)
+{
+   const GLuint *src = (const GLuint *) values;
+   GLuint *dst = Z24_ADDRESS(rb, x, y);
+   GLuint i;
+   for (i = 0; i < count; i++) {
+      if (!mask || mask[i]) {
+         dst[i] = (src[i] << 8) | (dst[i] & 0xff);
+      }
+   }
+}
+
+
+static void
+put_mono_row_z24(GLcontext *ctx, struct gl_renderbuffer *rb, GLuint count,
+                 GLint x, GLint y, const void *value, const GLubyte *mask)
+{
+   const GLuint val = *((const GLuint *) value) << 8;
+   GLuint *dst = Z24_ADDRESS(rb, x, y);
+   GLuint i;
+   for (i = 0; i < count; i++) {
+      if (!mask || mask[i]) {
+         dst[i] = val | (dst[i] & 0xff);
+      }
+   }
+}
+
+
+static void
+put_values_z24(GLcontext *ctx, struct gl_renderbuffer *rb, GLuint count,
+               const GLint x[], const GLint y[], const void *values,
+               const GLubyte *mask)
+{
+   const GLuint *src = (const GLuint *) values;
+   GLuint i;
+   for (i = 0; i < count; i++) {
+      if (!mask || mask[i]) {
+         GLuint *dst = Z24_ADDRESS(rb, x[i], y[i]);
+         *dst = (src[i] << 8) | (*dst & 0xff);
+      }
+   }
+}
+
+
+static void
+put_mono_values_z24(GLcontext *ctx, struct gl_renderbuffer *rb, GLuint count,
+                    const GLint x[], const GLint y[], const void *value,
+                    const GLubyte *mask)
+{
+   const GLuint val = *((const GLuint *) value) << 8;
+   GLuint i;
+   for (i = 0; i < count; i++) {
+      if (!mask || mask[i]) {
+         GLuint *dst = Z24_ADDRESS(rb, x[i], y[i]);
+         *dst = val | (*dst & 0xff);
+      }
+   }
+}
+
+
+/*
+ * Stencil wrapper functions.  Values are GLubytes.
+ */
+
+static void
+get_row_s8(GLcontext *ctx, struct gl_renderbuffer *rb, GLuint count,
+           GLint x, GLint y, void *values)
+{
+   const GLuint *src = Z24_ADDRESS(rb, x, y);
+   GLubyte *dst = (GLubyte *) values;
+   GLuint i;
+   for (i = 0; i < count; i++) {
+      dst[i] = (GLubyte) src[i];
+   }
+}
+
+
+static void
+get_values_s8(GLcontext *ctx, struct gl_renderbuffer *rb, GLuint count,
+              const GLint x[], const GLint y[], void *values)
+{
+   GLubyte *dst = (GLubyte *) values;
+   GLuint i;
+   for (i = 0; i < count; i++) {
+      dst[i] = (GLubyte) *Z24_ADDRESS(rb, x[i], y[i]);
+   }
+}
+
+
+static void
+put_row_s8(GLcontext *ctx, struct gl_renderbuffer *rb, GLuint count,
+           GLint x, GLint y, const void *values, const GLubyte *mask)
+{
+   const GLubyte *src = (const GLubyte *) values;
+   GLuint *dst = Z24_ADDRESS(rb, x, y);
+   GLuint i;
+   for (i = 0; i < count; i++) {
+      if (!mask || mask[i]) {
+         dst[i] = (dst[i] & ~0xff) | src[i];
+      }
+   }
+}
+
+
+static void
+put_mono_row_s8(GLcontext *ctx, struct gl_renderbuffer *rb, GLuint count,
+                GLint x, GLint y, const void *value, const GLubyte *mask)
+{
+   const GLubyte val = *((const GLubyte *) value);
+   GLuint *dst = Z24_ADDRESS(rb, x, y);
+   GLuint i;
+   for (i = 0; i < count; i++) {
+      if (!mask || mask[i]) {
+         dst[i] = (dst[i] & ~0xff) | val;
+      }
+   }
+}
+
+
+static void
+put_values_s8(GLcontext *ctx, struct gl_renderbuffer *rb, GLuint count,
+              const GLint x[], const GLint y[], const void *values,
+              const GLubyte *mask)
+{
+   const GLubyte *src = (const GLubyte *) values;
+   GLuint i;
+   for (i = 0; i < count; i++) {
+      if (!mask || mask[i]) {
+         GLuint *dst = Z24_ADDRESS(rb, x[i], y[i]);
+         *dst = (*dst & ~0xff) | src[i];
+      }
+   }
+}
+
+
+static void
+put_mono_values_s8(GLcontext *ctx, struct gl_renderbuffer *rb, GLuint count,
+                   const GLint x[], const GLint y[], const void *value,
+                   const GLubyte *mask)
+{
+   const GLubyte val = *((const GLubyte *) value);
+   GLuint i;
+   for (i = 0; i < count; i++) {
+      if (!mask || mask[i]) {
+         GLuint *dst = Z24_ADDRESS(rb, x[i], y[i]);
+         *dst = (*dst & ~0xff) | val;
+      }
+   }
+}
+
+#undef Z24_ADDRESS
+
+
+
+/**********************************************************************/
+/**********************************************************************/
+/**********************************************************************/
+
+
+/**
+ * Multisample buffers.  A multisample renderbuffer keeps one ordinary
+ * renderbuffer of the same size and format per sample in rb->Samples[].
+ * Values stored with the Put functions are written to all the samples.
+ * The Get functions return the average of the samples for color buffers,
+ * and the values of sample 0 for depth and stencil buffers.  Direct access
+ * isn't allowed.
+ *
+ * That's all that's needed for everything but rasterization, for which
+ * swrast tests and writes the covered samples of each fragment one by one.
+ *
+ * A multisample color buffer wraps the window system's color buffer,
+ * rb->Resolve, which only receives the averaged image when
+ * _mesa_resolve_multisample_renderbuffers() is called.
+ */
+
+/** Number of pixels averaged at a time */
+#define AVERAGE_CHUNK 256
+
+
+static GLboolean
+alloc_storage_multisample(GLcontext *ctx, struct gl_renderbuffer *rb,
+                          GLenum internalFormat, GLuint width, GLuint height)
+{
+   GLuint s;
+
+   ASSERT(rb->NumSamples > 0);
+
+   if (rb->Resolve &&
+       !rb->Resolve->AllocStorage(ctx, rb->Resolve, internalFormat,
+                                  width, height)) {
+      rb->Width = 0;
+      rb->Height = 0;
+      return GL_FALSE;
+   }
+
+   /* the samples keep the formats they were created with */
+   for (s = 0; s < rb->NumSamples; s++) {
+      struct gl_renderbuffer *srb = rb->Samples[s];
+      if (!srb->AllocStorage(ctx, srb, srb->InternalFormat, width, height)) {
+         rb->Width = 0;
+         rb->Height = 0;
+         return GL_FALSE;
+      }
+   }
+
+   rb->_BaseFormat = rb->Samples[0]->_BaseFormat;
+   rb->DataType = rb->Samples[0]->DataType;
+   COPY_4V(rb->ComponentSizes, rb->Samples[0]->ComponentSizes);
+   rb->Width = width;
+   rb->Height = height;
+   rb->InternalFormat = internalFormat;
+
+   return GL_TRUE;
+}
+
+
+/**
+ * Delete a multisample renderbuffer with its samples and resolve buffer.
+ */
+static void
+delete_renderbuffer_multisample(struct gl_renderbuffer *rb)
+{
+   GLuint s;
+
+   for (s = 0; s < rb->NumSamples; s++) {
+      rb->Samples[s]->Delete(rb->Samples[s]);
+      rb->Samples[s] = NULL;
+   }
+   if (rb->Resolve) {
+      rb->Resolve->Delete(rb->Resolve);
+      rb->Resolve = NULL;
+   }
+   _mesa_free(rb);
+}
+
+
+static void *
+get_pointer_multisample(GLcontext *ctx, struct gl_renderbuffer *rb,
+                        GLint x, GLint y)
+{
+   return NULL;   /* don't allow direct access! */
+}
+
+
+/**
+ * Average the color samples of count pixels, either of the row which
+ * starts at (x[0], y[0]) or at the locations (x[i], y[i]).  The number of
+ * samples is a power of two.
+ */
+static void
+get_average_multisample(GLcontext *ctx, struct gl_renderbuffer *rb,
+                        GLuint count, const GLint x[], const GLint y[],
+                        GLboolean row, void *values)
+{
+   const GLuint numSamples = rb->NumSamples;
+   const GLuint round = numSamples / 2;
+   GLuint shift = 0, start;
+
+   ASSERT(rb->DataType == GL_UNSIGNED_BYTE ||
+          rb->DataType == GL_UNSIGNED_SHORT);
+   ASSERT((numSamples & (numSamples - 1)) == 0);
+
+   while ((1u << shift) < numSamples)
+      shift++;
+
+   for (start = 0; start < count; start += AVERAGE_CHUNK) {
+      const GLuint n = MIN2(count - start, AVERAGE_CHUNK);
+      GLuint sum[AVERAGE_CHUNK * 4];
+      union {
+         GLubyte ub[AVERAGE_CHUNK * 4];
+         GLushort us[AVERAGE_CHUNK * 4];
+      } tmp;
+      GLuint s, i;
+
+      for (s = 0; s < numSamples; s++) {
+         struct gl_renderbuffer *srb = rb->Samples[s];
+         if (row)
+            srb->GetRow(ctx, srb, n, x[0] + start, y[0], tmp.ub);
+         else
+            srb->GetValues(ctx, srb, n, x + start, y + start, tmp.ub);
+
+         if (rb->DataType == GL_UNSIGNED_BYTE) {
+            if (s == 0) {
+               for (i = 0; i < 4 * n; i++)
+                  sum[i] = tmp.ub[i];
+            }
+            else {
+               for (i = 0; i < 4 * n; i++)
+                  sum[i] += tmp.ub[i];
+            }
+         }
+         else {
+            if (s == 0) {
+               for (i = 0; i < 4 * n; i++)
+                  sum[i] = tmp.us[i];
+            }
+            else {
+               for (i = 0; i < 4 * n; i++)
+                  sum[i] += tmp.us[i];
+            }
+         }
+      }
+
+      if (rb->DataType == GL_UNSIGNED_BYTE) {
+         GLubyte *dst = (GLubyte *) values + 4 * start;
+         for (i = 0; i < 4 * n; i++)
+            dst[i] = (GLubyte) ((sum[i] + round) >> shift);
+      }
+      else {
+         GLushort *dst = (GLushort *) values + 4 * start;
+         for (i = 0; i < 4 * n; i++)
+            dst[i] = (GLushort) ((sum[i] + round) >> shift);
+      }
+   }
+}
+
+
+static void
+get_row_multisample(GLcontext *ctx, struct gl_renderbuffer *rb, GLuint count,
+                    GLint x, GLint y, void *values)
+{
+   if (rb->_BaseFormat == GL_RGBA || rb->_BaseFormat == GL_RGB) {
+      get_average_multisample(ctx, rb, count, &x, &y, GL_TRUE, values);
+   }
+   else {
+      struct gl_renderbuffer *srb = rb->Samples[0];
+      srb->GetRow(ctx, srb, count, x, y, values);
+   }
+}
+
+
+static void
+get_values_multisample(GLcontext *ctx, struct gl_renderbuffer *rb,
+                       GLuint count, const GLint x[], const GLint y[],
+                       void *values)
+{
+   if (rb->_BaseFormat == GL_RGBA || rb->_BaseFormat == GL_RGB) {
+      get_average_multisample(ctx, rb, count, x, y, GL_FALSE, values);
+   }
+   else {
+      struct gl_renderbuffer *srb = rb->Samples[0];
+      srb->GetValues(ctx, srb, count, x, y, values);
+   }
+}
+
+
+static void
+put_row_multisample(GLcontext *ctx, struct gl_renderbuffer *rb, GLuint count,
+                    GLint x, GLint y, const void *values, const GLubyte *mask)
+{
+   GLuint s;
+   for (s = 0; s < rb->NumSamples; s++) {
+      struct gl_renderbuffer *srb = rb->Samples[s];
+      srb->PutRow(ctx, srb, count, x, y, values, mask);
+   }
+}
+
+
+static void
+put_row_rgb_multisample(GLcontext *ctx, struct gl_renderbuffer *rb,
+                        GLuint count, GLint x, GLint y,
+                        const void *values, const GLubyte *mask)
+{
+   GLuint s;
+   for (s = 0; s < rb->NumSamples; s++) {
+      struct gl_renderbuffer *srb = rb->Samples[s];
+      srb->PutRowRGB(ctx, srb, count, x, y, values, mask);
+   }
+}
+
+
+static void
+put_mono_row_multisample(GLcontext *ctx, struct gl_renderbuffer *rb,
+                         GLuint count, GLint x, GLint y,
+                         const void *value, const GLubyte *mask)
+{
+   GLuint s;
+   for (s = 0; s < rb->NumSamples; s++) {
+      struct gl_renderbuffer *srb = rb->Samples[s];
+      srb->PutMonoRow(ctx, srb, count, x, y, value, mask);
+   }
+}
+
+
+static void
+put_values_multisample(GLcontext *ctx, struct gl_renderbuffer *rb,
+                       GLuint count, const GLint x[], const GLint y[],
+                       const void *values, const GLubyte *mask)
+{
+   GLuint s;
+   for (s = 0; s < rb->NumSamples; s++) {
+      struct gl_renderbuffer *srb = rb->Samples[s];
+      srb->PutValues(ctx, srb, count, x, y, values, mask);
+   }
+}
+
+
+static void
+put_mono_values_multisample(GLcontext *ctx, struct gl_renderbuffer *rb,
+                            GLuint count, const GLint x[], const GLint y[],
+                            const void *value, const GLubyte *mask)
+{
+   GLuint s;
+   for (s = 0; s < rb->NumSamples; s++) {
+      struct gl_renderbuffer *srb = rb->Samples[s];
+      srb->PutMonoValues(ctx, srb, count, x, y, value, mask);
+   }
+}
+
+
+/**
+ * Allocate a multisample renderbuffer which will replace rb as an
+ * attachment of a framebuffer.  The caller fills in the samples.
+ */
+static struct gl_renderbuffer *
+new_multisample_renderbuffer(GLcontext *ctx, const struct gl_renderbuffer *rb,
+                             GLuint numSamples)
+{
+   struct gl_renderbuffer *msrb = _mesa_new_renderbuffer(ctx, 0);
+   if (!msrb) {
+      _mesa_error(ctx, GL_OUT_OF_MEMORY, "Allocating multisample buffer");
+      return NULL;
+   }
+
+   msrb->InternalFormat = rb->InternalFormat;
+   msrb->_BaseFormat = rb->_BaseFormat;
+   msrb->DataType = rb->DataType;
+   COPY_4V(msrb->ComponentSizes, rb->ComponentSizes);
+   msrb->NumSamples = numSamples;
+   msrb->AllocStorage = alloc_storage_multisample;
+   msrb->Delete = delete_renderbuffer_multisample;
+   msrb->GetPointer = get_pointer_multisample;
+   msrb->GetRow = get_row_multisample;
+   msrb->GetValues = get_values_multisample;
+   msrb->PutRow = put_row_multisample;
+   msrb->PutRowRGB = NULL;
+   msrb->PutMonoRow = put_mono_row_multisample;
+   msrb->PutValues = put_values_multisample;
+   msrb->PutMonoValues = put_mono_values_multisample;
+
+   return msrb;
+}
+
+#undef AVERAGE_CHUNK
+
+
 
 /**********************************************************************/
 /**********************************************************************/
@@ -1391,6 +1977,9 @@ _mesa_init_renderbuffer(struct gl_renderbuffer *rb, GLuint name)
    rb->ComponentSizes[2] = 0;
    rb->ComponentSizes[3] = 0;
    rb->Data = NULL;
+   rb->LazyClear = NULL;
+   rb->NumSamples = 0;
+   rb->Resolve = NULL;
 
    /* Point back to ourself so that we don't have to check for Wrapped==NULL
     * all over the drivers.
@@ -1433,6 +2022,9 @@ _mesa_delete_renderbuffer(struct gl_renderbuffer *rb)
    if (rb->Data) {
       _mesa_free(rb->Data);
    }
+   if (rb->LazyClear) {
+      _mesa_free(rb->LazyClear);
+   }
    _mesa_free(rb);
 }
 
@@ -1755,6 +2347,204 @@ _mesa_add_stencil_renderbuffer(GLcontext *ctx, struct gl_framebuffer *fb,
 }
 
 
+/**
+ * Allocate a depth and a stencil wrapper around a new packed 24/8
+ * depth/stencil renderbuffer (see above).
+ */
+static GLboolean
+new_depth_stencil_renderbuffers(GLcontext *ctx, struct gl_renderbuffer **drbOut,
+                                struct gl_renderbuffer **srbOut)
+{
+   struct gl_renderbuffer *dsrb, *drb, *srb;
+
+   dsrb = _mesa_new_renderbuffer(ctx, 0);
+   drb = _mesa_new_renderbuffer(ctx, 0);
+   srb = _mesa_new_renderbuffer(ctx, 0);
+   if (!dsrb || !drb || !srb) {
+      if (dsrb)
+         _mesa_free(dsrb);
+      if (drb)
+         _mesa_free(drb);
+      if (srb)
+         _mesa_free(srb);
+      _mesa_error(ctx, GL_OUT_OF_MEMORY, "Allocating depth/stencil buffer");
+      return GL_FALSE;
+   }
+
+   dsrb->InternalFormat = GL_DEPTH_STENCIL_MESA;
+   dsrb->AllocStorage = soft_renderbuffer_storage;
+   /* one reference for each of the wrappers */
+   dsrb->RefCount = 2;
+
+   drb->InternalFormat = GL_DEPTH_COMPONENT24;
+   drb->_BaseFormat = GL_DEPTH_COMPONENT;
+   drb->DataType = GL_UNSIGNED_INT;
+   drb->ComponentSizes[0] = 24;
+   drb->Wrapped = dsrb;
+   drb->AllocStorage = alloc_storage_depth_stencil;
+   drb->Delete = delete_renderbuffer_depth_stencil;
+   drb->GetPointer = get_pointer_depth_stencil;
+   drb->GetRow = get_row_z24;
+   drb->GetValues = get_values_z24;
+   drb->PutRow = put_row_z24;
+   drb->PutRowRGB = NULL;
+   drb->PutMonoRow = put_mono_row_z24;
+   drb->PutValues = put_values_z24;
+   drb->PutMonoValues = put_mono_values_z24;
+
+   srb->InternalFormat = GL_STENCIL_INDEX8_EXT;
+   srb->_BaseFormat = GL_STENCIL_INDEX;
+   srb->DataType = GL_UNSIGNED_BYTE;
+   srb->ComponentSizes[0] = 8;
+   srb->Wrapped = dsrb;
+   srb->AllocStorage = alloc_storage_depth_stencil;
+   srb->Delete = delete_renderbuffer_depth_stencil;
+   srb->GetPointer = get_pointer_depth_stencil;
+   srb->GetRow = get_row_s8;
+   srb->GetValues = get_values_s8;
+   srb->PutRow = put_row_s8;
+   srb->PutRowRGB = NULL;
+   srb->PutMonoRow = put_mono_row_s8;
+   srb->PutValues = put_values_s8;
+   srb->PutMonoValues = put_mono_values_s8;
+
+   *drbOut = drb;
+   *srbOut = srb;
+   return GL_TRUE;
+}
+
+
+/**
+ * Add software-based depth and stencil renderbuffers which share one
+ * packed 24/8 depth/stencil buffer to the given framebuffer.  This
+ * halves the memory traffic of stencil and depth testing, and lets
+ * swrast test both in a single pass.
+ * This is a helper routine for device drivers when creating a
+ * window system framebuffer (not a user-created render/framebuffer).
+ * Drivers which use _mesa_add_soft_renderbuffers() get this for free
+ * with 17 to 24 depth bits and up to 8 stencil bits.
+ */
+GLboolean
+_mesa_add_depth_stencil_renderbuffer(GLcontext *ctx, struct gl_framebuffer *fb,
+                                     GLuint depthBits, GLuint stencilBits)
+{
+   struct gl_renderbuffer *drb, *srb;
+
+   if (depthBits <= 16 || depthBits > 24 || stencilBits > 8) {
+      _mesa_problem(ctx,
+          "Unsupported depth/stencilBits in _mesa_add_depth_stencil_renderbuffer");
+      return GL_FALSE;
+   }
+
+   assert(fb->Attachment[BUFFER_DEPTH].Renderbuffer == NULL);
+   assert(fb->Attachment[BUFFER_STENCIL].Renderbuffer == NULL);
+
+   if (!new_depth_stencil_renderbuffers(ctx, &drb, &srb))
+      return GL_FALSE;
+
+   _mesa_add_renderbuffer(fb, BUFFER_DEPTH, drb);
+   _mesa_add_renderbuffer(fb, BUFFER_STENCIL, srb);
+
+   return GL_TRUE;
+}
+
+
+/**
+ * Replace the depth and stencil wrappers around a packed 24/8 buffer by
+ * separate software renderbuffers with the same contents.  The wrappers
+ * are deleted.
+ */
+static GLboolean
+unpack_depth_stencil_renderbuffers(GLcontext *ctx,
+                                   struct gl_renderbuffer **drbInOut,
+                                   struct gl_renderbuffer **srbInOut)
+{
+   struct gl_renderbuffer *drb = *drbInOut, *srb = *srbInOut;
+   struct gl_renderbuffer *depth, *stencil;
+   GLuint zValues[MAX_WIDTH];
+   GLubyte sValues[MAX_WIDTH];
+   GLuint y;
+
+   ASSERT(drb->Wrapped == srb->Wrapped);
+   ASSERT(drb->Width <= MAX_WIDTH);
+
+   depth = _mesa_new_soft_renderbuffer(ctx, 0);
+   stencil = _mesa_new_soft_renderbuffer(ctx, 0);
+   if (!depth || !stencil) {
+      if (depth)
+         depth->Delete(depth);
+      if (stencil)
+         stencil->Delete(stencil);
+      _mesa_error(ctx, GL_OUT_OF_MEMORY, "Allocating depth/stencil buffer");
+      return GL_FALSE;
+   }
+   if (!depth->AllocStorage(ctx, depth, GL_DEPTH_COMPONENT24,
+                            drb->Width, drb->Height) ||
+       !stencil->AllocStorage(ctx, stencil, GL_STENCIL_INDEX8_EXT,
+                              srb->Width, srb->Height)) {
+      depth->Delete(depth);
+      stencil->Delete(stencil);
+      return GL_FALSE;
+   }
+
+   for (y = 0; y < drb->Height; y++) {
+      drb->GetRow(ctx, drb, drb->Width, 0, y, zValues);
+      depth->PutRow(ctx, depth, drb->Width, 0, y, zValues, NULL);
+      srb->GetRow(ctx, srb, srb->Width, 0, y, sValues);
+      stencil->PutRow(ctx, stencil, srb->Width, 0, y, sValues, NULL);
+   }
+
+   drb->Delete(drb);
+   srb->Delete(srb);
+   *drbInOut = depth;
+   *srbInOut = stencil;
+   return GL_TRUE;
+}
+
+
+/**
+ * If the depth and stencil renderbuffers of the given framebuffer share a
+ * packed 24/8 buffer (see _mesa_add_depth_stencil_renderbuffer()), give
+ * them separate buffers with the same contents, also for each sample of
+ * a multisample framebuffer.  Drivers call this before handing the depth
+ * values to the application, which expects them in a buffer of their own.
+ * The framebuffer mustn't be in use by rendering while this is done.
+ */
+GLboolean
+_mesa_unpack_depth_stencil_renderbuffers(GLcontext *ctx,
+                                         struct gl_framebuffer *fb)
+{
+   struct gl_renderbuffer_attachment *datt = &fb->Attachment[BUFFER_DEPTH];
+   struct gl_renderbuffer_attachment *satt = &fb->Attachment[BUFFER_STENCIL];
+   struct gl_renderbuffer *drb = datt->Renderbuffer;
+   struct gl_renderbuffer *srb = satt->Renderbuffer;
+   GLuint s;
+
+   if (!drb || !srb)
+      return GL_TRUE;
+
+   if (drb->NumSamples) {
+      for (s = 0; s < drb->NumSamples; s++) {
+         struct gl_renderbuffer *dsrb = drb->Samples[s]->Wrapped;
+         if (dsrb != drb->Samples[s] && dsrb->Data &&
+             !unpack_depth_stencil_renderbuffers(ctx, &drb->Samples[s],
+                                                 &srb->Samples[s]))
+            return GL_FALSE;
+      }
+   }
+   else if (drb->Wrapped != drb && drb->Wrapped == srb->Wrapped &&
+            drb->Wrapped->Data) {
+      ASSERT(drb->RefCount == 1);
+      ASSERT(srb->RefCount == 1);
+      if (!unpack_depth_stencil_renderbuffers(ctx, &datt->Renderbuffer,
+                                              &satt->Renderbuffer))
+         return GL_FALSE;
+   }
+
+   return GL_TRUE;
+}
+
+
 /**
  * Add a software-based accumulation renderbuffer to the given framebuffer.
  * This is a helper routine for device drivers when creating a
@@ -1842,6 +2632,165 @@ _mesa_add_aux_renderbuffers(GLcontext *ctx, struct gl_framebuffer *fb,
 
 
 
+/**
+ * Turn the color, depth and stencil renderbuffers of the given framebuffer
+ * into multisample renderbuffers (see above) with numSamples samples per
+ * pixel, which must be a power of two.  The color buffers become the
+ * resolve buffers, the samples are software renderbuffers.
+ * This is a helper routine for device drivers when creating a
+ * window system framebuffer (not a user-created render/framebuffer).
+ * Call it after adding the other renderbuffers, and call
+ * _mesa_resolve_multisample_renderbuffers() to update the color buffers.
+ * _mesa_add_soft_renderbuffers() does this for software color buffers
+ * if the visual has more than one sample.
+ *
+ * NOTE: color-index and floating point color buffers not supported.
+ */
+GLboolean
+_mesa_add_multisample_renderbuffers(GLcontext *ctx, struct gl_framebuffer *fb,
+                                    GLuint numSamples)
+{
+   struct gl_renderbuffer *depthRb = fb->Attachment[BUFFER_DEPTH].Renderbuffer;
+   struct gl_renderbuffer *stencilRb
+      = fb->Attachment[BUFFER_STENCIL].Renderbuffer;
+   struct gl_renderbuffer *msDepth = NULL, *msStencil = NULL;
+   GLboolean packed;
+   GLenum colorFormat;
+   GLuint b, s;
+
+   /* for window system framebuffers only! */
+   assert(fb->Name == 0);
+
+   if (numSamples < 2 || numSamples > MAX_SAMPLES ||
+       (numSamples & (numSamples - 1)) || !fb->Visual.rgbMode) {
+      _mesa_problem(ctx,
+           "Unsupported visual in _mesa_add_multisample_renderbuffers");
+      return GL_FALSE;
+   }
+
+#if CHAN_TYPE == GL_UNSIGNED_BYTE
+   colorFormat = fb->Visual.alphaBits ? GL_RGBA8 : GL_RGB8;
+#elif CHAN_TYPE == GL_UNSIGNED_SHORT
+   colorFormat = GL_RGBA16;
+#else
+   _mesa_problem(ctx,
+           "Unsupported channel type in _mesa_add_multisample_renderbuffers");
+   return GL_FALSE;
+#endif
+
+   for (b = BUFFER_FRONT_LEFT; b <= BUFFER_BACK_RIGHT; b++) {
+      struct gl_renderbuffer *rb = fb->Attachment[b].Renderbuffer;
+      struct gl_renderbuffer *msrb;
+
+      if (!rb)
+         continue;
+
+      msrb = new_multisample_renderbuffer(ctx, rb, numSamples);
+      if (!msrb)
+         return GL_FALSE;
+      for (s = 0; s < numSamples; s++) {
+         msrb->Samples[s] = _mesa_new_soft_renderbuffer(ctx, 0);
+         if (!msrb->Samples[s]) {
+            _mesa_error(ctx, GL_OUT_OF_MEMORY, "Allocating multisample buffer");
+            return GL_FALSE;
+         }
+         msrb->Samples[s]->InternalFormat = colorFormat;
+      }
+      msrb->PutRowRGB = put_row_rgb_multisample;
+      msrb->Resolve = rb;
+
+      /* clear the pointer to avoid assertion/sanity check failure later */
+      fb->Attachment[b].Renderbuffer = NULL;
+      _mesa_add_renderbuffer(fb, b, msrb);
+   }
+
+   /* Sample 0 of the depth and stencil buffers is the existing buffer.
+    * The other samples are made the same way, with their depth and stencil
+    * values packed together if the existing buffers are.
+    */
+   packed = (depthRb && stencilRb && depthRb->Wrapped == stencilRb->Wrapped &&
+             depthRb->Wrapped != depthRb);
+   if (depthRb) {
+      msDepth = new_multisample_renderbuffer(ctx, depthRb, numSamples);
+      if (!msDepth)
+         return GL_FALSE;
+      msDepth->Samples[0] = depthRb;
+   }
+   if (stencilRb) {
+      msStencil = new_multisample_renderbuffer(ctx, stencilRb, numSamples);
+      if (!msStencil)
+         return GL_FALSE;
+      msStencil->Samples[0] = stencilRb;
+   }
+   for (s = 1; s < numSamples; s++) {
+      if (packed) {
+         if (!new_depth_stencil_renderbuffers(ctx, &msDepth->Samples[s],
+                                              &msStencil->Samples[s]))
+            return GL_FALSE;
+         continue;
+      }
+      if (depthRb) {
+         msDepth->Samples[s] = _mesa_new_soft_renderbuffer(ctx, 0);
+         if (!msDepth->Samples[s]) {
+            _mesa_error(ctx, GL_OUT_OF_MEMORY, "Allocating multisample buffer");
+            return GL_FALSE;
+         }
+         msDepth->Samples[s]->InternalFormat = depthRb->InternalFormat;
+      }
+      if (stencilRb) {
+         msStencil->Samples[s] = _mesa_new_soft_renderbuffer(ctx, 0);
+         if (!msStencil->Samples[s]) {
+            _mesa_error(ctx, GL_OUT_OF_MEMORY, "Allocating multisample buffer");
+            return GL_FALSE;
+         }
+         msStencil->Samples[s]->InternalFormat = stencilRb->InternalFormat;
+      }
+   }
+   if (msDepth) {
+      fb->Attachment[BUFFER_DEPTH].Renderbuffer = NULL;
+      _mesa_add_renderbuffer(fb, BUFFER_DEPTH, msDepth);
+   }
+   if (msStencil) {
+      fb->Attachment[BUFFER_STENCIL].Renderbuffer = NULL;
+      _mesa_add_renderbuffer(fb, BUFFER_STENCIL, msStencil);
+   }
+
+   return GL_TRUE;
+}
+
+
+/**
+ * Store the average of the samples of each multisample color buffer of
+ * the given framebuffer in its resolve buffer.  Drivers call this before
+ * the color buffers are displayed or handed to the application.
+ */
+void
+_mesa_resolve_multisample_renderbuffers(GLcontext *ctx,
+                                        struct gl_framebuffer *fb)
+{
+   GLuint b;
+
+   for (b = BUFFER_FRONT_LEFT; b <= BUFFER_BACK_RIGHT; b++) {
+      struct gl_renderbuffer *rb = fb->Attachment[b].Renderbuffer;
+      struct gl_renderbuffer *dst;
+      GLchan rgba[MAX_WIDTH][4];
+      GLuint y;
+
+      if (!rb || !rb->NumSamples || !rb->Resolve)
+         continue;
+
+      dst = rb->Resolve;
+      ASSERT(rb->DataType == CHAN_TYPE);
+      ASSERT(rb->Width <= MAX_WIDTH);
+      for (y = 0; y < rb->Height; y++) {
+         rb->GetRow(ctx, rb, rb->Width, 0, y, rgba);
+         dst->PutRow(ctx, dst, rb->Width, 0, y, rgba, NULL);
+      }
+   }
+}
+
+
+
 /**
  * Attach a renderbuffer to a framebuffer.
  */
@@ -67,6 +67,14 @@ extern GLboolean
 _mesa_add_stencil_renderbuffer(GLcontext *ctx, struct gl_framebuffer *fb,
                                GLuint stencilBits);
 
+extern GLboolean
+_mesa_add_depth_stencil_renderbuffer(GLcontext *ctx, struct gl_framebuffer *fb,
+                                     GLuint depthBits, GLuint stencilBits);
+
+extern GLboolean
+_mesa_unpack_depth_stencil_renderbuffers(GLcontext *ctx,
+                                         struct gl_framebuffer *fb);
+
 
 extern GLboolean
 _mesa_add_accum_renderbuffer(GLcontext *ctx, struct gl_framebuffer *fb,
@@ -77,6 +85,14 @@ extern GLboolean
 _mesa_add_aux_renderbuffers(GLcontext *ctx, struct gl_framebuffer *fb,
                             GLuint bits, GLuint numBuffers);
 
+extern GLboolean
+_mesa_add_multisample_renderbuffers(GLcontext *ctx, struct gl_framebuffer *fb,
+                                    GLuint numSamples);
+
+extern void
+_mesa_resolve_multisample_renderbuffers(GLcontext *ctx,
+                                        struct gl_framebuffer *fb);
+
 extern void
 _mesa_add_renderbuffer(struct gl_framebuffer *fb,
                        GLuint bufferName, struct gl_renderbuffer *rb);
@@ -38,12 +38,15 @@
 #include "s_aatriangle.h"
 #include "s_context.h"
 #include "s_span.h"
+#include "x86/common_x86_sse2.h"
 
 
 /*
  * Compute coefficients of a plane using the X,Y coords of the v0, v1, v2
  * vertices and the given Z values.
  * A point (x,y,z) lies on plane iff a*x+b*y+c*z+d = 0.
+ * The plane is scaled so that c = -1, so z = a*x+b*y+d.  The vertices
+ * must not be colinear.
  */
 static INLINE void
 compute_plane(const GLfloat v0[], const GLfloat v1[], const GLfloat v2[],
@@ -67,11 +70,12 @@ compute_plane(const GLfloat v0[], const GLfloat v1[], const GLfloat v2[],
    /* The scalar product "(r*(a,b,c)+w)*(a,b,c)" is "r*(a^2+b^2+c^2)",
       which is equal to "-d" below. */
    const GLfloat d = -(a * v0[0] + b * v0[1] + c * z0);
+   const GLfloat scale = -1.0F / c;
 
-   plane[0] = a;
-   plane[1] = b;
-   plane[2] = c;
-   plane[3] = d;
+   plane[0] = a * scale;
+   plane[1] = b * scale;
+   plane[2] = -1.0F;
+   plane[3] = d * scale;
 }
 
 
@@ -87,14 +91,6 @@ constant_plane(GLfloat value, GLfloat plane[4])
    plane[3] = value;
 }
 
-#define CONSTANT_PLANE(VALUE, PLANE)	\
-do {					\
-   PLANE[0] = 0.0F;			\
-   PLANE[1] = 0.0F;			\
-   PLANE[2] = -1.0F;			\
-   PLANE[3] = VALUE;			\
-} while (0)
-
 
 
 /*
@@ -103,15 +99,11 @@ do {					\
 static INLINE GLfloat
 solve_plane(GLfloat x, GLfloat y, const GLfloat plane[4])
 {
-   ASSERT(plane[2] != 0.0F);
-   return (plane[3] + plane[0] * x + plane[1] * y) / -plane[2];
+   ASSERT(plane[2] == -1.0F);
+   return plane[3] + plane[0] * x + plane[1] * y;
 }
 
 
-#define SOLVE_PLANE(X, Y, PLANE) \
-   ((PLANE[3] + PLANE[0] * (X) + PLANE[1] * (Y)) / -PLANE[2])
-
-
 /*
  * Return 1 / solve_plane().
  */
@@ -122,7 +114,7 @@ solve_plane_recip(GLfloat x, GLfloat y, const GLfloat plane[4])
    if (denom == 0.0F)
       return 0.0F;
    else
-      return -plane[2] / denom;
+      return 1.0F / denom;
 }
 
 
@@ -132,7 +124,7 @@ solve_plane_recip(GLfloat x, GLfloat y, const GLfloat plane[4])
 static INLINE GLchan
 solve_plane_chan(GLfloat x, GLfloat y, const GLfloat plane[4])
 {
-   const GLfloat z = (plane[3] + plane[0] * x + plane[1] * y) / -plane[2];
+   const GLfloat z = plane[3] + plane[0] * x + plane[1] * y;
 #if CHAN_TYPE == GL_FLOAT
    return CLAMP(z, 0.0F, CHAN_MAXF);
 #else
@@ -147,194 +139,237 @@ solve_plane_chan(GLfloat x, GLfloat y, const GLfloat plane[4])
 
 
 /*
- * Compute how much (area) of the given pixel is inside the triangle.
- * Vertices MUST be specified in counter-clockwise order.
- * Return:  coverage in [0, 1].
+ * Coverage is computed with 16 samples per pixel.  The vertices are
+ * snapped to 1/256 pixel and the edge functions are evaluated exactly in
+ * that fixed-point space, incrementally from pixel to pixel.
+ *
+ * Sample positions, relative to the lower-left pixel corner, in 1/256 pixel
+ * units.  Contributed by Ray Tice.
+ *
+ * Jitter sample positions -
+ * - average should be .5 in x & y for each column
+ * - each of the 16 rows and columns should be used once
+ * - the rectangle formed by the first four points
+ *   should contain the other points
+ * - the distrubition should be fairly even in any given direction
+ *
+ * The pattern drawn below isn't optimal, but it's better than a regular
+ * grid.  In the drawing, the center of each subpixel is surrounded by
+ * four dots.  The "x" marks the jittered position relative to the
+ * subpixel center.
  */
-static GLfloat
-compute_coveragef(const GLfloat v0[3], const GLfloat v1[3],
-                  const GLfloat v2[3], GLint winx, GLint winy)
+#define SUB_BITS 8
+#define SUB_ONE (1 << SUB_BITS)
+#define POS(a, b) (8 + (a) * 64 + (b) * 16)
+static const GLint samples[16][2] = {
+   /* start with the four corners */
+   { POS(0, 2), POS(0, 0) },
+   { POS(3, 3), POS(0, 2) },
+   { POS(0, 0), POS(3, 1) },
+   { POS(3, 1), POS(3, 3) },
+   /* continue with interior samples */
+   { POS(1, 1), POS(0, 1) },
+   { POS(2, 0), POS(0, 3) },
+   { POS(0, 3), POS(1, 3) },
+   { POS(1, 2), POS(1, 0) },
+   { POS(2, 3), POS(1, 2) },
+   { POS(3, 2), POS(1, 1) },
+   { POS(0, 1), POS(2, 2) },
+   { POS(1, 0), POS(2, 1) },
+   { POS(2, 1), POS(2, 3) },
+   { POS(3, 0), POS(2, 0) },
+   { POS(1, 3), POS(3, 0) },
+   { POS(2, 2), POS(3, 2) }
+};
+#undef POS
+
+
+/*
+ * Sample positions of multisample framebuffers, in the same units.  These
+ * are the usual 2x, 4x and 8x patterns of hardware multisampling, given
+ * in 1/16 pixel relative to the pixel center.
+ */
+#define POS(x, y) { 128 + 16 * (x), 128 + 16 * (y) }
+static const GLint samples2[2][2] = {
+   POS(4, 4), POS(-4, -4)
+};
+static const GLint samples4[4][2] = {
+   POS(-2, -6), POS(6, -2), POS(-6, 2), POS(2, 6)
+};
+static const GLint samples8[8][2] = {
+   POS(1, -3), POS(-1, 3), POS(5, 1), POS(-3, -5),
+   POS(-5, 5), POS(-7, -1), POS(3, 7), POS(7, -7)
+};
+#undef POS
+
+
+static INLINE const GLint (*multisample_positions(GLuint numSamples))[2]
 {
-   /* Given a position [0,3]x[0,3] return the sub-pixel sample position.
-    * Contributed by Ray Tice.
-    *
-    * Jitter sample positions -
-    * - average should be .5 in x & y for each column
-    * - each of the 16 rows and columns should be used once
-    * - the rectangle formed by the first four points
-    *   should contain the other points
-    * - the distrubition should be fairly even in any given direction
-    *
-    * The pattern drawn below isn't optimal, but it's better than a regular
-    * grid.  In the drawing, the center of each subpixel is surrounded by
-    * four dots.  The "x" marks the jittered position relative to the
-    * subpixel center.
-    */
-#define POS(a, b) (0.5+a*4+b)/16
-   static const GLfloat samples[16][2] = {
-      /* start with the four corners */
-      { POS(0, 2), POS(0, 0) },
-      { POS(3, 3), POS(0, 2) },
-      { POS(0, 0), POS(3, 1) },
-      { POS(3, 1), POS(3, 3) },
-      /* continue with interior samples */
-      { POS(1, 1), POS(0, 1) },
-      { POS(2, 0), POS(0, 3) },
-      { POS(0, 3), POS(1, 3) },
-      { POS(1, 2), POS(1, 0) },
-      { POS(2, 3), POS(1, 2) },
-      { POS(3, 2), POS(1, 1) },
-      { POS(0, 1), POS(2, 2) },
-      { POS(1, 0), POS(2, 1) },
-      { POS(2, 1), POS(2, 3) },
-      { POS(3, 0), POS(2, 0) },
-      { POS(1, 3), POS(3, 0) },
-      { POS(2, 2), POS(3, 2) }
-   };
-
-   const GLfloat x = (GLfloat) winx;
-   const GLfloat y = (GLfloat) winy;
-   const GLfloat dx0 = v1[0] - v0[0];
-   const GLfloat dy0 = v1[1] - v0[1];
-   const GLfloat dx1 = v2[0] - v1[0];
-   const GLfloat dy1 = v2[1] - v1[1];
-   const GLfloat dx2 = v0[0] - v2[0];
-   const GLfloat dy2 = v0[1] - v2[1];
-   GLint stop = 4, i;
-   GLfloat insideCount = 16.0F;
-
-#ifdef DEBUG
-   {
-      const GLfloat area = dx0 * dy1 - dx1 * dy0;
-      ASSERT(area >= 0.0);
-   }
+   if (numSamples == 8)
+      return samples8;
+   else if (numSamples == 4)
+      return samples4;
+   else
+      return samples2;
+}
+
+
+/*
+ * The sample masks of partially covered pixels are computed with SSE2
+ * where available.
+ */
+#ifdef USE_SSE2_INTRIN
+static GLboolean UseSSE2 = GL_FALSE;
 #endif
 
-   for (i = 0; i < stop; i++) {
-      const GLfloat sx = x + samples[i][0];
-      const GLfloat sy = y + samples[i][1];
-      /* cross product determines if sample is inside or outside each edge */
-      GLfloat cross = (dx0 * (sy - v0[1]) - dy0 * (sx - v0[0]));
-      /* Check if the sample is exactly on an edge.  If so, let cross be a
-       * positive or negative value depending on the direction of the edge.
-       */
-      if (cross == 0.0F)
-         cross = dx0 + dy0;
-      if (cross < 0.0F) {
-         /* sample point is outside first edge */
-         insideCount -= 1.0F;
-         stop = 16;
-      }
-      else {
-         /* sample point is inside first edge */
-         cross = (dx1 * (sy - v1[1]) - dy1 * (sx - v1[0]));
-         if (cross == 0.0F)
-            cross = dx1 + dy1;
-         if (cross < 0.0F) {
-            /* sample point is outside second edge */
-            insideCount -= 1.0F;
-            stop = 16;
-         }
-         else {
-            /* sample point is inside first and second edges */
-            cross = (dx2 * (sy - v2[1]) -  dy2 * (sx - v2[0]));
-            if (cross == 0.0F)
-               cross = dx2 + dy2;
-            if (cross < 0.0F) {
-               /* sample point is outside third edge */
-               insideCount -= 1.0F;
-               stop = 16;
-            }
-         }
-      }
+
+/*
+ * One triangle edge.  The edge function is the cross product of the edge
+ * vector and the vector from the edge's first vertex to the sample, in
+ * 1/65536 pixel^2 units.  The vertices are in counter-clockwise order so
+ * samples with e >= 0 for all three edges are inside the triangle.  The
+ * values fit in 43 bits, so doubles hold them exactly.
+ */
+struct aa_edge {
+   GLdouble e;                  /* at the lower-left corner of pixel (x0,y0) */
+   GLdouble dedx, dedy;         /* per pixel step */
+   GLint offset[16];            /* per sample, relative to the corner */
+   GLint minOffset, maxOffset;
+};
+
+
+/*
+ * Set up an edge for the n sample positions pos[], n <= 16.  Fewer than
+ * 16 samples are padded with copies of the first one; the caller masks
+ * off the extra bits.
+ */
+static void
+setup_edge(struct aa_edge *edge, GLint ax, GLint ay, GLint bx, GLint by,
+           GLint x0, GLint y0, const GLint pos[][2], GLuint n)
+{
+   const GLint dx = bx - ax;
+   const GLint dy = by - ay;
+   /* A sample exactly on the edge is inside if dx + dy >= 0. */
+   const GLint bias = (dx + dy >= 0) ? 0 : 1;
+   GLuint i;
+
+   edge->e = (GLdouble) dx * (y0 * SUB_ONE - ay)
+           - (GLdouble) dy * (x0 * SUB_ONE - ax);
+   edge->dedx = (GLdouble) -dy * SUB_ONE;
+   edge->dedy = (GLdouble) dx * SUB_ONE;
+   for (i = 0; i < 16; i++) {
+      const GLint *p = pos[i < n ? i : 0];
+      const GLint off = dx * p[1] - dy * p[0] - bias;
+      edge->offset[i] = off;
+      if (i == 0 || off < edge->minOffset)
+         edge->minOffset = off;
+      if (i == 0 || off > edge->maxOffset)
+         edge->maxOffset = off;
    }
-   if (stop == 4)
-      return 1.0F;
-   else
-      return insideCount * (1.0F / 16.0F);
 }
 
 
+/*
+ * Narrow the pixel range [*start, *end) of a row to the pixels which may
+ * have samples inside the edge.  e is the edge function at pixel x0 of the
+ * row.  The range is made empty if no pixel does.  The result may include
+ * a pixel too many on either end, to allow for roundoff.
+ */
+static INLINE void
+clip_span_to_edge(const struct aa_edge *edge, GLdouble e, GLint x0,
+                  GLint *start, GLint *end)
+{
+   const GLdouble t = -(e + edge->maxOffset);
+   if (edge->dedx > 0.0) {
+      const GLdouble x = x0 + t / edge->dedx;
+      if (x >= *end)
+         *end = *start;
+      else if (x > *start)
+         *start = (GLint) x;
+   }
+   else if (edge->dedx < 0.0) {
+      const GLdouble x = x0 + t / edge->dedx + 2.0;
+      if (x <= *start)
+         *end = *start;
+      else if (x < *end)
+         *end = (GLint) x;
+   }
+   else if (t > 0.0) {
+      *end = *start;
+   }
+}
+
 
 /*
- * Compute how much (area) of the given pixel is inside the triangle.
- * Vertices MUST be specified in counter-clockwise order.
- * Return:  coverage in [0, 15].
+ * Mask of the samples which are inside an edge, for a pixel which is
+ * neither completely inside nor outside of it.
  */
-static GLint
-compute_coveragei(const GLfloat v0[3], const GLfloat v1[3],
-                  const GLfloat v2[3], GLint winx, GLint winy)
+static INLINE GLuint
+edge_mask(const struct aa_edge *edge, GLint e)
 {
-   /* NOTE: 15 samples instead of 16. */
-   static const GLfloat samples[15][2] = {
-      /* start with the four corners */
-      { POS(0, 2), POS(0, 0) },
-      { POS(3, 3), POS(0, 2) },
-      { POS(0, 0), POS(3, 1) },
-      { POS(3, 1), POS(3, 3) },
-      /* continue with interior samples */
-      { POS(1, 1), POS(0, 1) },
-      { POS(2, 0), POS(0, 3) },
-      { POS(0, 3), POS(1, 3) },
-      { POS(1, 2), POS(1, 0) },
-      { POS(2, 3), POS(1, 2) },
-      { POS(3, 2), POS(1, 1) },
-      { POS(0, 1), POS(2, 2) },
-      { POS(1, 0), POS(2, 1) },
-      { POS(2, 1), POS(2, 3) },
-      { POS(3, 0), POS(2, 0) },
-      { POS(1, 3), POS(3, 0) }
-   };
-   const GLfloat x = (GLfloat) winx;
-   const GLfloat y = (GLfloat) winy;
-   const GLfloat dx0 = v1[0] - v0[0];
-   const GLfloat dy0 = v1[1] - v0[1];
-   const GLfloat dx1 = v2[0] - v1[0];
-   const GLfloat dy1 = v2[1] - v1[1];
-   const GLfloat dx2 = v0[0] - v2[0];
-   const GLfloat dy2 = v0[1] - v2[1];
-   GLint stop = 4, i;
-   GLint insideCount = 15;
-
-#ifdef DEBUG
-   {
-      const GLfloat area = dx0 * dy1 - dx1 * dy0;
-      ASSERT(area >= 0.0);
+   GLuint mask = 0, i;
+   for (i = 0; i < 16; i++) {
+      if (edge->offset[i] + e >= 0)
+         mask |= 1 << i;
    }
+   return mask;
+}
+
+
+#ifdef USE_SSE2_INTRIN
+static INLINE SSE2_FUNC GLuint
+edge_mask_sse2(const struct aa_edge *edge, GLint e)
+{
+   const __m128i *off = (const __m128i *) edge->offset;
+   const __m128i t = _mm_set1_epi32(-e - 1);
+   const GLuint m0 = _mm_movemask_ps(_mm_castsi128_ps(
+                        _mm_cmpgt_epi32(_mm_loadu_si128(off + 0), t)));
+   const GLuint m1 = _mm_movemask_ps(_mm_castsi128_ps(
+                        _mm_cmpgt_epi32(_mm_loadu_si128(off + 1), t)));
+   const GLuint m2 = _mm_movemask_ps(_mm_castsi128_ps(
+                        _mm_cmpgt_epi32(_mm_loadu_si128(off + 2), t)));
+   const GLuint m3 = _mm_movemask_ps(_mm_castsi128_ps(
+                        _mm_cmpgt_epi32(_mm_loadu_si128(off + 3), t)));
+   return m0 | (m1 << 4) | (m2 << 8) | (m3 << 12);
+}
 #endif
 
-   for (i = 0; i < stop; i++) {
-      const GLfloat sx = x + samples[i][0];
-      const GLfloat sy = y + samples[i][1];
-      const GLfloat fx0 = sx - v0[0];
-      const GLfloat fy0 = sy - v0[1];
-      const GLfloat fx1 = sx - v1[0];
-      const GLfloat fy1 = sy - v1[1];
-      const GLfloat fx2 = sx - v2[0];
-      const GLfloat fy2 = sy - v2[1];
-      /* cross product determines if sample is inside or outside each edge */
-      GLfloat cross0 = (dx0 * fy0 - dy0 * fx0);
-      GLfloat cross1 = (dx1 * fy1 - dy1 * fx1);
-      GLfloat cross2 = (dx2 * fy2 - dy2 * fx2);
-      /* Check if the sample is exactly on an edge.  If so, let cross be a
-       * positive or negative value depending on the direction of the edge.
-       */
-      if (cross0 == 0.0F)
-         cross0 = dx0 + dy0;
-      if (cross1 == 0.0F)
-         cross1 = dx1 + dy1;
-      if (cross2 == 0.0F)
-         cross2 = dx2 + dy2;
-      if (cross0 < 0.0F || cross1 < 0.0F || cross2 < 0.0F) {
-         /* point is outside triangle */
-         insideCount--;
-         stop = 15;
-      }
+
+/*
+ * Return the mask of the samples of a pixel which are inside the triangle,
+ * given the edge functions at the pixel's lower-left corner.  Pixels
+ * entirely inside or outside of each edge don't test individual samples.
+ */
+static INLINE GLuint
+coverage_mask(const struct aa_edge edges[3], const GLdouble e[3])
+{
+   GLuint mask = 0xffff, i;
+   for (i = 0; i < 3; i++) {
+      if (e[i] + edges[i].minOffset >= 0.0)
+         continue;
+      if (e[i] + edges[i].maxOffset < 0.0)
+         return 0;
+#ifdef USE_SSE2_INTRIN
+      if (UseSSE2)
+         mask &= edge_mask_sse2(&edges[i], (GLint) e[i]);
+      else
+#endif
+         mask &= edge_mask(&edges[i], (GLint) e[i]);
    }
-   if (stop == 4)
-      return 15;
-   else
-      return insideCount;
+   return mask;
+}
+
+
+/*
+ * Number of bits set in a 16-bit mask.
+ */
+static INLINE GLuint
+bitcount16(GLuint m)
+{
+   m = m - ((m >> 1) & 0x5555);
+   m = (m & 0x3333) + ((m >> 2) & 0x3333);
+   m = (m + (m >> 4)) & 0x0f0f;
+   return (m + (m >> 8)) & 0x1f;
 }
 
 
@@ -365,6 +400,31 @@ index_aa_tri(GLcontext *ctx,
 }
 
 
+/*
+ * Set up the interpolation of the texcoords of unit u across a span
+ * from the planes of s, t, r and q (all divided by w), given the
+ * position (x,y) of the span's first fragment.
+ */
+static INLINE void
+span_texcoord_planes(struct sw_span *span, GLuint u, GLfloat x, GLfloat y,
+                     const GLfloat sPlane[4], const GLfloat tPlane[4],
+                     const GLfloat uPlane[4], const GLfloat vPlane[4])
+{
+   span->tex[u][0] = solve_plane(x, y, sPlane);
+   span->tex[u][1] = solve_plane(x, y, tPlane);
+   span->tex[u][2] = solve_plane(x, y, uPlane);
+   span->tex[u][3] = solve_plane(x, y, vPlane);
+   span->texStepX[u][0] = sPlane[0];
+   span->texStepX[u][1] = tPlane[0];
+   span->texStepX[u][2] = uPlane[0];
+   span->texStepX[u][3] = vPlane[0];
+   span->texStepY[u][0] = sPlane[1];
+   span->texStepY[u][1] = tPlane[1];
+   span->texStepY[u][2] = uPlane[1];
+   span->texStepY[u][3] = vPlane[1];
+}
+
+
 /*
  * Compute mipmap level of detail.
  * XXX we should really include the R coordinate in this computation
@@ -379,10 +439,10 @@ compute_lambda(const GLfloat sPlane[4], const GLfloat tPlane[4],
    const GLfloat t = solve_plane(cx, cy, tPlane);
    const GLfloat invQ_x1 = solve_plane_recip(cx+1.0F, cy, qPlane);
    const GLfloat invQ_y1 = solve_plane_recip(cx, cy+1.0F, qPlane);
-   const GLfloat s_x1 = s - sPlane[0] / sPlane[2];
-   const GLfloat s_y1 = s - sPlane[1] / sPlane[2];
-   const GLfloat t_x1 = t - tPlane[0] / tPlane[2];
-   const GLfloat t_y1 = t - tPlane[1] / tPlane[2];
+   const GLfloat s_x1 = s + sPlane[0];
+   const GLfloat s_y1 = s + sPlane[1];
+   const GLfloat t_x1 = t + tPlane[0];
+   const GLfloat t_y1 = t + tPlane[1];
    GLfloat dsdx = s_x1 * invQ_x1 - s * invQ;
    GLfloat dsdy = s_y1 * invQ_y1 - s * invQ;
    GLfloat dtdx = t_x1 * invQ_x1 - t * invQ;
@@ -457,6 +517,91 @@ spec_multitex_aa_tri(GLcontext *ctx,
 }
 
 
+static void
+rgba_ms_tri(GLcontext *ctx,
+	    const SWvertex *v0,
+	    const SWvertex *v1,
+	    const SWvertex *v2)
+{
+#define DO_Z
+#define DO_FOG
+#define DO_RGBA
+#define DO_MULTISAMPLE
+#include "s_aatritemp.h"
+}
+
+
+static void
+tex_ms_tri(GLcontext *ctx,
+	   const SWvertex *v0,
+	   const SWvertex *v1,
+	   const SWvertex *v2)
+{
+#define DO_Z
+#define DO_FOG
+#define DO_RGBA
+#define DO_TEX
+#define DO_MULTISAMPLE
+#include "s_aatritemp.h"
+}
+
+
+static void
+spec_tex_ms_tri(GLcontext *ctx,
+		const SWvertex *v0,
+		const SWvertex *v1,
+		const SWvertex *v2)
+{
+#define DO_Z
+#define DO_FOG
+#define DO_RGBA
+#define DO_TEX
+#define DO_SPEC
+#define DO_MULTISAMPLE
+#include "s_aatritemp.h"
+}
+
+
+static void
+multitex_ms_tri(GLcontext *ctx,
+		const SWvertex *v0,
+		const SWvertex *v1,
+		const SWvertex *v2)
+{
+#define DO_Z
+#define DO_FOG
+#define DO_RGBA
+#define DO_MULTITEX
+#define DO_MULTISAMPLE
+#include "s_aatritemp.h"
+}
+
+
+static void
+spec_multitex_ms_tri(GLcontext *ctx,
+		     const SWvertex *v0,
+		     const SWvertex *v1,
+		     const SWvertex *v2)
+{
+#define DO_Z
+#define DO_FOG
+#define DO_RGBA
+#define DO_MULTITEX
+#define DO_SPEC
+#define DO_MULTISAMPLE
+#include "s_aatritemp.h"
+}
+
+
+static void
+check_sse2(void)
+{
+#ifdef USE_SSE2_INTRIN
+   UseSSE2 = _mesa_have_sse2();
+#endif
+}
+
+
 /*
  * Examine GL state and set swrast->Triangle to an
  * appropriate antialiased triangle rasterizer function.
@@ -466,6 +611,8 @@ _swrast_set_aa_triangle_function(GLcontext *ctx)
 {
    ASSERT(ctx->Polygon.SmoothFlag);
 
+   check_sse2();
+
    if (ctx->Texture._EnabledCoordUnits != 0) {
       if (NEED_SECONDARY_COLOR(ctx)) {
          if (ctx->Texture._EnabledCoordUnits > 1) {
@@ -493,3 +640,42 @@ _swrast_set_aa_triangle_function(GLcontext *ctx)
 
    ASSERT(SWRAST_CONTEXT(ctx)->Triangle);
 }
+
+
+/*
+ * Examine GL state and set swrast->Triangle to an appropriate triangle
+ * rasterizer function for a multisample framebuffer (RGBA only).
+ */
+void
+_swrast_set_multisample_triangle_function(GLcontext *ctx)
+{
+   SWcontext *swrast = SWRAST_CONTEXT(ctx);
+
+   ASSERT(ctx->Multisample.Enabled);
+   ASSERT(swrast->_NumSamples > 1 && swrast->_NumSamples <= 8);
+   ASSERT(ctx->Visual.rgbMode);
+
+   check_sse2();
+
+   if (ctx->Texture._EnabledCoordUnits != 0) {
+      if (NEED_SECONDARY_COLOR(ctx)) {
+         if (ctx->Texture._EnabledCoordUnits > 1) {
+            swrast->Triangle = spec_multitex_ms_tri;
+         }
+         else {
+            swrast->Triangle = spec_tex_ms_tri;
+         }
+      }
+      else {
+         if (ctx->Texture._EnabledCoordUnits > 1) {
+            swrast->Triangle = multitex_ms_tri;
+         }
+         else {
+            swrast->Triangle = tex_ms_tri;
+         }
+      }
+   }
+   else {
+      swrast->Triangle = rgba_ms_tri;
+   }
+}
@@ -35,5 +35,8 @@
 extern void
 _swrast_set_aa_triangle_function(GLcontext *ctx);
 
+extern void
+_swrast_set_multisample_triangle_function(GLcontext *ctx);
+
 
 #endif
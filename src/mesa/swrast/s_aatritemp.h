@@ -27,8 +27,12 @@
  * Antialiased Triangle Rasterizer Template
  *
  * This file is #include'd to generate custom AA triangle rasterizers.
- * NOTE: this code hasn't been optimized yet.  That'll come after it
- * works correctly.
+ * The pixels of each row of the triangle's bounding box which may be
+ * covered are found from the edge functions, coverage is computed with
+ * coverage_mask() and the attributes are evaluated from their plane
+ * equations.  The multisample rasterizers use the same code with the
+ * multisample positions, and pass the sample masks on to the span code
+ * instead of a coverage value.
  *
  * The following macros may be defined to indicate what auxillary information
  * must be copmuted across the triangle:
@@ -38,19 +42,24 @@
  *    DO_SPEC      - if defined, compute specular RGB values
  *    DO_TEX       - if defined, compute unit 0 STRQ texcoords
  *    DO_MULTITEX  - if defined, compute all unit's STRQ texcoords
+ *    DO_MULTISAMPLE - if defined, compute sample masks for a multisample
+ *                   framebuffer instead of antialiasing coverage
  */
 
+#if defined(DO_MULTISAMPLE) && (defined(DO_TEX) || defined(DO_MULTITEX))
+/* the span code interpolates the texcoords and computes lambda */
+#define MS_TEX_INTERP
+#endif
+
 /*void triangle( GLcontext *ctx, GLuint v0, GLuint v1, GLuint v2, GLuint pv )*/
 {
    const GLfloat *p0 = v0->win;
    const GLfloat *p1 = v1->win;
    const GLfloat *p2 = v2->win;
-   const SWvertex *vMin, *vMid, *vMax;
-   GLint iyMin, iyMax;
-   GLfloat yMin, yMax;
-   GLboolean ltor;
-   GLfloat majDx, majDy;  /* major (i.e. long) edge dx and dy */
-   
+   struct gl_framebuffer *fb = ctx->DrawBuffer;
+   struct aa_edge edges[3];
+   GLint ixMin, ixMax, iyMin, iyMax, iy;
+
    struct sw_span span;
    
 #ifdef DO_Z
@@ -72,60 +81,81 @@
 #endif
 #ifdef DO_TEX
    GLfloat sPlane[4], tPlane[4], uPlane[4], vPlane[4];
+#ifndef MS_TEX_INTERP
    GLfloat texWidth, texHeight;
+#endif
 #elif defined(DO_MULTITEX)
    GLfloat sPlane[MAX_TEXTURE_COORD_UNITS][4];  /* texture S */
    GLfloat tPlane[MAX_TEXTURE_COORD_UNITS][4];  /* texture T */
    GLfloat uPlane[MAX_TEXTURE_COORD_UNITS][4];  /* texture R */
    GLfloat vPlane[MAX_TEXTURE_COORD_UNITS][4];  /* texture Q */
+#ifndef MS_TEX_INTERP
    GLfloat texWidth[MAX_TEXTURE_COORD_UNITS];
    GLfloat texHeight[MAX_TEXTURE_COORD_UNITS];
+#endif
+#endif
+#ifdef MS_TEX_INTERP
+   GLfloat wPlane[4];
 #endif
    GLfloat bf = SWRAST_CONTEXT(ctx)->_BackfaceSign;
-   
-   
+#ifdef DO_MULTISAMPLE
+   const GLuint numSamples = SWRAST_CONTEXT(ctx)->_NumSamples;
+   const GLint (*pos)[2] = multisample_positions(numSamples);
+   const GLuint allSamples = (1 << numSamples) - 1;
+
+   INIT_SPAN(span, GL_POLYGON, 0, 0, SPAN_SAMPLES);
+#else
+   const GLuint numSamples = 16;
+   const GLint (*pos)[2] = samples;
+
    INIT_SPAN(span, GL_POLYGON, 0, 0, SPAN_COVERAGE);
+#endif
 
-   /* determine bottom to top order of vertices */
+   /* Do backface culling */
    {
-      GLfloat y0 = v0->win[1];
-      GLfloat y1 = v1->win[1];
-      GLfloat y2 = v2->win[1];
-      if (y0 <= y1) {
-	 if (y1 <= y2) {
-	    vMin = v0;   vMid = v1;   vMax = v2;   /* y0<=y1<=y2 */
-	 }
-	 else if (y2 <= y0) {
-	    vMin = v2;   vMid = v0;   vMax = v1;   /* y2<=y0<=y1 */
-	 }
-	 else {
-	    vMin = v0;   vMid = v2;   vMax = v1;  bf = -bf; /* y0<=y2<=y1 */
-	 }
-      }
-      else {
-	 if (y0 <= y2) {
-	    vMin = v1;   vMid = v0;   vMax = v2;  bf = -bf; /* y1<=y0<=y2 */
-	 }
-	 else if (y2 <= y1) {
-	    vMin = v2;   vMid = v1;   vMax = v0;  bf = -bf; /* y2<=y1<=y0 */
-	 }
-	 else {
-	    vMin = v1;   vMid = v2;   vMax = v0;   /* y1<=y2<=y0 */
-	 }
-      }
+      const GLfloat area = (p1[0] - p0[0]) * (p2[1] - p0[1])
+                         - (p2[0] - p0[0]) * (p1[1] - p0[1]);
+      if (area * bf > 0 || area == 0 || IS_INF_OR_NAN(area))
+	 return;
    }
 
-   majDx = vMax->win[0] - vMin->win[0];
-   majDy = vMax->win[1] - vMin->win[1];
-
+   /* Edge function setup in fixed point, with the vertices in
+    * counter-clockwise order, and the bounding box of the triangle
+    * clipped to the framebuffer.
+    */
    {
-      const GLfloat botDx = vMid->win[0] - vMin->win[0];
-      const GLfloat botDy = vMid->win[1] - vMin->win[1];
-      const GLfloat area = majDx * botDy - botDx * majDy;
-      /* Do backface culling */
-      if (area * bf < 0 || area == 0 || IS_INF_OR_NAN(area))
-	 return;
-      ltor = (GLboolean) (area < 0.0F);
+      GLint x[3], y[3];
+      GLdouble area;
+      x[0] = IROUND(p0[0] * SUB_ONE);  y[0] = IROUND(p0[1] * SUB_ONE);
+      x[1] = IROUND(p1[0] * SUB_ONE);  y[1] = IROUND(p1[1] * SUB_ONE);
+      x[2] = IROUND(p2[0] * SUB_ONE);  y[2] = IROUND(p2[1] * SUB_ONE);
+      area = (GLdouble) (x[1] - x[0]) * (y[2] - y[0])
+           - (GLdouble) (x[2] - x[0]) * (y[1] - y[0]);
+      if (area == 0.0)
+         return;
+      if (area < 0.0) {
+         GLint tmp;
+         tmp = x[1];  x[1] = x[2];  x[2] = tmp;
+         tmp = y[1];  y[1] = y[2];  y[2] = tmp;
+      }
+
+      ixMin = MIN2(MIN2(x[0], x[1]), x[2]) >> SUB_BITS;
+      ixMax = (MAX2(MAX2(x[0], x[1]), x[2]) >> SUB_BITS) + 1;
+      iyMin = MIN2(MIN2(y[0], y[1]), y[2]) >> SUB_BITS;
+      iyMax = (MAX2(MAX2(y[0], y[1]), y[2]) >> SUB_BITS) + 1;
+      ixMin = MAX2(ixMin, fb->_Xmin);
+      ixMax = MIN2(ixMax, fb->_Xmax);
+      iyMin = MAX2(iyMin, fb->_Ymin);
+      iyMax = MIN2(iyMax, fb->_Ymax);
+      if (ixMin >= ixMax || iyMin >= iyMax)
+         return;
+
+      setup_edge(&edges[0], x[0], y[0], x[1], y[1], ixMin, iyMin,
+                 pos, numSamples);
+      setup_edge(&edges[1], x[1], y[1], x[2], y[2], ixMin, iyMin,
+                 pos, numSamples);
+      setup_edge(&edges[2], x[2], y[2], x[0], y[0], ixMin, iyMin,
+                 pos, numSamples);
    }
 
 #ifndef DO_OCCLUSION_TEST
@@ -134,12 +164,22 @@
 
    /* Plane equation setup:
     * We evaluate plane equations at window (x,y) coordinates in order
-    * to compute color, Z, fog, texcoords, etc.  This isn't terribly
-    * efficient but it's easy and reliable.
+    * to compute color, Z, fog, texcoords, etc.  The planes are normalized
+    * so each evaluation is just two multiply-adds.
     */
 #ifdef DO_Z
    compute_plane(p0, p1, p2, p0[2], p1[2], p2[2], zPlane);
    span.arrayMask |= SPAN_Z;
+#ifdef DO_MULTISAMPLE
+   {
+      /* Z of each sample relative to the pixel center */
+      GLuint s;
+      for (s = 0; s < numSamples; s++) {
+         span.sampleZ[s] = zPlane[0] * ((pos[s][0] - SUB_ONE / 2) * (1.0F / SUB_ONE))
+                         + zPlane[1] * ((pos[s][1] - SUB_ONE / 2) * (1.0F / SUB_ONE));
+      }
+   }
+#endif
 #endif
 #ifdef DO_FOG
    compute_plane(p0, p1, p2, v0->fog, v1->fog, v2->fog, fogPlane);
@@ -185,8 +225,10 @@
 #endif
 #ifdef DO_TEX
    {
+#ifndef MS_TEX_INTERP
       const struct gl_texture_object *obj = ctx->Texture.Unit[0]._Current;
       const struct gl_texture_image *texImage = obj->Image[0][obj->BaseLevel];
+#endif
       const GLfloat invW0 = v0->win[3];
       const GLfloat invW1 = v1->win[3];
       const GLfloat invW2 = v2->win[3];
@@ -206,17 +248,23 @@
       compute_plane(p0, p1, p2, t0, t1, t2, tPlane);
       compute_plane(p0, p1, p2, r0, r1, r2, uPlane);
       compute_plane(p0, p1, p2, q0, q1, q2, vPlane);
+#ifndef MS_TEX_INTERP
       texWidth = (GLfloat) texImage->Width;
       texHeight = (GLfloat) texImage->Height;
+#endif
    }
+#ifndef MS_TEX_INTERP
    span.arrayMask |= (SPAN_TEXTURE | SPAN_LAMBDA);
+#endif
 #elif defined(DO_MULTITEX)
    {
       GLuint u;
       for (u = 0; u < ctx->Const.MaxTextureUnits; u++) {
          if (ctx->Texture.Unit[u]._ReallyEnabled) {
+#ifndef MS_TEX_INTERP
             const struct gl_texture_object *obj = ctx->Texture.Unit[u]._Current;
             const struct gl_texture_image *texImage = obj->Image[0][obj->BaseLevel];
+#endif
             const GLfloat invW0 = v0->win[3];
             const GLfloat invW1 = v1->win[3];
             const GLfloat invW2 = v2->win[3];
@@ -236,281 +284,155 @@
             compute_plane(p0, p1, p2, t0, t1, t2, tPlane[u]);
             compute_plane(p0, p1, p2, r0, r1, r2, uPlane[u]);
             compute_plane(p0, p1, p2, q0, q1, q2, vPlane[u]);
+#ifndef MS_TEX_INTERP
             texWidth[u]  = (GLfloat) texImage->Width;
             texHeight[u] = (GLfloat) texImage->Height;
+#endif
          }
       }
    }
+#ifndef MS_TEX_INTERP
    span.arrayMask |= (SPAN_TEXTURE | SPAN_LAMBDA);
 #endif
+#endif
+#ifdef MS_TEX_INTERP
+   compute_plane(p0, p1, p2, p0[3], p1[3], p2[3], wPlane);
+   span.dwdx = wPlane[0];
+   span.dwdy = wPlane[1];
+#endif
 
-   /* Begin bottom-to-top scan over the triangle.
-    * The long edge will either be on the left or right side of the
-    * triangle.  We always scan from the long edge toward the shorter
-    * edges, stopping when we find that coverage = 0.  If the long edge
-    * is on the left we scan left-to-right.  Else, we scan right-to-left.
+   /* Scan the rows bottom to top.  Each row is written as one span, or
+    * more if it has uncovered pixels between covered ones.
     */
-   yMin = vMin->win[1];
-   yMax = vMax->win[1];
-   iyMin = (GLint) yMin;
-   iyMax = (GLint) yMax + 1;
+   for (iy = iyMin; iy < iyMax; iy++) {
+      const GLfloat cy = iy + 0.5F;
+      GLdouble e[3];
+      GLint ix, startX = ixMin, endX = ixMax;
+      GLuint count, i;
+
+      for (i = 0; i < 3; i++) {
+         e[i] = edges[i].e + (iy - iyMin) * edges[i].dedy;
+         clip_span_to_edge(&edges[i], e[i], ixMin, &startX, &endX);
+      }
+      if (startX >= endX)
+         continue;
+      for (i = 0; i < 3; i++)
+         e[i] += (startX - ixMin) * edges[i].dedx;
 
-   if (ltor) {
-      /* scan left to right */
-      const GLfloat *pMin = vMin->win;
-      const GLfloat *pMid = vMid->win;
-      const GLfloat *pMax = vMax->win;
-      const GLfloat dxdy = majDx / majDy;
-      const GLfloat xAdj = dxdy < 0.0F ? -dxdy : 0.0F;
-      GLfloat x = pMin[0] - (yMin - iyMin) * dxdy;
-      GLint iy;
-      for (iy = iyMin; iy < iyMax; iy++, x += dxdy) {
-         GLint ix, startX = (GLint) (x - xAdj);
-         GLuint count;
-         GLfloat coverage = 0.0F;
+      count = 0;
+      for (ix = startX; ix <= endX; ix++) {
+         /* (cx,cy) = center of fragment */
+         const GLfloat cx = ix + 0.5F;
+         struct span_arrays *array = span.array;
+         GLuint mask = 0;
 
-         /* skip over fragments with zero coverage */
-         while (startX < MAX_WIDTH) {
-            coverage = compute_coveragef(pMin, pMid, pMax, startX, iy);
-            if (coverage > 0.0F)
-               break;
-            startX++;
+         if (ix < endX) {
+            mask = coverage_mask(edges, e);
+#ifdef DO_MULTISAMPLE
+            mask &= allSamples;
+#endif
+            e[0] += edges[0].dedx;
+            e[1] += edges[1].dedx;
+            e[2] += edges[2].dedx;
          }
 
-         /* enter interior of triangle */
-         ix = startX;
-         count = 0;
-         while (coverage > 0.0F) {
-            /* (cx,cy) = center of fragment */
-            const GLfloat cx = ix + 0.5F, cy = iy + 0.5F;
-            struct span_arrays *array = span.array;
-#ifdef DO_INDEX
-            array->coverage[count] = (GLfloat) compute_coveragei(pMin, pMid, pMax, ix, iy);
-#else
-            array->coverage[count] = coverage;
-#endif
-#ifdef DO_Z
-            array->z[count] = (GLdepth) IROUND(solve_plane(cx, cy, zPlane));
-#endif
-#ifdef DO_FOG
-	    array->fog[count] = solve_plane(cx, cy, fogPlane);
-#endif
-#ifdef DO_RGBA
-            array->rgba[count][RCOMP] = solve_plane_chan(cx, cy, rPlane);
-            array->rgba[count][GCOMP] = solve_plane_chan(cx, cy, gPlane);
-            array->rgba[count][BCOMP] = solve_plane_chan(cx, cy, bPlane);
-            array->rgba[count][ACOMP] = solve_plane_chan(cx, cy, aPlane);
-#endif
-#ifdef DO_INDEX
-            array->index[count] = (GLint) solve_plane(cx, cy, iPlane);
-#endif
-#ifdef DO_SPEC
-            array->spec[count][RCOMP] = solve_plane_chan(cx, cy, srPlane);
-            array->spec[count][GCOMP] = solve_plane_chan(cx, cy, sgPlane);
-            array->spec[count][BCOMP] = solve_plane_chan(cx, cy, sbPlane);
-#endif
+         if (mask == 0) {
+            if (count > 0) {
+               span.x = ix - count;
+               span.y = iy;
+               span.end = count;
+#ifdef MS_TEX_INTERP
+               {
+                  /* start values at the first fragment's center */
+                  const GLfloat x0 = span.x + 0.5F;
 #ifdef DO_TEX
-            {
-               const GLfloat invQ = solve_plane_recip(cx, cy, vPlane);
-               array->texcoords[0][count][0] = solve_plane(cx, cy, sPlane) * invQ;
-               array->texcoords[0][count][1] = solve_plane(cx, cy, tPlane) * invQ;
-               array->texcoords[0][count][2] = solve_plane(cx, cy, uPlane) * invQ;
-               array->lambda[0][count] = compute_lambda(sPlane, tPlane, vPlane,
-                                                      cx, cy, invQ,
-                                                      texWidth, texHeight);
-            }
-#elif defined(DO_MULTITEX)
-            {
-               GLuint unit;
-               for (unit = 0; unit < ctx->Const.MaxTextureUnits; unit++) {
-                  if (ctx->Texture.Unit[unit]._ReallyEnabled) {
-                     GLfloat invQ = solve_plane_recip(cx, cy, vPlane[unit]);
-                     array->texcoords[unit][count][0] = solve_plane(cx, cy, sPlane[unit]) * invQ;
-                     array->texcoords[unit][count][1] = solve_plane(cx, cy, tPlane[unit]) * invQ;
-                     array->texcoords[unit][count][2] = solve_plane(cx, cy, uPlane[unit]) * invQ;
-                     array->lambda[unit][count] = compute_lambda(sPlane[unit],
-                                      tPlane[unit], vPlane[unit], cx, cy, invQ,
-                                      texWidth[unit], texHeight[unit]);
+                  span_texcoord_planes(&span, 0, x0, cy,
+                                       sPlane, tPlane, uPlane, vPlane);
+#else
+                  GLuint u;
+                  for (u = 0; u < ctx->Const.MaxTextureUnits; u++) {
+                     if (ctx->Texture.Unit[u]._ReallyEnabled) {
+                        span_texcoord_planes(&span, u, x0, cy, sPlane[u],
+                                             tPlane[u], uPlane[u], vPlane[u]);
+                     }
                   }
+#endif
+                  span.w = solve_plane(x0, cy, wPlane);
+                  span.interpMask = SPAN_TEXTURE;
                }
-            }
+#else
+               ASSERT(span.interpMask == 0);
 #endif
-            ix++;
-            count++;
-            coverage = compute_coveragef(pMin, pMid, pMax, ix, iy);
-         }
-         
-         if (ix <= startX)
-            continue;
-         
-         span.x = startX;
-         span.y = iy;
-         span.end = (GLuint) ix - (GLuint) startX;
-         ASSERT(span.interpMask == 0);
 #if defined(DO_RGBA)
-         _swrast_write_rgba_span(ctx, &span);
+               _swrast_write_rgba_span(ctx, &span);
 #else
-         _swrast_write_index_span(ctx, &span);
+               _swrast_write_index_span(ctx, &span);
 #endif
-      }
-   }
-   else {
-      /* scan right to left */
-      const GLfloat *pMin = vMin->win;
-      const GLfloat *pMid = vMid->win;
-      const GLfloat *pMax = vMax->win;
-      const GLfloat dxdy = majDx / majDy;
-      const GLfloat xAdj = dxdy > 0 ? dxdy : 0.0F;
-      GLfloat x = pMin[0] - (yMin - iyMin) * dxdy;
-      GLint iy;
-      for (iy = iyMin; iy < iyMax; iy++, x += dxdy) {
-         GLint ix, left, startX = (GLint) (x + xAdj);
-         GLuint count, n;
-         GLfloat coverage = 0.0F;
-         
-         /* make sure we're not past the window edge */
-         if (startX >= ctx->DrawBuffer->_Xmax) {
-            startX = ctx->DrawBuffer->_Xmax - 1;
+               count = 0;
+            }
+            continue;
          }
 
-         /* skip fragments with zero coverage */
-         while (startX >= 0) {
-            coverage = compute_coveragef(pMin, pMax, pMid, startX, iy);
-            if (coverage > 0.0F)
-               break;
-            startX--;
-         }
-         
-         /* enter interior of triangle */
-         ix = startX;
-         count = 0;
-         while (coverage > 0.0F) {
-            /* (cx,cy) = center of fragment */
-            const GLfloat cx = ix + 0.5F, cy = iy + 0.5F;
-            struct span_arrays *array = span.array;
-#ifdef DO_INDEX
-            array->coverage[ix] = (GLfloat) compute_coveragei(pMin, pMax, pMid, ix, iy);
+#if defined(DO_MULTISAMPLE)
+         array->samples[count] = (GLubyte) mask;
+#elif defined(DO_INDEX)
+         /* coverage in [0, 15] from the first 15 samples */
+         array->coverage[count] = (GLfloat) bitcount16(mask & 0x7fff);
 #else
-            array->coverage[ix] = coverage;
+         if (mask == 0xffff)
+            array->coverage[count] = 1.0F;
+         else
+            array->coverage[count] = bitcount16(mask) * (1.0F / 16.0F);
 #endif
 #ifdef DO_Z
-            array->z[ix] = (GLdepth) IROUND(solve_plane(cx, cy, zPlane));
+         array->z[count] = (GLdepth) IROUND(solve_plane(cx, cy, zPlane));
 #endif
 #ifdef DO_FOG
-            array->fog[ix] = solve_plane(cx, cy, fogPlane);
+         array->fog[count] = solve_plane(cx, cy, fogPlane);
 #endif
 #ifdef DO_RGBA
-            array->rgba[ix][RCOMP] = solve_plane_chan(cx, cy, rPlane);
-            array->rgba[ix][GCOMP] = solve_plane_chan(cx, cy, gPlane);
-            array->rgba[ix][BCOMP] = solve_plane_chan(cx, cy, bPlane);
-            array->rgba[ix][ACOMP] = solve_plane_chan(cx, cy, aPlane);
+         array->rgba[count][RCOMP] = solve_plane_chan(cx, cy, rPlane);
+         array->rgba[count][GCOMP] = solve_plane_chan(cx, cy, gPlane);
+         array->rgba[count][BCOMP] = solve_plane_chan(cx, cy, bPlane);
+         array->rgba[count][ACOMP] = solve_plane_chan(cx, cy, aPlane);
 #endif
 #ifdef DO_INDEX
-            array->index[ix] = (GLint) solve_plane(cx, cy, iPlane);
+         array->index[count] = (GLint) solve_plane(cx, cy, iPlane);
 #endif
 #ifdef DO_SPEC
-            array->spec[ix][RCOMP] = solve_plane_chan(cx, cy, srPlane);
-            array->spec[ix][GCOMP] = solve_plane_chan(cx, cy, sgPlane);
-            array->spec[ix][BCOMP] = solve_plane_chan(cx, cy, sbPlane);
+         array->spec[count][RCOMP] = solve_plane_chan(cx, cy, srPlane);
+         array->spec[count][GCOMP] = solve_plane_chan(cx, cy, sgPlane);
+         array->spec[count][BCOMP] = solve_plane_chan(cx, cy, sbPlane);
 #endif
-#ifdef DO_TEX
-            {
-               const GLfloat invQ = solve_plane_recip(cx, cy, vPlane);
-               array->texcoords[0][ix][0] = solve_plane(cx, cy, sPlane) * invQ;
-               array->texcoords[0][ix][1] = solve_plane(cx, cy, tPlane) * invQ;
-               array->texcoords[0][ix][2] = solve_plane(cx, cy, uPlane) * invQ;
-               array->lambda[0][ix] = compute_lambda(sPlane, tPlane, vPlane,
-                                          cx, cy, invQ, texWidth, texHeight);
-            }
-#elif defined(DO_MULTITEX)
-            {
-               GLuint unit;
-               for (unit = 0; unit < ctx->Const.MaxTextureUnits; unit++) {
-                  if (ctx->Texture.Unit[unit]._ReallyEnabled) {
-                     GLfloat invQ = solve_plane_recip(cx, cy, vPlane[unit]);
-                     array->texcoords[unit][ix][0] = solve_plane(cx, cy, sPlane[unit]) * invQ;
-                     array->texcoords[unit][ix][1] = solve_plane(cx, cy, tPlane[unit]) * invQ;
-                     array->texcoords[unit][ix][2] = solve_plane(cx, cy, uPlane[unit]) * invQ;
-                     array->lambda[unit][ix] = compute_lambda(sPlane[unit],
-                                                            tPlane[unit],
-                                                            vPlane[unit],
-                                                            cx, cy, invQ,
-                                                            texWidth[unit],
-                                                            texHeight[unit]);
-                  }
-               }
-            }
-#endif
-            ix--;
-            count++;
-            coverage = compute_coveragef(pMin, pMax, pMid, ix, iy);
-         }
-         
-         if (startX <= ix)
-            continue;
-
-         n = (GLuint) startX - (GLuint) ix;
-
-         left = ix + 1;
-
-         /* shift all values to the left */
-         /* XXX this is temporary */
+#if defined(MS_TEX_INTERP)
+         /* texcoords are interpolated by the span code */
+#elif defined(DO_TEX)
          {
-            struct span_arrays *array = span.array;
-            GLint j;
-            for (j = 0; j < (GLint) n; j++) {
-#ifdef DO_RGBA
-               COPY_CHAN4(array->rgba[j], array->rgba[j + left]);
-#endif
-#ifdef DO_SPEC
-               COPY_CHAN4(array->spec[j], array->spec[j + left]);
-#endif
-#ifdef DO_INDEX
-               array->index[j] = array->index[j + left];
-#endif
-#ifdef DO_Z
-               array->z[j] = array->z[j + left];
-#endif
-#ifdef DO_FOG
-               array->fog[j] = array->fog[j + left];
-#endif
-#ifdef DO_TEX
-               COPY_4V(array->texcoords[0][j], array->texcoords[0][j + left]);
-#endif
-#if defined(DO_MULTITEX) || defined(DO_TEX)
-               array->lambda[0][j] = array->lambda[0][j + left];
-#endif
-               array->coverage[j] = array->coverage[j + left];
-            }
+            const GLfloat invQ = solve_plane_recip(cx, cy, vPlane);
+            array->texcoords[0][count][0] = solve_plane(cx, cy, sPlane) * invQ;
+            array->texcoords[0][count][1] = solve_plane(cx, cy, tPlane) * invQ;
+            array->texcoords[0][count][2] = solve_plane(cx, cy, uPlane) * invQ;
+            array->lambda[0][count] = compute_lambda(sPlane, tPlane, vPlane,
+                                                   cx, cy, invQ,
+                                                   texWidth, texHeight);
          }
-#ifdef DO_MULTITEX
-         /* shift texcoords */
+#elif defined(DO_MULTITEX)
          {
-            struct span_arrays *array = span.array;
             GLuint unit;
             for (unit = 0; unit < ctx->Const.MaxTextureUnits; unit++) {
                if (ctx->Texture.Unit[unit]._ReallyEnabled) {
-                  GLint j;
-                  for (j = 0; j < (GLint) n; j++) {
-		     array->texcoords[unit][j][0] = array->texcoords[unit][j + left][0];
-                     array->texcoords[unit][j][1] = array->texcoords[unit][j + left][1];
-                     array->texcoords[unit][j][2] = array->texcoords[unit][j + left][2];
-                     array->lambda[unit][j] = array->lambda[unit][j + left];
-                  }
+                  GLfloat invQ = solve_plane_recip(cx, cy, vPlane[unit]);
+                  array->texcoords[unit][count][0] = solve_plane(cx, cy, sPlane[unit]) * invQ;
+                  array->texcoords[unit][count][1] = solve_plane(cx, cy, tPlane[unit]) * invQ;
+                  array->texcoords[unit][count][2] = solve_plane(cx, cy, uPlane[unit]) * invQ;
+                  array->lambda[unit][count] = compute_lambda(sPlane[unit],
+                                   tPlane[unit], vPlane[unit], cx, cy, invQ,
+                                   texWidth[unit], texHeight[unit]);
                }
             }
          }
 #endif
-
-         span.x = left;
-         span.y = iy;
-         span.end = n;
-         ASSERT(span.interpMask == 0);
-#if defined(DO_RGBA)
-         _swrast_write_rgba_span(ctx, &span);
-#else
-         _swrast_write_index_span(ctx, &span);
-#endif
+         count++;
       }
    }
 }
@@ -544,6 +466,14 @@
 #undef DO_MULTITEX
 #endif
 
+#ifdef DO_MULTISAMPLE
+#undef DO_MULTISAMPLE
+#endif
+
+#ifdef MS_TEX_INTERP
+#undef MS_TEX_INTERP
+#endif
+
 #ifdef DO_OCCLUSION_TEST
 #undef DO_OCCLUSION_TEST
 #endif
@@ -31,8 +31,11 @@
 
 #include "s_accum.h"
 #include "s_context.h"
+#include "s_lazyclear.h"
 #include "s_masking.h"
 #include "s_span.h"
+#include "s_tribin.h"
+#include "x86/common_x86_sse2.h"
 
 
 #define ACCUM_SCALE16 32767.0
@@ -70,49 +73,452 @@
 #endif
 
 
+/*
+ * Row functions.  They work on n accum buffer values (four per pixel) or
+ * on n pixels, as noted.
+ */
+#if defined(USE_SSE2_INTRIN) && CHAN_BITS == 8
+#define USE_SSE2_ACCUM
+#endif
+
+
+typedef void (*accum_scale_func)( GLuint n, GLshort acc[], GLfloat scale );
+typedef void (*accum_add_func)( GLuint n, GLshort acc[], GLshort incr );
+typedef void (*accum_color_func)( GLuint n, GLshort acc[],
+                                  CONST GLchan rgba[][4], GLfloat scale );
+typedef void (*accum_return_func)( GLuint n, const GLshort acc[],
+                                   GLchan rgba[][4], GLfloat scale );
+
+
+/** acc = acc * scale, for n values */
+static void
+scale_row( GLuint n, GLshort acc[], GLfloat scale )
+{
+   GLuint i;
+   for (i = 0; i < n; i++) {
+      acc[i] = (GLshort) (acc[i] * scale);
+   }
+}
+
+
+/** acc = acc + incr, for n values */
+static void
+add_row( GLuint n, GLshort acc[], GLshort incr )
+{
+   GLuint i;
+   for (i = 0; i < n; i++) {
+      acc[i] += incr;
+   }
+}
+
+
+/** Add the unscaled colors of n pixels (optimized accum mode) */
+static void
+accum_row( GLuint n, GLshort acc[], CONST GLchan rgba[][4], GLfloat scale )
+{
+   GLuint j;
+   (void) scale;
+   for (j = 0; j < n; j++) {
+      acc[j * 4 + 0] += rgba[j][RCOMP];
+      acc[j * 4 + 1] += rgba[j][GCOMP];
+      acc[j * 4 + 2] += rgba[j][BCOMP];
+      acc[j * 4 + 3] += rgba[j][ACOMP];
+   }
+}
+
+
+/** Add the scaled colors of n pixels */
+static void
+accum_row_scaled( GLuint n, GLshort acc[], CONST GLchan rgba[][4],
+                  GLfloat scale )
+{
+   GLuint j;
+   for (j = 0; j < n; j++) {
+      acc[j * 4 + 0] += (GLshort) ((GLfloat) rgba[j][RCOMP] * scale);
+      acc[j * 4 + 1] += (GLshort) ((GLfloat) rgba[j][GCOMP] * scale);
+      acc[j * 4 + 2] += (GLshort) ((GLfloat) rgba[j][BCOMP] * scale);
+      acc[j * 4 + 3] += (GLshort) ((GLfloat) rgba[j][ACOMP] * scale);
+   }
+}
+
+
+/** Load the unscaled colors of n pixels (optimized accum mode) */
+static void
+load_row( GLuint n, GLshort acc[], CONST GLchan rgba[][4], GLfloat scale )
+{
+   GLuint j;
+   (void) scale;
+   for (j = 0; j < n; j++) {
+      acc[j * 4 + 0] = rgba[j][RCOMP];
+      acc[j * 4 + 1] = rgba[j][GCOMP];
+      acc[j * 4 + 2] = rgba[j][BCOMP];
+      acc[j * 4 + 3] = rgba[j][ACOMP];
+   }
+}
+
+
+/** Load the scaled colors of n pixels */
+static void
+load_row_scaled( GLuint n, GLshort acc[], CONST GLchan rgba[][4],
+                 GLfloat scale )
+{
+   GLuint j;
+   for (j = 0; j < n; j++) {
+      acc[j * 4 + 0] = (GLshort) ((GLfloat) rgba[j][RCOMP] * scale);
+      acc[j * 4 + 1] = (GLshort) ((GLfloat) rgba[j][GCOMP] * scale);
+      acc[j * 4 + 2] = (GLshort) ((GLfloat) rgba[j][BCOMP] * scale);
+      acc[j * 4 + 3] = (GLshort) ((GLfloat) rgba[j][ACOMP] * scale);
+   }
+}
+
+
+/** Compute the colors of n pixels from scaled accum values */
+static void
+return_row_scaled( GLuint n, const GLshort acc[], GLchan rgba[][4],
+                   GLfloat scale )
+{
+   GLuint j;
+   for (j = 0; j < n; j++) {
+      GLint r = IROUND( (GLfloat) (acc[j * 4 + 0]) * scale );
+      GLint g = IROUND( (GLfloat) (acc[j * 4 + 1]) * scale );
+      GLint b = IROUND( (GLfloat) (acc[j * 4 + 2]) * scale );
+      GLint a = IROUND( (GLfloat) (acc[j * 4 + 3]) * scale );
+      rgba[j][RCOMP] = CLAMP( r, 0, CHAN_MAX );
+      rgba[j][GCOMP] = CLAMP( g, 0, CHAN_MAX );
+      rgba[j][BCOMP] = CLAMP( b, 0, CHAN_MAX );
+      rgba[j][ACOMP] = CLAMP( a, 0, CHAN_MAX );
+   }
+}
+
+
+#ifdef USE_SSE2_ACCUM
+
+/*
+ * Round to nearest like IROUND().  That's the FPU's rounding mode on x86
+ * and adding 0.5 and truncating elsewhere; only negative values, which
+ * get clamped to zero anyway, round differently.
+ */
+#if defined(USE_X86_ASM) && defined(__i386__)
+#define IROUND_PS(F)  _mm_cvtps_epi32(F)
+#else
+#define IROUND_PS(F)  _mm_cvttps_epi32(_mm_add_ps(F, _mm_set1_ps(0.5F)))
+#endif
+
+
+/**
+ * Pack eight 32-bit integers to 16 bits, keeping the low 16 bits of each
+ * like a GLshort cast does.
+ */
+static INLINE SSE2_FUNC __m128i
+pack_shorts( __m128i lo, __m128i hi )
+{
+   lo = _mm_srai_epi32(_mm_slli_epi32(lo, 16), 16);
+   hi = _mm_srai_epi32(_mm_slli_epi32(hi, 16), 16);
+   return _mm_packs_epi32(lo, hi);
+}
+
+
+/** (GLshort) (x * scale) for eight shorts */
+static INLINE SSE2_FUNC __m128i
+scale_shorts( __m128i x, __m128 scale )
+{
+   const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+   const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+   return pack_shorts(_mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(lo), scale)),
+                      _mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(hi), scale)));
+}
+
+
+/** IROUND(x * scale) for eight shorts, saturated to 16 bits */
+static INLINE SSE2_FUNC __m128i
+round_shorts( __m128i x, __m128 scale )
+{
+   const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+   const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+   return _mm_packs_epi32(IROUND_PS(_mm_mul_ps(_mm_cvtepi32_ps(lo), scale)),
+                          IROUND_PS(_mm_mul_ps(_mm_cvtepi32_ps(hi), scale)));
+}
+
+
+static SSE2_FUNC void
+scale_row_sse2( GLuint n, GLshort acc[], GLfloat scale )
+{
+   const __m128 s = _mm_set1_ps(scale);
+   GLuint i;
+
+   for (i = 0; i + 8 <= n; i += 8) {
+      const __m128i a = _mm_loadu_si128((const __m128i *) (acc + i));
+      _mm_storeu_si128((__m128i *) (acc + i), scale_shorts(a, s));
+   }
+   scale_row(n - i, acc + i, scale);
+}
+
+
+static SSE2_FUNC void
+add_row_sse2( GLuint n, GLshort acc[], GLshort incr )
+{
+   const __m128i v = _mm_set1_epi16(incr);
+   GLuint i;
+
+   for (i = 0; i + 8 <= n; i += 8) {
+      const __m128i a = _mm_loadu_si128((const __m128i *) (acc + i));
+      _mm_storeu_si128((__m128i *) (acc + i), _mm_add_epi16(a, v));
+   }
+   add_row(n - i, acc + i, incr);
+}
+
+
+/*
+ * The color row functions do four pixels, eight accum values in each
+ * of two registers, at a time.
+ */
+
+static SSE2_FUNC void
+accum_row_sse2( GLuint n, GLshort acc[], CONST GLchan rgba[][4],
+                GLfloat scale )
+{
+   const __m128i zero = _mm_setzero_si128();
+   GLuint j;
+
+   for (j = 0; j + 4 <= n; j += 4) {
+      const __m128i p = _mm_loadu_si128((const __m128i *) rgba[j]);
+      __m128i *a = (__m128i *) (acc + 4 * j);
+      _mm_storeu_si128(a, _mm_add_epi16(_mm_loadu_si128(a),
+                                        _mm_unpacklo_epi8(p, zero)));
+      _mm_storeu_si128(a + 1, _mm_add_epi16(_mm_loadu_si128(a + 1),
+                                            _mm_unpackhi_epi8(p, zero)));
+   }
+   accum_row(n - j, acc + 4 * j, rgba + j, scale);
+}
+
+
+static SSE2_FUNC void
+accum_row_scaled_sse2( GLuint n, GLshort acc[], CONST GLchan rgba[][4],
+                       GLfloat scale )
+{
+   const __m128i zero = _mm_setzero_si128();
+   const __m128 s = _mm_set1_ps(scale);
+   GLuint j;
+
+   for (j = 0; j + 4 <= n; j += 4) {
+      const __m128i p = _mm_loadu_si128((const __m128i *) rgba[j]);
+      __m128i *a = (__m128i *) (acc + 4 * j);
+      _mm_storeu_si128(a, _mm_add_epi16(_mm_loadu_si128(a),
+                             scale_shorts(_mm_unpacklo_epi8(p, zero), s)));
+      _mm_storeu_si128(a + 1, _mm_add_epi16(_mm_loadu_si128(a + 1),
+                             scale_shorts(_mm_unpackhi_epi8(p, zero), s)));
+   }
+   accum_row_scaled(n - j, acc + 4 * j, rgba + j, scale);
+}
+
+
+static SSE2_FUNC void
+load_row_sse2( GLuint n, GLshort acc[], CONST GLchan rgba[][4], GLfloat scale )
+{
+   const __m128i zero = _mm_setzero_si128();
+   GLuint j;
+
+   for (j = 0; j + 4 <= n; j += 4) {
+      const __m128i p = _mm_loadu_si128((const __m128i *) rgba[j]);
+      __m128i *a = (__m128i *) (acc + 4 * j);
+      _mm_storeu_si128(a, _mm_unpacklo_epi8(p, zero));
+      _mm_storeu_si128(a + 1, _mm_unpackhi_epi8(p, zero));
+   }
+   load_row(n - j, acc + 4 * j, rgba + j, scale);
+}
+
+
+static SSE2_FUNC void
+load_row_scaled_sse2( GLuint n, GLshort acc[], CONST GLchan rgba[][4],
+                      GLfloat scale )
+{
+   const __m128i zero = _mm_setzero_si128();
+   const __m128 s = _mm_set1_ps(scale);
+   GLuint j;
+
+   for (j = 0; j + 4 <= n; j += 4) {
+      const __m128i p = _mm_loadu_si128((const __m128i *) rgba[j]);
+      __m128i *a = (__m128i *) (acc + 4 * j);
+      _mm_storeu_si128(a, scale_shorts(_mm_unpacklo_epi8(p, zero), s));
+      _mm_storeu_si128(a + 1, scale_shorts(_mm_unpackhi_epi8(p, zero), s));
+   }
+   load_row_scaled(n - j, acc + 4 * j, rgba + j, scale);
+}
+
+
+static SSE2_FUNC void
+return_row_scaled_sse2( GLuint n, const GLshort acc[], GLchan rgba[][4],
+                        GLfloat scale )
+{
+   const __m128 s = _mm_set1_ps(scale);
+   GLuint j;
+
+   for (j = 0; j + 4 <= n; j += 4) {
+      const __m128i *a = (const __m128i *) (acc + 4 * j);
+      const __m128i lo = round_shorts(_mm_loadu_si128(a), s);
+      const __m128i hi = round_shorts(_mm_loadu_si128(a + 1), s);
+      _mm_storeu_si128((__m128i *) rgba[j], _mm_packus_epi16(lo, hi));
+   }
+   return_row_scaled(n - j, acc + 4 * j, rgba + j, scale);
+}
+
+#endif /* USE_SSE2_ACCUM */
+
+
+
+/**
+ * An accumulation buffer operation.  Row() is called for each row of
+ * the region [XPos, XPos + Width) x [YPos, YPos + Height), with acc
+ * pointing at the region's accum values in that row.  The rows are
+ * split into bands which may be processed by several threads, see
+ * _swrast_run_rows().
+ */
+struct accum_job {
+   struct gl_renderbuffer *rb;     /**< the accum buffer */
+   GLboolean Direct;               /**< is rb directly addressable? */
+   void (*Row)( GLcontext *ctx, const struct accum_job *job,
+                GLint y, GLshort acc[] );
+   GLboolean ReadOnly;             /**< Row() doesn't modify acc */
+   GLint XPos, YPos, Width, Height;
+
+   GLboolean IntegerMode;          /**< unscaled accum values? */
+   GLfloat Scale;
+   GLshort Incr;
+   const GLchan *MultTable;        /**< for GL_RETURN in integer mode */
+   GLint Max;
+   GLboolean Masking;
+
+   /** Rescale the whole buffer first, see rescale_accum() */
+   GLboolean Rescale;
+   GLfloat RescaleScale;
+
+   accum_scale_func ScaleRow;
+   accum_add_func AddRow;
+   accum_color_func ColorRow;
+   accum_return_func ReturnRow;
+};
+
+
+static void
+init_accum_job( GLcontext *ctx, struct accum_job *job,
+                GLint xpos, GLint ypos, GLint width, GLint height )
+{
+   job->rb = ctx->DrawBuffer->Attachment[BUFFER_ACCUM].Renderbuffer;
+   assert(job->rb);
+   job->Direct = (job->rb->GetPointer(ctx, job->rb, 0, 0) != NULL);
+   job->Row = NULL;
+   job->ReadOnly = GL_FALSE;
+   job->XPos = xpos;
+   job->YPos = ypos;
+   job->Width = width;
+   job->Height = height;
+   job->IntegerMode = GL_FALSE;
+   job->Rescale = GL_FALSE;
+
+   job->ScaleRow = scale_row;
+   job->AddRow = add_row;
+   job->ColorRow = NULL;
+   job->ReturnRow = return_row_scaled;
+#ifdef USE_SSE2_ACCUM
+   if (_mesa_have_sse2()) {
+      job->ScaleRow = scale_row_sse2;
+      job->AddRow = add_row_sse2;
+      job->ReturnRow = return_row_scaled_sse2;
+   }
+#endif
+}
+
+
+/**
+ * Choose the row function for GL_ACCUM or GL_LOAD.
+ */
+static accum_color_func
+choose_color_row( const struct accum_job *job, GLboolean load )
+{
+#ifdef USE_SSE2_ACCUM
+   if (_mesa_have_sse2()) {
+      if (load)
+         return job->IntegerMode ? load_row_sse2 : load_row_scaled_sse2;
+      else
+         return job->IntegerMode ? accum_row_sse2 : accum_row_scaled_sse2;
+   }
+#endif
+   if (load)
+      return job->IntegerMode ? load_row : load_row_scaled;
+   else
+      return job->IntegerMode ? accum_row : accum_row_scaled;
+}
+
+
+/**
+ * Do the job for rows [y0, y1).
+ */
+static void
+accum_rows( GLcontext *ctx, void *data, GLint y0, GLint y1 )
+{
+   const struct accum_job *job = (const struct accum_job *) data;
+   struct gl_renderbuffer *rb = job->rb;
+   /* when rescaling we need whole rows */
+   const GLint x0 = job->Rescale ? 0 : job->XPos;
+   const GLint n = job->Rescale ? (GLint) rb->Width : job->Width;
+   GLshort accRow[4 * MAX_WIDTH];
+   GLint y;
+
+   for (y = y0; y < y1; y++) {
+      const GLboolean inside = (y >= job->YPos && y < job->YPos + job->Height);
+      GLshort *row;
+
+      if (job->Direct) {
+         row = (GLshort *) rb->GetPointer(ctx, rb, x0, y);
+      }
+      else {
+         rb->GetRow(ctx, rb, n, x0, y, accRow);
+         row = accRow;
+      }
+
+      if (job->Rescale)
+         job->ScaleRow(4 * n, row, job->RescaleScale);
+
+      if (inside)
+         job->Row(ctx, job, y, row + 4 * (job->XPos - x0));
+
+      if (!job->Direct && (job->Rescale || !job->ReadOnly))
+         rb->PutRow(ctx, rb, n, x0, y, accRow, NULL);
+   }
+}
+
+
+static void
+run_accum_job( GLcontext *ctx, struct accum_job *job )
+{
+   if (job->Rescale)
+      _swrast_run_rows(ctx, accum_rows, job, 0, job->rb->Height);
+   else
+      _swrast_run_rows(ctx, accum_rows, job, job->YPos, job->Height);
+}
+
+
 /**
  * This is called when we fall out of optimized/unscaled accum buffer mode.
  * That is, we convert each unscaled accum buffer value into a scaled value
- * representing the range[-1, 1].
+ * representing the range[-1, 1].  The conversion is done by the job, in
+ * the same pass over the buffer as the operation itself.
  */
 static void
-rescale_accum( GLcontext *ctx )
+rescale_accum( GLcontext *ctx, struct accum_job *job )
 {
    SWcontext *swrast = SWRAST_CONTEXT(ctx);
-   struct gl_renderbuffer *rb
-      = ctx->DrawBuffer->Attachment[BUFFER_ACCUM].Renderbuffer;
-   const GLfloat s = swrast->_IntegerAccumScaler * (32767.0F / CHAN_MAXF);
+   struct gl_renderbuffer *rb = job->rb;
 
    assert(rb);
    assert(rb->_BaseFormat == GL_RGBA);
    /* add other types in future? */
    assert(rb->DataType == GL_SHORT || rb->DataType == GL_UNSIGNED_SHORT);
    assert(swrast->_IntegerAccumMode);
+   (void) rb;
 
-   if (rb->GetPointer(ctx, rb, 0, 0)) {
-      /* directly-addressable memory */
-      GLuint y;
-      for (y = 0; y < rb->Height; y++) {
-         GLuint i;
-         GLshort *acc = (GLshort *) rb->GetPointer(ctx, rb, 0, y);
-         for (i = 0; i < 4 * rb->Width; i++) {
-            acc[i] = (GLshort) (acc[i] * s);
-         }
-      }
-   }
-   else {
-      /* use get/put row funcs */
-      GLuint y;
-      for (y = 0; y < rb->Height; y++) {
-         GLshort accRow[MAX_WIDTH * 4];
-         GLuint i;
-         rb->GetRow(ctx, rb, rb->Width, 0, y, accRow);
-         for (i = 0; i < 4 * rb->Width; i++) {
-            accRow[i] = (GLshort) (accRow[i] * s);
-         }
-         rb->PutRow(ctx, rb, rb->Width, 0, y, accRow, NULL);
-      }
-   }
+   job->Rescale = GL_TRUE;
+   job->RescaleScale = swrast->_IntegerAccumScaler * (32767.0F / CHAN_MAXF);
 
    swrast->_IntegerAccumMode = GL_FALSE;
 }
@@ -178,42 +584,94 @@ _swrast_clear_accum_buffer( GLcontext *ctx, struct gl_renderbuffer *rb )
 }
 
 
+static void
+add_op( GLcontext *ctx, const struct accum_job *job, GLint y, GLshort acc[] )
+{
+   (void) ctx;
+   (void) y;
+   job->AddRow(4 * job->Width, acc, job->Incr);
+}
+
+
+static void
+mult_op( GLcontext *ctx, const struct accum_job *job, GLint y, GLshort acc[] )
+{
+   (void) ctx;
+   (void) y;
+   job->ScaleRow(4 * job->Width, acc, job->Scale);
+}
+
+
+/** GL_ACCUM and GL_LOAD */
+static void
+read_op( GLcontext *ctx, const struct accum_job *job, GLint y, GLshort acc[] )
+{
+   GLchan rgba[MAX_WIDTH][4];
+
+   /* read colors from color buffer */
+   _swrast_read_rgba_span(ctx, ctx->ReadBuffer->_ColorReadBuffer, job->Width,
+                          job->XPos, y, rgba);
+
+   job->ColorRow(job->Width, acc, (CONST GLchan (*)[4]) rgba, job->Scale);
+}
+
+
+static void
+return_op( GLcontext *ctx, const struct accum_job *job, GLint y,
+           GLshort acc[] )
+{
+   struct gl_framebuffer *fb = ctx->DrawBuffer;
+   GLchan rgba[MAX_WIDTH][4];
+   GLuint buffer;
+
+   /* get the colors to return */
+   if (job->IntegerMode) {
+      const GLchan *multTable = job->MultTable;
+      GLint j;
+      for (j = 0; j < job->Width; j++) {
+         ASSERT(acc[j * 4 + 0] < job->Max);
+         ASSERT(acc[j * 4 + 1] < job->Max);
+         ASSERT(acc[j * 4 + 2] < job->Max);
+         ASSERT(acc[j * 4 + 3] < job->Max);
+         rgba[j][RCOMP] = multTable[acc[j * 4 + 0]];
+         rgba[j][GCOMP] = multTable[acc[j * 4 + 1]];
+         rgba[j][BCOMP] = multTable[acc[j * 4 + 2]];
+         rgba[j][ACOMP] = multTable[acc[j * 4 + 3]];
+      }
+   }
+   else {
+      /* scaled integer (or float) accum buffer */
+      job->ReturnRow(job->Width, acc, rgba, job->Scale);
+   }
+
+   /* store colors */
+   for (buffer = 0; buffer < fb->_NumColorDrawBuffers[0]; buffer++) {
+      struct gl_renderbuffer *rb = fb->_ColorDrawBuffers[0][buffer];
+      if (job->Masking) {
+         _swrast_mask_rgba_array(ctx, rb, job->Width, job->XPos, y, rgba);
+      }
+      rb->PutRow(ctx, rb, job->Width, job->XPos, y, rgba, NULL);
+   }
+}
+
+
 static void
 accum_add(GLcontext *ctx, GLfloat value,
           GLint xpos, GLint ypos, GLint width, GLint height )
 {
    SWcontext *swrast = SWRAST_CONTEXT(ctx);
-   struct gl_renderbuffer *rb
-      = ctx->DrawBuffer->Attachment[BUFFER_ACCUM].Renderbuffer;
+   struct accum_job job;
 
-   assert(rb);
+   init_accum_job(ctx, &job, xpos, ypos, width, height);
 
    /* Leave optimized accum buffer mode */
    if (swrast->_IntegerAccumMode)
-      rescale_accum(ctx);
+      rescale_accum(ctx, &job);
 
-   if (rb->DataType == GL_SHORT || rb->DataType == GL_UNSIGNED_SHORT) {
-      const GLshort incr = (GLshort) (value * ACCUM_SCALE16);
-      if (rb->GetPointer(ctx, rb, 0, 0)) {
-         GLint i, j;
-         for (i = 0; i < height; i++) {
-            GLshort *acc = (GLshort *) rb->GetPointer(ctx, rb, xpos, ypos + i);
-            for (j = 0; j < 4 * width; j++) {
-               acc[j] += incr;
-            }
-         }
-      }
-      else {
-         GLint i, j;
-         for (i = 0; i < height; i++) {
-            GLshort accRow[4 * MAX_WIDTH];
-            rb->GetRow(ctx, rb, width, xpos, ypos + i, accRow);
-            for (j = 0; j < 4 * width; j++) {
-               accRow[j] += incr;
-            }
-            rb->PutRow(ctx, rb, width, xpos, ypos + i, accRow, NULL);
-         }
-      }
+   if (job.rb->DataType == GL_SHORT || job.rb->DataType == GL_UNSIGNED_SHORT) {
+      job.Row = add_op;
+      job.Incr = (GLshort) (value * ACCUM_SCALE16);
+      run_accum_job(ctx, &job);
    }
    else {
       /* other types someday */
@@ -226,36 +684,18 @@ accum_mult(GLcontext *ctx, GLfloat mult,
            GLint xpos, GLint ypos, GLint width, GLint height )
 {
    SWcontext *swrast = SWRAST_CONTEXT(ctx);
-   struct gl_renderbuffer *rb
-      = ctx->DrawBuffer->Attachment[BUFFER_ACCUM].Renderbuffer;
+   struct accum_job job;
 
-   assert(rb);
+   init_accum_job(ctx, &job, xpos, ypos, width, height);
 
    /* Leave optimized accum buffer mode */
    if (swrast->_IntegerAccumMode)
-      rescale_accum(ctx);
+      rescale_accum(ctx, &job);
 
-   if (rb->DataType == GL_SHORT || rb->DataType == GL_UNSIGNED_SHORT) {
-      if (rb->GetPointer(ctx, rb, 0, 0)) {
-         GLint i, j;
-         for (i = 0; i < height; i++) {
-            GLshort *acc = (GLshort *) rb->GetPointer(ctx, rb, xpos, ypos + i);
-            for (j = 0; j < 4 * width; j++) {
-               acc[j] = (GLshort) (acc[j] * mult);
-            }
-         }
-      }
-      else {
-         GLint i, j;
-         for (i = 0; i < height; i++) {
-            GLshort accRow[4 * MAX_WIDTH];
-            rb->GetRow(ctx, rb, width, xpos, ypos + i, accRow);
-            for (j = 0; j < 4 * width; j++) {
-               accRow[j] = (GLshort) (accRow[j] * mult);
-            }
-            rb->PutRow(ctx, rb, width, xpos, ypos + i, accRow, NULL);
-         }
-      }
+   if (job.rb->DataType == GL_SHORT || job.rb->DataType == GL_UNSIGNED_SHORT) {
+      job.Row = mult_op;
+      job.Scale = mult;
+      run_accum_job(ctx, &job);
    }
    else {
       /* other types someday */
@@ -269,11 +709,9 @@ accum_accum(GLcontext *ctx, GLfloat value,
             GLint xpos, GLint ypos, GLint width, GLint height )
 {
    SWcontext *swrast = SWRAST_CONTEXT(ctx);
-   struct gl_renderbuffer *rb
-      = ctx->DrawBuffer->Attachment[BUFFER_ACCUM].Renderbuffer;
-   const GLboolean directAccess = (rb->GetPointer(ctx, rb, 0, 0) != NULL);
+   struct accum_job job;
 
-   assert(rb);
+   init_accum_job(ctx, &job, xpos, ypos, width, height);
 
    if (!ctx->ReadBuffer->_ColorReadBuffer) {
       /* no read buffer - OK */
@@ -284,56 +722,17 @@ accum_accum(GLcontext *ctx, GLfloat value,
    if (swrast->_IntegerAccumScaler == 0.0 && value > 0.0 && value <= 1.0)
       swrast->_IntegerAccumScaler = value;
    if (swrast->_IntegerAccumMode && value != swrast->_IntegerAccumScaler)
-      rescale_accum(ctx);
+      rescale_accum(ctx, &job);
 
    _swrast_use_read_buffer(ctx);
 
-   if (rb->DataType == GL_SHORT || rb->DataType == GL_UNSIGNED_SHORT) {
-      const GLfloat scale = value * ACCUM_SCALE16 / CHAN_MAXF;
-      GLshort accumRow[4 * MAX_WIDTH];
-      GLchan rgba[MAX_WIDTH][4];
-      GLint i;
-
-      for (i = 0; i < height; i++) {
-         GLshort *acc;
-         if (directAccess) {
-            acc = (GLshort *) rb->GetPointer(ctx, rb, xpos, ypos + i);
-         }
-         else {
-            rb->GetRow(ctx, rb, width, xpos, ypos + i, accumRow);
-            acc = accumRow;
-         }
-
-         /* read colors from color buffer */
-         _swrast_read_rgba_span(ctx, ctx->ReadBuffer->_ColorReadBuffer, width,
-                                xpos, ypos + i, rgba);
-
-         /* do accumulation */
-         if (swrast->_IntegerAccumMode) {
-            /* simply add integer color values into accum buffer */
-            GLint j;
-            for (j = 0; j < width; j++) {
-               acc[j * 4 + 0] += rgba[j][RCOMP];
-               acc[j * 4 + 1] += rgba[j][GCOMP];
-               acc[j * 4 + 2] += rgba[j][BCOMP];
-               acc[j * 4 + 3] += rgba[j][ACOMP];
-            }
-         }
-         else {
-            /* scaled integer (or float) accum buffer */
-            GLint j;
-            for (j = 0; j < width; j++) {
-               acc[j * 4 + 0] += (GLshort) ((GLfloat) rgba[j][RCOMP] * scale);
-               acc[j * 4 + 1] += (GLshort) ((GLfloat) rgba[j][GCOMP] * scale);
-               acc[j * 4 + 2] += (GLshort) ((GLfloat) rgba[j][BCOMP] * scale);
-               acc[j * 4 + 3] += (GLshort) ((GLfloat) rgba[j][ACOMP] * scale);
-            }
-         }
-
-         if (!directAccess) {
-            rb->PutRow(ctx, rb, width, xpos, ypos + i, accumRow, NULL);
-         }
-      }
+   if (job.rb->DataType == GL_SHORT || job.rb->DataType == GL_UNSIGNED_SHORT) {
+      /* in integer mode simply add integer color values into accum buffer */
+      job.Row = read_op;
+      job.IntegerMode = swrast->_IntegerAccumMode;
+      job.Scale = value * ACCUM_SCALE16 / CHAN_MAXF;
+      job.ColorRow = choose_color_row(&job, GL_FALSE);
+      run_accum_job(ctx, &job);
    }
    else {
       /* other types someday */
@@ -349,11 +748,9 @@ accum_load(GLcontext *ctx, GLfloat value,
            GLint xpos, GLint ypos, GLint width, GLint height )
 {
    SWcontext *swrast = SWRAST_CONTEXT(ctx);
-   struct gl_renderbuffer *rb
-      = ctx->DrawBuffer->Attachment[BUFFER_ACCUM].Renderbuffer;
-   const GLboolean directAccess = (rb->GetPointer(ctx, rb, 0, 0) != NULL);
+   struct accum_job job;
 
-   assert(rb);
+   init_accum_job(ctx, &job, xpos, ypos, width, height);
 
    if (!ctx->ReadBuffer->_ColorReadBuffer) {
       /* no read buffer - OK */
@@ -376,54 +773,17 @@ accum_load(GLcontext *ctx, GLfloat value,
 
    _swrast_use_read_buffer(ctx);
 
-   if (rb->DataType == GL_SHORT || rb->DataType == GL_UNSIGNED_SHORT) {
-      const GLfloat scale = value * ACCUM_SCALE16 / CHAN_MAXF;
-      GLshort accumRow[4 * MAX_WIDTH];
-      GLchan rgba[MAX_WIDTH][4];
-      GLint i;
-
-      for (i = 0; i < height; i++) {
-         GLshort *acc;
-         if (directAccess) {
-            acc = (GLshort *) rb->GetPointer(ctx, rb, xpos, ypos + i);
-         }
-         else {
-            rb->GetRow(ctx, rb, width, xpos, ypos + i, accumRow);
-            acc = accumRow;
-         }
-
-         /* read colors from color buffer */
-         _swrast_read_rgba_span(ctx, ctx->ReadBuffer->_ColorReadBuffer, width,
-                                xpos, ypos + i, rgba);
-
-         /* do load */
-         if (swrast->_IntegerAccumMode) {
-            /* just copy values in */
-            GLint j;
-            assert(swrast->_IntegerAccumScaler > 0.0);
-            assert(swrast->_IntegerAccumScaler <= 1.0);
-            for (j = 0; j < width; j++) {
-               acc[j * 4 + 0] = rgba[j][RCOMP];
-               acc[j * 4 + 1] = rgba[j][GCOMP];
-               acc[j * 4 + 2] = rgba[j][BCOMP];
-               acc[j * 4 + 3] = rgba[j][ACOMP];
-            }
-         }
-         else {
-            /* scaled integer (or float) accum buffer */
-            GLint j;
-            for (j = 0; j < width; j++) {
-               acc[j * 4 + 0] = (GLshort) ((GLfloat) rgba[j][RCOMP] * scale);
-               acc[j * 4 + 1] = (GLshort) ((GLfloat) rgba[j][GCOMP] * scale);
-               acc[j * 4 + 2] = (GLshort) ((GLfloat) rgba[j][BCOMP] * scale);
-               acc[j * 4 + 3] = (GLshort) ((GLfloat) rgba[j][ACOMP] * scale);
-            }
-         }
-
-         if (!directAccess) {
-            rb->PutRow(ctx, rb, width, xpos, ypos + i, accumRow, NULL);
-         }
+   if (job.rb->DataType == GL_SHORT || job.rb->DataType == GL_UNSIGNED_SHORT) {
+      /* in integer mode just copy values in */
+      job.Row = read_op;
+      job.IntegerMode = swrast->_IntegerAccumMode;
+      job.Scale = value * ACCUM_SCALE16 / CHAN_MAXF;
+      job.ColorRow = choose_color_row(&job, GL_TRUE);
+      if (job.IntegerMode) {
+         assert(swrast->_IntegerAccumScaler > 0.0);
+         assert(swrast->_IntegerAccumScaler <= 1.0);
       }
+      run_accum_job(ctx, &job);
    }
    else {
       /* other types someday */
@@ -438,10 +798,6 @@ accum_return(GLcontext *ctx, GLfloat value,
              GLint xpos, GLint ypos, GLint width, GLint height )
 {
    SWcontext *swrast = SWRAST_CONTEXT(ctx);
-   struct gl_framebuffer *fb = ctx->DrawBuffer;
-   struct gl_renderbuffer *accumRb = fb->Attachment[BUFFER_ACCUM].Renderbuffer;
-   const GLboolean directAccess
-      = (accumRb->GetPointer(ctx, accumRb, 0, 0) != NULL);
    const GLboolean masking = (!ctx->Color.ColorMask[RCOMP] ||
                               !ctx->Color.ColorMask[GCOMP] ||
                               !ctx->Color.ColorMask[BCOMP] ||
@@ -451,10 +807,13 @@ accum_return(GLcontext *ctx, GLfloat value,
    static GLfloat prevMult = 0.0;
    const GLfloat mult = swrast->_IntegerAccumScaler;
    const GLint max = MIN2((GLint) (256 / mult), 32767);
+   struct accum_job job;
+
+   init_accum_job(ctx, &job, xpos, ypos, width, height);
 
    /* May have to leave optimized accum buffer mode */
    if (swrast->_IntegerAccumMode && value != 1.0)
-      rescale_accum(ctx);
+      rescale_accum(ctx, &job);
 
    if (swrast->_IntegerAccumMode && swrast->_IntegerAccumScaler > 0) {
       /* build lookup table to avoid many floating point multiplies */
@@ -467,63 +826,15 @@ accum_return(GLcontext *ctx, GLfloat value,
       }
    }
 
-   if (accumRb->DataType == GL_SHORT ||
-       accumRb->DataType == GL_UNSIGNED_SHORT) {
-      const GLfloat scale = value * CHAN_MAXF / ACCUM_SCALE16;
-      GLuint buffer, i;
-
-      /* XXX maybe transpose the 'i' and 'buffer' loops??? */
-      for (i = 0; i < height; i++) {
-         GLchan rgba[MAX_WIDTH][4];
-         GLshort accumRow[4 * MAX_WIDTH];
-         GLshort *acc;
-
-         if (directAccess) {
-            acc = (GLshort *) accumRb->GetPointer(ctx, accumRb, xpos, ypos +i);
-         }
-         else {
-            accumRb->GetRow(ctx, accumRb, width, xpos, ypos + i, accumRow);
-            acc = accumRow;
-         }
-
-         /* get the colors to return */
-         if (swrast->_IntegerAccumMode) {
-            GLint j;
-            for (j = 0; j < width; j++) {
-               ASSERT(acc[j * 4 + 0] < max);
-               ASSERT(acc[j * 4 + 1] < max);
-               ASSERT(acc[j * 4 + 2] < max);
-               ASSERT(acc[j * 4 + 3] < max);
-               rgba[j][RCOMP] = multTable[acc[j * 4 + 0]];
-               rgba[j][GCOMP] = multTable[acc[j * 4 + 1]];
-               rgba[j][BCOMP] = multTable[acc[j * 4 + 2]];
-               rgba[j][ACOMP] = multTable[acc[j * 4 + 3]];
-            }
-         }
-         else {
-            /* scaled integer (or float) accum buffer */
-            GLint j;
-            for (j = 0; j < width; j++) {
-               GLint r = IROUND( (GLfloat) (acc[j * 4 + 0]) * scale );
-               GLint g = IROUND( (GLfloat) (acc[j * 4 + 1]) * scale );
-               GLint b = IROUND( (GLfloat) (acc[j * 4 + 2]) * scale );
-               GLint a = IROUND( (GLfloat) (acc[j * 4 + 3]) * scale );
-               rgba[j][RCOMP] = CLAMP( r, 0, CHAN_MAX );
-               rgba[j][GCOMP] = CLAMP( g, 0, CHAN_MAX );
-               rgba[j][BCOMP] = CLAMP( b, 0, CHAN_MAX );
-               rgba[j][ACOMP] = CLAMP( a, 0, CHAN_MAX );
-            }
-         }
-
-         /* store colors */
-         for (buffer = 0; buffer < fb->_NumColorDrawBuffers[0]; buffer++) {
-            struct gl_renderbuffer *rb = fb->_ColorDrawBuffers[0][buffer];
-            if (masking) {
-               _swrast_mask_rgba_array(ctx, rb, width, xpos, ypos + i, rgba);
-            }
-            rb->PutRow(ctx, rb, width, xpos, ypos + i, rgba, NULL);
-         }
-      }
+   if (job.rb->DataType == GL_SHORT || job.rb->DataType == GL_UNSIGNED_SHORT) {
+      job.Row = return_op;
+      job.ReadOnly = GL_TRUE;
+      job.IntegerMode = swrast->_IntegerAccumMode;
+      job.Scale = value * CHAN_MAXF / ACCUM_SCALE16;
+      job.MultTable = multTable;
+      job.Max = max;
+      job.Masking = masking;
+      run_accum_job(ctx, &job);
    }
    else {
       /* other types someday */
@@ -573,6 +884,7 @@ _swrast_Accum( GLcontext *ctx, GLenum op, GLfloat value,
          accum_load(ctx, value, xpos, ypos, width, height);
 	 break;
       case GL_RETURN:
+         _swrast_resolve_lazy_clear_draw(ctx, xpos, ypos, width, height);
          accum_return(ctx, value, xpos, ypos, width, height);
 	 break;
       default:
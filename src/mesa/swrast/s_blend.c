@@ -40,6 +40,7 @@
 #include "s_blend.h"
 #include "s_context.h"
 #include "s_span.h"
+#include "x86/common_x86_sse2.h"
 
 
 #if defined(USE_MMX_ASM)
@@ -50,6 +51,14 @@
 #define _BLENDAPI
 #endif
 
+/*
+ * SSE2 versions of the special case blend functions, for 8 and 16-bit
+ * channels.
+ */
+#if defined(USE_SSE2_INTRIN) && CHAN_TYPE != GL_FLOAT
+#define USE_SSE2_BLEND
+#endif
+
 
 /*
  * Special case for glBlendFunc(GL_ZERO, GL_ONE)
@@ -319,6 +328,158 @@ blend_modulate( GLcontext *ctx, GLuint n, const GLubyte mask[],
 
 
 
+#if CHAN_TYPE != GL_FLOAT
+/**
+ * Exactly rounded X / CHAN_MAX for X in [0, CHAN_MAX * CHAN_MAX].
+ * This is Jim Blinn's formula, which needs no division.
+ */
+static INLINE GLuint
+div_chan_max( GLuint x )
+{
+   x += (CHAN_MAX + 1) / 2;
+   return (x + (x >> CHAN_BITS)) >> CHAN_BITS;
+}
+#endif
+
+
+/*
+ * Premultiplied alpha:  result = src + dest * (1 - src alpha)
+ */
+static void _BLENDAPI
+blend_premultiplied( GLcontext *ctx, GLuint n, const GLubyte mask[],
+                     GLchan rgba[][4], CONST GLchan dest[][4] )
+{
+   GLuint i;
+   ASSERT(ctx->Color.BlendEquationRGB==GL_FUNC_ADD);
+   ASSERT(ctx->Color.BlendEquationA==GL_FUNC_ADD);
+   ASSERT(ctx->Color.BlendSrcRGB==GL_ONE);
+   ASSERT(ctx->Color.BlendDstRGB==GL_ONE_MINUS_SRC_ALPHA);
+   (void) ctx;
+
+   for (i = 0; i < n; i++) {
+      if (mask[i]) {
+#if CHAN_TYPE == GL_FLOAT
+         const GLfloat t = 1.0F - CLAMP(rgba[i][ACOMP], 0.0F, CHAN_MAXF);
+         GLfloat r = MIN2(rgba[i][RCOMP], CHAN_MAXF) + dest[i][RCOMP] * t;
+         GLfloat g = MIN2(rgba[i][GCOMP], CHAN_MAXF) + dest[i][GCOMP] * t;
+         GLfloat b = MIN2(rgba[i][BCOMP], CHAN_MAXF) + dest[i][BCOMP] * t;
+         GLfloat a = MIN2(rgba[i][ACOMP], CHAN_MAXF) + dest[i][ACOMP] * t;
+         rgba[i][RCOMP] = MAX2( r, 0.0F );
+         rgba[i][GCOMP] = MAX2( g, 0.0F );
+         rgba[i][BCOMP] = MAX2( b, 0.0F );
+         rgba[i][ACOMP] = CLAMP( a, 0.0F, CHAN_MAXF );
+#else
+         const GLuint t = CHAN_MAX - rgba[i][ACOMP];
+         GLuint r = rgba[i][RCOMP] + div_chan_max(dest[i][RCOMP] * t);
+         GLuint g = rgba[i][GCOMP] + div_chan_max(dest[i][GCOMP] * t);
+         GLuint b = rgba[i][BCOMP] + div_chan_max(dest[i][BCOMP] * t);
+         GLuint a = rgba[i][ACOMP] + div_chan_max(dest[i][ACOMP] * t);
+         rgba[i][RCOMP] = (GLchan) MIN2( r, CHAN_MAX );
+         rgba[i][GCOMP] = (GLchan) MIN2( g, CHAN_MAX );
+         rgba[i][BCOMP] = (GLchan) MIN2( b, CHAN_MAX );
+         rgba[i][ACOMP] = (GLchan) MIN2( a, CHAN_MAX );
+#endif
+      }
+   }
+}
+
+
+
+/*
+ * Return true if the blend factor doesn't depend on the src or dest color.
+ */
+static GLboolean
+is_constant_factor( GLenum factor )
+{
+   switch (factor) {
+   case GL_ZERO:
+   case GL_ONE:
+   case GL_CONSTANT_COLOR:
+   case GL_ONE_MINUS_CONSTANT_COLOR:
+   case GL_CONSTANT_ALPHA:
+   case GL_ONE_MINUS_CONSTANT_ALPHA:
+      return GL_TRUE;
+   default:
+      return GL_FALSE;
+   }
+}
+
+
+/*
+ * Compute the RGBA weights for a constant blend factor.
+ */
+static void
+get_constant_factor( const GLcontext *ctx, GLenum factor, GLfloat f[4] )
+{
+   const GLfloat *color = ctx->Color.BlendColor;
+
+   switch (factor) {
+   case GL_ZERO:
+      ASSIGN_4V(f, 0.0F, 0.0F, 0.0F, 0.0F);
+      break;
+   case GL_ONE:
+      ASSIGN_4V(f, 1.0F, 1.0F, 1.0F, 1.0F);
+      break;
+   case GL_CONSTANT_COLOR:
+      COPY_4V(f, color);
+      break;
+   case GL_ONE_MINUS_CONSTANT_COLOR:
+      ASSIGN_4V(f, 1.0F - color[0], 1.0F - color[1],
+                1.0F - color[2], 1.0F - color[3]);
+      break;
+   case GL_CONSTANT_ALPHA:
+      ASSIGN_4V(f, color[3], color[3], color[3], color[3]);
+      break;
+   case GL_ONE_MINUS_CONSTANT_ALPHA:
+      ASSIGN_4V(f, 1.0F - color[3], 1.0F - color[3],
+                1.0F - color[3], 1.0F - color[3]);
+      break;
+   default:
+      _mesa_problem(ctx, "Bad blend factor in get_constant_factor");
+      ASSIGN_4V(f, 0.0F, 0.0F, 0.0F, 0.0F);
+   }
+}
+
+
+/*
+ * Blending with src and dest factors that are all zero, one or taken
+ * from the constant blend color, and GL_FUNC_ADD.  The factors are
+ * evaluated once per span; the arithmetic is the same as blend_general's.
+ */
+static void _BLENDAPI
+blend_constant( GLcontext *ctx, GLuint n, const GLubyte mask[],
+                GLchan rgba[][4], CONST GLchan dest[][4] )
+{
+   GLfloat sf[4], df[4];
+   GLuint i, c;
+   ASSERT(ctx->Color.BlendEquationRGB==GL_FUNC_ADD);
+   ASSERT(ctx->Color.BlendEquationA==GL_FUNC_ADD);
+   ASSERT(ctx->Color.BlendSrcRGB==ctx->Color.BlendSrcA);
+   ASSERT(ctx->Color.BlendDstRGB==ctx->Color.BlendDstA);
+
+   get_constant_factor(ctx, ctx->Color.BlendSrcRGB, sf);
+   get_constant_factor(ctx, ctx->Color.BlendDstRGB, df);
+
+   for (i = 0; i < n; i++) {
+      if (mask[i]) {
+         for (c = 0; c < 4; c++) {
+#if CHAN_TYPE == GL_FLOAT
+            const GLfloat x = MIN2(rgba[i][c], CHAN_MAXF) * sf[c]
+                            + MIN2(dest[i][c], CHAN_MAXF) * df[c];
+            rgba[i][c] = (c == ACOMP) ? CLAMP(x, 0.0F, CHAN_MAXF)
+                                      : MAX2(x, 0.0F);
+#else
+            const GLint s = rgba[i][c], d = dest[i][c];
+            const GLfloat x = s * sf[c] + d * df[c] + 0.5F;
+            rgba[i][c] = (GLchan) (GLint) CLAMP(x, 0.0F, CHAN_MAXF);
+#endif
+         }
+      }
+   }
+}
+
+
+
 /*
  * General case blend pixels.
  * Input:  n - number of pixels
@@ -757,6 +918,270 @@ blend_general( GLcontext *ctx, GLuint n, const GLubyte mask[],
 }
 
 
+#if defined(USE_SSE2_BLEND)
+
+/** Number of pixels in an SSE2 register */
+#define SSE2_PIXELS  (16 / (4 * sizeof(GLchan)))
+
+
+/**
+ * Merge the blended pixels R with the incoming pixels S according to the
+ * write mask.
+ */
+static INLINE SSE2_FUNC __m128i
+mask_pixels_sse2( const GLubyte mask[], __m128i r, __m128i s )
+{
+#if CHAN_BITS == 8
+   const __m128i m = _mm_setr_epi32(mask[0], mask[1], mask[2], mask[3]);
+#else
+   const __m128i m = _mm_setr_epi32(mask[0], mask[0], mask[1], mask[1]);
+#endif
+   const __m128i off = _mm_cmpeq_epi32(m, _mm_setzero_si128());
+   return _mm_or_si128(_mm_and_si128(off, s), _mm_andnot_si128(off, r));
+}
+
+
+/**
+ * Pack two vectors of GLints in [0, 65535] to GLushorts.  SSE2 only has
+ * a signed saturating pack, so sign extend the low halves first.
+ */
+static INLINE SSE2_FUNC __m128i
+pack_epu32_sse2( __m128i lo, __m128i hi )
+{
+   lo = _mm_srai_epi32(_mm_slli_epi32(lo, 16), 16);
+   hi = _mm_srai_epi32(_mm_slli_epi32(hi, 16), 16);
+   return _mm_packs_epi32(lo, hi);
+}
+
+
+/** Broadcast the alpha of both pixels in a vector of 16-bit channels */
+#define SPLAT_ALPHA_SSE2(V)						\
+   _mm_shufflehi_epi16(_mm_shufflelo_epi16(V, _MM_SHUFFLE(ACOMP, ACOMP,	\
+                                                          ACOMP, ACOMP)), \
+                       _MM_SHUFFLE(ACOMP, ACOMP, ACOMP, ACOMP))
+
+
+/*
+ * The following functions blend two pixels with 16-bit channels.  With
+ * 8-bit channels, WIDE_OP_SSE2 unpacks four pixels to two such vectors
+ * and packs the results back.
+ */
+
+static INLINE SSE2_FUNC __m128i
+transparency_sse2( __m128i s, __m128i d )
+{
+   const __m128i t = SPLAT_ALPHA_SSE2(s);
+#if CHAN_BITS == 8
+   /* DIV255((s - d) * t) + d, as in blend_transparency() */
+   const __m128i diff = _mm_sub_epi16(s, d);
+   const __m128i lo = _mm_mullo_epi16(diff, t);
+   const __m128i hi = _mm_mulhi_epi16(diff, t);
+   const __m128i round = _mm_set1_epi32(256);
+   __m128i x0 = _mm_unpacklo_epi16(lo, hi);
+   __m128i x1 = _mm_unpackhi_epi16(lo, hi);
+   x0 = _mm_add_epi32(_mm_add_epi32(_mm_slli_epi32(x0, 8), x0), round);
+   x1 = _mm_add_epi32(_mm_add_epi32(_mm_slli_epi32(x1, 8), x1), round);
+   return _mm_add_epi16(_mm_packs_epi32(_mm_srai_epi32(x0, 16),
+                                        _mm_srai_epi32(x1, 16)), d);
+#else
+   /* (s - d) * (t / CHAN_MAXF) + d, as in blend_transparency() */
+   const __m128i zero = _mm_setzero_si128();
+   const __m128 scale = _mm_set1_ps(CHAN_MAXF);
+   const __m128 s0 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(s, zero));
+   const __m128 s1 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(s, zero));
+   const __m128 d0 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(d, zero));
+   const __m128 d1 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(d, zero));
+   const __m128 t0 = _mm_div_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(t, zero)),
+                                scale);
+   const __m128 t1 = _mm_div_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(t, zero)),
+                                scale);
+   const __m128i r = pack_epu32_sse2(
+      _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_sub_ps(s0, d0), t0), d0)),
+      _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_sub_ps(s1, d1), t1), d1)));
+   /* 100% alpha is a no-op */
+   const __m128i opaque = _mm_cmpeq_epi16(t, _mm_set1_epi16((short) CHAN_MAX));
+   return _mm_or_si128(_mm_and_si128(opaque, s), _mm_andnot_si128(opaque, r));
+#endif
+}
+
+
+static INLINE SSE2_FUNC __m128i
+premultiplied_sse2( __m128i s, __m128i d )
+{
+   const __m128i t = _mm_sub_epi16(_mm_set1_epi16((short) CHAN_MAX),
+                                   SPLAT_ALPHA_SSE2(s));
+   __m128i x;
+#if CHAN_BITS == 8
+   /* div_chan_max(d * t), which fits in 16 bits */
+   x = _mm_add_epi16(_mm_mullo_epi16(d, t), _mm_set1_epi16(128));
+   x = _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+#else
+   /* div_chan_max(d * t) in 32 bits */
+   const __m128i lo = _mm_mullo_epi16(d, t);
+   const __m128i hi = _mm_mulhi_epu16(d, t);
+   const __m128i half = _mm_set1_epi32(32768);
+   __m128i x0 = _mm_add_epi32(_mm_unpacklo_epi16(lo, hi), half);
+   __m128i x1 = _mm_add_epi32(_mm_unpackhi_epi16(lo, hi), half);
+   x0 = _mm_srli_epi32(_mm_add_epi32(x0, _mm_srli_epi32(x0, 16)), 16);
+   x1 = _mm_srli_epi32(_mm_add_epi32(x1, _mm_srli_epi32(x1, 16)), 16);
+   x = pack_epu32_sse2(x0, x1);
+#endif
+   return _mm_adds_epu16(s, x);
+}
+
+
+static INLINE SSE2_FUNC __m128i
+modulate_sse2( __m128i s, __m128i d )
+{
+#if CHAN_BITS == 8
+   /* (s * d + 255) >> 8 */
+   return _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(s, d),
+                                       _mm_set1_epi16(255)), 8);
+#else
+   /* (s * d + 65535) >> 16 is the high half of s * d, plus one unless
+    * the low half is zero.
+    */
+   const __m128i lo = _mm_mullo_epi16(s, d);
+   const __m128i hi = _mm_mulhi_epu16(s, d);
+   return _mm_add_epi16(_mm_add_epi16(hi, _mm_set1_epi16(1)),
+                        _mm_cmpeq_epi16(lo, _mm_setzero_si128()));
+#endif
+}
+
+
+/** s * sf + d * df + 0.5, as in blend_constant() */
+static INLINE SSE2_FUNC __m128i
+constant_sse2( __m128i s, __m128i d, __m128 sf, __m128 df )
+{
+   const __m128i zero = _mm_setzero_si128();
+   const __m128 half = _mm_set1_ps(0.5F);
+   const __m128 max = _mm_set1_ps(CHAN_MAXF);
+   __m128 x0 = _mm_add_ps(
+      _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(s, zero)), sf),
+                 _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(d, zero)), df)),
+      half);
+   __m128 x1 = _mm_add_ps(
+      _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(s, zero)), sf),
+                 _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(d, zero)), df)),
+      half);
+   x0 = _mm_min_ps(_mm_max_ps(x0, _mm_setzero_ps()), max);
+   x1 = _mm_min_ps(_mm_max_ps(x1, _mm_setzero_ps()), max);
+   return pack_epu32_sse2(_mm_cvttps_epi32(x0), _mm_cvttps_epi32(x1));
+}
+
+
+#if CHAN_BITS == 8
+#define WIDE_OP_SSE2(OP, S, D)						\
+   _mm_packus_epi16(OP(_mm_unpacklo_epi8(S, _mm_setzero_si128()),	\
+                       _mm_unpacklo_epi8(D, _mm_setzero_si128())),	\
+                    OP(_mm_unpackhi_epi8(S, _mm_setzero_si128()),	\
+                       _mm_unpackhi_epi8(D, _mm_setzero_si128())))
+#define ADD_SSE2(S, D)  _mm_adds_epu8(S, D)
+#define MIN_SSE2(S, D)  _mm_min_epu8(S, D)
+#define MAX_SSE2(S, D)  _mm_max_epu8(S, D)
+#else
+#define WIDE_OP_SSE2(OP, S, D)  OP(S, D)
+#define ADD_SSE2(S, D)  _mm_adds_epu16(S, D)
+#define MIN_SSE2(S, D)  _mm_sub_epi16(S, _mm_subs_epu16(S, D))
+#define MAX_SSE2(S, D)  _mm_add_epi16(D, _mm_subs_epu16(S, D))
+#endif
+
+
+/**
+ * Blend the pixels SSE2_PIXELS at a time with EXPR, a function of the
+ * source and dest pixel vectors s and d.  The remaining pixels are
+ * blended with the C function TAIL.
+ */
+#define BLEND_SSE2(EXPR, TAIL)						\
+do {									\
+   GLuint i;								\
+   for (i = 0; i + SSE2_PIXELS <= n; i += SSE2_PIXELS) {		\
+      const __m128i s = _mm_loadu_si128((const __m128i *) rgba[i]);	\
+      const __m128i d = _mm_loadu_si128((const __m128i *) dest[i]);	\
+      _mm_storeu_si128((__m128i *) rgba[i],				\
+                       mask_pixels_sse2(mask + i, EXPR, s));		\
+   }									\
+   if (i < n)								\
+      TAIL(ctx, n - i, mask + i, rgba + i, dest + i);			\
+} while (0)
+
+
+static SSE2_FUNC void _BLENDAPI
+blend_transparency_sse2( GLcontext *ctx, GLuint n, const GLubyte mask[],
+                         GLchan rgba[][4], CONST GLchan dest[][4] )
+{
+   BLEND_SSE2(WIDE_OP_SSE2(transparency_sse2, s, d), blend_transparency);
+}
+
+
+static SSE2_FUNC void _BLENDAPI
+blend_premultiplied_sse2( GLcontext *ctx, GLuint n, const GLubyte mask[],
+                          GLchan rgba[][4], CONST GLchan dest[][4] )
+{
+   BLEND_SSE2(WIDE_OP_SSE2(premultiplied_sse2, s, d), blend_premultiplied);
+}
+
+
+static SSE2_FUNC void _BLENDAPI
+blend_add_sse2( GLcontext *ctx, GLuint n, const GLubyte mask[],
+                GLchan rgba[][4], CONST GLchan dest[][4] )
+{
+   BLEND_SSE2(ADD_SSE2(s, d), blend_add);
+}
+
+
+static SSE2_FUNC void _BLENDAPI
+blend_min_sse2( GLcontext *ctx, GLuint n, const GLubyte mask[],
+                GLchan rgba[][4], CONST GLchan dest[][4] )
+{
+   BLEND_SSE2(MIN_SSE2(s, d), blend_min);
+}
+
+
+static SSE2_FUNC void _BLENDAPI
+blend_max_sse2( GLcontext *ctx, GLuint n, const GLubyte mask[],
+                GLchan rgba[][4], CONST GLchan dest[][4] )
+{
+   BLEND_SSE2(MAX_SSE2(s, d), blend_max);
+}
+
+
+static SSE2_FUNC void _BLENDAPI
+blend_modulate_sse2( GLcontext *ctx, GLuint n, const GLubyte mask[],
+                     GLchan rgba[][4], CONST GLchan dest[][4] )
+{
+   BLEND_SSE2(WIDE_OP_SSE2(modulate_sse2, s, d), blend_modulate);
+}
+
+
+static SSE2_FUNC void _BLENDAPI
+blend_constant_sse2( GLcontext *ctx, GLuint n, const GLubyte mask[],
+                     GLchan rgba[][4], CONST GLchan dest[][4] )
+{
+   GLfloat f[4];
+   __m128 sf, df;
+
+   get_constant_factor(ctx, ctx->Color.BlendSrcRGB, f);
+   sf = _mm_loadu_ps(f);
+   get_constant_factor(ctx, ctx->Color.BlendDstRGB, f);
+   df = _mm_loadu_ps(f);
+
+#define CONSTANT_SSE2(S, D)  constant_sse2(S, D, sf, df)
+   BLEND_SSE2(WIDE_OP_SSE2(CONSTANT_SSE2, s, d), blend_constant);
+#undef CONSTANT_SSE2
+}
+
+#undef SPLAT_ALPHA_SSE2
+#undef WIDE_OP_SSE2
+#undef ADD_SSE2
+#undef MIN_SSE2
+#undef MAX_SSE2
+#undef BLEND_SSE2
+
+#endif /* USE_SSE2_BLEND */
+
+
+
 /*
  * Analyze current blending parameters to pick fastest blending function.
  * Result: the ctx->Color.BlendFunc pointer is updated.
@@ -768,12 +1193,21 @@ void _swrast_choose_blend_func( GLcontext *ctx )
    const GLenum dstRGB = ctx->Color.BlendDstRGB;
    const GLenum srcA = ctx->Color.BlendSrcA;
    const GLenum dstA = ctx->Color.BlendDstA;
+#if defined(USE_SSE2_BLEND)
+   const GLboolean sse2 = _mesa_have_sse2();
+#endif
 
    if (ctx->Color.BlendEquationRGB != ctx->Color.BlendEquationA) {
       SWRAST_CONTEXT(ctx)->BlendFunc = blend_general;
    }
    else if (eq==GL_MIN) {
       /* Note: GL_MIN ignores the blending weight factors */
+#if defined(USE_SSE2_BLEND)
+      if ( sse2 ) {
+         SWRAST_CONTEXT(ctx)->BlendFunc = blend_min_sse2;
+      }
+      else
+#endif
 #if defined(USE_MMX_ASM)
       if ( cpu_has_mmx ) {
          SWRAST_CONTEXT(ctx)->BlendFunc = _mesa_mmx_blend_min;
@@ -784,6 +1218,12 @@ void _swrast_choose_blend_func( GLcontext *ctx )
    }
    else if (eq==GL_MAX) {
       /* Note: GL_MAX ignores the blending weight factors */
+#if defined(USE_SSE2_BLEND)
+      if ( sse2 ) {
+         SWRAST_CONTEXT(ctx)->BlendFunc = blend_max_sse2;
+      }
+      else
+#endif
 #if defined(USE_MMX_ASM)
       if ( cpu_has_mmx ) {
          SWRAST_CONTEXT(ctx)->BlendFunc = _mesa_mmx_blend_max;
@@ -797,6 +1237,12 @@ void _swrast_choose_blend_func( GLcontext *ctx )
    }
    else if (eq==GL_FUNC_ADD && srcRGB==GL_SRC_ALPHA
             && dstRGB==GL_ONE_MINUS_SRC_ALPHA) {
+#if defined(USE_SSE2_BLEND)
+      if ( sse2 ) {
+         SWRAST_CONTEXT(ctx)->BlendFunc = blend_transparency_sse2;
+      }
+      else
+#endif
 #if defined(USE_MMX_ASM)
       if ( cpu_has_mmx ) {
          SWRAST_CONTEXT(ctx)->BlendFunc = _mesa_mmx_blend_transparency;
@@ -805,7 +1251,23 @@ void _swrast_choose_blend_func( GLcontext *ctx )
 #endif
 	 SWRAST_CONTEXT(ctx)->BlendFunc = blend_transparency;
    }
+   else if (eq==GL_FUNC_ADD && srcRGB==GL_ONE
+            && dstRGB==GL_ONE_MINUS_SRC_ALPHA) {
+#if defined(USE_SSE2_BLEND)
+      if ( sse2 ) {
+         SWRAST_CONTEXT(ctx)->BlendFunc = blend_premultiplied_sse2;
+      }
+      else
+#endif
+         SWRAST_CONTEXT(ctx)->BlendFunc = blend_premultiplied;
+   }
    else if (eq==GL_FUNC_ADD && srcRGB==GL_ONE && dstRGB==GL_ONE) {
+#if defined(USE_SSE2_BLEND)
+      if ( sse2 ) {
+         SWRAST_CONTEXT(ctx)->BlendFunc = blend_add_sse2;
+      }
+      else
+#endif
 #if defined(USE_MMX_ASM)
       if ( cpu_has_mmx ) {
          SWRAST_CONTEXT(ctx)->BlendFunc = _mesa_mmx_blend_add;
@@ -819,6 +1281,12 @@ void _swrast_choose_blend_func( GLcontext *ctx )
 	    ||
 	    ((eq==GL_FUNC_ADD || eq==GL_FUNC_SUBTRACT)
 	     && (srcRGB==GL_DST_COLOR && dstRGB==GL_ZERO))) {
+#if defined(USE_SSE2_BLEND)
+      if ( sse2 ) {
+         SWRAST_CONTEXT(ctx)->BlendFunc = blend_modulate_sse2;
+      }
+      else
+#endif
 #if defined(USE_MMX_ASM)
       if ( cpu_has_mmx ) {
          SWRAST_CONTEXT(ctx)->BlendFunc = _mesa_mmx_blend_modulate;
@@ -833,6 +1301,17 @@ void _swrast_choose_blend_func( GLcontext *ctx )
    else if (eq==GL_FUNC_ADD && srcRGB == GL_ONE && dstRGB == GL_ZERO) {
       SWRAST_CONTEXT(ctx)->BlendFunc = blend_replace;
    }
+   else if (eq==GL_FUNC_ADD && is_constant_factor(srcRGB)
+            && is_constant_factor(dstRGB)) {
+      /* glBlendColor() fades and the like */
+#if defined(USE_SSE2_BLEND)
+      if ( sse2 ) {
+         SWRAST_CONTEXT(ctx)->BlendFunc = blend_constant_sse2;
+      }
+      else
+#endif
+         SWRAST_CONTEXT(ctx)->BlendFunc = blend_constant;
+   }
    else {
       SWRAST_CONTEXT(ctx)->BlendFunc = blend_general;
    }
@@ -850,23 +1329,29 @@ _swrast_blend_span(GLcontext *ctx, struct gl_renderbuffer *rb,
                    const struct sw_span *span, GLchan rgba[][4])
 {
    GLchan framebuffer[MAX_WIDTH][4];
+   const GLchan (*dest)[4];
 
    ASSERT(span->end <= MAX_WIDTH);
    ASSERT(span->arrayMask & SPAN_RGBA);
    ASSERT(!ctx->Color._LogicOpEnabled);
 
-   /* Read span of current frame buffer pixels */
-   if (span->arrayMask & SPAN_XY) {
-      /* array of x/y pixel coords */
-      _swrast_get_values(ctx, rb, span->end, span->array->x, span->array->y,
-                         framebuffer, 4 * sizeof(GLchan));
-   }
-   else {
-      /* horizontal run of pixels */
-      _swrast_read_rgba_span(ctx, rb, span->end, span->x, span->y,
-                             framebuffer);
+   /* Use the current frame buffer pixels in place, if possible */
+   dest = (const GLchan (*)[4]) _swrast_get_rgba_span_pointer(ctx, rb, span);
+   if (!dest) {
+      /* Read span of current frame buffer pixels */
+      if (span->arrayMask & SPAN_XY) {
+         /* array of x/y pixel coords */
+         _swrast_get_values(ctx, rb, span->end, span->array->x,
+                            span->array->y, framebuffer, 4 * sizeof(GLchan));
+      }
+      else {
+         /* horizontal run of pixels */
+         _swrast_read_rgba_span(ctx, rb, span->end, span->x, span->y,
+                                framebuffer);
+      }
+      dest = (const GLchan (*)[4]) framebuffer;
    }
 
    SWRAST_CONTEXT(ctx)->BlendFunc( ctx, span->end, span->array->mask, rgba,
-				   (const GLchan (*)[4]) framebuffer );
+				   dest );
 }
@@ -33,6 +33,7 @@
 #include "s_accum.h"
 #include "s_context.h"
 #include "s_depth.h"
+#include "s_lazyclear.h"
 #include "s_masking.h"
 #include "s_stencil.h"
 
@@ -199,6 +200,57 @@ clear_ci_buffer(GLcontext *ctx, struct gl_renderbuffer *rb)
 }
 
 
+/**
+ * Clear an rgba color buffer by tagging its tiles (see s_lazyclear.c).
+ * Returns GL_FALSE if that can't be done for this buffer.
+ */
+static GLboolean
+lazy_clear_rgba_buffer(GLcontext *ctx, struct gl_renderbuffer *rb)
+{
+   union {
+      GLubyte ub[16];
+      GLushort us[8];
+      GLfloat f[4];
+   } value;
+   GLubyte writemask[16];
+   GLuint comps, size, c;
+
+   if (rb->Wrapped->_BaseFormat == GL_RGBA)
+      comps = 4;
+   else if (rb->Wrapped->_BaseFormat == GL_RGB)
+      comps = 3;
+   else
+      return GL_FALSE;
+
+   switch (rb->Wrapped->DataType) {
+      case GL_UNSIGNED_BYTE:
+         for (c = 0; c < comps; c++)
+            UNCLAMPED_FLOAT_TO_UBYTE(value.ub[c], ctx->Color.ClearColor[c]);
+         size = sizeof(GLubyte);
+         break;
+      case GL_UNSIGNED_SHORT:
+         for (c = 0; c < comps; c++)
+            UNCLAMPED_FLOAT_TO_USHORT(value.us[c], ctx->Color.ClearColor[c]);
+         size = sizeof(GLushort);
+         break;
+      case GL_FLOAT:
+         for (c = 0; c < comps; c++)
+            value.f[c] = ctx->Color.ClearColor[c];
+         size = sizeof(GLfloat);
+         break;
+      default:
+         return GL_FALSE;
+   }
+
+   for (c = 0; c < comps; c++) {
+      _mesa_memset(writemask + c * size,
+                   ctx->Color.ColorMask[c] ? 0xff : 0x0, size);
+   }
+
+   return _swrast_lazy_clear(ctx, rb, value.ub, writemask);
+}
+
+
 /**
  * Clear the front/back/left/right/aux color buffers.
  * This function is usually only called if the device driver can't
@@ -242,7 +294,10 @@ clear_color_buffers(GLcontext *ctx)
 #endif
 
       if (ctx->Visual.rgbMode) {
-         if (masking) {
+         if (lazy_clear_rgba_buffer(ctx, rb)) {
+            /* tiles tagged */
+         }
+         else if (masking) {
             clear_rgba_buffer_with_masking(ctx, rb);
          }
          else {
@@ -303,6 +358,20 @@ _swrast_Clear(GLcontext *ctx, GLbitfield mask,
       if (mask & ctx->DrawBuffer->_ColorDrawBufferMask[0]) {
          clear_color_buffers(ctx);
       }
+      if ((mask & BUFFER_BIT_DEPTH) && (mask & BUFFER_BIT_STENCIL)) {
+         struct gl_renderbuffer *depthRb
+            = ctx->DrawBuffer->Attachment[BUFFER_DEPTH].Renderbuffer;
+         struct gl_renderbuffer *stencilRb
+            = ctx->DrawBuffer->Attachment[BUFFER_STENCIL].Renderbuffer;
+         struct gl_renderbuffer *dsrb
+            = _swrast_get_packed_depth_stencil(ctx, depthRb);
+         if (dsrb &&
+             _swrast_get_packed_depth_stencil(ctx, stencilRb) == dsrb) {
+            /* clear the interleaved depth and stencil values together */
+            _swrast_clear_depth_stencil_buffer(ctx, depthRb);
+            mask &= ~(BUFFER_BIT_DEPTH | BUFFER_BIT_STENCIL);
+         }
+      }
       if (mask & BUFFER_BIT_DEPTH) {
          struct gl_renderbuffer *rb
             = ctx->DrawBuffer->Attachment[BUFFER_DEPTH].Renderbuffer;
@@ -38,11 +38,18 @@
 #include "swrast.h"
 #include "s_blend.h"
 #include "s_context.h"
+#include "s_depth.h"
+#include "s_hiz.h"
+#include "s_lazyclear.h"
 #include "s_lines.h"
+#include "s_nvfragprog.h"
 #include "s_points.h"
+#include "s_readpbo.h"
 #include "s_span.h"
+#include "s_stencil.h"
 #include "s_triangle.h"
 #include "s_texture.h"
+#include "s_tribin.h"
 
 
 /**
@@ -215,6 +222,73 @@ _swrast_update_fog_state( GLcontext *ctx )
 }
 
 
+/**
+ * Multisample framebuffers have wrapper renderbuffers holding one buffer
+ * per sample (see _mesa_add_multisample_renderbuffers()).  Update
+ * swrast->_NumSamples from the draw buffer's renderbuffers.
+ */
+static void
+_swrast_update_multisample( GLcontext *ctx )
+{
+   SWcontext *swrast = SWRAST_CONTEXT(ctx);
+   const struct gl_framebuffer *fb = ctx->DrawBuffer;
+   const struct gl_renderbuffer *rb = NULL;
+
+   swrast->_NumSamples = 0;
+   if (!fb)
+      return;
+
+   if (fb->_NumColorDrawBuffers[0] > 0)
+      rb = fb->_ColorDrawBuffers[0][0];
+   if (!rb)
+      rb = fb->Attachment[BUFFER_DEPTH].Renderbuffer;
+   if (rb && rb->NumSamples > 1)
+      swrast->_NumSamples = rb->NumSamples;
+}
+
+
+/**
+ * Can fragment shading be deferred until after the depth and stencil
+ * tests?  Only if the shading stage can't kill fragments or change
+ * their depth, and the alpha test doesn't depend on its results.
+ * Update swrast->_DeferredShading accordingly.
+ */
+static void
+_swrast_update_deferred_shading( GLcontext *ctx )
+{
+   SWcontext *swrast = SWRAST_CONTEXT(ctx);
+
+   swrast->_DeferredShading = GL_TRUE;
+
+   if (swrast->_NumSamples) {
+      /* fragments are shaded once, then tested and written per sample */
+      swrast->_DeferredShading = GL_FALSE;
+   }
+   else if ((ctx->Color.AlphaEnabled && ctx->Color.AlphaFunc != GL_ALWAYS) ||
+       ctx->ATIFragmentShader._Enabled) {
+      /* note: the ATI fragment shader code may kill fragments */
+      swrast->_DeferredShading = GL_FALSE;
+   }
+   else if (ctx->FragmentProgram._Active) {
+      const struct fragment_program *p = ctx->FragmentProgram._Current;
+      const struct fp_instruction *inst;
+
+      if (!p->Instructions ||
+          (p->OutputsWritten & (1 << FRAG_OUTPUT_DEPR))) {
+         swrast->_DeferredShading = GL_FALSE;
+         return;
+      }
+      for (inst = p->Instructions; inst->Opcode != FP_OPCODE_END; inst++) {
+         if (inst->Opcode == FP_OPCODE_KIL ||
+             inst->Opcode == FP_OPCODE_KIL_NV) {
+            swrast->_DeferredShading = GL_FALSE;
+            return;
+         }
+      }
+   }
+}
+
+
 /**
  * Update state for running fragment programs.  Basically, load the
  * program parameters with current state values.
@@ -226,6 +300,7 @@ _swrast_update_fragment_program( GLcontext *ctx )
       struct fragment_program *program = ctx->FragmentProgram._Current;
       _mesa_load_state_parameters(ctx, program->Parameters);
    }
+   _swrast_sse_invalidate_fragment_program( ctx );
 }
 
 
@@ -247,6 +322,7 @@ _swrast_update_fragment_program( GLcontext *ctx )
                               _SWRAST_NEW_RASTERMASK|		\
                               _NEW_LIGHT|			\
                               _NEW_FOG |			\
+                              _NEW_MULTISAMPLE |		\
 			      _DD_NEW_SEPARATE_SPECULAR)
 
 #define _SWRAST_NEW_LINE (_SWRAST_NEW_DERIVED |		\
@@ -272,6 +348,12 @@ _swrast_update_fragment_program( GLcontext *ctx )
 
 #define _SWRAST_NEW_BLEND_FUNC _NEW_COLOR
 
+#define _SWRAST_NEW_DEPTH_FUNC _NEW_DEPTH
+
+
+
+static void
+_swrast_validate_span_funcs( GLcontext *ctx );
 
 
 /**
@@ -287,8 +369,16 @@ _swrast_validate_triangle( GLcontext *ctx,
    SWcontext *swrast = SWRAST_CONTEXT(ctx);
 
    _swrast_validate_derived( ctx );
+   _swrast_validate_hiz( ctx );
    swrast->choose_triangle( ctx );
 
+   if (_swrast_can_bin_triangles( ctx )) {
+      /* The worker threads must not validate anything themselves */
+      _swrast_validate_span_funcs( ctx );
+      swrast->BinTriangle = swrast->Triangle;
+      swrast->Triangle = _swrast_bin_triangle;
+   }
+
    if (ctx->Texture._EnabledUnits == 0
        && NEED_SECONDARY_COLOR(ctx)
        && !ctx->FragmentProgram._Active) {
@@ -301,34 +391,56 @@ _swrast_validate_triangle( GLcontext *ctx,
 }
 
 /**
- * Called via swrast->Line.  Examine current GL state and choose a software
- * line routine.  Then call it.
+ * Examine current GL state and choose the software line routines for
+ * swrast->Line and swrast->Lines.
  */
 static void
-_swrast_validate_line( GLcontext *ctx, const SWvertex *v0, const SWvertex *v1 )
+_swrast_choose_line_funcs( GLcontext *ctx )
 {
    SWcontext *swrast = SWRAST_CONTEXT(ctx);
 
    _swrast_validate_derived( ctx );
    swrast->choose_line( ctx );
+   _swrast_choose_lines( ctx );
 
    if (ctx->Texture._EnabledUnits == 0
        && NEED_SECONDARY_COLOR(ctx)
        && !ctx->FragmentProgram._Active) {
       swrast->SpecLine = swrast->Line;
       swrast->Line = _swrast_add_spec_terms_line;
+      swrast->Lines = _swrast_loop_lines;
    }
+}
 
+/**
+ * Called via swrast->Line.  Choose the software line routines, then
+ * call the new one.
+ */
+static void
+_swrast_validate_line( GLcontext *ctx, const SWvertex *v0, const SWvertex *v1 )
+{
+   _swrast_choose_line_funcs( ctx );
+   SWRAST_CONTEXT(ctx)->Line( ctx, v0, v1 );
+}
 
-   swrast->Line( ctx, v0, v1 );
+/**
+ * Called via swrast->Lines.  Choose the software line routines, then
+ * call the new one.
+ */
+static void
+_swrast_validate_lines( GLcontext *ctx, const SWvertex *verts,
+                        const GLuint *elts, GLuint count, GLenum mode )
+{
+   _swrast_choose_line_funcs( ctx );
+   SWRAST_CONTEXT(ctx)->Lines( ctx, verts, elts, count, mode );
 }
 
 /**
- * Called via swrast->Point.  Examine current GL state and choose a software
- * point routine.  Then call it.
+ * Examine current GL state and choose the software point routines for
+ * swrast->Point and swrast->Points.
  */
 static void
-_swrast_validate_point( GLcontext *ctx, const SWvertex *v0 )
+_swrast_choose_point_funcs( GLcontext *ctx )
 {
    SWcontext *swrast = SWRAST_CONTEXT(ctx);
 
@@ -340,9 +452,31 @@ _swrast_validate_point( GLcontext *ctx, const SWvertex *v0 )
        && !ctx->FragmentProgram._Active) {
       swrast->SpecPoint = swrast->Point;
       swrast->Point = _swrast_add_spec_terms_point;
+      swrast->Points = _swrast_loop_points;
    }
+}
 
-   swrast->Point( ctx, v0 );
+/**
+ * Called via swrast->Point.  Choose the software point routines, then
+ * call the new one.
+ */
+static void
+_swrast_validate_point( GLcontext *ctx, const SWvertex *v0 )
+{
+   _swrast_choose_point_funcs( ctx );
+   SWRAST_CONTEXT(ctx)->Point( ctx, v0 );
+}
+
+/**
+ * Called via swrast->Points.  Choose the software point routines, then
+ * call the new one.
+ */
+static void
+_swrast_validate_points( GLcontext *ctx, const SWvertex *verts,
+                         const GLuint *elts, GLuint count )
+{
+   _swrast_choose_point_funcs( ctx );
+   SWRAST_CONTEXT(ctx)->Points( ctx, verts, elts, count );
 }
 
 
@@ -366,22 +500,40 @@ _swrast_validate_blend_func( GLcontext *ctx, GLuint n,
 
 
 /**
- * Called via the swrast->TextureSample[i] function pointer.
- * Basically, given a texture object, an array of texture coords
- * and an array of level-of-detail values, return an array of colors.
- * In this case, determine the correct texture sampling routine
- * (depending on filter mode, texture dimensions, etc) then call the
- * sampler routine.
+ * Called via swrast->DepthTestSpan16/32.  Choose the depth test
+ * functions for the current depth func and mask, then call one.
  */
-static void
-_swrast_validate_texture_sample( GLcontext *ctx, GLuint texUnit,
-				 const struct gl_texture_object *tObj,
-				 GLuint n, const GLfloat texcoords[][4],
-				 const GLfloat lambda[], GLchan rgba[][4] )
+static GLuint
+_swrast_validate_depth_span16( GLcontext *ctx, GLuint n, GLushort zbuffer[],
+                               const GLuint z[], GLubyte mask[] )
 {
    SWcontext *swrast = SWRAST_CONTEXT(ctx);
 
-   _swrast_validate_derived( ctx );
+   _swrast_choose_depth_funcs( ctx );
+
+   return swrast->DepthTestSpan16( ctx, n, zbuffer, z, mask );
+}
+
+static GLuint
+_swrast_validate_depth_span32( GLcontext *ctx, GLuint n, GLuint zbuffer[],
+                               const GLuint z[], GLubyte mask[] )
+{
+   SWcontext *swrast = SWRAST_CONTEXT(ctx);
+
+   _swrast_choose_depth_funcs( ctx );
+
+   return swrast->DepthTestSpan32( ctx, n, zbuffer, z, mask );
+}
+
+
+/**
+ * Choose the texture sampling routine for one texture unit.
+ */
+static void
+_swrast_update_texture_sample( GLcontext *ctx, GLuint texUnit,
+                               const struct gl_texture_object *tObj )
+{
+   SWcontext *swrast = SWRAST_CONTEXT(ctx);
 
    /* Compute min/mag filter threshold */
    if (tObj && tObj->MinFilter != tObj->MagFilter) {
@@ -397,12 +549,57 @@ _swrast_validate_texture_sample( GLcontext *ctx, GLuint texUnit,
 
    swrast->TextureSample[texUnit] =
       _swrast_choose_texture_sample_func( ctx, tObj );
+}
+
+
+/**
+ * Called via the swrast->TextureSample[i] function pointer.
+ * Basically, given a texture object, an array of texture coords
+ * and an array of level-of-detail values, return an array of colors.
+ * In this case, determine the correct texture sampling routine
+ * (depending on filter mode, texture dimensions, etc) then call the
+ * sampler routine.
+ */
+static void
+_swrast_validate_texture_sample( GLcontext *ctx, GLuint texUnit,
+				 const struct gl_texture_object *tObj,
+				 GLuint n, const GLfloat texcoords[][4],
+				 const GLfloat lambda[], GLchan rgba[][4] )
+{
+   SWcontext *swrast = SWRAST_CONTEXT(ctx);
+
+   _swrast_validate_derived( ctx );
+   _swrast_update_texture_sample( ctx, texUnit, tObj );
 
    swrast->TextureSample[texUnit]( ctx, texUnit, tObj, n, texcoords,
                                    lambda, rgba );
 }
 
 
+/**
+ * Validate the blend, depth and texture sampling functions which are
+ * otherwise chosen lazily by the span code on first use.
+ */
+static void
+_swrast_validate_span_funcs( GLcontext *ctx )
+{
+   SWcontext *swrast = SWRAST_CONTEXT(ctx);
+   GLuint i;
+
+   if (swrast->BlendFunc == _swrast_validate_blend_func)
+      _swrast_choose_blend_func( ctx );
+
+   if (swrast->DepthTestSpan16 == _swrast_validate_depth_span16)
+      _swrast_choose_depth_funcs( ctx );
+
+   for (i = 0; i < ctx->Const.MaxTextureUnits; i++) {
+      if (ctx->Texture.Unit[i]._ReallyEnabled &&
+          swrast->TextureSample[i] == _swrast_validate_texture_sample)
+         _swrast_update_texture_sample( ctx, i, ctx->Texture.Unit[i]._Current );
+   }
+}
+
+
 static void
 _swrast_sleep( GLcontext *ctx, GLuint new_state )
 {
@@ -430,15 +627,24 @@ _swrast_invalidate_state( GLcontext *ctx, GLuint new_state )
    if (new_state & swrast->invalidate_triangle)
       swrast->Triangle = _swrast_validate_triangle;
 
-   if (new_state & swrast->invalidate_line)
+   if (new_state & swrast->invalidate_line) {
       swrast->Line = _swrast_validate_line;
+      swrast->Lines = _swrast_validate_lines;
+   }
 
-   if (new_state & swrast->invalidate_point)
+   if (new_state & swrast->invalidate_point) {
       swrast->Point = _swrast_validate_point;
+      swrast->Points = _swrast_validate_points;
+   }
 
    if (new_state & _SWRAST_NEW_BLEND_FUNC)
       swrast->BlendFunc = _swrast_validate_blend_func;
 
+   if (new_state & _SWRAST_NEW_DEPTH_FUNC) {
+      swrast->DepthTestSpan16 = _swrast_validate_depth_span16;
+      swrast->DepthTestSpan32 = _swrast_validate_depth_span32;
+   }
+
    if (new_state & _SWRAST_NEW_TEXTURE_SAMPLE_FUNC)
       for (i = 0 ; i < ctx->Const.MaxTextureUnits ; i++)
 	 swrast->TextureSample[i] = _swrast_validate_texture_sample;
@@ -469,6 +675,12 @@ _swrast_validate_derived( GLcontext *ctx )
       if (swrast->NewState & _NEW_PROGRAM)
 	 _swrast_update_fragment_program( ctx );
 
+      if (swrast->NewState & _NEW_BUFFERS)
+         _swrast_update_multisample( ctx );
+
+      if (swrast->NewState & (_NEW_COLOR | _NEW_PROGRAM | _NEW_BUFFERS))
+         _swrast_update_deferred_shading( ctx );
+
       swrast->NewState = 0;
       swrast->StateChanges = 0;
       swrast->InvalidateState = _swrast_invalidate_state;
@@ -491,6 +703,10 @@ _swrast_Quad( GLcontext *ctx,
       _swrast_print_vertex( ctx, v2 );
       _swrast_print_vertex( ctx, v3 );
    }
+   if (ctx->RenderMode == GL_RENDER && _swrast_lazy_clear_draw_pending(ctx)) {
+      _swrast_resolve_lazy_clear_prim( ctx, v0, v1, v3, 0.0F );
+      _swrast_resolve_lazy_clear_prim( ctx, v1, v2, v3, 0.0F );
+   }
    SWRAST_CONTEXT(ctx)->Triangle( ctx, v0, v1, v3 );
    SWRAST_CONTEXT(ctx)->Triangle( ctx, v1, v2, v3 );
 }
@@ -505,6 +721,8 @@ _swrast_Triangle( GLcontext *ctx, const SWvertex *v0,
       _swrast_print_vertex( ctx, v1 );
       _swrast_print_vertex( ctx, v2 );
    }
+   if (ctx->RenderMode == GL_RENDER && _swrast_lazy_clear_draw_pending(ctx))
+      _swrast_resolve_lazy_clear_prim( ctx, v0, v1, v2, 0.0F );
    SWRAST_CONTEXT(ctx)->Triangle( ctx, v0, v1, v2 );
 }
 
@@ -516,9 +734,26 @@ _swrast_Line( GLcontext *ctx, const SWvertex *v0, const SWvertex *v1 )
       _swrast_print_vertex( ctx, v0 );
       _swrast_print_vertex( ctx, v1 );
    }
+   _swrast_flush_bins( ctx );
+   if (ctx->RenderMode == GL_RENDER && _swrast_lazy_clear_draw_pending(ctx))
+      _swrast_resolve_lazy_clear_prim( ctx, v0, v1, v1,
+                                       ctx->Line._Width * 0.5F );
    SWRAST_CONTEXT(ctx)->Line( ctx, v0, v1 );
 }
 
+void
+_swrast_Lines( GLcontext *ctx, const SWvertex *verts, const GLuint *elts,
+               GLuint count, GLenum mode )
+{
+   if (SWRAST_DEBUG) {
+      _mesa_debug(ctx, "_swrast_Lines 0x%x %u\n", mode, count);
+   }
+   _swrast_flush_bins( ctx );
+   if (ctx->RenderMode == GL_RENDER && _swrast_lazy_clear_draw_pending(ctx))
+      _swrast_resolve_lazy_clear_lines( ctx, verts, elts, count );
+   SWRAST_CONTEXT(ctx)->Lines( ctx, verts, elts, count, mode );
+}
+
 void
 _swrast_Point( GLcontext *ctx, const SWvertex *v0 )
 {
@@ -526,9 +761,27 @@ _swrast_Point( GLcontext *ctx, const SWvertex *v0 )
       _mesa_debug(ctx, "_swrast_Point\n");
       _swrast_print_vertex( ctx, v0 );
    }
+   _swrast_flush_bins( ctx );
+   if (ctx->RenderMode == GL_RENDER && _swrast_lazy_clear_draw_pending(ctx))
+      _swrast_resolve_lazy_clear_prim( ctx, v0, v0, v0,
+                                       MAX2(ctx->Point._Size,
+                                            v0->pointSize) * 0.5F );
    SWRAST_CONTEXT(ctx)->Point( ctx, v0 );
 }
 
+void
+_swrast_Points( GLcontext *ctx, const SWvertex *verts, const GLuint *elts,
+                GLuint count )
+{
+   if (SWRAST_DEBUG) {
+      _mesa_debug(ctx, "_swrast_Points %u\n", count);
+   }
+   _swrast_flush_bins( ctx );
+   if (ctx->RenderMode == GL_RENDER && _swrast_lazy_clear_draw_pending(ctx))
+      _swrast_resolve_lazy_clear_points( ctx, verts, elts, count );
+   SWRAST_CONTEXT(ctx)->Points( ctx, verts, elts, count );
+}
+
 void
 _swrast_InvalidateState( GLcontext *ctx, GLuint new_state )
 {
@@ -567,6 +820,82 @@ _swrast_allow_pixel_fog( GLcontext *ctx, GLboolean value )
    SWRAST_CONTEXT(ctx)->AllowPixelFog = value;
 }
 
+/**
+ * Let swrast rasterize triangles with multiple threads (see s_tribin.c).
+ * Only drivers whose renderbuffer and triangle functions may be called
+ * concurrently for different rows should enable this.
+ */
+void
+_swrast_allow_binning( GLcontext *ctx, GLboolean value )
+{
+   SWcontext *swrast = SWRAST_CONTEXT(ctx);
+
+   if (SWRAST_DEBUG) {
+      _mesa_debug(ctx, "_swrast_allow_binning %d\n", value);
+   }
+   swrast->Triangle = _swrast_validate_triangle;
+   swrast->AllowBinning = value;
+
+   if (value)
+      _swrast_init_bins( ctx );
+   else
+      _swrast_destroy_bins( ctx );
+}
+
+
+/**
+ * Let swrast clear depth and stencil buffers lazily (see s_lazyclear.c).
+ * Only drivers which never access those buffers' memory behind swrast's
+ * back should enable this.  Setting the MESA_NO_LAZY_CLEAR env var
+ * disables lazy clears.
+ */
+void
+_swrast_allow_lazy_clears( GLcontext *ctx, GLboolean value )
+{
+   if (SWRAST_DEBUG) {
+      _mesa_debug(ctx, "_swrast_allow_lazy_clears %d\n", value);
+   }
+   SWRAST_CONTEXT(ctx)->AllowLazyClears
+      = value && !_mesa_getenv("MESA_NO_LAZY_CLEAR");
+}
+
+
+/**
+ * Let glReadPixels into a pixel buffer object return before the pixels
+ * are stored into the buffer (see s_readpbo.c).  The driver must use
+ * the _swrast_*Buffer* functions for its buffer objects, or otherwise
+ * never access their memory behind core Mesa's back.  Setting the
+ * MESA_NO_ASYNC_READPIXELS env var disables this.
+ */
+void
+_swrast_allow_async_readpixels( GLcontext *ctx, GLboolean value )
+{
+   if (SWRAST_DEBUG) {
+      _mesa_debug(ctx, "_swrast_allow_async_readpixels %d\n", value);
+   }
+   SWRAST_CONTEXT(ctx)->AllowAsyncReadPixels
+      = value && !_mesa_getenv("MESA_NO_ASYNC_READPIXELS");
+}
+
+
+/**
+ * Return the number of fragments which weren't textured or run through
+ * a fragment program because they had failed the depth/stencil test
+ * (or color writes were off), optionally resetting the count.  Setting
+ * the MESA_SWRAST_STATS env var prints the total when the context is
+ * destroyed.
+ */
+GLuint
+_swrast_get_skipped_fragments( GLcontext *ctx, GLboolean reset )
+{
+   SWcontext *swrast = SWRAST_CONTEXT(ctx);
+   const GLuint count = swrast->SkippedFragments;
+
+   if (reset)
+      swrast->SkippedFragments = 0;
+   return count;
+}
+
 
 GLboolean
 _swrast_CreateContext( GLcontext *ctx )
@@ -592,10 +921,14 @@ _swrast_CreateContext( GLcontext *ctx )
    swrast->invalidate_triangle = _SWRAST_NEW_TRIANGLE;
 
    swrast->Point = _swrast_validate_point;
+   swrast->Points = _swrast_validate_points;
    swrast->Line = _swrast_validate_line;
+   swrast->Lines = _swrast_validate_lines;
    swrast->Triangle = _swrast_validate_triangle;
    swrast->InvalidateState = _swrast_sleep;
    swrast->BlendFunc = _swrast_validate_blend_func;
+   swrast->DepthTestSpan16 = _swrast_validate_depth_span16;
+   swrast->DepthTestSpan32 = _swrast_validate_depth_span32;
 
    swrast->AllowVertexFog = GL_TRUE;
    swrast->AllowPixelFog = GL_TRUE;
@@ -612,6 +945,9 @@ _swrast_CreateContext( GLcontext *ctx )
    for (i = 0; i < MAX_TEXTURE_IMAGE_UNITS; i++)
       swrast->TextureSample[i] = _swrast_validate_texture_sample;
 
+   _swrast_init_texture_filters();
+   _swrast_init_stencil_funcs();
+
    swrast->SpanArrays = MALLOC_STRUCT(span_arrays);
    if (!swrast->SpanArrays) {
       FREE(swrast);
@@ -650,6 +986,18 @@ _swrast_DestroyContext( GLcontext *ctx )
       _mesa_debug(ctx, "_swrast_DestroyContext\n");
    }
 
+   if (_mesa_getenv("MESA_SWRAST_STATS")) {
+      _mesa_debug(ctx, "swrast: %u fragments skipped shading\n",
+                  swrast->SkippedFragments);
+   }
+
+   _swrast_destroy_bins( ctx );
+   _swrast_stop_pack_worker( ctx );
+   _swrast_destroy_hiz( ctx );
+   _swrast_sse_destroy_fragment_programs( ctx );
+   if (swrast->FragProgSpanMachine)
+      _mesa_align_free( swrast->FragProgSpanMachine );
+
    FREE( swrast->SpanArrays );
    FREE( swrast->TexelBuffer );
    FREE( swrast );
@@ -679,6 +1027,8 @@ _swrast_flush( GLcontext *ctx )
       }
       swrast->PointSpan.end = 0;
    }
+   /* and any binned triangles */
+   _swrast_flush_bins(ctx);
 }
 
 void
@@ -705,6 +1055,7 @@ void
 _swrast_render_finish( GLcontext *ctx )
 {
    SWcontext *swrast = SWRAST_CONTEXT(ctx);
+   _swrast_flush_bins(ctx);
    if (swrast->Driver.SpanRenderFinish)
       swrast->Driver.SpanRenderFinish( ctx );
 
@@ -68,6 +68,8 @@
 /** sw_span::arrayMask only - for span_arrays::x, span_arrays::y */
 #define SPAN_XY           0x800
 #define SPAN_MASK        0x1000  /**< sw_span::arrayMask only */
+/** sw_span::arrayMask only - for span_arrays::samples */
+#define SPAN_SAMPLES     0x2000
 /*@}*/
 
 
@@ -91,6 +93,7 @@ struct span_arrays {
    GLfloat texcoords[MAX_TEXTURE_COORD_UNITS][MAX_WIDTH][4];
    GLfloat lambda[MAX_TEXTURE_COORD_UNITS][MAX_WIDTH];
    GLfloat coverage[MAX_WIDTH];
+   GLubyte samples[MAX_WIDTH];  /**< multisample coverage, one bit/sample */
 
    /** This mask indicates if fragment is alive or culled */
    GLubyte mask[MAX_WIDTH];
@@ -181,6 +184,9 @@ struct sw_span {
    GLfloat dsbdx, dsbdy;
    GLfloat dfogdx, dfogdy;
 
+   /** Z offset of each sample from the pixel center, for multisampling */
+   GLfloat sampleZ[MAX_SAMPLES];
+
    /**
     * This bitmask (of \link SpanFlags SPAN_* flags\endlink) indicates
     * which of the fragment arrays in the span_arrays struct are relevant.
@@ -205,7 +211,7 @@ do {								\
    (S).start = 0;						\
    (S).end = (END);						\
    (S).facing = 0;						\
-   (S).array = SWRAST_CONTEXT(ctx)->SpanArrays;			\
+   (S).array = SWRAST_SPAN_ARRAYS(SWRAST_CONTEXT(ctx));		\
 } while (0)
 
 
@@ -218,11 +224,29 @@ typedef void (_ASMAPIP blend_func)( GLcontext *ctx, GLuint n,
                                     const GLubyte mask[],
                                     GLchan src[][4], CONST GLchan dst[][4] );
 
+typedef GLuint (*depth_span16_func)( GLcontext *ctx, GLuint n,
+                                     GLushort zbuffer[], const GLuint z[],
+                                     GLubyte mask[] );
+
+typedef GLuint (*depth_span32_func)( GLcontext *ctx, GLuint n,
+                                     GLuint zbuffer[], const GLuint z[],
+                                     GLubyte mask[] );
+
 typedef void (*swrast_point_func)( GLcontext *ctx, const SWvertex *);
 
+/** Number of entries in SWcontext::PointStamp, a power of two */
+#define SWRAST_POINT_STAMPS 4096
+
+typedef void (*swrast_points_func)( GLcontext *ctx, const SWvertex *verts,
+                                    const GLuint *elts, GLuint count );
+
 typedef void (*swrast_line_func)( GLcontext *ctx,
                                   const SWvertex *, const SWvertex *);
 
+typedef void (*swrast_lines_func)( GLcontext *ctx, const SWvertex *verts,
+                                   const GLuint *elts, GLuint count,
+                                   GLenum mode );
+
 typedef void (*swrast_tri_func)( GLcontext *ctx, const SWvertex *,
                                  const SWvertex *, const SWvertex *);
 
@@ -287,6 +311,8 @@ typedef struct
    GLchan _FogColor[3];
    GLboolean _FogEnabled;
    GLenum _FogMode;  /* either GL_FOG_MODE or fragment program's fog mode */
+   GLboolean _DeferredShading;  /* shade fragments after depth/stencil test? */
+   GLuint _NumSamples;  /* samples/pixel of the draw buffer, 0 if single */
 
    /* Accum buffer temporaries.
     */
@@ -319,7 +345,9 @@ typedef struct
    void (*InvalidateState)( GLcontext *ctx, GLuint new_state );
 
    swrast_point_func Point;
+   swrast_points_func Points;
    swrast_line_func Line;
+   swrast_lines_func Lines;
    swrast_tri_func Triangle;
    /*@}*/
 
@@ -333,6 +361,42 @@ typedef struct
    swrast_tri_func SpecTriangle;
    /*@}*/
 
+   /**
+    * Tile-binned triangle rasterization, see s_tribin.c.  When binning
+    * is active, swrast->Triangle records triangles into the bins and
+    * BinTriangle holds the real triangle function used to replay them.
+    */
+   /*@{*/
+   GLboolean AllowBinning;
+   GLboolean _BinRunning;     /**< worker threads are replaying bins */
+   swrast_tri_func BinTriangle;
+   struct swrast_bin_state *Bin;
+   /*@}*/
+
+   /** Clear depth/stencil buffers and FBOs lazily, see s_lazyclear.c */
+   GLboolean AllowLazyClears;
+
+   /** Asynchronous glReadPixels into PBOs, see s_readpbo.c */
+   /*@{*/
+   GLboolean AllowAsyncReadPixels;
+   GLboolean _PackWorkerRef;  /**< holds a reference on the worker thread */
+   /*@}*/
+
+   /**
+    * Hierarchical Z, see s_hiz.c.  _HiZActive is set when the current
+    * depth state lets triangles be rejected against HiZ.
+    */
+   /*@{*/
+   struct swrast_hiz *HiZ;
+   GLboolean _HiZActive;
+   /*@}*/
+
+   /** Fragment programs compiled to SSE code, see s_fragprog_sse.c */
+   struct fp_sse_cache *FragProgSSE;
+
+   /** Register file for the span fragment program interpreter */
+   struct fp_span_machine *FragProgSpanMachine;
+
    /**
     * Typically, we'll allocate a sw_span structure as a local variable
     * and set its 'array' pointer to point to this object.  The reason is
@@ -346,16 +410,33 @@ typedef struct
     */
    struct sw_span PointSpan;
 
+   /**
+    * Which 2x2 pixel cells the fragments in PointSpan cover, for
+    * blending points without overlapping fragments in one span.  A cell
+    * is covered if its entry equals PointStampGen, see s_points.c.
+    */
+   /*@{*/
+   GLuint PointStamp[SWRAST_POINT_STAMPS];
+   GLuint PointStampGen;
+   /*@}*/
+
    /** Internal hooks, kept uptodate by the same mechanism as above.
     */
    blend_func BlendFunc;
    texture_sample_func TextureSample[MAX_TEXTURE_IMAGE_UNITS];
+   depth_span16_func DepthTestSpan16;
+   depth_span32_func DepthTestSpan32;
 
    /** Buffer for saving the sampled texture colors.
     * Needed for GL_ARB_texture_env_crossbar implementation.
     */
    GLchan *TexelBuffer;
 
+   /** Number of fragments which weren't shaded because they failed the
+    * depth/stencil test first, see _swrast_get_skipped_fragments().
+    */
+   GLuint SkippedFragments;
+
 } SWcontext;
 
 
@@ -365,6 +446,116 @@ _swrast_validate_derived( GLcontext *ctx );
 
 #define SWRAST_CONTEXT(ctx) ((SWcontext *)ctx->swrast_context)
 
+
+/**
+ * Per-thread rasterization scratch space.  While binned triangles are
+ * being replayed every thread needs its own span arrays and texel
+ * buffer, and may only write the window rows [YMin, YMax).  The
+ * statistics counters are kept per thread too and summed up afterwards.
+ */
+struct swrast_bin_thread {
+   struct swrast_bin_state *Bin;
+   struct span_arrays *SpanArrays;
+   GLchan *TexelBuffer;
+   GLint YMin, YMax;
+   GLuint SkippedFragments;
+};
+
+extern struct swrast_bin_thread *
+_swrast_get_bin_thread( void );
+
+#define SWRAST_SPAN_ARRAYS(swrast)					\
+   ((swrast)->_BinRunning ? _swrast_get_bin_thread()->SpanArrays	\
+                          : (swrast)->SpanArrays)
+
+#define SWRAST_TEXEL_BUFFER(swrast)					\
+   ((swrast)->_BinRunning ? _swrast_get_bin_thread()->TexelBuffer	\
+                          : (swrast)->TexelBuffer)
+
+#define SWRAST_COUNT_SKIPPED(swrast, N)					\
+do {									\
+   if ((swrast)->_BinRunning)						\
+      _swrast_get_bin_thread()->SkippedFragments += (N);		\
+   else									\
+      (swrast)->SkippedFragments += (N);				\
+} while (0)
+
+#define SWRAST_BIN_ROWS(swrast, YMIN, YMAX)				\
+do {									\
+   if ((swrast)->_BinRunning) {						\
+      const struct swrast_bin_thread *binThread = _swrast_get_bin_thread(); \
+      (YMIN) = binThread->YMin;						\
+      (YMAX) = binThread->YMax;						\
+   }									\
+   else {								\
+      (YMIN) = 0;							\
+      (YMAX) = MAX_HEIGHT;						\
+   }									\
+} while (0)
+
+
+/**
+ * Hierarchical Z state.  The depth buffer is divided into 8x8 pixel
+ * tiles and for each tile we keep the largest depth value it contains.
+ * The largest value in each 8-pixel row of a tile (a strip) is kept too
+ * so that spans can be tested and the tile maxima updated cheaply.
+ */
+struct swrast_hiz {
+   struct gl_renderbuffer *Renderbuffer;  /**< the depth buffer tracked */
+   GLuint Width, Height;                  /**< size of Renderbuffer */
+   GLuint TilesX, TilesY;
+   GLuint *StripMax;    /**< [y * TilesX + tileX] */
+   GLuint *TileMax;     /**< [tileY * TilesX + tileX] */
+   GLuint Bias;         /**< 1 for GL_LESS, 0 for GL_LEQUAL */
+   GLboolean Disabled;  /**< set by the MESA_NO_HIZ env var */
+};
+
+#define HIZ_TILE_SHIFT 3
+#define HIZ_TILE_SIZE  (1 << HIZ_TILE_SHIFT)
+
+extern GLboolean
+_swrast_hiz_reject_triangle( GLcontext *ctx, const SWvertex *v0,
+                             const SWvertex *v1, const SWvertex *v2,
+                             GLint yMin, GLint yMax );
+
+
+/**
+ * Test if every fragment of a span with interpolated Z is sure to fail
+ * the depth test.  The span's Z values are linear so the smaller of the
+ * end points bounds them.  zShift converts span Z to depth buffer values.
+ */
+static INLINE GLboolean
+_swrast_hiz_reject_span( const struct swrast_hiz *hiz,
+                         const struct sw_span *span, GLint zShift )
+{
+   const GLfixed zEnd = (GLfixed) ((GLuint) span->z +
+                                   (GLuint) span->zStep * (span->end - 1));
+   const GLfixed zMin = (span->z < zEnd) ? span->z : zEnd;
+   const GLuint *strip;
+   GLint x = span->x, n = span->end, tx, tx1;
+   GLuint z;
+
+   if (zMin < 0 || span->y < 0 || span->y >= (GLint) hiz->Height)
+      return GL_FALSE;
+   if (x < 0) {
+      n += x;
+      x = 0;
+   }
+   if (x + n > (GLint) hiz->Width)
+      n = hiz->Width - x;
+   if (n <= 0)
+      return GL_FALSE;
+
+   z = ((GLuint) zMin >> zShift) + hiz->Bias;
+   strip = hiz->StripMax + span->y * hiz->TilesX;
+   tx1 = (x + n - 1) >> HIZ_TILE_SHIFT;
+   for (tx = x >> HIZ_TILE_SHIFT; tx <= tx1; tx++) {
+      if (z <= strip[tx])
+         return GL_FALSE;
+   }
+   return GL_TRUE;
+}
+
 #define RENDER_START(SWctx, GLctx)			\
    do {							\
       if ((SWctx)->Driver.SpanRenderStart) {		\
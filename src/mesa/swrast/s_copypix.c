@@ -35,6 +35,8 @@
 
 #include "s_context.h"
 #include "s_depth.h"
+#include "s_drawpix.h"
+#include "s_lazyclear.h"
 #include "s_pixeltex.h"
 #include "s_span.h"
 #include "s_stencil.h"
@@ -44,10 +46,12 @@
 
 
 /*
- * Determine if there's overlap in an image copy.
- * This test also compensates for the fact that copies are done from
- * bottom to top and overlaps can sometimes be handled correctly
- * without making a temporary image copy.
+ * Determine if there's overlap in an image copy which requires a
+ * temporary image copy.
+ * Copies are done row by row from the top when the destination is above
+ * the source and from the bottom otherwise.  Without zoom that means a
+ * source row is always read before it can be overwritten, whatever the
+ * overlap.
  */
 static GLboolean
 regions_overlap(GLint srcx, GLint srcy,
@@ -57,18 +61,7 @@ regions_overlap(GLint srcx, GLint srcy,
 {
    if (zoomX == 1.0 && zoomY == 1.0) {
       /* no zoom */
-      if (srcx >= dstx + width || (srcx + width <= dstx)) {
-         return GL_FALSE;
-      }
-      else if (srcy < dsty) { /* this is OK */
-         return GL_FALSE;
-      }
-      else if (srcy > dsty + height) {
-         return GL_FALSE;
-      }
-      else {
-         return GL_TRUE;
-      }
+      return GL_FALSE;
    }
    else {
       /* add one pixel of slop when zooming, just to be safe */
@@ -123,6 +116,36 @@ chan_span_to_float(GLuint n, CONST GLchan in[][4], GLfloat out[][4])
 
 
 
+#if CHAN_BITS == 8
+/**
+ * Compute the results of the transfer operations for each possible
+ * component value, converting to and from float like copy_rgba_pixels().
+ */
+static void
+build_transfer_lut(GLcontext *ctx, GLuint transferOps, GLchan lut[4][256])
+{
+   GLchan ramp[256][4];
+   GLfloat rgbaFloat[256][4];
+   GLuint i;
+
+   ASSERT((transferOps & ~LUT_TRANSFER_OPS) == 0);
+
+   for (i = 0; i < 256; i++) {
+      ramp[i][0] = ramp[i][1] = ramp[i][2] = ramp[i][3] = (GLchan) i;
+   }
+   chan_span_to_float(256, (CONST GLchan (*)[4]) ramp, rgbaFloat);
+   _mesa_apply_rgba_transfer_ops(ctx, transferOps, 256, rgbaFloat);
+   float_span_to_chan(256, (CONST GLfloat (*)[4]) rgbaFloat, ramp);
+   for (i = 0; i < 256; i++) {
+      lut[RCOMP][i] = ramp[i][RCOMP];
+      lut[GCOMP][i] = ramp[i][GCOMP];
+      lut[BCOMP][i] = ramp[i][BCOMP];
+      lut[ACOMP][i] = ramp[i][ACOMP];
+   }
+}
+#endif
+
+
 /*
  * RGBA copypixels with convolution.
  */
@@ -280,6 +303,10 @@ copy_rgba_pixels(GLcontext *ctx, GLint srcx, GLint srcy,
    const GLboolean zoom = ctx->Pixel.ZoomX != 1.0F || ctx->Pixel.ZoomY != 1.0F;
    GLint overlapping;
    const GLuint transferOps = ctx->_ImageTransferState;
+#if CHAN_BITS == 8
+   GLchan lut[4][256];
+   GLboolean useLut;
+#endif
    struct sw_span span;
 
    if (!ctx->ReadBuffer->_ColorReadBuffer) {
@@ -337,6 +364,13 @@ copy_rgba_pixels(GLcontext *ctx, GLint srcx, GLint srcy,
    changeBuffer = ctx->Pixel.ReadBuffer != ctx->Color.DrawBuffer[0]
                   || ctx->DrawBuffer != ctx->ReadBuffer;
 
+#if CHAN_BITS == 8
+   /* scale/bias and color map by table lookup */
+   useLut = transferOps && (transferOps & ~LUT_TRANSFER_OPS) == 0;
+   if (useLut)
+      build_transfer_lut(ctx, transferOps, lut);
+#endif
+
    if (overlapping) {
       GLint ssy = sy;
       tmpImage = (GLchan *) MALLOC(width * height * sizeof(GLchan) * 4);
@@ -385,6 +419,19 @@ copy_rgba_pixels(GLcontext *ctx, GLint srcx, GLint srcy,
             _swrast_use_draw_buffer(ctx);
       }
 
+#if CHAN_BITS == 8
+      if (useLut) {
+         GLint i;
+         for (i = 0; i < width; i++) {
+            GLchan *rgba = span.array->rgba[i];
+            rgba[RCOMP] = lut[RCOMP][rgba[RCOMP]];
+            rgba[GCOMP] = lut[GCOMP][rgba[GCOMP]];
+            rgba[BCOMP] = lut[BCOMP][rgba[BCOMP]];
+            rgba[ACOMP] = lut[ACOMP][rgba[ACOMP]];
+         }
+      }
+      else
+#endif
       if (transferOps) {
          DEFMARRAY(GLfloat, rgbaFloat, MAX_WIDTH, 4);  /* mac 32k limitation */
          CHECKARRAY(rgbaFloat, return);
@@ -781,6 +828,9 @@ _swrast_CopyPixels( GLcontext *ctx,
    if (swrast->NewState)
       _swrast_validate_derived( ctx );
 
+   /* fill lazily cleared destination tiles (reads fill their own) */
+   _swrast_resolve_lazy_clear_zoomed(ctx, destx, desty, width, height);
+
    if (type == GL_COLOR && ctx->Visual.rgbMode) {
       copy_rgba_pixels( ctx, srcx, srcy, width, height, destx, desty );
    }
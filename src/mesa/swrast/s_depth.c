@@ -32,6 +32,10 @@
 #include "s_depth.h"
 #include "s_context.h"
 #include "s_span.h"
+#include "s_stencil.h"
+#include "s_hiz.h"
+#include "s_lazyclear.h"
+#include "x86/common_x86_sse2.h"
 
 
 /**
@@ -499,6 +503,312 @@ depth_test_span32( GLcontext *ctx, GLuint n,
 
 
 
+#ifdef USE_SSE2_INTRIN
+
+/*
+ * SSE2 versions of depth_test_span16/32().  There's one function for
+ * each depth func and depth mask combination so the compare is resolved
+ * at compile time; _swrast_choose_depth_funcs() picks one of them.
+ * Fragments are processed in groups of 16 to match one vector of mask
+ * bytes; the remainder is handled with plain C.
+ */
+
+
+static INLINE GLboolean
+depth_compare(GLenum func, GLuint z, GLuint zbuf)
+{
+   switch (func) {
+   case GL_LESS:     return z < zbuf;
+   case GL_LEQUAL:   return z <= zbuf;
+   case GL_GEQUAL:   return z >= zbuf;
+   case GL_GREATER:  return z > zbuf;
+   case GL_NOTEQUAL: return z != zbuf;
+   case GL_EQUAL:    return z == zbuf;
+   case GL_ALWAYS:   return GL_TRUE;
+   default:          return GL_FALSE;
+   }
+}
+
+
+/*
+ * SSE2 only has signed compares so both operands must have been biased
+ * by flipping their sign bits.
+ */
+static INLINE SSE2_FUNC __m128i
+sse2_compare32(GLenum func, __m128i z, __m128i zbuf)
+{
+   const __m128i ones = _mm_cmpeq_epi32(z, z);
+   switch (func) {
+   case GL_LESS:     return _mm_cmpgt_epi32(zbuf, z);
+   case GL_LEQUAL:   return _mm_xor_si128(_mm_cmpgt_epi32(z, zbuf), ones);
+   case GL_GEQUAL:   return _mm_xor_si128(_mm_cmpgt_epi32(zbuf, z), ones);
+   case GL_GREATER:  return _mm_cmpgt_epi32(z, zbuf);
+   case GL_NOTEQUAL: return _mm_xor_si128(_mm_cmpeq_epi32(z, zbuf), ones);
+   case GL_EQUAL:    return _mm_cmpeq_epi32(z, zbuf);
+   case GL_ALWAYS:   return ones;
+   default:          return _mm_setzero_si128();
+   }
+}
+
+
+static INLINE SSE2_FUNC __m128i
+sse2_compare16(GLenum func, __m128i z, __m128i zbuf)
+{
+   const __m128i ones = _mm_cmpeq_epi16(z, z);
+   switch (func) {
+   case GL_LESS:     return _mm_cmpgt_epi16(zbuf, z);
+   case GL_LEQUAL:   return _mm_xor_si128(_mm_cmpgt_epi16(z, zbuf), ones);
+   case GL_GEQUAL:   return _mm_xor_si128(_mm_cmpgt_epi16(zbuf, z), ones);
+   case GL_GREATER:  return _mm_cmpgt_epi16(z, zbuf);
+   case GL_NOTEQUAL: return _mm_xor_si128(_mm_cmpeq_epi16(z, zbuf), ones);
+   case GL_EQUAL:    return _mm_cmpeq_epi16(z, zbuf);
+   case GL_ALWAYS:   return ones;
+   default:          return _mm_setzero_si128();
+   }
+}
+
+
+/* Select 'a' where 'sel' is all ones, else 'b' */
+#define SSE2_SELECT(sel, a, b) \
+   _mm_or_si128(_mm_and_si128(sel, a), _mm_andnot_si128(sel, b))
+
+
+static INLINE SSE2_FUNC GLuint
+sse2_depth_test_span32(GLuint n, GLuint zbuffer[], const GLuint z[],
+                       GLubyte mask[], GLenum func, GLboolean write)
+{
+   const __m128i zero = _mm_setzero_si128();
+   const __m128i one = _mm_set1_epi8(1);
+   const __m128i bias = _mm_set1_epi32((int) 0x80000000);
+   __m128i sum = zero;
+   GLuint passed, i;
+
+   if (func == GL_ALWAYS && !write)
+      return n;
+
+   for (i = 0; i + 16 <= n; i += 16) {
+      __m128i *zbuf = (__m128i *) (zbuffer + i);
+      const __m128i *zval = (const __m128i *) (z + i);
+      __m128i dead, pass, zb[4], zv[4], p[4];
+      GLuint j;
+
+      /* skip groups of fragments which were all killed earlier */
+      dead = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) (mask + i)),
+                            zero);
+      if (_mm_movemask_epi8(dead) == 0xffff)
+         continue;
+
+      for (j = 0; j < 4; j++) {
+         zb[j] = _mm_loadu_si128(zbuf + j);
+         zv[j] = _mm_loadu_si128(zval + j);
+         p[j] = sse2_compare32(func, _mm_xor_si128(zv[j], bias),
+                               _mm_xor_si128(zb[j], bias));
+      }
+      pass = _mm_packs_epi16(_mm_packs_epi32(p[0], p[1]),
+                             _mm_packs_epi32(p[2], p[3]));
+      pass = _mm_andnot_si128(dead, pass);
+
+      if (write && _mm_movemask_epi8(pass)) {
+         const __m128i lo = _mm_unpacklo_epi8(pass, pass);
+         const __m128i hi = _mm_unpackhi_epi8(pass, pass);
+         p[0] = _mm_unpacklo_epi16(lo, lo);
+         p[1] = _mm_unpackhi_epi16(lo, lo);
+         p[2] = _mm_unpacklo_epi16(hi, hi);
+         p[3] = _mm_unpackhi_epi16(hi, hi);
+         for (j = 0; j < 4; j++)
+            _mm_storeu_si128(zbuf + j, SSE2_SELECT(p[j], zv[j], zb[j]));
+      }
+
+      pass = _mm_and_si128(pass, one);
+      _mm_storeu_si128((__m128i *) (mask + i), pass);
+      sum = _mm_add_epi64(sum, _mm_sad_epu8(pass, zero));
+   }
+
+   passed = _mm_cvtsi128_si32(sum) + _mm_cvtsi128_si32(_mm_srli_si128(sum, 8));
+
+   for (; i < n; i++) {
+      if (mask[i]) {
+         if (depth_compare(func, z[i], zbuffer[i])) {
+            if (write)
+               zbuffer[i] = z[i];
+            passed++;
+         }
+         else {
+            mask[i] = 0;
+         }
+      }
+   }
+
+   return passed;
+}
+
+
+/*
+ * As above, but the 32-bit fragment Z values are packed into 16 bits.
+ * They're never larger than 0xffff for a 16-bit depth buffer.
+ */
+static INLINE SSE2_FUNC GLuint
+sse2_depth_test_span16(GLuint n, GLushort zbuffer[], const GLuint z[],
+                       GLubyte mask[], GLenum func, GLboolean write)
+{
+   const __m128i zero = _mm_setzero_si128();
+   const __m128i one = _mm_set1_epi8(1);
+   const __m128i bias32 = _mm_set1_epi32(0x8000);
+   const __m128i bias16 = _mm_set1_epi16((short) 0x8000);
+   __m128i sum = zero;
+   GLuint passed, i;
+
+   if (func == GL_ALWAYS && !write)
+      return n;
+
+   for (i = 0; i + 16 <= n; i += 16) {
+      __m128i *zbuf = (__m128i *) (zbuffer + i);
+      const __m128i *zval = (const __m128i *) (z + i);
+      __m128i dead, pass, zb[2], zv[2], p[2];
+      GLuint j;
+
+      dead = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) (mask + i)),
+                            zero);
+      if (_mm_movemask_epi8(dead) == 0xffff)
+         continue;
+
+      for (j = 0; j < 2; j++) {
+         /* subtracting the bias puts the values in signed 16-bit range */
+         const __m128i a = _mm_sub_epi32(_mm_loadu_si128(zval + 2 * j),
+                                         bias32);
+         const __m128i b = _mm_sub_epi32(_mm_loadu_si128(zval + 2 * j + 1),
+                                         bias32);
+         zv[j] = _mm_packs_epi32(a, b);
+         zb[j] = _mm_xor_si128(_mm_loadu_si128(zbuf + j), bias16);
+         p[j] = sse2_compare16(func, zv[j], zb[j]);
+      }
+      pass = _mm_andnot_si128(dead, _mm_packs_epi16(p[0], p[1]));
+
+      if (write && _mm_movemask_epi8(pass)) {
+         p[0] = _mm_unpacklo_epi8(pass, pass);
+         p[1] = _mm_unpackhi_epi8(pass, pass);
+         for (j = 0; j < 2; j++)
+            _mm_storeu_si128(zbuf + j,
+                             _mm_xor_si128(SSE2_SELECT(p[j], zv[j], zb[j]),
+                                           bias16));
+      }
+
+      pass = _mm_and_si128(pass, one);
+      _mm_storeu_si128((__m128i *) (mask + i), pass);
+      sum = _mm_add_epi64(sum, _mm_sad_epu8(pass, zero));
+   }
+
+   passed = _mm_cvtsi128_si32(sum) + _mm_cvtsi128_si32(_mm_srli_si128(sum, 8));
+
+   for (; i < n; i++) {
+      if (mask[i]) {
+         if (depth_compare(func, z[i], zbuffer[i])) {
+            if (write)
+               zbuffer[i] = (GLushort) z[i];
+            passed++;
+         }
+         else {
+            mask[i] = 0;
+         }
+      }
+   }
+
+   return passed;
+}
+
+
+#define SSE2_DEPTH_FUNCS(NAME, FUNC)					\
+static SSE2_FUNC GLuint							\
+NAME##16(GLcontext *ctx, GLuint n, GLushort zbuffer[],			\
+         const GLuint z[], GLubyte mask[])				\
+{									\
+   (void) ctx;								\
+   return sse2_depth_test_span16(n, zbuffer, z, mask, FUNC, GL_FALSE);	\
+}									\
+static SSE2_FUNC GLuint							\
+NAME##16_write(GLcontext *ctx, GLuint n, GLushort zbuffer[],		\
+               const GLuint z[], GLubyte mask[])			\
+{									\
+   (void) ctx;								\
+   return sse2_depth_test_span16(n, zbuffer, z, mask, FUNC, GL_TRUE);	\
+}									\
+static SSE2_FUNC GLuint							\
+NAME##32(GLcontext *ctx, GLuint n, GLuint zbuffer[],			\
+         const GLuint z[], GLubyte mask[])				\
+{									\
+   (void) ctx;								\
+   return sse2_depth_test_span32(n, zbuffer, z, mask, FUNC, GL_FALSE);	\
+}									\
+static SSE2_FUNC GLuint							\
+NAME##32_write(GLcontext *ctx, GLuint n, GLuint zbuffer[],		\
+               const GLuint z[], GLubyte mask[])			\
+{									\
+   (void) ctx;								\
+   return sse2_depth_test_span32(n, zbuffer, z, mask, FUNC, GL_TRUE);	\
+}
+
+SSE2_DEPTH_FUNCS(sse2_never, GL_NEVER)
+SSE2_DEPTH_FUNCS(sse2_less, GL_LESS)
+SSE2_DEPTH_FUNCS(sse2_equal, GL_EQUAL)
+SSE2_DEPTH_FUNCS(sse2_lequal, GL_LEQUAL)
+SSE2_DEPTH_FUNCS(sse2_greater, GL_GREATER)
+SSE2_DEPTH_FUNCS(sse2_notequal, GL_NOTEQUAL)
+SSE2_DEPTH_FUNCS(sse2_gequal, GL_GEQUAL)
+SSE2_DEPTH_FUNCS(sse2_always, GL_ALWAYS)
+
+#undef SSE2_DEPTH_FUNCS
+
+
+/* Indexed by [func - GL_NEVER][depth mask] */
+static const depth_span16_func sse2_depth_span16_funcs[8][2] = {
+   { sse2_never16, sse2_never16_write },
+   { sse2_less16, sse2_less16_write },
+   { sse2_equal16, sse2_equal16_write },
+   { sse2_lequal16, sse2_lequal16_write },
+   { sse2_greater16, sse2_greater16_write },
+   { sse2_notequal16, sse2_notequal16_write },
+   { sse2_gequal16, sse2_gequal16_write },
+   { sse2_always16, sse2_always16_write }
+};
+
+static const depth_span32_func sse2_depth_span32_funcs[8][2] = {
+   { sse2_never32, sse2_never32_write },
+   { sse2_less32, sse2_less32_write },
+   { sse2_equal32, sse2_equal32_write },
+   { sse2_lequal32, sse2_lequal32_write },
+   { sse2_greater32, sse2_greater32_write },
+   { sse2_notequal32, sse2_notequal32_write },
+   { sse2_gequal32, sse2_gequal32_write },
+   { sse2_always32, sse2_always32_write }
+};
+
+#endif /* USE_SSE2_INTRIN */
+
+
+/**
+ * Choose the span depth test functions for the current depth state.
+ * Called via the swrast->DepthTestSpan16/32 validation stubs.
+ */
+void
+_swrast_choose_depth_funcs( GLcontext *ctx )
+{
+   SWcontext *swrast = SWRAST_CONTEXT(ctx);
+#if defined(USE_SSE2_INTRIN)
+   const GLuint func = ctx->Depth.Func - GL_NEVER;
+   const GLuint write = ctx->Depth.Mask ? 1 : 0;
+
+   if (func < 8 && _mesa_have_sse2()) {
+      swrast->DepthTestSpan16 = sse2_depth_span16_funcs[func][write];
+      swrast->DepthTestSpan32 = sse2_depth_span32_funcs[func][write];
+      return;
+   }
+#endif
+   swrast->DepthTestSpan16 = depth_test_span16;
+   swrast->DepthTestSpan32 = depth_test_span32;
+}
+
+
+
 /*
  * Apply depth test to span of fragments.
  */
@@ -512,20 +822,26 @@ depth_test_span( GLcontext *ctx, struct sw_span *span)
    const GLuint count = span->end;
    const GLuint *zValues = span->array->z;
    GLubyte *mask = span->array->mask;
+   SWcontext *swrast = SWRAST_CONTEXT(ctx);
+   struct gl_renderbuffer *dsrb = _swrast_get_packed_depth_stencil(ctx, rb);
    GLuint passed;
 
    ASSERT((span->arrayMask & SPAN_XY) == 0);
    ASSERT(span->arrayMask & SPAN_Z);
    
-   if (rb->GetPointer(ctx, rb, 0, 0)) {
+   if (dsrb) {
+      /* Depth values are packed with stencil values, which are kept */
+      return _swrast_z24s8_test_span(ctx, span, dsrb, 0, GL_FALSE);
+   }
+   else if (rb->GetPointer(ctx, rb, 0, 0)) {
       /* Directly access buffer */
       if (ctx->DrawBuffer->Visual.depthBits <= 16) {
          GLushort *zbuffer = (GLushort *) rb->GetPointer(ctx, rb, x, y);
-         passed = depth_test_span16(ctx, count, zbuffer, zValues, mask);
+         passed = swrast->DepthTestSpan16(ctx, count, zbuffer, zValues, mask);
       }
       else {
          GLuint *zbuffer = (GLuint *) rb->GetPointer(ctx, rb, x, y);
-         passed = depth_test_span32(ctx, count, zbuffer, zValues, mask);
+         passed = swrast->DepthTestSpan32(ctx, count, zbuffer, zValues, mask);
       }
    }
    else {
@@ -533,18 +849,22 @@ depth_test_span( GLcontext *ctx, struct sw_span *span)
       if (rb->DataType == GL_UNSIGNED_SHORT) {
          GLushort zbuffer[MAX_WIDTH];
          rb->GetRow(ctx, rb, count, x, y, zbuffer);
-         passed = depth_test_span16(ctx, count, zbuffer, zValues, mask );
+         passed = swrast->DepthTestSpan16(ctx, count, zbuffer, zValues, mask);
          rb->PutRow(ctx, rb, count, x, y, zbuffer, NULL);
       }
       else {
          GLuint zbuffer[MAX_WIDTH];
          ASSERT(rb->DataType == GL_UNSIGNED_INT);
          rb->GetRow(ctx, rb, count, x, y, zbuffer);
-         passed = depth_test_span32(ctx, count, zbuffer, zValues, mask );
+         passed = swrast->DepthTestSpan32(ctx, count, zbuffer, zValues, mask);
          rb->PutRow(ctx, rb, count, x, y, zbuffer, NULL);
       }
    }
 
+   if (passed > 0 && ctx->Depth.Mask && swrast->HiZ) {
+      _swrast_hiz_update_span(ctx, rb, x, y, count);
+   }
+
    if (passed < count) {
       span->writeAll = GL_FALSE;
    }
@@ -1059,8 +1379,13 @@ depth_test_pixels( GLcontext *ctx, struct sw_span *span )
    const GLint *y = span->array->y;
    const GLuint *z = span->array->z;
    GLubyte *mask = span->array->mask;
+   SWcontext *swrast = SWRAST_CONTEXT(ctx);
 
-   if (rb->GetPointer(ctx, rb, 0, 0)) {
+   if (_swrast_get_packed_depth_stencil(ctx, rb)) {
+      /* Depth values are packed with stencil values, which are kept */
+      return _swrast_z24s8_test_span(ctx, span, rb->Wrapped, 0, GL_FALSE);
+   }
+   else if (rb->GetPointer(ctx, rb, 0, 0)) {
       /* Directly access values */
       if (rb->DataType == GL_UNSIGNED_SHORT) {
          GLushort *zStart = (GLushort *) rb->Data;
@@ -1074,22 +1399,28 @@ depth_test_pixels( GLcontext *ctx, struct sw_span *span )
       }
    }
    else {
-      /* read depth values from buffer, test, write back */
+      /* read depth values from buffer, test, write back the ones which
+       * passed (the mask also excludes pixels outside the buffer)
+       */
       if (rb->DataType == GL_UNSIGNED_SHORT) {
          GLushort zbuffer[MAX_WIDTH];
          _swrast_get_values(ctx, rb, count, x, y, zbuffer, sizeof(GLushort));
-         depth_test_span16(ctx, count, zbuffer, z, mask );
-         rb->PutValues(ctx, rb, count, x, y, zbuffer, NULL);
+         swrast->DepthTestSpan16(ctx, count, zbuffer, z, mask);
+         rb->PutValues(ctx, rb, count, x, y, zbuffer, mask);
       }
       else {
          GLuint zbuffer[MAX_WIDTH];
          ASSERT(rb->DataType == GL_UNSIGNED_INT);
          _swrast_get_values(ctx, rb, count, x, y, zbuffer, sizeof(GLuint));
-         depth_test_span32(ctx, count, zbuffer, z, mask );
-         rb->PutValues(ctx, rb, count, x, y, zbuffer, NULL);
+         swrast->DepthTestSpan32(ctx, count, zbuffer, z, mask);
+         rb->PutValues(ctx, rb, count, x, y, zbuffer, mask);
       }
    }
 
+   if (ctx->Depth.Mask && swrast->HiZ) {
+      _swrast_hiz_update_pixels(ctx, rb, count, x, y, mask);
+   }
+
    return count; /* not really correct, but OK */
 }
 
@@ -1232,6 +1563,8 @@ _swrast_read_depth_span( GLcontext *ctx, struct gl_renderbuffer *rb,
       return;
    }
 
+   _swrast_resolve_lazy_clear(ctx, rb, x, y, n, 1);
+
    /* we'll always return 32-bit values to our caller */
    if (!rb) {
       _mesa_bzero(depth, n * sizeof(GLuint));
@@ -1274,6 +1607,21 @@ _swrast_read_depth_span_float( GLcontext *ctx, struct gl_renderbuffer *rb,
 }
 
 
+/**
+ * Compute the integer depth clearing value.
+ */
+static GLuint
+depth_clear_value( GLcontext *ctx )
+{
+   if (ctx->Depth.Clear == 1.0) {
+      return ctx->DrawBuffer->_DepthMax;
+   }
+   else {
+      return (GLuint) (ctx->Depth.Clear * ctx->DrawBuffer->_DepthMaxF);
+   }
+}
+
+
 /**
  * Clear the depth buffer.
  */
@@ -1282,19 +1630,14 @@ _swrast_clear_depth_buffer( GLcontext *ctx, struct gl_renderbuffer *rb )
 {
    GLuint clearValue;
    GLint x, y, width, height;
+   GLboolean lazy;
 
    if (!rb || !ctx->Depth.Mask) {
       /* no depth buffer, or writing to it is disabled */
       return;
    }
 
-   /* compute integer clearing value */
-   if (ctx->Depth.Clear == 1.0) {
-      clearValue = ctx->DrawBuffer->_DepthMax;
-   }
-   else {
-      clearValue = (GLuint) (ctx->Depth.Clear * ctx->DrawBuffer->_DepthMaxF);
-   }
+   clearValue = depth_clear_value(ctx);
 
    assert(rb->_BaseFormat == GL_DEPTH_COMPONENT);
 
@@ -1304,6 +1647,25 @@ _swrast_clear_depth_buffer( GLcontext *ctx, struct gl_renderbuffer *rb )
    width  = ctx->DrawBuffer->_Xmax - ctx->DrawBuffer->_Xmin;
    height = ctx->DrawBuffer->_Ymax - ctx->DrawBuffer->_Ymin;
 
+   /* try tagging the tiles instead of writing the values */
+   if (rb->Wrapped->_BaseFormat == GL_DEPTH_STENCIL_MESA) {
+      const GLuint value = clearValue << 8, writemask = ~0xffU;
+      lazy = _swrast_lazy_clear(ctx, rb, &value, &writemask);
+   }
+   else if (rb->DataType == GL_UNSIGNED_SHORT) {
+      const GLushort value = (GLushort) clearValue, writemask = 0xffff;
+      lazy = _swrast_lazy_clear(ctx, rb, &value, &writemask);
+   }
+   else {
+      const GLuint writemask = ~0U;
+      lazy = _swrast_lazy_clear(ctx, rb, &clearValue, &writemask);
+   }
+
+   if (lazy) {
+      _swrast_hiz_clear(ctx, rb, x, y, width, height, clearValue);
+      return;
+   }
+
    if (rb->GetPointer(ctx, rb, 0, 0)) {
       /* Direct buffer access is possible.  Either this is just malloc'd
        * memory, or perhaps the driver mmap'd the zbuffer memory.
@@ -1362,4 +1724,60 @@ _swrast_clear_depth_buffer( GLcontext *ctx, struct gl_renderbuffer *rb )
          }
       }
    }
+
+   _swrast_hiz_clear(ctx, rb, x, y, width, height, clearValue);
+}
+
+
+/**
+ * Clear both the depth and the stencil values of a packed depth/stencil
+ * buffer, in one pass.  rb is the depth renderbuffer, which must wrap a
+ * packed buffer (see _swrast_get_packed_depth_stencil()).
+ */
+void
+_swrast_clear_depth_stencil_buffer( GLcontext *ctx, struct gl_renderbuffer *rb )
+{
+   struct gl_renderbuffer *dsrb = _swrast_get_packed_depth_stencil(ctx, rb);
+   const GLuint zClear = depth_clear_value(ctx);
+   GLuint clearMask, clearValue;
+   GLint x, y, width, height, i, j;
+
+   ASSERT(dsrb);
+   ASSERT(dsrb->DataType == GL_UNSIGNED_INT_24_8_MESA);
+
+   /* the bits of the packed words to clear */
+   clearMask = ctx->Stencil.WriteMask[0] & 0xff;
+   if (ctx->Depth.Mask)
+      clearMask |= ~0xff;
+   if (clearMask == 0)
+      return;
+
+   clearValue = ((zClear << 8) | (ctx->Stencil.Clear & 0xff)) & clearMask;
+
+   /* compute region to clear */
+   x = ctx->DrawBuffer->_Xmin;
+   y = ctx->DrawBuffer->_Ymin;
+   width  = ctx->DrawBuffer->_Xmax - ctx->DrawBuffer->_Xmin;
+   height = ctx->DrawBuffer->_Ymax - ctx->DrawBuffer->_Ymin;
+
+   /* try tagging the tiles instead of writing the values */
+   if (!_swrast_lazy_clear(ctx, dsrb, &clearValue, &clearMask)) {
+      for (i = 0; i < height; i++) {
+         GLuint *dst = (GLuint *) dsrb->GetPointer(ctx, dsrb, x, y + i);
+         if (clearMask == ~0U) {
+            for (j = 0; j < width; j++) {
+               dst[j] = clearValue;
+            }
+         }
+         else {
+            for (j = 0; j < width; j++) {
+               dst[j] = (dst[j] & ~clearMask) | clearValue;
+            }
+         }
+      }
+   }
+
+   if (ctx->Depth.Mask) {
+      _swrast_hiz_clear(ctx, rb, x, y, width, height, zClear);
+   }
 }
@@ -31,6 +31,26 @@
 #include "s_context.h"
 
 
+/**
+ * If the depth or stencil renderbuffer rb is a wrapper around a packed
+ * 24/8 depth/stencil buffer (see _mesa_add_depth_stencil_renderbuffer())
+ * which can be accessed directly, return the packed buffer.
+ */
+static INLINE struct gl_renderbuffer *
+_swrast_get_packed_depth_stencil( GLcontext *ctx, struct gl_renderbuffer *rb )
+{
+   if (rb && rb->Wrapped != rb &&
+       rb->Wrapped->_BaseFormat == GL_DEPTH_STENCIL_MESA &&
+       rb->Wrapped->GetPointer(ctx, rb->Wrapped, 0, 0))
+      return rb->Wrapped;
+   return NULL;
+}
+
+
+extern void
+_swrast_choose_depth_funcs( GLcontext *ctx );
+
+
 extern GLuint
 _swrast_depth_test_span( GLcontext *ctx, struct sw_span *span);
 
@@ -53,4 +73,9 @@ extern void
 _swrast_clear_depth_buffer( GLcontext *ctx, struct gl_renderbuffer *rb );
 
 
+extern void
+_swrast_clear_depth_stencil_buffer( GLcontext *ctx,
+                                    struct gl_renderbuffer *rb );
+
+
 #endif
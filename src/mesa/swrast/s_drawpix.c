@@ -34,12 +34,86 @@
 
 #include "s_context.h"
 #include "s_drawpix.h"
+#include "s_lazyclear.h"
 #include "s_pixeltex.h"
 #include "s_span.h"
 #include "s_stencil.h"
 #include "s_zoom.h"
 
 
+#if CHAN_BITS == 8
+
+/**
+ * Compute the results of the current pixel transfer operations for each
+ * possible component value, by unpacking a ramp the slow way.
+ */
+static void
+build_transfer_lut(GLcontext *ctx, GLchan lut[4][256])
+{
+   GLubyte ramp[256][4];
+   GLchan rgba[256][4];
+   GLuint i;
+
+   ASSERT((ctx->_ImageTransferState & ~LUT_TRANSFER_OPS) == 0);
+
+   for (i = 0; i < 256; i++) {
+      ramp[i][0] = ramp[i][1] = ramp[i][2] = ramp[i][3] = (GLubyte) i;
+   }
+   _mesa_unpack_color_span_chan(ctx, 256, GL_RGBA, (GLchan *) rgba,
+                                GL_RGBA, GL_UNSIGNED_BYTE, ramp,
+                                &ctx->DefaultPacking,
+                                ctx->_ImageTransferState);
+   for (i = 0; i < 256; i++) {
+      lut[RCOMP][i] = rgba[i][RCOMP];
+      lut[GCOMP][i] = rgba[i][GCOMP];
+      lut[BCOMP][i] = rgba[i][BCOMP];
+      lut[ACOMP][i] = rgba[i][ACOMP];
+   }
+}
+
+
+/**
+ * Convert a row of GL_RGBA, GL_BGRA or GL_RGB ubyte pixels to GLchan
+ * RGBA, looking the components up in lut if it's not NULL.
+ */
+static void
+unpack_ubyte_row(GLenum format, GLuint n, const GLubyte *src,
+                 CONST GLchan lut[4][256], GLchan dst[][4])
+{
+   const GLuint r = (format == GL_BGRA) ? 2 : 0;
+   const GLuint b = (format == GL_BGRA) ? 0 : 2;
+   GLuint i;
+
+   if (format == GL_RGB) {
+      const GLchan alpha = lut ? lut[ACOMP][255] : CHAN_MAX;
+      for (i = 0; i < n; i++, src += 3) {
+         dst[i][RCOMP] = lut ? lut[RCOMP][src[0]] : src[0];
+         dst[i][GCOMP] = lut ? lut[GCOMP][src[1]] : src[1];
+         dst[i][BCOMP] = lut ? lut[BCOMP][src[2]] : src[2];
+         dst[i][ACOMP] = alpha;
+      }
+   }
+   else if (lut) {
+      for (i = 0; i < n; i++, src += 4) {
+         dst[i][RCOMP] = lut[RCOMP][src[r]];
+         dst[i][GCOMP] = lut[GCOMP][src[1]];
+         dst[i][BCOMP] = lut[BCOMP][src[b]];
+         dst[i][ACOMP] = lut[ACOMP][src[3]];
+      }
+   }
+   else {
+      for (i = 0; i < n; i++, src += 4) {
+         dst[i][RCOMP] = src[r];
+         dst[i][GCOMP] = src[1];
+         dst[i][BCOMP] = src[b];
+         dst[i][ACOMP] = src[3];
+      }
+   }
+}
+
+#endif /* CHAN_BITS == 8 */
+
+
 /*
  * Try to do a fast and simple RGB(a) glDrawPixels.
  * Return:  GL_TRUE if success, GL_FALSE if slow path must be used instead
@@ -73,7 +147,6 @@ fast_draw_pixels(GLcontext *ctx, GLint x, GLint y,
 
    if ((SWRAST_CONTEXT(ctx)->_RasterMask & ~CLIP_BIT) == 0
        && ctx->Texture._EnabledCoordUnits == 0
-       && unpack->Alignment == 1
        && !unpack->SwapBytes
        && !unpack->LsbFirst) {
 
@@ -91,6 +164,13 @@ fast_draw_pixels(GLcontext *ctx, GLint x, GLint y,
       else
          rowLength = width;
 
+      /* rows are assumed to be tightly packed below */
+      if (unpack->Alignment != 1) {
+         const GLint bpp = _mesa_bytes_per_pixel(format, type);
+         if (bpp <= 0 || (rowLength * bpp) % unpack->Alignment != 0)
+            return GL_FALSE;
+      }
+
       /* If we're not using pixel zoom then do all clipping calculations
        * now.  Otherwise, we'll let the _swrast_write_zoomed_*_span() functions
        * handle the clipping.
@@ -159,6 +239,52 @@ fast_draw_pixels(GLcontext *ctx, GLint x, GLint y,
        * skip "skipRows" rows and skip "skipPixels" pixels/row.
        */
 
+#if CHAN_BITS == 8
+      if ((format == GL_RGBA || format == GL_BGRA || format == GL_RGB)
+          && type == GL_UNSIGNED_BYTE
+          && ctx->Visual.rgbMode
+          && (ctx->_ImageTransferState != 0 || format == GL_BGRA)
+          && (ctx->_ImageTransferState & ~LUT_TRANSFER_OPS) == 0) {
+         /* BGRA and/or scale/bias, color map */
+         const GLint comps = (format == GL_RGB) ? 3 : 4;
+         const GLubyte *src = (const GLubyte *) pixels
+            + (skipRows * rowLength + skipPixels) * comps;
+         GLchan lut[4][256];
+         GLint row;
+
+         if (ctx->_ImageTransferState)
+            build_transfer_lut(ctx, lut);
+
+         ASSERT(drawWidth <= MAX_WIDTH);
+         for (row = 0; row < drawHeight; row++) {
+            unpack_ubyte_row(format, drawWidth, src,
+                             ctx->_ImageTransferState
+                             ? (CONST GLchan (*)[256]) lut : NULL,
+                             span.array->rgba);
+            if (ctx->Pixel.ZoomX==1.0F && ctx->Pixel.ZoomY==1.0F) {
+               rb->PutRow(ctx, rb, drawWidth, destX, destY,
+                          span.array->rgba, NULL);
+               destY++;
+            }
+            else if (ctx->Pixel.ZoomX==1.0F && ctx->Pixel.ZoomY==-1.0F) {
+               destY--;
+               rb->PutRow(ctx, rb, drawWidth, destX, destY,
+                          span.array->rgba, NULL);
+            }
+            else {
+               span.x = destX;
+               span.y = destY;
+               span.end = drawWidth;
+               _swrast_write_zoomed_rgba_span(ctx, &span,
+                            (CONST GLchan (*)[4]) span.array->rgba, zoomY0, 0);
+               destY++;
+            }
+            src += rowLength * comps;
+         }
+         return GL_TRUE;
+      }
+#endif
+
       if (format == GL_RGBA && type == CHAN_TYPE
           && ctx->_ImageTransferState==0) {
          if (ctx->Visual.rgbMode) {
@@ -915,6 +1041,8 @@ _swrast_DrawPixels( GLcontext *ctx,
 
    RENDER_START(swrast,ctx);
 
+   _swrast_resolve_lazy_clear_zoomed(ctx, x, y, width, height);
+
    switch (format) {
    case GL_STENCIL_INDEX:
       draw_stencil_pixels( ctx, x, y, width, height, type, unpack, pixels );
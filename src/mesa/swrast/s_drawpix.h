@@ -33,4 +33,12 @@
 
 /* XXX kill this header? */
 
+
+/**
+ * Pixel transfer operations which treat each color component on its
+ * own.  With 8-bit components they can be done by table lookup.
+ */
+#define LUT_TRANSFER_OPS (IMAGE_SCALE_BIAS_BIT | IMAGE_MAP_COLOR_BIT)
+
+
 #endif
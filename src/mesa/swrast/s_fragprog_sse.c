@@ -0,0 +1,1207 @@
+/*
+ * Mesa 3-D graphics library
+ * Version:  6.5
+ *
+ * Copyright (C) 1999-2006  Brian Paul   All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * BRIAN PAUL BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ * AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file s_fragprog_sse.c
+ *
+ * Translate ARB/NV fragment programs (including the ones generated by
+ * texenvprogram.c) to x86/x86-64 SSE machine code with the rtasm
+ * runtime assembler.
+ *
+ * The generated code works on a quad of four fragments at a time in
+ * SoA form: each component of each register is a 4-wide vector holding
+ * that component for the four fragments, so swizzles are free and
+ * every instruction maps onto plain packed SSE arithmetic.  Texture
+ * lookups and the transcendental functions call back into C, where the
+ * texture fetches go through swrast->TextureSample for the whole quad.
+ *
+ * Programs using anything we can't translate (condition codes,
+ * derivatives, pack/unpack, etc) are left to the interpreter in
+ * s_nvfragprog.c.
+ */
+
+#include "glheader.h"
+#include "colormac.h"
+#include "context.h"
+#include "imports.h"
+#include "macros.h"
+#include "nvfragprog.h"
+#include "program.h"
+
+#include "s_context.h"
+#include "s_nvfragprog.h"
+#include "s_span.h"
+
+
+#if defined(USE_SSE_ASM) || defined(USE_X86_64_ASM)
+
+#include "x86/rtasm/x86sse.h"
+#if defined(USE_SSE_ASM)
+#include "x86/common_x86_asm.h"
+#endif
+
+
+#define DISASSEM 0
+
+/** Max number of distinct program parameters referenced by a program */
+#define FP_SSE_MAX_CONSTS 64
+
+/** Code buffer space reserved per instruction while compiling */
+#define FP_SSE_MAX_INST_BYTES 1024
+
+/** Max number of compiled programs to keep around */
+#define FP_SSE_MAX_PROGRAMS 16
+
+
+/**
+ * Register file for one quad.  Each register is stored as [comp][frag].
+ */
+struct fp_sse_machine
+{
+   GLfloat Temps[MAX_NV_FRAGMENT_PROGRAM_TEMPS][4][4];
+   GLfloat Inputs[MAX_NV_FRAGMENT_PROGRAM_INPUTS][4][4];
+   GLfloat Outputs[MAX_NV_FRAGMENT_PROGRAM_OUTPUTS][4][4];
+   GLfloat Consts[FP_SSE_MAX_CONSTS][4][4];
+
+   GLfloat Src[2][4][4];     /**< sources for callback instructions */
+   GLfloat Result[4][4];     /**< result of callback instructions */
+   GLuint Kill[4];           /**< ~0 for killed fragments */
+
+   GLfloat Zero[4];
+   GLfloat One[4];
+   GLfloat SignMask[4];
+   GLfloat AbsMask[4];
+   GLfloat Big[4];           /**< 2^23: larger floats are integers */
+
+   void (*Callback)( struct fp_sse_machine *m, GLuint pc );
+
+   GLcontext *ctx;
+   const struct fragment_program *Program;
+   const struct sw_span *Span;
+   GLuint Column;            /**< span position of the first fragment */
+   GLuint Count;             /**< number of real fragments in the quad */
+};
+
+
+/**
+ * A compiled program.  The instructions are copied so that a program
+ * object which is respecified (or freed and reallocated) can't be
+ * matched with stale code.
+ */
+struct fp_sse_program
+{
+   const struct fragment_program *Program;
+   const struct fp_instruction *Source;
+   struct fp_instruction *Instructions;
+   GLuint NumInstructions;
+   GLuint NumTemps;
+   GLuint NumConsts;
+   struct {
+      GLuint File;
+      GLuint Index;
+   } Const[FP_SSE_MAX_CONSTS];
+   GLubyte *Code;
+   void (*Func)( struct fp_sse_machine *m );
+   struct fp_sse_program *Next;
+};
+
+
+struct fp_sse_cache
+{
+   struct fp_sse_machine *Machine;
+   struct fp_sse_program *Programs;    /**< most recently used first */
+   struct fp_sse_program *Current;
+   GLboolean Disabled;
+};
+
+
+struct compilation
+{
+   struct x86_function func;
+   struct fp_sse_program *p;
+   struct x86_reg machine;
+   GLboolean error;
+};
+
+
+static GLint get_offset( const void *a, const void *b )
+{
+   return (const char *)b - (const char *)a;
+}
+
+
+static struct x86_reg
+get_machine_ptr( struct compilation *cp, const void *field )
+{
+   const struct fp_sse_machine *m = NULL;
+   return x86_make_disp(cp->machine, get_offset(m, field));
+}
+
+
+static struct x86_reg
+xmm( GLuint idx )
+{
+   return x86_make_reg(file_XMM, idx);
+}
+
+
+/**
+ * Return the slot in m->Consts holding the given program parameter,
+ * allocating a new one if needed.
+ */
+static GLint
+get_const_slot( struct compilation *cp, GLuint file, GLuint index )
+{
+   struct fp_sse_program *p = cp->p;
+   GLuint i;
+
+   if (file == PROGRAM_NAMED_PARAM)
+      file = PROGRAM_STATE_VAR;
+
+   for (i = 0; i < p->NumConsts; i++) {
+      if (p->Const[i].File == file && p->Const[i].Index == index)
+         return i;
+   }
+
+   if (p->NumConsts == FP_SSE_MAX_CONSTS) {
+      cp->error = GL_TRUE;
+      return 0;
+   }
+
+   p->Const[p->NumConsts].File = file;
+   p->Const[p->NumConsts].Index = index;
+   return p->NumConsts++;
+}
+
+
+static struct x86_reg
+get_src_ptr( struct compilation *cp, const struct fp_src_register *src,
+             GLuint chan )
+{
+   const struct fp_sse_machine *m = NULL;
+
+   switch (src->File) {
+   case PROGRAM_TEMPORARY:
+      if (src->Index >= cp->p->NumTemps)
+         cp->p->NumTemps = src->Index + 1;
+      return get_machine_ptr(cp, m->Temps[src->Index][chan]);
+   case PROGRAM_INPUT:
+      return get_machine_ptr(cp, m->Inputs[src->Index][chan]);
+   case PROGRAM_LOCAL_PARAM:
+   case PROGRAM_ENV_PARAM:
+   case PROGRAM_STATE_VAR:
+   case PROGRAM_NAMED_PARAM:
+      return get_machine_ptr(cp, m->Consts[get_const_slot(cp, src->File,
+                                                          src->Index)][chan]);
+   default:
+      cp->error = GL_TRUE;
+      return get_machine_ptr(cp, m->Zero);
+   }
+}
+
+
+/**
+ * Load component 'comp' of a source register into an xmm register,
+ * applying swizzling, negation and absolute value.
+ */
+static void
+emit_fetch( struct compilation *cp, struct x86_reg dst,
+            const struct fp_instruction *inst, GLuint arg, GLuint comp )
+{
+   const struct fp_src_register *src = &inst->SrcReg[arg];
+   const struct fp_sse_machine *m = NULL;
+   const GLuint swz = GET_SWZ(src->Swizzle, comp);
+   GLboolean negate;
+
+   if (swz == SWIZZLE_ZERO)
+      sse_xorps(&cp->func, dst, dst);
+   else if (swz == SWIZZLE_ONE)
+      sse_movaps(&cp->func, dst, get_machine_ptr(cp, m->One));
+   else
+      sse_movaps(&cp->func, dst, get_src_ptr(cp, src, swz));
+
+   if (inst->Opcode == FP_OPCODE_SWZ)
+      negate = (src->NegateBase >> comp) & 1;
+   else
+      negate = src->NegateBase != 0;
+
+   if (negate)
+      sse_xorps(&cp->func, dst, get_machine_ptr(cp, m->SignMask));
+
+   if (inst->Opcode != FP_OPCODE_SWZ) {
+      if (src->Abs)
+         sse_andps(&cp->func, dst, get_machine_ptr(cp, m->AbsMask));
+      if (src->NegateAbs)
+         sse_xorps(&cp->func, dst, get_machine_ptr(cp, m->SignMask));
+   }
+}
+
+
+/**
+ * Write the per-component results to the destination register,
+ * observing the write mask and saturation.
+ */
+static void
+emit_store( struct compilation *cp, const struct fp_instruction *inst,
+            const struct x86_reg result[4] )
+{
+   const struct fp_dst_register *dst = &inst->DstReg;
+   const struct fp_sse_machine *m = NULL;
+   GLuint saturated = 0;
+   GLuint c;
+
+   if (dst->File == PROGRAM_WRITE_ONLY)
+      return;
+
+   for (c = 0; c < 4; c++) {
+      struct x86_reg ptr;
+
+      if (!GET_BIT(dst->WriteMask, c))
+         continue;
+
+      if (inst->Saturate && !(saturated & (1 << result[c].idx))) {
+         sse_maxps(&cp->func, result[c], get_machine_ptr(cp, m->Zero));
+         sse_minps(&cp->func, result[c], get_machine_ptr(cp, m->One));
+         saturated |= 1 << result[c].idx;
+      }
+
+      if (dst->File == PROGRAM_OUTPUT) {
+         ptr = get_machine_ptr(cp, m->Outputs[dst->Index][c]);
+      }
+      else if (dst->File == PROGRAM_TEMPORARY) {
+         if (dst->Index >= cp->p->NumTemps)
+            cp->p->NumTemps = dst->Index + 1;
+         ptr = get_machine_ptr(cp, m->Temps[dst->Index][c]);
+      }
+      else {
+         cp->error = GL_TRUE;
+         return;
+      }
+
+      sse_movaps(&cp->func, ptr, result[c]);
+   }
+}
+
+
+/**
+ * dst = floor(dst), using tmp0..tmp2.  Truncate through an integer
+ * conversion and step down for negative non-integers; values too big
+ * to convert are already integers and pass through unchanged.
+ */
+static void
+emit_floor( struct compilation *cp, struct x86_reg dst,
+            struct x86_reg tmp0, struct x86_reg tmp1, struct x86_reg tmp2 )
+{
+   const struct fp_sse_machine *m = NULL;
+
+   sse2_cvttps2dq(&cp->func, tmp0, dst);
+   sse2_cvtdq2ps(&cp->func, tmp0, tmp0);
+   sse_movaps(&cp->func, tmp1, dst);
+   sse_cmpps(&cp->func, tmp1, tmp0, cc_LessThan);
+   sse_andps(&cp->func, tmp1, get_machine_ptr(cp, m->One));
+   sse_subps(&cp->func, tmp0, tmp1);
+
+   sse_movaps(&cp->func, tmp2, dst);
+   sse_andps(&cp->func, tmp2, get_machine_ptr(cp, m->AbsMask));
+   sse_cmpps(&cp->func, tmp2, get_machine_ptr(cp, m->Big), cc_LessThan);
+   sse_andps(&cp->func, tmp0, tmp2);
+   sse_andnps(&cp->func, tmp2, dst);
+   sse_orps(&cp->func, tmp0, tmp2);
+   sse_movaps(&cp->func, dst, tmp0);
+}
+
+
+/**
+ * Call m->Callback(m, pc) to execute an instruction in C.  The machine
+ * pointer lives in a callee-saved register so it survives the call;
+ * the xmm registers don't, but nothing is kept in them across
+ * instructions.
+ */
+static void
+emit_callback( struct compilation *cp, GLuint pc )
+{
+   const struct fp_sse_machine *m = NULL;
+#if defined(USE_X86_64_ASM)
+   x86_mov(&cp->func, x86_fn_arg(&cp->func, 1), cp->machine);
+   x86_mov_reg_imm(&cp->func, x86_fn_arg(&cp->func, 2), pc);
+   x86_call(&cp->func, get_machine_ptr(cp, &m->Callback));
+#else
+   struct x86_reg regEAX = x86_make_reg(file_REG32, reg_AX);
+   x86_push_imm32(&cp->func, pc);
+   x86_push(&cp->func, cp->machine);
+   x86_call(&cp->func, get_machine_ptr(cp, &m->Callback));
+   x86_pop(&cp->func, regEAX);
+   x86_pop(&cp->func, regEAX);
+#endif
+}
+
+
+static void
+emit_compare( struct compilation *cp, const struct fp_instruction *inst,
+              struct x86_reg result[4], GLubyte cc, GLboolean swap )
+{
+   const struct fp_sse_machine *m = NULL;
+   GLuint c;
+
+   for (c = 0; c < 4; c++) {
+      if (!GET_BIT(inst->DstReg.WriteMask, c))
+         continue;
+      emit_fetch(cp, result[c], inst, swap ? 1 : 0, c);
+      emit_fetch(cp, xmm(0), inst, swap ? 0 : 1, c);
+      sse_cmpps(&cp->func, result[c], xmm(0), cc);
+      sse_andps(&cp->func, result[c], get_machine_ptr(cp, m->One));
+   }
+}
+
+
+/**
+ * Translate one instruction.
+ * \return GL_FALSE if the instruction can't be translated.
+ */
+static GLboolean
+emit_instruction( struct compilation *cp, const struct fp_instruction *inst,
+                  GLuint pc )
+{
+   const struct fp_sse_machine *m = NULL;
+   const GLuint mask = inst->DstReg.WriteMask;
+   struct x86_reg result[4];
+   GLuint c;
+
+   /* Condition codes aren't implemented.  Note that ARB and texenv
+    * programs may leave CondMask zero, which means "always".
+    */
+   if (inst->UpdateCondRegister ||
+       (inst->DstReg.CondMask >= COND_GT && inst->DstReg.CondMask != COND_TR))
+      return GL_FALSE;
+
+   /* per-component results go in xmm4..7, xmm0..3 are scratch */
+   for (c = 0; c < 4; c++)
+      result[c] = xmm(4 + c);
+
+   switch (inst->Opcode) {
+   case FP_OPCODE_ABS:
+      for (c = 0; c < 4; c++) {
+         if (GET_BIT(mask, c)) {
+            emit_fetch(cp, result[c], inst, 0, c);
+            sse_andps(&cp->func, result[c], get_machine_ptr(cp, m->AbsMask));
+         }
+      }
+      break;
+
+   case FP_OPCODE_ADD:
+   case FP_OPCODE_SUB:
+   case FP_OPCODE_MUL:
+   case FP_OPCODE_MIN:
+   case FP_OPCODE_MAX:
+      for (c = 0; c < 4; c++) {
+         if (!GET_BIT(mask, c))
+            continue;
+         emit_fetch(cp, result[c], inst, 0, c);
+         emit_fetch(cp, xmm(0), inst, 1, c);
+         switch (inst->Opcode) {
+         case FP_OPCODE_ADD:
+            sse_addps(&cp->func, result[c], xmm(0));
+            break;
+         case FP_OPCODE_SUB:
+            sse_subps(&cp->func, result[c], xmm(0));
+            break;
+         case FP_OPCODE_MUL:
+            sse_mulps(&cp->func, result[c], xmm(0));
+            break;
+         case FP_OPCODE_MIN:
+            sse_minps(&cp->func, result[c], xmm(0));
+            break;
+         default:
+            sse_maxps(&cp->func, result[c], xmm(0));
+            break;
+         }
+      }
+      break;
+
+   case FP_OPCODE_MAD:
+      for (c = 0; c < 4; c++) {
+         if (!GET_BIT(mask, c))
+            continue;
+         emit_fetch(cp, result[c], inst, 0, c);
+         emit_fetch(cp, xmm(0), inst, 1, c);
+         sse_mulps(&cp->func, result[c], xmm(0));
+         emit_fetch(cp, xmm(0), inst, 2, c);
+         sse_addps(&cp->func, result[c], xmm(0));
+      }
+      break;
+
+   case FP_OPCODE_LRP:
+      /* a * b + (1 - a) * c */
+      for (c = 0; c < 4; c++) {
+         if (!GET_BIT(mask, c))
+            continue;
+         emit_fetch(cp, result[c], inst, 0, c);
+         emit_fetch(cp, xmm(0), inst, 1, c);
+         emit_fetch(cp, xmm(1), inst, 2, c);
+         sse_movaps(&cp->func, xmm(2), get_machine_ptr(cp, m->One));
+         sse_subps(&cp->func, xmm(2), result[c]);
+         sse_mulps(&cp->func, result[c], xmm(0));
+         sse_mulps(&cp->func, xmm(2), xmm(1));
+         sse_addps(&cp->func, result[c], xmm(2));
+      }
+      break;
+
+   case FP_OPCODE_CMP:
+      /* a < 0 ? b : c */
+      for (c = 0; c < 4; c++) {
+         if (!GET_BIT(mask, c))
+            continue;
+         emit_fetch(cp, xmm(0), inst, 0, c);
+         sse_cmpps(&cp->func, xmm(0), get_machine_ptr(cp, m->Zero),
+                   cc_LessThan);
+         emit_fetch(cp, result[c], inst, 1, c);
+         sse_andps(&cp->func, result[c], xmm(0));
+         emit_fetch(cp, xmm(1), inst, 2, c);
+         sse_andnps(&cp->func, xmm(0), xmm(1));
+         sse_orps(&cp->func, result[c], xmm(0));
+      }
+      break;
+
+   case FP_OPCODE_DP3:
+   case FP_OPCODE_DP4:
+   case FP_OPCODE_DPH:
+      emit_fetch(cp, result[0], inst, 0, 0);
+      emit_fetch(cp, xmm(0), inst, 1, 0);
+      sse_mulps(&cp->func, result[0], xmm(0));
+      for (c = 1; c < 3; c++) {
+         emit_fetch(cp, xmm(0), inst, 0, c);
+         emit_fetch(cp, xmm(1), inst, 1, c);
+         sse_mulps(&cp->func, xmm(0), xmm(1));
+         sse_addps(&cp->func, result[0], xmm(0));
+      }
+      if (inst->Opcode == FP_OPCODE_DP4) {
+         emit_fetch(cp, xmm(0), inst, 0, 3);
+         emit_fetch(cp, xmm(1), inst, 1, 3);
+         sse_mulps(&cp->func, xmm(0), xmm(1));
+         sse_addps(&cp->func, result[0], xmm(0));
+      }
+      else if (inst->Opcode == FP_OPCODE_DPH) {
+         emit_fetch(cp, xmm(0), inst, 1, 3);
+         sse_addps(&cp->func, result[0], xmm(0));
+      }
+      result[1] = result[2] = result[3] = result[0];
+      break;
+
+   case FP_OPCODE_DST:
+      sse_movaps(&cp->func, result[0], get_machine_ptr(cp, m->One));
+      emit_fetch(cp, result[1], inst, 0, 1);
+      emit_fetch(cp, xmm(0), inst, 1, 1);
+      sse_mulps(&cp->func, result[1], xmm(0));
+      emit_fetch(cp, result[2], inst, 0, 2);
+      emit_fetch(cp, result[3], inst, 1, 3);
+      break;
+
+   case FP_OPCODE_FLR:
+   case FP_OPCODE_FRC:
+      for (c = 0; c < 4; c++) {
+         if (!GET_BIT(mask, c))
+            continue;
+         if (inst->Opcode == FP_OPCODE_FLR) {
+            emit_fetch(cp, result[c], inst, 0, c);
+            emit_floor(cp, result[c], xmm(0), xmm(1), xmm(2));
+         }
+         else {
+            emit_fetch(cp, result[c], inst, 0, c);
+            sse_movaps(&cp->func, xmm(3), result[c]);
+            emit_floor(cp, xmm(3), xmm(0), xmm(1), xmm(2));
+            sse_subps(&cp->func, result[c], xmm(3));
+         }
+      }
+      break;
+
+   case FP_OPCODE_KIL:
+      sse_xorps(&cp->func, xmm(1), xmm(1));
+      for (c = 0; c < 4; c++) {
+         emit_fetch(cp, xmm(0), inst, 0, c);
+         sse_cmpps(&cp->func, xmm(0), get_machine_ptr(cp, m->Zero),
+                   cc_LessThan);
+         sse_orps(&cp->func, xmm(1), xmm(0));
+      }
+      sse_orps(&cp->func, xmm(1), get_machine_ptr(cp, m->Kill));
+      sse_movaps(&cp->func, get_machine_ptr(cp, m->Kill), xmm(1));
+      return GL_TRUE;
+
+   case FP_OPCODE_MOV:
+   case FP_OPCODE_SWZ:
+      for (c = 0; c < 4; c++) {
+         if (GET_BIT(mask, c))
+            emit_fetch(cp, result[c], inst, 0, c);
+      }
+      break;
+
+   case FP_OPCODE_RCP:
+   case FP_OPCODE_RSQ:
+      emit_fetch(cp, xmm(0), inst, 0, 0);
+      if (inst->Opcode == FP_OPCODE_RSQ) {
+         sse_andps(&cp->func, xmm(0), get_machine_ptr(cp, m->AbsMask));
+         sse_sqrtps(&cp->func, xmm(0), xmm(0));
+      }
+      sse_movaps(&cp->func, result[0], get_machine_ptr(cp, m->One));
+      sse_divps(&cp->func, result[0], xmm(0));
+      result[1] = result[2] = result[3] = result[0];
+      break;
+
+   case FP_OPCODE_SEQ:
+      emit_compare(cp, inst, result, cc_Equal, GL_FALSE);
+      break;
+   case FP_OPCODE_SNE:
+      emit_compare(cp, inst, result, cc_NotEqual, GL_FALSE);
+      break;
+   case FP_OPCODE_SLT:
+      emit_compare(cp, inst, result, cc_LessThan, GL_FALSE);
+      break;
+   case FP_OPCODE_SLE:
+      emit_compare(cp, inst, result, cc_LessThanEqual, GL_FALSE);
+      break;
+   case FP_OPCODE_SGT:
+      emit_compare(cp, inst, result, cc_LessThan, GL_TRUE);
+      break;
+   case FP_OPCODE_SGE:
+      emit_compare(cp, inst, result, cc_LessThanEqual, GL_TRUE);
+      break;
+
+   case FP_OPCODE_SFL:
+      sse_xorps(&cp->func, result[0], result[0]);
+      result[1] = result[2] = result[3] = result[0];
+      break;
+   case FP_OPCODE_STR:
+      sse_movaps(&cp->func, result[0], get_machine_ptr(cp, m->One));
+      result[1] = result[2] = result[3] = result[0];
+      break;
+
+   case FP_OPCODE_XPD:
+      for (c = 0; c < 3; c++) {
+         const GLuint c1 = (c + 1) % 3, c2 = (c + 2) % 3;
+         if (!GET_BIT(mask, c))
+            continue;
+         emit_fetch(cp, result[c], inst, 0, c1);
+         emit_fetch(cp, xmm(0), inst, 1, c2);
+         sse_mulps(&cp->func, result[c], xmm(0));
+         emit_fetch(cp, xmm(0), inst, 0, c2);
+         emit_fetch(cp, xmm(1), inst, 1, c1);
+         sse_mulps(&cp->func, xmm(0), xmm(1));
+         sse_subps(&cp->func, result[c], xmm(0));
+      }
+      sse_movaps(&cp->func, result[3], get_machine_ptr(cp, m->One));
+      break;
+
+   case FP_OPCODE_TEX:
+   case FP_OPCODE_TXB:
+   case FP_OPCODE_TXP:
+   case FP_OPCODE_TXP_NV:
+   case FP_OPCODE_COS:
+   case FP_OPCODE_SIN:
+   case FP_OPCODE_SCS:
+   case FP_OPCODE_EX2:
+   case FP_OPCODE_LG2:
+   case FP_OPCODE_LIT:
+   case FP_OPCODE_POW:
+      for (c = 0; c < 4; c++) {
+         emit_fetch(cp, xmm(0), inst, 0, c);
+         sse_movaps(&cp->func, get_machine_ptr(cp, m->Src[0][c]), xmm(0));
+      }
+      if (inst->Opcode == FP_OPCODE_POW) {
+         emit_fetch(cp, xmm(0), inst, 1, 0);
+         sse_movaps(&cp->func, get_machine_ptr(cp, m->Src[1][0]), xmm(0));
+      }
+      emit_callback(cp, pc);
+      for (c = 0; c < 4; c++) {
+         if (GET_BIT(mask, c))
+            sse_movaps(&cp->func, result[c],
+                       get_machine_ptr(cp, m->Result[c]));
+      }
+      break;
+
+   default:
+      /* DDX, DDY, TXD, KIL_NV, pack/unpack, RFL, X2D, PRINT */
+      return GL_FALSE;
+   }
+
+   emit_store(cp, inst, result);
+   return GL_TRUE;
+}
+
+
+static GLboolean
+build_fragment_program( struct compilation *cp )
+{
+   struct fp_sse_program *p = cp->p;
+   GLuint pc;
+
+   cp->machine = x86_make_reg(file_REG32, reg_BX);
+
+   x86_push(&cp->func, cp->machine);
+   x86_mov(&cp->func, cp->machine, x86_fn_arg(&cp->func, 1));
+
+   for (pc = 0; pc < p->NumInstructions; pc++) {
+      const struct fp_instruction *inst = &p->Instructions[pc];
+
+      if (inst->Opcode == FP_OPCODE_END)
+         break;
+
+      if (DISASSEM)
+         _mesa_printf("%p: opcode %d\n", (void *) cp->func.csr, inst->Opcode);
+
+      if (!emit_instruction(cp, inst, pc) || cp->error)
+         return GL_FALSE;
+   }
+
+   x86_pop(&cp->func, cp->machine);
+   x86_ret(&cp->func);
+
+   return GL_TRUE;
+}
+
+
+static void
+free_program( struct fp_sse_program *p )
+{
+   if (p->Code)
+      _mesa_exec_free(p->Code);
+   if (p->Instructions)
+      _mesa_free(p->Instructions);
+   _mesa_free(p);
+}
+
+
+/**
+ * Translate a fragment program.
+ * \return the new compiled program, with a NULL Func if the program
+ * can't be translated, or NULL if out of memory.
+ */
+static struct fp_sse_program *
+compile_program( const struct fragment_program *program )
+{
+   struct compilation cp;
+   struct fp_sse_program *p;
+   GLuint n, size;
+
+   for (n = 0; n < program->Base.NumInstructions; n++) {
+      if (program->Instructions[n].Opcode == FP_OPCODE_END)
+         break;
+   }
+   if (n < program->Base.NumInstructions)
+      n++;
+
+   p = CALLOC_STRUCT(fp_sse_program);
+   if (!p)
+      return NULL;
+
+   p->Program = program;
+   p->Source = program->Instructions;
+   p->NumInstructions = n;
+   p->Instructions = (struct fp_instruction *)
+      _mesa_malloc(n * sizeof(struct fp_instruction));
+   if (!p->Instructions) {
+      free_program(p);
+      return NULL;
+   }
+   _mesa_memcpy(p->Instructions, program->Instructions,
+                n * sizeof(struct fp_instruction));
+
+   /* Assemble into ordinary memory, then copy just the bytes used to
+    * the (small) executable heap.  The code has no absolute addresses
+    * so it can be moved.
+    */
+   _mesa_memset(&cp, 0, sizeof(cp));
+   cp.p = p;
+   size = (n + 1) * FP_SSE_MAX_INST_BYTES;
+   cp.func.store = (GLubyte *) _mesa_malloc(size);
+   if (!cp.func.store) {
+      free_program(p);
+      return NULL;
+   }
+   cp.func.csr = cp.func.store;
+
+   if (build_fragment_program(&cp)) {
+      const GLuint used = cp.func.csr - cp.func.store;
+      ASSERT(used <= size);
+      p->Code = (GLubyte *) _mesa_exec_malloc(used);
+      if (p->Code) {
+         _mesa_memcpy(p->Code, cp.func.store, used);
+         p->Func = (void (*)(struct fp_sse_machine *)) p->Code;
+      }
+   }
+
+   _mesa_free(cp.func.store);
+   return p;
+}
+
+
+/**
+ * Find or build the compiled code for the given program.  Programs
+ * which can't be translated are remembered too (with a NULL Func) so
+ * that we don't retry them for every span.
+ */
+static struct fp_sse_program *
+lookup_program( struct fp_sse_cache *cache,
+                const struct fragment_program *program )
+{
+   struct fp_sse_program *p, *prev = NULL;
+   GLuint count = 0;
+
+   for (p = cache->Programs; p; prev = p, p = p->Next, count++) {
+      if (p->Program == program &&
+          p->Source == program->Instructions &&
+          memcmp(p->Instructions, program->Instructions,
+                       p->NumInstructions * sizeof(struct fp_instruction)) == 0)
+         break;
+   }
+
+   if (p) {
+      /* move to front */
+      if (prev) {
+         prev->Next = p->Next;
+         p->Next = cache->Programs;
+         cache->Programs = p;
+      }
+      return p;
+   }
+
+   p = compile_program(program);
+   if (!p)
+      return NULL;
+
+   p->Next = cache->Programs;
+   cache->Programs = p;
+
+   /* drop the least recently used program */
+   if (count >= FP_SSE_MAX_PROGRAMS) {
+      struct fp_sse_program *last = cache->Programs;
+      while (last->Next->Next)
+         last = last->Next;
+      free_program(last->Next);
+      last->Next = NULL;
+   }
+
+   return p;
+}
+
+
+/**
+ * Execute the instructions which aren't translated to SSE code, for
+ * each of the fragments of the quad, in the same way as the
+ * interpreter does.
+ */
+static void
+callback( struct fp_sse_machine *m, GLuint pc )
+{
+   GLcontext *ctx = m->ctx;
+   const struct fp_instruction *inst = &m->Program->Instructions[pc];
+   const struct sw_span *span = m->Span;
+   GLuint j;
+
+   switch (inst->Opcode) {
+   case FP_OPCODE_TEX:
+   case FP_OPCODE_TXB:
+   case FP_OPCODE_TXP:
+   case FP_OPCODE_TXP_NV:
+      {
+         SWcontext *swrast = SWRAST_CONTEXT(ctx);
+         const GLuint unit = inst->TexSrcUnit;
+         const struct gl_texture_object *texObj
+            = ctx->Texture.Unit[unit]._Current;
+         GLfloat texcoord[4][4], lambda[4];
+         GLchan rgba[4][4];
+         GLuint c;
+
+         for (j = 0; j < 4; j++) {
+            /* unused fragments of a partial quad repeat the last one */
+            const GLuint col = m->Column + MIN2(j, m->Count - 1);
+
+            for (c = 0; c < 4; c++)
+               texcoord[j][c] = m->Src[0][c][j];
+
+            lambda[j] = span->array->lambda[unit][col];
+
+            if (inst->Opcode == FP_OPCODE_TXB) {
+               lambda[j] += ctx->Texture.Unit[unit].LodBias
+                  + texObj->LodBias + texcoord[j][3];
+            }
+            else if ((inst->Opcode == FP_OPCODE_TXP ||
+                      (inst->Opcode == FP_OPCODE_TXP_NV &&
+                       inst->TexSrcIdx != TEXTURE_CUBE_INDEX)) &&
+                     texcoord[j][3] != 0.0) {
+               texcoord[j][0] /= texcoord[j][3];
+               texcoord[j][1] /= texcoord[j][3];
+               texcoord[j][2] /= texcoord[j][3];
+            }
+         }
+
+         swrast->TextureSample[unit](ctx, unit, texObj, 4,
+                                     (const GLfloat (*)[4]) texcoord,
+                                     lambda, rgba);
+
+         for (j = 0; j < 4; j++) {
+            for (c = 0; c < 4; c++)
+               m->Result[c][j] = CHAN_TO_FLOAT(rgba[j][c]);
+         }
+      }
+      break;
+   case FP_OPCODE_COS:
+      for (j = 0; j < 4; j++) {
+         m->Result[0][j] = m->Result[1][j] = m->Result[2][j]
+            = m->Result[3][j] = (GLfloat) _mesa_cos(m->Src[0][0][j]);
+      }
+      break;
+   case FP_OPCODE_SIN:
+      for (j = 0; j < 4; j++) {
+         m->Result[0][j] = m->Result[1][j] = m->Result[2][j]
+            = m->Result[3][j] = (GLfloat) _mesa_sin(m->Src[0][0][j]);
+      }
+      break;
+   case FP_OPCODE_SCS:
+      for (j = 0; j < 4; j++) {
+         m->Result[0][j] = (GLfloat) cos(m->Src[0][0][j]);
+         m->Result[1][j] = (GLfloat) sin(m->Src[0][0][j]);
+         m->Result[2][j] = 0.0F;
+         m->Result[3][j] = 0.0F;
+      }
+      break;
+   case FP_OPCODE_EX2:
+      for (j = 0; j < 4; j++) {
+         m->Result[0][j] = m->Result[1][j] = m->Result[2][j]
+            = m->Result[3][j] = (GLfloat) _mesa_pow(2.0, m->Src[0][0][j]);
+      }
+      break;
+   case FP_OPCODE_LG2:
+      for (j = 0; j < 4; j++) {
+         m->Result[0][j] = m->Result[1][j] = m->Result[2][j]
+            = m->Result[3][j] = LOG2(m->Src[0][0][j]);
+      }
+      break;
+   case FP_OPCODE_POW:
+      for (j = 0; j < 4; j++) {
+         m->Result[0][j] = m->Result[1][j] = m->Result[2][j]
+            = m->Result[3][j] = (GLfloat) _mesa_pow(m->Src[0][0][j],
+                                                    m->Src[1][0][j]);
+      }
+      break;
+   case FP_OPCODE_LIT:
+      for (j = 0; j < 4; j++) {
+         const GLfloat epsilon = 1.0F / 256.0F; /* from NV VP spec */
+         GLfloat a0 = MAX2(m->Src[0][0][j], 0.0F);
+         GLfloat a1 = MAX2(m->Src[0][1][j], 0.0F);
+         GLfloat a3 = CLAMP(m->Src[0][3][j],
+                            -(128.0F - epsilon), (128.0F - epsilon));
+         m->Result[0][j] = 1.0F;
+         m->Result[1][j] = a0;
+         if (a0 > 0.0F) {
+            if (a1 == 0.0 && a3 == 0.0)
+               m->Result[2][j] = 1.0;
+            else
+               m->Result[2][j] = EXPF(a3 * LOGF(a1));
+         }
+         else {
+            m->Result[2][j] = 0.0;
+         }
+         m->Result[3][j] = 1.0F;
+      }
+      break;
+   default:
+      _mesa_problem(ctx, "Bad opcode %d in fragment program callback",
+                    inst->Opcode);
+   }
+}
+
+
+/**
+ * Load the input registers for the fragments [col, col+count) of the
+ * span.  The unused fragments of a partial quad repeat the last one so
+ * that they compute something sensible.
+ */
+static void
+load_inputs( GLcontext *ctx, struct fp_sse_machine *m, GLuint inputsRead,
+             const struct sw_span *span, GLuint col, GLuint count )
+{
+   GLuint j, u;
+
+   for (j = 0; j < 4; j++) {
+      const GLuint i = col + MIN2(j, count - 1);
+
+      if (inputsRead & (1 << FRAG_ATTRIB_WPOS)) {
+         GLfloat (*wpos)[4] = m->Inputs[FRAG_ATTRIB_WPOS];
+         wpos[0][j] = (GLfloat) span->x + i;
+         wpos[1][j] = (GLfloat) span->y;
+         wpos[2][j] = (GLfloat) span->array->z[i] / ctx->DrawBuffer->_DepthMaxF;
+         wpos[3][j] = span->w + i * span->dwdx;
+      }
+      if (inputsRead & (1 << FRAG_ATTRIB_COL0)) {
+         GLfloat (*col0)[4] = m->Inputs[FRAG_ATTRIB_COL0];
+         col0[0][j] = CHAN_TO_FLOAT(span->array->rgba[i][RCOMP]);
+         col0[1][j] = CHAN_TO_FLOAT(span->array->rgba[i][GCOMP]);
+         col0[2][j] = CHAN_TO_FLOAT(span->array->rgba[i][BCOMP]);
+         col0[3][j] = CHAN_TO_FLOAT(span->array->rgba[i][ACOMP]);
+      }
+      if (inputsRead & (1 << FRAG_ATTRIB_COL1)) {
+         GLfloat (*col1)[4] = m->Inputs[FRAG_ATTRIB_COL1];
+         col1[0][j] = CHAN_TO_FLOAT(span->array->spec[i][RCOMP]);
+         col1[1][j] = CHAN_TO_FLOAT(span->array->spec[i][GCOMP]);
+         col1[2][j] = CHAN_TO_FLOAT(span->array->spec[i][BCOMP]);
+         col1[3][j] = CHAN_TO_FLOAT(span->array->spec[i][ACOMP]);
+      }
+      if (inputsRead & (1 << FRAG_ATTRIB_FOGC)) {
+         GLfloat (*fogc)[4] = m->Inputs[FRAG_ATTRIB_FOGC];
+         fogc[0][j] = span->array->fog[i];
+         fogc[1][j] = 0.0F;
+         fogc[2][j] = 0.0F;
+         fogc[3][j] = 0.0F;
+      }
+      for (u = 0; u < ctx->Const.MaxTextureCoordUnits; u++) {
+         if (inputsRead & (1 << (FRAG_ATTRIB_TEX0 + u))) {
+            GLfloat (*tex)[4] = m->Inputs[FRAG_ATTRIB_TEX0 + u];
+            tex[0][j] = span->array->texcoords[u][i][0];
+            tex[1][j] = span->array->texcoords[u][i][1];
+            tex[2][j] = span->array->texcoords[u][i][2];
+            tex[3][j] = span->array->texcoords[u][i][3];
+         }
+      }
+   }
+}
+
+
+/**
+ * Copy the program parameters used by the compiled code into the
+ * machine, replicated for the four fragments.
+ */
+static void
+load_constants( GLcontext *ctx, struct fp_sse_machine *m,
+                const struct fp_sse_program *p,
+                const struct fragment_program *program )
+{
+   GLuint i, c, j;
+
+   for (i = 0; i < p->NumConsts; i++) {
+      const GLfloat *src;
+
+      switch (p->Const[i].File) {
+      case PROGRAM_LOCAL_PARAM:
+         src = program->Base.LocalParams[p->Const[i].Index];
+         break;
+      case PROGRAM_ENV_PARAM:
+         src = ctx->FragmentProgram.Parameters[p->Const[i].Index];
+         break;
+      default:
+         src = program->Parameters->ParameterValues[p->Const[i].Index];
+         break;
+      }
+
+      for (c = 0; c < 4; c++)
+         for (j = 0; j < 4; j++)
+            m->Consts[i][c][j] = src[c];
+   }
+}
+
+
+static void
+init_machine( struct fp_sse_machine *m )
+{
+   GLuint j;
+
+   _mesa_bzero(m, sizeof(*m));
+
+   for (j = 0; j < 4; j++) {
+      fi_type sign, abs;
+      sign.i = 0x80000000;
+      abs.i = 0x7fffffff;
+      m->One[j] = 1.0F;
+      m->SignMask[j] = sign.f;
+      m->AbsMask[j] = abs.f;
+      m->Big[j] = 8388608.0F;
+   }
+
+   m->Callback = callback;
+}
+
+
+/**
+ * Run the current fragment program on the span with the compiled code.
+ * \return GL_FALSE if there's no compiled code for the program, in
+ * which case the caller should use the interpreter.
+ */
+GLboolean
+_swrast_sse_exec_fragment_program( GLcontext *ctx, struct sw_span *span )
+{
+   SWcontext *swrast = SWRAST_CONTEXT(ctx);
+   struct fp_sse_cache *cache = swrast->FragProgSSE;
+   const struct fragment_program *program = ctx->FragmentProgram._Current;
+   const GLboolean writeDepth
+      = (program->OutputsWritten & (1 << FRAG_OUTPUT_DEPR)) != 0;
+   struct fp_sse_program *p;
+   struct fp_sse_machine *m;
+   GLuint i, j;
+
+   if (!cache) {
+      cache = swrast->FragProgSSE = CALLOC_STRUCT(fp_sse_cache);
+      if (!cache)
+         return GL_FALSE;
+#if defined(USE_SSE_ASM)
+      cache->Disabled = !cpu_has_xmm2;
+#endif
+      if (_mesa_getenv("MESA_NO_CODEGEN"))
+         cache->Disabled = GL_TRUE;
+      if (!cache->Disabled) {
+         cache->Machine = (struct fp_sse_machine *)
+            _mesa_align_malloc(sizeof(struct fp_sse_machine), 16);
+         if (cache->Machine)
+            init_machine(cache->Machine);
+         else
+            cache->Disabled = GL_TRUE;
+      }
+   }
+
+   if (cache->Disabled || ctx->FragmentProgram.CallbackEnabled)
+      return GL_FALSE;
+
+   p = cache->Current;
+   if (!p || p->Program != program || p->Source != program->Instructions) {
+      p = cache->Current = lookup_program(cache, program);
+      if (!p)
+         return GL_FALSE;
+   }
+   if (!p->Func)
+      return GL_FALSE;
+
+   m = cache->Machine;
+   m->ctx = ctx;
+   m->Program = program;
+   m->Span = span;
+
+   load_constants(ctx, m, p, program);
+
+   for (i = 0; i < span->end; i += 4) {
+      const GLuint count = MIN2(4, span->end - i);
+      GLubyte *mask = span->array->mask + i;
+
+      for (j = 0; j < count; j++) {
+         if (mask[j])
+            break;
+      }
+      if (j == count)
+         continue;
+
+      load_inputs(ctx, m, program->InputsRead, span, i, count);
+
+      if (program->Base.Target == GL_FRAGMENT_PROGRAM_NV) {
+         /* Clear temporary registers (undefined for ARB_f_p) */
+         _mesa_bzero(m->Temps, p->NumTemps * sizeof(m->Temps[0]));
+      }
+      m->Kill[0] = m->Kill[1] = m->Kill[2] = m->Kill[3] = 0;
+      m->Column = i;
+      m->Count = count;
+
+      p->Func(m);
+
+      for (j = 0; j < count; j++) {
+         const GLfloat (*colOut)[4] = m->Outputs[FRAG_OUTPUT_COLR];
+
+         if (!mask[j])
+            continue;
+
+         if (m->Kill[j]) {
+            mask[j] = GL_FALSE;  /* killed fragment */
+            span->writeAll = GL_FALSE;
+            continue;
+         }
+
+         UNCLAMPED_FLOAT_TO_CHAN(span->array->rgba[i + j][RCOMP], colOut[0][j]);
+         UNCLAMPED_FLOAT_TO_CHAN(span->array->rgba[i + j][GCOMP], colOut[1][j]);
+         UNCLAMPED_FLOAT_TO_CHAN(span->array->rgba[i + j][BCOMP], colOut[2][j]);
+         UNCLAMPED_FLOAT_TO_CHAN(span->array->rgba[i + j][ACOMP], colOut[3][j]);
+
+         if (writeDepth) {
+            const GLfloat depth = m->Outputs[FRAG_OUTPUT_DEPR][2][j];
+            span->array->z[i + j] = IROUND(depth * ctx->DrawBuffer->_DepthMaxF);
+         }
+      }
+   }
+
+   return GL_TRUE;
+}
+
+
+/**
+ * Called when the fragment program state changes; a program string
+ * may have been respecified in place.
+ */
+void
+_swrast_sse_invalidate_fragment_program( GLcontext *ctx )
+{
+   SWcontext *swrast = SWRAST_CONTEXT(ctx);
+   if (swrast->FragProgSSE)
+      swrast->FragProgSSE->Current = NULL;
+}
+
+
+void
+_swrast_sse_destroy_fragment_programs( GLcontext *ctx )
+{
+   SWcontext *swrast = SWRAST_CONTEXT(ctx);
+   struct fp_sse_cache *cache = swrast->FragProgSSE;
+
+   if (cache) {
+      while (cache->Programs) {
+         struct fp_sse_program *next = cache->Programs->Next;
+         free_program(cache->Programs);
+         cache->Programs = next;
+      }
+      if (cache->Machine)
+         _mesa_align_free(cache->Machine);
+      _mesa_free(cache);
+      swrast->FragProgSSE = NULL;
+   }
+}
+
+
+#else
+
+
+GLboolean
+_swrast_sse_exec_fragment_program( GLcontext *ctx, struct sw_span *span )
+{
+   /* Dummy version for when there's no SSE code generator */
+   (void) ctx;
+   (void) span;
+   return GL_FALSE;
+}
+
+void
+_swrast_sse_invalidate_fragment_program( GLcontext *ctx )
+{
+   (void) ctx;
+}
+
+void
+_swrast_sse_destroy_fragment_programs( GLcontext *ctx )
+{
+   (void) ctx;
+}
+
+
+#endif
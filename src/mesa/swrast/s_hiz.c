@@ -0,0 +1,479 @@
+/*
+ * Mesa 3-D graphics library
+ * Version:  6.5
+ *
+ * Copyright (C) 1999-2006  Brian Paul   All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * BRIAN PAUL BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ * AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/*
+ * Hierarchical Z.
+ *
+ * For the bound depth buffer we keep the maximum depth value of every
+ * 8x8 pixel tile, and of every 8x1 strip within a tile.  With the
+ * GL_LESS and GL_LEQUAL depth functions a fragment whose depth is
+ * greater than (or equal to) the maximum of its tile is sure to fail
+ * the depth test, so the triangle template can drop whole triangles and
+ * spans without interpolating or testing any of their fragments.
+ *
+ * The maxima are updated exactly whenever swrast clears or writes the
+ * depth buffer.  Drivers' own depth-writing triangle and line functions
+ * are only used with GL_LESS, which can only lower depth values, so
+ * the maxima remain valid (if conservative) upper bounds after those.
+ *
+ * While binned triangles are replayed (see s_tribin.c) every thread
+ * writes whole 16-row bands, which are made of whole tile rows, so the
+ * threads never update the same strip or tile.
+ */
+
+
+#include "glheader.h"
+#include "context.h"
+#include "imports.h"
+#include "macros.h"
+
+#include "s_context.h"
+#include "s_depth.h"
+#include "s_hiz.h"
+#include "s_lazyclear.h"
+
+
+/**
+ * Can we track the given depth renderbuffer?  We need direct access to
+ * the depth values, and values which fit in a GLint-sized span z.
+ * Depth values packed with stencil values are read from the packed
+ * buffer.
+ */
+static GLboolean
+hiz_supported( GLcontext *ctx, struct gl_renderbuffer *rb )
+{
+   const GLuint depthBits = ctx->DrawBuffer->Visual.depthBits;
+
+   if (rb && rb->NumSamples)
+      return GL_FALSE;  /* one depth buffer per sample */
+
+   if (_swrast_get_packed_depth_stencil(ctx, rb))
+      return depthBits > 16 && depthBits <= 24;
+
+   if (!rb || !rb->GetPointer)
+      return GL_FALSE;
+
+   if (rb->DataType == GL_UNSIGNED_SHORT)
+      return depthBits > 0 && depthBits <= 16;
+   else if (rb->DataType == GL_UNSIGNED_INT)
+      return depthBits > 16 && depthBits <= 24;
+   else
+      return GL_FALSE;
+}
+
+
+/**
+ * Compute the maximum depth value of strip tx on row y.
+ */
+static GLuint
+compute_strip( GLcontext *ctx, const struct swrast_hiz *hiz,
+               GLint tx, GLint y )
+{
+   struct gl_renderbuffer *rb = hiz->Renderbuffer;
+   const GLint x0 = tx << HIZ_TILE_SHIFT;
+   const GLint x1 = MIN2(x0 + HIZ_TILE_SIZE, (GLint) hiz->Width);
+   GLuint zMax = 0;
+   GLint x;
+
+   if (rb->Wrapped->_BaseFormat == GL_DEPTH_STENCIL_MESA) {
+      /* packed depth/stencil, the depth values are in the high 24 bits */
+      struct gl_renderbuffer *dsrb = rb->Wrapped;
+      const GLuint *zsRow = (const GLuint *) dsrb->GetPointer(ctx, dsrb, 0, y);
+      for (x = x0; x < x1; x++)
+         zMax = MAX2(zMax, zsRow[x]);
+      zMax >>= 8;
+   }
+   else if (rb->DataType == GL_UNSIGNED_SHORT) {
+      const GLushort *zRow = (const GLushort *) rb->GetPointer(ctx, rb, 0, y);
+      for (x = x0; x < x1; x++)
+         zMax = MAX2(zMax, zRow[x]);
+   }
+   else {
+      const GLuint *zRow = (const GLuint *) rb->GetPointer(ctx, rb, 0, y);
+      for (x = x0; x < x1; x++)
+         zMax = MAX2(zMax, zRow[x]);
+   }
+   return zMax;
+}
+
+
+/**
+ * Recompute the maximum of tile (tx, ty) from its strips.
+ */
+static void
+compute_tile( struct swrast_hiz *hiz, GLint tx, GLint ty )
+{
+   const GLint y0 = ty << HIZ_TILE_SHIFT;
+   const GLint y1 = MIN2(y0 + HIZ_TILE_SIZE, (GLint) hiz->Height);
+   const GLuint *strip = hiz->StripMax + y0 * hiz->TilesX + tx;
+   GLuint zMax = 0;
+   GLint y;
+
+   for (y = y0; y < y1; y++) {
+      zMax = MAX2(zMax, *strip);
+      strip += hiz->TilesX;
+   }
+   hiz->TileMax[ty * hiz->TilesX + tx] = zMax;
+}
+
+
+/**
+ * Recompute the strip maxima of the pixels in the given rectangle,
+ * then the maxima of the tiles containing them.
+ */
+static void
+update_rect( GLcontext *ctx, struct swrast_hiz *hiz,
+             GLint x, GLint y, GLint width, GLint height )
+{
+   GLint tx, ty, tx0, tx1, i;
+
+   tx0 = x >> HIZ_TILE_SHIFT;
+   tx1 = (x + width - 1) >> HIZ_TILE_SHIFT;
+
+   for (i = y; i < y + height; i++) {
+      GLuint *strip = hiz->StripMax + i * hiz->TilesX;
+      for (tx = tx0; tx <= tx1; tx++)
+         strip[tx] = compute_strip(ctx, hiz, tx, i);
+   }
+
+   for (ty = y >> HIZ_TILE_SHIFT; ty <= (y + height - 1) >> HIZ_TILE_SHIFT;
+        ty++) {
+      for (tx = tx0; tx <= tx1; tx++)
+         compute_tile(hiz, tx, ty);
+   }
+}
+
+
+/**
+ * Check that hiz tracks rb, and that rb hasn't been resized behind our
+ * back.  If it has, stop tracking it; _swrast_validate_hiz() will start
+ * over after the resize.
+ */
+static GLboolean
+hiz_tracking( struct swrast_hiz *hiz, const struct gl_renderbuffer *rb )
+{
+   if (!hiz || hiz->Renderbuffer != rb)
+      return GL_FALSE;
+   if (hiz->Width != rb->Width || hiz->Height != rb->Height) {
+      hiz->Renderbuffer = NULL;
+      return GL_FALSE;
+   }
+   return GL_TRUE;
+}
+
+
+/**
+ * Start tracking renderbuffer rb.  All the maxima are computed from the
+ * current contents of the buffer.
+ */
+static void
+bind_renderbuffer( GLcontext *ctx, struct gl_renderbuffer *rb )
+{
+   SWcontext *swrast = SWRAST_CONTEXT(ctx);
+   struct swrast_hiz *hiz = swrast->HiZ;
+   const GLuint tilesX = (rb->Width + HIZ_TILE_SIZE - 1) >> HIZ_TILE_SHIFT;
+   const GLuint tilesY = (rb->Height + HIZ_TILE_SIZE - 1) >> HIZ_TILE_SHIFT;
+
+   hiz->Renderbuffer = NULL;
+
+   if (hiz->Width != rb->Width || hiz->Height != rb->Height || !hiz->TileMax) {
+      if (hiz->StripMax)
+         _mesa_free(hiz->StripMax);
+      if (hiz->TileMax)
+         _mesa_free(hiz->TileMax);
+      hiz->StripMax = (GLuint *) _mesa_malloc(tilesX * rb->Height
+                                              * sizeof(GLuint));
+      hiz->TileMax = (GLuint *) _mesa_malloc(tilesX * tilesY
+                                             * sizeof(GLuint));
+      if (!hiz->StripMax || !hiz->TileMax) {
+         if (hiz->StripMax)
+            _mesa_free(hiz->StripMax);
+         if (hiz->TileMax)
+            _mesa_free(hiz->TileMax);
+         hiz->StripMax = hiz->TileMax = NULL;
+         hiz->Width = hiz->Height = 0;
+         return;
+      }
+      hiz->Width = rb->Width;
+      hiz->Height = rb->Height;
+      hiz->TilesX = tilesX;
+      hiz->TilesY = tilesY;
+   }
+
+   hiz->Renderbuffer = rb;
+   if (rb->Width > 0 && rb->Height > 0)
+      update_rect(ctx, hiz, 0, 0, rb->Width, rb->Height);
+}
+
+
+/**
+ * Called from _swrast_validate_triangle() to bind the current depth
+ * buffer and decide whether triangles may be culled against it.
+ */
+void
+_swrast_validate_hiz( GLcontext *ctx )
+{
+   SWcontext *swrast = SWRAST_CONTEXT(ctx);
+   struct gl_renderbuffer *rb
+      = ctx->DrawBuffer->Attachment[BUFFER_DEPTH].Renderbuffer;
+
+   swrast->_HiZActive = GL_FALSE;
+
+   if (!swrast->HiZ) {
+      swrast->HiZ = CALLOC_STRUCT(swrast_hiz);
+      if (!swrast->HiZ)
+         return;
+      swrast->HiZ->Disabled = (_mesa_getenv("MESA_NO_HIZ") != NULL);
+   }
+
+   if (swrast->HiZ->Disabled || !hiz_supported(ctx, rb)) {
+      swrast->HiZ->Renderbuffer = NULL;
+      return;
+   }
+
+   if (!hiz_tracking(swrast->HiZ, rb)) {
+      /* the maxima are computed from the depth values in memory */
+      _swrast_resolve_lazy_clear(ctx, rb, 0, 0, rb->Width, rb->Height);
+      bind_renderbuffer(ctx, rb);
+   }
+   if (swrast->HiZ->Renderbuffer != rb)
+      return;
+
+   /* Culling is only safe if fragments which fail the depth test have
+    * no side effects and can't have their depth changed.
+    */
+   if (!ctx->Depth.Test ||
+       (ctx->Depth.Func != GL_LESS && ctx->Depth.Func != GL_LEQUAL) ||
+       ctx->FragmentProgram._Active)
+      return;
+
+   if (ctx->Stencil.Enabled &&
+       (ctx->Stencil.FailFunc[0] != GL_KEEP ||
+        ctx->Stencil.FailFunc[1] != GL_KEEP ||
+        ctx->Stencil.ZFailFunc[0] != GL_KEEP ||
+        ctx->Stencil.ZFailFunc[1] != GL_KEEP))
+      return;
+
+   swrast->HiZ->Bias = (ctx->Depth.Func == GL_LESS) ? 1 : 0;
+   swrast->_HiZActive = GL_TRUE;
+}
+
+
+void
+_swrast_destroy_hiz( GLcontext *ctx )
+{
+   SWcontext *swrast = SWRAST_CONTEXT(ctx);
+   struct swrast_hiz *hiz = swrast->HiZ;
+
+   if (hiz) {
+      if (hiz->StripMax)
+         _mesa_free(hiz->StripMax);
+      if (hiz->TileMax)
+         _mesa_free(hiz->TileMax);
+      _mesa_free(hiz);
+      swrast->HiZ = NULL;
+   }
+   swrast->_HiZActive = GL_FALSE;
+}
+
+
+/**
+ * Called after depth values were written to the span [x, x+n) on row y.
+ */
+void
+_swrast_hiz_update_span( GLcontext *ctx, struct gl_renderbuffer *rb,
+                         GLint x, GLint y, GLuint n )
+{
+   struct swrast_hiz *hiz = SWRAST_CONTEXT(ctx)->HiZ;
+   GLuint *strip;
+   GLint tx, tx1;
+
+   if (!hiz_tracking(hiz, rb) || n == 0 ||
+       y < 0 || y >= (GLint) hiz->Height)
+      return;
+
+   if (x < 0) {
+      n += x;
+      x = 0;
+   }
+   if (x + (GLint) n > (GLint) hiz->Width)
+      n = hiz->Width - x;
+   if ((GLint) n <= 0)
+      return;
+
+   strip = hiz->StripMax + y * hiz->TilesX;
+   tx1 = (x + n - 1) >> HIZ_TILE_SHIFT;
+   for (tx = x >> HIZ_TILE_SHIFT; tx <= tx1; tx++) {
+      const GLuint zMax = compute_strip(ctx, hiz, tx, y);
+      if (zMax != strip[tx]) {
+         strip[tx] = zMax;
+         compute_tile(hiz, tx, y >> HIZ_TILE_SHIFT);
+      }
+   }
+}
+
+
+/**
+ * Called after depth values were written to the pixels at (x[i], y[i])
+ * for which mask[i] is set.
+ */
+void
+_swrast_hiz_update_pixels( GLcontext *ctx, struct gl_renderbuffer *rb,
+                           GLuint n, const GLint x[], const GLint y[],
+                           const GLubyte mask[] )
+{
+   struct swrast_hiz *hiz = SWRAST_CONTEXT(ctx)->HiZ;
+   GLuint i;
+
+   if (!hiz_tracking(hiz, rb))
+      return;
+
+   for (i = 0; i < n; i++) {
+      if (mask[i] &&
+          x[i] >= 0 && x[i] < (GLint) hiz->Width &&
+          y[i] >= 0 && y[i] < (GLint) hiz->Height) {
+         const GLint tx = x[i] >> HIZ_TILE_SHIFT;
+         GLuint *strip = hiz->StripMax + y[i] * hiz->TilesX + tx;
+         const GLuint zMax = compute_strip(ctx, hiz, tx, y[i]);
+         if (zMax != *strip) {
+            *strip = zMax;
+            compute_tile(hiz, tx, y[i] >> HIZ_TILE_SHIFT);
+         }
+      }
+   }
+}
+
+
+/**
+ * Called after the given rectangle of the depth buffer was cleared to
+ * clearValue.  Strips inside the rectangle take the clear value, the
+ * ones straddling its left and right edges are recomputed.  Likewise
+ * for the tiles.
+ */
+void
+_swrast_hiz_clear( GLcontext *ctx, struct gl_renderbuffer *rb,
+                   GLint x, GLint y, GLint width, GLint height,
+                   GLuint clearValue )
+{
+   struct swrast_hiz *hiz = SWRAST_CONTEXT(ctx)->HiZ;
+   GLint tx, ty, tx0, tx1, ty0, ty1, in0, in1, i;
+
+   if (!hiz_tracking(hiz, rb) || width <= 0 || height <= 0)
+      return;
+
+   tx0 = x >> HIZ_TILE_SHIFT;
+   tx1 = (x + width - 1) >> HIZ_TILE_SHIFT;
+
+   /* the strips [in0, in1] lie entirely inside the rectangle */
+   in0 = (x + HIZ_TILE_SIZE - 1) >> HIZ_TILE_SHIFT;
+   in1 = tx1;
+   if (x + width < (GLint) hiz->Width &&
+       ((x + width) & (HIZ_TILE_SIZE - 1)) != 0)
+      in1--;
+
+   for (i = y; i < y + height; i++) {
+      GLuint *strip = hiz->StripMax + i * hiz->TilesX;
+      for (tx = in0; tx <= in1; tx++)
+         strip[tx] = clearValue;
+      if (tx0 < in0)
+         strip[tx0] = compute_strip(ctx, hiz, tx0, i);
+      if (tx1 > in1 && tx1 >= in0)
+         strip[tx1] = compute_strip(ctx, hiz, tx1, i);
+   }
+
+   ty0 = y >> HIZ_TILE_SHIFT;
+   ty1 = (y + height - 1) >> HIZ_TILE_SHIFT;
+
+   for (ty = ty0; ty <= ty1; ty++) {
+      /* is the whole column of strips of this tile row cleared? */
+      const GLint y0 = ty << HIZ_TILE_SHIFT;
+      const GLint y1 = MIN2(y0 + HIZ_TILE_SIZE, (GLint) hiz->Height);
+      const GLboolean fullRows = (y0 >= y && y1 <= y + height);
+      GLuint *tile = hiz->TileMax + ty * hiz->TilesX;
+
+      for (tx = tx0; tx <= tx1; tx++) {
+         if (fullRows && tx >= in0 && tx <= in1)
+            tile[tx] = clearValue;
+         else
+            compute_tile(hiz, tx, ty);
+      }
+   }
+}
+
+
+/**
+ * Test if the triangle is sure to be hidden, judging by the tiles its
+ * bounding box touches.  Only rows [yMin, yMax) are considered, which
+ * lets threads replaying bins look at their own tiles only.
+ */
+GLboolean
+_swrast_hiz_reject_triangle( GLcontext *ctx, const SWvertex *v0,
+                             const SWvertex *v1, const SWvertex *v2,
+                             GLint yMin, GLint yMax )
+{
+   const struct swrast_hiz *hiz = SWRAST_CONTEXT(ctx)->HiZ;
+   GLfloat xMinF, xMaxF, yMinF, yMaxF, zMinF;
+   GLint x0, x1, y0, y1, tx, ty, tx0, tx1;
+   GLuint zMin;
+
+   xMinF = MIN2(v0->win[0], MIN2(v1->win[0], v2->win[0]));
+   xMaxF = MAX2(v0->win[0], MAX2(v1->win[0], v2->win[0]));
+   yMinF = MIN2(v0->win[1], MIN2(v1->win[1], v2->win[1]));
+   yMaxF = MAX2(v0->win[1], MAX2(v1->win[1], v2->win[1]));
+   zMinF = MIN2(v0->win[2], MIN2(v1->win[2], v2->win[2]));
+
+   /* bounding box, with a pixel to spare for sub-pixel snapping */
+   x0 = IFLOOR(xMinF) - 1;
+   x1 = IFLOOR(xMaxF) + 2;
+   y0 = IFLOOR(yMinF) - 1;
+   y1 = IFLOOR(yMaxF) + 2;
+
+   /* The interpolated depth values can't be less than the smallest
+    * vertex depth, give or take the error accumulated by stepping the
+    * interpolants (less than a unit per step).
+    */
+   zMinF -= (GLfloat) (x1 - x0 + y1 - y0 + 2);
+   if (!(zMinF > 0.0F))
+      return GL_FALSE;
+   zMin = (GLuint) zMinF + hiz->Bias;
+
+   x0 = MAX2(x0, 0);
+   x1 = MIN2(x1, (GLint) hiz->Width);
+   y0 = MAX2(y0, MAX2(yMin, 0));
+   y1 = MIN2(y1, MIN2(yMax, (GLint) hiz->Height));
+   if (x0 >= x1 || y0 >= y1)
+      return GL_FALSE;
+
+   tx0 = x0 >> HIZ_TILE_SHIFT;
+   tx1 = (x1 - 1) >> HIZ_TILE_SHIFT;
+   for (ty = y0 >> HIZ_TILE_SHIFT; ty <= (y1 - 1) >> HIZ_TILE_SHIFT; ty++) {
+      const GLuint *tile = hiz->TileMax + ty * hiz->TilesX;
+      for (tx = tx0; tx <= tx1; tx++) {
+         if (zMin <= tile[tx])
+            return GL_FALSE;
+      }
+   }
+   return GL_TRUE;
+}
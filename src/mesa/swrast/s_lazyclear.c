@@ -0,0 +1,558 @@
+/*
+ * Mesa 3-D graphics library
+ * Version:  6.5
+ *
+ * Copyright (C) 1999-2006  Brian Paul   All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * BRIAN PAUL BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ * AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/*
+ * Lazy (tiled) clears.
+ *
+ * Instead of writing every pixel, glClear just tags the 16x16 pixel
+ * tiles it covers with the clear value.  A tagged tile is filled with
+ * its value ("materialized") the first time anything reads or writes
+ * pixels in it, so a clear costs O(tiles) and tiles which aren't touched
+ * before the next clear are never written at all.
+ *
+ * The tags are kept in the renderbuffer (rb->LazyClear), which doesn't
+ * know about them, so every path that accesses a renderbuffer with
+ * pending tags must resolve the tiles it touches first:
+ *
+ *  - points, lines and triangles resolve their bounding box in
+ *    _swrast_Point/Line/Triangle(), before they are binned or drawn;
+ *  - span writes and reads, glDrawPixels, glCopyPixels, glReadPixels,
+ *    glBitmap and glAccum resolve the rows or rectangles they access;
+ *  - _swrast_validate_hiz() resolves a depth buffer before reading it.
+ *
+ * Only buffers that no one but swrast can see are cleared lazily: the
+ * depth and stencil buffers of window system framebuffers (which drivers
+ * must not access behind swrast's back once they have called
+ * _swrast_allow_lazy_clears()) and the renderbuffers of user-created
+ * framebuffer objects.  Window system color buffers are always cleared
+ * at once.
+ */
+
+
+#include "glheader.h"
+#include "context.h"
+#include "imports.h"
+#include "macros.h"
+
+#include "s_context.h"
+#include "s_lazyclear.h"
+
+
+/**
+ * Bytes per pixel of a renderbuffer, or 0 if lazy clears aren't
+ * supported for its format.
+ */
+static GLuint
+pixel_size( const struct gl_renderbuffer *rb )
+{
+   GLuint comps, bytes;
+
+   switch (rb->_BaseFormat) {
+   case GL_RGBA:
+      comps = 4;
+      break;
+   case GL_RGB:
+      comps = 3;
+      break;
+   case GL_DEPTH_COMPONENT:
+   case GL_STENCIL_INDEX:
+   case GL_DEPTH_STENCIL_MESA:
+      comps = 1;
+      break;
+   default:
+      return 0;
+   }
+
+   switch (rb->DataType) {
+   case GL_UNSIGNED_BYTE:
+      bytes = 1;
+      break;
+   case GL_UNSIGNED_SHORT:
+      bytes = 2;
+      break;
+   case GL_UNSIGNED_INT:
+   case GL_UNSIGNED_INT_24_8_MESA:
+   case GL_FLOAT:
+      bytes = 4;
+      break;
+   default:
+      return 0;
+   }
+
+   return comps * bytes;
+}
+
+
+/**
+ * May renderbuffer rb, which holds the storage of one of fb's
+ * attachments, be cleared lazily?  It must be directly addressable and
+ * invisible to anything but swrast.
+ */
+static GLboolean
+lazy_clear_allowed( GLcontext *ctx, const struct gl_framebuffer *fb,
+                    struct gl_renderbuffer *rb )
+{
+   GLuint i;
+
+   if (!SWRAST_CONTEXT(ctx)->AllowLazyClears)
+      return GL_FALSE;
+
+   if (pixel_size(rb) == 0 || !rb->GetPointer(ctx, rb, 0, 0))
+      return GL_FALSE;
+
+   for (i = 0; i < BUFFER_COUNT; i++) {
+      const struct gl_renderbuffer_attachment *att = fb->Attachment + i;
+      if (att->Renderbuffer && att->Renderbuffer->Wrapped == rb) {
+         return att->Type == GL_RENDERBUFFER_EXT &&
+            (fb->Name != 0 || i == BUFFER_DEPTH || i == BUFFER_STENCIL);
+      }
+   }
+   return GL_FALSE;
+}
+
+
+/**
+ * Return the tags of renderbuffer rb, allocating them if needed.  Tags
+ * left from before a resize are dropped; the contents of a resized
+ * buffer are undefined anyway.
+ */
+static struct swrast_lazy_clear *
+get_lazy_clear( struct gl_renderbuffer *rb )
+{
+   struct swrast_lazy_clear *lc = (struct swrast_lazy_clear *) rb->LazyClear;
+   const GLuint tilesX
+      = (rb->Width + LAZY_CLEAR_TILE_SIZE - 1) >> LAZY_CLEAR_TILE_SHIFT;
+   const GLuint tilesY
+      = (rb->Height + LAZY_CLEAR_TILE_SIZE - 1) >> LAZY_CLEAR_TILE_SHIFT;
+   const GLuint size = pixel_size(rb);
+
+   if (lc && lc->Width == rb->Width && lc->Height == rb->Height &&
+       lc->PixelSize == size)
+      return lc;
+
+   if (lc)
+      _mesa_free(lc);
+
+   /* the tag flags and values follow the struct in the same block */
+   lc = (struct swrast_lazy_clear *)
+      _mesa_malloc(sizeof(struct swrast_lazy_clear)
+                   + tilesX * tilesY * (1 + size));
+   rb->LazyClear = lc;
+   if (!lc)
+      return NULL;
+
+   lc->Width = rb->Width;
+   lc->Height = rb->Height;
+   lc->TilesX = tilesX;
+   lc->TilesY = tilesY;
+   lc->PixelSize = size;
+   lc->NumTagged = 0;
+   lc->Tagged = (GLubyte *) (lc + 1);
+   lc->Values = lc->Tagged + tilesX * tilesY;
+   _mesa_bzero(lc->Tagged, tilesX * tilesY);
+   return lc;
+}
+
+
+/**
+ * Fill a rectangle of rb with a pixel value.  If writemask is not NULL
+ * only the bits set in it are written.
+ */
+static void
+fill_rect( GLcontext *ctx, struct gl_renderbuffer *rb, GLuint size,
+           GLint x, GLint y, GLint width, GLint height,
+           const GLubyte *value, const GLubyte *writemask )
+{
+   GLint i, j;
+   GLuint k;
+
+   for (i = 0; i < height; i++) {
+      GLubyte *dst = (GLubyte *) rb->GetPointer(ctx, rb, x, y + i);
+
+      if (writemask) {
+         for (j = 0; j < width; j++) {
+            for (k = 0; k < size; k++) {
+               dst[k] = (dst[k] & ~writemask[k]) | (value[k] & writemask[k]);
+            }
+            dst += size;
+         }
+      }
+      else if (size == 1) {
+         _mesa_memset(dst, value[0], width);
+      }
+      else if (size == 2) {
+         GLushort *dst16 = (GLushort *) dst, value16;
+         MEMCPY(&value16, value, 2);
+         for (j = 0; j < width; j++)
+            dst16[j] = value16;
+      }
+      else if (size == 4) {
+         GLuint *dst32 = (GLuint *) dst, value32;
+         MEMCPY(&value32, value, 4);
+         for (j = 0; j < width; j++)
+            dst32[j] = value32;
+      }
+      else {
+         for (j = 0; j < width; j++) {
+            MEMCPY(dst, value, size);
+            dst += size;
+         }
+      }
+   }
+}
+
+
+/**
+ * The rectangle of tile (tx, ty) which lies inside the buffer.
+ */
+static void
+tile_rect( const struct swrast_lazy_clear *lc, GLint tx, GLint ty,
+           GLint *x, GLint *y, GLint *width, GLint *height )
+{
+   *x = tx << LAZY_CLEAR_TILE_SHIFT;
+   *y = ty << LAZY_CLEAR_TILE_SHIFT;
+   *width = MIN2(LAZY_CLEAR_TILE_SIZE, (GLint) lc->Width - *x);
+   *height = MIN2(LAZY_CLEAR_TILE_SIZE, (GLint) lc->Height - *y);
+}
+
+
+/**
+ * Fill tagged tile (tx, ty) with its value and untag it.
+ */
+static void
+materialize_tile( GLcontext *ctx, struct gl_renderbuffer *rb,
+                  struct swrast_lazy_clear *lc, GLint tx, GLint ty )
+{
+   const GLuint t = ty * lc->TilesX + tx;
+   GLint x, y, width, height;
+
+   ASSERT(lc->Tagged[t]);
+   tile_rect(lc, tx, ty, &x, &y, &width, &height);
+   fill_rect(ctx, rb, lc->PixelSize, x, y, width, height,
+             lc->Values + t * lc->PixelSize, NULL);
+   lc->Tagged[t] = 0;
+   lc->NumTagged--;
+}
+
+
+/**
+ * Clear the current drawing region (the scissor box) of renderbuffer rb
+ * lazily.  value is the clear value, in the format of the pixels of rb's
+ * storage (rb->Wrapped), and writemask tells which bits of it are to be
+ * written.  Tiles entirely inside the region are tagged (or have their
+ * tag updated); the pixels of the others are written at once.
+ *
+ * \return GL_FALSE if rb can't be cleared lazily, and wasn't cleared.
+ */
+GLboolean
+_swrast_lazy_clear( GLcontext *ctx, struct gl_renderbuffer *rb,
+                    const void *value, const void *writemask )
+{
+   const struct gl_framebuffer *fb = ctx->DrawBuffer;
+   const GLubyte *val = (const GLubyte *) value;
+   const GLubyte *wmask = (const GLubyte *) writemask;
+   const GLint x0 = fb->_Xmin, x1 = fb->_Xmax;
+   const GLint y0 = fb->_Ymin, y1 = fb->_Ymax;
+   struct swrast_lazy_clear *lc;
+   GLboolean fullMask = GL_TRUE;
+   GLuint size, k;
+   GLint tx, ty;
+
+   rb = rb->Wrapped;
+   if (!lazy_clear_allowed(ctx, fb, rb)) {
+      /* the caller clears the pixels, don't let old tags override them */
+      _swrast_resolve_lazy_clear(ctx, rb, x0, y0, x1 - x0, y1 - y0);
+      return GL_FALSE;
+   }
+
+   lc = get_lazy_clear(rb);
+   if (!lc)
+      return GL_FALSE;
+
+   if (x0 >= x1 || y0 >= y1)
+      return GL_TRUE;
+
+   size = lc->PixelSize;
+   for (k = 0; k < size; k++) {
+      if (wmask[k] != 0xff)
+         fullMask = GL_FALSE;
+   }
+
+   for (ty = y0 >> LAZY_CLEAR_TILE_SHIFT;
+        ty <= (y1 - 1) >> LAZY_CLEAR_TILE_SHIFT; ty++) {
+      for (tx = x0 >> LAZY_CLEAR_TILE_SHIFT;
+           tx <= (x1 - 1) >> LAZY_CLEAR_TILE_SHIFT; tx++) {
+         const GLuint t = ty * lc->TilesX + tx;
+         GLubyte *tag = lc->Values + t * size;
+         GLint x, y, width, height;
+
+         tile_rect(lc, tx, ty, &x, &y, &width, &height);
+
+         if (x >= x0 && x + width <= x1 && y >= y0 && y + height <= y1) {
+            /* the whole tile is cleared */
+            if (lc->Tagged[t]) {
+               for (k = 0; k < size; k++)
+                  tag[k] = (tag[k] & ~wmask[k]) | (val[k] & wmask[k]);
+               continue;
+            }
+            else if (fullMask) {
+               MEMCPY(tag, val, size);
+               lc->Tagged[t] = 1;
+               lc->NumTagged++;
+               continue;
+            }
+         }
+         else {
+            /* only part of the tile is cleared */
+            if (lc->Tagged[t])
+               materialize_tile(ctx, rb, lc, tx, ty);
+            width = MIN2(x + width, x1) - MAX2(x, x0);
+            height = MIN2(y + height, y1) - MAX2(y, y0);
+            x = MAX2(x, x0);
+            y = MAX2(y, y0);
+         }
+
+         fill_rect(ctx, rb, size, x, y, width, height, val,
+                   fullMask ? NULL : wmask);
+      }
+   }
+
+   return GL_TRUE;
+}
+
+
+/**
+ * Materialize the tagged tiles of renderbuffer rb (or of the buffer it
+ * wraps) which intersect the given rectangle.
+ */
+void
+_swrast_resolve_lazy_clear( GLcontext *ctx, struct gl_renderbuffer *rb,
+                            GLint x, GLint y, GLint width, GLint height )
+{
+   struct swrast_lazy_clear *lc;
+   GLint tx, ty, x1, y1;
+
+   if (!_swrast_lazy_clear_pending(rb))
+      return;
+
+   rb = rb->Wrapped;
+   lc = (struct swrast_lazy_clear *) rb->LazyClear;
+   if (lc->Width != rb->Width || lc->Height != rb->Height) {
+      /* resized, the contents are undefined now */
+      lc->NumTagged = 0;
+      _mesa_bzero(lc->Tagged, lc->TilesX * lc->TilesY);
+      return;
+   }
+
+   x1 = MIN2(x + width, (GLint) rb->Width);
+   y1 = MIN2(y + height, (GLint) rb->Height);
+   x = MAX2(x, 0);
+   y = MAX2(y, 0);
+   if (x >= x1 || y >= y1)
+      return;
+
+   for (ty = y >> LAZY_CLEAR_TILE_SHIFT;
+        ty <= (y1 - 1) >> LAZY_CLEAR_TILE_SHIFT; ty++) {
+      const GLubyte *tagged = lc->Tagged + ty * lc->TilesX;
+      for (tx = x >> LAZY_CLEAR_TILE_SHIFT;
+           tx <= (x1 - 1) >> LAZY_CLEAR_TILE_SHIFT; tx++) {
+         if (tagged[tx]) {
+            materialize_tile(ctx, rb, lc, tx, ty);
+            if (lc->NumTagged == 0)
+               return;
+         }
+      }
+   }
+}
+
+
+/**
+ * Materialize the tagged tiles of the color draw buffers and of the
+ * depth and stencil buffers which intersect the given rectangle.
+ */
+void
+_swrast_resolve_lazy_clear_draw( GLcontext *ctx, GLint x, GLint y,
+                                 GLint width, GLint height )
+{
+   struct gl_framebuffer *fb = ctx->DrawBuffer;
+   GLuint i;
+
+   for (i = 0; i < fb->_NumColorDrawBuffers[0]; i++) {
+      _swrast_resolve_lazy_clear(ctx, fb->_ColorDrawBuffers[0][i],
+                                 x, y, width, height);
+   }
+   _swrast_resolve_lazy_clear(ctx, fb->Attachment[BUFFER_DEPTH].Renderbuffer,
+                              x, y, width, height);
+   _swrast_resolve_lazy_clear(ctx, fb->Attachment[BUFFER_STENCIL].Renderbuffer,
+                              x, y, width, height);
+}
+
+
+/**
+ * Like _swrast_resolve_lazy_clear_draw(), for the area covered by a
+ * width x height image drawn at (x, y) with the current pixel zoom.
+ */
+void
+_swrast_resolve_lazy_clear_zoomed( GLcontext *ctx, GLint x, GLint y,
+                                   GLint width, GLint height )
+{
+   const GLfloat xEnd = x + width * ctx->Pixel.ZoomX;
+   const GLfloat yEnd = y + height * ctx->Pixel.ZoomY;
+   const GLint x0 = IFLOOR(MIN2((GLfloat) x, xEnd)) - 1;
+   const GLint x1 = IFLOOR(MAX2((GLfloat) x, xEnd)) + 2;
+   const GLint y0 = IFLOOR(MIN2((GLfloat) y, yEnd)) - 1;
+   const GLint y1 = IFLOOR(MAX2((GLfloat) y, yEnd)) + 2;
+
+   _swrast_resolve_lazy_clear_draw(ctx, x0, y0, x1 - x0, y1 - y0);
+}
+
+
+/**
+ * Materialize the tiles of the draw buffers that a span may touch.
+ */
+void
+_swrast_resolve_lazy_clear_span( GLcontext *ctx, const struct sw_span *span )
+{
+   if (span->end == 0)
+      return;
+
+   if (span->arrayMask & SPAN_XY) {
+      const GLint *x = span->array->x, *y = span->array->y;
+      GLint xMin = x[0], xMax = x[0], yMin = y[0], yMax = y[0];
+      GLuint i;
+      for (i = 1; i < span->end; i++) {
+         xMin = MIN2(xMin, x[i]);
+         xMax = MAX2(xMax, x[i]);
+         yMin = MIN2(yMin, y[i]);
+         yMax = MAX2(yMax, y[i]);
+      }
+      _swrast_resolve_lazy_clear_draw(ctx, xMin, yMin,
+                                      xMax - xMin + 1, yMax - yMin + 1);
+   }
+   else {
+      _swrast_resolve_lazy_clear_draw(ctx, span->x, span->y, span->end, 1);
+   }
+}
+
+
+/**
+ * Materialize the tiles of the draw buffers under the window area
+ * [xMin, xMax] x [yMin, yMax].
+ */
+static void
+resolve_lazy_clear_bounds( GLcontext *ctx, GLfloat xMin, GLfloat xMax,
+                           GLfloat yMin, GLfloat yMax )
+{
+   const GLfloat width = (GLfloat) ctx->DrawBuffer->Width;
+   const GLfloat height = (GLfloat) ctx->DrawBuffer->Height;
+   GLint x0, x1, y0, y1;
+
+   /* keep the conversions below in range */
+   xMin = CLAMP(xMin, -1.0F, width);
+   xMax = CLAMP(xMax, -1.0F, width);
+   yMin = CLAMP(yMin, -1.0F, height);
+   yMax = CLAMP(yMax, -1.0F, height);
+
+   /* a pixel to spare for sub-pixel snapping and antialiasing */
+   x0 = IFLOOR(xMin) - 1;
+   x1 = IFLOOR(xMax) + 2;
+   y0 = IFLOOR(yMin) - 1;
+   y1 = IFLOOR(yMax) + 2;
+
+   _swrast_resolve_lazy_clear_draw(ctx, x0, y0, x1 - x0, y1 - y0);
+}
+
+
+/**
+ * Materialize the tiles of the draw buffers under a point, line or
+ * triangle.  radius is half the point size or line width; lines and
+ * points pass their first vertex more than once.
+ */
+void
+_swrast_resolve_lazy_clear_prim( GLcontext *ctx, const SWvertex *v0,
+                                 const SWvertex *v1, const SWvertex *v2,
+                                 GLfloat radius )
+{
+   resolve_lazy_clear_bounds(ctx,
+      MIN2(v0->win[0], MIN2(v1->win[0], v2->win[0])) - radius,
+      MAX2(v0->win[0], MAX2(v1->win[0], v2->win[0])) + radius,
+      MIN2(v0->win[1], MIN2(v1->win[1], v2->win[1])) - radius,
+      MAX2(v0->win[1], MAX2(v1->win[1], v2->win[1])) + radius);
+}
+
+
+/**
+ * Materialize the tiles of the draw buffers under the points passed to
+ * _swrast_Points(), all at once.
+ */
+void
+_swrast_resolve_lazy_clear_points( GLcontext *ctx, const SWvertex *verts,
+                                   const GLuint *elts, GLuint count )
+{
+   GLfloat xMin = 1.0e30F, xMax = -1.0e30F, yMin = 1.0e30F, yMax = -1.0e30F;
+   GLuint i;
+
+   for (i = 0; i < count; i++) {
+      const SWvertex *v = elts ? verts + elts[i] : verts + i;
+      const GLfloat radius = MAX2(ctx->Point._Size, v->pointSize) * 0.5F;
+      if (IS_INF_OR_NAN(v->win[0] + v->win[1]))
+         continue;  /* culled by the point functions */
+      xMin = MIN2(xMin, v->win[0] - radius);
+      xMax = MAX2(xMax, v->win[0] + radius);
+      yMin = MIN2(yMin, v->win[1] - radius);
+      yMax = MAX2(yMax, v->win[1] + radius);
+   }
+
+   if (xMin <= xMax)
+      resolve_lazy_clear_bounds(ctx, xMin, xMax, yMin, yMax);
+}
+
+
+/**
+ * Materialize the tiles of the draw buffers under the lines passed to
+ * _swrast_Lines(), all at once.
+ */
+void
+_swrast_resolve_lazy_clear_lines( GLcontext *ctx, const SWvertex *verts,
+                                  const GLuint *elts, GLuint count )
+{
+   const GLfloat radius = ctx->Line._Width * 0.5F;
+   GLfloat xMin = 1.0e30F, xMax = -1.0e30F, yMin = 1.0e30F, yMax = -1.0e30F;
+   GLuint i;
+
+   for (i = 0; i < count; i++) {
+      const SWvertex *v = elts ? verts + elts[i] : verts + i;
+      if (IS_INF_OR_NAN(v->win[0] + v->win[1]))
+         continue;  /* culled by the line functions */
+      xMin = MIN2(xMin, v->win[0]);
+      xMax = MAX2(xMax, v->win[0]);
+      yMin = MIN2(yMin, v->win[1]);
+      yMax = MAX2(yMax, v->win[1]);
+   }
+
+   if (xMin <= xMax)
+      resolve_lazy_clear_bounds(ctx, xMin - radius, xMax + radius,
+                                yMin - radius, yMax + radius);
+}
@@ -0,0 +1,120 @@
+/*
+ * Mesa 3-D graphics library
+ * Version:  6.5
+ *
+ * Copyright (C) 1999-2006  Brian Paul   All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * BRIAN PAUL BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ * AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef S_LAZYCLEAR_H
+#define S_LAZYCLEAR_H
+
+
+#include "mtypes.h"
+#include "s_context.h"
+
+
+/**
+ * Deferred clear state of a renderbuffer, hung off rb->LazyClear.  The
+ * buffer is divided into 16x16 pixel tiles; a tagged tile is to be
+ * filled with its tag value the next time it's touched.
+ */
+struct swrast_lazy_clear {
+   GLuint Width, Height;    /**< size of the renderbuffer */
+   GLuint TilesX, TilesY;
+   GLuint PixelSize;        /**< bytes per pixel */
+   GLuint NumTagged;        /**< number of tagged tiles */
+   GLubyte *Tagged;         /**< [ty * TilesX + tx] */
+   GLubyte *Values;         /**< [(ty * TilesX + tx) * PixelSize] */
+};
+
+#define LAZY_CLEAR_TILE_SHIFT 4
+#define LAZY_CLEAR_TILE_SIZE  (1 << LAZY_CLEAR_TILE_SHIFT)
+
+
+/**
+ * Does renderbuffer rb (or the buffer it wraps) have tiles waiting to
+ * be cleared?
+ */
+static INLINE GLboolean
+_swrast_lazy_clear_pending( const struct gl_renderbuffer *rb )
+{
+   const struct swrast_lazy_clear *lc;
+
+   if (!rb)
+      return GL_FALSE;
+   lc = (const struct swrast_lazy_clear *) rb->Wrapped->LazyClear;
+   return lc && lc->NumTagged > 0;
+}
+
+
+/**
+ * Does any buffer that rendering may touch (the color draw buffers, the
+ * depth and the stencil buffer) have tiles waiting to be cleared?
+ */
+static INLINE GLboolean
+_swrast_lazy_clear_draw_pending( GLcontext *ctx )
+{
+   const struct gl_framebuffer *fb = ctx->DrawBuffer;
+   GLuint i;
+
+   for (i = 0; i < fb->_NumColorDrawBuffers[0]; i++) {
+      if (_swrast_lazy_clear_pending(fb->_ColorDrawBuffers[0][i]))
+         return GL_TRUE;
+   }
+   return _swrast_lazy_clear_pending(fb->Attachment[BUFFER_DEPTH].Renderbuffer)
+      || _swrast_lazy_clear_pending(fb->Attachment[BUFFER_STENCIL].Renderbuffer);
+}
+
+
+extern GLboolean
+_swrast_lazy_clear( GLcontext *ctx, struct gl_renderbuffer *rb,
+                    const void *value, const void *writemask );
+
+extern void
+_swrast_resolve_lazy_clear( GLcontext *ctx, struct gl_renderbuffer *rb,
+                            GLint x, GLint y, GLint width, GLint height );
+
+extern void
+_swrast_resolve_lazy_clear_draw( GLcontext *ctx, GLint x, GLint y,
+                                 GLint width, GLint height );
+
+extern void
+_swrast_resolve_lazy_clear_zoomed( GLcontext *ctx, GLint x, GLint y,
+                                   GLint width, GLint height );
+
+extern void
+_swrast_resolve_lazy_clear_span( GLcontext *ctx, const struct sw_span *span );
+
+extern void
+_swrast_resolve_lazy_clear_prim( GLcontext *ctx, const SWvertex *v0,
+                                 const SWvertex *v1, const SWvertex *v2,
+                                 GLfloat radius );
+
+extern void
+_swrast_resolve_lazy_clear_points( GLcontext *ctx, const SWvertex *verts,
+                                   const GLuint *elts, GLuint count );
+
+extern void
+_swrast_resolve_lazy_clear_lines( GLcontext *ctx, const SWvertex *verts,
+                                  const GLuint *elts, GLuint count );
+
+
+#endif
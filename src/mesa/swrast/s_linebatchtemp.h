@@ -0,0 +1,318 @@
+/*
+ * Mesa 3-D graphics library
+ * Version:  6.5
+ *
+ * Copyright (C) 1999-2006  Brian Paul   All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * BRIAN PAUL BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ * AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/*
+ * Batched Line Rasterizer Template
+ *
+ * This file is #include'd to generate swrast->Lines functions which draw
+ * a whole GL_LINES or GL_LINE_STRIP primitive straight into the color
+ * buffer (and depth buffer), for RGBA lines without blending, fog,
+ * texturing or other per-fragment operations besides the depth test.
+ * The buffers must be directly addressable with GetPointer(); if they're
+ * not, the lines are drawn one at a time with swrast->Line.
+ *
+ * Each line is walked as a series of runs of pixels along its major axis
+ * which share the same minor coordinate.  The length of each run follows
+ * from the Bresenham error term without stepping it per pixel, so the
+ * pixels are exactly those of s_linetemp.h.  Runs are clipped as a whole
+ * and wide lines replicate each run across the minor axis, as
+ * draw_wide_line() does.  Stippled lines use compute_stipple_mask().
+ *
+ * The following macros may be defined:
+ *    NAME        - name of the function to generate
+ *    DEPTH_TYPE  - GLushort for 16-bit fixed point depth buffers, or
+ *                  GLuint for deeper ones, to depth test the lines with
+ *                  GL_LESS or GL_LEQUAL
+ */
+
+
+static void
+NAME( GLcontext *ctx, const SWvertex *verts, const GLuint *elts,
+      GLuint count, GLenum mode )
+{
+   SWcontext *swrast = SWRAST_CONTEXT(ctx);
+   struct gl_framebuffer *fb = ctx->DrawBuffer;
+   struct gl_renderbuffer *rb = fb->_ColorDrawBuffers[0][0];
+   const GLboolean smooth = (ctx->Light.ShadeModel == GL_SMOOTH);
+   const GLboolean stipple = ctx->Line.StippleFlag;
+   const GLuint vertStep = (mode == GL_LINES) ? 2 : 1;
+   const GLint width = (GLint) CLAMP(ctx->Line._Width,
+                                     MIN_LINE_WIDTH, MAX_LINE_WIDTH);
+   const GLint wideStart = (width & 1) ? width / 2 : width / 2 - 1;
+   GLubyte stippleMask[MAX_WIDTH];
+   GLchan *cBase;
+   GLint cStride;
+#ifdef DEPTH_TYPE
+   struct gl_renderbuffer *zrb = fb->Attachment[BUFFER_DEPTH].Renderbuffer;
+   const GLboolean lequal = (ctx->Depth.Func == GL_LEQUAL);
+   const GLboolean zWrite = ctx->Depth.Mask;
+   const GLboolean hiz = zWrite && swrast->HiZ != NULL;
+   DEPTH_TYPE *zBase;
+   GLint zStride;
+#endif
+   GLuint i;
+
+   if (swrast->_NumSamples
+       || rb->_BaseFormat != GL_RGBA || rb->DataType != CHAN_TYPE
+#ifdef DEPTH_TYPE
+       || !zrb || _swrast_get_packed_depth_stencil(ctx, zrb)
+       || zrb->DataType != (sizeof(DEPTH_TYPE) == 2 ? GL_UNSIGNED_SHORT
+                                                     : GL_UNSIGNED_INT)
+       || !zrb->GetPointer(ctx, zrb, 0, 0)
+#endif
+       || !rb->GetPointer(ctx, rb, 0, 0)) {
+      _swrast_loop_lines(ctx, verts, elts, count, mode);
+      return;
+   }
+
+   /* Address pixel (x,y) as base + y * stride + x * 4 (or + x for Z) */
+   cBase = (GLchan *) rb->GetPointer(ctx, rb, 0, 0);
+   cStride = (rb->Height > 1)
+      ? (GLint) ((GLchan *) rb->GetPointer(ctx, rb, 0, 1) - cBase) : 0;
+#ifdef DEPTH_TYPE
+   zBase = (DEPTH_TYPE *) zrb->GetPointer(ctx, zrb, 0, 0);
+   zStride = (zrb->Height > 1)
+      ? (GLint) ((DEPTH_TYPE *) zrb->GetPointer(ctx, zrb, 0, 1) - zBase) : 0;
+#endif
+
+   for (i = 0; i + 1 < count; i += vertStep) {
+      const SWvertex *vert0 = elts ? verts + elts[i] : verts + i;
+      const SWvertex *vert1 = elts ? verts + elts[i + 1] : verts + i + 1;
+      GLint x0 = (GLint) vert0->win[0];
+      GLint y0 = (GLint) vert0->win[1];
+      GLint dx = (GLint) vert1->win[0] - x0;
+      GLint dy = (GLint) vert1->win[1] - y0;
+      GLint xstep = 1, ystep = 1;
+      GLint numPixels, n;
+      /* a is the major and b the minor coordinate */
+      GLint a, b, aLen, bLen, aStep, bStep, aMin, aMax, bMin, bMax;
+      GLint cA, cB, error, errorInc, errorDec;
+      GLboolean xMajor;
+      GLfixed r, g, bl, al;
+      GLint dr, dg, db, da;
+      GLchan color[4];
+#ifdef DEPTH_TYPE
+      GLint z, zStep, zA, zB;
+#endif
+
+      if (stipple && mode == GL_LINES)
+         swrast->StippleCounter = 0;
+
+      /* Cull primitives with malformed coordinates. */
+      {
+         GLfloat tmp = vert0->win[0] + vert0->win[1]
+                     + vert1->win[0] + vert1->win[1];
+         if (IS_INF_OR_NAN(tmp))
+            continue;
+      }
+
+      if (dx == 0 && dy == 0)
+         continue;
+      if (dx < 0) {
+         dx = -dx;
+         xstep = -1;
+      }
+      if (dy < 0) {
+         dy = -dy;
+         ystep = -1;
+      }
+      numPixels = MAX2(dx, dy);
+      xMajor = (dx > dy);
+
+      if (numPixels > MAX_WIDTH) {
+         swrast->Line(ctx, vert0, vert1);
+         continue;
+      }
+
+      if (stipple)
+         compute_stipple_mask(ctx, numPixels, stippleMask);
+
+      /* The flat shaded color, or overwritten per pixel.  The steps
+       * only matter past the first pixel and the edges of a finely
+       * tessellated mesh are often just one pixel long.
+       */
+      COPY_CHAN4(color, vert1->color);
+      r = g = bl = al = 0;
+      dr = dg = db = da = 0;
+      if (smooth) {
+         r  = ChanToFixed(vert0->color[RCOMP]);
+         g  = ChanToFixed(vert0->color[GCOMP]);
+         bl = ChanToFixed(vert0->color[BCOMP]);
+         al = ChanToFixed(vert0->color[ACOMP]);
+         if (numPixels > 1) {
+            dr = (ChanToFixed(vert1->color[RCOMP]) - r ) / numPixels;
+            dg = (ChanToFixed(vert1->color[GCOMP]) - g ) / numPixels;
+            db = (ChanToFixed(vert1->color[BCOMP]) - bl) / numPixels;
+            da = (ChanToFixed(vert1->color[ACOMP]) - al) / numPixels;
+         }
+      }
+
+#ifdef DEPTH_TYPE
+      zStep = 0;
+      if (sizeof(DEPTH_TYPE) == 2) {
+         z = FloatToFixed(vert0->win[2]) + FIXED_HALF;
+         if (numPixels > 1)
+            zStep = FloatToFixed(vert1->win[2] - vert0->win[2]) / numPixels;
+      }
+      else {
+         /* don't use fixed point */
+         z = (GLint) vert0->win[2];
+         if (numPixels > 1)
+            zStep = (GLint) ((vert1->win[2] - vert0->win[2]) / numPixels);
+      }
+#endif
+
+      if (xMajor) {
+         /* X-major: runs go along rows */
+         a = x0;  aLen = dx;  aStep = xstep;
+         b = y0;  bLen = dy;  bStep = ystep;
+         aMin = fb->_Xmin;  aMax = fb->_Xmax;
+         bMin = fb->_Ymin;  bMax = fb->_Ymax;
+         cA = 4;
+         cB = cStride;
+#ifdef DEPTH_TYPE
+         zA = 1;
+         zB = zStride;
+#endif
+      }
+      else {
+         /* Y-major: runs go along columns */
+         a = y0;  aLen = dy;  aStep = ystep;
+         b = x0;  bLen = dx;  bStep = xstep;
+         aMin = fb->_Ymin;  aMax = fb->_Ymax;
+         bMin = fb->_Xmin;  bMax = fb->_Xmax;
+         cA = cStride;
+         cB = 4;
+#ifdef DEPTH_TYPE
+         zA = zStride;
+         zB = 1;
+#endif
+      }
+
+      errorInc = bLen + bLen;
+      error = errorInc - aLen;
+      errorDec = error - aLen;
+
+      for (n = 0; n < numPixels; ) {
+         GLint len, j0, j1, w;
+
+         /* The run ends with the first pixel at which the error term is
+          * not negative; it grows by errorInc per pixel until then.
+          */
+         if (error >= 0)
+            len = 1;
+         else if (error + errorInc >= 0)
+            len = 2;
+         else if (errorInc == 0)
+            len = numPixels - n;
+         else
+            len = (errorInc - 1 - error) / errorInc + 1;
+         if (len > numPixels - n)
+            len = numPixels - n;
+
+         /* clip the run along the major axis */
+         if (aStep > 0) {
+            j0 = MAX2(0, aMin - a);
+            j1 = MIN2(len, aMax - a);
+         }
+         else {
+            j0 = MAX2(0, a - aMax + 1);
+            j1 = MIN2(len, a - aMin + 1);
+         }
+
+         for (w = 0; w < width && j0 < j1; w++) {
+            const GLint bw = b - wideStart + w;
+            const GLint aj = a + j0 * aStep;
+            GLchan *cPtr;
+#ifdef DEPTH_TYPE
+            DEPTH_TYPE *zPtr;
+            GLboolean written = GL_FALSE;
+#endif
+            GLint j;
+
+            if (bw < bMin || bw >= bMax)
+               continue;
+
+            cPtr = cBase + aj * cA + bw * cB;
+#ifdef DEPTH_TYPE
+            zPtr = zBase + aj * zA + bw * zB;
+#endif
+            for (j = j0; j < j1; j++) {
+               const GLint k = n + j;
+               if (!stipple || stippleMask[k]) {
+#ifdef DEPTH_TYPE
+                  const GLuint Z = (sizeof(DEPTH_TYPE) == 2)
+                     ? (GLuint) FixedToInt(z + k * zStep)
+                     : (GLuint) (z + k * zStep);
+                  if (lequal ? Z <= (GLuint) *zPtr : Z < (GLuint) *zPtr) {
+                     if (zWrite) {
+                        *zPtr = (DEPTH_TYPE) Z;
+                        written = GL_TRUE;
+                     }
+#endif
+                     if (smooth) {
+                        color[RCOMP] = FixedToChan(r  + k * dr);
+                        color[GCOMP] = FixedToChan(g  + k * dg);
+                        color[BCOMP] = FixedToChan(bl + k * db);
+                        color[ACOMP] = FixedToChan(al + k * da);
+                     }
+                     COPY_CHAN4(cPtr, color);
+#ifdef DEPTH_TYPE
+                  }
+#endif
+               }
+               cPtr += aStep * cA;
+#ifdef DEPTH_TYPE
+               zPtr += aStep * zA;
+#endif
+            }
+
+#ifdef DEPTH_TYPE
+            if (hiz && written) {
+               if (xMajor) {
+                  /* one row */
+                  const GLint first = (aStep > 0) ? aj : a + (j1 - 1) * aStep;
+                  _swrast_hiz_update_span(ctx, zrb, first, bw, j1 - j0);
+               }
+               else {
+                  /* one column */
+                  for (j = j0; j < j1; j++)
+                     _swrast_hiz_update_span(ctx, zrb, bw, a + j * aStep, 1);
+               }
+            }
+#endif
+         }
+
+         error += (len - 1) * errorInc + errorDec;
+         a += len * aStep;
+         b += bStep;
+         n += len;
+      }
+   }
+}
+
+
+#undef NAME
+#undef DEPTH_TYPE
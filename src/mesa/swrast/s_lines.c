@@ -32,6 +32,7 @@
 #include "s_context.h"
 #include "s_depth.h"
 #include "s_feedback.h"
+#include "s_hiz.h"
 #include "s_lines.h"
 #include "s_span.h"
 
@@ -214,6 +215,49 @@ draw_wide_line( GLcontext *ctx, struct sw_span *span, GLboolean xMajor )
 
 
 
+#if CHAN_TYPE != GL_FLOAT
+
+/* Batched RGBA lines, no Z */
+#define NAME rgba_lines
+#include "s_linebatchtemp.h"
+
+/* Batched RGBA lines, 16-bit Z less/lequal */
+#define NAME rgba_z16_lines
+#define DEPTH_TYPE GLushort
+#include "s_linebatchtemp.h"
+
+/* Batched RGBA lines, 32-bit Z less/lequal */
+#define NAME rgba_z32_lines
+#define DEPTH_TYPE GLuint
+#include "s_linebatchtemp.h"
+
+#endif /* CHAN_TYPE != GL_FLOAT */
+
+
+/**
+ * Draw the lines of a GL_LINES or GL_LINE_STRIP primitive one at a time
+ * with swrast->Line, for the cases without a batched line function.
+ */
+void
+_swrast_loop_lines( GLcontext *ctx, const SWvertex *verts,
+                    const GLuint *elts, GLuint count, GLenum mode )
+{
+   SWcontext *swrast = SWRAST_CONTEXT(ctx);
+   const GLuint step = (mode == GL_LINES) ? 2 : 1;
+   const GLboolean resetStipple = ctx->Line.StippleFlag && mode == GL_LINES;
+   GLuint i;
+
+   for (i = 0; i + 1 < count; i += step) {
+      if (resetStipple)
+         swrast->StippleCounter = 0;
+      if (elts)
+         swrast->Line( ctx, &verts[elts[i]], &verts[elts[i + 1]] );
+      else
+         swrast->Line( ctx, &verts[i], &verts[i + 1] );
+   }
+}
+
+
 void
 _swrast_add_spec_terms_line( GLcontext *ctx,
                              const SWvertex *v0,
@@ -336,3 +380,37 @@ _swrast_choose_line( GLcontext *ctx )
 
    /*_mesa_print_line_function(ctx);*/
 }
+
+
+/*
+ * Choose swrast->Lines, which draws whole GL_LINES and GL_LINE_STRIP
+ * primitives.  Plain RGBA lines, wide and/or stippled, optionally
+ * depth tested, are drawn straight into the frame buffer; everything
+ * else goes through swrast->Line.
+ */
+void
+_swrast_choose_lines( GLcontext *ctx )
+{
+   SWcontext *swrast = SWRAST_CONTEXT(ctx);
+
+   swrast->Lines = _swrast_loop_lines;
+
+#if CHAN_TYPE != GL_FLOAT
+   if (ctx->RenderMode == GL_RENDER
+       && ctx->Visual.rgbMode
+       && !ctx->Line.SmoothFlag
+       && !NEED_SECONDARY_COLOR(ctx)
+       && (swrast->_RasterMask & ~(DEPTH_BIT | CLIP_BIT)) == 0) {
+      if (!ctx->Depth.Test) {
+         swrast->Lines = rgba_lines;
+      }
+      else if ((ctx->Depth.Func == GL_LESS || ctx->Depth.Func == GL_LEQUAL)
+               && !ctx->Depth.BoundsTest) {
+         if (ctx->Visual.depthBits <= 16)
+            swrast->Lines = rgba_z16_lines;
+         else
+            swrast->Lines = rgba_z32_lines;
+      }
+   }
+#endif
+}
@@ -32,6 +32,13 @@
 void
 _swrast_choose_line( GLcontext *ctx );
 
+void
+_swrast_choose_lines( GLcontext *ctx );
+
+void
+_swrast_loop_lines( GLcontext *ctx, const SWvertex *verts,
+                    const GLuint *elts, GLuint count, GLenum mode );
+
 void
 _swrast_add_spec_terms_line( GLcontext *ctx,
 			     const SWvertex *v0,
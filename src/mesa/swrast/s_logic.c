@@ -212,18 +212,24 @@ void
 _swrast_logicop_rgba_span(GLcontext *ctx, struct gl_renderbuffer *rb,
                           const struct sw_span *span, GLchan rgba[][4])
 {
-   GLchan dest[MAX_WIDTH][4];
+   GLchan destBuf[MAX_WIDTH][4];
+   const GLchan (*dest)[4];
 
    ASSERT(span->end < MAX_WIDTH);
    ASSERT(span->arrayMask & SPAN_RGBA);
    ASSERT(rb->DataType == GL_UNSIGNED_BYTE);
 
-   if (span->arrayMask & SPAN_XY) {
-      _swrast_get_values(ctx, rb, span->end, span->array->x, span->array->y,
-                         dest, 4 * sizeof(GLchan));
-   }
-   else {
-      _swrast_read_rgba_span(ctx, rb, span->end, span->x, span->y, dest);
+   dest = (const GLchan (*)[4]) _swrast_get_rgba_span_pointer(ctx, rb, span);
+   if (!dest) {
+      if (span->arrayMask & SPAN_XY) {
+         _swrast_get_values(ctx, rb, span->end, span->array->x,
+                            span->array->y, destBuf, 4 * sizeof(GLchan));
+      }
+      else {
+         _swrast_read_rgba_span(ctx, rb, span->end, span->x, span->y,
+                                destBuf);
+      }
+      dest = (const GLchan (*)[4]) destBuf;
    }
 
    /* XXX make this a runtime test */
@@ -42,12 +42,13 @@ void
 _swrast_mask_rgba_span(GLcontext *ctx, struct gl_renderbuffer *rb,
                        const struct sw_span *span, GLchan rgba[][4])
 {
-   GLchan dest[MAX_WIDTH][4];
+   GLchan destBuf[MAX_WIDTH][4];
+   const GLchan (*dest)[4];
 #if CHAN_BITS == 8
    GLuint srcMask = *((GLuint*)ctx->Color.ColorMask);
    GLuint dstMask = ~srcMask;
    GLuint *rgba32 = (GLuint *) rgba;
-   GLuint *dest32 = (GLuint *) dest;
+   const GLuint *dest32;
 #else
    const GLboolean rMask = ctx->Color.ColorMask[RCOMP];
    const GLboolean gMask = ctx->Color.ColorMask[GCOMP];
@@ -60,15 +61,20 @@ _swrast_mask_rgba_span(GLcontext *ctx, struct gl_renderbuffer *rb,
    ASSERT(n < MAX_WIDTH);
    ASSERT(span->arrayMask & SPAN_RGBA);
 
-   if (span->arrayMask & SPAN_XY) {
-      _swrast_get_values(ctx, rb, n, span->array->x, span->array->y,
-                         dest, 4 * sizeof(GLchan));
-   }
-   else {
-      _swrast_read_rgba_span(ctx, rb, n, span->x, span->y, dest);
+   dest = (const GLchan (*)[4]) _swrast_get_rgba_span_pointer(ctx, rb, span);
+   if (!dest) {
+      if (span->arrayMask & SPAN_XY) {
+         _swrast_get_values(ctx, rb, n, span->array->x, span->array->y,
+                            destBuf, 4 * sizeof(GLchan));
+      }
+      else {
+         _swrast_read_rgba_span(ctx, rb, n, span->x, span->y, destBuf);
+      }
+      dest = (const GLchan (*)[4]) destBuf;
    }
 
 #if CHAN_BITS == 8
+   dest32 = (const GLuint *) dest;
    for (i = 0; i < n; i++) {
       rgba32[i] = (rgba32[i] & srcMask) | (dest32[i] & dstMask);
    }
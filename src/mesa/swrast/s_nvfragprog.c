@@ -1444,6 +1444,912 @@ init_machine( GLcontext *ctx, struct fp_machine *machine,
 
 
 
+/*
+ * Span interpreter.
+ *
+ * Rather than running the whole program for one fragment at a time,
+ * execute each instruction for a run of up to FP_SPAN_CHUNK fragments.
+ * The registers are kept in structure-of-arrays form (one array per
+ * component) so the instruction decoding and register lookups happen
+ * once per run and the per-fragment loops are simple enough for the
+ * compiler to vectorize.  Programs which use condition codes,
+ * derivatives or PRINT still go through execute_program().
+ */
+
+/** Number of fragments processed per pass of the span interpreter */
+#define FP_SPAN_CHUNK 64
+
+struct fp_span_machine
+{
+   GLfloat Temporaries[MAX_NV_FRAGMENT_PROGRAM_TEMPS][4][FP_SPAN_CHUNK];
+   GLfloat Inputs[MAX_NV_FRAGMENT_PROGRAM_INPUTS][4][FP_SPAN_CHUNK];
+   GLfloat Outputs[MAX_NV_FRAGMENT_PROGRAM_OUTPUTS][4][FP_SPAN_CHUNK];
+   GLfloat Src[3][4][FP_SPAN_CHUNK];    /**< swizzled/negated operands */
+   GLfloat Result[4][FP_SPAN_CHUNK];
+   GLfloat TexCoords[FP_SPAN_CHUNK][4];
+   GLfloat Lambda[FP_SPAN_CHUNK];
+   GLchan Texels[FP_SPAN_CHUNK][4];
+   GLboolean Killed[FP_SPAN_CHUNK];
+};
+
+
+/**
+ * Check if the span interpreter can run the given program.
+ * \param numTemps  returns number of temporary registers used
+ */
+static GLboolean
+span_program_supported( const struct fragment_program *program,
+                        GLuint *numTemps )
+{
+   GLuint pc, temps = 0;
+
+   for (pc = 0; pc < program->Base.NumInstructions; pc++) {
+      const struct fp_instruction *inst = program->Instructions + pc;
+      GLuint i;
+
+      switch (inst->Opcode) {
+      case FP_OPCODE_DDX:
+      case FP_OPCODE_DDY:
+      case FP_OPCODE_KIL_NV:
+      case FP_OPCODE_PRINT:
+         return GL_FALSE;
+      case FP_OPCODE_END:
+         *numTemps = temps;
+         return GL_TRUE;
+      default:
+         ;
+      }
+
+      /* ARB programs may leave CondMask zero, meaning "always" */
+      if (inst->UpdateCondRegister ||
+          (inst->DstReg.CondMask >= COND_GT &&
+           inst->DstReg.CondMask != COND_TR))
+         return GL_FALSE;
+
+      if (inst->DstReg.File == PROGRAM_TEMPORARY)
+         temps = MAX2(temps, (GLuint) inst->DstReg.Index + 1);
+      for (i = 0; i < 3; i++) {
+         if (inst->SrcReg[i].File == PROGRAM_TEMPORARY)
+            temps = MAX2(temps, (GLuint) inst->SrcReg[i].Index + 1);
+      }
+   }
+
+   return GL_FALSE;
+}
+
+
+/**
+ * Return the n values of one component of a source operand, with
+ * swizzling and negation applied.  Unmodified temporaries and inputs
+ * are returned in place, anything else is expanded into
+ * machine->Src[arg].
+ */
+static const GLfloat *
+fetch_span_component( GLcontext *ctx, struct fp_span_machine *machine,
+                      const struct fragment_program *program,
+                      const struct fp_instruction *inst, GLuint arg,
+                      GLuint comp, GLuint n )
+{
+   const struct fp_src_register *source = &inst->SrcReg[arg];
+   const GLuint swz = GET_SWZ(source->Swizzle, comp);
+   GLfloat *dst = machine->Src[arg][comp];
+   GLboolean negateBase, absolute, negateAbs;
+   GLuint i;
+
+   if (inst->Opcode == FP_OPCODE_SWZ) {
+      negateBase = (source->NegateBase >> comp) & 1;
+      absolute = negateAbs = GL_FALSE;
+   }
+   else {
+      negateBase = source->NegateBase != 0;
+      absolute = source->Abs;
+      negateAbs = source->NegateAbs;
+   }
+
+   if (swz == SWIZZLE_ZERO || swz == SWIZZLE_ONE ||
+       (source->File != PROGRAM_TEMPORARY && source->File != PROGRAM_INPUT)) {
+      /* same value for all fragments */
+      GLfloat value;
+      if (swz == SWIZZLE_ZERO)
+         value = 0.0F;
+      else if (swz == SWIZZLE_ONE)
+         value = 1.0F;
+      else
+         value = get_register_pointer(ctx, source, NULL, program)[swz];
+      if (negateBase)
+         value = -value;
+      if (absolute)
+         value = FABSF(value);
+      if (negateAbs)
+         value = -value;
+      for (i = 0; i < n; i++)
+         dst[i] = value;
+   }
+   else {
+      const GLfloat *src = (source->File == PROGRAM_TEMPORARY)
+         ? machine->Temporaries[source->Index][swz]
+         : machine->Inputs[source->Index][swz];
+
+      if (!negateBase && !absolute && !negateAbs)
+         return src;
+
+      if (negateBase) {
+         for (i = 0; i < n; i++)
+            dst[i] = -src[i];
+         src = dst;
+      }
+      if (absolute) {
+         for (i = 0; i < n; i++)
+            dst[i] = FABSF(src[i]);
+         src = dst;
+      }
+      if (negateAbs) {
+         for (i = 0; i < n; i++)
+            dst[i] = -src[i];
+      }
+   }
+
+   return dst;
+}
+
+
+/**
+ * Fetch all four components of a source operand.
+ */
+static void
+fetch_span_vector4( GLcontext *ctx, struct fp_span_machine *machine,
+                    const struct fragment_program *program,
+                    const struct fp_instruction *inst, GLuint arg,
+                    GLuint n, const GLfloat *result[4] )
+{
+   result[0] = fetch_span_component(ctx, machine, program, inst, arg, 0, n);
+   result[1] = fetch_span_component(ctx, machine, program, inst, arg, 1, n);
+   result[2] = fetch_span_component(ctx, machine, program, inst, arg, 2, n);
+   result[3] = fetch_span_component(ctx, machine, program, inst, arg, 3, n);
+}
+
+
+/**
+ * Copy machine->Result to the instruction's destination register,
+ * observing the write mask and saturation.
+ * \param scalar  if true, all components come from Result[0]
+ */
+static void
+store_span_vector4( const struct fp_instruction *inst,
+                    struct fp_span_machine *machine,
+                    GLboolean scalar, GLuint n )
+{
+   const struct fp_dst_register *dest = &(inst->DstReg);
+   GLfloat (*dstReg)[FP_SPAN_CHUNK];
+   GLuint c, i;
+
+   switch (dest->File) {
+      case PROGRAM_OUTPUT:
+         dstReg = machine->Outputs[dest->Index];
+         break;
+      case PROGRAM_TEMPORARY:
+         dstReg = machine->Temporaries[dest->Index];
+         break;
+      case PROGRAM_WRITE_ONLY:
+         return;
+      default:
+         _mesa_problem(NULL, "bad register file in store_span_vector4(fp)");
+         return;
+   }
+
+   for (c = 0; c < 4; c++) {
+      if (GET_BIT(dest->WriteMask, c)) {
+         const GLfloat *value = machine->Result[scalar ? 0 : c];
+         GLfloat *dst = dstReg[c];
+         if (inst->Saturate) {
+            for (i = 0; i < n; i++)
+               dst[i] = CLAMP(value[i], 0.0F, 1.0F);
+         }
+         else {
+            for (i = 0; i < n; i++)
+               dst[i] = value[i];
+         }
+      }
+   }
+}
+
+
+/**
+ * Sample the texture for the texcoords in machine->TexCoords and
+ * lambdas in machine->Lambda, putting the colors in machine->Result.
+ */
+static void
+fetch_span_texels( GLcontext *ctx, struct fp_span_machine *machine,
+                   GLuint unit, GLuint n )
+{
+   SWcontext *swrast = SWRAST_CONTEXT(ctx);
+   GLuint i;
+
+   swrast->TextureSample[unit](ctx, unit, ctx->Texture.Unit[unit]._Current,
+                               n, (const GLfloat (*)[4]) machine->TexCoords,
+                               machine->Lambda, machine->Texels);
+
+   for (i = 0; i < n; i++) {
+      machine->Result[0][i] = CHAN_TO_FLOAT(machine->Texels[i][RCOMP]);
+      machine->Result[1][i] = CHAN_TO_FLOAT(machine->Texels[i][GCOMP]);
+      machine->Result[2][i] = CHAN_TO_FLOAT(machine->Texels[i][BCOMP]);
+      machine->Result[3][i] = CHAN_TO_FLOAT(machine->Texels[i][ACOMP]);
+   }
+}
+
+
+/**
+ * Execute the program for fragments [start, start + n) of the span.
+ * Killed fragments are flagged in machine->Killed.
+ */
+static void
+execute_program_span( GLcontext *ctx,
+                      const struct fragment_program *program,
+                      struct fp_span_machine *machine,
+                      const struct sw_span *span, GLuint start, GLuint n )
+{
+   GLfloat (*result)[FP_SPAN_CHUNK] = machine->Result;
+   GLuint pc;
+
+   for (pc = 0; pc < program->Base.NumInstructions; pc++) {
+      const struct fp_instruction *inst = program->Instructions + pc;
+      const GLuint mask = inst->DstReg.WriteMask;
+      const GLfloat *a[4], *b[4], *c[4];
+      GLboolean scalar = GL_FALSE;
+      GLuint i, j;
+
+      switch (inst->Opcode) {
+         case FP_OPCODE_ABS:
+            for (j = 0; j < 4; j++) {
+               if (GET_BIT(mask, j)) {
+                  a[j] = fetch_span_component(ctx, machine, program, inst, 0, j, n);
+                  for (i = 0; i < n; i++)
+                     result[j][i] = FABSF(a[j][i]);
+               }
+            }
+            break;
+         case FP_OPCODE_ADD:
+            for (j = 0; j < 4; j++) {
+               if (GET_BIT(mask, j)) {
+                  a[j] = fetch_span_component(ctx, machine, program, inst, 0, j, n);
+                  b[j] = fetch_span_component(ctx, machine, program, inst, 1, j, n);
+                  for (i = 0; i < n; i++)
+                     result[j][i] = a[j][i] + b[j][i];
+               }
+            }
+            break;
+         case FP_OPCODE_CMP:
+            for (j = 0; j < 4; j++) {
+               if (GET_BIT(mask, j)) {
+                  a[j] = fetch_span_component(ctx, machine, program, inst, 0, j, n);
+                  b[j] = fetch_span_component(ctx, machine, program, inst, 1, j, n);
+                  c[j] = fetch_span_component(ctx, machine, program, inst, 2, j, n);
+                  for (i = 0; i < n; i++)
+                     result[j][i] = a[j][i] < 0.0F ? b[j][i] : c[j][i];
+               }
+            }
+            break;
+         case FP_OPCODE_COS:
+            a[0] = fetch_span_component(ctx, machine, program, inst, 0, 0, n);
+            for (i = 0; i < n; i++)
+               result[0][i] = (GLfloat)_mesa_cos(a[0][i]);
+            scalar = GL_TRUE;
+            break;
+         case FP_OPCODE_DP3:
+         case FP_OPCODE_DP4:
+         case FP_OPCODE_DPH:
+            fetch_span_vector4(ctx, machine, program, inst, 0, n, a);
+            fetch_span_vector4(ctx, machine, program, inst, 1, n, b);
+            if (inst->Opcode == FP_OPCODE_DP3) {
+               for (i = 0; i < n; i++)
+                  result[0][i] = a[0][i] * b[0][i] + a[1][i] * b[1][i]
+                               + a[2][i] * b[2][i];
+            }
+            else if (inst->Opcode == FP_OPCODE_DP4) {
+               for (i = 0; i < n; i++)
+                  result[0][i] = a[0][i] * b[0][i] + a[1][i] * b[1][i]
+                               + a[2][i] * b[2][i] + a[3][i] * b[3][i];
+            }
+            else {
+               for (i = 0; i < n; i++)
+                  result[0][i] = a[0][i] * b[0][i] + a[1][i] * b[1][i]
+                               + a[2][i] * b[2][i] + b[3][i];
+            }
+            scalar = GL_TRUE;
+            break;
+         case FP_OPCODE_DST: /* Distance vector */
+            fetch_span_vector4(ctx, machine, program, inst, 0, n, a);
+            fetch_span_vector4(ctx, machine, program, inst, 1, n, b);
+            for (i = 0; i < n; i++) {
+               result[0][i] = 1.0F;
+               result[1][i] = a[1][i] * b[1][i];
+               result[2][i] = a[2][i];
+               result[3][i] = b[3][i];
+            }
+            break;
+         case FP_OPCODE_EX2: /* Exponential base 2 */
+            a[0] = fetch_span_component(ctx, machine, program, inst, 0, 0, n);
+            for (i = 0; i < n; i++)
+               result[0][i] = (GLfloat) _mesa_pow(2.0, a[0][i]);
+            scalar = GL_TRUE;
+            break;
+         case FP_OPCODE_FLR:
+            for (j = 0; j < 4; j++) {
+               if (GET_BIT(mask, j)) {
+                  a[j] = fetch_span_component(ctx, machine, program, inst, 0, j, n);
+                  for (i = 0; i < n; i++)
+                     result[j][i] = FLOORF(a[j][i]);
+               }
+            }
+            break;
+         case FP_OPCODE_FRC:
+            for (j = 0; j < 4; j++) {
+               if (GET_BIT(mask, j)) {
+                  a[j] = fetch_span_component(ctx, machine, program, inst, 0, j, n);
+                  for (i = 0; i < n; i++)
+                     result[j][i] = a[j][i] - FLOORF(a[j][i]);
+               }
+            }
+            break;
+         case FP_OPCODE_KIL: /* ARB_f_p only */
+            fetch_span_vector4(ctx, machine, program, inst, 0, n, a);
+            for (i = 0; i < n; i++) {
+               if (a[0][i] < 0.0F || a[1][i] < 0.0F ||
+                   a[2][i] < 0.0F || a[3][i] < 0.0F)
+                  machine->Killed[i] = GL_TRUE;
+            }
+            break;
+         case FP_OPCODE_LG2:  /* log base 2 */
+            a[0] = fetch_span_component(ctx, machine, program, inst, 0, 0, n);
+            for (i = 0; i < n; i++)
+               result[0][i] = LOG2(a[0][i]);
+            scalar = GL_TRUE;
+            break;
+         case FP_OPCODE_LIT:
+            {
+               const GLfloat epsilon = 1.0F / 256.0F; /* from NV VP spec */
+               fetch_span_vector4(ctx, machine, program, inst, 0, n, a);
+               for (i = 0; i < n; i++) {
+                  const GLfloat a0 = MAX2(a[0][i], 0.0F);
+                  const GLfloat a1 = MAX2(a[1][i], 0.0F);
+                  const GLfloat a3 = CLAMP(a[3][i], -(128.0F - epsilon),
+                                           (128.0F - epsilon));
+                  result[0][i] = 1.0F;
+                  result[1][i] = a0;
+                  if (a0 > 0.0F) {
+                     if (a1 == 0.0 && a3 == 0.0)
+                        result[2][i] = 1.0;
+                     else
+                        result[2][i] = EXPF(a3 * LOGF(a1));
+                  }
+                  else {
+                     result[2][i] = 0.0;
+                  }
+                  result[3][i] = 1.0F;
+               }
+            }
+            break;
+         case FP_OPCODE_LRP:
+            for (j = 0; j < 4; j++) {
+               if (GET_BIT(mask, j)) {
+                  a[j] = fetch_span_component(ctx, machine, program, inst, 0, j, n);
+                  b[j] = fetch_span_component(ctx, machine, program, inst, 1, j, n);
+                  c[j] = fetch_span_component(ctx, machine, program, inst, 2, j, n);
+                  for (i = 0; i < n; i++)
+                     result[j][i] = a[j][i] * b[j][i]
+                                  + (1.0F - a[j][i]) * c[j][i];
+               }
+            }
+            break;
+         case FP_OPCODE_MAD:
+            for (j = 0; j < 4; j++) {
+               if (GET_BIT(mask, j)) {
+                  a[j] = fetch_span_component(ctx, machine, program, inst, 0, j, n);
+                  b[j] = fetch_span_component(ctx, machine, program, inst, 1, j, n);
+                  c[j] = fetch_span_component(ctx, machine, program, inst, 2, j, n);
+                  for (i = 0; i < n; i++)
+                     result[j][i] = a[j][i] * b[j][i] + c[j][i];
+               }
+            }
+            break;
+         case FP_OPCODE_MAX:
+            for (j = 0; j < 4; j++) {
+               if (GET_BIT(mask, j)) {
+                  a[j] = fetch_span_component(ctx, machine, program, inst, 0, j, n);
+                  b[j] = fetch_span_component(ctx, machine, program, inst, 1, j, n);
+                  for (i = 0; i < n; i++)
+                     result[j][i] = MAX2(a[j][i], b[j][i]);
+               }
+            }
+            break;
+         case FP_OPCODE_MIN:
+            for (j = 0; j < 4; j++) {
+               if (GET_BIT(mask, j)) {
+                  a[j] = fetch_span_component(ctx, machine, program, inst, 0, j, n);
+                  b[j] = fetch_span_component(ctx, machine, program, inst, 1, j, n);
+                  for (i = 0; i < n; i++)
+                     result[j][i] = MIN2(a[j][i], b[j][i]);
+               }
+            }
+            break;
+         case FP_OPCODE_MOV:
+         case FP_OPCODE_SWZ:
+            for (j = 0; j < 4; j++) {
+               if (GET_BIT(mask, j)) {
+                  a[j] = fetch_span_component(ctx, machine, program, inst, 0, j, n);
+                  for (i = 0; i < n; i++)
+                     result[j][i] = a[j][i];
+               }
+            }
+            break;
+         case FP_OPCODE_MUL:
+            for (j = 0; j < 4; j++) {
+               if (GET_BIT(mask, j)) {
+                  a[j] = fetch_span_component(ctx, machine, program, inst, 0, j, n);
+                  b[j] = fetch_span_component(ctx, machine, program, inst, 1, j, n);
+                  for (i = 0; i < n; i++)
+                     result[j][i] = a[j][i] * b[j][i];
+               }
+            }
+            break;
+         case FP_OPCODE_PK2H: /* pack two 16-bit floats in one 32-bit float */
+            {
+               GLuint *rawResult = (GLuint *) result[0];
+               fetch_span_vector4(ctx, machine, program, inst, 0, n, a);
+               for (i = 0; i < n; i++) {
+                  const GLhalfNV hx = _mesa_float_to_half(a[0][i]);
+                  const GLhalfNV hy = _mesa_float_to_half(a[1][i]);
+                  rawResult[i] = hx | (hy << 16);
+               }
+               scalar = GL_TRUE;
+            }
+            break;
+         case FP_OPCODE_PK2US: /* pack two GLushorts into one 32-bit float */
+            {
+               GLuint *rawResult = (GLuint *) result[0];
+               fetch_span_vector4(ctx, machine, program, inst, 0, n, a);
+               for (i = 0; i < n; i++) {
+                  const GLuint usx = IROUND(CLAMP(a[0][i], 0.0F, 1.0F) * 65535.0F);
+                  const GLuint usy = IROUND(CLAMP(a[1][i], 0.0F, 1.0F) * 65535.0F);
+                  rawResult[i] = usx | (usy << 16);
+               }
+               scalar = GL_TRUE;
+            }
+            break;
+         case FP_OPCODE_PK4B: /* pack four GLbytes into one 32-bit float */
+            {
+               GLuint *rawResult = (GLuint *) result[0];
+               fetch_span_vector4(ctx, machine, program, inst, 0, n, a);
+               for (i = 0; i < n; i++) {
+                  GLuint ub[4];
+                  for (j = 0; j < 4; j++) {
+                     const GLfloat v = CLAMP(a[j][i], -128.0F / 127.0F, 1.0F);
+                     ub[j] = IROUND(127.0F * v + 128.0F);
+                  }
+                  rawResult[i] = ub[0] | (ub[1] << 8) | (ub[2] << 16)
+                               | (ub[3] << 24);
+               }
+               scalar = GL_TRUE;
+            }
+            break;
+         case FP_OPCODE_PK4UB: /* pack four GLubytes into one 32-bit float */
+            {
+               GLuint *rawResult = (GLuint *) result[0];
+               fetch_span_vector4(ctx, machine, program, inst, 0, n, a);
+               for (i = 0; i < n; i++) {
+                  GLuint ub[4];
+                  for (j = 0; j < 4; j++) {
+                     const GLfloat v = CLAMP(a[j][i], 0.0F, 1.0F);
+                     ub[j] = IROUND(255.0F * v);
+                  }
+                  rawResult[i] = ub[0] | (ub[1] << 8) | (ub[2] << 16)
+                               | (ub[3] << 24);
+               }
+               scalar = GL_TRUE;
+            }
+            break;
+         case FP_OPCODE_POW:
+            a[0] = fetch_span_component(ctx, machine, program, inst, 0, 0, n);
+            b[0] = fetch_span_component(ctx, machine, program, inst, 1, 0, n);
+            for (i = 0; i < n; i++)
+               result[0][i] = (GLfloat)_mesa_pow(a[0][i], b[0][i]);
+            scalar = GL_TRUE;
+            break;
+         case FP_OPCODE_RCP:
+            a[0] = fetch_span_component(ctx, machine, program, inst, 0, 0, n);
+            for (i = 0; i < n; i++)
+               result[0][i] = 1.0F / a[0][i];
+            scalar = GL_TRUE;
+            break;
+         case FP_OPCODE_RFL:
+            fetch_span_vector4(ctx, machine, program, inst, 0, n, a);
+            fetch_span_vector4(ctx, machine, program, inst, 1, n, b);
+            for (i = 0; i < n; i++) {
+               const GLfloat len2 = a[0][i] * a[0][i]
+                                  + a[1][i] * a[1][i]
+                                  + a[2][i] * a[2][i];
+               const GLfloat s = (2.0F * (a[0][i] * b[0][i] +
+                                          a[1][i] * b[1][i] +
+                                          a[2][i] * b[2][i])) / len2;
+               result[0][i] = s * a[0][i] - b[0][i];
+               result[1][i] = s * a[1][i] - b[1][i];
+               result[2][i] = s * a[2][i] - b[2][i];
+               result[3][i] = 0.0F;  /* undefined! */
+            }
+            break;
+         case FP_OPCODE_RSQ: /* 1 / sqrt() */
+            a[0] = fetch_span_component(ctx, machine, program, inst, 0, 0, n);
+            for (i = 0; i < n; i++)
+               result[0][i] = INV_SQRTF(FABSF(a[0][i]));
+            scalar = GL_TRUE;
+            break;
+         case FP_OPCODE_SCS: /* sine and cos */
+            a[0] = fetch_span_component(ctx, machine, program, inst, 0, 0, n);
+            for (i = 0; i < n; i++) {
+               result[0][i] = (GLfloat)cos(a[0][i]);
+               result[1][i] = (GLfloat)sin(a[0][i]);
+               result[2][i] = 0.0;  /* undefined! */
+               result[3][i] = 0.0;  /* undefined! */
+            }
+            break;
+         case FP_OPCODE_SEQ: /* set on equal */
+         case FP_OPCODE_SGE: /* set on greater or equal */
+         case FP_OPCODE_SGT: /* set on greater */
+         case FP_OPCODE_SLE: /* set on less or equal */
+         case FP_OPCODE_SLT: /* set on less */
+         case FP_OPCODE_SNE: /* set on not equal */
+            for (j = 0; j < 4; j++) {
+               if (!GET_BIT(mask, j))
+                  continue;
+               a[j] = fetch_span_component(ctx, machine, program, inst, 0, j, n);
+               b[j] = fetch_span_component(ctx, machine, program, inst, 1, j, n);
+               switch (inst->Opcode) {
+               case FP_OPCODE_SEQ:
+                  for (i = 0; i < n; i++)
+                     result[j][i] = (a[j][i] == b[j][i]) ? 1.0F : 0.0F;
+                  break;
+               case FP_OPCODE_SGE:
+                  for (i = 0; i < n; i++)
+                     result[j][i] = (a[j][i] >= b[j][i]) ? 1.0F : 0.0F;
+                  break;
+               case FP_OPCODE_SGT:
+                  for (i = 0; i < n; i++)
+                     result[j][i] = (a[j][i] > b[j][i]) ? 1.0F : 0.0F;
+                  break;
+               case FP_OPCODE_SLE:
+                  for (i = 0; i < n; i++)
+                     result[j][i] = (a[j][i] <= b[j][i]) ? 1.0F : 0.0F;
+                  break;
+               case FP_OPCODE_SLT:
+                  for (i = 0; i < n; i++)
+                     result[j][i] = (a[j][i] < b[j][i]) ? 1.0F : 0.0F;
+                  break;
+               default:
+                  for (i = 0; i < n; i++)
+                     result[j][i] = (a[j][i] != b[j][i]) ? 1.0F : 0.0F;
+                  break;
+               }
+            }
+            break;
+         case FP_OPCODE_SFL: /* set false, operands ignored */
+         case FP_OPCODE_STR: /* set true, operands ignored */
+            {
+               const GLfloat value
+                  = (inst->Opcode == FP_OPCODE_STR) ? 1.0F : 0.0F;
+               for (i = 0; i < n; i++)
+                  result[0][i] = value;
+               scalar = GL_TRUE;
+            }
+            break;
+         case FP_OPCODE_SIN:
+            a[0] = fetch_span_component(ctx, machine, program, inst, 0, 0, n);
+            for (i = 0; i < n; i++)
+               result[0][i] = (GLfloat)_mesa_sin(a[0][i]);
+            scalar = GL_TRUE;
+            break;
+         case FP_OPCODE_SUB:
+            for (j = 0; j < 4; j++) {
+               if (GET_BIT(mask, j)) {
+                  a[j] = fetch_span_component(ctx, machine, program, inst, 0, j, n);
+                  b[j] = fetch_span_component(ctx, machine, program, inst, 1, j, n);
+                  for (i = 0; i < n; i++)
+                     result[j][i] = a[j][i] - b[j][i];
+               }
+            }
+            break;
+         case FP_OPCODE_TEX: /* Both ARB and NV frag prog */
+         case FP_OPCODE_TXB: /* GL_ARB_fragment_program only */
+         case FP_OPCODE_TXP: /* GL_ARB_fragment_program only */
+         case FP_OPCODE_TXP_NV: /* GL_NV_fragment_program only */
+            {
+               const GLuint unit = inst->TexSrcUnit;
+               const GLfloat *lambda = span->array->lambda[unit] + start;
+               GLfloat (*texcoord)[4] = machine->TexCoords;
+
+               fetch_span_vector4(ctx, machine, program, inst, 0, n, a);
+               for (i = 0; i < n; i++) {
+                  texcoord[i][0] = a[0][i];
+                  texcoord[i][1] = a[1][i];
+                  texcoord[i][2] = a[2][i];
+                  texcoord[i][3] = a[3][i];
+                  machine->Lambda[i] = lambda[i];
+               }
+
+               if (inst->Opcode == FP_OPCODE_TXB) {
+                  /* texcoord[3] is the bias to add to lambda */
+                  for (i = 0; i < n; i++) {
+                     const GLfloat bias = ctx->Texture.Unit[unit].LodBias
+                        + ctx->Texture.Unit[unit]._Current->LodBias
+                        + texcoord[i][3];
+                     machine->Lambda[i] += bias;
+                  }
+               }
+               else if (inst->Opcode == FP_OPCODE_TXP ||
+                        (inst->Opcode == FP_OPCODE_TXP_NV &&
+                         inst->TexSrcIdx != TEXTURE_CUBE_INDEX)) {
+                  for (i = 0; i < n; i++) {
+                     if (texcoord[i][3] != 0.0) {
+                        texcoord[i][0] /= texcoord[i][3];
+                        texcoord[i][1] /= texcoord[i][3];
+                        texcoord[i][2] /= texcoord[i][3];
+                     }
+                  }
+               }
+
+               fetch_span_texels(ctx, machine, unit, n);
+            }
+            break;
+         case FP_OPCODE_TXD: /* GL_NV_fragment_program only */
+            /* Texture lookup w/ partial derivatives for LOD */
+            fetch_span_vector4(ctx, machine, program, inst, 0, n, a);
+            fetch_span_vector4(ctx, machine, program, inst, 1, n, b);
+            fetch_span_vector4(ctx, machine, program, inst, 2, n, c);
+            for (i = 0; i < n; i++) {
+               GLfloat texcoord[4], dtdx[4], dtdy[4], color[4];
+               for (j = 0; j < 4; j++) {
+                  texcoord[j] = a[j][i];
+                  dtdx[j] = b[j][i];
+                  dtdy[j] = c[j][i];
+               }
+               fetch_texel_deriv( ctx, texcoord, dtdx, dtdy, inst->TexSrcUnit,
+                                  color );
+               for (j = 0; j < 4; j++)
+                  result[j][i] = color[j];
+            }
+            break;
+         case FP_OPCODE_UP2H: /* unpack two 16-bit floats */
+            {
+               const GLuint *rawBits;
+               a[0] = fetch_span_component(ctx, machine, program, inst, 0, 0, n);
+               rawBits = (const GLuint *) a[0];
+               for (i = 0; i < n; i++) {
+                  result[0][i] = result[2][i]
+                     = _mesa_half_to_float(rawBits[i] & 0xffff);
+                  result[1][i] = result[3][i]
+                     = _mesa_half_to_float(rawBits[i] >> 16);
+               }
+            }
+            break;
+         case FP_OPCODE_UP2US: /* unpack two GLushorts */
+            {
+               const GLuint *rawBits;
+               a[0] = fetch_span_component(ctx, machine, program, inst, 0, 0, n);
+               rawBits = (const GLuint *) a[0];
+               for (i = 0; i < n; i++) {
+                  result[0][i] = result[2][i]
+                     = (rawBits[i] & 0xffff) * (1.0f / 65535.0f);
+                  result[1][i] = result[3][i]
+                     = (rawBits[i] >> 16) * (1.0f / 65535.0f);
+               }
+            }
+            break;
+         case FP_OPCODE_UP4B: /* unpack four GLbytes */
+            {
+               const GLuint *rawBits;
+               a[0] = fetch_span_component(ctx, machine, program, inst, 0, 0, n);
+               rawBits = (const GLuint *) a[0];
+               for (j = 0; j < 4; j++) {
+                  for (i = 0; i < n; i++)
+                     result[j][i]
+                        = (((rawBits[i] >> (8 * j)) & 0xff) - 128) / 127.0F;
+               }
+            }
+            break;
+         case FP_OPCODE_UP4UB: /* unpack four GLubytes */
+            {
+               const GLuint *rawBits;
+               a[0] = fetch_span_component(ctx, machine, program, inst, 0, 0, n);
+               rawBits = (const GLuint *) a[0];
+               for (j = 0; j < 4; j++) {
+                  for (i = 0; i < n; i++)
+                     result[j][i] = ((rawBits[i] >> (8 * j)) & 0xff) / 255.0F;
+               }
+            }
+            break;
+         case FP_OPCODE_XPD: /* cross product */
+            fetch_span_vector4(ctx, machine, program, inst, 0, n, a);
+            fetch_span_vector4(ctx, machine, program, inst, 1, n, b);
+            for (i = 0; i < n; i++) {
+               result[0][i] = a[1][i] * b[2][i] - a[2][i] * b[1][i];
+               result[1][i] = a[2][i] * b[0][i] - a[0][i] * b[2][i];
+               result[2][i] = a[0][i] * b[1][i] - a[1][i] * b[0][i];
+               result[3][i] = 1.0;
+            }
+            break;
+         case FP_OPCODE_X2D: /* 2-D matrix transform */
+            fetch_span_vector4(ctx, machine, program, inst, 0, n, a);
+            fetch_span_vector4(ctx, machine, program, inst, 1, n, b);
+            fetch_span_vector4(ctx, machine, program, inst, 2, n, c);
+            for (i = 0; i < n; i++) {
+               result[0][i] = a[0][i] + b[0][i] * c[0][i] + b[1][i] * c[1][i];
+               result[1][i] = a[1][i] + b[0][i] * c[2][i] + b[1][i] * c[3][i];
+               result[2][i] = a[2][i] + b[0][i] * c[0][i] + b[1][i] * c[1][i];
+               result[3][i] = a[3][i] + b[0][i] * c[2][i] + b[1][i] * c[3][i];
+            }
+            break;
+         case FP_OPCODE_END:
+            return;
+         default:
+            _mesa_problem(ctx, "Bad opcode %d in execute_program_span",
+                          inst->Opcode);
+            return;
+      }
+
+      if (inst->Opcode != FP_OPCODE_KIL)
+         store_span_vector4(inst, machine, scalar, n);
+   }
+}
+
+
+/**
+ * Load the input registers for fragments [start, start + n) of the span.
+ */
+static void
+init_machine_span( GLcontext *ctx, struct fp_span_machine *machine,
+                   const struct fragment_program *program,
+                   const struct sw_span *span, GLuint start, GLuint n,
+                   GLuint numTemps )
+{
+   const GLuint inputsRead = program->InputsRead;
+   GLuint i, u;
+
+   if (program->Base.Target == GL_FRAGMENT_PROGRAM_NV) {
+      /* Clear temporary registers (undefined for ARB_f_p) */
+      _mesa_bzero(machine->Temporaries,
+                  numTemps * sizeof(machine->Temporaries[0]));
+   }
+
+   if (inputsRead & (1 << FRAG_ATTRIB_WPOS)) {
+      GLfloat (*wpos)[FP_SPAN_CHUNK] = machine->Inputs[FRAG_ATTRIB_WPOS];
+      ASSERT(span->arrayMask & SPAN_Z);
+      for (i = 0; i < n; i++) {
+         const GLuint col = start + i;
+         wpos[0][i] = (GLfloat) span->x + col;
+         wpos[1][i] = (GLfloat) span->y;
+         wpos[2][i] = (GLfloat) span->array->z[col] / ctx->DrawBuffer->_DepthMaxF;
+         wpos[3][i] = span->w + col * span->dwdx;
+      }
+   }
+   if (inputsRead & (1 << FRAG_ATTRIB_COL0)) {
+      GLfloat (*col0)[FP_SPAN_CHUNK] = machine->Inputs[FRAG_ATTRIB_COL0];
+      const GLchan (*rgba)[4] = (const GLchan (*)[4]) span->array->rgba + start;
+      ASSERT(span->arrayMask & SPAN_RGBA);
+      for (i = 0; i < n; i++) {
+         col0[0][i] = CHAN_TO_FLOAT(rgba[i][RCOMP]);
+         col0[1][i] = CHAN_TO_FLOAT(rgba[i][GCOMP]);
+         col0[2][i] = CHAN_TO_FLOAT(rgba[i][BCOMP]);
+         col0[3][i] = CHAN_TO_FLOAT(rgba[i][ACOMP]);
+      }
+   }
+   if (inputsRead & (1 << FRAG_ATTRIB_COL1)) {
+      GLfloat (*col1)[FP_SPAN_CHUNK] = machine->Inputs[FRAG_ATTRIB_COL1];
+      const GLchan (*spec)[4] = (const GLchan (*)[4]) span->array->spec + start;
+      for (i = 0; i < n; i++) {
+         col1[0][i] = CHAN_TO_FLOAT(spec[i][RCOMP]);
+         col1[1][i] = CHAN_TO_FLOAT(spec[i][GCOMP]);
+         col1[2][i] = CHAN_TO_FLOAT(spec[i][BCOMP]);
+         col1[3][i] = CHAN_TO_FLOAT(spec[i][ACOMP]);
+      }
+   }
+   if (inputsRead & (1 << FRAG_ATTRIB_FOGC)) {
+      GLfloat (*fogc)[FP_SPAN_CHUNK] = machine->Inputs[FRAG_ATTRIB_FOGC];
+      ASSERT(span->arrayMask & SPAN_FOG);
+      for (i = 0; i < n; i++) {
+         fogc[0][i] = span->array->fog[start + i];
+         fogc[1][i] = 0.0F;
+         fogc[2][i] = 0.0F;
+         fogc[3][i] = 0.0F;
+      }
+   }
+   for (u = 0; u < ctx->Const.MaxTextureCoordUnits; u++) {
+      if (inputsRead & (1 << (FRAG_ATTRIB_TEX0 + u))) {
+         GLfloat (*tex)[FP_SPAN_CHUNK] = machine->Inputs[FRAG_ATTRIB_TEX0 + u];
+         const GLfloat (*texcoords)[4]
+            = (const GLfloat (*)[4]) span->array->texcoords[u] + start;
+         for (i = 0; i < n; i++) {
+            tex[0][i] = texcoords[i][0];
+            tex[1][i] = texcoords[i][1];
+            tex[2][i] = texcoords[i][2];
+            tex[3][i] = texcoords[i][3];
+         }
+      }
+   }
+
+   for (i = 0; i < n; i++)
+      machine->Killed[i] = GL_FALSE;
+}
+
+
+/**
+ * Run the current fragment program on the span with the span
+ * interpreter.
+ * \return GL_FALSE if the program needs the per-fragment interpreter.
+ */
+static GLboolean
+exec_fragment_program_span( GLcontext *ctx, struct sw_span *span )
+{
+   SWcontext *swrast = SWRAST_CONTEXT(ctx);
+   const struct fragment_program *program = ctx->FragmentProgram._Current;
+   const GLboolean writeDepth
+      = (program->OutputsWritten & (1 << FRAG_OUTPUT_DEPR)) != 0;
+   struct fp_span_machine *machine;
+   GLuint numTemps, start, i;
+
+   if (ctx->FragmentProgram.CallbackEnabled ||
+       !span_program_supported(program, &numTemps))
+      return GL_FALSE;
+
+   machine = swrast->FragProgSpanMachine;
+   if (!machine) {
+      machine = (struct fp_span_machine *)
+         _mesa_align_malloc(sizeof(struct fp_span_machine), 16);
+      if (!machine)
+         return GL_FALSE;
+      swrast->FragProgSpanMachine = machine;
+   }
+
+   for (start = 0; start < span->end; start += FP_SPAN_CHUNK) {
+      const GLuint n = MIN2(FP_SPAN_CHUNK, span->end - start);
+      GLubyte *mask = span->array->mask + start;
+      const GLfloat (*colOut)[FP_SPAN_CHUNK];
+
+      for (i = 0; i < n; i++) {
+         if (mask[i])
+            break;
+      }
+      if (i == n)
+         continue;
+
+      init_machine_span(ctx, machine, program, span, start, n, numTemps);
+      execute_program_span(ctx, program, machine, span, start, n);
+
+      /* Store output registers */
+      colOut = (const GLfloat (*)[FP_SPAN_CHUNK])
+         machine->Outputs[FRAG_OUTPUT_COLR];
+      for (i = 0; i < n; i++) {
+         if (!mask[i])
+            continue;
+         if (machine->Killed[i]) {
+            mask[i] = GL_FALSE;  /* killed fragment */
+            span->writeAll = GL_FALSE;
+            continue;
+         }
+         UNCLAMPED_FLOAT_TO_CHAN(span->array->rgba[start + i][RCOMP], colOut[0][i]);
+         UNCLAMPED_FLOAT_TO_CHAN(span->array->rgba[start + i][GCOMP], colOut[1][i]);
+         UNCLAMPED_FLOAT_TO_CHAN(span->array->rgba[start + i][BCOMP], colOut[2][i]);
+         UNCLAMPED_FLOAT_TO_CHAN(span->array->rgba[start + i][ACOMP], colOut[3][i]);
+         if (writeDepth) {
+            const GLfloat depth = machine->Outputs[FRAG_OUTPUT_DEPR][2][i];
+            span->array->z[start + i]
+               = IROUND(depth * ctx->DrawBuffer->_DepthMaxF);
+         }
+      }
+   }
+
+   return GL_TRUE;
+}
+
+
 /**
  * Execute the current fragment program, operating on the given span.
  */
@@ -1459,7 +2365,13 @@ _swrast_exec_fragment_program( GLcontext *ctx, struct sw_span *span )
       _mesa_load_state_parameters(ctx, program->Parameters);
    }   
 
-   for (i = 0; i < span->end; i++) {
+   if (_swrast_sse_exec_fragment_program(ctx, span) ||
+       exec_fragment_program_span(ctx, span))
+      i = span->end;
+   else
+      i = 0;
+
+   for ( ; i < span->end; i++) {
       if (span->array->mask[i]) {
          init_machine(ctx, &ctx->FragmentProgram.Machine,
                       ctx->FragmentProgram._Current, span, i);
@@ -33,5 +33,14 @@
 extern void
 _swrast_exec_fragment_program( GLcontext *ctx, struct sw_span *span );
 
+extern GLboolean
+_swrast_sse_exec_fragment_program( GLcontext *ctx, struct sw_span *span );
+
+extern void
+_swrast_sse_invalidate_fragment_program( GLcontext *ctx );
+
+extern void
+_swrast_sse_destroy_fragment_programs( GLcontext *ctx );
+
 
 #endif
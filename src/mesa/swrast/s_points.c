@@ -45,11 +45,131 @@
 #define SPRITE    0x80
 
 
+/*
+ * The fill_point_row() SSE2 code is always available on x86-64.
+ */
+#if defined(__SSE2__)
+#define USE_SSE2_POINTS
+#include <emmintrin.h>
+#endif
+
+
+/**
+ * Blending, logic ops and color masking read the destination colors of
+ * the whole point span at once, so a point mustn't be drawn over pixels
+ * that already have fragments in the span.  The span's pixels are
+ * tracked in swrast->PointStamp, a hash table of 2x2 pixel cells holding
+ * the generation number of the span that last covered them.  Emptying
+ * the span starts a new generation.
+ */
+#define POINT_STAMP(X, Y) \
+   ((((X) >> 1) + ((Y) >> 1) * 67) & (SWRAST_POINT_STAMPS - 1))
+
+
+/**
+ * May pixels [xmin, xmax] x [ymin, ymax] have fragments in the point span?
+ */
+static INLINE GLboolean
+point_overlaps_span( const SWcontext *swrast, GLint xmin, GLint ymin,
+                     GLint xmax, GLint ymax )
+{
+   GLint x, y;
+
+   if (swrast->PointSpan.end == 0)
+      return GL_FALSE;
+
+   for (y = ymin & ~1; y <= ymax; y += 2) {
+      for (x = xmin & ~1; x <= xmax; x += 2) {
+         if (swrast->PointStamp[POINT_STAMP(x, y)] == swrast->PointStampGen)
+            return GL_TRUE;
+      }
+   }
+   return GL_FALSE;
+}
+
+
+/**
+ * Record that pixels [xmin, xmax] x [ymin, ymax] are added to the point
+ * span.
+ */
+static INLINE void
+add_point_to_span( SWcontext *swrast, GLint xmin, GLint ymin,
+                   GLint xmax, GLint ymax )
+{
+   GLint x, y;
+
+   if (swrast->PointSpan.end == 0)
+      swrast->PointStampGen++;
+
+   for (y = ymin & ~1; y <= ymax; y += 2) {
+      for (x = xmin & ~1; x <= xmax; x += 2) {
+         swrast->PointStamp[POINT_STAMP(x, y)] = swrast->PointStampGen;
+      }
+   }
+}
+
+
+/**
+ * Put the n fragments of a point row at (x, y) .. (x + n - 1, y) into
+ * the span arrays starting at index i.  If color isn't NULL it's stored
+ * as the fragments' color.
+ */
+static INLINE void
+fill_point_row( struct span_arrays *array, GLuint i, GLint x, GLint y,
+                GLuint n, GLdepth z, GLfloat fog, const GLchan color[4] )
+{
+   GLuint j = 0;
+
+#if defined(USE_SSE2_POINTS)
+   {
+      const __m128i four = _mm_set1_epi32(4);
+      const __m128i yv = _mm_set1_epi32(y);
+      const __m128i zv = _mm_set1_epi32((GLint) z);
+      const __m128 fogv = _mm_set1_ps(fog);
+      __m128i xv = _mm_add_epi32(_mm_set1_epi32(x), _mm_setr_epi32(0, 1, 2, 3));
+      for (; j + 4 <= n; j += 4) {
+         _mm_storeu_si128((__m128i *) (array->x + i + j), xv);
+         _mm_storeu_si128((__m128i *) (array->y + i + j), yv);
+         _mm_storeu_si128((__m128i *) (array->z + i + j), zv);
+         _mm_storeu_ps(array->fog + i + j, fogv);
+         xv = _mm_add_epi32(xv, four);
+      }
+   }
+#endif
+   for (; j < n; j++) {
+      array->x[i + j] = x + j;
+      array->y[i + j] = y;
+      array->z[i + j] = z;
+      array->fog[i + j] = fog;
+   }
+
+   if (color) {
+      GLchan (*rgba)[4] = array->rgba + i;
+      j = 0;
+#if defined(USE_SSE2_POINTS) && CHAN_BITS == 8
+      {
+         GLuint c;
+         __m128i cv;
+         COPY_4UBV((GLubyte *) &c, color);
+         cv = _mm_set1_epi32((GLint) c);
+         for (; j + 4 <= n; j += 4) {
+            _mm_storeu_si128((__m128i *) rgba[j], cv);
+         }
+      }
+#endif
+      for (; j < n; j++) {
+         COPY_CHAN4(rgba[j], color);
+      }
+   }
+}
+
+
 /*
  * CI points with size == 1.0
  */
 #define FLAGS (INDEX)
 #define NAME size1_ci_point
+#define BATCH_NAME size1_ci_points
 #include "s_pointtemp.h"
 
 
@@ -58,6 +178,7 @@
  */
 #define FLAGS (INDEX | LARGE)
 #define NAME general_ci_point
+#define BATCH_NAME general_ci_points
 #include "s_pointtemp.h"
 
 
@@ -66,6 +187,7 @@
  */
 #define FLAGS (INDEX | SMOOTH)
 #define NAME antialiased_ci_point
+#define BATCH_NAME antialiased_ci_points
 #include "s_pointtemp.h"
 
 
@@ -74,6 +196,7 @@
  */
 #define FLAGS (INDEX | ATTENUATE)
 #define NAME atten_general_ci_point
+#define BATCH_NAME atten_general_ci_points
 #include "s_pointtemp.h"
 
 
@@ -82,6 +205,7 @@
  */
 #define FLAGS (RGBA)
 #define NAME size1_rgba_point
+#define BATCH_NAME size1_rgba_points
 #include "s_pointtemp.h"
 
 
@@ -90,6 +214,7 @@
  */
 #define FLAGS (RGBA | LARGE)
 #define NAME general_rgba_point
+#define BATCH_NAME general_rgba_points
 #include "s_pointtemp.h"
 
 
@@ -98,6 +223,7 @@
  */
 #define FLAGS (RGBA | SMOOTH)
 #define NAME antialiased_rgba_point
+#define BATCH_NAME antialiased_rgba_points
 #include "s_pointtemp.h"
 
 
@@ -106,6 +232,7 @@
  */
 #define FLAGS (RGBA | LARGE | TEXTURE | SPECULAR)
 #define NAME textured_rgba_point
+#define BATCH_NAME textured_rgba_points
 #include "s_pointtemp.h"
 
 
@@ -114,6 +241,7 @@
  */
 #define FLAGS (RGBA | SMOOTH | TEXTURE | SPECULAR)
 #define NAME antialiased_tex_rgba_point
+#define BATCH_NAME antialiased_tex_rgba_points
 #include "s_pointtemp.h"
 
 
@@ -122,6 +250,7 @@
  */
 #define FLAGS (RGBA | ATTENUATE)
 #define NAME atten_general_rgba_point
+#define BATCH_NAME atten_general_rgba_points
 #include "s_pointtemp.h"
 
 
@@ -130,6 +259,7 @@
  */
 #define FLAGS (RGBA | ATTENUATE | TEXTURE | SPECULAR)
 #define NAME atten_textured_rgba_point
+#define BATCH_NAME atten_textured_rgba_points
 #include "s_pointtemp.h"
 
 
@@ -138,6 +268,7 @@
  */
 #define FLAGS (RGBA | ATTENUATE | TEXTURE | SMOOTH)
 #define NAME atten_antialiased_rgba_point
+#define BATCH_NAME atten_antialiased_rgba_points
 #include "s_pointtemp.h"
 
 
@@ -146,11 +277,13 @@
  */
 #define FLAGS (RGBA | SPRITE | SPECULAR)
 #define NAME sprite_point
+#define BATCH_NAME sprite_points
 #include "s_pointtemp.h"
 
 
 #define FLAGS (RGBA | SPRITE | SPECULAR | ATTENUATE)
 #define NAME atten_sprite_point
+#define BATCH_NAME atten_sprite_points
 #include "s_pointtemp.h"
 
 
@@ -168,21 +301,49 @@ void _swrast_add_spec_terms_point( GLcontext *ctx,
 
 
 
+/**
+ * Draw points one at a time with swrast->Point, for the cases without
+ * a batched point function.
+ */
+void
+_swrast_loop_points( GLcontext *ctx, const SWvertex *verts,
+                     const GLuint *elts, GLuint count )
+{
+   SWcontext *swrast = SWRAST_CONTEXT(ctx);
+   GLuint i;
+
+   if (elts) {
+      for (i = 0; i < count; i++)
+         swrast->Point( ctx, &verts[elts[i]] );
+   }
+   else {
+      for (i = 0; i < count; i++)
+         swrast->Point( ctx, &verts[i] );
+   }
+}
+
+
+
 /* record the current point function name */
 #ifdef DEBUG
 
 static const char *pntFuncName = NULL;
 
-#define USE(pntFunc)                   \
+#define USE(pntFunc, pntsFunc)         \
 do {                                   \
     pntFuncName = #pntFunc;            \
     /*printf("%s\n", pntFuncName);*/   \
     swrast->Point = pntFunc;           \
+    swrast->Points = pntsFunc;         \
 } while (0)
 
 #else
 
-#define USE(pntFunc)  swrast->Point = pntFunc
+#define USE(pntFunc, pntsFunc)         \
+do {                                   \
+    swrast->Point = pntFunc;           \
+    swrast->Points = pntsFunc;         \
+} while (0)
 
 #endif
 
@@ -202,74 +363,74 @@ _swrast_choose_point( GLcontext *ctx )
          /* GL_ARB_point_sprite / GL_NV_point_sprite */
          /* XXX this might not be good enough */
          if (ctx->Point._Attenuated)
-            USE(atten_sprite_point);
+            USE(atten_sprite_point, atten_sprite_points);
          else
-            USE(sprite_point);
+            USE(sprite_point, sprite_points);
       }
       else if (ctx->Point.SmoothFlag) {
          /* Smooth points */
          if (rgbMode) {
             if (ctx->Point._Attenuated || ctx->VertexProgram.PointSizeEnabled) {
-               USE(atten_antialiased_rgba_point);
+               USE(atten_antialiased_rgba_point, atten_antialiased_rgba_points);
             }
             else if (ctx->Texture._EnabledCoordUnits) {
-               USE(antialiased_tex_rgba_point);
+               USE(antialiased_tex_rgba_point, antialiased_tex_rgba_points);
             }
             else {
-               USE(antialiased_rgba_point);
+               USE(antialiased_rgba_point, antialiased_rgba_points);
             }
          }
          else {
-            USE(antialiased_ci_point);
+            USE(antialiased_ci_point, antialiased_ci_points);
          }
       }
       else if (ctx->Point._Attenuated || ctx->VertexProgram.PointSizeEnabled) {
          if (rgbMode) {
             if (ctx->Texture._EnabledCoordUnits) {
                if (ctx->Point.SmoothFlag) {
-                  USE(atten_antialiased_rgba_point);
+                  USE(atten_antialiased_rgba_point, atten_antialiased_rgba_points);
                }
                else {
-                  USE(atten_textured_rgba_point);
+                  USE(atten_textured_rgba_point, atten_textured_rgba_points);
                }
             }
             else {
-               USE(atten_general_rgba_point);
+               USE(atten_general_rgba_point, atten_general_rgba_points);
             }
          }
          else {
             /* ci, atten */
-            USE(atten_general_ci_point);
+            USE(atten_general_ci_point, atten_general_ci_points);
          }
       }
       else if (ctx->Texture._EnabledCoordUnits && rgbMode) {
          /* textured */
-         USE(textured_rgba_point);
+         USE(textured_rgba_point, textured_rgba_points);
       }
       else if (ctx->Point._Size != 1.0) {
          /* large points */
          if (rgbMode) {
-            USE(general_rgba_point);
+            USE(general_rgba_point, general_rgba_points);
          }
          else {
-            USE(general_ci_point);
+            USE(general_ci_point, general_ci_points);
          }
       }
       else {
          /* single pixel points */
          if (rgbMode) {
-            USE(size1_rgba_point);
+            USE(size1_rgba_point, size1_rgba_points);
          }
          else {
-            USE(size1_ci_point);
+            USE(size1_ci_point, size1_ci_points);
          }
       }
    }
    else if (ctx->RenderMode==GL_FEEDBACK) {
-      USE(_swrast_feedback_point);
+      USE(_swrast_feedback_point, _swrast_loop_points);
    }
    else {
       /* GL_SELECT mode */
-      USE(_swrast_select_point);
+      USE(_swrast_select_point, _swrast_loop_points);
    }
 }
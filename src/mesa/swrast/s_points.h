@@ -36,4 +36,8 @@ extern void
 _swrast_add_spec_terms_point( GLcontext *ctx,
 			      const SWvertex *v0 );
 
+extern void
+_swrast_loop_points( GLcontext *ctx, const SWvertex *verts,
+                     const GLuint *elts, GLuint count );
+
 #endif
@@ -64,51 +64,41 @@
 
 
 
+/**
+ * Draw n points, verts[elts[i]] or verts[i] if elts is NULL.  The
+ * fragments are accumulated in swrast->PointSpan, which is written when
+ * it's full, or before a point overlaps its fragments if blending, logic
+ * ops or color masking need the old destination colors.
+ */
 static void
-NAME ( GLcontext *ctx, const SWvertex *vert )
+BATCH_NAME( GLcontext *ctx, const SWvertex *verts, const GLuint *elts,
+            GLuint n )
 {
+   SWcontext *swrast = SWRAST_CONTEXT(ctx);
+   struct sw_span *span = &(swrast->PointSpan);
+   const GLboolean noOverlap =
+      (swrast->_RasterMask & (BLEND_BIT | LOGIC_OP_BIT | MASKING_BIT)) != 0;
 #if FLAGS & (ATTENUATE | LARGE | SMOOTH | SPRITE)
    GLfloat size;
 #endif
-#if FLAGS & RGBA
-#if (FLAGS & ATTENUATE) && (FLAGS & SMOOTH)
-   GLfloat alphaAtten;
-#endif
-   const GLchan red   = vert->color[0];
-   const GLchan green = vert->color[1];
-   const GLchan blue  = vert->color[2];
-   const GLchan alpha = vert->color[3];
-#endif
-#if FLAGS & SPECULAR
-   const GLchan specRed   = vert->specular[0];
-   const GLchan specGreen = vert->specular[1];
-   const GLchan specBlue  = vert->specular[2];
-#endif
-#if FLAGS & INDEX
-   const GLuint colorIndex = (GLuint) vert->index; /* XXX round? */
-#endif
 #if FLAGS & TEXTURE
    GLfloat texcoord[MAX_TEXTURE_COORD_UNITS][4];
+   GLuint texUnit[MAX_TEXTURE_COORD_UNITS], numTexUnits = 0;
+#endif
+#if FLAGS & SPRITE
+   GLuint spriteUnit[MAX_TEXTURE_COORD_UNITS], numSpriteUnits = 0;
+   GLfloat spriteR[MAX_TEXTURE_COORD_UNITS];
+#endif
+#if FLAGS & (TEXTURE | SPRITE)
    GLuint u;
 #endif
-   SWcontext *swrast = SWRAST_CONTEXT(ctx);
-   struct sw_span *span = &(swrast->PointSpan);
-
-   /* Cull primitives with malformed coordinates.
-    */
-   {
-      float tmp = vert->win[0] + vert->win[1];
-      if (IS_INF_OR_NAN(tmp))
-	 return;
-   }
+   GLuint i;
 
    /*
     * Span init
     */
-   span->interpMask = SPAN_FOG;
-   span->arrayMask = SPAN_XY | SPAN_Z;
-   span->fog = vert->fog;
-   span->fogStep = 0.0;
+   span->interpMask = 0;
+   span->arrayMask = SPAN_XY | SPAN_Z | SPAN_FOG;
 #if FLAGS & RGBA
    span->arrayMask |= SPAN_RGBA;
 #endif
@@ -120,26 +110,9 @@ NAME ( GLcontext *ctx, const SWvertex *vert )
 #endif
 #if FLAGS & TEXTURE
    span->arrayMask |= SPAN_TEXTURE;
-   if (ctx->FragmentProgram._Active) {
-      /* Don't divide texture s,t,r by q (use TXP to do that) */
-      for (u = 0; u < ctx->Const.MaxTextureUnits; u++) {
-         if (ctx->Texture._EnabledCoordUnits & (1 << u)) {
-            COPY_4V(texcoord[u], vert->texcoord[u]);
-         }
-      }
-   }
-   else {
-      /* Divide texture s,t,r by q here */
-      for (u = 0; u < ctx->Const.MaxTextureUnits; u++) {
-         if (ctx->Texture._EnabledCoordUnits & (1 << u)) {
-            const GLfloat q = vert->texcoord[u][3];
-            const GLfloat invQ = (q == 0.0F || q == 1.0F) ? 1.0F : (1.0F / q);
-            texcoord[u][0] = vert->texcoord[u][0] * invQ;
-            texcoord[u][1] = vert->texcoord[u][1] * invQ;
-            texcoord[u][2] = vert->texcoord[u][2] * invQ;
-            texcoord[u][3] = q;
-         }
-      }
+   for (u = 0; u < ctx->Const.MaxTextureUnits; u++) {
+      if (ctx->Texture._EnabledCoordUnits & (1 << u))
+         texUnit[numTexUnits++] = u;
    }
    /* need these for fragment programs */
    span->w = 1.0F;
@@ -151,269 +124,395 @@ NAME ( GLcontext *ctx, const SWvertex *vert )
 #endif
 #if FLAGS & SPRITE
    span->arrayMask |= SPAN_TEXTURE;
-#endif
-
-   /* Compute point size if not known to be one */
-#if FLAGS & ATTENUATE
-   /* first, clamp attenuated size to the user-specifed range */
-   size = CLAMP(vert->pointSize, ctx->Point.MinSize, ctx->Point.MaxSize);
-#if (FLAGS & RGBA) && (FLAGS & SMOOTH)
-   /* only if multisampling, compute the fade factor */
-   if (ctx->Multisample.Enabled) {
-      if (vert->pointSize >= ctx->Point.Threshold) {
-         alphaAtten = 1.0F;
-      }
-      else {
-         GLfloat dsize = vert->pointSize / ctx->Point.Threshold;
-         alphaAtten = dsize * dsize;
-      }
-   }
-   else {
-      alphaAtten = 1.0;
+   for (u = 0; u < ctx->Const.MaxTextureUnits; u++) {
+      if (ctx->Texture.Unit[u]._ReallyEnabled)
+         spriteUnit[numSpriteUnits++] = u;
    }
 #endif
-#elif FLAGS & (LARGE | SMOOTH | SPRITE)
-   /* constant, non-attenuated size */
-   size = ctx->Point._Size; /* this is already clamped */
-#endif
 
-
-#if FLAGS & (ATTENUATE | LARGE | SMOOTH | SPRITE)
-   /***
-    *** Multi-pixel points
-    ***/
-
-   /* do final clamping now */
+#if (FLAGS & (LARGE | SMOOTH | SPRITE)) && !(FLAGS & ATTENUATE)
+   /* constant, non-attenuated size, already clamped to the user range */
+   size = ctx->Point._Size;
    if (ctx->Point.SmoothFlag) {
       size = CLAMP(size, ctx->Const.MinPointSizeAA, ctx->Const.MaxPointSizeAA);
    }
    else {
       size = CLAMP(size, ctx->Const.MinPointSize, ctx->Const.MaxPointSize);
    }
+#endif
 
-   {{
-      GLint x, y;
-      const GLfloat radius = 0.5F * size;
-      const GLint z = (GLint) (vert->win[2] + 0.5F);
-      GLuint count;
-#if FLAGS & SMOOTH
-      const GLfloat rmin = radius - 0.7071F;  /* 0.7071 = sqrt(2)/2 */
-      const GLfloat rmax = radius + 0.7071F;
-      const GLfloat rmin2 = MAX2(0.0F, rmin * rmin);
-      const GLfloat rmax2 = rmax * rmax;
-      const GLfloat cscale = 1.0F / (rmax2 - rmin2);
-      const GLint xmin = (GLint) (vert->win[0] - radius);
-      const GLint xmax = (GLint) (vert->win[0] + radius);
-      const GLint ymin = (GLint) (vert->win[1] - radius);
-      const GLint ymax = (GLint) (vert->win[1] + radius);
-#else
-      /* non-smooth */
-      GLint xmin, xmax, ymin, ymax;
-      GLint iSize = (GLint) (size + 0.5F);
-      GLint iRadius;
-      iSize = MAX2(1, iSize);
-      iRadius = iSize / 2;
-      if (iSize & 1) {
-         /* odd size */
-         xmin = (GLint) (vert->win[0] - iRadius);
-         xmax = (GLint) (vert->win[0] + iRadius);
-         ymin = (GLint) (vert->win[1] - iRadius);
-         ymax = (GLint) (vert->win[1] + iRadius);
+   for (i = 0; i < n; i++) {
+      const SWvertex *vert = elts ? verts + elts[i] : verts + i;
+#if FLAGS & RGBA
+#if (FLAGS & ATTENUATE) && (FLAGS & SMOOTH)
+      GLfloat alphaAtten;
+#endif
+      const GLchan red   = vert->color[0];
+      const GLchan green = vert->color[1];
+      const GLchan blue  = vert->color[2];
+      const GLchan alpha = vert->color[3];
+#endif
+#if FLAGS & SPECULAR
+      const GLchan specRed   = vert->specular[0];
+      const GLchan specGreen = vert->specular[1];
+      const GLchan specBlue  = vert->specular[2];
+#endif
+#if FLAGS & INDEX
+      const GLuint colorIndex = (GLuint) vert->index; /* XXX round? */
+#endif
+
+      /* Cull primitives with malformed coordinates.
+       */
+      {
+         float tmp = vert->win[0] + vert->win[1];
+         if (IS_INF_OR_NAN(tmp))
+            continue;
+      }
+
+#if FLAGS & TEXTURE
+      if (ctx->FragmentProgram._Active) {
+         /* Don't divide texture s,t,r by q (use TXP to do that) */
+         for (u = 0; u < numTexUnits; u++) {
+            COPY_4V(texcoord[texUnit[u]], vert->texcoord[texUnit[u]]);
+         }
       }
       else {
-         /* even size */
-         xmin = (GLint) vert->win[0] - iRadius + 1;
-         xmax = xmin + iSize - 1;
-         ymin = (GLint) vert->win[1] - iRadius + 1;
-         ymax = ymin + iSize - 1;
+         /* Divide texture s,t,r by q here */
+         for (u = 0; u < numTexUnits; u++) {
+            const GLuint unit = texUnit[u];
+            const GLfloat q = vert->texcoord[unit][3];
+            const GLfloat invQ = (q == 0.0F || q == 1.0F) ? 1.0F : (1.0F / q);
+            texcoord[unit][0] = vert->texcoord[unit][0] * invQ;
+            texcoord[unit][1] = vert->texcoord[unit][1] * invQ;
+            texcoord[unit][2] = vert->texcoord[unit][2] * invQ;
+            texcoord[unit][3] = q;
+         }
       }
-#endif /*SMOOTH*/
+#endif
 
-      /* check if we need to flush */
-      if (span->end + (xmax-xmin+1) * (ymax-ymin+1) >= MAX_WIDTH ||
-          (swrast->_RasterMask & (BLEND_BIT | LOGIC_OP_BIT | MASKING_BIT))) {
-#if FLAGS & RGBA
-         _swrast_write_rgba_span(ctx, span);
-#else
-         _swrast_write_index_span(ctx, span);
+#if FLAGS & ATTENUATE
+      /* first, clamp attenuated size to the user-specifed range */
+      size = CLAMP(vert->pointSize, ctx->Point.MinSize, ctx->Point.MaxSize);
+#if (FLAGS & RGBA) && (FLAGS & SMOOTH)
+      /* only if multisampling, compute the fade factor */
+      if (ctx->Multisample.Enabled) {
+         if (vert->pointSize >= ctx->Point.Threshold) {
+            alphaAtten = 1.0F;
+         }
+         else {
+            GLfloat dsize = vert->pointSize / ctx->Point.Threshold;
+            alphaAtten = dsize * dsize;
+         }
+      }
+      else {
+         alphaAtten = 1.0;
+      }
 #endif
-         span->end = 0;
+      /* do final clamping now */
+      if (ctx->Point.SmoothFlag) {
+         size = CLAMP(size, ctx->Const.MinPointSizeAA, ctx->Const.MaxPointSizeAA);
       }
+      else {
+         size = CLAMP(size, ctx->Const.MinPointSize, ctx->Const.MaxPointSize);
+      }
+#endif
 
-      /*
-       * OK, generate fragments
-       */
-      count = span->end;
-      (void) radius;
-      for (y = ymin; y <= ymax; y++) {
-         /* check if we need to flush */
-         if (count + (xmax-xmin+1) >= MAX_WIDTH) {
-	     span->end = count;
-#if FLAGS & RGBA
-            _swrast_write_rgba_span(ctx, span);
+
+#if FLAGS & (ATTENUATE | LARGE | SMOOTH | SPRITE)
+      /***
+       *** Multi-pixel points
+       ***/
+      {{
+         GLint y;
+         const GLfloat radius = 0.5F * size;
+         const GLint z = (GLint) (vert->win[2] + 0.5F);
+         GLuint count;
+#if FLAGS & SMOOTH
+         const GLfloat rmin = radius - 0.7071F;  /* 0.7071 = sqrt(2)/2 */
+         const GLfloat rmax = radius + 0.7071F;
+         const GLfloat rmin2 = MAX2(0.0F, rmin * rmin);
+         const GLfloat rmax2 = rmax * rmax;
+         const GLfloat cscale = 1.0F / (rmax2 - rmin2);
+         const GLint xmin = (GLint) (vert->win[0] - radius);
+         const GLint xmax = (GLint) (vert->win[0] + radius);
+         const GLint ymin = (GLint) (vert->win[1] - radius);
+         const GLint ymax = (GLint) (vert->win[1] + radius);
 #else
-            _swrast_write_index_span(ctx, span);
+         /* non-smooth */
+         GLint xmin, xmax, ymin, ymax;
+         GLint iSize = (GLint) (size + 0.5F);
+         GLint iRadius;
+#if FLAGS & RGBA
+         GLchan color[4];
+#endif
+#if FLAGS & SPRITE
+         /* sprite S coordinates of the columns */
+         GLfloat spriteS[MAX_WIDTH];
+         GLint x;
 #endif
-            count = span->end = 0;
+         iSize = MAX2(1, iSize);
+         iRadius = iSize / 2;
+         if (iSize & 1) {
+            /* odd size */
+            xmin = (GLint) (vert->win[0] - iRadius);
+            xmax = (GLint) (vert->win[0] + iRadius);
+            ymin = (GLint) (vert->win[1] - iRadius);
+            ymax = (GLint) (vert->win[1] + iRadius);
          }
+         else {
+            /* even size */
+            xmin = (GLint) vert->win[0] - iRadius + 1;
+            xmax = xmin + iSize - 1;
+            ymin = (GLint) vert->win[1] - iRadius + 1;
+            ymax = ymin + iSize - 1;
+         }
+#if FLAGS & RGBA
+         color[RCOMP] = red;
+         color[GCOMP] = green;
+         color[BCOMP] = blue;
+         color[ACOMP] = alpha;
+#endif
+#if FLAGS & SPRITE
          for (x = xmin; x <= xmax; x++) {
-#if FLAGS & (SPRITE | TEXTURE)
-            GLuint u;
+            spriteS[x - xmin] = 0.5F + (x + 0.5F - vert->win[0]) / size;
+         }
+         for (u = 0; u < numSpriteUnits; u++) {
+            const GLuint unit = spriteUnit[u];
+            if (ctx->Point.SpriteRMode == GL_ZERO)
+               spriteR[u] = 0.0F;
+            else if (ctx->Point.SpriteRMode == GL_S)
+               spriteR[u] = vert->texcoord[unit][0];
+            else /* GL_R */
+               spriteR[u] = vert->texcoord[unit][2];
+         }
 #endif
+#endif /*SMOOTH*/
 
+         /* check if we need to flush */
+         if (span->end + (xmax-xmin+1) * (ymax-ymin+1) >= MAX_WIDTH ||
+             (noOverlap && point_overlaps_span(swrast, xmin, ymin, xmax, ymax))) {
 #if FLAGS & RGBA
-            span->array->rgba[count][RCOMP] = red;
-            span->array->rgba[count][GCOMP] = green;
-            span->array->rgba[count][BCOMP] = blue;
-            span->array->rgba[count][ACOMP] = alpha;
-#endif
-#if FLAGS & SPECULAR
-            span->array->spec[count][RCOMP] = specRed;
-            span->array->spec[count][GCOMP] = specGreen;
-            span->array->spec[count][BCOMP] = specBlue;
+            _swrast_write_rgba_span(ctx, span);
+#else
+            _swrast_write_index_span(ctx, span);
 #endif
-#if FLAGS & INDEX
-            span->array->index[count] = colorIndex;
+            span->end = 0;
+         }
+         if (noOverlap)
+            add_point_to_span(swrast, xmin, ymin, xmax, ymax);
+
+         /*
+          * OK, generate fragments
+          */
+         count = span->end;
+         (void) radius;
+         for (y = ymin; y <= ymax; y++) {
+            /* check if we need to flush */
+            if (count + (xmax-xmin+1) >= MAX_WIDTH) {
+               span->end = count;
+#if FLAGS & RGBA
+               _swrast_write_rgba_span(ctx, span);
+#else
+               _swrast_write_index_span(ctx, span);
 #endif
-#if FLAGS & TEXTURE
-            for (u = 0; u < ctx->Const.MaxTextureUnits; u++) {
-               if (ctx->Texture._EnabledCoordUnits & (1 << u)) {
-                  COPY_4V(span->array->texcoords[u][count], texcoord[u]);
-               }
+               count = span->end = 0;
             }
-#endif
 
 #if FLAGS & SMOOTH
-            /* compute coverage */
             {
-               const GLfloat dx = x - vert->win[0] + 0.5F;
-               const GLfloat dy = y - vert->win[1] + 0.5F;
-               const GLfloat dist2 = dx * dx + dy * dy;
-               if (dist2 < rmax2) {
-                  if (dist2 >= rmin2) {
-                     /* compute partial coverage */
-                     span->array->coverage[count] = 1.0F - (dist2 - rmin2) * cscale;
+               GLint x;
+               for (x = xmin; x <= xmax; x++) {
+                  /* compute coverage */
+                  const GLfloat dx = x - vert->win[0] + 0.5F;
+                  const GLfloat dy = y - vert->win[1] + 0.5F;
+                  const GLfloat dist2 = dx * dx + dy * dy;
+                  if (dist2 < rmax2) {
+                     if (dist2 >= rmin2) {
+                        /* compute partial coverage */
+                        span->array->coverage[count] = 1.0F - (dist2 - rmin2) * cscale;
 #if FLAGS & INDEX
-                     /* coverage in [0,15] */
-                     span->array->coverage[count] *= 15.0;
+                        /* coverage in [0,15] */
+                        span->array->coverage[count] *= 15.0;
 #endif
-                  }
-                  else {
-                     /* full coverage */
-                     span->array->coverage[count] = 1.0F;
-                  }
+                     }
+                     else {
+                        /* full coverage */
+                        span->array->coverage[count] = 1.0F;
+                     }
 
-                  span->array->x[count] = x;
-                  span->array->y[count] = y;
-                  span->array->z[count] = z;
+                     span->array->x[count] = x;
+                     span->array->y[count] = y;
+                     span->array->z[count] = z;
+                     span->array->fog[count] = vert->fog;
 
-#if (FLAGS & ATTENUATE) && (FLAGS & RGBA)
-                  span->array->rgba[count][ACOMP] = (GLchan) (alpha * alphaAtten);
-#elif FLAGS & RGBA
-                  span->array->rgba[count][ACOMP] = alpha;
+#if FLAGS & RGBA
+                     span->array->rgba[count][RCOMP] = red;
+                     span->array->rgba[count][GCOMP] = green;
+                     span->array->rgba[count][BCOMP] = blue;
+#if FLAGS & ATTENUATE
+                     span->array->rgba[count][ACOMP] = (GLchan) (alpha * alphaAtten);
+#else
+                     span->array->rgba[count][ACOMP] = alpha;
 #endif /*ATTENUATE*/
-                  count++;
-               } /*if*/
+#endif
+#if FLAGS & SPECULAR
+                     span->array->spec[count][RCOMP] = specRed;
+                     span->array->spec[count][GCOMP] = specGreen;
+                     span->array->spec[count][BCOMP] = specBlue;
+#endif
+#if FLAGS & INDEX
+                     span->array->index[count] = colorIndex;
+#endif
+#if FLAGS & TEXTURE
+                     for (u = 0; u < numTexUnits; u++) {
+                        COPY_4V(span->array->texcoords[texUnit[u]][count],
+                                texcoord[texUnit[u]]);
+                     }
+#endif
+                     count++;
+                  } /*if*/
+               } /*for x*/
             }
 
 #else /*SMOOTH*/
 
             /* not smooth (square points) */
-            span->array->x[count] = x;
-            span->array->y[count] = y;
-            span->array->z[count] = z;
+            {
+               const GLuint width = xmax - xmin + 1;
+#if (FLAGS & (SPECULAR | INDEX | TEXTURE | SPRITE))
+               GLuint k;
+#endif
+#if FLAGS & SPRITE
+               GLfloat t;
+               if (ctx->Point.SpriteOrigin == GL_LOWER_LEFT)
+                  t = 0.5F + (y + 0.5F - vert->win[1]) / size;
+               else /* GL_UPPER_LEFT */
+                  t = 0.5F - (y + 0.5F - vert->win[1]) / size;
+#endif
 
+#if FLAGS & RGBA
+               fill_point_row(span->array, count, xmin, y, width, z,
+                              vert->fog, color);
+#else
+               fill_point_row(span->array, count, xmin, y, width, z,
+                              vert->fog, NULL);
+#endif
+#if FLAGS & SPECULAR
+               for (k = count; k < count + width; k++) {
+                  span->array->spec[k][RCOMP] = specRed;
+                  span->array->spec[k][GCOMP] = specGreen;
+                  span->array->spec[k][BCOMP] = specBlue;
+               }
+#endif
+#if FLAGS & INDEX
+               for (k = count; k < count + width; k++) {
+                  span->array->index[k] = colorIndex;
+               }
+#endif
+#if FLAGS & TEXTURE
+               for (u = 0; u < numTexUnits; u++) {
+                  const GLuint unit = texUnit[u];
+                  for (k = count; k < count + width; k++) {
+                     COPY_4V(span->array->texcoords[unit][k], texcoord[unit]);
+                  }
+               }
+#endif
 #if FLAGS & SPRITE
-            for (u = 0; u < ctx->Const.MaxTextureUnits; u++) {
-               if (ctx->Texture.Unit[u]._ReallyEnabled) {
-                  if (ctx->Point.CoordReplace[u]) {
-                     GLfloat s = 0.5F + (x + 0.5F - vert->win[0]) / size;
-                     GLfloat t, r;
-                     if (ctx->Point.SpriteOrigin == GL_LOWER_LEFT)
-                        t = 0.5F + (y + 0.5F - vert->win[1]) / size;
-                     else /* GL_UPPER_LEFT */
-                        t = 0.5F - (y + 0.5F - vert->win[1]) / size;
-                     if (ctx->Point.SpriteRMode == GL_ZERO)
-                        r = 0.0F;
-                     else if (ctx->Point.SpriteRMode == GL_S)
-                        r = vert->texcoord[u][0];
-                     else /* GL_R */
-                        r = vert->texcoord[u][2];
-                     span->array->texcoords[u][count][0] = s;
-                     span->array->texcoords[u][count][1] = t;
-                     span->array->texcoords[u][count][2] = r;
-                     span->array->texcoords[u][count][3] = 1.0F;
+               for (u = 0; u < numSpriteUnits; u++) {
+                  const GLuint unit = spriteUnit[u];
+                  GLfloat (*tc)[4] = span->array->texcoords[unit] + count;
+                  if (ctx->Point.CoordReplace[unit]) {
+                     for (k = 0; k < width; k++) {
+                        tc[k][0] = spriteS[k];
+                        tc[k][1] = t;
+                        tc[k][2] = spriteR[u];
+                        tc[k][3] = 1.0F;
+                     }
                   }
                   else {
-                     COPY_4V(span->array->texcoords[u][count], vert->texcoord[u]);
+                     for (k = 0; k < width; k++) {
+                        COPY_4V(tc[k], vert->texcoord[unit]);
+                     }
                   }
                }
-            }
 #endif /*SPRITE*/
 
-            count++;  /* square point */
+               count += width;  /* square point */
+            }
 
 #endif /*SMOOTH*/
 
-	 } /*for x*/
-      } /*for y*/
-      span->end = count;
-   }}
+         } /*for y*/
+         span->end = count;
+      }}
 
 #else /* LARGE | ATTENUATE | SMOOTH | SPRITE */
 
-   /***
-    *** Single-pixel points
-    ***/
-   {{
-      GLuint count;
+      /***
+       *** Single-pixel points
+       ***/
+      {{
+         const GLint x = (GLint) vert->win[0];
+         const GLint y = (GLint) vert->win[1];
+         GLuint count;
 
-      /* check if we need to flush */
-      if (span->end >= MAX_WIDTH ||
-          (swrast->_RasterMask & (BLEND_BIT | LOGIC_OP_BIT | MASKING_BIT))) {
+         /* check if we need to flush */
+         if (span->end >= MAX_WIDTH ||
+             (noOverlap && point_overlaps_span(swrast, x, y, x, y))) {
 #if FLAGS & RGBA
-         _swrast_write_rgba_span(ctx, span);
+            _swrast_write_rgba_span(ctx, span);
 #else
-         _swrast_write_index_span(ctx, span);
+            _swrast_write_index_span(ctx, span);
 #endif
-         span->end = 0;
-      }
+            span->end = 0;
+         }
+         if (noOverlap)
+            add_point_to_span(swrast, x, y, x, y);
 
-      count = span->end;
+         count = span->end;
 
 #if FLAGS & RGBA
-      span->array->rgba[count][RCOMP] = red;
-      span->array->rgba[count][GCOMP] = green;
-      span->array->rgba[count][BCOMP] = blue;
-      span->array->rgba[count][ACOMP] = alpha;
+         span->array->rgba[count][RCOMP] = red;
+         span->array->rgba[count][GCOMP] = green;
+         span->array->rgba[count][BCOMP] = blue;
+         span->array->rgba[count][ACOMP] = alpha;
 #endif
 #if FLAGS & SPECULAR
-      span->array->spec[count][RCOMP] = specRed;
-      span->array->spec[count][GCOMP] = specGreen;
-      span->array->spec[count][BCOMP] = specBlue;
+         span->array->spec[count][RCOMP] = specRed;
+         span->array->spec[count][GCOMP] = specGreen;
+         span->array->spec[count][BCOMP] = specBlue;
 #endif
 #if FLAGS & INDEX
-      span->array->index[count] = colorIndex;
+         span->array->index[count] = colorIndex;
 #endif
 #if FLAGS & TEXTURE
-      for (u = 0; u < ctx->Const.MaxTextureUnits; u++) {
-         if (ctx->Texture.Unit[u]._ReallyEnabled) {
-            COPY_4V(span->array->texcoords[u][count], texcoord[u]);
+         for (u = 0; u < numTexUnits; u++) {
+            COPY_4V(span->array->texcoords[texUnit[u]][count],
+                    texcoord[texUnit[u]]);
          }
-      }
 #endif
 
-      span->array->x[count] = (GLint) vert->win[0];
-      span->array->y[count] = (GLint) vert->win[1];
-      span->array->z[count] = (GLint) (vert->win[2] + 0.5F);
-      span->end = count + 1;
-   }}
+         span->array->x[count] = x;
+         span->array->y[count] = y;
+         span->array->z[count] = (GLint) (vert->win[2] + 0.5F);
+         span->array->fog[count] = vert->fog;
+         span->end = count + 1;
+      }}
 
 #endif /* LARGE || ATTENUATE || SMOOTH */
 
-   ASSERT(span->end <= MAX_WIDTH);
+      ASSERT(span->end <= MAX_WIDTH);
+   } /*for i*/
+}
+
+
+static void
+NAME ( GLcontext *ctx, const SWvertex *vert )
+{
+   BATCH_NAME(ctx, vert, NULL, 1);
 }
 
 
 #undef FLAGS
 #undef NAME
+#undef BATCH_NAME
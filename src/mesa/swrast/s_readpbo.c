@@ -0,0 +1,382 @@
+/*
+ * Mesa 3-D graphics library
+ * Version:  6.5
+ *
+ * Copyright (C) 1999-2006  Brian Paul   All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * BRIAN PAUL BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ * AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/*
+ * Asynchronous glReadPixels into pixel buffer objects.
+ *
+ * When enabled (see _swrast_allow_async_readpixels()) a glReadPixels
+ * into a PBO only copies the pixels out of the renderbuffer; converting
+ * them to the requested format and type and storing them into the
+ * buffer object is queued for a worker thread.  The application can
+ * render the next frame meanwhile.
+ *
+ * The buffer object functions below wait for the queued jobs which
+ * write into a buffer object before its contents can be seen or its
+ * storage changes: when it's mapped, read, written, reallocated,
+ * deleted, or bound for anything but packing.  One worker thread is
+ * shared by all contexts, since buffer objects may be shared; jobs are
+ * packed in submission order.
+ */
+
+
+#include "glheader.h"
+#include "bufferobj.h"
+#include "context.h"
+#include "imports.h"
+
+#include "s_context.h"
+#include "s_readpbo.h"
+
+
+#ifdef PTHREADS
+
+#include <pthread.h>
+
+/** Max number of jobs in the queue before glReadPixels waits */
+#define MAX_PACK_JOBS 4
+
+
+static pthread_mutex_t WorkerMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t Worker;
+static GLuint WorkerRefCount = 0;    /**< contexts using the worker */
+
+static pthread_mutex_t QueueMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t WorkCond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t DoneCond = PTHREAD_COND_INITIALIZER;
+static struct swrast_pack_job *QueueHead = NULL, *QueueTail = NULL;
+static struct swrast_pack_job *Running = NULL;
+static GLuint NumJobs = 0;           /**< queued and running jobs */
+static GLboolean Quit = GL_FALSE;
+
+/** Rows of the last finished job, kept for the next one */
+static GLchan *FreeRows = NULL;
+static GLuint FreeRowsSize = 0;
+
+
+static void *
+pack_worker( void *data )
+{
+   (void) data;
+
+   pthread_mutex_lock(&QueueMutex);
+   for (;;) {
+      struct swrast_pack_job *job;
+
+      while (!QueueHead && !Quit)
+         pthread_cond_wait(&WorkCond, &QueueMutex);
+      if (!QueueHead)
+         break;
+
+      job = QueueHead;
+      QueueHead = job->Next;
+      if (!QueueHead)
+         QueueTail = NULL;
+      Running = job;
+      pthread_mutex_unlock(&QueueMutex);
+
+      job->Pack(job);
+
+      pthread_mutex_lock(&QueueMutex);
+      Running = NULL;
+      NumJobs--;
+      if (job->RowsSize > FreeRowsSize) {
+         if (FreeRows)
+            FREE(FreeRows);
+         FreeRows = job->Rows;
+         FreeRowsSize = job->RowsSize;
+      }
+      else {
+         FREE(job->Rows);
+      }
+      FREE(job);
+      pthread_cond_broadcast(&DoneCond);
+   }
+   pthread_mutex_unlock(&QueueMutex);
+
+   return NULL;
+}
+
+
+/**
+ * Is a queued or running job from ctx, or writing into bufObj?
+ * Either may be NULL to match anything.
+ */
+static GLboolean
+jobs_pending( const GLcontext *ctx, const struct gl_buffer_object *bufObj )
+{
+   const struct swrast_pack_job *job;
+
+   if (Running && (!ctx || Running->ctx == ctx) &&
+       (!bufObj || Running->BufferObj == bufObj))
+      return GL_TRUE;
+
+   for (job = QueueHead; job; job = job->Next) {
+      if ((!ctx || job->ctx == ctx) && (!bufObj || job->BufferObj == bufObj))
+         return GL_TRUE;
+   }
+   return GL_FALSE;
+}
+
+
+static void
+wait_for_jobs( const GLcontext *ctx, const struct gl_buffer_object *bufObj )
+{
+   pthread_mutex_lock(&QueueMutex);
+   while (NumJobs > 0 && jobs_pending(ctx, bufObj))
+      pthread_cond_wait(&DoneCond, &QueueMutex);
+   pthread_mutex_unlock(&QueueMutex);
+}
+
+
+/**
+ * Make sure the worker thread is running, and keep it running until
+ * _swrast_stop_pack_worker() is called for this context.
+ * \return GL_FALSE if the thread couldn't be started.
+ */
+GLboolean
+_swrast_start_pack_worker( GLcontext *ctx )
+{
+   SWcontext *swrast = SWRAST_CONTEXT(ctx);
+
+   if (swrast->_PackWorkerRef)
+      return GL_TRUE;
+
+   pthread_mutex_lock(&WorkerMutex);
+   if (WorkerRefCount == 0 &&
+       pthread_create(&Worker, NULL, pack_worker, NULL) != 0) {
+      pthread_mutex_unlock(&WorkerMutex);
+      return GL_FALSE;
+   }
+   WorkerRefCount++;
+   swrast->_PackWorkerRef = GL_TRUE;
+   pthread_mutex_unlock(&WorkerMutex);
+
+   return GL_TRUE;
+}
+
+
+/**
+ * Wait for the context's jobs and let go of the worker thread.  The
+ * thread exits when no context uses it anymore.
+ */
+void
+_swrast_stop_pack_worker( GLcontext *ctx )
+{
+   SWcontext *swrast = SWRAST_CONTEXT(ctx);
+
+   if (!swrast->_PackWorkerRef)
+      return;
+
+   wait_for_jobs(ctx, NULL);
+
+   pthread_mutex_lock(&WorkerMutex);
+   swrast->_PackWorkerRef = GL_FALSE;
+   if (--WorkerRefCount == 0) {
+      pthread_mutex_lock(&QueueMutex);
+      Quit = GL_TRUE;
+      pthread_cond_broadcast(&WorkCond);
+      pthread_mutex_unlock(&QueueMutex);
+
+      pthread_join(Worker, NULL);
+
+      Quit = GL_FALSE;
+      if (FreeRows) {
+         FREE(FreeRows);
+         FreeRows = NULL;
+         FreeRowsSize = 0;
+      }
+   }
+   pthread_mutex_unlock(&WorkerMutex);
+}
+
+
+/**
+ * Allocate a job with room for rowsSize bytes of pixels.
+ */
+struct swrast_pack_job *
+_swrast_new_pack_job( GLuint rowsSize )
+{
+   struct swrast_pack_job *job = MALLOC_STRUCT(swrast_pack_job);
+
+   if (!job)
+      return NULL;
+
+   job->Rows = NULL;
+   pthread_mutex_lock(&QueueMutex);
+   if (FreeRows && FreeRowsSize >= rowsSize) {
+      job->Rows = FreeRows;
+      job->RowsSize = FreeRowsSize;
+      FreeRows = NULL;
+      FreeRowsSize = 0;
+   }
+   pthread_mutex_unlock(&QueueMutex);
+
+   if (!job->Rows) {
+      job->Rows = (GLchan *) MALLOC(rowsSize);
+      job->RowsSize = rowsSize;
+      if (!job->Rows) {
+         FREE(job);
+         return NULL;
+      }
+   }
+
+   return job;
+}
+
+
+/**
+ * Hand a job to the worker thread, which frees it when done.  Waits if
+ * too many jobs are queued already.
+ */
+void
+_swrast_queue_pack_job( struct swrast_pack_job *job )
+{
+   ASSERT(SWRAST_CONTEXT(job->ctx)->_PackWorkerRef);
+
+   job->Next = NULL;
+
+   pthread_mutex_lock(&QueueMutex);
+   while (NumJobs >= MAX_PACK_JOBS)
+      pthread_cond_wait(&DoneCond, &QueueMutex);
+   if (QueueTail)
+      QueueTail->Next = job;
+   else
+      QueueHead = job;
+   QueueTail = job;
+   NumJobs++;
+   pthread_cond_signal(&WorkCond);
+   pthread_mutex_unlock(&QueueMutex);
+}
+
+
+#else /* PTHREADS */
+
+
+/*
+ * No thread support: glReadPixels is always synchronous.
+ */
+
+static void
+wait_for_jobs( const GLcontext *ctx, const struct gl_buffer_object *bufObj )
+{
+   (void) ctx;
+   (void) bufObj;
+}
+
+GLboolean
+_swrast_start_pack_worker( GLcontext *ctx )
+{
+   (void) ctx;
+   return GL_FALSE;
+}
+
+void
+_swrast_stop_pack_worker( GLcontext *ctx )
+{
+   (void) ctx;
+}
+
+struct swrast_pack_job *
+_swrast_new_pack_job( GLuint rowsSize )
+{
+   (void) rowsSize;
+   return NULL;
+}
+
+void
+_swrast_queue_pack_job( struct swrast_pack_job *job )
+{
+   job->Pack(job);
+   FREE(job->Rows);
+   FREE(job);
+}
+
+
+#endif /* PTHREADS */
+
+
+
+/*
+ * Buffer object functions for ctx->Driver which wait for the buffer's
+ * pending glReadPixels before calling the core Mesa versions.
+ */
+
+
+void
+_swrast_BindBuffer( GLcontext *ctx, GLenum target,
+                    struct gl_buffer_object *obj )
+{
+   (void) ctx;
+   /* vertex arrays and unpacking read the buffer's memory directly */
+   if (target != GL_PIXEL_PACK_BUFFER_EXT)
+      wait_for_jobs(NULL, obj);
+}
+
+
+void
+_swrast_DeleteBuffer( GLcontext *ctx, struct gl_buffer_object *obj )
+{
+   wait_for_jobs(NULL, obj);
+   _mesa_delete_buffer_object(ctx, obj);
+}
+
+
+void
+_swrast_BufferData( GLcontext *ctx, GLenum target, GLsizeiptrARB size,
+                    const GLvoid *data, GLenum usage,
+                    struct gl_buffer_object *obj )
+{
+   wait_for_jobs(NULL, obj);
+   _mesa_buffer_data(ctx, target, size, data, usage, obj);
+}
+
+
+void
+_swrast_BufferSubData( GLcontext *ctx, GLenum target, GLintptrARB offset,
+                       GLsizeiptrARB size, const GLvoid *data,
+                       struct gl_buffer_object *obj )
+{
+   wait_for_jobs(NULL, obj);
+   _mesa_buffer_subdata(ctx, target, offset, size, data, obj);
+}
+
+
+void
+_swrast_GetBufferSubData( GLcontext *ctx, GLenum target, GLintptrARB offset,
+                          GLsizeiptrARB size, GLvoid *data,
+                          struct gl_buffer_object *obj )
+{
+   wait_for_jobs(NULL, obj);
+   _mesa_buffer_get_subdata(ctx, target, offset, size, data, obj);
+}
+
+
+void *
+_swrast_MapBuffer( GLcontext *ctx, GLenum target, GLenum access,
+                   struct gl_buffer_object *obj )
+{
+   wait_for_jobs(NULL, obj);
+   return _mesa_buffer_map(ctx, target, access, obj);
+}
@@ -0,0 +1,68 @@
+/*
+ * Mesa 3-D graphics library
+ * Version:  6.5
+ *
+ * Copyright (C) 1999-2006  Brian Paul   All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * BRIAN PAUL BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ * AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef S_READPBO_H
+#define S_READPBO_H
+
+
+#include "mtypes.h"
+#include "swrast.h"
+
+
+/**
+ * A glReadPixels into a pixel buffer object waiting to be packed.  Rows
+ * holds a copy of the pixels taken when glReadPixels was called; Pack()
+ * converts them into the buffer object's memory at Dest.
+ */
+struct swrast_pack_job {
+   struct swrast_pack_job *Next;
+   GLcontext *ctx;
+   struct gl_buffer_object *BufferObj;
+   void (*Pack)( const struct swrast_pack_job *job );
+
+   GLsizei Width, Height;
+   GLenum Format, Type;
+   struct gl_pixelstore_attrib Packing;
+   GLvoid *Dest;            /**< image address within BufferObj->Data */
+
+   GLchan *Rows;            /**< Width * Height RGBA pixels, bottom row first */
+   GLuint RowsSize;         /**< size of Rows in bytes */
+};
+
+
+extern GLboolean
+_swrast_start_pack_worker( GLcontext *ctx );
+
+extern void
+_swrast_stop_pack_worker( GLcontext *ctx );
+
+extern struct swrast_pack_job *
+_swrast_new_pack_job( GLuint rowsSize );
+
+extern void
+_swrast_queue_pack_job( struct swrast_pack_job *job );
+
+
+#endif
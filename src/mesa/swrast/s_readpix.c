@@ -36,8 +36,11 @@
 
 #include "s_context.h"
 #include "s_depth.h"
+#include "s_lazyclear.h"
+#include "s_readpbo.h"
 #include "s_span.h"
 #include "s_stencil.h"
+#include "x86/common_x86_sse2.h"
 
 
 
@@ -230,9 +233,207 @@ read_stencil_pixels( GLcontext *ctx,
 
 
 
+/*
+ * Row copy functions for the fast RGBA read paths.  They convert n
+ * RGBA GLchan pixels to the component order of the destination format.
+ */
+#if defined(USE_SSE2_INTRIN) && CHAN_BITS == 8
+#define USE_SSE2_READPIX
+#endif
+
+
+typedef void (*read_row_func)( GLuint n, const GLubyte *src, GLubyte *dst );
+
+
+static void
+read_row_rgba( GLuint n, const GLubyte *src, GLubyte *dst )
+{
+   MEMCPY(dst, src, 4 * sizeof(GLchan) * n);
+}
+
+
+#if CHAN_BITS == 8
+
+static void
+read_row_bgra( GLuint n, const GLubyte *src, GLubyte *dst )
+{
+   GLuint i;
+   for (i = 0; i < n; i++) {
+      const GLubyte r = src[0], b = src[2];
+      dst[0] = b;
+      dst[1] = src[1];
+      dst[2] = r;
+      dst[3] = src[3];
+      src += 4;
+      dst += 4;
+   }
+}
+
+
+static void
+read_row_rgb( GLuint n, const GLubyte *src, GLubyte *dst )
+{
+   GLuint i;
+   for (i = 0; i < n; i++) {
+      dst[0] = src[0];
+      dst[1] = src[1];
+      dst[2] = src[2];
+      src += 4;
+      dst += 3;
+   }
+}
+
+
+#ifdef USE_SSE2_READPIX
+
+/**
+ * Swap the R and B bytes of four pixels at a time.
+ */
+static SSE2_FUNC void
+read_row_bgra_sse2( GLuint n, const GLubyte *src, GLubyte *dst )
+{
+   const __m128i ga = _mm_set1_epi32(0xff00ff00);
+   const __m128i rb = _mm_set1_epi32(0x000000ff);
+   GLuint i;
+
+   for (i = 0; i + 4 <= n; i += 4) {
+      const __m128i p = _mm_loadu_si128((const __m128i *) (src + 4 * i));
+      const __m128i q = _mm_or_si128(_mm_and_si128(p, ga),
+                           _mm_or_si128(_mm_and_si128(_mm_srli_epi32(p, 16), rb),
+                                        _mm_slli_epi32(_mm_and_si128(p, rb), 16)));
+      _mm_storeu_si128((__m128i *) (dst + 4 * i), q);
+   }
+   read_row_bgra(n - i, src + 4 * i, dst + 4 * i);
+}
+
+
+/**
+ * Drop the A bytes of four pixels at a time.  Within each 64-bit lane
+ * the RGB bytes of the two pixels are joined, then the six bytes of the
+ * upper lane are moved down to follow those of the lower lane.
+ */
+static SSE2_FUNC void
+read_row_rgb_sse2( GLuint n, const GLubyte *src, GLubyte *dst )
+{
+   const __m128i lo = _mm_set_epi32(0, 0x00ffffff, 0, 0x00ffffff);
+   const __m128i hi = _mm_set_epi32(0x00ffffff, 0, 0x00ffffff, 0);
+   const __m128i first = _mm_set_epi32(0, 0, 0x0000ffff, 0xffffffff);
+   GLuint i;
+
+   for (i = 0; i + 4 <= n; i += 4) {
+      const __m128i p = _mm_loadu_si128((const __m128i *) (src + 4 * i));
+      const __m128i q = _mm_or_si128(_mm_and_si128(p, lo),
+                                     _mm_srli_epi64(_mm_and_si128(p, hi), 8));
+      const __m128i r = _mm_or_si128(_mm_and_si128(q, first),
+                                     _mm_andnot_si128(first,
+                                                      _mm_srli_si128(q, 2)));
+      GLuint last = (GLuint) _mm_cvtsi128_si32(_mm_srli_si128(r, 8));
+      _mm_storel_epi64((__m128i *) (dst + 3 * i), r);
+      MEMCPY(dst + 3 * i + 8, &last, 4);
+   }
+   read_row_rgb(n - i, src + 4 * i, dst + 3 * i);
+}
+
+#endif /* USE_SSE2_READPIX */
+
+#endif /* CHAN_BITS == 8 */
+
+
+/**
+ * Choose the row function storing RGBA GLchan pixels in the given
+ * format and type, or return NULL if there's none.
+ */
+static read_row_func
+choose_read_row_func( GLenum format, GLenum type, GLboolean swapBytes )
+{
+#if CHAN_BITS == 16
+   if (format == GL_RGBA && type == GL_UNSIGNED_SHORT && !swapBytes)
+      return read_row_rgba;
+#elif CHAN_BITS == 8
+   const GLuint ui = 1;
+   const GLubyte littleEndian = *((const GLubyte *) &ui);
+#ifdef USE_SSE2_READPIX
+   const GLboolean sse2 = _mesa_have_sse2();
+#endif
+
+   if (type == GL_UNSIGNED_INT_8_8_8_8_REV) {
+      /* the components are in the same order as with GL_UNSIGNED_BYTE */
+      if (!littleEndian || swapBytes)
+         return NULL;
+   }
+   else if (type != GL_UNSIGNED_BYTE) {
+      return NULL;
+   }
+
+   switch (format) {
+   case GL_RGBA:
+      return read_row_rgba;
+   case GL_BGRA:
+#ifdef USE_SSE2_READPIX
+      if (sse2)
+         return read_row_bgra_sse2;
+#endif
+      return read_row_bgra;
+   case GL_RGB:
+      if (type != GL_UNSIGNED_BYTE)
+         return NULL;
+#ifdef USE_SSE2_READPIX
+      if (sse2)
+         return read_row_rgb_sse2;
+#endif
+      return read_row_rgb;
+   default:
+      ;
+   }
+   (void) sse2;
+#endif
+   return NULL;
+}
+
+
+/**
+ * Read a rectangle of color buffer rb (already clipped to the buffer)
+ * with the given row function.  Buffers with RGBA GLubyte pixels in
+ * memory are read from in place, others a row at a time with GetRow.
+ * \param dst  where the bottom row goes
+ * \param dstStride  bytes from one row of dst to the next (may be < 0)
+ */
+static void
+read_rgba_rows( GLcontext *ctx, struct gl_renderbuffer *rb,
+                GLint x, GLint y, GLsizei width, GLsizei height,
+                read_row_func readRow, GLubyte *dst, GLint dstStride )
+{
+   const GLboolean direct = (rb->Wrapped == rb &&
+                             rb->_BaseFormat == GL_RGBA &&
+                             rb->DataType == CHAN_TYPE &&
+                             rb->GetPointer(ctx, rb, x, y) != NULL);
+   GLint row;
+
+   ASSERT(rb->GetRow);
+   for (row = 0; row < height; row++) {
+      if (direct) {
+         const GLubyte *src
+            = (const GLubyte *) rb->GetPointer(ctx, rb, x, y + row);
+         readRow(width, src, dst);
+      }
+      else if (readRow == read_row_rgba) {
+         rb->GetRow(ctx, rb, width, x, y + row, dst);
+      }
+      else {
+         GLchan rgba[MAX_WIDTH][4];
+         rb->GetRow(ctx, rb, width, x, y + row, rgba);
+         readRow(width, (const GLubyte *) rgba, dst);
+      }
+      dst += dstStride;
+   }
+}
+
+
 /**
  * Optimized glReadPixels for particular pixel formats:
- *   GL_UNSIGNED_BYTE, GL_RGBA
+ *   GL_RGBA, GL_BGRA or GL_RGB and GL_UNSIGNED_BYTE,
+ *   GL_RGBA or GL_BGRA and GL_UNSIGNED_INT_8_8_8_8_REV
+ * (GL_RGBA and GL_UNSIGNED_SHORT with 16-bit channels)
  * when pixel scaling, biasing and mapping are disabled.
  */
 static GLboolean
@@ -244,65 +445,30 @@ read_fast_rgba_pixels( GLcontext *ctx,
                        const struct gl_pixelstore_attrib *packing )
 {
    struct gl_renderbuffer *rb = ctx->ReadBuffer->_ColorReadBuffer;
+   read_row_func readRow;
+   GLubyte *dst;
+   GLint dstStride;
+
    /* can't do scale, bias, mapping, etc */
    if (ctx->_ImageTransferState)
        return GL_FALSE;
 
-   /* can't do fancy pixel packing */
-   if (packing->Alignment != 1 || packing->SwapBytes || packing->LsbFirst)
+   if (!ctx->Visual.rgbMode || width > MAX_WIDTH)
       return GL_FALSE;
 
-   {
-      GLint srcX = x;
-      GLint srcY = y;
-      GLint readWidth = width;           /* actual width read */
-      GLint readHeight = height;         /* actual height read */
-      GLint skipPixels = packing->SkipPixels;
-      GLint skipRows = packing->SkipRows;
-      GLint rowLength;
-
-      if (packing->RowLength > 0)
-         rowLength = packing->RowLength;
-      else
-         rowLength = width;
-
-      /*
-       * Ready to read!
-       * The window region at (destX, destY) of size (readWidth, readHeight)
-       * will be read back.
-       * We'll write pixel data to buffer pointed to by "pixels" but we'll
-       * skip "skipRows" rows and skip "skipPixels" pixels/row.
-       */
-#if CHAN_BITS == 8
-      if (format == GL_RGBA && type == GL_UNSIGNED_BYTE) {
-#elif CHAN_BITS == 16
-      if (format == GL_RGBA && type == GL_UNSIGNED_SHORT) {
-#else
-      if (0) {
-#endif
-         GLchan *dest = (GLchan *) pixels
-                      + (skipRows * rowLength + skipPixels) * 4;
-         GLint row;
-
-         if (packing->Invert) {
-            /* start at top and go down */
-            dest += (readHeight - 1) * rowLength * 4;
-            rowLength = -rowLength;
-         }
+   readRow = choose_read_row_func(format, type, packing->SwapBytes);
+   if (!readRow)
+      return GL_FALSE;
 
-         ASSERT(rb->GetRow);
-         for (row=0; row<readHeight; row++) {
-            rb->GetRow(ctx, rb, readWidth, srcX, srcY, dest);
-            dest += rowLength * 4;
-            srcY++;
-         }
-         return GL_TRUE;
-      }
-      else {
-         /* can't do this format/type combination */
-         return GL_FALSE;
-      }
-   }
+   /* the packing takes care of the skipped pixels and rows, the row
+    * length, the alignment and the row order
+    */
+   dst = (GLubyte *) _mesa_image_address2d(packing, pixels, width, height,
+                                           format, type, 0, 0);
+   dstStride = _mesa_image_row_stride(packing, width, format, type);
+
+   read_rgba_rows(ctx, rb, x, y, width, height, readRow, dst, dstStride);
+   return GL_TRUE;
 }
 
 
@@ -491,6 +657,165 @@ read_rgba_pixels( GLcontext *ctx,
 }
 
 
+/**
+ * Is bufObj bound for anything which reads its memory without going
+ * through ctx->Driver, i.e. vertex arrays or unpacking?
+ */
+static GLboolean
+buffer_bound_for_reading( const GLcontext *ctx,
+                          const struct gl_buffer_object *bufObj )
+{
+   const struct gl_array_attrib *array = &ctx->Array;
+   GLuint i;
+
+   if (array->ArrayBufferObj == bufObj ||
+       array->ElementArrayBufferObj == bufObj ||
+       ctx->Unpack.BufferObj == bufObj)
+      return GL_TRUE;
+
+   if (array->Vertex.BufferObj == bufObj ||
+       array->Normal.BufferObj == bufObj ||
+       array->Color.BufferObj == bufObj ||
+       array->SecondaryColor.BufferObj == bufObj ||
+       array->FogCoord.BufferObj == bufObj ||
+       array->Index.BufferObj == bufObj ||
+       array->EdgeFlag.BufferObj == bufObj)
+      return GL_TRUE;
+   for (i = 0; i < MAX_TEXTURE_COORD_UNITS; i++) {
+      if (array->TexCoord[i].BufferObj == bufObj)
+         return GL_TRUE;
+   }
+   for (i = 0; i < VERT_ATTRIB_MAX; i++) {
+      if (array->VertexAttrib[i].BufferObj == bufObj)
+         return GL_TRUE;
+   }
+
+   return GL_FALSE;
+}
+
+
+/**
+ * Called by the worker thread to pack the pixels saved by
+ * read_rgba_pixels_async() into the buffer object.  Same conversions
+ * as read_fast_rgba_pixels() and read_rgba_pixels() without transfer
+ * operations.
+ */
+static void
+pack_rgba_job( const struct swrast_pack_job *job )
+{
+   GLcontext *ctx = job->ctx;
+   const GLsizei width = job->Width, height = job->Height;
+   const read_row_func readRow
+      = choose_read_row_func(job->Format, job->Type, job->Packing.SwapBytes);
+   const GLboolean requantize = (ctx->Visual.redBits < CHAN_BITS ||
+                                 ctx->Visual.greenBits < CHAN_BITS ||
+                                 ctx->Visual.blueBits < CHAN_BITS);
+   GLint row;
+
+   for (row = 0; row < height; row++) {
+      const GLchan (*rgba)[4]
+         = (const GLchan (*)[4]) (job->Rows + row * width * 4);
+      GLvoid *dst = _mesa_image_address2d(&job->Packing, job->Dest,
+                                          width, height,
+                                          job->Format, job->Type, row, 0);
+      if (readRow) {
+         readRow(width, (const GLubyte *) rgba, (GLubyte *) dst);
+      }
+      else if (requantize) {
+         DEFMARRAY(GLfloat, rgbaf, MAX_WIDTH, 4);  /* mac 32k limitation */
+         CHECKARRAY(rgbaf, return);  /* mac 32k limitation */
+         _mesa_chan_to_float_span(ctx, width, rgba, rgbaf);
+         _mesa_pack_rgba_span_float(ctx, width, (CONST GLfloat (*)[4]) rgbaf,
+                                    job->Format, job->Type, dst,
+                                    &job->Packing, 0);
+         UNDEFARRAY(rgbaf);  /* mac 32k limitation */
+      }
+      else {
+         _mesa_pack_rgba_span_chan(ctx, width, rgba, job->Format, job->Type,
+                                   dst, &job->Packing, 0);
+      }
+   }
+}
+
+
+/**
+ * glReadPixels into a pixel buffer object, packed by a worker thread
+ * (see s_readpbo.c).  The pixels are copied out of the read buffer now
+ * so that rendering may go on; converting and storing them into the
+ * buffer object happens in the background.
+ * \return GL_FALSE if the pixels have to be read synchronously.
+ */
+static GLboolean
+read_rgba_pixels_async( GLcontext *ctx,
+                        GLint x, GLint y,
+                        GLsizei width, GLsizei height,
+                        GLenum format, GLenum type, GLvoid *pixels,
+                        const struct gl_pixelstore_attrib *packing )
+{
+   SWcontext *swrast = SWRAST_CONTEXT(ctx);
+   struct gl_renderbuffer *rb = ctx->ReadBuffer->_ColorReadBuffer;
+   struct swrast_pack_job *job;
+
+   if (!swrast->AllowAsyncReadPixels || !rb || !ctx->Visual.rgbMode ||
+       ctx->_ImageTransferState || width > MAX_WIDTH)
+      return GL_FALSE;
+
+   /* luminance depends on the color clamping state when packing */
+   switch (format) {
+      case GL_RED:
+      case GL_GREEN:
+      case GL_BLUE:
+      case GL_ALPHA:
+      case GL_RGB:
+      case GL_RGBA:
+      case GL_BGR:
+      case GL_BGRA:
+      case GL_ABGR_EXT:
+         break;
+      default:
+         return GL_FALSE;
+   }
+
+   /* let read_rgba_pixels() report bad types */
+   if (type == GL_HALF_FLOAT_ARB ||
+       !_mesa_is_legal_format_and_type(ctx, format, type))
+      return GL_FALSE;
+
+   /* copying the pixels out of the renderbuffer is all there is to do */
+   if (choose_read_row_func(format, type, packing->SwapBytes)
+       == read_row_rgba)
+      return GL_FALSE;
+
+   if (buffer_bound_for_reading(ctx, packing->BufferObj) ||
+       !_swrast_start_pack_worker(ctx))
+      return GL_FALSE;
+
+   job = _swrast_new_pack_job(width * height * 4 * sizeof(GLchan));
+   if (!job)
+      return GL_FALSE;
+
+   _swrast_use_read_buffer(ctx);
+   RENDER_START(swrast, ctx);
+   read_rgba_rows(ctx, rb, x, y, width, height, read_row_rgba,
+                  (GLubyte *) job->Rows, width * 4 * sizeof(GLchan));
+   RENDER_FINISH(swrast, ctx);
+   _swrast_use_draw_buffer(ctx);
+
+   job->ctx = ctx;
+   job->BufferObj = packing->BufferObj;
+   job->Pack = pack_rgba_job;
+   job->Width = width;
+   job->Height = height;
+   job->Format = format;
+   job->Type = type;
+   job->Packing = *packing;
+   job->Dest = ADD_POINTERS(packing->BufferObj->Data, pixels);
+
+   _swrast_queue_pack_job(job);
+   return GL_TRUE;
+}
+
+
 /**
  * Software fallback routine for ctx->Driver.ReadPixels().
  * We wind up using the swrast->ReadSpan() routines to do the job.
@@ -504,6 +829,7 @@ _swrast_ReadPixels( GLcontext *ctx,
 {
    SWcontext *swrast = SWRAST_CONTEXT(ctx);
    struct gl_pixelstore_attrib clippedPacking;
+   struct gl_renderbuffer *rb;
 
    if (swrast->NewState)
       _swrast_validate_derived( ctx );
@@ -520,6 +846,15 @@ _swrast_ReadPixels( GLcontext *ctx,
       return;
    }
 
+   /* fill lazily cleared tiles of the region first */
+   if (format == GL_DEPTH_COMPONENT)
+      rb = ctx->ReadBuffer->Attachment[BUFFER_DEPTH].Renderbuffer;
+   else if (format == GL_STENCIL_INDEX)
+      rb = ctx->ReadBuffer->Attachment[BUFFER_STENCIL].Renderbuffer;
+   else
+      rb = ctx->ReadBuffer->_ColorReadBuffer;
+   _swrast_resolve_lazy_clear(ctx, rb, x, y, width, height);
+
    if (clippedPacking.BufferObj->Name) {
       /* pack into PBO */
       GLubyte *buf;
@@ -529,6 +864,11 @@ _swrast_ReadPixels( GLcontext *ctx,
                      "glReadPixels(invalid PBO access)");
          return;
       }
+      if (!clippedPacking.BufferObj->Pointer &&
+          read_rgba_pixels_async(ctx, x, y, width, height, format, type,
+                                 pixels, &clippedPacking)) {
+         return;
+      }
       buf = (GLubyte *) ctx->Driver.MapBuffer(ctx, GL_PIXEL_PACK_BUFFER_EXT,
                                               GL_WRITE_ONLY_ARB,
                                               clippedPacking.BufferObj);
@@ -582,3 +922,64 @@ _swrast_ReadPixels( GLcontext *ctx,
                               clippedPacking.BufferObj);
    }
 }
+
+
+/**
+ * Read a rectangle of the color read buffer straight into the caller's
+ * memory, ignoring the pixel store and transfer state.  Only the formats
+ * and types of read_fast_rgba_pixels() are supported.  For
+ * OSMesaReadPixels().
+ * \param stride  bytes from one row of pixels to the next; pixels is
+ *                where the bottom row goes, a negative stride stores
+ *                the rows top-down
+ * \return GL_FALSE if the format, type or read buffer isn't supported
+ */
+GLboolean
+_swrast_read_rgba_pixels( GLcontext *ctx,
+                          GLint x, GLint y, GLsizei width, GLsizei height,
+                          GLenum format, GLenum type, GLint stride,
+                          GLvoid *pixels )
+{
+   SWcontext *swrast = SWRAST_CONTEXT(ctx);
+   struct gl_renderbuffer *rb = ctx->ReadBuffer->_ColorReadBuffer;
+   const GLint bpp = _mesa_bytes_per_pixel(format, type);
+   GLubyte *dst = (GLubyte *) pixels;
+   read_row_func readRow;
+
+   if (swrast->NewState)
+      _swrast_validate_derived( ctx );
+
+   readRow = choose_read_row_func(format, type, GL_FALSE);
+   if (!rb || !readRow || !ctx->Visual.rgbMode)
+      return GL_FALSE;
+
+   /* clip to the read buffer */
+   if (x < 0) {
+      dst -= x * bpp;
+      width += x;
+      x = 0;
+   }
+   if (y < 0) {
+      dst -= y * stride;
+      height += y;
+      y = 0;
+   }
+   if (x + width > (GLint) ctx->ReadBuffer->Width)
+      width = ctx->ReadBuffer->Width - x;
+   if (y + height > (GLint) ctx->ReadBuffer->Height)
+      height = ctx->ReadBuffer->Height - y;
+   if (width <= 0 || height <= 0)
+      return GL_TRUE;
+   if (width > MAX_WIDTH)
+      return GL_FALSE;
+
+   _swrast_resolve_lazy_clear(ctx, rb, x, y, width, height);
+
+   RENDER_START(swrast, ctx);
+   _swrast_use_read_buffer(ctx);
+   read_rgba_rows(ctx, rb, x, y, width, height, readRow, dst, stride);
+   _swrast_use_draw_buffer(ctx);
+   RENDER_FINISH(swrast, ctx);
+
+   return GL_TRUE;
+}
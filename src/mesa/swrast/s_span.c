@@ -42,6 +42,7 @@
 #include "s_context.h"
 #include "s_depth.h"
 #include "s_fog.h"
+#include "s_lazyclear.h"
 #include "s_logic.h"
 #include "s_masking.h"
 #include "s_nvfragprog.h"
@@ -802,6 +803,11 @@ _swrast_write_index_span( GLcontext *ctx, struct sw_span *span)
       }
    }
 
+   /* Fill lazily cleared tiles before touching them */
+   if (!swrast->_BinRunning && _swrast_lazy_clear_draw_pending(ctx)) {
+      _swrast_resolve_lazy_clear_span(ctx, span);
+   }
+
    /* Depth bounds test */
    if (ctx->Depth.BoundsTest && ctx->Visual.depthBits > 0) {
       if (!_swrast_depth_bounds_test(ctx, span)) {
@@ -1093,6 +1099,479 @@ multi_write_rgba_span( GLcontext *ctx, struct sw_span *span )
 }
 
 
+/**
+ * Compute the fragment colors of an RGBA span: interpolate the colors,
+ * texcoords and fog values, then run the fragment program or apply the
+ * enabled textures.
+ */
+static void
+shade_rgba_span( GLcontext *ctx, struct sw_span *span )
+{
+   /* Interpolate texcoords? */
+   if (ctx->Texture._EnabledCoordUnits
+       && (span->interpMask & SPAN_TEXTURE)
+       && (span->arrayMask & SPAN_TEXTURE) == 0) {
+      interpolate_texcoords(ctx, span);
+   }
+
+   /* Now we need the rgba array, fill it in if needed */
+   if ((span->interpMask & SPAN_RGBA) && (span->arrayMask & SPAN_RGBA) == 0)
+      interpolate_colors(ctx, span);
+
+   if (span->interpMask & SPAN_SPEC)
+      interpolate_specular(ctx, span);
+
+   if (span->interpMask & SPAN_FOG)
+      interpolate_fog(ctx, span);
+
+   /* Compute fragment colors with fragment program or texture lookups */
+   if (ctx->FragmentProgram._Active) {
+      /* frag prog may need Z values */
+      if (span->interpMask & SPAN_Z)
+         _swrast_span_interpolate_z(ctx, span);
+      _swrast_exec_fragment_program( ctx, span );
+   }
+   else if (ctx->ATIFragmentShader._Enabled)
+      _swrast_exec_fragment_shader( ctx, span );
+   else if (ctx->Texture._EnabledUnits && (span->arrayMask & SPAN_TEXTURE))
+      _swrast_texture_span( ctx, span );
+}
+
+
+/**
+ * Remove the fragments which were killed by the depth/stencil test from
+ * both ends of a horizontal span, so that they don't get shaded.  The
+ * span's x, end and interpolation start values are advanced, and the
+ * arrays which were already computed are shifted down to match.
+ * \return number of fragments removed
+ */
+static GLuint
+trim_span( GLcontext *ctx, struct sw_span *span )
+{
+   struct span_arrays *array = span->array;
+   const GLubyte *mask = array->mask;
+   GLuint first = 0, last = span->end;
+   GLuint n, i, u;
+
+   if (span->arrayMask & SPAN_XY)
+      return 0;
+
+   while (first < last && !mask[first])
+      first++;
+   while (last > first && !mask[last - 1])
+      last--;
+
+   n = last - first;
+   if (n == 0 || n == span->end)
+      return 0;
+
+   if (first > 0) {
+      const GLint k = (GLint) first;
+
+      /* shift the arrays down (dst < src so copy forward) */
+      for (i = 0; i < n; i++)
+         array->mask[i] = array->mask[i + first];
+      if (span->arrayMask & SPAN_RGBA) {
+         for (i = 0; i < n; i++)
+            COPY_CHAN4(array->rgba[i], array->rgba[i + first]);
+      }
+      if (span->arrayMask & SPAN_SPEC) {
+         for (i = 0; i < n; i++)
+            COPY_CHAN4(array->spec[i], array->spec[i + first]);
+      }
+      if (span->arrayMask & SPAN_Z) {
+         for (i = 0; i < n; i++)
+            array->z[i] = array->z[i + first];
+      }
+      if (span->arrayMask & SPAN_FOG) {
+         for (i = 0; i < n; i++)
+            array->fog[i] = array->fog[i + first];
+      }
+      if (span->arrayMask & SPAN_COVERAGE) {
+         for (i = 0; i < n; i++)
+            array->coverage[i] = array->coverage[i + first];
+      }
+      if (span->arrayMask & (SPAN_TEXTURE | SPAN_LAMBDA)) {
+         for (u = 0; u < ctx->Const.MaxTextureCoordUnits; u++) {
+            if (!(ctx->Texture._EnabledCoordUnits & (1 << u)))
+               continue;
+            if (span->arrayMask & SPAN_TEXTURE) {
+               for (i = 0; i < n; i++)
+                  COPY_4V(array->texcoords[u][i],
+                          array->texcoords[u][i + first]);
+            }
+            if (span->arrayMask & SPAN_LAMBDA) {
+               for (i = 0; i < n; i++)
+                  array->lambda[u][i] = array->lambda[u][i + first];
+            }
+         }
+      }
+
+      /* advance the interpolants which haven't been expanded yet */
+      if ((span->interpMask & SPAN_RGBA) && !(span->arrayMask & SPAN_RGBA)) {
+         span->red += span->redStep * k;
+         span->green += span->greenStep * k;
+         span->blue += span->blueStep * k;
+         span->alpha += span->alphaStep * k;
+      }
+      if ((span->interpMask & SPAN_SPEC) && !(span->arrayMask & SPAN_SPEC)) {
+         span->specRed += span->specRedStep * k;
+         span->specGreen += span->specGreenStep * k;
+         span->specBlue += span->specBlueStep * k;
+      }
+      if ((span->interpMask & SPAN_Z) && !(span->arrayMask & SPAN_Z))
+         span->z += span->zStep * k;
+      /* The float interpolants are stepped one fragment at a time, the
+       * same way the interpolation loops accumulate them, so that the
+       * surviving fragments get bit-identical values.
+       */
+      for (i = 0; i < first; i++) {
+         if ((span->interpMask & SPAN_FOG) && !(span->arrayMask & SPAN_FOG))
+            span->fog += span->fogStep;
+         if (span->interpMask & SPAN_W)
+            span->w += span->dwdx;
+         if ((span->interpMask & SPAN_TEXTURE)
+             && !(span->arrayMask & SPAN_TEXTURE)) {
+            for (u = 0; u < ctx->Const.MaxTextureCoordUnits; u++) {
+               if (!(ctx->Texture._EnabledCoordUnits & (1 << u)))
+                  continue;
+               span->tex[u][0] += span->texStepX[u][0];
+               span->tex[u][1] += span->texStepX[u][1];
+               span->tex[u][2] += span->texStepX[u][2];
+               span->tex[u][3] += span->texStepX[u][3];
+            }
+         }
+      }
+      if (span->interpMask & SPAN_INT_TEXTURE) {
+         span->intTex[0] += span->intTexStep[0] * k;
+         span->intTex[1] += span->intTexStep[1] * k;
+      }
+
+      span->x += k;
+   }
+
+   i = span->end - n;
+   span->end = n;
+   return i;
+}
+
+
+/**
+ * Add the specular color, fog and antialiasing coverage to the shaded
+ * fragment colors.
+ */
+static void
+finish_rgba_span( GLcontext *ctx, struct sw_span *span )
+{
+   SWcontext *swrast = SWRAST_CONTEXT(ctx);
+
+   ASSERT(span->arrayMask & SPAN_RGBA);
+
+   if (!ctx->FragmentProgram._Enabled) {
+      /* Add base and specular colors */
+      if (ctx->Fog.ColorSumEnabled ||
+          (ctx->Light.Enabled &&
+           ctx->Light.Model.ColorControl == GL_SEPARATE_SPECULAR_COLOR)) {
+         if (span->interpMask & SPAN_SPEC) {
+            interpolate_specular(ctx, span);
+         }
+         if (span->arrayMask & SPAN_SPEC) {
+            add_colors( span->end, span->array->rgba, span->array->spec );
+         }
+         else {
+            /* We probably added the base/specular colors during the
+             * vertex stage!
+             */
+         }
+      }
+   }
+
+   /* Fog */
+   if (swrast->_FogEnabled) {
+      _swrast_fog_rgba_span(ctx, span);
+   }
+
+   /* Antialias coverage application */
+   if (span->arrayMask & SPAN_COVERAGE) {
+      GLchan (*rgba)[4] = span->array->rgba;
+      GLfloat *coverage = span->array->coverage;
+      GLuint i;
+      for (i = 0; i < span->end; i++) {
+         rgba[i][ACOMP] = (GLchan) (rgba[i][ACOMP] * coverage[i]);
+      }
+   }
+}
+
+
+/**
+ * Blend, logic op and mask the span's colors and write them to the
+ * current color draw buffer(s).
+ */
+static void
+put_rgba_span( GLcontext *ctx, struct sw_span *span )
+{
+   const GLuint colorMask = *((GLuint *) ctx->Color.ColorMask);
+   SWcontext *swrast = SWRAST_CONTEXT(ctx);
+
+   if (swrast->_RasterMask & MULTI_DRAW_BIT) {
+      /* need to do blend/logicop separately for each color buffer */
+      multi_write_rgba_span(ctx, span);
+   }
+   else {
+      /* normal: write to exactly one buffer */
+      struct gl_renderbuffer *rb = ctx->DrawBuffer->_ColorDrawBuffers[0][0];
+
+      if (ctx->Color._LogicOpEnabled) {
+         _swrast_logicop_rgba_span(ctx, rb, span, span->array->rgba);
+      }
+      else if (ctx->Color.BlendEnabled) {
+         _swrast_blend_span(ctx, rb, span, span->array->rgba);
+      }
+
+      /* Color component masking */
+      if (colorMask != 0xffffffff) {
+         _swrast_mask_rgba_span(ctx, rb, span, span->array->rgba);
+      }
+
+      /* Finally, write the pixels to a color buffer */
+      if (span->arrayMask & SPAN_XY) {
+         /* array of pixel coords */
+         ASSERT(rb->PutValues);
+         ASSERT(rb->_BaseFormat == GL_RGB || rb->_BaseFormat == GL_RGBA);
+         /* XXX check datatype */
+         rb->PutValues(ctx, rb, span->end, span->array->x, span->array->y,
+                       span->array->rgba, span->array->mask);
+      }
+      else {
+         /* horizontal run of pixels */
+         ASSERT(rb->PutRow);
+         ASSERT(rb->_BaseFormat == GL_RGB || rb->_BaseFormat == GL_RGBA);
+         /* XXX check datatype */
+         rb->PutRow(ctx, rb, span->end, span->x, span->y, span->array->rgba,
+                    span->writeAll ? NULL : span->array->mask);
+      }
+   }
+}
+
+
+/**
+ * The draw buffer's attachments while the buffers of one sample of a
+ * multisample framebuffer are bound in their place.
+ */
+struct sample_binding {
+   struct gl_renderbuffer *Color[MAX_DRAW_BUFFERS][4];
+   struct gl_renderbuffer *Depth, *Stencil;
+};
+
+
+/**
+ * Multisample framebuffers have a wrapper renderbuffer holding one
+ * renderbuffer per sample in each color, depth and stencil attachment
+ * (see _mesa_add_multisample_renderbuffers()).  Point the draw buffer at
+ * the renderbuffers of the given sample so that the depth, stencil and
+ * color functions work on them like on ordinary buffers, saving the
+ * wrappers in b.
+ */
+static void
+bind_sample( GLcontext *ctx, struct sample_binding *b, GLuint sample )
+{
+   struct gl_framebuffer *fb = ctx->DrawBuffer;
+   GLuint output, i;
+
+   for (output = 0; output < ctx->Const.MaxDrawBuffers; output++) {
+      for (i = 0; i < fb->_NumColorDrawBuffers[output]; i++) {
+         struct gl_renderbuffer *rb = fb->_ColorDrawBuffers[output][i];
+         b->Color[output][i] = rb;
+         if (rb->NumSamples)
+            fb->_ColorDrawBuffers[output][i] = rb->Samples[sample];
+      }
+   }
+
+   b->Depth = fb->Attachment[BUFFER_DEPTH].Renderbuffer;
+   if (b->Depth && b->Depth->NumSamples)
+      fb->Attachment[BUFFER_DEPTH].Renderbuffer = b->Depth->Samples[sample];
+
+   b->Stencil = fb->Attachment[BUFFER_STENCIL].Renderbuffer;
+   if (b->Stencil && b->Stencil->NumSamples)
+      fb->Attachment[BUFFER_STENCIL].Renderbuffer = b->Stencil->Samples[sample];
+}
+
+
+/**
+ * Put back the wrappers saved by bind_sample().
+ */
+static void
+unbind_sample( GLcontext *ctx, const struct sample_binding *b )
+{
+   struct gl_framebuffer *fb = ctx->DrawBuffer;
+   GLuint output, i;
+
+   for (output = 0; output < ctx->Const.MaxDrawBuffers; output++) {
+      for (i = 0; i < fb->_NumColorDrawBuffers[output]; i++)
+         fb->_ColorDrawBuffers[output][i] = b->Color[output][i];
+   }
+   fb->Attachment[BUFFER_DEPTH].Renderbuffer = b->Depth;
+   fb->Attachment[BUFFER_STENCIL].Renderbuffer = b->Stencil;
+}
+
+
+/**
+ * Apply GL_SAMPLE_ALPHA_TO_COVERAGE, GL_SAMPLE_ALPHA_TO_ONE and
+ * GL_SAMPLE_COVERAGE to the span's sample masks.
+ */
+static void
+sample_coverage_span( GLcontext *ctx, struct sw_span *span,
+                      GLuint numSamples )
+{
+   GLchan (*rgba)[4] = span->array->rgba;
+   GLubyte *samples = span->array->samples;
+   const GLuint n = span->end;
+   GLuint i;
+
+   if (ctx->Multisample.SampleAlphaToCoverage) {
+      for (i = 0; i < n; i++) {
+         GLint k = IROUND(CHAN_TO_FLOAT(rgba[i][ACOMP]) * numSamples);
+         k = CLAMP(k, 0, (GLint) numSamples);
+         samples[i] &= (GLubyte) ((1 << k) - 1);
+      }
+   }
+
+   if (ctx->Multisample.SampleAlphaToOne) {
+      for (i = 0; i < n; i++)
+         rgba[i][ACOMP] = CHAN_MAX;
+   }
+
+   if (ctx->Multisample.SampleCoverage) {
+      const GLint k = IROUND(ctx->Multisample.SampleCoverageValue * numSamples);
+      GLubyte bits = (GLubyte) ((1 << k) - 1);
+      if (ctx->Multisample.SampleCoverageInvert)
+         bits = ~bits;
+      for (i = 0; i < n; i++)
+         samples[i] &= bits;
+   }
+}
+
+
+/**
+ * The rest of _swrast_write_rgba_span() for multisample framebuffers.
+ * The fragments have been shaded once; the stencil and depth tests and
+ * the color writes are done once per sample, each time only for the
+ * fragments which cover the sample.  Polygon spans carry their coverage
+ * in span_arrays::samples (SPAN_SAMPLES) and the Z offsets of the sample
+ * positions in sw_span::sampleZ; other fragments cover all samples.
+ */
+static void
+multisample_write_rgba_span( GLcontext *ctx, struct sw_span *span )
+{
+   SWcontext *swrast = SWRAST_CONTEXT(ctx);
+   const GLuint colorMask = *((GLuint *) ctx->Color.ColorMask);
+   const GLuint numSamples = swrast->_NumSamples;
+   const GLuint n = span->end;
+   const GLboolean zTest = ctx->Stencil.Enabled || ctx->Depth.Test;
+   /* do the color stages modify span->array->rgba? */
+   const GLboolean keepColors = (swrast->_RasterMask & MULTI_DRAW_BIT) == 0 &&
+      (ctx->Color._LogicOpEnabled || ctx->Color.BlendEnabled ||
+       colorMask != 0xffffffff);
+   const GLuint depthMax = ctx->DrawBuffer->_DepthMax;
+   GLubyte *samples = span->array->samples;
+   struct sample_binding binding;
+   GLubyte mask[MAX_WIDTH];
+   GLdepth z[MAX_WIDTH];
+   GLchan rgba[MAX_WIDTH][4];
+   GLuint s, i;
+
+   ASSERT(numSamples <= MAX_SAMPLES);
+
+   finish_rgba_span(ctx, span);
+
+   if (!(span->arrayMask & SPAN_SAMPLES))
+      _mesa_memset(samples, 0xff, n);
+   if (ctx->Multisample.Enabled)
+      sample_coverage_span(ctx, span, numSamples);
+
+   if (zTest) {
+      if (span->interpMask & SPAN_Z)
+         _swrast_span_interpolate_z(ctx, span);
+      MEMCPY(z, span->array->z, n * sizeof(GLdepth));
+   }
+   MEMCPY(mask, span->array->mask, n * sizeof(GLubyte));
+   if (keepColors)
+      MEMCPY(rgba, span->array->rgba, 4 * n * sizeof(GLchan));
+
+   span->writeAll = GL_FALSE;
+
+   for (s = 0; s < numSamples; s++) {
+      const GLubyte bit = (GLubyte) (1 << s);
+      GLboolean any = GL_FALSE;
+
+      for (i = 0; i < n; i++) {
+         span->array->mask[i] = (mask[i] && (samples[i] & bit));
+         any |= span->array->mask[i];
+      }
+      if (!any)
+         continue;
+
+      if (zTest) {
+         if (span->arrayMask & SPAN_SAMPLES) {
+            /* Z at the sample position, clamped to [0, depthMax] */
+            const GLfloat dzf = span->sampleZ[s];
+            if (dzf >= 0.0F) {
+               const GLuint dz = (dzf < (GLfloat) depthMax)
+                  ? (GLuint) dzf : depthMax;
+               for (i = 0; i < n; i++)
+                  span->array->z[i] = (z[i] < depthMax - dz)
+                     ? z[i] + dz : depthMax;
+            }
+            else {
+               const GLuint dz = (-dzf < (GLfloat) depthMax)
+                  ? (GLuint) -dzf : depthMax;
+               for (i = 0; i < n; i++)
+                  span->array->z[i] = (z[i] > dz) ? z[i] - dz : 0;
+            }
+         }
+         else if (s > 0) {
+            MEMCPY(span->array->z, z, n * sizeof(GLdepth));
+         }
+      }
+      if (s > 0 && keepColors)
+         MEMCPY(span->array->rgba, rgba, 4 * n * sizeof(GLchan));
+
+      bind_sample(ctx, &binding, s);
+
+      if (zTest) {
+         GLboolean passed;
+         if (ctx->Stencil.Enabled && ctx->DrawBuffer->Visual.stencilBits > 0)
+            passed = _swrast_stencil_and_ztest_span(ctx, span);
+         else if (ctx->DrawBuffer->Visual.depthBits > 0)
+            passed = _swrast_depth_test_span(ctx, span) != 0;
+         else
+            passed = GL_TRUE;
+         if (!passed) {
+            unbind_sample(ctx, &binding);
+            continue;
+         }
+      }
+
+      if (ctx->Depth.OcclusionTest) {
+         ctx->OcclusionResult = GL_TRUE;
+      }
+
+#if FEATURE_ARB_occlusion_query
+      if (ctx->Occlusion.Active) {
+         /* samples, not fragments, are counted */
+         for (i = 0; i < n; i++)
+            ctx->Occlusion.PassedCounter += span->array->mask[i];
+      }
+#endif
+
+      if (colorMask != 0x0)
+         put_rgba_span(ctx, span);
+
+      unbind_sample(ctx, &binding);
+   }
+}
+
+
 /**
  * Apply all the per-fragment operations to a span.
  * This now includes texturing (_swrast_write_texture_span() is history).
@@ -1107,9 +1586,9 @@ _swrast_write_rgba_span( GLcontext *ctx, struct sw_span *span)
    SWcontext *swrast = SWRAST_CONTEXT(ctx);
    const GLuint origInterpMask = span->interpMask;
    const GLuint origArrayMask = span->arrayMask;
-   const GLboolean deferredTexture = !(ctx->Color.AlphaEnabled ||
-                                       ctx->FragmentProgram._Active ||
-                                       ctx->ATIFragmentShader._Enabled);
+   const GLboolean deferredTexture = swrast->_DeferredShading;
+   struct sw_span origSpan;
+   GLboolean trimmed = GL_FALSE;
 
    ASSERT(span->primitive == GL_POINT  ||  span->primitive == GL_LINE ||
 	  span->primitive == GL_POLYGON  ||  span->primitive == GL_BITMAP);
@@ -1137,6 +1616,11 @@ _swrast_write_rgba_span( GLcontext *ctx, struct sw_span *span)
       }
    }
 
+   /* Fill lazily cleared tiles before touching them */
+   if (!swrast->_BinRunning && _swrast_lazy_clear_draw_pending(ctx)) {
+      _swrast_resolve_lazy_clear_span(ctx, span);
+   }
+
 #ifdef DEBUG
    /* Make sure all fragments are within window bounds */
    if (span->arrayMask & SPAN_XY) {
@@ -1157,40 +1641,13 @@ _swrast_write_rgba_span( GLcontext *ctx, struct sw_span *span)
       stipple_polygon_span(ctx, span);
    }
 
-   /* Interpolate texcoords? */
-   if (ctx->Texture._EnabledCoordUnits
-       && (span->interpMask & SPAN_TEXTURE)
-       && (span->arrayMask & SPAN_TEXTURE) == 0) {
-      interpolate_texcoords(ctx, span);
-   }
-
    /* This is the normal place to compute the resulting fragment color/Z.
     * As an optimization, we try to defer this until after Z/stencil
     * testing in order to try to avoid computing colors that we won't
-    * actually need.
+    * actually need.  See _swrast_update_deferred_shading().
     */
    if (!deferredTexture) {
-      /* Now we need the rgba array, fill it in if needed */
-      if ((span->interpMask & SPAN_RGBA) && (span->arrayMask & SPAN_RGBA) == 0)
-         interpolate_colors(ctx, span);
-
-      if (span->interpMask & SPAN_SPEC)
-         interpolate_specular(ctx, span);
-
-      if (span->interpMask & SPAN_FOG)
-         interpolate_fog(ctx, span);
-
-      /* Compute fragment colors with fragment program or texture lookups */
-      if (ctx->FragmentProgram._Active) {
-         /* frag prog may need Z values */
-         if (span->interpMask & SPAN_Z)
-            _swrast_span_interpolate_z(ctx, span);
-         _swrast_exec_fragment_program( ctx, span );
-      }
-      else if (ctx->ATIFragmentShader._Enabled)
-         _swrast_exec_fragment_shader( ctx, span );
-      else if (ctx->Texture._EnabledUnits && (span->arrayMask & SPAN_TEXTURE))
-         _swrast_texture_span( ctx, span );
+      shade_rgba_span(ctx, span);
 
       /* Do the alpha test */
       if (!_swrast_alpha_test(ctx, span)) {
@@ -1199,6 +1656,15 @@ _swrast_write_rgba_span( GLcontext *ctx, struct sw_span *span)
       }
    }
 
+   if (swrast->_NumSamples) {
+      /* depth/stencil tests and color writes for each sample */
+      ASSERT(!deferredTexture);
+      multisample_write_rgba_span(ctx, span);
+      span->interpMask = origInterpMask;
+      span->arrayMask = origArrayMask;
+      return;
+   }
+
    /* Stencil and Z testing */
    if (ctx->Stencil.Enabled || ctx->Depth.Test) {
       if (span->interpMask & SPAN_Z)
@@ -1207,6 +1673,8 @@ _swrast_write_rgba_span( GLcontext *ctx, struct sw_span *span)
       if (ctx->Stencil.Enabled && ctx->DrawBuffer->Visual.stencilBits > 0) {
          /* Combined Z/stencil tests */
          if (!_swrast_stencil_and_ztest_span(ctx, span)) {
+            if (deferredTexture)
+               SWRAST_COUNT_SKIPPED(swrast, span->end);
             span->interpMask = origInterpMask;
             span->arrayMask = origArrayMask;
             return;
@@ -1217,6 +1685,8 @@ _swrast_write_rgba_span( GLcontext *ctx, struct sw_span *span)
          ASSERT(ctx->Depth.Test);
          ASSERT(span->arrayMask & SPAN_Z);
          if (!_swrast_depth_test_span(ctx, span)) {
+            if (deferredTexture)
+               SWRAST_COUNT_SKIPPED(swrast, span->end);
             span->interpMask = origInterpMask;
             span->arrayMask = origArrayMask;
             return;
@@ -1242,6 +1712,8 @@ _swrast_write_rgba_span( GLcontext *ctx, struct sw_span *span)
     * the occlusion test.
     */
    if (colorMask == 0x0) {
+      if (deferredTexture)
+         SWRAST_COUNT_SKIPPED(swrast, span->end);
       span->interpMask = origInterpMask;
       span->arrayMask = origArrayMask;
       return;
@@ -1252,97 +1724,29 @@ _swrast_write_rgba_span( GLcontext *ctx, struct sw_span *span)
     * Z/stencil testing.
     */
    if (deferredTexture) {
-      /* Now we need the rgba array, fill it in if needed */
-      if ((span->interpMask & SPAN_RGBA) && (span->arrayMask & SPAN_RGBA) == 0)
-         interpolate_colors(ctx, span);
-
-      if (span->interpMask & SPAN_SPEC)
-         interpolate_specular(ctx, span);
-
-      if (span->interpMask & SPAN_FOG)
-         interpolate_fog(ctx, span);
-
-      if (ctx->FragmentProgram._Active)
-         _swrast_exec_fragment_program( ctx, span );
-      else if (ctx->ATIFragmentShader._Enabled)
-         _swrast_exec_fragment_shader( ctx, span );
-      else if (ctx->Texture._EnabledUnits && (span->arrayMask & SPAN_TEXTURE))
-         _swrast_texture_span( ctx, span );
-   }
-
-   ASSERT(span->arrayMask & SPAN_RGBA);
-
-   if (!ctx->FragmentProgram._Enabled) {
-      /* Add base and specular colors */
-      if (ctx->Fog.ColorSumEnabled ||
-          (ctx->Light.Enabled &&
-           ctx->Light.Model.ColorControl == GL_SEPARATE_SPECULAR_COLOR)) {
-         if (span->interpMask & SPAN_SPEC) {
-            interpolate_specular(ctx, span);
-         }
-         if (span->arrayMask & SPAN_SPEC) {
-            add_colors( span->end, span->array->rgba, span->array->spec );
-         }
-         else {
-            /* We probably added the base/specular colors during the
-             * vertex stage!
-             */
+      /* Don't shade the dead fragments at the ends of the span either.
+       * trim_span() moves the span, so save a copy to restore later.
+       */
+      if (!span->writeAll) {
+         GLuint skipped;
+         origSpan = *span;
+         skipped = trim_span(ctx, span);
+         if (skipped) {
+            SWRAST_COUNT_SKIPPED(swrast, skipped);
+            trimmed = GL_TRUE;
          }
       }
-   }
 
-   /* Fog */
-   if (swrast->_FogEnabled) {
-      _swrast_fog_rgba_span(ctx, span);
+      shade_rgba_span(ctx, span);
    }
 
-   /* Antialias coverage application */
-   if (span->arrayMask & SPAN_COVERAGE) {
-      GLchan (*rgba)[4] = span->array->rgba;
-      GLfloat *coverage = span->array->coverage;
-      GLuint i;
-      for (i = 0; i < span->end; i++) {
-         rgba[i][ACOMP] = (GLchan) (rgba[i][ACOMP] * coverage[i]);
-      }
-   }
+   finish_rgba_span(ctx, span);
 
-   if (swrast->_RasterMask & MULTI_DRAW_BIT) {
-      /* need to do blend/logicop separately for each color buffer */
-      multi_write_rgba_span(ctx, span);
-   }
-   else {
-      /* normal: write to exactly one buffer */
-      struct gl_renderbuffer *rb = ctx->DrawBuffer->_ColorDrawBuffers[0][0];
-
-      if (ctx->Color._LogicOpEnabled) {
-         _swrast_logicop_rgba_span(ctx, rb, span, span->array->rgba);
-      }
-      else if (ctx->Color.BlendEnabled) {
-         _swrast_blend_span(ctx, rb, span, span->array->rgba);
-      }
-
-      /* Color component masking */
-      if (colorMask != 0xffffffff) {
-         _swrast_mask_rgba_span(ctx, rb, span, span->array->rgba);
-      }
+   put_rgba_span(ctx, span);
 
-      /* Finally, write the pixels to a color buffer */
-      if (span->arrayMask & SPAN_XY) {
-         /* array of pixel coords */
-         ASSERT(rb->PutValues);
-         ASSERT(rb->_BaseFormat == GL_RGB || rb->_BaseFormat == GL_RGBA);
-         /* XXX check datatype */
-         rb->PutValues(ctx, rb, span->end, span->array->x, span->array->y,
-                       span->array->rgba, span->array->mask);
-      }
-      else {
-         /* horizontal run of pixels */
-         ASSERT(rb->PutRow);
-         ASSERT(rb->_BaseFormat == GL_RGB || rb->_BaseFormat == GL_RGBA);
-         /* XXX check datatype */
-         rb->PutRow(ctx, rb, span->end, span->x, span->y, span->array->rgba,
-                    span->writeAll ? NULL : span->array->mask);
-      }
+   if (trimmed) {
+      /* undo trim_span() */
+      *span = origSpan;
    }
 
    span->interpMask = origInterpMask;
@@ -1351,6 +1755,31 @@ _swrast_write_rgba_span( GLcontext *ctx, struct sw_span *span)
 
 
 
+/**
+ * Return a pointer to the frame buffer's pixels for a horizontal span
+ * of RGBA pixels, or NULL if the pixels can't be addressed directly.
+ * The blend, logic op and color mask stages use this to look at the
+ * destination colors in place instead of copying them out with GetRow.
+ */
+void *
+_swrast_get_rgba_span_pointer( GLcontext *ctx, struct gl_renderbuffer *rb,
+                               const struct sw_span *span )
+{
+   if (span->arrayMask & SPAN_XY)
+      return NULL;
+
+   /* the pixels must be stored exactly like a GLchan[4] array */
+   if (rb->_BaseFormat != GL_RGBA || rb->DataType != CHAN_TYPE)
+      return NULL;
+
+   if (span->y < 0 || span->y >= (GLint) rb->Height ||
+       span->x < 0 || span->x + (GLint) span->end > (GLint) rb->Width)
+      return NULL;
+
+   return rb->GetPointer(ctx, rb, span->x, span->y);
+}
+
+
 /**
  * Read RGBA pixels from frame buffer.  Clipping will be done to prevent
  * reading ouside the buffer's boundaries.
@@ -1400,6 +1829,7 @@ _swrast_read_rgba_span( GLcontext *ctx, struct gl_renderbuffer *rb,
       ASSERT(rb->GetRow);
       ASSERT(rb->_BaseFormat == GL_RGB || rb->_BaseFormat == GL_RGBA);
       ASSERT(rb->DataType == GL_UNSIGNED_BYTE);
+      _swrast_resolve_lazy_clear(ctx, rb, x + skip, y, length, 1);
       rb->GetRow(ctx, rb, length, x + skip, y, rgba + skip);
    }
 }
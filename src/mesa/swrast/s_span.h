@@ -59,6 +59,10 @@ extern void
 _swrast_write_rgba_span( GLcontext *ctx, struct sw_span *span);
 
 
+extern void *
+_swrast_get_rgba_span_pointer( GLcontext *ctx, struct gl_renderbuffer *rb,
+                               const struct sw_span *span );
+
 extern void
 _swrast_read_rgba_span( GLcontext *ctx, struct gl_renderbuffer *rb,
                         GLuint n, GLint x, GLint y, GLchan rgba[][4] );
@@ -31,8 +31,11 @@
 
 #include "s_context.h"
 #include "s_depth.h"
+#include "s_hiz.h"
+#include "s_lazyclear.h"
 #include "s_stencil.h"
 #include "s_span.h"
+#include "x86/common_x86_sse2.h"
 
 
 
@@ -411,6 +414,7 @@ stencil_and_ztest_span(GLcontext *ctx, struct sw_span *span, GLuint face)
 {
    struct gl_framebuffer *fb = ctx->DrawBuffer;
    struct gl_renderbuffer *rb = fb->Attachment[BUFFER_STENCIL].Renderbuffer;
+   struct gl_renderbuffer *dsrb = _swrast_get_packed_depth_stencil(ctx, rb);
    GLstencil stencilRow[MAX_WIDTH];
    GLstencil *stencil;
    const GLuint n = span->end;
@@ -427,6 +431,13 @@ stencil_and_ztest_span(GLcontext *ctx, struct sw_span *span, GLuint face)
    }
 #endif
 
+   if (dsrb && (!ctx->Depth.Test ||
+                _swrast_get_packed_depth_stencil(ctx,
+                      fb->Attachment[BUFFER_DEPTH].Renderbuffer) == dsrb)) {
+      /* stencil and depth values are interleaved, do it all in one pass */
+      return _swrast_z24s8_test_span(ctx, span, dsrb, face, GL_TRUE) > 0;
+   }
+
    stencil = rb->GetPointer(ctx, rb, x, y);
    if (!stencil) {
       rb->GetRow(ctx, rb, n, x, y, stencilRow);
@@ -511,6 +522,372 @@ stencil_and_ztest_span(GLcontext *ctx, struct sw_span *span, GLuint face)
 
 
 
+/*
+ * Stencil and depth testing for packed 24/8 depth/stencil buffers.
+ *
+ * When the depth and stencil attachments both wrap one packed buffer,
+ * each pixel's depth and stencil values live in the same 32-bit word,
+ * so the stencil test, the depth test, the stencil operations and the
+ * depth write can all be done in a single pass over the span, reading
+ * and writing every word once.  The same function also does the depth
+ * test alone when stenciling is disabled.
+ */
+
+
+/** The depth and stencil state for one face, for the kernels below */
+struct z24s8_state
+{
+   GLenum StencilFunc;
+   GLenum FailOp, ZFailOp, ZPassOp;
+   GLuint Ref;          /**< stencil reference value */
+   GLuint MaskedRef;    /**< Ref & ValueMask */
+   GLuint ValueMask;
+   GLuint WriteMask;    /**< stencil write mask */
+   GLenum DepthFunc;    /**< GL_ALWAYS if depth testing is disabled */
+   GLboolean DepthWrite;
+};
+
+
+typedef GLuint (*z24s8_span_func)( const struct z24s8_state *state, GLuint n,
+                                   GLuint zs[], const GLuint z[],
+                                   GLubyte mask[] );
+
+
+/** Test "a func b" */
+static INLINE GLboolean
+compare_values( GLenum func, GLuint a, GLuint b )
+{
+   switch (func) {
+   case GL_LESS:     return a < b;
+   case GL_LEQUAL:   return a <= b;
+   case GL_GEQUAL:   return a >= b;
+   case GL_GREATER:  return a > b;
+   case GL_NOTEQUAL: return a != b;
+   case GL_EQUAL:    return a == b;
+   case GL_ALWAYS:   return GL_TRUE;
+   default:          return GL_FALSE;
+   }
+}
+
+
+/** Apply the stencil operator to one stencil value */
+static INLINE GLuint
+stencil_op_value( GLenum oper, GLuint s, GLuint ref )
+{
+   switch (oper) {
+   case GL_ZERO:          return 0;
+   case GL_REPLACE:       return ref;
+   case GL_INCR:          return (s < STENCIL_MAX) ? s + 1 : s;
+   case GL_DECR:          return (s > 0) ? s - 1 : s;
+   case GL_INCR_WRAP_EXT: return (s + 1) & 0xff;
+   case GL_DECR_WRAP_EXT: return (s - 1) & 0xff;
+   case GL_INVERT:        return ~s & 0xff;
+   default:               return s;
+   }
+}
+
+
+/**
+ * Stencil and depth test one fragment with depth z against the packed
+ * word *zs, and update the word.
+ * \return GL_TRUE if the fragment passed both tests
+ */
+static INLINE GLboolean
+z24s8_test_fragment( const struct z24s8_state *state, GLuint *zs, GLuint z )
+{
+   const GLuint w = *zs;
+   const GLuint s = w & 0xff;
+   GLuint newZ = w & ~0xff, newS;
+   GLboolean pass = GL_FALSE;
+
+   if (!compare_values(state->StencilFunc, state->MaskedRef,
+                       s & state->ValueMask)) {
+      newS = stencil_op_value(state->FailOp, s, state->Ref);
+   }
+   else if (!compare_values(state->DepthFunc, z, w >> 8)) {
+      newS = stencil_op_value(state->ZFailOp, s, state->Ref);
+   }
+   else {
+      newS = stencil_op_value(state->ZPassOp, s, state->Ref);
+      if (state->DepthWrite)
+         newZ = z << 8;
+      pass = GL_TRUE;
+   }
+
+   *zs = newZ | (s & ~state->WriteMask & 0xff) | (newS & state->WriteMask);
+   return pass;
+}
+
+
+/**
+ * Stencil and depth test n fragments against the packed words zs[].
+ * \return number of fragments which passed both tests
+ */
+static GLuint
+z24s8_test_span_c( const struct z24s8_state *state, GLuint n, GLuint zs[],
+                   const GLuint z[], GLubyte mask[] )
+{
+   GLuint passed = 0, i;
+
+   for (i = 0; i < n; i++) {
+      if (mask[i]) {
+         if (z24s8_test_fragment(state, zs + i, z[i]))
+            passed++;
+         else
+            mask[i] = 0;
+      }
+   }
+
+   return passed;
+}
+
+
+/*
+ * SSE2 version of the above, four fragments at a time.
+ */
+#ifdef USE_SSE2_INTRIN
+
+
+/* Select 'a' where 'sel' is all ones, else 'b' */
+#define SSE2_SELECT(sel, a, b) \
+   _mm_or_si128(_mm_and_si128(sel, a), _mm_andnot_si128(sel, b))
+
+
+/**
+ * Test "a func b" in each 32-bit lane.  The values have at most 24 bits
+ * so the signed compares do the job.
+ */
+static INLINE SSE2_FUNC __m128i
+compare_values_sse2( GLenum func, __m128i a, __m128i b )
+{
+   const __m128i ones = _mm_cmpeq_epi32(a, a);
+   switch (func) {
+   case GL_LESS:     return _mm_cmpgt_epi32(b, a);
+   case GL_LEQUAL:   return _mm_xor_si128(_mm_cmpgt_epi32(a, b), ones);
+   case GL_GEQUAL:   return _mm_xor_si128(_mm_cmpgt_epi32(b, a), ones);
+   case GL_GREATER:  return _mm_cmpgt_epi32(a, b);
+   case GL_NOTEQUAL: return _mm_xor_si128(_mm_cmpeq_epi32(a, b), ones);
+   case GL_EQUAL:    return _mm_cmpeq_epi32(a, b);
+   case GL_ALWAYS:   return ones;
+   default:          return _mm_setzero_si128();
+   }
+}
+
+
+static INLINE SSE2_FUNC __m128i
+stencil_op_sse2( GLenum oper, __m128i s, __m128i ref )
+{
+   const __m128i max = _mm_set1_epi32(STENCIL_MAX);
+   switch (oper) {
+   case GL_ZERO:
+      return _mm_setzero_si128();
+   case GL_REPLACE:
+      return ref;
+   case GL_INCR:
+      /* subtracting the all-ones compare result adds one */
+      return _mm_sub_epi32(s, _mm_cmpgt_epi32(max, s));
+   case GL_DECR:
+      return _mm_add_epi32(s, _mm_cmpgt_epi32(s, _mm_setzero_si128()));
+   case GL_INCR_WRAP_EXT:
+      return _mm_and_si128(_mm_add_epi32(s, _mm_set1_epi32(1)), max);
+   case GL_DECR_WRAP_EXT:
+      return _mm_and_si128(_mm_sub_epi32(s, _mm_set1_epi32(1)), max);
+   case GL_INVERT:
+      return _mm_xor_si128(s, max);
+   default:
+      return s;
+   }
+}
+
+
+static SSE2_FUNC GLuint
+z24s8_test_span_sse2( const struct z24s8_state *state, GLuint n,
+                      GLuint zs[], const GLuint z[], GLubyte mask[] )
+{
+   const __m128i zero = _mm_setzero_si128();
+   const __m128i lowByte = _mm_set1_epi32(0xff);
+   const __m128i ref = _mm_set1_epi32(state->Ref);
+   const __m128i maskedRef = _mm_set1_epi32(state->MaskedRef);
+   const __m128i valueMask = _mm_set1_epi32(state->ValueMask);
+   /* the bits of each word which aren't written by the stencil ops */
+   const __m128i keepBits = _mm_set1_epi32(~state->WriteMask);
+   __m128i sum = zero;
+   GLuint i;
+
+   for (i = 0; i + 4 <= n; i += 4) {
+      __m128i live, w, s, zval, sPass, zPass, newS, out;
+      GLint pass;
+
+      live = _mm_cmpgt_epi32(_mm_setr_epi32(mask[i], mask[i + 1],
+                                            mask[i + 2], mask[i + 3]),
+                             zero);
+      if (!_mm_movemask_epi8(live))
+         continue;
+
+      w = _mm_loadu_si128((const __m128i *) (zs + i));
+      zval = _mm_loadu_si128((const __m128i *) (z + i));
+      s = _mm_and_si128(w, lowByte);
+
+      sPass = _mm_and_si128(live,
+                            compare_values_sse2(state->StencilFunc, maskedRef,
+                                                _mm_and_si128(s, valueMask)));
+      zPass = _mm_and_si128(sPass,
+                            compare_values_sse2(state->DepthFunc, zval,
+                                                _mm_srli_epi32(w, 8)));
+
+      newS = s;
+      if (state->FailOp != GL_KEEP)
+         newS = SSE2_SELECT(_mm_andnot_si128(sPass, live),
+                            stencil_op_sse2(state->FailOp, s, ref), newS);
+      if (state->ZFailOp != GL_KEEP)
+         newS = SSE2_SELECT(_mm_andnot_si128(zPass, sPass),
+                            stencil_op_sse2(state->ZFailOp, s, ref), newS);
+      if (state->ZPassOp != GL_KEEP)
+         newS = SSE2_SELECT(zPass,
+                            stencil_op_sse2(state->ZPassOp, s, ref), newS);
+
+      out = _mm_or_si128(_mm_and_si128(w, keepBits),
+                         _mm_andnot_si128(keepBits, newS));
+      if (state->DepthWrite)
+         out = SSE2_SELECT(zPass,
+                           _mm_or_si128(_mm_slli_epi32(zval, 8),
+                                        _mm_and_si128(out, lowByte)),
+                           out);
+      _mm_storeu_si128((__m128i *) (zs + i), out);
+
+      /* the passing fragments' lanes are all ones, count them */
+      sum = _mm_sub_epi32(sum, zPass);
+      pass = _mm_movemask_ps(_mm_castsi128_ps(zPass));
+      mask[i] = pass & 1;
+      mask[i + 1] = (pass >> 1) & 1;
+      mask[i + 2] = (pass >> 2) & 1;
+      mask[i + 3] = pass >> 3;
+   }
+
+   sum = _mm_add_epi32(sum, _mm_srli_si128(sum, 8));
+   sum = _mm_add_epi32(sum, _mm_srli_si128(sum, 4));
+
+   return _mm_cvtsi128_si32(sum)
+      + z24s8_test_span_c(state, n - i, zs + i, z + i, mask + i);
+}
+
+#undef SSE2_SELECT
+
+#endif /* USE_SSE2_INTRIN */
+
+
+static z24s8_span_func z24s8_test_span = z24s8_test_span_c;
+
+
+/**
+ * Choose the packed depth/stencil kernel for this CPU.  Called when a
+ * context is created, after the x86 CPU features have been detected.
+ */
+void
+_swrast_init_stencil_funcs( void )
+{
+#if defined(USE_SSE2_INTRIN)
+   z24s8_test_span = _mesa_have_sse2() ? z24s8_test_span_sse2
+                                       : z24s8_test_span_c;
+#endif
+}
+
+
+/**
+ * Stencil and/or depth test a span against a packed 24/8 depth/stencil
+ * buffer, in a single pass.  The fragments of pixel arrays are tested
+ * in order, each one seeing the results of the previous ones.
+ * \param dsrb  the packed buffer, see _swrast_get_packed_depth_stencil()
+ * \param face  0 or 1 for front or back face stencil state
+ * \param stencil  do the stencil test and ops, or just the depth test?
+ * \return number of fragments which passed
+ */
+GLuint
+_swrast_z24s8_test_span( GLcontext *ctx, struct sw_span *span,
+                         struct gl_renderbuffer *dsrb, GLuint face,
+                         GLboolean stencil )
+{
+   struct gl_renderbuffer *zrb
+      = ctx->DrawBuffer->Attachment[BUFFER_DEPTH].Renderbuffer;
+   const GLuint n = span->end;
+   const GLuint *z = span->array->z;
+   GLubyte *mask = span->array->mask;
+   struct z24s8_state state;
+   GLuint passed;
+
+   ASSERT(dsrb->DataType == GL_UNSIGNED_INT_24_8_MESA);
+   ASSERT(stencil || ctx->Depth.Test);
+
+   if (stencil) {
+      state.StencilFunc = ctx->Stencil.Function[face];
+      state.FailOp = ctx->Stencil.FailFunc[face];
+      state.ZFailOp = ctx->Stencil.ZFailFunc[face];
+      state.ZPassOp = ctx->Stencil.ZPassFunc[face];
+      state.Ref = ctx->Stencil.Ref[face];
+      state.ValueMask = ctx->Stencil.ValueMask[face] & 0xff;
+      state.WriteMask = ctx->Stencil.WriteMask[face] & 0xff;
+   }
+   else {
+      state.StencilFunc = GL_ALWAYS;
+      state.FailOp = state.ZFailOp = state.ZPassOp = GL_KEEP;
+      state.Ref = 0;
+      state.ValueMask = 0xff;
+      state.WriteMask = 0;
+   }
+   state.MaskedRef = state.Ref & state.ValueMask;
+
+   if (ctx->Depth.Test) {
+      ASSERT(span->arrayMask & SPAN_Z);
+      state.DepthFunc = ctx->Depth.Func;
+      state.DepthWrite = ctx->Depth.Mask;
+   }
+   else {
+      state.DepthFunc = GL_ALWAYS;
+      state.DepthWrite = GL_FALSE;
+   }
+
+   if (span->arrayMask & SPAN_XY) {
+      /* pixels outside the buffer have been masked out already */
+      GLuint *zsStart = (GLuint *) dsrb->Data;
+      const GLint *x = span->array->x;
+      const GLint *y = span->array->y;
+      const GLuint stride = dsrb->Width;
+      GLuint i;
+
+      passed = 0;
+      for (i = 0; i < n; i++) {
+         if (mask[i]) {
+            if (z24s8_test_fragment(&state, zsStart + y[i] * stride + x[i],
+                                    z[i]))
+               passed++;
+            else
+               mask[i] = 0;
+         }
+      }
+
+      if (passed > 0 && state.DepthWrite && SWRAST_CONTEXT(ctx)->HiZ) {
+         _swrast_hiz_update_pixels(ctx, zrb, n, x, y, mask);
+      }
+   }
+   else {
+      passed = z24s8_test_span(&state, n,
+                               (GLuint *) dsrb->GetPointer(ctx, dsrb,
+                                                           span->x, span->y),
+                               z, mask);
+
+      if (passed > 0 && state.DepthWrite && SWRAST_CONTEXT(ctx)->HiZ) {
+         _swrast_hiz_update_span(ctx, zrb, span->x, span->y, n);
+      }
+   }
+
+   if (passed < n) {
+      span->writeAll = GL_FALSE;
+   }
+   return passed;
+}
+
+
+
 /*
  * Return the address of a stencil buffer value given the window coords:
  */
@@ -904,6 +1281,7 @@ stencil_and_ztest_pixels( GLcontext *ctx, struct sw_span *span, GLuint face )
 {
    struct gl_framebuffer *fb = ctx->DrawBuffer;
    struct gl_renderbuffer *rb = fb->Attachment[BUFFER_STENCIL].Renderbuffer;
+   struct gl_renderbuffer *dsrb = _swrast_get_packed_depth_stencil(ctx, rb);
    const GLuint n = span->end;
    const GLint *x = span->array->x;
    const GLint *y = span->array->y;
@@ -913,6 +1291,13 @@ stencil_and_ztest_pixels( GLcontext *ctx, struct sw_span *span, GLuint face )
    ASSERT(ctx->Stencil.Enabled);
    ASSERT(n <= MAX_WIDTH);
 
+   if (dsrb && (!ctx->Depth.Test ||
+                _swrast_get_packed_depth_stencil(ctx,
+                      fb->Attachment[BUFFER_DEPTH].Renderbuffer) == dsrb)) {
+      /* stencil and depth values are interleaved, do it all in one pass */
+      return _swrast_z24s8_test_span(ctx, span, dsrb, face, GL_TRUE) > 0;
+   }
+
    if (!rb->GetPointer(ctx, rb, 0, 0)) {
       /* No direct access */
       GLstencil stencil[MAX_WIDTH];
@@ -1081,6 +1466,7 @@ _swrast_read_stencil_span(GLcontext *ctx, struct gl_renderbuffer *rb,
       return;
    }
 
+   _swrast_resolve_lazy_clear(ctx, rb, x, y, n, 1);
    rb->GetRow(ctx, rb, n, x, y, stencil);
 }
 
@@ -1120,6 +1506,8 @@ _swrast_write_stencil_span(GLcontext *ctx, GLint n, GLint x, GLint y,
       return;
    }
 
+   _swrast_resolve_lazy_clear(ctx, rb, x, y, n, 1);
+
    if ((stencilMask & stencilMax) != stencilMax) {
       /* need to apply writemask */
       GLstencil destVals[MAX_WIDTH], newVals[MAX_WIDTH];
@@ -1161,6 +1549,17 @@ _swrast_clear_stencil_buffer( GLcontext *ctx, struct gl_renderbuffer *rb )
    width  = ctx->DrawBuffer->_Xmax - ctx->DrawBuffer->_Xmin;
    height = ctx->DrawBuffer->_Ymax - ctx->DrawBuffer->_Ymin;
 
+   /* try tagging the tiles instead of writing the values */
+   if (rb->Wrapped->_BaseFormat == GL_DEPTH_STENCIL_MESA) {
+      /* stencil values are in the low byte of the packed words */
+      const GLuint value = clearVal, writemask = mask;
+      if (_swrast_lazy_clear(ctx, rb, &value, &writemask))
+         return;
+   }
+   else if (_swrast_lazy_clear(ctx, rb, &clearVal, &mask)) {
+      return;
+   }
+
    if (rb->GetPointer(ctx, rb, 0, 0)) {
       /* Direct buffer access */
       if (ctx->Stencil.WriteMask[0] != STENCIL_MAX) {
@@ -36,6 +36,16 @@ extern GLboolean
 _swrast_stencil_and_ztest_span(GLcontext *ctx, struct sw_span *span);
 
 
+extern GLuint
+_swrast_z24s8_test_span( GLcontext *ctx, struct sw_span *span,
+                         struct gl_renderbuffer *dsrb, GLuint face,
+                         GLboolean stencil );
+
+
+extern void
+_swrast_init_stencil_funcs( void );
+
+
 extern void
 _swrast_read_stencil_span(GLcontext *ctx, struct gl_renderbuffer *rb,
                           GLint n, GLint x, GLint y, GLstencil stencil[]);
@@ -0,0 +1,331 @@
+/*
+ * Mesa 3-D graphics library
+ * Version:  6.5
+ *
+ * Copyright (C) 1999-2006  Brian Paul   All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * BRIAN PAUL BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ * AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/*
+ * Template for 2D texture sampling functions specialized for one texture
+ * format and wrap mode.  The texels are read straight out of the image
+ * data instead of through gl_texture_image::FetchTexelc, and the wrap
+ * mode tests of the texel location macros are resolved at compile time.
+ *
+ * Define the following macros before including this file:
+ *   NAME(PREFIX)  to generate the function names
+ *   WRAP_MODE  GL_REPEAT or GL_CLAMP_TO_EDGE, for both S and T
+ *   TEXEL_TYPE  the datatype of the image data (GLchan, GLushort, etc)
+ *   TEXEL_SIZE  number of TEXEL_TYPE elements per texel
+ *   FETCH_TEXEL(DST, SRC)  to convert the texel at SRC to GLchan DST[4]
+ *   ONE_CHANNEL  optional, define if the format has a single channel
+ *
+ * NAME and WRAP_MODE are undefined at the end of this file, the texel
+ * macros are not, so the file can be included again for the other wrap
+ * mode.  The generated texture_sample_func is NAME(sample); it handles
+ * all the min/mag filters of textures without a border.  The filtering
+ * itself is done by the kernels in s_texture.c, except for bilinear
+ * filtering of single channel formats: that's done inline, where the
+ * compiler only does the work once for the replicated channels.
+ *
+ * Only used when CHAN_TYPE == GL_UNSIGNED_BYTE.
+ */
+
+
+static INLINE void
+NAME(fetch)( const struct gl_texture_image *img, GLint i, GLint j,
+             GLchan rgba[4] )
+{
+   const TEXEL_TYPE *src = (const TEXEL_TYPE *) img->Data
+      + (img->RowStride * j + i) * TEXEL_SIZE;
+   FETCH_TEXEL(rgba, src);
+}
+
+
+static INLINE void
+NAME(nearest)( const struct gl_texture_object *tObj,
+               const struct gl_texture_image *img,
+               const GLfloat texcoord[4], GLchan rgba[4] )
+{
+   const GLint width = img->Width2;
+   const GLint height = img->Height2;
+   GLint i, j;
+
+   COMPUTE_NEAREST_TEXEL_LOCATION(WRAP_MODE, texcoord[0], width,  i);
+   COMPUTE_NEAREST_TEXEL_LOCATION(WRAP_MODE, texcoord[1], height, j);
+
+   NAME(fetch)(img, i, j, rgba);
+}
+
+
+/**
+ * Compute the texel locations and weights for bilinear sampling at
+ * texcoord and fetch the four texels.
+ */
+static INLINE void
+NAME(linear_texels)( const struct gl_texture_object *tObj,
+                     const struct gl_texture_image *img,
+                     const GLfloat texcoord[4], GLint *ia, GLint *ib,
+                     GLchan t00[4], GLchan t10[4],
+                     GLchan t01[4], GLchan t11[4] )
+{
+   const GLint width = img->Width2;
+   const GLint height = img->Height2;
+   GLint i0, j0, i1, j1;
+   GLfloat u, v;
+
+   COMPUTE_LINEAR_TEXEL_LOCATIONS(WRAP_MODE, texcoord[0], u, width,  i0, i1);
+   COMPUTE_LINEAR_TEXEL_LOCATIONS(WRAP_MODE, texcoord[1], v, height, j0, j1);
+
+   *ia = IROUND_POS(FRAC(u) * ILERP_SCALE);
+   *ib = IROUND_POS(FRAC(v) * ILERP_SCALE);
+
+   NAME(fetch)(img, i0, j0, t00);
+   NAME(fetch)(img, i1, j0, t10);
+   NAME(fetch)(img, i0, j1, t01);
+   NAME(fetch)(img, i1, j1, t11);
+}
+
+
+#ifdef ONE_CHANNEL
+
+/**
+ * Bilinear sample at texcoord.
+ */
+static INLINE void
+NAME(linear)( const struct gl_texture_object *tObj,
+              const struct gl_texture_image *img,
+              const GLfloat texcoord[4], GLchan rgba[4] )
+{
+   GLchan t00[4], t10[4], t01[4], t11[4]; /* sampled texel colors */
+   GLint ia, ib;
+
+   NAME(linear_texels)(tObj, img, texcoord, &ia, &ib, t00, t10, t01, t11);
+
+   rgba[0] = ilerp_2d(ia, ib, t00[0], t10[0], t01[0], t11[0]);
+   rgba[1] = ilerp_2d(ia, ib, t00[1], t10[1], t01[1], t11[1]);
+   rgba[2] = ilerp_2d(ia, ib, t00[2], t10[2], t01[2], t11[2]);
+   rgba[3] = ilerp_2d(ia, ib, t00[3], t10[3], t01[3], t11[3]);
+}
+
+#else
+
+/**
+ * Gather the texels and weights for bilinear sampling at texcoord into
+ * element k of the chunk.
+ */
+static INLINE void
+NAME(linear)( const struct gl_texture_object *tObj,
+              const struct gl_texture_image *img,
+              const GLfloat texcoord[4], struct bilinear_chunk *chunk,
+              GLuint k )
+{
+   NAME(linear_texels)(tObj, img, texcoord, &chunk->ia[k], &chunk->ib[k],
+                       chunk->t00[k], chunk->t10[k],
+                       chunk->t01[k], chunk->t11[k]);
+}
+
+#endif
+
+
+/**
+ * Sample n texels with the given filter.  The linear and mipmap filters
+ * are done a chunk of texels at a time: the texels and weights are
+ * gathered first and then filtered with bilinear_texels() and
+ * blend_mipmap_texels().
+ */
+static void
+NAME(filter)( const struct gl_texture_object *tObj, GLenum filter,
+              GLuint n, const GLfloat texcoords[][4],
+              const GLfloat lambda[], GLchan rgba[][4] )
+{
+   const struct gl_texture_image *img = tObj->Image[0][tObj->BaseLevel];
+#ifndef ONE_CHANNEL
+   struct bilinear_chunk chunk[2];
+#endif
+   GLchan t0[SAMPLE_CHUNK][4], t1[SAMPLE_CHUNK][4];
+   GLfloat f[SAMPLE_CHUNK];
+   GLuint start, i, k, count;
+
+   switch (filter) {
+   case GL_NEAREST:
+      for (i = 0; i < n; i++)
+         NAME(nearest)(tObj, img, texcoords[i], rgba[i]);
+      break;
+   case GL_LINEAR:
+#ifdef ONE_CHANNEL
+      for (i = 0; i < n; i++)
+         NAME(linear)(tObj, img, texcoords[i], rgba[i]);
+#else
+      for (start = 0; start < n; start += count) {
+         count = MIN2(n - start, SAMPLE_CHUNK);
+         for (k = 0; k < count; k++)
+            NAME(linear)(tObj, img, texcoords[start + k], &chunk[0], k);
+         bilinear_texels(count, &chunk[0], rgba + start);
+      }
+#endif
+      break;
+   case GL_NEAREST_MIPMAP_NEAREST:
+      for (i = 0; i < n; i++) {
+         GLint level;
+         COMPUTE_NEAREST_MIPMAP_LEVEL(tObj, lambda[i], level);
+         NAME(nearest)(tObj, tObj->Image[0][level], texcoords[i], rgba[i]);
+      }
+      break;
+   case GL_LINEAR_MIPMAP_NEAREST:
+#ifdef ONE_CHANNEL
+      for (i = 0; i < n; i++) {
+         GLint level;
+         COMPUTE_NEAREST_MIPMAP_LEVEL(tObj, lambda[i], level);
+         NAME(linear)(tObj, tObj->Image[0][level], texcoords[i], rgba[i]);
+      }
+#else
+      for (start = 0; start < n; start += count) {
+         count = MIN2(n - start, SAMPLE_CHUNK);
+         for (k = 0; k < count; k++) {
+            GLint level;
+            COMPUTE_NEAREST_MIPMAP_LEVEL(tObj, lambda[start + k], level);
+            NAME(linear)(tObj, tObj->Image[0][level], texcoords[start + k],
+                         &chunk[0], k);
+         }
+         bilinear_texels(count, &chunk[0], rgba + start);
+      }
+#endif
+      break;
+   case GL_NEAREST_MIPMAP_LINEAR:
+      for (start = 0; start < n; start += count) {
+         count = MIN2(n - start, SAMPLE_CHUNK);
+         for (k = 0; k < count; k++) {
+            const GLfloat *texcoord = texcoords[start + k];
+            GLint level;
+            COMPUTE_LINEAR_MIPMAP_LEVEL(tObj, lambda[start + k], level);
+            if (level >= tObj->_MaxLevel) {
+               /* blending with a weight of zero leaves t0 unchanged */
+               NAME(nearest)(tObj, tObj->Image[0][tObj->_MaxLevel],
+                             texcoord, t0[k]);
+               COPY_CHAN4(t1[k], t0[k]);
+               f[k] = 0.0F;
+            }
+            else {
+               NAME(nearest)(tObj, tObj->Image[0][level  ], texcoord, t0[k]);
+               NAME(nearest)(tObj, tObj->Image[0][level+1], texcoord, t1[k]);
+               f[k] = FRAC(lambda[start + k]);
+            }
+         }
+         blend_mipmap_texels(count, f, (const GLchan (*)[4]) t0,
+                             (const GLchan (*)[4]) t1, rgba + start);
+      }
+      break;
+   case GL_LINEAR_MIPMAP_LINEAR:
+      for (start = 0; start < n; start += count) {
+         count = MIN2(n - start, SAMPLE_CHUNK);
+         for (k = 0; k < count; k++) {
+            const GLfloat *texcoord = texcoords[start + k];
+            GLint level;
+            COMPUTE_LINEAR_MIPMAP_LEVEL(tObj, lambda[start + k], level);
+#ifdef ONE_CHANNEL
+            if (level >= tObj->_MaxLevel) {
+               /* blending with a weight of zero leaves t0 unchanged */
+               NAME(linear)(tObj, tObj->Image[0][tObj->_MaxLevel],
+                            texcoord, t0[k]);
+               COPY_CHAN4(t1[k], t0[k]);
+               f[k] = 0.0F;
+            }
+            else {
+               NAME(linear)(tObj, tObj->Image[0][level  ], texcoord, t0[k]);
+               NAME(linear)(tObj, tObj->Image[0][level+1], texcoord, t1[k]);
+               f[k] = FRAC(lambda[start + k]);
+            }
+#else
+            if (level >= tObj->_MaxLevel) {
+               /* blending with a weight of zero leaves t0 unchanged */
+               NAME(linear)(tObj, tObj->Image[0][tObj->_MaxLevel],
+                            texcoord, &chunk[0], k);
+               chunk[1].ia[k] = chunk[0].ia[k];
+               chunk[1].ib[k] = chunk[0].ib[k];
+               COPY_CHAN4(chunk[1].t00[k], chunk[0].t00[k]);
+               COPY_CHAN4(chunk[1].t10[k], chunk[0].t10[k]);
+               COPY_CHAN4(chunk[1].t01[k], chunk[0].t01[k]);
+               COPY_CHAN4(chunk[1].t11[k], chunk[0].t11[k]);
+               f[k] = 0.0F;
+            }
+            else {
+               NAME(linear)(tObj, tObj->Image[0][level  ], texcoord,
+                            &chunk[0], k);
+               NAME(linear)(tObj, tObj->Image[0][level+1], texcoord,
+                            &chunk[1], k);
+               f[k] = FRAC(lambda[start + k]);
+            }
+#endif
+         }
+#ifndef ONE_CHANNEL
+         bilinear_texels(count, &chunk[0], t0);
+         bilinear_texels(count, &chunk[1], t1);
+#endif
+         blend_mipmap_texels(count, f, (const GLchan (*)[4]) t0,
+                             (const GLchan (*)[4]) t1, rgba + start);
+      }
+      break;
+   default:
+      _mesa_problem(NULL, "Bad filter in specialized 2D texture sampler");
+   }
+}
+
+
+/**
+ * Sample with min/mag filter selection, as sample_lambda_2d() does.
+ */
+static void
+NAME(sample)( GLcontext *ctx, GLuint texUnit,
+              const struct gl_texture_object *tObj, GLuint n,
+              const GLfloat texcoords[][4], const GLfloat lambda[],
+              GLchan rgba[][4] )
+{
+   ASSERT(tObj->WrapS == WRAP_MODE);
+   ASSERT(tObj->WrapT == WRAP_MODE);
+   ASSERT(tObj->Image[0][tObj->BaseLevel]->Border == 0);
+
+   if (tObj->MinFilter == tObj->MagFilter) {
+      NAME(filter)(tObj, tObj->MinFilter, n, texcoords, lambda, rgba);
+   }
+   else {
+      GLuint minStart, minEnd;  /* texels with minification */
+      GLuint magStart, magEnd;  /* texels with magnification */
+
+      ASSERT(lambda != NULL);
+      compute_min_mag_ranges(SWRAST_CONTEXT(ctx)->_MinMagThresh[texUnit],
+                             n, lambda, &minStart, &minEnd, &magStart, &magEnd);
+
+      if (minStart < minEnd) {
+         NAME(filter)(tObj, tObj->MinFilter, minEnd - minStart,
+                      texcoords + minStart, lambda + minStart,
+                      rgba + minStart);
+      }
+      if (magStart < magEnd) {
+         NAME(filter)(tObj, tObj->MagFilter, magEnd - magStart,
+                      texcoords + magStart, lambda + magStart,
+                      rgba + magStart);
+      }
+   }
+}
+
+
+#undef NAME
+#undef WRAP_MODE
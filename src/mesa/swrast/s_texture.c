@@ -31,6 +31,7 @@
 #include "pixel.h"
 #include "texformat.h"
 #include "teximage.h"
+#include "x86/common_x86_sse2.h"
 
 #include "s_context.h"
 #include "s_texture.h"
@@ -836,6 +837,242 @@ sample_lambda_1d( GLcontext *ctx, GLuint texUnit,
 }
 
 
+/**********************************************************************/
+/*                    Texel Filtering Kernels                         */
+/**********************************************************************/
+
+#if CHAN_TYPE == GL_UNSIGNED_BYTE
+
+/*
+ * The 2D samplers generated from s_texsamptemp.h first gather the texels
+ * and weights for up to SAMPLE_CHUNK samples and then filter them all
+ * with one call through bilinear_texels and blend_mipmap_texels.  Those
+ * point at plain C kernels or at SSE2 kernels, which filter all four
+ * channels of a texel at once, four texels per iteration.  See
+ * _swrast_init_texture_filters().
+ */
+
+#define SAMPLE_CHUNK 64
+
+/**
+ * Texels and fixed point weights for bilinear filtering of a chunk of
+ * samples.  ia and ib are the horizontal and vertical weights in
+ * [0, ILERP_SCALE], as for ilerp_2d().
+ */
+struct bilinear_chunk
+{
+   GLint ia[SAMPLE_CHUNK], ib[SAMPLE_CHUNK];
+   GLchan t00[SAMPLE_CHUNK][4], t10[SAMPLE_CHUNK][4];
+   GLchan t01[SAMPLE_CHUNK][4], t11[SAMPLE_CHUNK][4];
+};
+
+typedef void (*bilinear_texels_func)( GLuint n,
+                                      const struct bilinear_chunk *chunk,
+                                      GLchan rgba[][4] );
+
+typedef void (*blend_mipmap_texels_func)( GLuint n, const GLfloat f[],
+                                          const GLchan t0[][4],
+                                          const GLchan t1[][4],
+                                          GLchan rgba[][4] );
+
+
+static void
+bilinear_texels_c( GLuint n, const struct bilinear_chunk *chunk,
+                   GLchan rgba[][4] )
+{
+   GLuint i, c;
+   for (i = 0; i < n; i++) {
+      const GLint ia = chunk->ia[i], ib = chunk->ib[i];
+      for (c = 0; c < 4; c++) {
+         rgba[i][c] = ilerp_2d(ia, ib, chunk->t00[i][c], chunk->t10[i][c],
+                               chunk->t01[i][c], chunk->t11[i][c]);
+      }
+   }
+}
+
+
+/**
+ * Blend the texels sampled from two mipmap levels, f being the fraction
+ * of the second one.
+ */
+static void
+blend_mipmap_texels_c( GLuint n, const GLfloat f[],
+                       const GLchan t0[][4], const GLchan t1[][4],
+                       GLchan rgba[][4] )
+{
+   GLuint i;
+   for (i = 0; i < n; i++) {
+      rgba[i][RCOMP] = CHAN_CAST ((1.0F-f[i]) * t0[i][RCOMP] + f[i] * t1[i][RCOMP]);
+      rgba[i][GCOMP] = CHAN_CAST ((1.0F-f[i]) * t0[i][GCOMP] + f[i] * t1[i][GCOMP]);
+      rgba[i][BCOMP] = CHAN_CAST ((1.0F-f[i]) * t0[i][BCOMP] + f[i] * t1[i][BCOMP]);
+      rgba[i][ACOMP] = CHAN_CAST ((1.0F-f[i]) * t0[i][ACOMP] + f[i] * t1[i][ACOMP]);
+   }
+}
+
+
+#ifdef USE_SSE2_INTRIN
+#define USE_SSE2_FILTERS
+#endif
+
+#ifdef USE_SSE2_FILTERS
+
+
+/**
+ * ILERP() of four channels.  (b - a) * w is exact in single precision,
+ * since |b - a| < 2^8 and w is a multiple of 2^-16 in [0, 1].
+ * cvttps truncates towards zero where ILERP's shift rounds towards minus
+ * infinity, so the negative results are corrected.
+ */
+static INLINE SSE2_FUNC __m128i
+ilerp_sse2( __m128 w, __m128i a, __m128i b )
+{
+   const __m128 x = _mm_mul_ps(_mm_cvtepi32_ps(_mm_sub_epi32(b, a)), w);
+   const __m128i t = _mm_cvttps_epi32(x);
+   const __m128i fix = _mm_castps_si128(_mm_cmplt_ps(x, _mm_cvtepi32_ps(t)));
+   return _mm_add_epi32(a, _mm_add_epi32(t, fix));
+}
+
+
+/** Unpack four RGBA ubyte texels to one vector of GLints each */
+#define UNPACK_TEXELS_SSE2(SRC, T)					\
+do {									\
+   const __m128i zero = _mm_setzero_si128();				\
+   const __m128i v = _mm_loadu_si128((const __m128i *) (SRC));		\
+   const __m128i lo = _mm_unpacklo_epi8(v, zero);			\
+   const __m128i hi = _mm_unpackhi_epi8(v, zero);			\
+   T[0] = _mm_unpacklo_epi16(lo, zero);					\
+   T[1] = _mm_unpackhi_epi16(lo, zero);					\
+   T[2] = _mm_unpacklo_epi16(hi, zero);					\
+   T[3] = _mm_unpackhi_epi16(hi, zero);					\
+} while (0)
+
+/** Pack four vectors of GLints in [0, 255] to four RGBA ubyte texels */
+#define PACK_TEXELS_SSE2(T, DST)					\
+   _mm_storeu_si128((__m128i *) (DST),					\
+                    _mm_packus_epi16(_mm_packs_epi32(T[0], T[1]),	\
+                                     _mm_packs_epi32(T[2], T[3])))
+
+/** Broadcast element K of V */
+#define SPLAT_SSE2(V, K)  _mm_shuffle_ps(V, V, _MM_SHUFFLE(K, K, K, K))
+
+
+static SSE2_FUNC void
+bilinear_texels_sse2( GLuint n, const struct bilinear_chunk *chunk,
+                      GLchan rgba[][4] )
+{
+   const __m128 scale = _mm_set1_ps(1.0F / ILERP_SCALE);
+   GLuint i;
+
+   for (i = 0; i + 4 <= n; i += 4) {
+      const __m128 wa = _mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128(
+                                      (const __m128i *) (chunk->ia + i))),
+                                   scale);
+      const __m128 wb = _mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128(
+                                      (const __m128i *) (chunk->ib + i))),
+                                   scale);
+      __m128i t00[4], t10[4], t01[4], t11[4], r[4];
+
+      UNPACK_TEXELS_SSE2(chunk->t00[i], t00);
+      UNPACK_TEXELS_SSE2(chunk->t10[i], t10);
+      UNPACK_TEXELS_SSE2(chunk->t01[i], t01);
+      UNPACK_TEXELS_SSE2(chunk->t11[i], t11);
+
+#define BILERP(K)							\
+      {									\
+         const __m128 a = SPLAT_SSE2(wa, K), b = SPLAT_SSE2(wb, K);	\
+         r[K] = ilerp_sse2(b, ilerp_sse2(a, t00[K], t10[K]),		\
+                              ilerp_sse2(a, t01[K], t11[K]));		\
+      }
+      BILERP(0);
+      BILERP(1);
+      BILERP(2);
+      BILERP(3);
+#undef BILERP
+
+      PACK_TEXELS_SSE2(r, rgba[i]);
+   }
+
+   /* the remaining texels */
+   for (; i < n; i++) {
+      const GLint ia = chunk->ia[i], ib = chunk->ib[i];
+      GLuint c;
+      for (c = 0; c < 4; c++) {
+         rgba[i][c] = ilerp_2d(ia, ib, chunk->t00[i][c], chunk->t10[i][c],
+                               chunk->t01[i][c], chunk->t11[i][c]);
+      }
+   }
+}
+
+
+static SSE2_FUNC void
+blend_mipmap_texels_sse2( GLuint n, const GLfloat f[],
+                          const GLchan t0[][4], const GLchan t1[][4],
+                          GLchan rgba[][4] )
+{
+   const __m128 one = _mm_set1_ps(1.0F);
+   GLuint i;
+
+   for (i = 0; i + 4 <= n; i += 4) {
+      const __m128 f1 = _mm_loadu_ps(f + i);
+      const __m128 f0 = _mm_sub_ps(one, f1);
+      __m128i a[4], b[4], r[4];
+
+      UNPACK_TEXELS_SSE2(t0[i], a);
+      UNPACK_TEXELS_SSE2(t1[i], b);
+
+#define BLEND(K)							\
+      r[K] = _mm_cvttps_epi32(						\
+                _mm_add_ps(_mm_mul_ps(SPLAT_SSE2(f0, K),		\
+                                      _mm_cvtepi32_ps(a[K])),		\
+                           _mm_mul_ps(SPLAT_SSE2(f1, K),		\
+                                      _mm_cvtepi32_ps(b[K]))))
+      BLEND(0);
+      BLEND(1);
+      BLEND(2);
+      BLEND(3);
+#undef BLEND
+
+      PACK_TEXELS_SSE2(r, rgba[i]);
+   }
+
+   if (i < n)
+      blend_mipmap_texels_c(n - i, f + i, t0 + i, t1 + i, rgba + i);
+}
+
+#undef UNPACK_TEXELS_SSE2
+#undef PACK_TEXELS_SSE2
+#undef SPLAT_SSE2
+
+#endif /* USE_SSE2_FILTERS */
+
+
+static bilinear_texels_func bilinear_texels = bilinear_texels_c;
+static blend_mipmap_texels_func blend_mipmap_texels = blend_mipmap_texels_c;
+
+#endif /* CHAN_TYPE == GL_UNSIGNED_BYTE */
+
+
+/**
+ * Choose the texel filtering kernels for this CPU.  Called when a
+ * context is created, after the x86 CPU features have been detected.
+ */
+void
+_swrast_init_texture_filters( void )
+{
+#if defined(USE_SSE2_FILTERS)
+   if (_mesa_have_sse2()) {
+      bilinear_texels = bilinear_texels_sse2;
+      blend_mipmap_texels = blend_mipmap_texels_sse2;
+   }
+   else {
+      bilinear_texels = bilinear_texels_c;
+      blend_mipmap_texels = blend_mipmap_texels_c;
+   }
+#endif
+}
+
+
+
 /**********************************************************************/
 /*                    2-D Texture Sampling Functions                  */
 /**********************************************************************/
@@ -1406,6 +1643,322 @@ sample_lambda_2d( GLcontext *ctx, GLuint texUnit,
 }
 
 
+#if CHAN_TYPE == GL_UNSIGNED_BYTE
+
+/*
+ * 2D sampling functions specialized for the common texture formats.
+ * See s_texsamptemp.h and choose_2d_format_sample_func().
+ *
+ * The 32-bit formats are read a byte at a time, which is faster than
+ * unpacking the texel word.  Their byte order in memory depends on the
+ * host, so the functions for them are named for the byte order and
+ * choose_2d_format_sample_func() picks them at runtime.  Byte order RGBA
+ * is the same as MESA_FORMAT_RGBA.
+ */
+
+#define TEXEL_TYPE GLubyte
+#define TEXEL_SIZE 4
+#define FETCH_TEXEL(DST, SRC)						\
+   DST[RCOMP] = SRC[3];							\
+   DST[GCOMP] = SRC[2];							\
+   DST[BCOMP] = SRC[1];							\
+   DST[ACOMP] = SRC[0]
+#define NAME(PREFIX) PREFIX##_2d_abgr_repeat
+#define WRAP_MODE GL_REPEAT
+#include "s_texsamptemp.h"
+#define NAME(PREFIX) PREFIX##_2d_abgr_clamp_to_edge
+#define WRAP_MODE GL_CLAMP_TO_EDGE
+#include "s_texsamptemp.h"
+#undef TEXEL_TYPE
+#undef TEXEL_SIZE
+#undef FETCH_TEXEL
+
+#define TEXEL_TYPE GLubyte
+#define TEXEL_SIZE 4
+#define FETCH_TEXEL(DST, SRC)						\
+   DST[RCOMP] = SRC[2];							\
+   DST[GCOMP] = SRC[1];							\
+   DST[BCOMP] = SRC[0];							\
+   DST[ACOMP] = SRC[3]
+#define NAME(PREFIX) PREFIX##_2d_bgra_repeat
+#define WRAP_MODE GL_REPEAT
+#include "s_texsamptemp.h"
+#define NAME(PREFIX) PREFIX##_2d_bgra_clamp_to_edge
+#define WRAP_MODE GL_CLAMP_TO_EDGE
+#include "s_texsamptemp.h"
+#undef TEXEL_TYPE
+#undef TEXEL_SIZE
+#undef FETCH_TEXEL
+
+#define TEXEL_TYPE GLubyte
+#define TEXEL_SIZE 4
+#define FETCH_TEXEL(DST, SRC)						\
+   DST[RCOMP] = SRC[1];							\
+   DST[GCOMP] = SRC[2];							\
+   DST[BCOMP] = SRC[3];							\
+   DST[ACOMP] = SRC[0]
+#define NAME(PREFIX) PREFIX##_2d_argb_repeat
+#define WRAP_MODE GL_REPEAT
+#include "s_texsamptemp.h"
+#define NAME(PREFIX) PREFIX##_2d_argb_clamp_to_edge
+#define WRAP_MODE GL_CLAMP_TO_EDGE
+#include "s_texsamptemp.h"
+#undef TEXEL_TYPE
+#undef TEXEL_SIZE
+#undef FETCH_TEXEL
+
+#define TEXEL_TYPE GLushort
+#define TEXEL_SIZE 1
+#define FETCH_TEXEL(DST, SRC)						\
+   DST[RCOMP] = (GLchan) (((SRC[0] >> 8) & 0xf8) | ((SRC[0] >> 13) & 0x7)); \
+   DST[GCOMP] = (GLchan) (((SRC[0] >> 3) & 0xfc) | ((SRC[0] >>  9) & 0x3)); \
+   DST[BCOMP] = (GLchan) (((SRC[0] << 3) & 0xf8) | ((SRC[0] >>  2) & 0x7)); \
+   DST[ACOMP] = CHAN_MAX
+#define NAME(PREFIX) PREFIX##_2d_rgb565_repeat
+#define WRAP_MODE GL_REPEAT
+#include "s_texsamptemp.h"
+#define NAME(PREFIX) PREFIX##_2d_rgb565_clamp_to_edge
+#define WRAP_MODE GL_CLAMP_TO_EDGE
+#include "s_texsamptemp.h"
+#undef TEXEL_TYPE
+#undef TEXEL_SIZE
+#undef FETCH_TEXEL
+
+#define TEXEL_TYPE GLubyte
+#define TEXEL_SIZE 1
+#define FETCH_TEXEL(DST, SRC)						\
+   DST[RCOMP] = DST[GCOMP] = DST[BCOMP] = 0;				\
+   DST[ACOMP] = SRC[0]
+#define ONE_CHANNEL
+#define NAME(PREFIX) PREFIX##_2d_a8_repeat
+#define WRAP_MODE GL_REPEAT
+#include "s_texsamptemp.h"
+#define NAME(PREFIX) PREFIX##_2d_a8_clamp_to_edge
+#define WRAP_MODE GL_CLAMP_TO_EDGE
+#include "s_texsamptemp.h"
+#undef TEXEL_TYPE
+#undef TEXEL_SIZE
+#undef FETCH_TEXEL
+#undef ONE_CHANNEL
+
+#define TEXEL_TYPE GLubyte
+#define TEXEL_SIZE 1
+#define FETCH_TEXEL(DST, SRC)						\
+   DST[RCOMP] = DST[GCOMP] = DST[BCOMP] = SRC[0];			\
+   DST[ACOMP] = CHAN_MAX
+#define ONE_CHANNEL
+#define NAME(PREFIX) PREFIX##_2d_l8_repeat
+#define WRAP_MODE GL_REPEAT
+#include "s_texsamptemp.h"
+#define NAME(PREFIX) PREFIX##_2d_l8_clamp_to_edge
+#define WRAP_MODE GL_CLAMP_TO_EDGE
+#include "s_texsamptemp.h"
+#undef TEXEL_TYPE
+#undef TEXEL_SIZE
+#undef FETCH_TEXEL
+#undef ONE_CHANNEL
+
+#define TEXEL_TYPE GLubyte
+#define TEXEL_SIZE 1
+#define FETCH_TEXEL(DST, SRC)						\
+   DST[RCOMP] = DST[GCOMP] = DST[BCOMP] = DST[ACOMP] = SRC[0]
+#define ONE_CHANNEL
+#define NAME(PREFIX) PREFIX##_2d_i8_repeat
+#define WRAP_MODE GL_REPEAT
+#include "s_texsamptemp.h"
+#define NAME(PREFIX) PREFIX##_2d_i8_clamp_to_edge
+#define WRAP_MODE GL_CLAMP_TO_EDGE
+#include "s_texsamptemp.h"
+#undef TEXEL_TYPE
+#undef TEXEL_SIZE
+#undef FETCH_TEXEL
+#undef ONE_CHANNEL
+
+/* The generic GLchan formats, chosen for unsized internal formats */
+
+#define TEXEL_TYPE GLchan
+#define TEXEL_SIZE 4
+#define FETCH_TEXEL(DST, SRC)	COPY_CHAN4(DST, SRC)
+#define NAME(PREFIX) PREFIX##_2d_rgba_repeat
+#define WRAP_MODE GL_REPEAT
+#include "s_texsamptemp.h"
+#define NAME(PREFIX) PREFIX##_2d_rgba_clamp_to_edge
+#define WRAP_MODE GL_CLAMP_TO_EDGE
+#include "s_texsamptemp.h"
+#undef TEXEL_TYPE
+#undef TEXEL_SIZE
+#undef FETCH_TEXEL
+
+#define TEXEL_TYPE GLchan
+#define TEXEL_SIZE 3
+#define FETCH_TEXEL(DST, SRC)						\
+   DST[RCOMP] = SRC[0];							\
+   DST[GCOMP] = SRC[1];							\
+   DST[BCOMP] = SRC[2];							\
+   DST[ACOMP] = CHAN_MAX
+#define NAME(PREFIX) PREFIX##_2d_rgb_repeat
+#define WRAP_MODE GL_REPEAT
+#include "s_texsamptemp.h"
+#define NAME(PREFIX) PREFIX##_2d_rgb_clamp_to_edge
+#define WRAP_MODE GL_CLAMP_TO_EDGE
+#include "s_texsamptemp.h"
+#undef TEXEL_TYPE
+#undef TEXEL_SIZE
+#undef FETCH_TEXEL
+
+#define TEXEL_TYPE GLchan
+#define TEXEL_SIZE 1
+#define FETCH_TEXEL(DST, SRC)						\
+   DST[RCOMP] = DST[GCOMP] = DST[BCOMP] = 0;				\
+   DST[ACOMP] = SRC[0]
+#define ONE_CHANNEL
+#define NAME(PREFIX) PREFIX##_2d_alpha_repeat
+#define WRAP_MODE GL_REPEAT
+#include "s_texsamptemp.h"
+#define NAME(PREFIX) PREFIX##_2d_alpha_clamp_to_edge
+#define WRAP_MODE GL_CLAMP_TO_EDGE
+#include "s_texsamptemp.h"
+#undef TEXEL_TYPE
+#undef TEXEL_SIZE
+#undef FETCH_TEXEL
+#undef ONE_CHANNEL
+
+#define TEXEL_TYPE GLchan
+#define TEXEL_SIZE 1
+#define FETCH_TEXEL(DST, SRC)						\
+   DST[RCOMP] = DST[GCOMP] = DST[BCOMP] = SRC[0];			\
+   DST[ACOMP] = CHAN_MAX
+#define ONE_CHANNEL
+#define NAME(PREFIX) PREFIX##_2d_luminance_repeat
+#define WRAP_MODE GL_REPEAT
+#include "s_texsamptemp.h"
+#define NAME(PREFIX) PREFIX##_2d_luminance_clamp_to_edge
+#define WRAP_MODE GL_CLAMP_TO_EDGE
+#include "s_texsamptemp.h"
+#undef TEXEL_TYPE
+#undef TEXEL_SIZE
+#undef FETCH_TEXEL
+#undef ONE_CHANNEL
+
+#define TEXEL_TYPE GLchan
+#define TEXEL_SIZE 1
+#define FETCH_TEXEL(DST, SRC)						\
+   DST[RCOMP] = DST[GCOMP] = DST[BCOMP] = DST[ACOMP] = SRC[0]
+#define ONE_CHANNEL
+#define NAME(PREFIX) PREFIX##_2d_intensity_repeat
+#define WRAP_MODE GL_REPEAT
+#include "s_texsamptemp.h"
+#define NAME(PREFIX) PREFIX##_2d_intensity_clamp_to_edge
+#define WRAP_MODE GL_CLAMP_TO_EDGE
+#include "s_texsamptemp.h"
+#undef TEXEL_TYPE
+#undef TEXEL_SIZE
+#undef FETCH_TEXEL
+#undef ONE_CHANNEL
+
+#endif /* CHAN_TYPE == GL_UNSIGNED_BYTE */
+
+
+/**
+ * Return a 2D sampling function specialized for the texture's format and
+ * wrap mode, or NULL if there isn't one and the generic functions (which
+ * go through FetchTexelc) have to be used.
+ */
+static texture_sample_func
+choose_2d_format_sample_func( const struct gl_texture_object *t )
+{
+#if CHAN_TYPE == GL_UNSIGNED_BYTE
+   const struct gl_texture_image *img = t->Image[0][t->BaseLevel];
+   const GLint mesaFormat = img->TexFormat->MesaFormat;
+   const GLuint ui = 1;
+   const GLubyte littleEndian = *((const GLubyte *) &ui);
+   GLboolean repeat;
+
+   if (img->Border != 0 || t->WrapS != t->WrapT)
+      return NULL;
+
+   if (t->WrapS == GL_REPEAT)
+      repeat = GL_TRUE;
+   else if (t->WrapS == GL_CLAMP_TO_EDGE)
+      repeat = GL_FALSE;
+   else
+      return NULL;
+
+   /* the nearest/repeat/power of two case already has faster paths */
+   if (repeat && t->_IsPowerOfTwo &&
+       t->MinFilter == GL_NEAREST && t->MagFilter == GL_NEAREST) {
+      if (mesaFormat == MESA_FORMAT_RGB)
+         return &opt_sample_rgb_2d;
+      else if (mesaFormat == MESA_FORMAT_RGBA)
+         return &opt_sample_rgba_2d;
+   }
+
+   switch (mesaFormat) {
+   case MESA_FORMAT_RGBA8888:
+      if (littleEndian)
+         return repeat ? &sample_2d_abgr_repeat
+                       : &sample_2d_abgr_clamp_to_edge;
+      else
+         return repeat ? &sample_2d_rgba_repeat
+                       : &sample_2d_rgba_clamp_to_edge;
+   case MESA_FORMAT_RGBA8888_REV:
+      if (littleEndian)
+         return repeat ? &sample_2d_rgba_repeat
+                       : &sample_2d_rgba_clamp_to_edge;
+      else
+         return repeat ? &sample_2d_abgr_repeat
+                       : &sample_2d_abgr_clamp_to_edge;
+   case MESA_FORMAT_ARGB8888:
+      if (littleEndian)
+         return repeat ? &sample_2d_bgra_repeat
+                       : &sample_2d_bgra_clamp_to_edge;
+      else
+         return repeat ? &sample_2d_argb_repeat
+                       : &sample_2d_argb_clamp_to_edge;
+   case MESA_FORMAT_ARGB8888_REV:
+      if (littleEndian)
+         return repeat ? &sample_2d_argb_repeat
+                       : &sample_2d_argb_clamp_to_edge;
+      else
+         return repeat ? &sample_2d_bgra_repeat
+                       : &sample_2d_bgra_clamp_to_edge;
+   case MESA_FORMAT_RGB565:
+      return repeat ? &sample_2d_rgb565_repeat
+                    : &sample_2d_rgb565_clamp_to_edge;
+   case MESA_FORMAT_A8:
+      return repeat ? &sample_2d_a8_repeat
+                    : &sample_2d_a8_clamp_to_edge;
+   case MESA_FORMAT_L8:
+      return repeat ? &sample_2d_l8_repeat
+                    : &sample_2d_l8_clamp_to_edge;
+   case MESA_FORMAT_I8:
+      return repeat ? &sample_2d_i8_repeat
+                    : &sample_2d_i8_clamp_to_edge;
+   case MESA_FORMAT_RGBA:
+      return repeat ? &sample_2d_rgba_repeat
+                    : &sample_2d_rgba_clamp_to_edge;
+   case MESA_FORMAT_RGB:
+      return repeat ? &sample_2d_rgb_repeat
+                    : &sample_2d_rgb_clamp_to_edge;
+   case MESA_FORMAT_ALPHA:
+      return repeat ? &sample_2d_alpha_repeat
+                    : &sample_2d_alpha_clamp_to_edge;
+   case MESA_FORMAT_LUMINANCE:
+      return repeat ? &sample_2d_luminance_repeat
+                    : &sample_2d_luminance_clamp_to_edge;
+   case MESA_FORMAT_INTENSITY:
+      return repeat ? &sample_2d_intensity_repeat
+                    : &sample_2d_intensity_clamp_to_edge;
+   default:
+      return NULL;
+   }
+#else
+   (void) t;
+   return NULL;
+#endif
+}
+
+
 
 /**********************************************************************/
 /*                    3-D Texture Sampling Functions                  */
@@ -2740,6 +3293,7 @@ _swrast_choose_texture_sample_func( GLcontext *ctx,
    else {
       const GLboolean needLambda = (GLboolean) (t->MinFilter != t->MagFilter);
       const GLenum format = t->Image[0][t->BaseLevel]->Format;
+      texture_sample_func func;
 
       switch (t->Target) {
       case GL_TEXTURE_1D:
@@ -2760,6 +3314,9 @@ _swrast_choose_texture_sample_func( GLcontext *ctx,
          if (format == GL_DEPTH_COMPONENT) {
             return &sample_depth_texture;
          }
+         else if ((func = choose_2d_format_sample_func(t)) != NULL) {
+            return func;
+         }
          else if (needLambda) {
             return &sample_lambda_2d;
          }
@@ -3875,6 +4432,7 @@ void
 _swrast_texture_span( GLcontext *ctx, struct sw_span *span )
 {
    SWcontext *swrast = SWRAST_CONTEXT(ctx);
+   GLchan *texelBuffer = SWRAST_TEXEL_BUFFER(swrast);
    GLchan primary_rgba[MAX_WIDTH][4];
    GLuint unit;
 
@@ -3897,7 +4455,7 @@ _swrast_texture_span( GLcontext *ctx, struct sw_span *span )
          const struct gl_texture_object *curObj = texUnit->_Current;
          GLfloat *lambda = span->array->lambda[unit];
          GLchan (*texels)[4] = (GLchan (*)[4])
-            (swrast->TexelBuffer + unit * (span->end * 4 * sizeof(GLchan)));
+            (texelBuffer + unit * (span->end * 4 * sizeof(GLchan)));
 
          /* adjust texture lod (lambda) */
          if (span->arrayMask & SPAN_LAMBDA) {
@@ -3946,13 +4504,13 @@ _swrast_texture_span( GLcontext *ctx, struct sw_span *span )
          if (texUnit->_CurrentCombine != &texUnit->_EnvMode ) {
             texture_combine( ctx, unit, span->end,
                              (CONST GLchan (*)[4]) primary_rgba,
-                             swrast->TexelBuffer,
+                             texelBuffer,
                              span->array->rgba );
          }
          else {
             /* conventional texture blend */
             const GLchan (*texels)[4] = (const GLchan (*)[4])
-               (swrast->TexelBuffer + unit *
+               (texelBuffer + unit *
                 (span->end * 4 * sizeof(GLchan)));
             texture_apply( ctx, texUnit, span->end,
                            (CONST GLchan (*)[4]) primary_rgba, texels,
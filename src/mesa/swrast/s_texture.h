@@ -39,4 +39,7 @@ _swrast_choose_texture_sample_func( GLcontext *ctx,
 extern void
 _swrast_texture_span( GLcontext *ctx, struct sw_span *span );
 
+extern void
+_swrast_init_texture_filters( void );
+
 #endif
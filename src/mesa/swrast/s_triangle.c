@@ -673,8 +673,11 @@ fast_persp_span(GLcontext *ctx, struct sw_span *span,
    GLfloat tex_coord[3], tex_step[3];
    GLchan *dest = span->array->rgba[0];
 
-   const GLuint savedTexEnable = ctx->Texture._EnabledUnits;
-   ctx->Texture._EnabledUnits = 0;
+   /* The texture is applied here, so keep the span code from
+    * texturing the span again.  Don't touch ctx->Texture state for
+    * this since spans may be written by several threads at once.
+    */
+   span->interpMask &= ~SPAN_TEXTURE;
 
    tex_coord[0] = span->tex[0][0]  * (info->smask + 1);
    tex_step[0] = span->texStepX[0][0] * (info->smask + 1);
@@ -785,9 +788,6 @@ fast_persp_span(GLcontext *ctx, struct sw_span *span,
 
 #undef SPAN_NEAREST
 #undef SPAN_LINEAR
-
-   /* restore state */
-   ctx->Texture._EnabledUnits = savedTexEnable;
 }
 
 
@@ -1050,18 +1050,31 @@ _swrast_choose_triangle( GLcontext *ctx )
 
    if (ctx->RenderMode==GL_RENDER) {
 
+      /* GL_POLYGON_SMOOTH is ignored while multisampling */
+      if (ctx->Multisample.Enabled && swrast->_NumSamples && rgbmode) {
+         _swrast_set_multisample_triangle_function(ctx);
+         ASSERT(swrast->Triangle);
+         return;
+      }
+
       if (ctx->Polygon.SmoothFlag) {
          _swrast_set_aa_triangle_function(ctx);
          ASSERT(swrast->Triangle);
          return;
       }
 
-      /* special case for occlusion testing */
+      /* special case for occlusion testing, which needs direct access
+       * to the depth buffer (not packed with stencil values, and not
+       * multisampled)
+       */
       if ((ctx->Depth.OcclusionTest || ctx->Occlusion.Active) &&
+          !swrast->_NumSamples &&
           ctx->Depth.Test &&
           ctx->Depth.Mask == GL_FALSE &&
           ctx->Depth.Func == GL_LESS &&
-          !ctx->Stencil.Enabled) {
+          !ctx->Stencil.Enabled &&
+          ctx->DrawBuffer->Attachment[BUFFER_DEPTH].Renderbuffer->Wrapped ==
+          ctx->DrawBuffer->Attachment[BUFFER_DEPTH].Renderbuffer) {
          if ((rgbmode &&
               ctx->Color.ColorMask[0] == 0 &&
               ctx->Color.ColorMask[1] == 0 &&
@@ -1109,7 +1122,8 @@ _swrast_choose_triangle( GLcontext *ctx )
 			&& ctx->Depth.Mask == GL_TRUE)
 		       || swrast->_RasterMask == TEXTURE_BIT)
 		   && ctx->Polygon.StippleFlag == GL_FALSE
-                   && ctx->Visual.depthBits <= 16) {
+                   && ctx->Visual.depthBits <= 16
+                   && !swrast->_NumSamples) {
 		  if (swrast->_RasterMask == (DEPTH_BIT | TEXTURE_BIT)) {
 		     USE(simple_z_textured_triangle);
 		  }
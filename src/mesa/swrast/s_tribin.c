@@ -0,0 +1,506 @@
+/*
+ * Mesa 3-D graphics library
+ * Version:  6.5
+ *
+ * Copyright (C) 1999-2006  Brian Paul   All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * BRIAN PAUL BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ * AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/*
+ * Tile-binned, multi-threaded triangle rasterization.
+ *
+ * When enabled (see _swrast_allow_binning() and the MESA_SWRAST_THREADS
+ * environment variable) swrast->Triangle doesn't draw triangles directly.
+ * Instead, the clipped and set-up window-space vertices are recorded in a
+ * bin along with the triangle function chosen for the current state.
+ * When the bin fills up, or at the end of the vertex buffer, the window
+ * is divided into tiles of BIN_TILE_ROWS full-width rows and a pool of
+ * worker threads rasterizes the tiles in parallel.  Each tile replays
+ * the triangles which touch it in submission order, only writing spans
+ * which fall inside the tile, so per-pixel GL ordering is preserved.
+ *
+ * Tiles span the whole window width since the span functions work on
+ * horizontal runs of pixels; horizontal clipping happens in the usual
+ * span code.
+ *
+ * State which the span functions modify (the occlusion counters, the
+ * fragment program machine, the two-sided stencil facing flag) can't be
+ * shared between threads, so binning is only done when none of those
+ * are in use.
+ *
+ * The worker threads can also run other whole-buffer operations in
+ * bands of rows, see _swrast_run_rows().
+ */
+
+
+#include "glheader.h"
+#include "context.h"
+#include "imports.h"
+#include "macros.h"
+
+#include "s_context.h"
+#include "s_tribin.h"
+
+
+#ifdef PTHREADS
+
+#include "glthread.h"
+
+#define BIN_MAX_THREADS    32
+#define BIN_MAX_TRIANGLES  1024
+#define BIN_TILE_ROWS      16
+
+
+struct bin_triangle {
+   swrast_tri_func func;
+   GLint ymin, ymax;         /**< conservative range of window rows */
+   SWvertex v[3];
+};
+
+
+struct swrast_bin_state {
+   GLcontext *ctx;
+   GLuint NumThreads;        /**< number of threads, including the caller */
+   GLboolean WorkersStarted;
+
+   struct bin_triangle *Tri;
+   GLuint Count;
+
+   struct swrast_bin_thread Thread[BIN_MAX_THREADS];
+   pthread_t Worker[BIN_MAX_THREADS];
+
+   pthread_mutex_t Mutex;
+   pthread_cond_t WorkCond;  /**< signalled when a new flush starts */
+   pthread_cond_t DoneCond;  /**< signalled when the last worker is done */
+   GLuint Generation;        /**< incremented for each flush */
+   GLuint NextTile, NumTiles;
+   GLuint Busy;              /**< workers still busy with this flush */
+   GLboolean Quit;
+
+   /** Set while running _swrast_run_rows() instead of triangles */
+   swrast_rows_func RowsFunc;
+   void *RowsData;
+   GLint RowsY, RowsYEnd;
+};
+
+
+static _glthread_TSD BinThreadTSD;
+static GLboolean BinThreadTSDInit = GL_FALSE;
+_glthread_DECLARE_STATIC_MUTEX(BinThreadTSDMutex);
+
+
+struct swrast_bin_thread *
+_swrast_get_bin_thread( void )
+{
+   return (struct swrast_bin_thread *) _glthread_GetTSD(&BinThreadTSD);
+}
+
+
+/**
+ * Grab tiles until there are none left and rasterize them, or pass
+ * their rows to the RowsFunc.
+ */
+static void
+rasterize_tiles( struct swrast_bin_state *bin,
+                 struct swrast_bin_thread *thread )
+{
+   GLcontext *ctx = bin->ctx;
+
+   for (;;) {
+      GLuint tile, i;
+
+      pthread_mutex_lock(&bin->Mutex);
+      tile = bin->NextTile++;
+      pthread_mutex_unlock(&bin->Mutex);
+
+      if (tile >= bin->NumTiles)
+         return;
+
+      if (bin->RowsFunc) {
+         thread->YMin = bin->RowsY + tile * BIN_TILE_ROWS;
+         thread->YMax = MIN2(thread->YMin + BIN_TILE_ROWS, bin->RowsYEnd);
+         bin->RowsFunc(ctx, bin->RowsData, thread->YMin, thread->YMax);
+         continue;
+      }
+
+      thread->YMin = tile * BIN_TILE_ROWS;
+      thread->YMax = thread->YMin + BIN_TILE_ROWS;
+
+      for (i = 0; i < bin->Count; i++) {
+         const struct bin_triangle *tri = &bin->Tri[i];
+         if (tri->ymax >= thread->YMin && tri->ymin < thread->YMax) {
+            tri->func(ctx, &tri->v[0], &tri->v[1], &tri->v[2]);
+         }
+      }
+   }
+}
+
+
+static void *
+bin_worker( void *data )
+{
+   struct swrast_bin_thread *thread = (struct swrast_bin_thread *) data;
+   struct swrast_bin_state *bin = thread->Bin;
+   GLuint generation = 0;
+
+   _glthread_SetTSD(&BinThreadTSD, thread);
+
+   pthread_mutex_lock(&bin->Mutex);
+   for (;;) {
+      while (bin->Generation == generation && !bin->Quit)
+         pthread_cond_wait(&bin->WorkCond, &bin->Mutex);
+      if (bin->Quit)
+         break;
+      generation = bin->Generation;
+      pthread_mutex_unlock(&bin->Mutex);
+
+      rasterize_tiles(bin, thread);
+
+      pthread_mutex_lock(&bin->Mutex);
+      if (--bin->Busy == 0)
+         pthread_cond_signal(&bin->DoneCond);
+   }
+   pthread_mutex_unlock(&bin->Mutex);
+
+   return NULL;
+}
+
+
+/**
+ * Allocate the per-thread buffers and start the worker threads.
+ * If anything fails we just continue with fewer threads.
+ */
+static void
+start_workers( GLcontext *ctx, struct swrast_bin_state *bin )
+{
+   const GLuint texelBytes = ctx->Const.MaxTextureUnits *
+                             MAX_WIDTH * 4 * sizeof(GLchan);
+   GLuint i;
+
+   bin->WorkersStarted = GL_TRUE;
+
+   for (i = 1; i < bin->NumThreads; i++) {
+      struct swrast_bin_thread *thread = &bin->Thread[i];
+
+      thread->Bin = bin;
+      thread->SpanArrays = MALLOC_STRUCT(span_arrays);
+      thread->TexelBuffer = (GLchan *) MALLOC(texelBytes);
+      if (!thread->SpanArrays || !thread->TexelBuffer ||
+          pthread_create(&bin->Worker[i], NULL, bin_worker, thread) != 0) {
+         if (thread->SpanArrays)
+            FREE(thread->SpanArrays);
+         if (thread->TexelBuffer)
+            FREE(thread->TexelBuffer);
+         break;
+      }
+   }
+
+   bin->NumThreads = i;
+}
+
+
+/**
+ * Process numTiles tiles with the worker threads and the calling thread.
+ */
+static void
+run_tiles( GLcontext *ctx, struct swrast_bin_state *bin, GLuint numTiles )
+{
+   SWcontext *swrast = SWRAST_CONTEXT(ctx);
+   GLuint i;
+
+   if (!bin->WorkersStarted)
+      start_workers(ctx, bin);
+
+   /* The main thread uses the context's own buffers */
+   bin->Thread[0].SpanArrays = swrast->SpanArrays;
+   bin->Thread[0].TexelBuffer = swrast->TexelBuffer;
+   _glthread_SetTSD(&BinThreadTSD, &bin->Thread[0]);
+
+   pthread_mutex_lock(&bin->Mutex);
+   bin->NumTiles = numTiles;
+   bin->NextTile = 0;
+   bin->Busy = bin->NumThreads - 1;
+   bin->Generation++;
+   swrast->_BinRunning = GL_TRUE;
+   pthread_cond_broadcast(&bin->WorkCond);
+   pthread_mutex_unlock(&bin->Mutex);
+
+   rasterize_tiles(bin, &bin->Thread[0]);
+
+   pthread_mutex_lock(&bin->Mutex);
+   while (bin->Busy > 0)
+      pthread_cond_wait(&bin->DoneCond, &bin->Mutex);
+   swrast->_BinRunning = GL_FALSE;
+   pthread_mutex_unlock(&bin->Mutex);
+
+   for (i = 0; i < bin->NumThreads; i++) {
+      swrast->SkippedFragments += bin->Thread[i].SkippedFragments;
+      bin->Thread[i].SkippedFragments = 0;
+   }
+}
+
+
+/**
+ * Rasterize all binned triangles and empty the bins.
+ */
+void
+_swrast_flush_bins( GLcontext *ctx )
+{
+   SWcontext *swrast = SWRAST_CONTEXT(ctx);
+   struct swrast_bin_state *bin = swrast->Bin;
+
+   if (!bin || bin->Count == 0)
+      return;
+
+   run_tiles(ctx, bin, (ctx->DrawBuffer->Height + BIN_TILE_ROWS - 1)
+                       / BIN_TILE_ROWS);
+
+   bin->Count = 0;
+}
+
+
+/**
+ * Call func for rows [y, y + height), split into bands of rows which
+ * are processed in parallel if there are worker threads.  func must
+ * only touch the rows it's given.
+ */
+void
+_swrast_run_rows( GLcontext *ctx, swrast_rows_func func, void *data,
+                  GLint y, GLint height )
+{
+   SWcontext *swrast = SWRAST_CONTEXT(ctx);
+   struct swrast_bin_state *bin = swrast->Bin;
+
+   _swrast_flush_bins(ctx);
+
+   if (!bin || bin->NumThreads < 2 || height <= BIN_TILE_ROWS) {
+      if (height > 0)
+         func(ctx, data, y, y + height);
+      return;
+   }
+
+   bin->RowsFunc = func;
+   bin->RowsData = data;
+   bin->RowsY = y;
+   bin->RowsYEnd = y + height;
+   run_tiles(ctx, bin, (height + BIN_TILE_ROWS - 1) / BIN_TILE_ROWS);
+   bin->RowsFunc = NULL;
+}
+
+
+/**
+ * Installed as swrast->Triangle while binning.  Save a copy of the
+ * vertices and the real triangle function for later.
+ */
+void
+_swrast_bin_triangle( GLcontext *ctx,
+                      const SWvertex *v0,
+                      const SWvertex *v1,
+                      const SWvertex *v2 )
+{
+   SWcontext *swrast = SWRAST_CONTEXT(ctx);
+   struct swrast_bin_state *bin = swrast->Bin;
+   struct bin_triangle *tri;
+   GLfloat ymin, ymax;
+
+   if (bin->Count == BIN_MAX_TRIANGLES)
+      _swrast_flush_bins(ctx);
+
+   tri = &bin->Tri[bin->Count++];
+   tri->func = swrast->BinTriangle;
+   tri->v[0] = *v0;
+   tri->v[1] = *v1;
+   tri->v[2] = *v2;
+
+   ymin = MIN2(v0->win[1], v1->win[1]);
+   ymin = MIN2(ymin, v2->win[1]);
+   ymax = MAX2(v0->win[1], v1->win[1]);
+   ymax = MAX2(ymax, v2->win[1]);
+   tri->ymin = IFLOOR(ymin) - 1;
+   tri->ymax = IFLOOR(ymax) + 1;
+}
+
+
+/**
+ * Can the triangles for the current state be rasterized in parallel?
+ * Called from _swrast_validate_triangle() after _swrast_validate_derived().
+ */
+GLboolean
+_swrast_can_bin_triangles( GLcontext *ctx )
+{
+   const SWcontext *swrast = SWRAST_CONTEXT(ctx);
+
+   if (!swrast->AllowBinning || !swrast->Bin || swrast->Bin->NumThreads < 2)
+      return GL_FALSE;
+   if (ctx->RenderMode != GL_RENDER)
+      return GL_FALSE;
+   if (ctx->Polygon.SmoothFlag)
+      return GL_FALSE;
+   if (swrast->_NumSamples)
+      return GL_FALSE;  /* the span code rebinds the sample buffers */
+   if (swrast->_RasterMask & (OCCLUSION_BIT | FRAGPROG_BIT | ATIFRAGSHADER_BIT))
+      return GL_FALSE;
+   if (ctx->Stencil.Enabled && ctx->Stencil.TestTwoSide)
+      return GL_FALSE;
+
+   return GL_TRUE;
+}
+
+
+/**
+ * Set up the bins.  The number of threads comes from the
+ * MESA_SWRAST_THREADS environment variable; the worker threads
+ * themselves aren't started until the first flush.
+ */
+void
+_swrast_init_bins( GLcontext *ctx )
+{
+   SWcontext *swrast = SWRAST_CONTEXT(ctx);
+   struct swrast_bin_state *bin;
+   const char *env = _mesa_getenv("MESA_SWRAST_THREADS");
+   GLint numThreads = env ? _mesa_atoi(env) : 0;
+
+   if (swrast->Bin || numThreads < 2)
+      return;
+
+   /* Create the thread key now.  _glthread_GetTSD() would create it on
+    * first use, but then several workers (or contexts) could race to do
+    * it and end up with different keys.
+    */
+   _glthread_LOCK_MUTEX(BinThreadTSDMutex);
+   if (!BinThreadTSDInit) {
+      _glthread_InitTSD(&BinThreadTSD);
+      BinThreadTSDInit = GL_TRUE;
+   }
+   _glthread_UNLOCK_MUTEX(BinThreadTSDMutex);
+
+   bin = CALLOC_STRUCT(swrast_bin_state);
+   if (!bin)
+      return;
+
+   bin->Tri = (struct bin_triangle *)
+      MALLOC(BIN_MAX_TRIANGLES * sizeof(struct bin_triangle));
+   if (!bin->Tri) {
+      FREE(bin);
+      return;
+   }
+
+   bin->ctx = ctx;
+   bin->NumThreads = MIN2(numThreads, BIN_MAX_THREADS);
+   bin->Thread[0].Bin = bin;
+   pthread_mutex_init(&bin->Mutex, NULL);
+   pthread_cond_init(&bin->WorkCond, NULL);
+   pthread_cond_init(&bin->DoneCond, NULL);
+
+   swrast->Bin = bin;
+}
+
+
+void
+_swrast_destroy_bins( GLcontext *ctx )
+{
+   SWcontext *swrast = SWRAST_CONTEXT(ctx);
+   struct swrast_bin_state *bin = swrast->Bin;
+   GLuint i;
+
+   if (!bin)
+      return;
+
+   _swrast_flush_bins(ctx);
+
+   if (bin->WorkersStarted) {
+      pthread_mutex_lock(&bin->Mutex);
+      bin->Quit = GL_TRUE;
+      pthread_cond_broadcast(&bin->WorkCond);
+      pthread_mutex_unlock(&bin->Mutex);
+
+      for (i = 1; i < bin->NumThreads; i++) {
+         pthread_join(bin->Worker[i], NULL);
+         FREE(bin->Thread[i].SpanArrays);
+         FREE(bin->Thread[i].TexelBuffer);
+      }
+   }
+
+   pthread_mutex_destroy(&bin->Mutex);
+   pthread_cond_destroy(&bin->WorkCond);
+   pthread_cond_destroy(&bin->DoneCond);
+
+   FREE(bin->Tri);
+   FREE(bin);
+   swrast->Bin = NULL;
+}
+
+
+#else /* PTHREADS */
+
+
+/*
+ * No thread support: triangles are never binned.
+ */
+
+struct swrast_bin_thread *
+_swrast_get_bin_thread( void )
+{
+   return NULL;
+}
+
+void
+_swrast_flush_bins( GLcontext *ctx )
+{
+   (void) ctx;
+}
+
+void
+_swrast_bin_triangle( GLcontext *ctx,
+                      const SWvertex *v0,
+                      const SWvertex *v1,
+                      const SWvertex *v2 )
+{
+   SWRAST_CONTEXT(ctx)->BinTriangle(ctx, v0, v1, v2);
+}
+
+void
+_swrast_run_rows( GLcontext *ctx, swrast_rows_func func, void *data,
+                  GLint y, GLint height )
+{
+   if (height > 0)
+      func(ctx, data, y, y + height);
+}
+
+GLboolean
+_swrast_can_bin_triangles( GLcontext *ctx )
+{
+   (void) ctx;
+   return GL_FALSE;
+}
+
+void
+_swrast_init_bins( GLcontext *ctx )
+{
+   (void) ctx;
+}
+
+void
+_swrast_destroy_bins( GLcontext *ctx )
+{
+   (void) ctx;
+}
+
+#endif /* PTHREADS */
@@ -190,7 +190,14 @@ static void NAME(GLcontext *ctx, const SWvertex *v0,
    const GLint depthBits = ctx->DrawBuffer->Visual.depthBits;
    const GLint fixedToDepthShift = depthBits <= 16 ? FIXED_SHIFT : 0;
    const GLfloat maxDepth = ctx->DrawBuffer->_DepthMaxF;
+   /* non-NULL if spans may be culled with hierarchical Z */
+   const struct swrast_hiz *hiz = SWRAST_CONTEXT(ctx)->_HiZActive
+      ? SWRAST_CONTEXT(ctx)->HiZ : NULL;
 #define FixedToDepth(F)  ((F) >> fixedToDepthShift)
+#define HIDDEN_SPAN(S) \
+   (hiz && _swrast_hiz_reject_span(hiz, &(S), fixedToDepthShift))
+#else
+#define HIDDEN_SPAN(S) GL_FALSE
 #endif
    EdgeT eMaj, eTop, eBot;
    GLfloat oneOverArea;
@@ -200,10 +207,12 @@ static void NAME(GLcontext *ctx, const SWvertex *v0,
    const GLint snapMask = ~((FIXED_ONE / (1 << SUB_PIXEL_BITS)) - 1); /* for x/y coord snapping */
 #endif
    GLinterp vMin_fx, vMin_fy, vMid_fx, vMid_fy, vMax_fx, vMax_fy;
+   GLint binYMin, binYMax;  /* rows we may write, see s_tribin.c */
 
    struct sw_span span;
 
    INIT_SPAN(span, GL_POLYGON, 0, 0, 0);
+   SWRAST_BIN_ROWS(SWRAST_CONTEXT(ctx), binYMin, binYMax);
 
 #ifdef INTERP_Z
    (void) fixedToDepthShift;
@@ -322,6 +331,12 @@ static void NAME(GLcontext *ctx, const SWvertex *v0,
       oneOverArea = 1.0F / area;
    }
 
+#ifdef INTERP_Z
+   /* Is the whole triangle behind the depth buffer contents? */
+   if (hiz && _swrast_hiz_reject_triangle(ctx, v0, v1, v2, binYMin, binYMax))
+      return;
+#endif
+
 
    span.facing = ctx->_Facing; /* for 2-sided stencil test */
 
@@ -1136,8 +1151,10 @@ static void NAME(GLcontext *ctx, const SWvertex *v0,
                /* This is where we actually generate fragments */
                /* XXX the test for span.y > 0 _shouldn't_ be needed but
                 * it fixes a problem on 64-bit Opterons (bug 4842).
+                * binYMin is never negative.
                 */
-               if (span.end > 0 && span.y >= 0) {
+               if (span.end > 0 && span.y >= binYMin && span.y < binYMax
+                   && !HIDDEN_SPAN(span)) {
                   const GLint len = span.end - 1;
                   (void) len;
 #ifdef INTERP_RGB
@@ -1300,6 +1317,7 @@ static void NAME(GLcontext *ctx, const SWvertex *v0,
 #undef T_SCALE
 
 #undef FixedToDepth
+#undef HIDDEN_SPAN
 #undef ColorTemp
 #undef GLinterp
 #undef InterpToInt
@@ -45,6 +45,10 @@ zoom_span( GLcontext *ctx, const struct sw_span *span,
    GLint c0, c1, skipCol;
    GLint i, j;
    const GLuint maxWidth = MIN2( ctx->DrawBuffer->Width, MAX_WIDTH );
+   const GLint zoomX = (ctx->Pixel.ZoomX > -MAX_WIDTH &&
+                        ctx->Pixel.ZoomX < MAX_WIDTH)
+      ? (GLint) ctx->Pixel.ZoomX : 0;
+   GLboolean directWrite;
    struct sw_span zoomed;
    struct span_arrays zoomed_arrays;  /* this is big! */
 
@@ -55,6 +59,14 @@ zoom_span( GLcontext *ctx, const struct sw_span *span,
    INIT_SPAN(zoomed, GL_BITMAP, 0, 0, 0);
    zoomed.array = &zoomed_arrays;
 
+   /* Colors which need no per-fragment operations besides clipping can
+    * be written straight into the color buffer, each row once.
+    */
+   directWrite = (format == GL_RGBA || format == GL_RGB)
+      && (SWRAST_CONTEXT(ctx)->_RasterMask & ~CLIP_BIT) == 0
+      && ctx->Texture._EnabledCoordUnits == 0
+      && ctx->Visual.rgbMode;
+
    /* copy fog interp info */
    zoomed.fog = span->fog;
    zoomed.fogStep = span->fogStep;
@@ -162,6 +174,21 @@ zoom_span( GLcontext *ctx, const struct sw_span *span,
             COPY_CHAN4(zoomed.array->rgba[j], rgba[i]);
          }
       }
+      else if (zoomX == ctx->Pixel.ZoomX) {
+         /* integer zoom: replicate each source pixel zoomX times */
+         const GLint n = (zoomX > 0) ? zoomX : -zoomX;
+         GLint rep = ((GLint) zoomed.start + skipCol) % n;
+         i = ((GLint) zoomed.start + skipCol) / n;
+         if (zoomX < 0)
+            i = span->end - i - 1;
+         for (j = (GLint) zoomed.start; j < (GLint) zoomed.end; j++) {
+            COPY_CHAN4(zoomed.array->rgba[j], rgba[i]);
+            if (++rep == n) {
+               rep = 0;
+               i += (zoomX > 0) ? 1 : -1;
+            }
+         }
+      }
       else {
          /* general solution */
          const GLfloat xscale = 1.0F / ctx->Pixel.ZoomX;
@@ -189,6 +216,24 @@ zoom_span( GLcontext *ctx, const struct sw_span *span,
             zoomed.array->rgba[j][3] = CHAN_MAX;
          }
       }
+      else if (zoomX == ctx->Pixel.ZoomX) {
+         /* integer zoom: replicate each source pixel zoomX times */
+         const GLint n = (zoomX > 0) ? zoomX : -zoomX;
+         GLint rep = ((GLint) zoomed.start + skipCol) % n;
+         i = ((GLint) zoomed.start + skipCol) / n;
+         if (zoomX < 0)
+            i = span->end - i - 1;
+         for (j = (GLint) zoomed.start; j < (GLint) zoomed.end; j++) {
+            zoomed.array->rgba[j][0] = rgb[i][0];
+            zoomed.array->rgba[j][1] = rgb[i][1];
+            zoomed.array->rgba[j][2] = rgb[i][2];
+            zoomed.array->rgba[j][3] = CHAN_MAX;
+            if (++rep == n) {
+               rep = 0;
+               i += (zoomX > 0) ? 1 : -1;
+            }
+         }
+      }
       else {
          /* general solution */
          const GLfloat xscale = 1.0F / ctx->Pixel.ZoomX;
@@ -264,7 +309,24 @@ zoom_span( GLcontext *ctx, const struct sw_span *span,
 
 
    /* write the span in rows [r0, r1) */
-   if (format == GL_RGBA || format == GL_RGB) {
+   if (directWrite) {
+      /* Nothing to do per fragment, just clip to the scissor box and put
+       * the rows into the color buffer.
+       */
+      struct gl_renderbuffer *rb = ctx->DrawBuffer->_ColorDrawBuffers[0][0];
+      const GLint x0 = MAX2(zoomed.x, ctx->DrawBuffer->_Xmin);
+      const GLint x1 = MIN2(zoomed.x + (GLint) zoomed.end,
+                            ctx->DrawBuffer->_Xmax);
+      if (x0 < x1) {
+         r0 = MAX2(r0, ctx->DrawBuffer->_Ymin);
+         r1 = MIN2(r1, ctx->DrawBuffer->_Ymax);
+         for (row = r0; row < r1; row++) {
+            rb->PutRow(ctx, rb, x1 - x0, x0, row,
+                       zoomed.array->rgba[x0 - zoomed.x], NULL);
+         }
+      }
+   }
+   else if (format == GL_RGBA || format == GL_RGB) {
       /* Writing the span may modify the colors, so make a backup now if we're
        * going to call _swrast_write_zoomed_span() more than once.
        * Also, clipping may change the span end value, so store it as well.
@@ -127,6 +127,12 @@ _swrast_ReadPixels( GLcontext *ctx,
 		    const struct gl_pixelstore_attrib *unpack,
 		    GLvoid *pixels );
 
+extern GLboolean
+_swrast_read_rgba_pixels( GLcontext *ctx,
+                          GLint x, GLint y, GLsizei width, GLsizei height,
+                          GLenum format, GLenum type, GLint stride,
+                          GLvoid *pixels );
+
 extern void
 _swrast_Clear( GLcontext *ctx, GLbitfield mask, GLboolean all,
 	       GLint x, GLint y, GLint width, GLint height );
@@ -158,9 +164,23 @@ _swrast_ResetLineStipple( GLcontext *ctx );
 extern void
 _swrast_Point( GLcontext *ctx, const SWvertex *v );
 
+/* Render count points, verts[elts[i]] or, if elts is NULL, verts[i].
+ */
+extern void
+_swrast_Points( GLcontext *ctx, const SWvertex *verts, const GLuint *elts,
+                GLuint count );
+
 extern void
 _swrast_Line( GLcontext *ctx, const SWvertex *v0, const SWvertex *v1 );
 
+/* Render a GL_LINES or GL_LINE_STRIP primitive of count vertices,
+ * verts[elts[i]] or, if elts is NULL, verts[i].  The line stipple is
+ * reset before each separate line.
+ */
+extern void
+_swrast_Lines( GLcontext *ctx, const SWvertex *verts, const GLuint *elts,
+               GLuint count, GLenum mode );
+
 extern void
 _swrast_Triangle( GLcontext *ctx, const SWvertex *v0,
                   const SWvertex *v1, const SWvertex *v2 );
@@ -195,11 +215,23 @@ _swrast_allow_vertex_fog( GLcontext *ctx, GLboolean value );
 extern void
 _swrast_allow_pixel_fog( GLcontext *ctx, GLboolean value );
 
+extern void
+_swrast_allow_binning( GLcontext *ctx, GLboolean value );
+
+extern void
+_swrast_allow_lazy_clears( GLcontext *ctx, GLboolean value );
+
+extern void
+_swrast_allow_async_readpixels( GLcontext *ctx, GLboolean value );
+
 /* Debug:
  */
 extern void
 _swrast_print_vertex( GLcontext *ctx, const SWvertex *v );
 
+extern GLuint
+_swrast_get_skipped_fragments( GLcontext *ctx, GLboolean reset );
+
 
 /*
  * Imaging fallbacks (a better solution should be found, perhaps
@@ -256,6 +288,37 @@ _swrast_copy_texsubimage3d(GLcontext *ctx,
                            GLint x, GLint y, GLsizei width, GLsizei height);
 
 
+/*
+ * Buffer object functions, for asynchronous glReadPixels into pixel
+ * buffer objects (see _swrast_allow_async_readpixels()).
+ */
+extern void
+_swrast_BindBuffer( GLcontext *ctx, GLenum target,
+                    struct gl_buffer_object *obj );
+
+extern void
+_swrast_DeleteBuffer( GLcontext *ctx, struct gl_buffer_object *obj );
+
+extern void
+_swrast_BufferData( GLcontext *ctx, GLenum target, GLsizeiptrARB size,
+                    const GLvoid *data, GLenum usage,
+                    struct gl_buffer_object *obj );
+
+extern void
+_swrast_BufferSubData( GLcontext *ctx, GLenum target, GLintptrARB offset,
+                       GLsizeiptrARB size, const GLvoid *data,
+                       struct gl_buffer_object *obj );
+
+extern void
+_swrast_GetBufferSubData( GLcontext *ctx, GLenum target, GLintptrARB offset,
+                          GLsizeiptrARB size, GLvoid *data,
+                          struct gl_buffer_object *obj );
+
+extern void *
+_swrast_MapBuffer( GLcontext *ctx, GLenum target, GLenum access,
+                   struct gl_buffer_object *obj );
+
+
 /* The driver interface for the software rasterizer.
  * Unless otherwise noted, all functions are mandatory.  
  */
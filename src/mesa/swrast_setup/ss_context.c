@@ -78,6 +78,7 @@ _swsetup_DestroyContext( GLcontext *ctx )
 static void
 _swsetup_RenderPrimitive( GLcontext *ctx, GLenum mode )
 {
+   _swsetup_flush_lines( ctx );
    SWSETUP_CONTEXT(ctx)->render_prim = mode;
    _swrast_render_primitive( ctx, mode );
 }
@@ -165,6 +166,7 @@ _swsetup_RenderStart( GLcontext *ctx )
 static void
 _swsetup_RenderFinish( GLcontext *ctx )
 {
+   _swsetup_flush_lines( ctx );
    _swrast_render_finish( ctx );
 }
 
@@ -194,8 +196,8 @@ _swsetup_Wakeup( GLcontext *ctx )
    /* line */
    /* triangle */
    /* quad */
-   tnl->Driver.Render.PrimTabVerts = _tnl_render_tab_verts;
-   tnl->Driver.Render.PrimTabElts = _tnl_render_tab_elts;
+   tnl->Driver.Render.PrimTabVerts = _swsetup_render_tab_verts;
+   tnl->Driver.Render.PrimTabElts = _swsetup_render_tab_elts;
    tnl->Driver.Render.ResetLineStipple = _swrast_ResetLineStipple;
    tnl->Driver.Render.BuildVertices = _tnl_build_vertices;
    tnl->Driver.Render.Multipass = 0;
@@ -206,6 +208,7 @@ _swsetup_Wakeup( GLcontext *ctx )
 
    swsetup->verts = (SWvertex *)tnl->clipspace.vertex_buf;
    swsetup->last_index = 0;
+   swsetup->line_count = 0;
 }
 
 
@@ -33,11 +33,17 @@
 #include "swrast/swrast.h"
 #include "swrast_setup.h"
 
+/* Number of lines swsetup_line() collects before drawing them.
+ */
+#define SS_LINE_BATCH 256
+
 typedef struct {
    GLuint NewState;
    GLenum render_prim;
    GLuint last_index;
    SWvertex *verts;
+   GLuint line_elts[2 * SS_LINE_BATCH];
+   GLuint line_count;		/* entries in line_elts */
 } SScontext;
 
 #define SWSETUP_CONTEXT(ctx) ((SScontext *)ctx->swsetup_context)
@@ -31,6 +31,7 @@
 #include "mtypes.h"
 
 #include "tnl/t_context.h"
+#include "tnl/t_pipeline.h"
 
 #include "ss_triangle.h"
 #include "ss_context.h"
@@ -44,6 +45,8 @@
 static tnl_triangle_func tri_tab[SS_MAX_TRIFUNC];
 static tnl_quad_func     quad_tab[SS_MAX_TRIFUNC];
 
+static void init_render_tabs( void );
+
 
 static void _swsetup_render_line_tri( GLcontext *ctx,
 				      GLuint e0, GLuint e1, GLuint e2,
@@ -251,31 +254,157 @@ void _swsetup_trifuncs_init( GLcontext *ctx )
    init_offset_unfilled_rgba();
    init_twoside_unfilled_rgba();
    init_offset_twoside_unfilled_rgba();
+
+   init_render_tabs();
 }
 
 
+/* Number of points handed to swrast at once when some are clipped.
+ */
+#define SS_POINT_BATCH 256
+
 static void swsetup_points( GLcontext *ctx, GLuint first, GLuint last )
 {
    struct vertex_buffer *VB = &TNL_CONTEXT(ctx)->vb;
    SWvertex *verts = SWSETUP_CONTEXT(ctx)->verts;
-   GLuint i;
+   const GLuint *elts = VB->Elts;
+   const GLubyte *clipmask = VB->ClipMask;
+   GLuint batch[SS_POINT_BATCH];
+
+   if (VB->ClipOrMask == 0) {
+      /* nothing clipped, pass the whole range */
+      if (elts)
+	 _swrast_Points( ctx, verts, elts + first, last - first );
+      else
+	 _swrast_Points( ctx, verts + first, NULL, last - first );
+      return;
+   }
 
-   if (VB->Elts) {
-      for (i = first; i < last; i++)
-	 if (VB->ClipMask[VB->Elts[i]] == 0)
-	    _swrast_Point( ctx, &verts[VB->Elts[i]] );
+   while (first < last) {
+      GLuint n = 0;
+      for ( ; first < last && n < SS_POINT_BATCH; first++) {
+	 const GLuint e = elts ? elts[first] : first;
+	 if (clipmask[e] == 0)
+	    batch[n++] = e;
+      }
+      if (n)
+	 _swrast_Points( ctx, verts, batch, n );
    }
-   else {
-      for (i = first; i < last; i++)
-	 if (VB->ClipMask[i] == 0)
-	    _swrast_Point( ctx, &verts[i] );
+}
+
+void _swsetup_flush_lines( GLcontext *ctx )
+{
+   SScontext *swsetup = SWSETUP_CONTEXT(ctx);
+
+   if (swsetup->line_count) {
+      _swrast_Lines( ctx, swsetup->verts, swsetup->line_elts,
+		     swsetup->line_count, GL_LINES );
+      swsetup->line_count = 0;
    }
 }
 
+/* Lines between vertices of the vertex buffer are collected and drawn
+ * together at the next primitive or at the end of rendering.  Lines
+ * between vertices made by clipping, which the next clipped primitive
+ * overwrites, and stippled lines, which need the stipple reset between
+ * them, are drawn right away.
+ */
 static void swsetup_line( GLcontext *ctx, GLuint v0, GLuint v1 )
 {
+   SScontext *swsetup = SWSETUP_CONTEXT(ctx);
+   const GLuint count = TNL_CONTEXT(ctx)->vb.Count;
+
+   if (v0 < count && v1 < count && !ctx->Line.StippleFlag) {
+      swsetup->line_elts[swsetup->line_count++] = v0;
+      swsetup->line_elts[swsetup->line_count++] = v1;
+      if (swsetup->line_count == 2 * SS_LINE_BATCH)
+	 _swsetup_flush_lines( ctx );
+   }
+   else {
+      _swsetup_flush_lines( ctx );
+      _swrast_Line( ctx, &swsetup->verts[v0], &swsetup->verts[v1] );
+   }
+}
+
+
+/* Unclipped GL_LINES and GL_LINE_STRIP primitives are handed to swrast
+ * whole, see _swsetup_render_tab_verts/elts.  If something other than
+ * swsetup_line is hooked into tnl's line function we keep out of the
+ * way and use tnl's own render functions.
+ */
+static void swsetup_render_lines( GLcontext *ctx, GLuint start, GLuint count,
+				  GLuint flags, const GLuint *elts,
+				  GLenum mode )
+{
+   TNLcontext *tnl = TNL_CONTEXT(ctx);
    SWvertex *verts = SWSETUP_CONTEXT(ctx)->verts;
-   _swrast_Line( ctx, &verts[v0], &verts[v1] );
+
+   ctx->OcclusionResult = GL_TRUE;
+   tnl->Driver.Render.PrimitiveNotify( ctx, mode );
+
+   if (mode == GL_LINE_STRIP && (flags & PRIM_BEGIN) &&
+       ctx->Line.StippleFlag)
+      tnl->Driver.Render.ResetLineStipple( ctx );
+
+   if (elts)
+      _swrast_Lines( ctx, verts, elts + start, count - start, mode );
+   else
+      _swrast_Lines( ctx, verts + start, NULL, count - start, mode );
+}
+
+static void swsetup_render_lines_verts( GLcontext *ctx, GLuint start,
+					GLuint count, GLuint flags )
+{
+   if (TNL_CONTEXT(ctx)->Driver.Render.Line != swsetup_line)
+      _tnl_render_tab_verts[GL_LINES]( ctx, start, count, flags );
+   else
+      swsetup_render_lines( ctx, start, count, flags, NULL, GL_LINES );
+}
+
+static void swsetup_render_line_strip_verts( GLcontext *ctx, GLuint start,
+					     GLuint count, GLuint flags )
+{
+   if (TNL_CONTEXT(ctx)->Driver.Render.Line != swsetup_line)
+      _tnl_render_tab_verts[GL_LINE_STRIP]( ctx, start, count, flags );
+   else
+      swsetup_render_lines( ctx, start, count, flags, NULL, GL_LINE_STRIP );
+}
+
+static void swsetup_render_lines_elts( GLcontext *ctx, GLuint start,
+				       GLuint count, GLuint flags )
+{
+   if (TNL_CONTEXT(ctx)->Driver.Render.Line != swsetup_line)
+      _tnl_render_tab_elts[GL_LINES]( ctx, start, count, flags );
+   else
+      swsetup_render_lines( ctx, start, count, flags,
+			    TNL_CONTEXT(ctx)->vb.Elts, GL_LINES );
+}
+
+static void swsetup_render_line_strip_elts( GLcontext *ctx, GLuint start,
+					    GLuint count, GLuint flags )
+{
+   if (TNL_CONTEXT(ctx)->Driver.Render.Line != swsetup_line)
+      _tnl_render_tab_elts[GL_LINE_STRIP]( ctx, start, count, flags );
+   else
+      swsetup_render_lines( ctx, start, count, flags,
+			    TNL_CONTEXT(ctx)->vb.Elts, GL_LINE_STRIP );
+}
+
+/* tnl's render tables with the line functions above put in.
+ */
+tnl_render_func _swsetup_render_tab_verts[GL_POLYGON+2];
+tnl_render_func _swsetup_render_tab_elts[GL_POLYGON+2];
+
+static void init_render_tabs( void )
+{
+   MEMCPY( _swsetup_render_tab_verts, _tnl_render_tab_verts,
+	   sizeof(_swsetup_render_tab_verts) );
+   MEMCPY( _swsetup_render_tab_elts, _tnl_render_tab_elts,
+	   sizeof(_swsetup_render_tab_elts) );
+   _swsetup_render_tab_verts[GL_LINES] = swsetup_render_lines_verts;
+   _swsetup_render_tab_verts[GL_LINE_STRIP] = swsetup_render_line_strip_verts;
+   _swsetup_render_tab_elts[GL_LINES] = swsetup_render_lines_elts;
+   _swsetup_render_tab_elts[GL_LINE_STRIP] = swsetup_render_line_strip_elts;
 }
 
 
@@ -30,10 +30,15 @@
 #define SS_TRIANGLE_H
 
 #include "mtypes.h"
+#include "tnl/t_context.h"
 #include "ss_context.h"
 
 
 void _swsetup_trifuncs_init( GLcontext *ctx );
 void _swsetup_choose_trifuncs( GLcontext *ctx );
+void _swsetup_flush_lines( GLcontext *ctx );
+
+extern tnl_render_func _swsetup_render_tab_verts[];
+extern tnl_render_func _swsetup_render_tab_elts[];
 
 #endif
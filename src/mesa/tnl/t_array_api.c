@@ -107,6 +107,154 @@ static void _tnl_draw_range_elements( GLcontext *ctx, GLenum mode,
 
 
 
+/**
+ * Add array element 'elt' to the vertex buffer being built up by
+ * split_drawelements(), unless the vertex cache says it's already there.
+ */
+static INLINE void split_emit_elt( struct tnl_split_elts *split, GLuint elt )
+{
+   GLuint *slot = &split->Cache[elt & (TNL_SPLIT_CACHE_SIZE - 1)];
+   GLuint v = *slot;
+
+   /* Stale cache entries point past the end of the vertex buffer, or at
+    * a vertex which has since been reused for another element.
+    */
+   if (v >= split->nr_verts || split->Map[v] != elt) {
+      v = split->nr_verts++;
+      split->Map[v] = elt;
+      *slot = v;
+   }
+
+   split->Elts[split->nr_elts++] = v;
+}
+
+
+static GLboolean split_flush( GLcontext *ctx, GLenum mode, GLuint flags )
+{
+   TNLcontext *tnl = TNL_CONTEXT(ctx);
+   struct tnl_split_elts *split = &tnl->split;
+   struct tnl_prim prim;
+
+   if (!_tnl_vb_bind_array_elements( ctx, split->Map, split->nr_verts ))
+      return GL_FALSE;
+
+   tnl->vb.Primitive = &prim;
+   tnl->vb.Primitive[0].mode = mode | flags;
+   tnl->vb.Primitive[0].start = 0;
+   tnl->vb.Primitive[0].count = split->nr_elts;
+   tnl->vb.PrimitiveCount = 1;
+
+   tnl->vb.Elts = split->Elts;
+
+   tnl->Driver.RunPipeline( ctx );
+
+   split->nr_verts = 0;
+   split->nr_elts = 0;
+   return GL_TRUE;
+}
+
+
+/**
+ * Draw an element list whose index range doesn't fit in a single vertex
+ * buffer.  The list is cut into runs which reference at most
+ * TNL_SPLIT_VERTS distinct vertices; only those vertices are pulled out
+ * of the arrays and transformed, once per run.
+ */
+static void split_drawelements( GLcontext *ctx, GLenum mode, GLsizei count,
+				const GLuint *indices )
+{
+   TNLcontext *tnl = TNL_CONTEXT(ctx);
+   struct tnl_split_elts *split = &tnl->split;
+   GLuint max_verts = MIN2(TNL_SPLIT_VERTS, ctx->Const.MaxArrayLockSize - 1);
+   GLuint flags = PRIM_BEGIN;
+   GLuint minimum, modulo;
+   GLsizei i, j;
+
+   /* Runs may only be cut at a multiple of 'modulo' indices, and strips
+    * repeat the last 'minimum' indices at the start of the next run.
+    * Cutting triangle strips at an even index keeps the winding.
+    */
+   switch (mode) {
+   case GL_POINTS:
+      minimum = 0;
+      modulo = 1;
+      break;
+   case GL_LINES:
+      minimum = 0;
+      modulo = 2;
+      break;
+   case GL_LINE_STRIP:
+      minimum = 1;
+      modulo = 1;
+      break;
+   case GL_TRIANGLES:
+      minimum = 0;
+      modulo = 3;
+      break;
+   case GL_TRIANGLE_STRIP:
+   case GL_QUAD_STRIP:
+      minimum = 2;
+      modulo = 2;
+      break;
+   case GL_QUADS:
+      minimum = 0;
+      modulo = 4;
+      break;
+   case GL_LINE_LOOP:
+   case GL_TRIANGLE_FAN:
+   case GL_POLYGON:
+   default:
+      /* Fan-like primitives must use the slow path if they cannot fit
+       * in a single vertex buffer.
+       */
+      if ((GLuint) count <= max_verts) {
+	 minimum = 0;
+	 modulo = count;
+      }
+      else {
+	 fallback_drawelements( ctx, mode, count, indices );
+	 return;
+      }
+   }
+
+   FLUSH_CURRENT( ctx, 0 );
+
+   split->nr_verts = 0;
+   split->nr_elts = 0;
+
+   for (i = 0 ; i < count ; i += modulo) {
+      GLuint nr = MIN2(modulo, (GLuint) (count - i));
+
+      if (split->nr_verts + nr > max_verts ||
+	  split->nr_elts + nr > TNL_SPLIT_ELTS) {
+	 if (!split_flush( ctx, mode, flags )) {
+	    /* Out of memory for the gathered arrays.  They're allocated
+	     * for the first run, so nothing has been drawn yet.
+	     */
+	    fallback_drawelements( ctx, mode, count, indices );
+	    return;
+	 }
+
+	 /* Only a line strip continues its stipple pattern into the next
+	  * run, unfilled triangle and quad strips reset it per primitive.
+	  */
+	 if (mode == GL_LINE_STRIP)
+	    flags = 0;
+
+	 for (j = i - minimum ; j < i ; j++)
+	    split_emit_elt( split, indices[j] );
+      }
+
+      for (j = i ; j < i + (GLsizei) nr ; j++)
+	 split_emit_elt( split, indices[j] );
+   }
+
+   if (!split_flush( ctx, mode, flags | PRIM_END ))
+      fallback_drawelements( ctx, mode, count, indices );
+}
+
+
+
 /**
  * Called via the GL API dispatcher.
  */
@@ -303,7 +451,7 @@ _tnl_DrawRangeElements(GLenum mode,
 				   ctx->Array.LockCount,
 				   count, ui_indices );
       else {
-	 fallback_drawelements( ctx, mode, count, ui_indices );
+	 split_drawelements( ctx, mode, count, ui_indices );
       }
    }
    else if (start == 0 && end < ctx->Const.MaxArrayLockSize) {
@@ -313,9 +461,9 @@ _tnl_DrawRangeElements(GLenum mode,
       _tnl_draw_range_elements( ctx, mode, end + 1, count, ui_indices );
    }
    else {
-      /* Range is too big to optimize:
+      /* Range is too big for a single vertexbuffer:
        */
-      fallback_drawelements( ctx, mode, count, ui_indices );
+      split_drawelements( ctx, mode, count, ui_indices );
    }
 }
 
@@ -356,7 +504,7 @@ _tnl_DrawElements(GLenum mode, GLsizei count, GLenum type,
 				   ctx->Array.LockCount,
 				   count, ui_indices );
       else
-	 fallback_drawelements( ctx, mode, count, ui_indices );
+	 split_drawelements( ctx, mode, count, ui_indices );
    }
    else {
       /* Scan the index list and see if we can use the locked path anyway.
@@ -372,7 +520,7 @@ _tnl_DrawElements(GLenum mode, GLsizei count, GLenum type,
 	  max_elt < (GLuint) count) 	           /* do we want to use it? */
 	 _tnl_draw_range_elements( ctx, mode, max_elt+1, count, ui_indices );
       else
-	 fallback_drawelements( ctx, mode, count, ui_indices );
+	 split_drawelements( ctx, mode, count, ui_indices );
    }
 }
 
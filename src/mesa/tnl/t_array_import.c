@@ -252,18 +252,16 @@ static void _tnl_constant_attrib( TNLcontext *tnl,
 
 
 
-void _tnl_vb_bind_arrays( GLcontext *ctx, GLint start, GLint end)
+static void _tnl_vb_bind_inputs( GLcontext *ctx, GLuint count )
 {
    TNLcontext *tnl = TNL_CONTEXT(ctx);
    struct vertex_buffer *VB = &tnl->vb;
    struct tnl_vertex_arrays *tmp = &tnl->array_inputs;
    GLuint i, index;
 
-   VB->Count = end - start;
+   VB->Count = count;
    VB->Elts = NULL;
 
-   _ac_import_range( ctx, start, end );
-
    /* When vertex program mode is enabled, the generic vertex program
     * attribute arrays have priority over the conventional attributes.
     * Try to use them now.
@@ -350,3 +348,25 @@ void _tnl_vb_bind_arrays( GLcontext *ctx, GLint start, GLint end)
       VB->TexCoordPtr[i] = VB->AttribPtr[_TNL_ATTRIB_TEX0 + i];
    }
 }
+
+
+void _tnl_vb_bind_arrays( GLcontext *ctx, GLint start, GLint end)
+{
+   _ac_import_range( ctx, start, end );
+   _tnl_vb_bind_inputs( ctx, end - start );
+}
+
+
+/**
+ * Bind the 'count' array elements listed in 'elts' to the vertex buffer,
+ * so that vertex i of the buffer is array element elts[i].  Returns
+ * GL_FALSE if there's no memory to gather the elements into.
+ */
+GLboolean _tnl_vb_bind_array_elements( GLcontext *ctx, const GLuint *elts,
+				       GLuint count )
+{
+   if (!_ac_import_gather( ctx, elts, count ))
+      return GL_FALSE;
+   _tnl_vb_bind_inputs( ctx, count );
+   return GL_TRUE;
+}
@@ -31,6 +31,10 @@
 
 extern void _tnl_vb_bind_arrays( GLcontext *ctx, GLint start, GLint end );
 
+extern GLboolean _tnl_vb_bind_array_elements( GLcontext *ctx,
+					      const GLuint *elts,
+					      GLuint count );
+
 extern void _tnl_array_import_init( GLcontext *ctx );
 
 #endif
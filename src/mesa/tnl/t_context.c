@@ -42,6 +42,7 @@
 #include "t_context.h"
 #include "t_pipeline.h"
 #include "t_save_api.h"
+#include "t_slice.h"
 #include "t_vp_build.h"
 #include "t_vtx_api.h"
 
@@ -96,6 +97,7 @@ _tnl_CreateContext( GLcontext *ctx )
    _tnl_save_init( ctx );
    _tnl_array_init( ctx );
    _tnl_vtx_init( ctx );
+   _tnl_init_slices( ctx );
 
    if (ctx->_MaintainTnlProgram) 
       _tnl_install_pipeline( ctx, _tnl_vp_pipeline );
@@ -143,6 +145,7 @@ _tnl_DestroyContext( GLcontext *ctx )
    _tnl_vtx_destroy( ctx );
    _tnl_save_destroy( ctx );
    _tnl_destroy_pipeline( ctx );
+   _tnl_destroy_slices( ctx );
    _ae_destroy_context( ctx );
 
    _tnl_ProgramCacheDestroy( ctx );
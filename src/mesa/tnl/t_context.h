@@ -412,6 +412,33 @@ struct tnl_vertex_arrays
 };
 
 
+/* Size of the vertex buffers glDrawElements calls are split into when
+ * their index range doesn't fit in a single vertex buffer.
+ */
+#define TNL_SPLIT_VERTS        1024
+#define TNL_SPLIT_ELTS         (4 * TNL_SPLIT_VERTS)
+#define TNL_SPLIT_CACHE_SIZE   (2 * TNL_SPLIT_VERTS)
+
+/**
+ * Scratch space for splitting glDrawElements calls.  The array elements
+ * referenced by a run of indices are gathered into a vertex buffer of
+ * their own, and the indices are rebased to point into it.
+ */
+struct tnl_split_elts
+{
+   GLuint Elts[TNL_SPLIT_ELTS];	/**< rebased indices */
+   GLuint Map[TNL_SPLIT_VERTS];	/**< vertex buffer slot -> array element */
+   GLuint nr_elts;
+   GLuint nr_verts;
+
+   /** Direct-mapped cache of array element -> vertex buffer slot, so
+    * that indices shared by neighbouring primitives reuse the same
+    * vertex and it is only transformed once.
+    */
+   GLuint Cache[TNL_SPLIT_CACHE_SIZE];
+};
+
+
 /**
  * Contains the current state of a running pipeline.
  */
@@ -728,6 +755,8 @@ struct tnl_device_driver
 };
    
 
+struct tnl_slice_state;
+
 /**
  * Context state for T&L context.
  */
@@ -756,6 +785,11 @@ typedef struct
    struct tnl_vertex_arrays save_inputs;
    struct tnl_vertex_arrays current;
    struct tnl_vertex_arrays array_inputs;
+   struct tnl_split_elts split;
+
+   /* Worker threads for the per-vertex stages, see t_slice.c:
+    */
+   struct tnl_slice_state *Slice;
 
    /* Clipspace/ndc/window vertex managment:
     */
@@ -0,0 +1,315 @@
+/*
+ * Mesa 3-D graphics library
+ * Version:  6.5
+ *
+ * Copyright (C) 1999-2006  Brian Paul   All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * BRIAN PAUL BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ * AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/*
+ * Multi-threaded vertex buffer processing.
+ *
+ * The per-vertex pipeline stages (transform and cliptest, normal
+ * transformation, lighting) hand _tnl_run_slices() a function which
+ * processes a range of vertices.  If the MESA_TNL_THREADS environment
+ * variable asks for more than one thread, large vertex buffers are cut
+ * into contiguous slices which a pool of worker threads and the calling
+ * thread process in parallel.  _tnl_run_slices() only returns once every
+ * slice is done, so the following stages, and the render stage in
+ * particular, see the whole vertex buffer in order exactly as before.
+ *
+ * Stages only use the slices for work which reads the GL state without
+ * modifying it, and write each vertex's results in place, so the output
+ * doesn't depend on the number of threads.
+ */
+
+
+#include "glheader.h"
+#include "context.h"
+#include "imports.h"
+#include "macros.h"
+
+#include "t_context.h"
+#include "t_slice.h"
+
+
+/**
+ * Make view a copy of vector v which only covers elements
+ * [start, start + count).  Vectors with zero stride hold a single
+ * element which all slices share.
+ */
+void
+_tnl_slice_vector( GLvector4f *view, const GLvector4f *v,
+		   GLuint start, GLuint count )
+{
+   *view = *v;
+   view->data = (GLfloat (*)[4]) ((GLubyte *) v->data + start * v->stride);
+   view->start = (GLfloat *) ((GLubyte *) v->start + start * v->stride);
+   view->count = count;
+   view->storage = NULL;
+}
+
+
+#ifdef PTHREADS
+
+#include "glthread.h"
+
+#define SLICE_MAX_THREADS  TNL_MAX_SLICES
+
+/* Vertex buffers with fewer vertices per thread than this aren't worth
+ * the synchronization and are processed by the calling thread alone.
+ */
+#define SLICE_MIN_VERTS    128
+
+
+struct tnl_slice_state {
+   GLcontext *ctx;
+   GLuint NumThreads;        /**< number of threads, including the caller */
+   GLboolean WorkersStarted;
+
+   pthread_t Worker[SLICE_MAX_THREADS];
+
+   pthread_mutex_t Mutex;
+   pthread_cond_t WorkCond;  /**< signalled when a new run starts */
+   pthread_cond_t DoneCond;  /**< signalled when the last worker is done */
+   GLuint Generation;        /**< incremented for each run */
+   GLuint Busy;              /**< workers still busy with this run */
+   GLboolean Quit;
+
+   tnl_slice_func Func;
+   void *Data;
+   GLuint Count;
+   GLuint NumSlices, NextSlice;
+};
+
+
+/**
+ * Grab slices until there are none left.
+ */
+static void
+process_slices( struct tnl_slice_state *sl )
+{
+   for (;;) {
+      GLuint slice, start, end;
+
+      pthread_mutex_lock(&sl->Mutex);
+      slice = sl->NextSlice++;
+      pthread_mutex_unlock(&sl->Mutex);
+
+      if (slice >= sl->NumSlices)
+	 return;
+
+      start = sl->Count * slice / sl->NumSlices;
+      end = sl->Count * (slice + 1) / sl->NumSlices;
+      sl->Func(sl->ctx, sl->Data, slice, start, end - start);
+   }
+}
+
+
+static void *
+slice_worker( void *data )
+{
+   struct tnl_slice_state *sl = (struct tnl_slice_state *) data;
+   GLuint generation = 0;
+
+   pthread_mutex_lock(&sl->Mutex);
+   for (;;) {
+      unsigned short __tmp;
+
+      while (sl->Generation == generation && !sl->Quit)
+	 pthread_cond_wait(&sl->WorkCond, &sl->Mutex);
+      if (sl->Quit)
+	 break;
+      generation = sl->Generation;
+      pthread_mutex_unlock(&sl->Mutex);
+
+      /* Use the same FPU precision as the calling thread, which is
+       * inside _tnl_run_pipeline().
+       */
+      START_FAST_MATH(__tmp);
+      process_slices(sl);
+      END_FAST_MATH(__tmp);
+
+      pthread_mutex_lock(&sl->Mutex);
+      if (--sl->Busy == 0)
+	 pthread_cond_signal(&sl->DoneCond);
+   }
+   pthread_mutex_unlock(&sl->Mutex);
+
+   return NULL;
+}
+
+
+/**
+ * Start the worker threads.  If that fails we just continue with fewer
+ * threads.
+ */
+static void
+start_workers( struct tnl_slice_state *sl )
+{
+   GLuint i;
+
+   sl->WorkersStarted = GL_TRUE;
+
+   for (i = 1; i < sl->NumThreads; i++) {
+      if (pthread_create(&sl->Worker[i], NULL, slice_worker, sl) != 0)
+	 break;
+   }
+
+   sl->NumThreads = i;
+}
+
+
+/**
+ * Call func for vertices [0, count), split into slices which are
+ * processed in parallel if there are worker threads.  func must only
+ * write the results of the vertices it's given.  Returns the number of
+ * slices used, so that callers can combine per-slice results.
+ */
+GLuint
+_tnl_run_slices( GLcontext *ctx, tnl_slice_func func, void *data,
+		 GLuint count )
+{
+   struct tnl_slice_state *sl = TNL_CONTEXT(ctx)->Slice;
+   GLuint numSlices;
+
+   if (!sl || count < 2 * SLICE_MIN_VERTS) {
+      func(ctx, data, 0, 0, count);
+      return 1;
+   }
+
+   if (!sl->WorkersStarted)
+      start_workers(sl);
+
+   numSlices = MIN2(sl->NumThreads, count / SLICE_MIN_VERTS);
+   if (numSlices < 2) {
+      func(ctx, data, 0, 0, count);
+      return 1;
+   }
+
+   pthread_mutex_lock(&sl->Mutex);
+   sl->Func = func;
+   sl->Data = data;
+   sl->Count = count;
+   sl->NumSlices = numSlices;
+   sl->NextSlice = 0;
+   sl->Busy = sl->NumThreads - 1;
+   sl->Generation++;
+   pthread_cond_broadcast(&sl->WorkCond);
+   pthread_mutex_unlock(&sl->Mutex);
+
+   process_slices(sl);
+
+   pthread_mutex_lock(&sl->Mutex);
+   while (sl->Busy > 0)
+      pthread_cond_wait(&sl->DoneCond, &sl->Mutex);
+   pthread_mutex_unlock(&sl->Mutex);
+
+   return numSlices;
+}
+
+
+/**
+ * Set up the worker pool.  The number of threads comes from the
+ * MESA_TNL_THREADS environment variable; the threads themselves aren't
+ * started until the first large vertex buffer.
+ */
+void
+_tnl_init_slices( GLcontext *ctx )
+{
+   TNLcontext *tnl = TNL_CONTEXT(ctx);
+   struct tnl_slice_state *sl;
+   const char *env = _mesa_getenv("MESA_TNL_THREADS");
+   GLint numThreads = env ? _mesa_atoi(env) : 0;
+
+   if (tnl->Slice || numThreads < 2)
+      return;
+
+   sl = CALLOC_STRUCT(tnl_slice_state);
+   if (!sl)
+      return;
+
+   sl->ctx = ctx;
+   sl->NumThreads = MIN2(numThreads, SLICE_MAX_THREADS);
+   pthread_mutex_init(&sl->Mutex, NULL);
+   pthread_cond_init(&sl->WorkCond, NULL);
+   pthread_cond_init(&sl->DoneCond, NULL);
+
+   tnl->Slice = sl;
+}
+
+
+void
+_tnl_destroy_slices( GLcontext *ctx )
+{
+   TNLcontext *tnl = TNL_CONTEXT(ctx);
+   struct tnl_slice_state *sl = tnl->Slice;
+   GLuint i;
+
+   if (!sl)
+      return;
+
+   if (sl->WorkersStarted) {
+      pthread_mutex_lock(&sl->Mutex);
+      sl->Quit = GL_TRUE;
+      pthread_cond_broadcast(&sl->WorkCond);
+      pthread_mutex_unlock(&sl->Mutex);
+
+      for (i = 1; i < sl->NumThreads; i++)
+	 pthread_join(sl->Worker[i], NULL);
+   }
+
+   pthread_mutex_destroy(&sl->Mutex);
+   pthread_cond_destroy(&sl->WorkCond);
+   pthread_cond_destroy(&sl->DoneCond);
+
+   FREE(sl);
+   tnl->Slice = NULL;
+}
+
+
+#else /* PTHREADS */
+
+
+/*
+ * No thread support: the whole vertex buffer is a single slice.
+ */
+
+GLuint
+_tnl_run_slices( GLcontext *ctx, tnl_slice_func func, void *data,
+		 GLuint count )
+{
+   func(ctx, data, 0, 0, count);
+   return 1;
+}
+
+void
+_tnl_init_slices( GLcontext *ctx )
+{
+   (void) ctx;
+}
+
+void
+_tnl_destroy_slices( GLcontext *ctx )
+{
+   (void) ctx;
+}
+
+#endif /* PTHREADS */
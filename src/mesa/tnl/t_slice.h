@@ -0,0 +1,55 @@
+/*
+ * Mesa 3-D graphics library
+ * Version:  6.5
+ *
+ * Copyright (C) 1999-2006  Brian Paul   All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * BRIAN PAUL BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ * AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef _T_SLICE_H_
+#define _T_SLICE_H_
+
+#include "mtypes.h"
+#include "math/m_vector.h"
+
+
+/* Upper bound on the number of slices a vertex buffer is split into.
+ */
+#define TNL_MAX_SLICES  32
+
+
+/* Process vertices [start, start + count) of the vertex buffer.  slice
+ * is the index of this slice, less than the value returned by
+ * _tnl_run_slices().
+ */
+typedef void (*tnl_slice_func)( GLcontext *ctx, void *data,
+				GLuint slice, GLuint start, GLuint count );
+
+extern GLuint _tnl_run_slices( GLcontext *ctx, tnl_slice_func func,
+			       void *data, GLuint count );
+
+extern void _tnl_slice_vector( GLvector4f *view, const GLvector4f *v,
+			       GLuint start, GLuint count );
+
+extern void _tnl_init_slices( GLcontext *ctx );
+
+extern void _tnl_destroy_slices( GLcontext *ctx );
+
+#endif
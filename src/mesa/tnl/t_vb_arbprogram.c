@@ -1029,7 +1029,7 @@ static void free_tnl_data( struct vertex_program *program  )
 {
    struct tnl_compiled_program *p = program->TnlData;
    if (p->compiled_func)
-      _mesa_free((void *)p->compiled_func);
+      _mesa_exec_free((void *)p->compiled_func);
    _mesa_free(p);
    program->TnlData = NULL;
 }
@@ -1071,7 +1071,7 @@ static void compile_vertex_program( struct vertex_program *program,
       _mesa_printf("\n\n");
    }
    
-#ifdef USE_SSE_ASM
+#if defined(USE_SSE_ASM) || defined(USE_X86_64_ASM)
    if (try_codegen)
       _tnl_sse_codegen_vertex_program(p);
 #endif
@@ -139,6 +139,12 @@ struct output {
 #define RESTORE_FPU (FAST_X86_FPU)
 #define RND_NEG_FPU (FAST_X86_FPU | 0x400)
 #endif
+#elif defined(USE_X86_64_ASM)
+/* No fast math mode on x86-64, the x87 control word stays at the
+ * hardware default.
+ */
+#define RESTORE_FPU 0x037f
+#define RND_NEG_FPU (0x037f | 0x400)
 #else
 #define RESTORE_FPU 0
 #define RND_NEG_FPU 0
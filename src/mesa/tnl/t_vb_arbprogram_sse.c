@@ -48,10 +48,12 @@
 #include "t_context.h"
 #include "t_vb_arbprogram.h"
 
-#if defined(USE_SSE_ASM)
+#if defined(USE_SSE_ASM) || defined(USE_X86_64_ASM)
 
 #include "x86/rtasm/x86sse.h"
+#if defined(USE_SSE_ASM)
 #include "x86/common_x86_asm.h"
+#endif
 
 #define X    0
 #define Y    1
@@ -67,10 +69,22 @@
  * EBP,
  * ESI,
  * EDI
+ *
+ * On x86-64 these are the full 64-bit registers, and XMM8-15 are
+ * available to the register allocator too.
  */
 
 #define DISASSEM 0
 
+#if defined(USE_X86_64_ASM)
+#define NR_XMM 16
+#else
+#define NR_XMM 8
+#endif
+
+/** Code buffer space reserved per instruction while compiling */
+#define MAX_INSN_BYTES 512
+
 #define FAIL								\
 do {									\
    _mesa_printf("x86 translation failed in %s\n", __FUNCTION__);	\
@@ -87,7 +101,7 @@ struct compilation {
       GLuint idx:7;
       GLuint dirty:1;
       GLuint last_used:10;
-   } xmm[8];
+   } xmm[NR_XMM];
 
    struct {
       struct x86_reg base;
@@ -148,7 +162,7 @@ static struct x86_reg get_xmm_reg( struct compilation *cp )
    GLuint i;
    GLuint oldest = 0;
 
-   for (i = 0; i < 8; i++) 
+   for (i = 0; i < NR_XMM; i++) 
       if (cp->xmm[i].last_used < cp->xmm[oldest].last_used)
 	 oldest = i;
 
@@ -170,9 +184,9 @@ static void invalidate_xmm( struct compilation *cp,
 {
    GLuint i;
 
-   /* Invalidate any old copy of this register in XMM0-7.  
+   /* Invalidate any old copy of this register in the XMM regs.
     */
-   for (i = 0; i < 8; i++) {
+   for (i = 0; i < NR_XMM; i++) {
       if (cp->xmm[i].file == file && cp->xmm[i].idx == idx) {
 	 cp->xmm[i].file = FILE_REG;
 	 cp->xmm[i].idx = REG_UNDEF;
@@ -190,8 +204,8 @@ static struct x86_reg get_dst_xmm_reg( struct compilation *cp,
 {
    struct x86_reg reg;
 
-   /* Invalidate any old copy of this register in XMM0-7.  Don't reuse
-    * as this may be one of the arguments.
+   /* Invalidate any old copy of this register in the XMM regs.  Don't
+    * reuse as this may be one of the arguments.
     */
    invalidate_xmm( cp, file, idx );
 
@@ -208,8 +222,8 @@ static struct x86_reg get_dst_xmm_reg( struct compilation *cp,
 static struct x86_reg get_dst_ptr( struct compilation *cp, 
 				   GLuint file, GLuint idx )
 {
-   /* Invalidate any old copy of this register in XMM0-7.  Don't reuse
-    * as this may be one of the arguments.
+   /* Invalidate any old copy of this register in the XMM regs.  Don't
+    * reuse as this may be one of the arguments.
     */
    invalidate_xmm( cp, file, idx );
 
@@ -225,7 +239,7 @@ static struct x86_reg get_arg( struct compilation *cp, GLuint file, GLuint idx )
 {
    GLuint i;
 
-   for (i = 0; i < 8; i++) {
+   for (i = 0; i < NR_XMM; i++) {
       if (cp->xmm[i].file == file &&
 	  cp->xmm[i].idx == idx) {
 	 cp->xmm[i].last_used = cp->insn_counter;
@@ -245,7 +259,7 @@ static struct x86_reg get_arg_ptr( struct compilation *cp, GLuint file, GLuint i
    /* If there is a modified version of this register in one of the
     * XMM regs, write it out to memory.
     */
-   for (i = 0; i < 8; i++) {
+   for (i = 0; i < NR_XMM; i++) {
       if (cp->xmm[i].file == file && 
 	  cp->xmm[i].idx == idx &&
 	  cp->xmm[i].dirty) 
@@ -301,15 +315,15 @@ static GLboolean emit_RSW( struct compilation *cp, union instruction op )
    if (neg) {
       struct x86_reg negs = get_arg(cp, FILE_REG, REG_SWZ);
       struct x86_reg tmp = get_xmm_reg(cp);
-      /* Load 1,-1,0,0
+      /* Load -1,1,0,0
        * Use neg as arg to pshufd
        * Multiply
        */
-      emit_pshufd(cp, tmp, negs, 
-		  SHUF((neg & 1) ? 1 : 0,
-		       (neg & 2) ? 1 : 0,
-		       (neg & 4) ? 1 : 0,
-		       (neg & 8) ? 1 : 0));
+      emit_pshufd(cp, tmp, negs,
+		  SHUF((neg & 1) ? 0 : 1,
+		       (neg & 2) ? 0 : 1,
+		       (neg & 4) ? 0 : 1,
+		       (neg & 8) ? 0 : 1));
       sse_mulps(&cp->func, dst, tmp);
    }
 
@@ -336,7 +350,9 @@ static GLboolean emit_shuf_copy1( struct compilation *cp,
 }
 
 
-/* Helper for writemask:
+/* Helper for writemask: dst gets the two elements of arg1 which shuf
+ * moves to X and Y, and the other two elements of arg0.  shuf must be
+ * its own inverse.
  */
 static GLboolean emit_shuf_copy2( struct compilation *cp,
 				  struct x86_reg dst,
@@ -355,23 +371,25 @@ static GLboolean emit_shuf_copy2( struct compilation *cp,
 }
 
 
+/* Replace a in st0 with 2^a, leaving the rest of the x87 stack as it
+ * was.  Uses two more stack slots.
+ */
 static void emit_x87_ex2( struct compilation *cp )
 {
    struct x86_reg st0 = x86_make_reg(file_x87, 0);
    struct x86_reg st1 = x86_make_reg(file_x87, 1);
-   struct x86_reg st3 = x86_make_reg(file_x87, 3);
 
    set_fpu_round_neg_inf( cp );
 
    x87_fld(&cp->func, st0); /* a a */
    x87_fprndint( &cp->func );	/* int(a) a */
-   x87_fld(&cp->func, st0); /* int(a) int(a) a */
-   x87_fstp(&cp->func, st3); /* int(a) a int(a)*/
-   x87_fsubp(&cp->func, st1); /* frac(a) int(a) */
+   x87_fsub(&cp->func, st1, st0); /* int(a) frac(a) */
+   x87_fxch(&cp->func, st1); /* frac(a) int(a) */
    x87_f2xm1(&cp->func);    /* (2^frac(a))-1 int(a)*/
    x87_fld1(&cp->func);    /* 1 (2^frac(a))-1 int(a)*/
    x87_faddp(&cp->func, st1);	/* 2^frac(a) int(a) */
-   x87_fscale(&cp->func);	/* 2^a */
+   x87_fscale(&cp->func);	/* 2^a int(a) */
+   x87_fstp(&cp->func, st1);	/* 2^a */
 }
 
 #if 0
@@ -437,13 +455,13 @@ static GLboolean emit_MSK( struct compilation *cp, union instruction op )
       return GL_TRUE;
 
    case WRITEMASK_XY:
-      sse_movups(&cp->func, dst, dst0);
-      sse_shufps(&cp->func, dst, arg, SHUF(X, Y, Z, W));
+      sse_movups(&cp->func, dst, arg);
+      sse_shufps(&cp->func, dst, dst0, SHUF(X, Y, Z, W));
       return GL_TRUE;
 
    case WRITEMASK_ZW: 
-      sse_movups(&cp->func, dst, arg);
-      sse_shufps(&cp->func, dst, dst0, SHUF(X, Y, Z, W));
+      sse_movups(&cp->func, dst, dst0);
+      sse_shufps(&cp->func, dst, arg, SHUF(X, Y, Z, W));
       return GL_TRUE;
 
    case WRITEMASK_YZW: 
@@ -472,18 +490,19 @@ static GLboolean emit_MSK( struct compilation *cp, union instruction op )
       return GL_TRUE;
 
    case WRITEMASK_XZ:
-      emit_shuf_copy2(cp, dst, arg, dst0, SHUF(X,Z,Y,W));
+      emit_shuf_copy2(cp, dst, dst0, arg, SHUF(X,Z,Y,W));
       return GL_TRUE;
 
    case WRITEMASK_XW: 
-      emit_shuf_copy2(cp, dst, arg, dst0, SHUF(X,W,Z,Y));
+      emit_shuf_copy2(cp, dst, dst0, arg, SHUF(X,W,Z,Y));
+      return GL_TRUE;
 
    case WRITEMASK_YZ:      
-      emit_shuf_copy2(cp, dst, arg, dst0, SHUF(Z,Y,X,W));
+      emit_shuf_copy2(cp, dst, dst0, arg, SHUF(Z,Y,X,W));
       return GL_TRUE;
 
    case WRITEMASK_YW:
-      emit_shuf_copy2(cp, dst, arg, dst0, SHUF(W,Y,Z,X));
+      emit_shuf_copy2(cp, dst, dst0, arg, SHUF(W,Y,Z,X));
       return GL_TRUE;
 
    case WRITEMASK_XZW:
@@ -595,11 +614,15 @@ static GLboolean emit_DPH( struct compilation *cp, union instruction op )
    struct x86_reg arg1 = get_arg(cp, op.alu.file1, op.alu.idx1); 
    struct x86_reg dst = get_dst_xmm_reg(cp, FILE_REG, op.alu.dst);
    struct x86_reg ones = get_reg_ptr(FILE_REG, REG_ONES);
-   struct x86_reg tmp = get_xmm_reg(cp);      
+   struct x86_reg tmp = get_xmm_reg(cp);
 
+   /* A movss from memory clears the upper three elements, so go
+    * through tmp to replace arg0[3] with 1.0:
+    */
    emit_pshufd(cp, dst, arg0, SHUF(W,X,Y,Z));
-   sse_movss(&cp->func, dst, ones);
-   emit_pshufd(cp, dst, dst, SHUF(W,X,Y,Z));
+   sse_movss(&cp->func, tmp, ones);
+   sse_movss(&cp->func, dst, tmp);
+   emit_pshufd(cp, dst, dst, SHUF(Y,Z,W,X));
    sse_mulps(&cp->func, dst, arg1);
    
    /* Now the hard bit: sum the values (from DP4):
@@ -696,10 +719,10 @@ static GLboolean emit_EX2( struct compilation *cp, union instruction op )
 
    emit_x87_ex2(cp);
 
-   x87_fst(&cp->func, x86_make_disp(dst, 0));    
-   x87_fst(&cp->func, x86_make_disp(dst, 4));    
-   x87_fst(&cp->func, x86_make_disp(dst, 8));    
-   x87_fst(&cp->func, x86_make_disp(dst, 12));    
+   x87_fst(&cp->func, x86_make_disp(dst, 0));
+   x87_fst(&cp->func, x86_make_disp(dst, 4));
+   x87_fst(&cp->func, x86_make_disp(dst, 8));
+   x87_fstp(&cp->func, x86_make_disp(dst, 12));
    return GL_TRUE;
 }
 
@@ -709,7 +732,6 @@ static GLboolean emit_EXP( struct compilation *cp, union instruction op )
     struct x86_reg dst = get_dst_ptr(cp, FILE_REG, op.alu.dst); 
     struct x86_reg st0 = x86_make_reg(file_x87, 0);
     struct x86_reg st1 = x86_make_reg(file_x87, 1);
-    struct x86_reg st3 = x86_make_reg(file_x87, 3);
 
     /* CAUTION: dst may alias arg0!
      */
@@ -723,20 +745,20 @@ static GLboolean emit_EXP( struct compilation *cp, union instruction op )
      */
     set_fpu_round_neg_inf( cp );
     x87_fprndint( &cp->func );	/* flr(a) a */
-    x87_fld(&cp->func, st0); /* flr(a) flr(a) a */
-    x87_fld1(&cp->func);    /* 1 floor(a) floor(a) a */
+    x87_fsub(&cp->func, st1, st0); /* flr(a) frac(a) */
+    x87_fld1(&cp->func);    /* 1 flr(a) frac(a) */
     x87_fst(&cp->func, x86_make_disp(dst, 12));  /* stack unchanged */
-    x87_fscale(&cp->func);  /* 2^floor(a) floor(a) a */
-    x87_fst(&cp->func, st3); /* 2^floor(a) floor(a) a 2^floor(a)*/
-    x87_fstp(&cp->func, x86_make_disp(dst, 0)); /* flr(a) a 2^flr(a) */
-    x87_fsubrp(&cp->func, st1); /* frac(a) 2^flr(a) */
+    x87_fscale(&cp->func);  /* 2^flr(a) flr(a) frac(a) */
+    x87_fstp(&cp->func, st1); /* 2^flr(a) frac(a) */
+    x87_fst(&cp->func, x86_make_disp(dst, 0)); /* 2^flr(a) frac(a) */
+    x87_fxch(&cp->func, st1); /* frac(a) 2^flr(a) */
     x87_fst(&cp->func, x86_make_disp(dst, 4));    /* frac(a) 2^flr(a) */
     x87_f2xm1(&cp->func);    /* (2^frac(a))-1 2^flr(a)*/
     x87_fld1(&cp->func);    /* 1 (2^frac(a))-1 2^flr(a)*/
     x87_faddp(&cp->func, st1);	/* 2^frac(a) 2^flr(a) */
     x87_fmulp(&cp->func, st1);	/* 2^a */
-    x87_fst(&cp->func, x86_make_disp(dst, 8));    
-    
+    x87_fstp(&cp->func, x86_make_disp(dst, 8));
+
 
 
 /*    dst[0] = 2^floor(tmp); */
@@ -752,26 +774,22 @@ static GLboolean emit_LOG( struct compilation *cp, union instruction op )
     struct x86_reg dst = get_dst_ptr(cp, FILE_REG, op.alu.dst); 
     struct x86_reg st0 = x86_make_reg(file_x87, 0);
     struct x86_reg st1 = x86_make_reg(file_x87, 1);
-    struct x86_reg st2 = x86_make_reg(file_x87, 2);
- 
+
     /* CAUTION: dst may alias arg0!
      */
     x87_fld(&cp->func, arg0);	/* arg0.x */
     x87_fabs(&cp->func);	/* |arg0.x| */
     x87_fxtract(&cp->func);	/* mantissa(arg0.x), exponent(arg0.x) */
-    x87_fst(&cp->func, st2);	/* mantissa, exponent, mantissa */
-    x87_fld1(&cp->func);	/* 1, mantissa, exponent, mantissa */
-    x87_fyl2x(&cp->func); 	/* log2(mantissa), exponent, mantissa */
-    x87_fadd(&cp->func, st0, st1);	/* e+l2(m), e, m  */
-    x87_fstp(&cp->func, x86_make_disp(dst, 8)); /* e, m */
-
-    x87_fld1(&cp->func);	/* 1, e, m */
-    x87_fsub(&cp->func, st1, st0);	/* 1, e-1, m */
-    x87_fstp(&cp->func, x86_make_disp(dst, 12)); /* e-1,m */
-    x87_fstp(&cp->func, dst);	/* m */
+    x87_fst(&cp->func, x86_make_disp(dst, 4)); /* m, e */
+    x87_fld1(&cp->func);	/* 1, m, e */
+    x87_fxch(&cp->func, st1);	/* m, 1, e */
+    x87_fyl2x(&cp->func); 	/* log2(m), e */
+    x87_fadd(&cp->func, st0, st1);	/* e+l2(m), e */
+    x87_fstp(&cp->func, x86_make_disp(dst, 8)); /* e */
+    x87_fstp(&cp->func, x86_make_disp(dst, 0));
 
-    x87_fadd(&cp->func, st0, st0);	/* 2m */
-    x87_fstp(&cp->func, x86_make_disp(dst, 4));	
+    x87_fld1(&cp->func);	/* 1 */
+    x87_fstp(&cp->func, x86_make_disp(dst, 12));
 
     return GL_TRUE;
 }
@@ -811,7 +829,7 @@ static GLboolean emit_FRC( struct compilation *cp, union instruction op )
       x87_fld(&cp->func, x86_make_disp(arg0, i*4));   
       x87_fld(&cp->func, st0);	/* a a */
       x87_fprndint( &cp->func );   /* flr(a) a */
-      x87_fsubrp(&cp->func, st1); /* frc(a) */
+      x87_fsubp(&cp->func, st1); /* frc(a) */
       x87_fstp(&cp->func, x86_make_disp(dst, i*4));
    }
 
@@ -827,52 +845,59 @@ static GLboolean emit_LIT( struct compilation *cp, union instruction op )
    struct x86_reg dst = get_dst_ptr(cp, FILE_REG, op.alu.dst); 
    struct x86_reg lit = get_arg(cp, FILE_REG, REG_LIT);
    struct x86_reg tmp = get_xmm_reg(cp);
+   struct x86_reg st0 = x86_make_reg(file_x87, 0);
    struct x86_reg st1 = x86_make_reg(file_x87, 1);
-   struct x86_reg regEAX = x86_make_reg(file_REG32, reg_AX);
+   struct x86_reg st2 = x86_make_reg(file_x87, 2);
    GLubyte *fixup1, *fixup2;
 
+   /* Set the rounding mode for emit_x87_ex2() here, as the code which
+    * follows is conditional.
+    */
+   set_fpu_round_neg_inf( cp );
 
    /* Load the interesting parts of arg0:
     */
    x87_fld(&cp->func, x86_make_disp(arg0, 12));	/* a3 */
    x87_fld(&cp->func, x86_make_disp(arg0, 4)); /* a1 a3 */
    x87_fld(&cp->func, x86_make_disp(arg0, 0)); /* a0 a1 a3 */
-   
+
    /* Intialize dst:
     */
    sse_movaps(&cp->func, tmp, lit);
    sse_movaps(&cp->func, dst, tmp);
-   
+
    /* Check arg0[0]:
     */
    x87_fldz(&cp->func);		/* 0 a0 a1 a3 */
-   x87_fucomp(&cp->func, st1);	/* a0 a1 a3 */
-   x87_fnstsw(&cp->func, regEAX);
-   x86_sahf(&cp->func);
-   fixup1 = x86_jcc_forward(&cp->func, cc_AE); 
-   
-   x87_fstp(&cp->func, x86_make_disp(dst, 4));	/* a1 a3 */
+   x87_fucomip(&cp->func, st1);	/* a0 a1 a3 */
+   fixup1 = x86_jcc_forward(&cp->func, cc_AE);
+
+   x87_fst(&cp->func, x86_make_disp(dst, 4));	/* a0 a1 a3 */
 
    /* Check arg0[1]:
-    */ 
-   x87_fldz(&cp->func);		/* 0 a1 a3 */
-   x87_fucomp(&cp->func, st1);	/* a1 a3 */
-   x87_fnstsw(&cp->func, regEAX);
-   x86_sahf(&cp->func);
-   fixup2 = x86_jcc_forward(&cp->func, cc_AE); 
+    */
+   x87_fldz(&cp->func);		/* 0 a0 a1 a3 */
+   x87_fucomip(&cp->func, st2);	/* a0 a1 a3 */
+   fixup2 = x86_jcc_forward(&cp->func, cc_AE);
 
    /* Compute pow(a1, a3)
     */
-   x87_fyl2x(&cp->func);	/* a3*log2(a1) */
+   x87_fld(&cp->func, st2);	/* a3 a0 a1 a3 */
+   x87_fld(&cp->func, st2);	/* a1 a3 a0 a1 a3 */
+   x87_fyl2x(&cp->func);	/* a3*log2(a1) a0 a1 a3 */
 
-   emit_x87_ex2( cp );		/* 2^(a3*log2(a1)) */
+   emit_x87_ex2( cp );		/* 2^(a3*log2(a1)) a0 a1 a3 */
 
-   x87_fstp(&cp->func, x86_make_disp(dst, 8));
-   
-   /* Land jumps:
+   x87_fstp(&cp->func, x86_make_disp(dst, 8)); /* a0 a1 a3 */
+
+   /* Land jumps, all paths have the same stack:
     */
    x86_fixup_fwd_jump(&cp->func, fixup1);
    x86_fixup_fwd_jump(&cp->func, fixup2);
+
+   x87_fstp(&cp->func, st0);	/* a1 a3 */
+   x87_fstp(&cp->func, st0);	/* a3 */
+   x87_fstp(&cp->func, st0);
 #else
    struct x86_reg dst = get_dst_xmm_reg(cp, FILE_REG, op.alu.dst); 
    struct x86_reg ones = get_reg_ptr(FILE_REG, REG_LIT);
@@ -962,20 +987,18 @@ static GLboolean emit_REL( struct compilation *cp, union instruction op )
    FAIL;
 }
 
+/* The rcpss and rsqrtss approximations are only good to 12 bits,
+ * well short of what the vertex program specs require, so do a full
+ * precision divide (and square root) instead.
+ */
 static GLboolean emit_RCP( struct compilation *cp, union instruction op )
 {
    struct x86_reg arg0 = get_arg(cp, op.alu.file0, op.alu.idx0);
    struct x86_reg dst = get_dst_xmm_reg(cp, FILE_REG, op.alu.dst);
+   struct x86_reg ones = get_reg_ptr(FILE_REG, REG_ONES);
 
-   if (cp->have_sse2) {
-      sse2_rcpss(&cp->func, dst, arg0);
-   }
-   else {
-      struct x86_reg ones = get_reg_ptr(FILE_REG, REG_ONES);
-      sse_movss(&cp->func, dst, ones);
-      sse_divss(&cp->func, dst, arg0);
-   }
-
+   sse_movss(&cp->func, dst, ones);
+   sse_divss(&cp->func, dst, arg0);
    sse_shufps(&cp->func, dst, dst, SHUF(X, X, X, X));
    return GL_TRUE;
 }
@@ -984,17 +1007,21 @@ static GLboolean emit_RSQ( struct compilation *cp, union instruction op )
 {
    struct x86_reg arg0 = get_arg(cp, op.alu.file0, op.alu.idx0);
    struct x86_reg dst = get_dst_xmm_reg(cp, FILE_REG, op.alu.dst);
+   struct x86_reg neg = get_reg_ptr(FILE_REG, REG_NEG);
+   struct x86_reg ones = get_reg_ptr(FILE_REG, REG_ONES);
+   struct x86_reg tmp = get_xmm_reg(cp);
 
-   /* TODO: Calculate absolute value
+   /* Absolute value, as for ABS:
     */
-#if 0
-   sse_movss(&cp->func, dst, arg0);
-   sse_mulss(&cp->func, dst, neg);
-   sse_maxss(&cp->func, dst, arg0);
-#endif
+   sse_movss(&cp->func, tmp, arg0);
+   sse_movaps(&cp->func, dst, tmp);
+   sse_mulps(&cp->func, dst, neg);
+   sse_maxps(&cp->func, dst, tmp);
 
-   sse_rsqrtss(&cp->func, dst, arg0);
-   sse_shufps(&cp->func, dst, dst, SHUF(X, X, X, X));
+   sse_sqrtps(&cp->func, dst, dst);
+   sse_movss(&cp->func, tmp, ones);
+   sse_divss(&cp->func, tmp, dst);
+   emit_pshufd(cp, dst, tmp, SHUF(X, X, X, X));
    return GL_TRUE;
 }
 
@@ -1143,7 +1170,7 @@ static GLboolean build_vertex_program( struct compilation *cp )
 
    /* TODO: only for outputs:
     */
-   for (j = 0; j < 8; j++) {
+   for (j = 0; j < NR_XMM; j++) {
       if (cp->xmm[j].dirty) 
 	 spill(cp, j);
    }
@@ -1180,17 +1207,27 @@ GLboolean
 _tnl_sse_codegen_vertex_program(struct tnl_compiled_program *p)
 {
    struct compilation cp;
+   GLuint size;
+   GLubyte *code;
    
    memset(&cp, 0, sizeof(cp));
    cp.p = p;
    cp.have_sse2 = 1;
 
    if (p->compiled_func) {
-      _mesa_free((void *)p->compiled_func);
+      _mesa_exec_free((void *)p->compiled_func);
       p->compiled_func = NULL;
    }
 
-   x86_init_func(&cp.func);
+   /* Assemble into ordinary memory, then copy just the bytes used to
+    * the executable heap.  A fixed size buffer (as allocated by
+    * x86_init_func) would be too small for long programs.
+    */
+   size = (p->nr_instructions + 1) * MAX_INSN_BYTES;
+   cp.func.store = (GLubyte *) _mesa_malloc(size);
+   if (!cp.func.store)
+      return GL_FALSE;
+   cp.func.csr = cp.func.store;
 
    cp.fpucntl = RESTORE_FPU;
 
@@ -1199,13 +1236,19 @@ _tnl_sse_codegen_vertex_program(struct tnl_compiled_program *p)
     * depends only on the list of instructions:
     */
    if (!build_vertex_program(&cp)) {
-      x86_release_func( &cp.func );
+      _mesa_free(cp.func.store);
       return GL_FALSE;
    }
 
+   assert(cp.func.csr - cp.func.store <= (GLint) size);
 
-   p->compiled_func = (void (*)(struct arb_vp_machine *))x86_get_func( &cp.func );
-   return GL_TRUE;
+   code = (GLubyte *) _mesa_exec_malloc(cp.func.csr - cp.func.store);
+   if (code)
+      _mesa_memcpy(code, cp.func.store, cp.func.csr - cp.func.store);
+   _mesa_free(cp.func.store);
+
+   p->compiled_func = (void (*)(struct arb_vp_machine *)) code;
+   return code != NULL;
 }
 
 
@@ -1215,7 +1258,8 @@ _tnl_sse_codegen_vertex_program(struct tnl_compiled_program *p)
 GLboolean
 _tnl_sse_codegen_vertex_program(struct tnl_compiled_program *p)
 {
-   /* Dummy version for when USE_SSE_ASM not defined */
+   /* Dummy version for when neither USE_SSE_ASM nor USE_X86_64_ASM
+    * is defined */
    return GL_FALSE;
 }
 
@@ -33,9 +33,11 @@
 #include "mtypes.h"
 
 #include "math/m_translate.h"
+#include "x86/common_x86_sse2.h"
 
 #include "t_context.h"
 #include "t_pipeline.h"
+#include "t_slice.h"
 
 #define LIGHT_TWOSIDE       0x1
 #define LIGHT_MATERIAL      0x2
@@ -55,6 +57,7 @@ struct material_cursor {
    GLuint stride;         /* stride to next vertex color (bytes) */
    GLfloat *current;      /* points to material attribute to update */
    GLuint size;           /* vertex/color size: 1, 2, 3 or 4 */
+   GLuint attr;           /* MAT_ATTRIB_x being updated */
 };
 
 /**
@@ -143,6 +146,7 @@ prepare_materials(GLcontext *ctx,
 	 store->mat[j].stride = VB->AttribPtr[i]->stride;
 	 store->mat[j].size   = VB->AttribPtr[i]->size;
 	 store->mat[j].current = ctx->Light.Material.Attrib[attr];
+	 store->mat[j].attr   = attr;
 	 store->mat_bitmask |= (1<<attr);
       }
    }
@@ -155,6 +159,383 @@ prepare_materials(GLcontext *ctx,
    return store->mat_count;
 }
 
+
+/*
+ * SSE2 versions of light_rgba() and light_fast_rgba() which light four
+ * vertices at a time.
+ */
+#ifdef USE_SSE2_INTRIN
+
+#define SOA_LANES 4
+
+/* The material attributes which the SSE2 functions can take from the
+ * vertex colors.  Tracking the shininess or the color indexes falls back
+ * to the C functions.
+ */
+#define SOA_MATERIAL_BITS (MAT_BIT_FRONT_AMBIENT | MAT_BIT_BACK_AMBIENT |	\
+			   MAT_BIT_FRONT_DIFFUSE | MAT_BIT_BACK_DIFFUSE |	\
+			   MAT_BIT_FRONT_SPECULAR | MAT_BIT_BACK_SPECULAR |	\
+			   MAT_BIT_FRONT_EMISSION | MAT_BIT_BACK_EMISSION)
+
+/* Element l of a vector, for filling in vectors one vertex at a time.
+ */
+#define SOA_LANE(v, l)  (((GLfloat *) &(v))[l])
+
+/**
+ * An enabled light, with the values used by the lighting loops splatted
+ * across all lanes.  The _Mat values have one lane per vertex when they
+ * come from GL_COLOR_MATERIAL.
+ */
+struct soa_light {
+   __m128 VP_inf_norm[3];
+   __m128 h_inf_norm[3];
+   __m128 VP_inf_spot_attenuation;
+   __m128 Position[3];
+   __m128 Attenuation[3];	/* constant, linear, quadratic */
+   __m128 Ambient[3];
+   __m128 Diffuse[3];
+   __m128 Specular[3];
+   __m128 _MatAmbient[2][3];
+   __m128 _MatDiffuse[2][3];
+   __m128 _MatSpecular[2][3];
+};
+
+/**
+ * The lighting state for the SSE2 functions, set up once per call.
+ */
+struct soa_lighting {
+   __m128 BaseColor[2][3];
+   __m128 Alpha[2];
+   __m128 EyeZDir[3];
+   const struct gl_shine_tab *ShineTable[2];
+   GLuint NumLights;
+   struct soa_light Light[MAX_LIGHTS];
+};
+
+
+static INLINE SSE2_FUNC void
+soa_set1_3v( __m128 dst[3], const GLfloat *v )
+{
+   dst[0] = _mm_set1_ps(v[0]);
+   dst[1] = _mm_set1_ps(v[1]);
+   dst[2] = _mm_set1_ps(v[2]);
+}
+
+
+/**
+ * Set up the lighting state from the current light and material values.
+ */
+static void SSE2_FUNC
+soa_setup_lighting( GLcontext *ctx, struct soa_lighting *sl )
+{
+   const struct gl_light *light;
+   GLuint side, i = 0;
+
+   for (side = 0; side < 2; side++) {
+      soa_set1_3v(sl->BaseColor[side], ctx->Light._BaseColor[side]);
+      sl->Alpha[side] =
+	 _mm_set1_ps(ctx->Light.Material.Attrib[MAT_ATTRIB_DIFFUSE(side)][3]);
+      sl->ShineTable[side] = ctx->_ShineTable[side];
+   }
+   soa_set1_3v(sl->EyeZDir, ctx->_EyeZDir);
+
+   foreach (light, &ctx->Light.EnabledList) {
+      struct soa_light *l = &sl->Light[i++];
+
+      soa_set1_3v(l->VP_inf_norm, light->_VP_inf_norm);
+      soa_set1_3v(l->h_inf_norm, light->_h_inf_norm);
+      l->VP_inf_spot_attenuation = _mm_set1_ps(light->_VP_inf_spot_attenuation);
+      soa_set1_3v(l->Position, light->_Position);
+      l->Attenuation[0] = _mm_set1_ps(light->ConstantAttenuation);
+      l->Attenuation[1] = _mm_set1_ps(light->LinearAttenuation);
+      l->Attenuation[2] = _mm_set1_ps(light->QuadraticAttenuation);
+      soa_set1_3v(l->Ambient, light->Ambient);
+      soa_set1_3v(l->Diffuse, light->Diffuse);
+      soa_set1_3v(l->Specular, light->Specular);
+      for (side = 0; side < 2; side++) {
+	 soa_set1_3v(l->_MatAmbient[side], light->_MatAmbient[side]);
+	 soa_set1_3v(l->_MatDiffuse[side], light->_MatDiffuse[side]);
+	 soa_set1_3v(l->_MatSpecular[side], light->_MatSpecular[side]);
+      }
+   }
+   sl->NumLights = i;
+}
+
+
+/**
+ * Load x, y and z of n (at most four) vectors, repeating the last one in
+ * the unused lanes.
+ */
+static INLINE SSE2_FUNC void
+soa_load_3fv( __m128 v[3], const GLfloat *p, GLuint stride, GLuint n )
+{
+   const GLfloat *p0 = p;
+   const GLfloat *p1 = n > 1 ? (const GLfloat *) ((GLubyte *) p0 + stride) : p0;
+   const GLfloat *p2 = n > 2 ? (const GLfloat *) ((GLubyte *) p1 + stride) : p1;
+   const GLfloat *p3 = n > 3 ? (const GLfloat *) ((GLubyte *) p2 + stride) : p2;
+
+   v[0] = _mm_setr_ps(p0[0], p1[0], p2[0], p3[0]);
+   v[1] = _mm_setr_ps(p0[1], p1[1], p2[1], p3[1]);
+   v[2] = _mm_setr_ps(p0[2], p1[2], p2[2], p3[2]);
+}
+
+
+/**
+ * As soa_load_3fv(), for the four components of vectors of the given
+ * size, filling in the missing ones as COPY_CLEAN_4V() does.
+ */
+static INLINE SSE2_FUNC void
+soa_load_clean_4fv( __m128 v[4], const GLfloat *p, GLuint stride,
+		    GLuint size, GLuint n )
+{
+   const GLfloat *p0 = p;
+   const GLfloat *p1 = n > 1 ? (const GLfloat *) ((GLubyte *) p0 + stride) : p0;
+   const GLfloat *p2 = n > 2 ? (const GLfloat *) ((GLubyte *) p1 + stride) : p1;
+   const GLfloat *p3 = n > 3 ? (const GLfloat *) ((GLubyte *) p2 + stride) : p2;
+   GLuint c;
+
+   for (c = 0; c < 4; c++) {
+      if (c < size)
+	 v[c] = _mm_setr_ps(p0[c], p1[c], p2[c], p3[c]);
+      else
+	 v[c] = _mm_set1_ps(c == 3 ? 1.0F : 0.0F);
+   }
+}
+
+
+/**
+ * Store n (at most four) colors.
+ */
+static INLINE SSE2_FUNC void
+soa_store_color( GLfloat (*dst)[4], const __m128 rgb[3], __m128 a, GLuint n )
+{
+   __m128 r = rgb[0], g = rgb[1], b = rgb[2];
+
+   _MM_TRANSPOSE4_PS(r, g, b, a);
+
+   _mm_storeu_ps(dst[0], r);
+   if (n > 1) _mm_storeu_ps(dst[1], g);
+   if (n > 2) _mm_storeu_ps(dst[2], b);
+   if (n > 3) _mm_storeu_ps(dst[3], a);
+}
+
+
+static INLINE SSE2_FUNC __m128
+soa_dot3( const __m128 a[3], const __m128 b[3] )
+{
+   return _mm_add_ps(_mm_add_ps(_mm_mul_ps(a[0], b[0]),
+				_mm_mul_ps(a[1], b[1])),
+		     _mm_mul_ps(a[2], b[2]));
+}
+
+
+static INLINE SSE2_FUNC __m128
+soa_select( __m128 mask, __m128 a, __m128 b )
+{
+   return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+
+/**
+ * As NORMALIZE_3FV(), in each lane.
+ */
+static INLINE SSE2_FUNC void
+soa_normalize_3fv( __m128 v[3] )
+{
+   const __m128 len = soa_dot3(v, v);
+   const __m128 nonzero = _mm_cmpneq_ps(len, _mm_setzero_ps());
+   const __m128 inv = _mm_div_ps(_mm_set1_ps(1.0F), _mm_sqrt_ps(len));
+
+   v[0] = soa_select(nonzero, _mm_mul_ps(v[0], inv), v[0]);
+   v[1] = soa_select(nonzero, _mm_mul_ps(v[1], inv), v[1]);
+   v[2] = soa_select(nonzero, _mm_mul_ps(v[2], inv), v[2]);
+}
+
+
+static INLINE SSE2_FUNC void
+soa_select_3v( __m128 dst[3], __m128 mask, const __m128 a[3],
+	       const __m128 b[3] )
+{
+   dst[0] = soa_select(mask, a[0], b[0]);
+   dst[1] = soa_select(mask, a[1], b[1]);
+   dst[2] = soa_select(mask, a[2], b[2]);
+}
+
+
+/**
+ * As SCALE_3V(), in each lane.
+ */
+static INLINE SSE2_FUNC void
+soa_scale_3v( __m128 dst[3], const __m128 a[3], const __m128 b[3] )
+{
+   dst[0] = _mm_mul_ps(a[0], b[0]);
+   dst[1] = _mm_mul_ps(a[1], b[1]);
+   dst[2] = _mm_mul_ps(a[2], b[2]);
+}
+
+
+/**
+ * dst = a + scale * b
+ */
+static INLINE SSE2_FUNC void
+soa_mad_3v( __m128 dst[3], const __m128 a[3], __m128 scale,
+	    const __m128 b[3] )
+{
+   dst[0] = _mm_add_ps(a[0], _mm_mul_ps(scale, b[0]));
+   dst[1] = _mm_add_ps(a[1], _mm_mul_ps(scale, b[1]));
+   dst[2] = _mm_add_ps(a[2], _mm_mul_ps(scale, b[2]));
+}
+
+
+static INLINE SSE2_FUNC void
+soa_acc_3v( __m128 sum[3], const __m128 v[3] )
+{
+   sum[0] = _mm_add_ps(sum[0], v[0]);
+   sum[1] = _mm_add_ps(sum[1], v[1]);
+   sum[2] = _mm_add_ps(sum[2], v[2]);
+}
+
+
+/**
+ * sum += scale * v in the lanes selected by mask.
+ */
+static INLINE SSE2_FUNC void
+soa_acc_scale_3v( __m128 sum[3], __m128 mask, __m128 scale,
+		  const __m128 v[3] )
+{
+   sum[0] = _mm_add_ps(sum[0], _mm_and_ps(mask, _mm_mul_ps(scale, v[0])));
+   sum[1] = _mm_add_ps(sum[1], _mm_and_ps(mask, _mm_mul_ps(scale, v[1])));
+   sum[2] = _mm_add_ps(sum[2], _mm_and_ps(mask, _mm_mul_ps(scale, v[2])));
+}
+
+
+/**
+ * As _mesa_update_material() for the color material attributes of
+ * vertices [j, j + n), one lane per vertex.  Only the first 'sides'
+ * sides are updated.
+ */
+static void SSE2_FUNC
+soa_color_material( GLcontext *ctx, const struct light_stage_data *store,
+		    struct soa_lighting *sl, GLuint j, GLuint n, GLuint sides )
+{
+   const GLuint bitmask = store->mat_bitmask;
+   __m128 mat[MAT_ATTRIB_MAX][4];
+   GLuint i, side;
+
+   for (i = 0; i < store->mat_count; i++) {
+      const struct material_cursor *cur = &store->mat[i];
+      soa_load_clean_4fv( mat[cur->attr],
+			  (const GLfloat *) ((const GLubyte *) cur->ptr +
+					     j * cur->stride),
+			  cur->stride, cur->size, n );
+   }
+
+   for (side = 0; side < sides; side++) {
+      const GLuint amb = MAT_ATTRIB_AMBIENT(side);
+      const GLuint diff = MAT_ATTRIB_DIFFUSE(side);
+      const GLuint spec = MAT_ATTRIB_SPECULAR(side);
+      const GLuint em = MAT_ATTRIB_EMISSION(side);
+
+      if (bitmask & ((1 << em) | (1 << amb))) {
+	 __m128 ModelAmbient[3];
+
+	 if (!(bitmask & (1 << em)))
+	    soa_set1_3v(mat[em], ctx->Light.Material.Attrib[em]);
+	 if (!(bitmask & (1 << amb)))
+	    soa_set1_3v(mat[amb], ctx->Light.Material.Attrib[amb]);
+
+	 soa_set1_3v(ModelAmbient, ctx->Light.Model.Ambient);
+	 soa_scale_3v(sl->BaseColor[side], mat[amb], ModelAmbient);
+	 soa_acc_3v(sl->BaseColor[side], mat[em]);
+      }
+
+      if (bitmask & (1 << diff))
+	 sl->Alpha[side] = mat[diff][3];
+
+      for (i = 0; i < sl->NumLights; i++) {
+	 struct soa_light *l = &sl->Light[i];
+
+	 if (bitmask & (1 << amb))
+	    soa_scale_3v(l->_MatAmbient[side], l->Ambient, mat[amb]);
+	 if (bitmask & (1 << diff))
+	    soa_scale_3v(l->_MatDiffuse[side], l->Diffuse, mat[diff]);
+	 if (bitmask & (1 << spec))
+	    soa_scale_3v(l->_MatSpecular[side], l->Specular, mat[spec]);
+      }
+   }
+}
+
+
+/**
+ * Leave the material as update_materials() would have after lighting
+ * all nr vertices one at a time.
+ */
+static void
+soa_finish_materials( GLcontext *ctx, struct light_stage_data *store,
+		      GLuint nr )
+{
+   GLuint i;
+
+   for (i = 0; i < store->mat_count; i++)
+      STRIDE_F(store->mat[i].ptr, (nr - 1) * store->mat[i].stride);
+
+   update_materials( ctx, store );
+}
+
+
+/**
+ * As GET_SHINE_TAB_ENTRY(), for the lanes selected by mask which have a
+ * positive n_dot_h; the others get zero.  Lanes in the back bitmask use
+ * the back material's shine table.  Only the table reads are done per
+ * lane, so there are no data dependent branches except for the rare
+ * _mesa_pow() fallback.
+ */
+static INLINE SSE2_FUNC __m128
+soa_shine( const struct soa_lighting *sl, __m128 mask, GLuint back,
+	   __m128 n_dot_h )
+{
+   const __m128 live = _mm_and_ps(mask, _mm_cmpgt_ps(n_dot_h, _mm_setzero_ps()));
+   const __m128 f = _mm_and_ps(live, _mm_mul_ps(n_dot_h,
+					       _mm_set1_ps(SHINE_TABLE_SIZE-1)));
+   const __m128i k = _mm_cvttps_epi32(_mm_min_ps(f,
+					_mm_set1_ps(SHINE_TABLE_SIZE-2)));
+   const __m128 big = _mm_cmpge_ps(f, _mm_set1_ps(SHINE_TABLE_SIZE-1));
+   GLint ki[SOA_LANES];
+   const GLfloat *t[SOA_LANES];
+   __m128 coef;
+   GLuint l, pow_lanes;
+
+   if (!_mm_movemask_ps(live))
+      return live;
+
+   _mm_storeu_si128((__m128i *) ki, k);
+   for (l = 0; l < SOA_LANES; l++)
+      t[l] = sl->ShineTable[(back >> l) & 1]->tab + ki[l];
+
+   coef = _mm_setr_ps(t[0][0], t[1][0], t[2][0], t[3][0]);
+   coef = _mm_add_ps(coef, _mm_mul_ps(_mm_sub_ps(f, _mm_cvtepi32_ps(k)),
+		     _mm_sub_ps(_mm_setr_ps(t[0][1], t[1][1], t[2][1], t[3][1]),
+				coef)));
+   coef = _mm_and_ps(live, coef);
+
+   pow_lanes = _mm_movemask_ps(_mm_and_ps(live, big));
+   if (pow_lanes) {
+      GLfloat dp[SOA_LANES];
+      _mm_storeu_ps(dp, n_dot_h);
+      for (l = 0; l < SOA_LANES; l++) {
+	 if (pow_lanes & (1 << l)) {
+	    const struct gl_shine_tab *tab = sl->ShineTable[(back >> l) & 1];
+	    SOA_LANE(coef, l) = (GLfloat) _mesa_pow(dp[l], tab->shininess);
+	 }
+      }
+   }
+
+   return coef;
+}
+
+#endif /* USE_SSE2_INTRIN */
+
+
 /* Tables for all the shading functions.
  */
 static light_func _tnl_light_tab[MAX_LIGHT_FUNC];
@@ -162,6 +543,10 @@ static light_func _tnl_light_fast_tab[MAX_LIGHT_FUNC];
 static light_func _tnl_light_fast_single_tab[MAX_LIGHT_FUNC];
 static light_func _tnl_light_spec_tab[MAX_LIGHT_FUNC];
 static light_func _tnl_light_ci_tab[MAX_LIGHT_FUNC];
+#ifdef USE_SSE2_INTRIN
+static light_func _tnl_light_sse2_tab[MAX_LIGHT_FUNC];
+static light_func _tnl_light_fast_sse2_tab[MAX_LIGHT_FUNC];
+#endif
 
 #define TAG(x)           x
 #define IDX              (0)
@@ -194,6 +579,92 @@ static void init_lighting_tables( void )
 }
 
 
+/* State shared by the slices of run_lighting().
+ */
+struct light_slices {
+   light_func func;
+   struct tnl_pipeline_stage *stage;
+   const struct vertex_buffer *VB;
+   const GLvector4f *input;
+};
+
+
+/* Light vertices [start, start + count) by running the light function
+ * on copies of the vertex buffer and the stage data which only cover
+ * those vertices.
+ */
+static void light_slice( GLcontext *ctx, void *data,
+			 GLuint slice, GLuint start, GLuint count )
+{
+   struct light_slices *ls = (struct light_slices *) data;
+   struct light_stage_data *store = LIGHT_STAGE_DATA(ls->stage);
+   struct light_stage_data slice_store;
+   struct tnl_pipeline_stage slice_stage;
+   struct vertex_buffer VB;
+   GLvector4f input, normal;
+   GLuint i;
+
+   (void) slice;
+
+   VB = *ls->VB;
+   VB.Count = count;
+   _tnl_slice_vector( &normal, ls->VB->NormalPtr, start, count );
+   VB.NormalPtr = &normal;
+   _tnl_slice_vector( &input, ls->input, start, count );
+
+   slice_store = *store;
+   for (i = 0; i < 2; i++) {
+      _tnl_slice_vector( &slice_store.LitColor[i], &store->LitColor[i],
+			 start, count );
+      _tnl_slice_vector( &slice_store.LitSecondary[i],
+			 &store->LitSecondary[i], start, count );
+      _tnl_slice_vector( &slice_store.LitIndex[i], &store->LitIndex[i],
+			 start, count );
+   }
+
+   slice_stage = *ls->stage;
+   slice_stage.privatePtr = &slice_store;
+
+   ls->func( ctx, &VB, &slice_stage, &input );
+}
+
+
+/* Run the light function in slices.  Point the vertex buffer at the
+ * results, as the light function itself would have done.
+ */
+static void run_light_slices( GLcontext *ctx,
+			      struct tnl_pipeline_stage *stage,
+			      struct vertex_buffer *VB,
+			      light_func func,
+			      GLvector4f *input )
+{
+   struct light_stage_data *store = LIGHT_STAGE_DATA(stage);
+   struct light_slices ls;
+   const GLuint sides = ctx->Light.Model.TwoSide ? 2 : 1;
+   GLuint i;
+
+   store->LitColor[0].stride = 16;
+   store->LitColor[1].stride = 16;
+
+   ls.func = func;
+   ls.stage = stage;
+   ls.VB = VB;
+   ls.input = input;
+   _tnl_run_slices( ctx, light_slice, &ls, VB->Count );
+
+   for (i = 0; i < sides; i++) {
+      if (ctx->Visual.rgbMode) {
+	 VB->ColorPtr[i] = &store->LitColor[i];
+	 if (store->light_func_tab == _tnl_light_spec_tab)
+	    VB->SecondaryColorPtr[i] = &store->LitSecondary[i];
+      }
+      else {
+	 VB->IndexPtr[i] = &store->LitIndex[i];
+      }
+   }
+}
+
+
 static GLboolean run_lighting( GLcontext *ctx, 
 			       struct tnl_pipeline_stage *stage )
 {
@@ -242,9 +713,14 @@ static GLboolean run_lighting( GLcontext *ctx,
       idx |= LIGHT_TWOSIDE;
 
    /* The individual functions know about replaying side-effects
-    * vs. full re-execution. 
+    * vs. full re-execution.  Tracking materials changes the GL state
+    * per vertex, and a single normal is lit only once, so those can't
+    * be split into slices.
     */
-   store->light_func_tab[idx]( ctx, VB, stage, input );
+   if (!(idx & LIGHT_MATERIAL) && VB->NormalPtr->stride)
+      run_light_slices( ctx, stage, VB, store->light_func_tab[idx], input );
+   else
+      store->light_func_tab[idx]( ctx, VB, stage, input );
 
    VB->AttribPtr[_TNL_ATTRIB_COLOR0] = VB->ColorPtr[0];
    VB->AttribPtr[_TNL_ATTRIB_COLOR1] = VB->SecondaryColorPtr[0];
@@ -270,12 +746,21 @@ static void validate_lighting( GLcontext *ctx,
 	    tab = _tnl_light_spec_tab;
 	 else
 	    tab = _tnl_light_tab;
+#ifdef USE_SSE2_INTRIN
+	 if (tab == _tnl_light_tab && !(ctx->Light._Flags & LIGHT_SPOT) &&
+	     _mesa_have_sse2())
+	    tab = _tnl_light_sse2_tab;
+#endif
       }
       else {
 	 if (ctx->Light.EnabledList.next == ctx->Light.EnabledList.prev)
 	    tab = _tnl_light_fast_single_tab;
 	 else
 	    tab = _tnl_light_fast_tab;
+#ifdef USE_SSE2_INTRIN
+	 if (tab == _tnl_light_fast_tab && _mesa_have_sse2())
+	    tab = _tnl_light_fast_sse2_tab;
+#endif
       }
    }
    else
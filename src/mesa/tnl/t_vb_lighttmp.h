@@ -638,6 +638,300 @@ static void TAG(light_fast_rgba)( GLcontext *ctx,
 
 
 
+#ifdef USE_SSE2_INTRIN
+
+/* As light_rgba(), but lighting four vertices per iteration.  Spotlights
+ * aren't handled; validate_lighting() doesn't pick this for them.
+ */
+static void SSE2_FUNC TAG(light_rgba_sse2)( GLcontext *ctx,
+					    struct vertex_buffer *VB,
+					    struct tnl_pipeline_stage *stage,
+					    GLvector4f *input )
+{
+   struct light_stage_data *store = LIGHT_STAGE_DATA(stage);
+   const GLuint vstride = input->stride;
+   const GLfloat *vertex = (GLfloat *) input->data;
+   const GLuint nstride = VB->NormalPtr->stride;
+   const GLfloat *normal = (GLfloat *)VB->NormalPtr->data;
+
+   GLfloat (*Fcolor)[4] = (GLfloat (*)[4]) store->LitColor[0].data;
+#if IDX & LIGHT_TWOSIDE
+   GLfloat (*Bcolor)[4] = (GLfloat (*)[4]) store->LitColor[1].data;
+#endif
+
+   const GLuint nr = VB->Count;
+   const __m128 zero = _mm_setzero_ps();
+   const __m128 one = _mm_set1_ps(1.0F);
+   struct soa_lighting sl;
+   GLuint j;
+
+#ifdef TRACE
+   fprintf(stderr, "%s\n", __FUNCTION__ );
+#endif
+
+   if (nr < SOA_LANES
+#if IDX & LIGHT_MATERIAL
+       || (store->mat_bitmask & ~SOA_MATERIAL_BITS)
+#endif
+      ) {
+      TAG(light_rgba)( ctx, VB, stage, input );
+      return;
+   }
+
+   VB->ColorPtr[0] = &store->LitColor[0];
+#if IDX & LIGHT_TWOSIDE
+   VB->ColorPtr[1] = &store->LitColor[1];
+#endif
+
+   store->LitColor[0].stride = 16;
+   store->LitColor[1].stride = 16;
+
+   soa_setup_lighting( ctx, &sl );
+
+   for (j = 0; j < nr; j += SOA_LANES) {
+      const GLuint n = MIN2(nr - j, SOA_LANES);
+      __m128 v[3], norm[3], sum[2][3];
+      struct gl_light *light;
+      GLuint i = 0;
+
+#if IDX & LIGHT_MATERIAL
+      soa_color_material( ctx, store, &sl, j, n, NR_SIDES );
+#endif
+
+      soa_load_3fv( v, vertex, vstride, n );
+      soa_load_3fv( norm, normal, nstride, n );
+      STRIDE_F(vertex, n * vstride);
+      STRIDE_F(normal, n * nstride);
+
+      COPY_3V(sum[0], sl.BaseColor[0]);
+#if IDX & LIGHT_TWOSIDE
+      COPY_3V(sum[1], sl.BaseColor[1]);
+#endif
+
+      /* Add contribution from each enabled light source */
+      foreach (light, &ctx->Light.EnabledList) {
+	 const struct soa_light *l = &sl.Light[i++];
+	 __m128 VP[3], h[3], contrib[3], spec[3];
+	 __m128 attenuation, live, back, front, n_dot_VP, n_dot_h, coef;
+
+	 /* compute VP and attenuation */
+	 if (!(light->_Flags & LIGHT_POSITIONAL)) {
+	    /* directional light */
+	    COPY_3V(VP, l->VP_inf_norm);
+	    attenuation = l->VP_inf_spot_attenuation;
+	 }
+	 else {
+	    __m128 d, invd, far;
+
+	    VP[0] = _mm_sub_ps(l->Position[0], v[0]);
+	    VP[1] = _mm_sub_ps(l->Position[1], v[1]);
+	    VP[2] = _mm_sub_ps(l->Position[2], v[2]);
+
+	    d = _mm_sqrt_ps(soa_dot3(VP, VP));
+
+	    far = _mm_cmpgt_ps(d, _mm_set1_ps(1e-6F));
+	    invd = _mm_div_ps(one, d);
+	    VP[0] = soa_select(far, _mm_mul_ps(VP[0], invd), VP[0]);
+	    VP[1] = soa_select(far, _mm_mul_ps(VP[1], invd), VP[1]);
+	    VP[2] = soa_select(far, _mm_mul_ps(VP[2], invd), VP[2]);
+
+	    attenuation =
+	       _mm_div_ps(one, _mm_add_ps(l->Attenuation[0],
+		  _mm_mul_ps(d, _mm_add_ps(l->Attenuation[1],
+					   _mm_mul_ps(d, l->Attenuation[2])))));
+	 }
+
+	 /* lanes where this light makes a contribution */
+	 live = _mm_cmpnlt_ps(attenuation, _mm_set1_ps(1e-3F));
+	 if (!_mm_movemask_ps(live))
+	    continue;
+
+	 /* Compute dot product or normal and vector from V to light pos */
+	 n_dot_VP = soa_dot3(norm, VP);
+
+	 /* Which side gets the diffuse & specular terms? */
+	 back = _mm_and_ps(live, _mm_cmplt_ps(n_dot_VP, zero));
+	 front = _mm_andnot_ps(back, live);
+
+	 soa_acc_scale_3v(sum[0], back, attenuation, l->_MatAmbient[0]);
+#if IDX & LIGHT_TWOSIDE
+	 soa_acc_scale_3v(sum[1], front, attenuation, l->_MatAmbient[1]);
+	 n_dot_VP = _mm_xor_ps(n_dot_VP, _mm_and_ps(back, _mm_set1_ps(-0.0F)));
+
+	 /* diffuse term */
+	 {
+	    __m128 contrib1[3];
+	    soa_mad_3v(contrib1, l->_MatAmbient[1], n_dot_VP, l->_MatDiffuse[1]);
+	    soa_mad_3v(contrib, l->_MatAmbient[0], n_dot_VP, l->_MatDiffuse[0]);
+	    soa_select_3v(contrib, back, contrib1, contrib);
+	    soa_select_3v(spec, back, l->_MatSpecular[1], l->_MatSpecular[0]);
+	 }
+#else
+	 /* diffuse term */
+	 soa_mad_3v(contrib, l->_MatAmbient[0], n_dot_VP, l->_MatDiffuse[0]);
+	 COPY_3V(spec, l->_MatSpecular[0]);
+#endif
+
+	 /* specular term - cannibalize VP... */
+	 if (ctx->Light.Model.LocalViewer) {
+	    __m128 e[3];
+	    COPY_3V(e, v);
+	    soa_normalize_3fv(e);
+	    h[0] = _mm_sub_ps(VP[0], e[0]);       /* h = VP + VPe */
+	    h[1] = _mm_sub_ps(VP[1], e[1]);
+	    h[2] = _mm_sub_ps(VP[2], e[2]);
+	    soa_normalize_3fv(h);
+	 }
+	 else if (light->_Flags & LIGHT_POSITIONAL) {
+	    h[0] = _mm_add_ps(VP[0], sl.EyeZDir[0]);
+	    h[1] = _mm_add_ps(VP[1], sl.EyeZDir[1]);
+	    h[2] = _mm_add_ps(VP[2], sl.EyeZDir[2]);
+	    soa_normalize_3fv(h);
+	 }
+	 else {
+	    COPY_3V(h, l->h_inf_norm);
+	 }
+
+	 n_dot_h = soa_dot3(norm, h);
+
+#if IDX & LIGHT_TWOSIDE
+	 n_dot_h = _mm_xor_ps(n_dot_h, _mm_and_ps(back, _mm_set1_ps(-0.0F)));
+	 coef = soa_shine(&sl, live, _mm_movemask_ps(back), n_dot_h);
+#else
+	 coef = soa_shine(&sl, front, 0, n_dot_h);
+#endif
+
+	 soa_mad_3v(contrib, contrib, coef, spec);
+
+	 soa_acc_scale_3v(sum[0], front, attenuation, contrib);
+#if IDX & LIGHT_TWOSIDE
+	 soa_acc_scale_3v(sum[1], back, attenuation, contrib);
+#endif
+      }
+
+      soa_store_color( Fcolor + j, sum[0], sl.Alpha[0], n );
+#if IDX & LIGHT_TWOSIDE
+      soa_store_color( Bcolor + j, sum[1], sl.Alpha[1], n );
+#endif
+   }
+
+#if IDX & LIGHT_MATERIAL
+   soa_finish_materials( ctx, store, nr );
+#endif
+}
+
+
+/* As light_fast_rgba(), but lighting four vertices per iteration.
+ */
+static void SSE2_FUNC TAG(light_fast_rgba_sse2)( GLcontext *ctx,
+						 struct vertex_buffer *VB,
+						 struct tnl_pipeline_stage *stage,
+						 GLvector4f *input )
+{
+   struct light_stage_data *store = LIGHT_STAGE_DATA(stage);
+   const GLuint nstride = VB->NormalPtr->stride;
+   const GLfloat *normal = (GLfloat *)VB->NormalPtr->data;
+   GLfloat (*Fcolor)[4] = (GLfloat (*)[4]) store->LitColor[0].data;
+#if IDX & LIGHT_TWOSIDE
+   GLfloat (*Bcolor)[4] = (GLfloat (*)[4]) store->LitColor[1].data;
+#endif
+#if IDX & LIGHT_MATERIAL
+   const GLuint nr = VB->Count;
+#else
+   const GLuint nr = VB->NormalPtr->count;
+#endif
+   const __m128 zero = _mm_setzero_ps();
+   struct soa_lighting sl;
+   GLuint j;
+
+#ifdef TRACE
+   fprintf(stderr, "%s %d\n", __FUNCTION__, nr );
+#endif
+
+   /* This also takes care of a single normal lit only once.
+    */
+   if (nr < SOA_LANES
+#if IDX & LIGHT_MATERIAL
+       || (store->mat_bitmask & ~SOA_MATERIAL_BITS)
+#endif
+      ) {
+      TAG(light_fast_rgba)( ctx, VB, stage, input );
+      return;
+   }
+
+   VB->ColorPtr[0] = &store->LitColor[0];
+#if IDX & LIGHT_TWOSIDE
+   VB->ColorPtr[1] = &store->LitColor[1];
+#endif
+
+   store->LitColor[0].stride = 16;
+   store->LitColor[1].stride = 16;
+
+   soa_setup_lighting( ctx, &sl );
+
+   for (j = 0; j < nr; j += SOA_LANES) {
+      const GLuint n = MIN2(nr - j, SOA_LANES);
+      __m128 norm[3], sum[2][3];
+      GLuint i;
+
+#if IDX & LIGHT_MATERIAL
+      soa_color_material( ctx, store, &sl, j, n, NR_SIDES );
+#endif
+
+      soa_load_3fv( norm, normal, nstride, n );
+      STRIDE_F(normal, n * nstride);
+
+      COPY_3V(sum[0], sl.BaseColor[0]);
+#if IDX & LIGHT_TWOSIDE
+      COPY_3V(sum[1], sl.BaseColor[1]);
+#endif
+
+      for (i = 0; i < sl.NumLights; i++) {
+	 const struct soa_light *l = &sl.Light[i];
+	 __m128 n_dot_VP, n_dot_h, front, spec;
+#if IDX & LIGHT_TWOSIDE
+	 __m128 back;
+#endif
+
+	 soa_acc_3v(sum[0], l->_MatAmbient[0]);
+#if IDX & LIGHT_TWOSIDE
+	 soa_acc_3v(sum[1], l->_MatAmbient[1]);
+#endif
+
+	 n_dot_VP = soa_dot3(norm, l->VP_inf_norm);
+	 n_dot_h = soa_dot3(norm, l->h_inf_norm);
+	 front = _mm_cmpgt_ps(n_dot_VP, zero);
+
+	 soa_acc_scale_3v(sum[0], front, n_dot_VP, l->_MatDiffuse[0]);
+	 spec = soa_shine(&sl, front, 0, n_dot_h);
+	 soa_mad_3v(sum[0], sum[0], spec, l->_MatSpecular[0]);
+
+#if IDX & LIGHT_TWOSIDE
+	 back = _mm_andnot_ps(front, _mm_cmpeq_ps(zero, zero));
+	 n_dot_VP = _mm_xor_ps(n_dot_VP, _mm_set1_ps(-0.0F));
+	 n_dot_h = _mm_xor_ps(n_dot_h, _mm_set1_ps(-0.0F));
+	 soa_acc_scale_3v(sum[1], back, n_dot_VP, l->_MatDiffuse[1]);
+	 spec = soa_shine(&sl, back, ~0, n_dot_h);
+	 soa_mad_3v(sum[1], sum[1], spec, l->_MatSpecular[1]);
+#endif
+      }
+
+      soa_store_color( Fcolor + j, sum[0], sl.Alpha[0], n );
+#if IDX & LIGHT_TWOSIDE
+      soa_store_color( Bcolor + j, sum[1], sl.Alpha[1], n );
+#endif
+   }
+
+#if IDX & LIGHT_MATERIAL
+   soa_finish_materials( ctx, store, nr );
+#endif
+}
+
+#endif /* USE_SSE2_INTRIN */
+
+
+
+
 /*
  * Use current lighting/material settings to compute the color indexes
  * for an array of vertices.
@@ -816,6 +1110,10 @@ static void TAG(init_light_tab)( void )
    _tnl_light_fast_single_tab[IDX] = TAG(light_fast_rgba_single);
    _tnl_light_spec_tab[IDX] = TAG(light_rgba_spec);
    _tnl_light_ci_tab[IDX] = TAG(light_ci);
+#ifdef USE_SSE2_INTRIN
+   _tnl_light_sse2_tab[IDX] = TAG(light_rgba_sse2);
+   _tnl_light_fast_sse2_tab[IDX] = TAG(light_fast_rgba_sse2);
+#endif
 }
 
 
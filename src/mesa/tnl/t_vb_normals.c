@@ -37,6 +37,7 @@
 
 #include "t_context.h"
 #include "t_pipeline.h"
+#include "t_slice.h"
 
 
 struct normal_stage_data {
@@ -47,6 +48,35 @@ struct normal_stage_data {
 #define NORMAL_STAGE_DATA(stage) ((struct normal_stage_data *)stage->privatePtr)
 
 
+/* State shared by the slices of run_normal_stage().
+ */
+struct normal_slices {
+   struct normal_stage_data *store;
+   const GLvector4f *input;
+   const GLfloat *lengths;
+};
+
+
+static void
+transform_slice(GLcontext *ctx, void *data,
+                GLuint slice, GLuint start, GLuint count)
+{
+   struct normal_slices *ns = (struct normal_slices *) data;
+   GLvector4f input, normal;
+
+   (void) slice;
+
+   _tnl_slice_vector(&input, ns->input, start, count);
+   _tnl_slice_vector(&normal, &ns->store->normal, start, count);
+
+   ns->store->NormalTransform( ctx->ModelviewMatrixStack.Top,
+                               ctx->_ModelViewInvScale,
+                               &input,  /* input normals */
+                               ns->lengths ? ns->lengths + start : NULL,
+                               &normal ); /* resulting normals */
+}
+
+
 static GLboolean
 run_normal_stage(GLcontext *ctx, struct tnl_pipeline_stage *stage)
 {
@@ -65,11 +95,24 @@ run_normal_stage(GLcontext *ctx, struct tnl_pipeline_stage *stage)
    else
       lengths = VB->NormalLengthPtr;
 
-   store->NormalTransform( ctx->ModelviewMatrixStack.Top,
-			   ctx->_ModelViewInvScale,
-			   VB->NormalPtr,  /* input normals */
-			   lengths,
-			   &store->normal ); /* resulting normals */
+   if (VB->NormalPtr->stride) {
+      /* A normal per vertex: transform them in slices.
+       */
+      struct normal_slices ns;
+
+      ns.store = store;
+      ns.input = VB->NormalPtr;
+      ns.lengths = lengths;
+      _tnl_run_slices( ctx, transform_slice, &ns, VB->NormalPtr->count );
+      store->normal.count = VB->NormalPtr->count;
+   }
+   else {
+      store->NormalTransform( ctx->ModelviewMatrixStack.Top,
+                              ctx->_ModelViewInvScale,
+                              VB->NormalPtr,  /* input normals */
+                              lengths,
+                              &store->normal ); /* resulting normals */
+   }
 
    if (VB->NormalPtr->count > 1) {
       store->normal.stride = 4 * sizeof(GLfloat);
@@ -50,7 +50,10 @@ run_point_stage(GLcontext *ctx, struct tnl_pipeline_stage *stage)
    if (ctx->Point._Attenuated && !ctx->VertexProgram._Enabled) {
       struct point_stage_data *store = POINT_STAGE_DATA(stage);
       struct vertex_buffer *VB = &TNL_CONTEXT(ctx)->vb;
-      const GLfloat (*eye)[4] = (const GLfloat (*)[4]) VB->EyePtr->data;
+      /* EyePtr may be the vertex array itself, with any stride and size */
+      const GLfloat *eyeZ = (const GLfloat *) VB->EyePtr->data + 2;
+      const GLuint eyeStride = VB->EyePtr->stride / sizeof(GLfloat);
+      const GLboolean haveZ = (VB->EyePtr->size > 2);
       const GLfloat p0 = ctx->Point.Params[0];
       const GLfloat p1 = ctx->Point.Params[1];
       const GLfloat p2 = ctx->Point.Params[2];
@@ -58,8 +61,8 @@ run_point_stage(GLcontext *ctx, struct tnl_pipeline_stage *stage)
       GLfloat (*size)[4] = store->PointSize.data;
       GLuint i;
 
-      for (i = 0; i < VB->Count; i++) {
-         const GLfloat dist = FABSF(eye[i][2]);
+      for (i = 0; i < VB->Count; i++, eyeZ += eyeStride) {
+         const GLfloat dist = haveZ ? FABSF(*eyeZ) : 0.0F;
          const GLfloat q = p0 + dist * (p1 + dist * p2);
          const GLfloat atten = (q != 0.0) ? SQRTF(1.0 / q) : 1.0;
          size[i][0] = pointSize * atten; /* clamping done in rasterization */
@@ -37,6 +37,7 @@
 
 #include "t_context.h"
 #include "t_pipeline.h"
+#include "t_slice.h"
 
 
 
@@ -119,69 +120,155 @@ static void (*(usercliptab[5]))( GLcontext *,
 
 
 
-static GLboolean run_vertex_stage( GLcontext *ctx,
-				   struct tnl_pipeline_stage *stage )
-{
-   struct vertex_stage_data *store = (struct vertex_stage_data *)stage->privatePtr;
-   TNLcontext *tnl = TNL_CONTEXT(ctx);
-   struct vertex_buffer *VB = &tnl->vb;
+/* State shared by the slices of run_vertex_stage().
+ */
+struct vertex_slices {
+   struct vertex_stage_data *store;
+   const GLvector4f *obj;
+   GLboolean eye;		/* transform to eye coordinates? */
+   GLboolean ndc;		/* perspective divide? */
+   GLvector4f view[3];		/* slice 0's eye, clip and ndc vectors */
+   GLboolean ndcIsClip;
+   GLubyte ormask[TNL_MAX_SLICES];
+   GLubyte andmask[TNL_MAX_SLICES];
+};
 
-   if (ctx->VertexProgram._Enabled) 
-      return GL_TRUE;
 
-   if (ctx->_NeedEyeCoords) {
-      /* Separate modelview transformation:
-       * Use combined ModelProject to avoid some depth artifacts
-       */
-      if (ctx->ModelviewMatrixStack.Top->type == MATRIX_IDENTITY)
-	 VB->EyePtr = VB->ObjPtr;
-      else
-	 VB->EyePtr = TransformRaw( &store->eye,
-				    ctx->ModelviewMatrixStack.Top,
-				    VB->ObjPtr);
+/* Transform, cliptest and divide vertices [start, start + count).
+ * The results land in the stage's vectors at the same positions as
+ * when the whole vertex buffer is done at once.
+ */
+static void transform_slice( GLcontext *ctx, void *data,
+			     GLuint slice, GLuint start, GLuint count )
+{
+   struct vertex_slices *vs = (struct vertex_slices *) data;
+   struct vertex_stage_data *store = vs->store;
+   GLvector4f obj, eye, clip, proj;
+   GLvector4f *ndc = NULL;
+   GLubyte ormask = 0;
+   GLubyte andmask = CLIP_ALL_BITS;
+
+   _tnl_slice_vector( &obj, vs->obj, start, count );
+
+   if (vs->eye) {
+      _tnl_slice_vector( &eye, &store->eye, start, count );
+      (void) TransformRaw( &eye, ctx->ModelviewMatrixStack.Top, &obj );
    }
 
-   VB->ClipPtr = TransformRaw( &store->clip,
-			       &ctx->_ModelProjectMatrix,
-			       VB->ObjPtr );
+   _tnl_slice_vector( &clip, &store->clip, start, count );
+   (void) TransformRaw( &clip, &ctx->_ModelProjectMatrix, &obj );
 
    /* Drivers expect this to be clean to element 4...
     */
-   switch (VB->ClipPtr->size) {
+   switch (clip.size) {
    case 1:			
       /* impossible */
    case 2:
-      _mesa_vector4f_clean_elem( VB->ClipPtr, VB->Count, 2 );
+      _mesa_vector4f_clean_elem( &clip, count, 2 );
       /* fall-through */
    case 3:
-      _mesa_vector4f_clean_elem( VB->ClipPtr, VB->Count, 3 );
+      _mesa_vector4f_clean_elem( &clip, count, 3 );
       /* fall-through */
    case 4:
       break;
    }
 
-
    /* Cliptest and perspective divide.  Clip functions must clear
     * the clipmask.
     */
-   store->ormask = 0;
-   store->andmask = CLIP_ALL_BITS;
-
-   if (tnl->NeedNdcCoords) {
-      VB->NdcPtr =
-	 _mesa_clip_tab[VB->ClipPtr->size]( VB->ClipPtr,
-					    &store->proj,
-					    store->clipmask,
-					    &store->ormask,
-					    &store->andmask );
+   if (vs->ndc) {
+      _tnl_slice_vector( &proj, &store->proj, start, count );
+      ndc = _mesa_clip_tab[clip.size]( &clip,
+				       &proj,
+				       store->clipmask + start,
+				       &ormask,
+				       &andmask );
    }
    else {
+      _mesa_clip_np_tab[clip.size]( &clip,
+				    NULL,
+				    store->clipmask + start,
+				    &ormask,
+				    &andmask );
+   }
+
+   vs->ormask[slice] = ormask;
+   vs->andmask[slice] = andmask;
+
+   /* All slices produce vectors of the same size, remember one set.
+    */
+   if (slice == 0) {
+      if (vs->eye)
+	 vs->view[0] = eye;
+      vs->view[1] = clip;
+      if (ndc) {
+	 vs->view[2] = *ndc;
+	 vs->ndcIsClip = (ndc == &clip);
+      }
+   }
+}
+
+
+/* Copy the size and dirty flags a slice left in view back to the
+ * stage's vector.
+ */
+static GLvector4f *finish_vector( GLvector4f *v, const GLvector4f *view,
+				  GLuint count )
+{
+   v->size = view->size;
+   v->flags = view->flags;
+   v->count = count;
+   return v;
+}
+
+
+static GLboolean run_vertex_stage( GLcontext *ctx,
+				   struct tnl_pipeline_stage *stage )
+{
+   struct vertex_stage_data *store = (struct vertex_stage_data *)stage->privatePtr;
+   TNLcontext *tnl = TNL_CONTEXT(ctx);
+   struct vertex_buffer *VB = &tnl->vb;
+   struct vertex_slices vs;
+   GLuint nr, i;
+
+   if (ctx->VertexProgram._Enabled) 
+      return GL_TRUE;
+
+   /* Separate modelview transformation:
+    * Use combined ModelProject to avoid some depth artifacts
+    */
+   vs.store = store;
+   vs.obj = VB->ObjPtr;
+   vs.eye = (ctx->_NeedEyeCoords &&
+	     ctx->ModelviewMatrixStack.Top->type != MATRIX_IDENTITY);
+   vs.ndc = tnl->NeedNdcCoords;
+
+   nr = _tnl_run_slices( ctx, transform_slice, &vs, VB->Count );
+
+   if (ctx->_NeedEyeCoords) {
+      if (vs.eye)
+	 VB->EyePtr = finish_vector( &store->eye, &vs.view[0], VB->Count );
+      else
+	 VB->EyePtr = VB->ObjPtr;
+   }
+
+   VB->ClipPtr = finish_vector( &store->clip, &vs.view[1], VB->Count );
+
+   if (!vs.ndc)
       VB->NdcPtr = NULL;
-      _mesa_clip_np_tab[VB->ClipPtr->size]( VB->ClipPtr,
-					    NULL,
-					    store->clipmask,
-					    &store->ormask,
-					    &store->andmask );
+   else if (vs.ndcIsClip)
+      VB->NdcPtr = VB->ClipPtr;
+   else
+      VB->NdcPtr = finish_vector( &store->proj, &vs.view[2], VB->Count );
+
+   /* A slice's andmask is zero if any of its vertices is unclipped,
+    * so combining them gives the masks of the whole vertex buffer.
+    */
+   store->ormask = 0;
+   store->andmask = CLIP_ALL_BITS;
+   for (i = 0; i < nr; i++) {
+      store->ormask |= vs.ormask[i];
+      store->andmask &= vs.andmask[i];
    }
 
    if (store->andmask)
@@ -33,10 +33,12 @@
 #include "simple_list.h"
 #include "enums.h"
 
-#if defined(USE_SSE_ASM)
+#if defined(USE_SSE_ASM) || defined(USE_X86_64_ASM)
 
 #include "x86/rtasm/x86sse.h"
+#if defined(USE_SSE_ASM)
 #include "x86/common_x86_asm.h"
+#endif
 
 
 #define X    0
@@ -331,6 +333,8 @@ static void update_src_ptr( struct x86_program *p,
  * EAX -- pointer to current output vertex
  * ECX -- pointer to current attribute 
  * 
+ * On x86-64 the pointers are in the full 64-bit registers and the
+ * arguments arrive in registers, see x86_fn_arg().
  */
 static GLboolean build_vertex_emit( struct x86_program *p )
 {
@@ -348,8 +352,6 @@ static GLboolean build_vertex_emit( struct x86_program *p )
    struct x86_reg vp1 = x86_make_reg(file_XMM, 2);
    GLubyte *fixup, *label;
 
-   x86_init_func(&p->func);
-   
    /* Push a few regs?
     */
    x86_push(&p->func, countEBP);
@@ -632,17 +634,23 @@ void _tnl_generate_sse_emit( GLcontext *ctx )
    struct tnl_clipspace *vtx = GET_VERTEX_STATE(ctx);
    struct x86_program p;   
 
+#if defined(USE_SSE_ASM)
    if (!cpu_has_xmm) {
       vtx->codegen_emit = NULL;
       return;
    }
+#endif
 
    memset(&p, 0, sizeof(p));
 
    p.ctx = ctx;
    p.inputs_safe = 0;		/* for now */
    p.outputs_safe = 1;		/* for now */
+#if defined(USE_SSE_ASM)
    p.have_sse2 = cpu_has_xmm2;
+#else
+   p.have_sse2 = 1;		/* always there on x86-64 */
+#endif
    p.identity = x86_make_reg(file_XMM, 6);
    p.chan0 = x86_make_reg(file_XMM, 7);
 
@@ -664,7 +672,8 @@ void _tnl_generate_sse_emit( GLcontext *ctx )
 
 void _tnl_generate_sse_emit( GLcontext *ctx )
 {
-   /* Dummy version for when USE_SSE_ASM not defined */
+   /* Dummy version for when neither USE_SSE_ASM nor USE_X86_64_ASM
+    * is defined */
 }
 
 #endif
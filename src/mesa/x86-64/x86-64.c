@@ -42,8 +42,57 @@
 #include "math/m_debug.h"
 #endif
 
+DECLARE_XFORM_GROUP( x86_64, 1 )
+DECLARE_XFORM_GROUP( x86_64, 2 )
+DECLARE_XFORM_GROUP( x86_64, 3 )
 DECLARE_XFORM_GROUP( x86_64, 4 )
 
+DECLARE_NORM_GROUP( x86_64 )
+
+
+extern GLvector4f * _ASMAPI
+_mesa_x86_64_cliptest_points4( GLvector4f *clip_vec,
+			       GLvector4f *proj_vec,
+			       GLubyte clipMask[],
+			       GLubyte *orMask,
+			       GLubyte *andMask );
+
+extern GLvector4f * _ASMAPI
+_mesa_x86_64_cliptest_points4_np( GLvector4f *clip_vec,
+				  GLvector4f *proj_vec,
+				  GLubyte clipMask[],
+				  GLubyte *orMask,
+				  GLubyte *andMask );
+
+extern GLvector4f * _ASMAPI
+_mesa_x86_64_cliptest_points3( GLvector4f *clip_vec,
+			       GLvector4f *proj_vec,
+			       GLubyte clipMask[],
+			       GLubyte *orMask,
+			       GLubyte *andMask );
+
+extern GLvector4f * _ASMAPI
+_mesa_x86_64_cliptest_points2( GLvector4f *clip_vec,
+			       GLvector4f *proj_vec,
+			       GLubyte clipMask[],
+			       GLubyte *orMask,
+			       GLubyte *andMask );
+
+extern void _ASMAPI
+_mesa_x86_64_dotprod_vec2( GLfloat *out, GLuint out_stride,
+			   const GLvector4f *coord_vec,
+			   const GLfloat plane[4] );
+
+extern void _ASMAPI
+_mesa_x86_64_dotprod_vec3( GLfloat *out, GLuint out_stride,
+			   const GLvector4f *coord_vec,
+			   const GLfloat plane[4] );
+
+extern void _ASMAPI
+_mesa_x86_64_dotprod_vec4( GLfloat *out, GLuint out_stride,
+			   const GLvector4f *coord_vec,
+			   const GLfloat plane[4] );
+
 #endif
 
 /*
@@ -86,8 +135,25 @@ void _mesa_init_all_x86_64_transform_asm(void)
 
    message("Initializing x86-64 optimizations\n");
 
+   ASSIGN_XFORM_GROUP( x86_64, 1 );
+   ASSIGN_XFORM_GROUP( x86_64, 2 );
+   ASSIGN_XFORM_GROUP( x86_64, 3 );
    ASSIGN_XFORM_GROUP( x86_64, 4 );
 
+   ASSIGN_NORM_GROUP( x86_64 );
+
+   _mesa_clip_tab[4] = _mesa_x86_64_cliptest_points4;
+   _mesa_clip_tab[3] = _mesa_x86_64_cliptest_points3;
+   _mesa_clip_tab[2] = _mesa_x86_64_cliptest_points2;
+
+   _mesa_clip_np_tab[4] = _mesa_x86_64_cliptest_points4_np;
+   _mesa_clip_np_tab[3] = _mesa_x86_64_cliptest_points3;
+   _mesa_clip_np_tab[2] = _mesa_x86_64_cliptest_points2;
+
+   _mesa_dotprod_tab[2] = _mesa_x86_64_dotprod_vec2;
+   _mesa_dotprod_tab[3] = _mesa_x86_64_dotprod_vec3;
+   _mesa_dotprod_tab[4] = _mesa_x86_64_dotprod_vec4;
+
    /*
    _mesa_transform_tab[4][MATRIX_GENERAL] =
       _mesa_x86_64_transform_points4_general;
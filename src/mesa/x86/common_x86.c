@@ -44,6 +44,7 @@
 #endif
 
 #include "common_x86_asm.h"
+#include "common_x86_sse2.h"
 #include "imports.h"
 
 
@@ -446,3 +447,17 @@ void _mesa_init_all_x86_transform_asm( void )
 #endif
 }
 
+
+
+/**
+ * May the SSE2_FUNC functions (see common_x86_sse2.h) be used?  On x86
+ * this depends on the CPU, and on x86-64 only on MESA_NO_ASM.
+ */
+GLboolean _mesa_have_sse2( void )
+{
+#if defined(USE_SSE_ASM)
+   return cpu_has_xmm && cpu_has_xmm2;
+#else
+   return _mesa_getenv( "MESA_NO_ASM" ) == NULL;
+#endif
+}
@@ -0,0 +1,56 @@
+/*
+ * Mesa 3-D graphics library
+ * Version:  6.5
+ *
+ * Copyright (C) 1999-2006  Brian Paul   All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * BRIAN PAUL BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ * AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file common_x86_sse2.h
+ * Support for C functions written with SSE2 intrinsics.
+ *
+ * USE_SSE2_INTRIN is defined if such functions can be built.  They're
+ * always available on x86-64.  On x86 they're built with the target
+ * attribute when the compiler isn't generating SSE2 code anyway.  Either
+ * way, declare them with SSE2_FUNC and only call them if
+ * _mesa_have_sse2() says so.
+ */
+
+#ifndef __COMMON_X86_SSE2_H__
+#define __COMMON_X86_SSE2_H__
+
+#include "glheader.h"
+
+#if defined(__SSE2__)
+#define USE_SSE2_INTRIN
+#define SSE2_FUNC
+#elif defined(USE_SSE_ASM) && defined(__GNUC__) && \
+      (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#define USE_SSE2_INTRIN
+#define SSE2_FUNC __attribute__((target("sse2")))
+#endif
+
+#ifdef USE_SSE2_INTRIN
+#include <emmintrin.h>
+#endif
+
+extern GLboolean _mesa_have_sse2( void );
+
+#endif
@@ -1,10 +1,9 @@
-#if defined(USE_X86_ASM)
+#if defined(USE_X86_ASM) || defined(USE_X86_64_ASM)
 
 #include "imports.h"
 #include "x86sse.h"
 
 #define DISASSEM 0
-#define X86_TWOB 0x0f
 
 /* Emit bytes to the instruction stream:
  */
@@ -42,22 +41,15 @@ static void emit_2ub_fn( struct x86_function *p, GLubyte b0, GLubyte b1, const c
    *(p->csr++) = b1;
 }
 
-static void emit_3ub_fn( struct x86_function *p, GLubyte b0, GLubyte b1, GLubyte b2, const char *fn )
-{
-   disassem(p, fn);
-   *(p->csr++) = b0;
-   *(p->csr++) = b1;
-   *(p->csr++) = b2;
-}
-
 #define emit_1ub(p, b0)         emit_1ub_fn(p, b0, __FUNCTION__)
 #define emit_2ub(p, b0, b1)     emit_2ub_fn(p, b0, b1, __FUNCTION__)
-#define emit_3ub(p, b0, b1, b2) emit_3ub_fn(p, b0, b1, b2, __FUNCTION__)
 
 
 
 /* Build a modRM byte + possible displacement.  No treatment of SIB
- * indexing.  BZZT - no way to encode an absolute address.
+ * indexing.  BZZT - no way to encode an absolute address.  On x86-64
+ * the high bit of each register number goes in the REX prefix, see
+ * emit_rex().
  */
 static void emit_modrm( struct x86_function *p, 
 			struct x86_reg reg, 
@@ -68,15 +60,16 @@ static void emit_modrm( struct x86_function *p,
    assert(reg.mod == mod_REG);
    
    val |= regmem.mod << 6;     	/* mod field */
-   val |= reg.idx << 3;		/* reg field */
-   val |= regmem.idx;		/* r/m field */
+   val |= (reg.idx & 7) << 3;	/* reg field */
+   val |= regmem.idx & 7;	/* r/m field */
    
    emit_1ub_fn(p, val, 0);
 
    /* Oh-oh we've stumbled into the SIB thing.
     */
    if (regmem.file == file_REG32 &&
-       regmem.idx == reg_SP) {
+       regmem.mod != mod_REG &&
+       (regmem.idx & 7) == reg_SP) {
       emit_1ub_fn(p, 0x24, 0);		/* simplistic! */
    }
 
@@ -97,12 +90,66 @@ static void emit_modrm( struct x86_function *p,
 }
 
 
-static void emit_modrm_noreg( struct x86_function *p,
-			      GLuint op,
-			      struct x86_reg regmem )
+/* On x86-64, a REX prefix is needed for 64-bit operands (w) and to
+ * reach registers 8-15.  It goes after any mandatory 0x66/0xf2/0xf3
+ * prefix and right before the opcode.
+ */
+static void emit_rex( struct x86_function *p,
+		      GLuint w,
+		      struct x86_reg reg,
+		      struct x86_reg regmem )
+{
+#if defined(USE_X86_64_ASM)
+   GLubyte rex = 0x40;
+
+   if (w)
+      rex |= 0x08;		/* REX.W */
+   if (reg.idx & 8)
+      rex |= 0x04;		/* REX.R */
+   if (regmem.idx & 8)
+      rex |= 0x01;		/* REX.B */
+
+   if (rex != 0x40)
+      emit_1ub_fn(p, rex, 0);
+#else
+   (void) p;
+   (void) w;
+   (void) reg;
+   (void) regmem;
+#endif
+}
+
+/* Emit an instruction taking a modrm operand: the mandatory prefix
+ * (if not zero), REX, the opcode and the modrm byte.  Opcodes above
+ * 0xff are two-byte 0x0f opcodes.
+ */
+static void emit_op( struct x86_function *p,
+		     GLubyte prefix,
+		     GLuint w,
+		     GLuint op,
+		     struct x86_reg reg,
+		     struct x86_reg regmem )
+{
+   if (prefix)
+      emit_1ub_fn(p, prefix, 0);
+   emit_rex(p, w, reg, regmem);
+   if (op > 0xff)
+      emit_1ub_fn(p, op >> 8, 0);
+   emit_1ub_fn(p, op & 0xff, 0);
+   emit_modrm(p, reg, regmem);
+}
+
+/* As above, for instructions using the reg field of the modrm byte as
+ * an opcode extension.
+ */
+static void emit_op_noreg( struct x86_function *p,
+			   GLubyte prefix,
+			   GLuint op,
+			   GLuint ext,
+			   struct x86_reg regmem )
 {
-   struct x86_reg dummy = x86_make_reg(file_REG32, op);
-   emit_modrm(p, dummy, regmem);
+   struct x86_reg dummy = x86_make_reg(file_REG32, ext);
+   emit_op(p, prefix, 0, op, dummy, regmem);
 }
 
 /* Many x86 instructions have two opcodes to cope with the situations
@@ -111,22 +158,22 @@ static void emit_modrm_noreg( struct x86_function *p,
  * the arguments presented.
  */
 static void emit_op_modrm( struct x86_function *p,
-			   GLubyte op_dst_is_reg, 
-			   GLubyte op_dst_is_mem,
+			   GLubyte prefix,
+			   GLuint w,
+			   GLuint op_dst_is_reg, 
+			   GLuint op_dst_is_mem,
 			   struct x86_reg dst,
 			   struct x86_reg src )
 {  
    switch (dst.mod) {
    case mod_REG:
-      emit_1ub_fn(p, op_dst_is_reg, 0);
-      emit_modrm(p, dst, src);
+      emit_op(p, prefix, w, op_dst_is_reg, dst, src);
       break;
    case mod_INDIRECT:
    case mod_DISP32:
    case mod_DISP8:
       assert(src.mod == mod_REG);
-      emit_1ub_fn(p, op_dst_is_mem, 0);
-      emit_modrm(p, src, dst);
+      emit_op(p, prefix, w, op_dst_is_mem, src, dst);
       break;
    default:
       assert(0);
@@ -135,7 +182,13 @@ static void emit_op_modrm( struct x86_function *p,
 }
 
 
-
+/* Operand size flag for pointer-sized integer operations:
+ */
+#if defined(USE_X86_64_ASM)
+#define PTR_W 1
+#else
+#define PTR_W 0
+#endif
 
 
 
@@ -165,7 +218,7 @@ struct x86_reg x86_make_disp( struct x86_reg reg,
    else
       reg.disp += disp;
 
-   if (reg.disp == 0)
+   if (reg.disp == 0 && (reg.idx & 7) != reg_BP)
       reg.mod = mod_INDIRECT;
    else if (reg.disp <= 127 && reg.disp >= -128)
       reg.mod = mod_DISP8;
@@ -236,30 +289,53 @@ void x86_push( struct x86_function *p,
 	       struct x86_reg reg )
 {
    assert(reg.mod == mod_REG);
-   emit_1ub(p, 0x50 + reg.idx);
-   p->stack_offset += 4;
+   emit_rex(p, 0, x86_make_reg(file_REG32, 0), reg);
+   emit_1ub(p, 0x50 + (reg.idx & 7));
+   p->stack_offset += sizeof(void *);
 }
 
 void x86_pop( struct x86_function *p,
 	      struct x86_reg reg )
 {
    assert(reg.mod == mod_REG);
-   emit_1ub(p, 0x58 + reg.idx);
-   p->stack_offset -= 4;
+   emit_rex(p, 0, x86_make_reg(file_REG32, 0), reg);
+   emit_1ub(p, 0x58 + (reg.idx & 7));
+   p->stack_offset -= sizeof(void *);
+}
+
+/* Push a 32-bit immediate (sign-extended to 64 bits on x86-64):
+ */
+void x86_push_imm32( struct x86_function *p,
+		     GLint imm )
+{
+   emit_1ub(p, 0x68);
+   emit_1i(p, imm);
+   p->stack_offset += sizeof(void *);
 }
 
+/* On x86-64 the one-byte inc/dec opcodes are REX prefixes, so use the
+ * two-byte forms there.
+ */
 void x86_inc( struct x86_function *p,
 	      struct x86_reg reg )
 {
    assert(reg.mod == mod_REG);
+#if defined(USE_X86_64_ASM)
+   emit_op_noreg(p, 0, 0xff, 0, reg);
+#else
    emit_1ub(p, 0x40 + reg.idx);
+#endif
 }
 
 void x86_dec( struct x86_function *p,
 	      struct x86_reg reg )
 {
    assert(reg.mod == mod_REG);
+#if defined(USE_X86_64_ASM)
+   emit_op_noreg(p, 0, 0xff, 1, reg);
+#else
    emit_1ub(p, 0x48 + reg.idx);
+#endif
 }
 
 void x86_ret( struct x86_function *p )
@@ -267,46 +343,68 @@ void x86_ret( struct x86_function *p )
    emit_1ub(p, 0xc3);
 }
 
+/* Indirect call through a register or a memory location holding the
+ * function address.  The caller is responsible for the argument setup
+ * and for keeping the stack aligned.
+ */
+void x86_call( struct x86_function *p,
+	       struct x86_reg reg )
+{
+   emit_op_noreg(p, 0, 0xff, 2, reg);
+}
+
 void x86_sahf( struct x86_function *p )
 {
    emit_1ub(p, 0x9e);
 }
 
+/* Moves are pointer-sized, ie. 64-bit on x86-64, so that they can
+ * be used for pointers (such as those returned by x86_fn_arg()) and
+ * pointers loaded from or stored to memory.
+ */
 void x86_mov( struct x86_function *p,
 	      struct x86_reg dst,
 	      struct x86_reg src )
 {
-   emit_op_modrm( p, 0x8b, 0x89, dst, src );
+   emit_op_modrm( p, 0, PTR_W, 0x8b, 0x89, dst, src );
+}
+
+void x86_mov_reg_imm( struct x86_function *p,
+		      struct x86_reg dst,
+		      GLint imm )
+{
+   assert(dst.mod == mod_REG);
+   emit_rex(p, 0, x86_make_reg(file_REG32, 0), dst);
+   emit_1ub(p, 0xb8 + (dst.idx & 7));
+   emit_1i(p, imm);
 }
 
 void x86_xor( struct x86_function *p,
 	      struct x86_reg dst,
 	      struct x86_reg src )
 {
-   emit_op_modrm( p, 0x33, 0x31, dst, src );
+   emit_op_modrm( p, 0, 0, 0x33, 0x31, dst, src );
 }
 
 void x86_cmp( struct x86_function *p,
 	      struct x86_reg dst,
 	      struct x86_reg src )
 {
-   emit_op_modrm( p, 0x3b, 0x39, dst, src );
+   emit_op_modrm( p, 0, 0, 0x3b, 0x39, dst, src );
 }
 
 void x86_lea( struct x86_function *p,
 	      struct x86_reg dst,
 	      struct x86_reg src )
 {
-   emit_1ub(p, 0x8d);
-   emit_modrm( p, dst, src );
+   emit_op( p, 0, PTR_W, 0x8d, dst, src );
 }
 
 void x86_test( struct x86_function *p,
 	       struct x86_reg dst,
 	       struct x86_reg src )
 {
-   emit_1ub(p, 0x85);
-   emit_modrm( p, dst, src );
+   emit_op( p, 0, 0, 0x85, dst, src );
 }
 
 
@@ -320,24 +418,21 @@ void sse_movss( struct x86_function *p,
 		struct x86_reg dst,
 		struct x86_reg src )
 {
-   emit_2ub(p, 0xF3, X86_TWOB);
-   emit_op_modrm( p, 0x10, 0x11, dst, src );
+   emit_op_modrm( p, 0xf3, 0, 0x0f10, 0x0f11, dst, src );
 }
 
 void sse_movaps( struct x86_function *p,
 		 struct x86_reg dst,
 		 struct x86_reg src )
 {
-   emit_1ub(p, X86_TWOB);
-   emit_op_modrm( p, 0x28, 0x29, dst, src );
+   emit_op_modrm( p, 0, 0, 0x0f28, 0x0f29, dst, src );
 }
 
 void sse_movups( struct x86_function *p,
 		 struct x86_reg dst,
 		 struct x86_reg src )
 {
-   emit_1ub(p, X86_TWOB);
-   emit_op_modrm( p, 0x10, 0x11, dst, src );
+   emit_op_modrm( p, 0, 0, 0x0f10, 0x0f11, dst, src );
 }
 
 void sse_movhps( struct x86_function *p,
@@ -345,8 +440,7 @@ void sse_movhps( struct x86_function *p,
 		 struct x86_reg src )
 {
    assert(dst.mod != mod_REG || src.mod != mod_REG);
-   emit_1ub(p, X86_TWOB);
-   emit_op_modrm( p, 0x16, 0x17, dst, src ); /* cf movlhps */
+   emit_op_modrm( p, 0, 0, 0x0f16, 0x0f17, dst, src ); /* cf movlhps */
 }
 
 void sse_movlps( struct x86_function *p,
@@ -354,81 +448,106 @@ void sse_movlps( struct x86_function *p,
 		 struct x86_reg src )
 {
    assert(dst.mod != mod_REG || src.mod != mod_REG);
-   emit_1ub(p, X86_TWOB);
-   emit_op_modrm( p, 0x12, 0x13, dst, src ); /* cf movhlps */
+   emit_op_modrm( p, 0, 0, 0x0f12, 0x0f13, dst, src ); /* cf movhlps */
 }
 
 void sse_maxps( struct x86_function *p,
 		struct x86_reg dst,
 		struct x86_reg src )
 {
-   emit_2ub(p, X86_TWOB, 0x5F);
-   emit_modrm( p, dst, src );
+   emit_op( p, 0, 0, 0x0f5f, dst, src );
+}
+
+void sse_divps( struct x86_function *p,
+		struct x86_reg dst,
+		struct x86_reg src )
+{
+   emit_op( p, 0, 0, 0x0f5e, dst, src );
 }
 
 void sse_divss( struct x86_function *p,
 		struct x86_reg dst,
 		struct x86_reg src )
 {
-   emit_3ub(p, 0xF3, X86_TWOB, 0x5E);
-   emit_modrm( p, dst, src );
+   emit_op( p, 0xf3, 0, 0x0f5e, dst, src );
 }
 
 void sse_minps( struct x86_function *p,
 		struct x86_reg dst,
 		struct x86_reg src )
 {
-   emit_2ub(p, X86_TWOB, 0x5D);
-   emit_modrm( p, dst, src );
+   emit_op( p, 0, 0, 0x0f5d, dst, src );
 }
 
 void sse_subps( struct x86_function *p,
 		struct x86_reg dst,
 		struct x86_reg src )
 {
-   emit_2ub(p, X86_TWOB, 0x5C);
-   emit_modrm( p, dst, src );
+   emit_op( p, 0, 0, 0x0f5c, dst, src );
 }
 
 void sse_mulps( struct x86_function *p,
 		struct x86_reg dst,
 		struct x86_reg src )
 {
-   emit_2ub(p, X86_TWOB, 0x59);
-   emit_modrm( p, dst, src );
+   emit_op( p, 0, 0, 0x0f59, dst, src );
 }
 
 void sse_addps( struct x86_function *p,
 		struct x86_reg dst,
 		struct x86_reg src )
 {
-   emit_2ub(p, X86_TWOB, 0x58);
-   emit_modrm( p, dst, src );
+   emit_op( p, 0, 0, 0x0f58, dst, src );
 }
 
 void sse_addss( struct x86_function *p,
 		struct x86_reg dst,
 		struct x86_reg src )
 {
-   emit_3ub(p, 0xF3, X86_TWOB, 0x58);
-   emit_modrm( p, dst, src );
+   emit_op( p, 0xf3, 0, 0x0f58, dst, src );
 }
 
 void sse_andps( struct x86_function *p,
 		struct x86_reg dst,
 		struct x86_reg src )
 {
-   emit_2ub(p, X86_TWOB, 0x54);
-   emit_modrm( p, dst, src );
+   emit_op( p, 0, 0, 0x0f54, dst, src );
+}
+
+
+void sse_andnps( struct x86_function *p,
+		 struct x86_reg dst,
+		 struct x86_reg src )
+{
+   emit_op( p, 0, 0, 0x0f55, dst, src );
 }
 
+void sse_orps( struct x86_function *p,
+	       struct x86_reg dst,
+	       struct x86_reg src )
+{
+   emit_op( p, 0, 0, 0x0f56, dst, src );
+}
+
+void sse_xorps( struct x86_function *p,
+		struct x86_reg dst,
+		struct x86_reg src )
+{
+   emit_op( p, 0, 0, 0x0f57, dst, src );
+}
+
+void sse_sqrtps( struct x86_function *p,
+		 struct x86_reg dst,
+		 struct x86_reg src )
+{
+   emit_op( p, 0, 0, 0x0f51, dst, src );
+}
 
 void sse_rsqrtss( struct x86_function *p,
 		  struct x86_reg dst,
 		  struct x86_reg src )
 {
-   emit_3ub(p, 0xF3, X86_TWOB, 0x52);
-   emit_modrm( p, dst, src );
+   emit_op( p, 0xf3, 0, 0x0f52, dst, src );
 
 }
 
@@ -437,8 +556,7 @@ void sse_movhlps( struct x86_function *p,
 		  struct x86_reg src )
 {
    assert(dst.mod == mod_REG && src.mod == mod_REG);
-   emit_2ub(p, X86_TWOB, 0x12);
-   emit_modrm( p, dst, src );
+   emit_op( p, 0, 0, 0x0f12, dst, src );
 }
 
 void sse_movlhps( struct x86_function *p,
@@ -446,8 +564,7 @@ void sse_movlhps( struct x86_function *p,
 		  struct x86_reg src )
 {
    assert(dst.mod == mod_REG && src.mod == mod_REG);
-   emit_2ub(p, X86_TWOB, 0x16);
-   emit_modrm( p, dst, src );
+   emit_op( p, 0, 0, 0x0f16, dst, src );
 }
 
 
@@ -460,8 +577,7 @@ void sse_cvtps2pi( struct x86_function *p,
 
    p->need_emms = 1;
 
-   emit_2ub(p, X86_TWOB, 0x2d);
-   emit_modrm( p, dst, src );
+   emit_op( p, 0, 0, 0x0f2d, dst, src );
 }
 
 
@@ -473,8 +589,7 @@ void sse_shufps( struct x86_function *p,
 		 struct x86_reg arg0,
 		 GLubyte shuf) 
 {
-   emit_2ub(p, X86_TWOB, 0xC6);
-   emit_modrm(p, dest, arg0);
+   emit_op( p, 0, 0, 0x0fc6, dest, arg0 );
    emit_1ub(p, shuf); 
 }
 
@@ -483,8 +598,7 @@ void sse_cmpps( struct x86_function *p,
 		struct x86_reg arg0,
 		GLubyte cc) 
 {
-   emit_2ub(p, X86_TWOB, 0xC2);
-   emit_modrm(p, dest, arg0);
+   emit_op( p, 0, 0, 0x0fc2, dest, arg0 );
    emit_1ub(p, cc); 
 }
 
@@ -500,8 +614,7 @@ void sse2_pshufd( struct x86_function *p,
 		  struct x86_reg arg0,
 		  GLubyte shuf) 
 {
-   emit_3ub(p, 0x66, X86_TWOB, 0x70);
-   emit_modrm(p, dest, arg0);
+   emit_op( p, 0x66, 0, 0x0f70, dest, arg0 );
    emit_1ub(p, shuf); 
 }
 
@@ -509,48 +622,56 @@ void sse2_cvtps2dq( struct x86_function *p,
 		    struct x86_reg dst,
 		    struct x86_reg src )
 {
-   emit_3ub(p, 0x66, X86_TWOB, 0x5B);
-   emit_modrm( p, dst, src );
+   emit_op( p, 0x66, 0, 0x0f5b, dst, src );
+}
+
+void sse2_cvttps2dq( struct x86_function *p,
+		     struct x86_reg dst,
+		     struct x86_reg src )
+{
+   emit_op( p, 0xf3, 0, 0x0f5b, dst, src );
+}
+
+void sse2_cvtdq2ps( struct x86_function *p,
+		    struct x86_reg dst,
+		    struct x86_reg src )
+{
+   emit_op( p, 0, 0, 0x0f5b, dst, src );
 }
 
 void sse2_packssdw( struct x86_function *p,
 		    struct x86_reg dst,
 		    struct x86_reg src )
 {
-   emit_3ub(p, 0x66, X86_TWOB, 0x6B);
-   emit_modrm( p, dst, src );
+   emit_op( p, 0x66, 0, 0x0f6b, dst, src );
 }
 
 void sse2_packsswb( struct x86_function *p,
 		    struct x86_reg dst,
 		    struct x86_reg src )
 {
-   emit_3ub(p, 0x66, X86_TWOB, 0x63);
-   emit_modrm( p, dst, src );
+   emit_op( p, 0x66, 0, 0x0f63, dst, src );
 }
 
 void sse2_packuswb( struct x86_function *p,
 		    struct x86_reg dst,
 		    struct x86_reg src )
 {
-   emit_3ub(p, 0x66, X86_TWOB, 0x67);
-   emit_modrm( p, dst, src );
+   emit_op( p, 0x66, 0, 0x0f67, dst, src );
 }
 
 void sse2_rcpss( struct x86_function *p,
 		struct x86_reg dst,
 		struct x86_reg src )
 {
-   emit_3ub(p, 0xF3, X86_TWOB, 0x53);
-   emit_modrm( p, dst, src );
+   emit_op( p, 0xf3, 0, 0x0f53, dst, src );
 }
 
 void sse2_movd( struct x86_function *p,
 		struct x86_reg dst,
 		struct x86_reg src )
 {
-   emit_2ub(p, 0x66, X86_TWOB);
-   emit_op_modrm( p, 0x6e, 0x7e, dst, src );
+   emit_op_modrm( p, 0x66, 0, 0x0f6e, 0x0f7e, dst, src );
 }
 
 
@@ -561,14 +682,12 @@ void sse2_movd( struct x86_function *p,
  */
 void x87_fist( struct x86_function *p, struct x86_reg dst )
 {
-   emit_1ub(p, 0xdb);
-   emit_modrm_noreg(p, 2, dst);
+   emit_op_noreg(p, 0, 0xdb, 2, dst);
 }
 
 void x87_fistp( struct x86_function *p, struct x86_reg dst )
 {
-   emit_1ub(p, 0xdb);
-   emit_modrm_noreg(p, 3, dst);
+   emit_op_noreg(p, 0, 0xdb, 3, dst);
 }
 
 void x87_fldz( struct x86_function *p )
@@ -581,8 +700,7 @@ void x87_fldcw( struct x86_function *p, struct x86_reg arg )
 {
    assert(arg.file == file_REG32);
    assert(arg.mod != mod_REG);
-   emit_1ub(p, 0xd9);
-   emit_modrm_noreg(p, 5, arg);
+   emit_op_noreg(p, 0, 0xd9, 5, arg);
 }
 
 void x87_fld1( struct x86_function *p )
@@ -630,14 +748,13 @@ static void x87_arith_op( struct x86_function *p, struct x86_reg dst, struct x86
       if (dst.idx == 0) 
 	 emit_2ub(p, dst0ub0, dst0ub1+arg.idx);
       else if (arg.idx == 0) 
-	 emit_2ub(p, arg0ub0, arg0ub1+arg.idx);
+	 emit_2ub(p, arg0ub0, arg0ub1+dst.idx);
       else
 	 assert(0);
    }
    else if (dst.idx == 0) {
-      assert(arg.file = file_REG32);
-      emit_1ub(p, 0xd8);
-      emit_modrm_noreg(p, argmem_noreg, arg);
+      assert(arg.file == file_REG32);
+      emit_op_noreg(p, 0, 0xd8, argmem_noreg, arg);
    }
    else
       assert(0);
@@ -648,7 +765,7 @@ void x87_fmul( struct x86_function *p, struct x86_reg dst, struct x86_reg arg )
    x87_arith_op(p, dst, arg, 
 		0xd8, 0xc8,
 		0xdc, 0xc8,
-		4);
+		1);
 }
 
 void x87_fsub( struct x86_function *p, struct x86_reg dst, struct x86_reg arg )
@@ -745,6 +862,14 @@ void x87_fucomp( struct x86_function *p, struct x86_reg arg )
    emit_2ub(p, 0xdd, 0xe8+arg.idx);
 }
 
+/* Compare and set EFLAGS directly, avoiding fnstsw/sahf:
+ */
+void x87_fucomip( struct x86_function *p, struct x86_reg arg )
+{
+   assert(arg.file == file_x87);
+   emit_2ub(p, 0xdf, 0xe8+arg.idx);
+}
+
 void x87_fucompp( struct x86_function *p )
 {
    emit_2ub(p, 0xda, 0xe9);
@@ -835,8 +960,7 @@ void x87_fld( struct x86_function *p, struct x86_reg arg )
    if (arg.file == file_x87) 
       emit_2ub(p, 0xd9, 0xc0 + arg.idx);
    else {
-      emit_1ub(p, 0xd9);
-      emit_modrm_noreg(p, 0, arg);
+      emit_op_noreg(p, 0, 0xd9, 0, arg);
    }
 }
 
@@ -845,8 +969,7 @@ void x87_fst( struct x86_function *p, struct x86_reg dst )
    if (dst.file == file_x87) 
       emit_2ub(p, 0xdd, 0xd0 + dst.idx);
    else {
-      emit_1ub(p, 0xd9);
-      emit_modrm_noreg(p, 2, dst);
+      emit_op_noreg(p, 0, 0xd9, 2, dst);
    }
 }
 
@@ -855,8 +978,7 @@ void x87_fstp( struct x86_function *p, struct x86_reg dst )
    if (dst.file == file_x87) 
       emit_2ub(p, 0xdd, 0xd8 + dst.idx);
    else {
-      emit_1ub(p, 0xd9);
-      emit_modrm_noreg(p, 3, dst);
+      emit_op_noreg(p, 0, 0xd9, 3, dst);
    }
 }
 
@@ -865,8 +987,7 @@ void x87_fcom( struct x86_function *p, struct x86_reg dst )
    if (dst.file == file_x87) 
       emit_2ub(p, 0xd8, 0xd0 + dst.idx);
    else {
-      emit_1ub(p, 0xd8);
-      emit_modrm_noreg(p, 2, dst);
+      emit_op_noreg(p, 0, 0xd8, 2, dst);
    }
 }
 
@@ -875,8 +996,7 @@ void x87_fcomp( struct x86_function *p, struct x86_reg dst )
    if (dst.file == file_x87) 
       emit_2ub(p, 0xd8, 0xd8 + dst.idx);
    else {
-      emit_1ub(p, 0xd8);
-      emit_modrm_noreg(p, 3, dst);
+      emit_op_noreg(p, 0, 0xd8, 3, dst);
    }
 }
 
@@ -889,8 +1009,7 @@ void x87_fnstsw( struct x86_function *p, struct x86_reg dst )
        dst.mod == mod_REG) 
       emit_2ub(p, 0xdf, 0xe0);
    else {
-      emit_1ub(p, 0xdd);
-      emit_modrm_noreg(p, 7, dst);
+      emit_op_noreg(p, 0, 0xdd, 7, dst);
    }
 }
 
@@ -917,8 +1036,7 @@ void mmx_packssdw( struct x86_function *p,
 
    p->need_emms = 1;
 
-   emit_2ub(p, X86_TWOB, 0x6b);
-   emit_modrm( p, dst, src );
+   emit_op( p, 0, 0, 0x0f6b, dst, src );
 }
 
 void mmx_packuswb( struct x86_function *p,
@@ -930,8 +1048,7 @@ void mmx_packuswb( struct x86_function *p,
 
    p->need_emms = 1;
 
-   emit_2ub(p, X86_TWOB, 0x67);
-   emit_modrm( p, dst, src );
+   emit_op( p, 0, 0, 0x0f67, dst, src );
 }
 
 void mmx_movd( struct x86_function *p,
@@ -939,8 +1056,7 @@ void mmx_movd( struct x86_function *p,
 	       struct x86_reg src )
 {
    p->need_emms = 1;
-   emit_1ub(p, X86_TWOB);
-   emit_op_modrm( p, 0x6e, 0x7e, dst, src );
+   emit_op_modrm( p, 0, 0, 0x0f6e, 0x0f7e, dst, src );
 }
 
 void mmx_movq( struct x86_function *p,
@@ -948,8 +1064,7 @@ void mmx_movq( struct x86_function *p,
 	       struct x86_reg src )
 {
    p->need_emms = 1;
-   emit_1ub(p, X86_TWOB);
-   emit_op_modrm( p, 0x6f, 0x7f, dst, src );
+   emit_op_modrm( p, 0, 0, 0x0f6f, 0x0f7f, dst, src );
 }
 
 
@@ -959,13 +1074,22 @@ void mmx_movq( struct x86_function *p,
 
 
 /* Retreive a reference to one of the function arguments, taking into
- * account any push/pop activity:
+ * account any push/pop activity.  On x86-64 the first six integer
+ * arguments are passed in registers instead (System V ABI):
  */
 struct x86_reg x86_fn_arg( struct x86_function *p,
 			   GLuint arg )
 {
+#if defined(USE_X86_64_ASM)
+   static const enum x86_reg_name arg_regs[6] = {
+      reg_DI, reg_SI, reg_DX, reg_CX, reg_R8, reg_R9
+   };
+   assert(arg >= 1 && arg <= 6);
+   return x86_make_reg(file_REG32, arg_regs[arg - 1]);
+#else
    return x86_make_disp(x86_make_reg(file_REG32, reg_SP), 
 			p->stack_offset + arg * 4);	/* ??? */
+#endif
 }
 
 
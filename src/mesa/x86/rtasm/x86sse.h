@@ -2,7 +2,7 @@
 #ifndef _X86SSE_H_
 #define _X86SSE_H_
 
-#if defined(USE_X86_ASM)
+#if defined(USE_X86_ASM) || defined(USE_X86_64_ASM)
 
 #include "glheader.h"
 
@@ -12,7 +12,7 @@
  */
 struct x86_reg {
    GLuint file:3;
-   GLuint idx:3;
+   GLuint idx:4;		/* 8-15 are r8-r15 and xmm8-xmm15 on x86-64 */
    GLuint mod:2;		/* mod_REG if this is just a register */
    GLint  disp:24;		/* only +/- 23bits of offset - should be enough... */
 };
@@ -50,6 +50,17 @@ enum x86_reg_name {
    reg_BP,
    reg_SI,
    reg_DI
+#if defined(USE_X86_64_ASM)
+   ,
+   reg_R8,
+   reg_R9,
+   reg_R10,
+   reg_R11,
+   reg_R12,
+   reg_R13,
+   reg_R14,
+   reg_R15
+#endif
 };
 
 
@@ -126,7 +137,9 @@ void mmx_movq( struct x86_function *p, struct x86_reg dst, struct x86_reg src );
 void mmx_packssdw( struct x86_function *p, struct x86_reg dst, struct x86_reg src );
 void mmx_packuswb( struct x86_function *p, struct x86_reg dst, struct x86_reg src );
 
+void sse2_cvtdq2ps( struct x86_function *p, struct x86_reg dst, struct x86_reg src );
 void sse2_cvtps2dq( struct x86_function *p, struct x86_reg dst, struct x86_reg src );
+void sse2_cvttps2dq( struct x86_function *p, struct x86_reg dst, struct x86_reg src );
 void sse2_movd( struct x86_function *p, struct x86_reg dst, struct x86_reg src );
 void sse2_packssdw( struct x86_function *p, struct x86_reg dst, struct x86_reg src );
 void sse2_packsswb( struct x86_function *p, struct x86_reg dst, struct x86_reg src );
@@ -137,7 +150,9 @@ void sse2_rcpss( struct x86_function *p, struct x86_reg dst, struct x86_reg src
 void sse_addps( struct x86_function *p, struct x86_reg dst, struct x86_reg src );
 void sse_addss( struct x86_function *p, struct x86_reg dst, struct x86_reg src );
 void sse_cvtps2pi( struct x86_function *p, struct x86_reg dst, struct x86_reg src );
+void sse_divps( struct x86_function *p, struct x86_reg dst, struct x86_reg src );
 void sse_divss( struct x86_function *p, struct x86_reg dst, struct x86_reg src );
+void sse_andnps( struct x86_function *p, struct x86_reg dst, struct x86_reg src );
 void sse_andps( struct x86_function *p, struct x86_reg dst, struct x86_reg src );
 void sse_cmpps( struct x86_function *p, struct x86_reg dst, struct x86_reg src, GLubyte cc );
 void sse_maxps( struct x86_function *p, struct x86_reg dst, struct x86_reg src );
@@ -150,17 +165,23 @@ void sse_movlps( struct x86_function *p, struct x86_reg dst, struct x86_reg src
 void sse_movss( struct x86_function *p, struct x86_reg dst, struct x86_reg src );
 void sse_movups( struct x86_function *p, struct x86_reg dst, struct x86_reg src );
 void sse_mulps( struct x86_function *p, struct x86_reg dst, struct x86_reg src );
+void sse_orps( struct x86_function *p, struct x86_reg dst, struct x86_reg src );
 void sse_subps( struct x86_function *p, struct x86_reg dst, struct x86_reg src );
 void sse_rsqrtss( struct x86_function *p, struct x86_reg dst, struct x86_reg src );
 void sse_shufps( struct x86_function *p, struct x86_reg dest, struct x86_reg arg0, GLubyte shuf );
+void sse_sqrtps( struct x86_function *p, struct x86_reg dst, struct x86_reg src );
+void sse_xorps( struct x86_function *p, struct x86_reg dst, struct x86_reg src );
 
+void x86_call( struct x86_function *p, struct x86_reg reg );
 void x86_cmp( struct x86_function *p, struct x86_reg dst, struct x86_reg src );
 void x86_dec( struct x86_function *p, struct x86_reg reg );
 void x86_inc( struct x86_function *p, struct x86_reg reg );
 void x86_lea( struct x86_function *p, struct x86_reg dst, struct x86_reg src );
 void x86_mov( struct x86_function *p, struct x86_reg dst, struct x86_reg src );
+void x86_mov_reg_imm( struct x86_function *p, struct x86_reg dst, GLint imm );
 void x86_pop( struct x86_function *p, struct x86_reg reg );
 void x86_push( struct x86_function *p, struct x86_reg reg );
+void x86_push_imm32( struct x86_function *p, GLint imm );
 void x86_ret( struct x86_function *p );
 void x86_test( struct x86_function *p, struct x86_reg dst, struct x86_reg src );
 void x86_xor( struct x86_function *p, struct x86_reg dst, struct x86_reg src );
@@ -210,12 +231,14 @@ void x87_fnstsw( struct x86_function *p, struct x86_reg dst );
 void x87_fucompp( struct x86_function *p );
 void x87_fucomp( struct x86_function *p, struct x86_reg arg );
 void x87_fucom( struct x86_function *p, struct x86_reg arg );
+void x87_fucomip( struct x86_function *p, struct x86_reg arg );
 
 
 
 /* Retreive a reference to one of the function arguments, taking into
  * account any push/pop activity.  Note - doesn't track explict
- * manipulation of ESP by other instructions.
+ * manipulation of ESP by other instructions.  On x86-64 the first six
+ * arguments are registers.
  */
 struct x86_reg x86_fn_arg( struct x86_function *p, GLuint arg );
 
@@ -414,6 +414,18 @@ SOURCE=..\..\..\..\src\mesa\swrast\s_fog.c
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\..\..\src\mesa\swrast\s_fragprog_sse.c
+# End Source File
+# Begin Source File
+
+SOURCE=..\..\..\..\src\mesa\swrast\s_hiz.c
+# End Source File
+# Begin Source File
+
+SOURCE=..\..\..\..\src\mesa\swrast\s_lazyclear.c
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\..\..\src\mesa\swrast\s_imaging.c
 # End Source File
 # Begin Source File
@@ -442,6 +454,10 @@ SOURCE=..\..\..\..\src\mesa\swrast\s_points.c
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\..\..\src\mesa\swrast\s_readpbo.c
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\..\..\src\mesa\swrast\s_readpix.c
 # End Source File
 # Begin Source File
@@ -466,6 +482,10 @@ SOURCE=..\..\..\..\src\mesa\swrast\s_triangle.c
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\..\..\src\mesa\swrast\s_tribin.c
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\..\..\src\mesa\swrast\s_zoom.c
 # End Source File
 # Begin Source File
@@ -562,6 +582,10 @@ SOURCE=..\..\..\..\src\mesa\tnl\t_save_playback.c
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\..\..\src\mesa\tnl\t_slice.c
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\..\..\src\mesa\tnl\t_vb_arbprogram.c
 # End Source File
 # Begin Source File
@@ -1087,6 +1111,14 @@ SOURCE=..\..\..\..\src\mesa\swrast\s_fog.h
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\..\..\src\mesa\swrast\s_hiz.h
+# End Source File
+# Begin Source File
+
+SOURCE=..\..\..\..\src\mesa\swrast\s_lazyclear.h
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\..\..\src\mesa\swrast\s_lines.h
 # End Source File
 # Begin Source File
@@ -1115,6 +1147,10 @@ SOURCE=..\..\..\..\src\mesa\swrast\s_points.h
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\..\..\src\mesa\swrast\s_readpbo.h
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\..\..\src\mesa\swrast\s_pointtemp.h
 # End Source File
 # Begin Source File
@@ -1131,6 +1167,10 @@ SOURCE=..\..\..\..\src\mesa\swrast\s_stencil.h
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\..\..\src\mesa\swrast\s_texsamptemp.h
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\..\..\src\mesa\swrast\s_texture.h
 # End Source File
 # Begin Source File
@@ -1139,6 +1179,10 @@ SOURCE=..\..\..\..\src\mesa\swrast\s_triangle.h
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\..\..\src\mesa\swrast\s_tribin.h
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\..\..\src\mesa\swrast\s_trispan.h
 # End Source File
 # Begin Source File